@@ -0,0 +1,1536 @@
+/* liric_benchmark.c */
+/**
+ * Liric end-to-end throughput benchmark. This drives Liric_Multrun, Liric_Bias_Dark_MultBias and
+ * Liric_Bias_Dark_MultDark over a matrix of coadd exposure lengths, exposure counts, noise image types and image flips,
+ * normally against the simulated frame grabber (detector_grabber_simulator) so no hardware is needed.
+ * For each case we report the frames per second, the dead time between exposures, percentiles of the per-stage
+ * latencies (exposure, inter-exposure gap, exposure period), the detector library's own per-stage latency
+ * statistics (detector_latency) and the peak resident set size, and optionally write the results to a CSV file
+ * for regression tracking.
+ * With -reply_benchmark, we instead time building the filename list and command reply of multruns with
+ * large numbers of frames, comparing the old reallocating Liric_General_Add_String with the string builder.
+ * @author $Author$
+ */
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "log_udp.h"
+
+#include "detector_buffer.h"
+#include "detector_exposure.h"
+#include "detector_fits_filename.h"
+#include "detector_general.h"
+#include "detector_grabber.h"
+#include "detector_grabber_simulator.h"
+#include "detector_latency.h"
+#include "detector_setup.h"
+
+#include "liric_bias_dark.h"
+#include "liric_command.h"
+#include "liric_config.h"
+#include "liric_fits_header.h"
+#include "liric_general.h"
+#include "liric_multrun.h"
+
+/* hash defines */
+/**
+ * Length of some of the strings used in this program.
+ */
+#define STRING_LENGTH                   (256)
+/**
+ * The maximum number of values in each of the benchmark matrix lists (coadd lengths, exposure counts etc).
+ */
+#define MAX_LIST_COUNT                  (16)
+/**
+ * The default number of coadds in each Multrun/MultDark exposure.
+ */
+#define DEFAULT_COADDS_PER_EXPOSURE     (2)
+/**
+ * The default interval between samples of the detector exposure state, in microseconds.
+ */
+#define DEFAULT_SAMPLE_US               (200)
+/**
+ * The default directory to write the benchmark FITS images into.
+ */
+#define DEFAULT_FITS_DIR                "/tmp"
+/**
+ * The config keyword suffix used to pass the benchmark coadd exposure length to Liric_Command_Initialise_Detector,
+ * i.e. the benchmark sets "detector.coadd_exposure_length.benchmark" in the case config file.
+ */
+#define COADD_EXPOSURE_LENGTH_NAME      "benchmark"
+/**
+ * The number of times each reply benchmark case is repeated, to get a measurable time.
+ */
+#define REPLY_REPEAT_COUNT              (100)
+/**
+ * The length of the stack buffer the string builder reply benchmark builds replies in, as in liric_server.c.
+ */
+#define REPLY_BUFFER_LENGTH             (4096)
+
+/* enums */
+/**
+ * Enum of the Liric commands this program benchmarks.
+ * <ul>
+ * <li>COMMAND_MULTRUN
+ * <li>COMMAND_MULTBIAS
+ * <li>COMMAND_MULTDARK
+ * </ul>
+ * The enum values are indexes into Command_Name_List.
+ * @see #Command_Name_List
+ */
+enum COMMAND
+{
+	COMMAND_MULTRUN=0,COMMAND_MULTBIAS=1,COMMAND_MULTDARK=2
+};
+
+/* data types */
+/**
+ * Structure holding the exposure timestamps recorded by the monitor thread during one benchmark case.
+ * <dl>
+ * <dt>Sample_Us</dt> <dd>The interval between samples of Detector_Exposure_In_Progress, in microseconds.</dd>
+ * <dt>Run</dt> <dd>A boolean, the monitor thread samples while this is TRUE.</dd>
+ * <dt>Start_Time_List</dt> <dd>A list of timestamps (CLOCK_MONOTONIC) when each exposure was seen to start.</dd>
+ * <dt>End_Time_List</dt> <dd>A list of timestamps (CLOCK_MONOTONIC) when each exposure was seen to end.</dd>
+ * <dt>Allocated_Count</dt> <dd>The number of elements allocated in Start_Time_List / End_Time_List.</dd>
+ * <dt>Exposure_Count</dt> <dd>The number of exposures seen to start.</dd>
+ * <dt>End_Count</dt> <dd>The number of exposures seen to end.</dd>
+ * </dl>
+ */
+struct Monitor_Struct
+{
+	int Sample_Us;
+	volatile int Run;
+	struct timespec *Start_Time_List;
+	struct timespec *End_Time_List;
+	int Allocated_Count;
+	int Exposure_Count;
+	int End_Count;
+};
+
+/**
+ * Structure holding the latency percentiles of one benchmark stage, in milliseconds.
+ * <dl>
+ * <dt>Count</dt> <dd>The number of samples the percentiles were computed from.</dd>
+ * <dt>P50</dt> <dd>The 50th percentile (median).</dd>
+ * <dt>P90</dt> <dd>The 90th percentile.</dd>
+ * <dt>P99</dt> <dd>The 99th percentile.</dd>
+ * <dt>Max</dt> <dd>The maximum.</dd>
+ * </dl>
+ */
+struct Percentile_Struct
+{
+	int Count;
+	double P50;
+	double P90;
+	double P99;
+	double Max;
+};
+
+/**
+ * Structure holding the detector library's latency statistics of one exposure stage, in milliseconds,
+ * as returned by Detector_Latency_Stage_Statistics_Get.
+ * <dl>
+ * <dt>Count</dt> <dd>The number of latencies the statistics were computed from.</dd>
+ * <dt>Min</dt> <dd>The minimum.</dd>
+ * <dt>Mean</dt> <dd>The mean.</dd>
+ * <dt>P95</dt> <dd>The 95th percentile.</dd>
+ * <dt>Max</dt> <dd>The maximum.</dd>
+ * </dl>
+ * @see ../detector/cdocs/detector_latency.html#Detector_Latency_Stage_Statistics_Get
+ */
+struct Stage_Latency_Struct
+{
+	int Count;
+	double Min;
+	double Mean;
+	double P95;
+	double Max;
+};
+
+/**
+ * Structure holding the results of one benchmark case.
+ * <dl>
+ * <dt>Command</dt> <dd>Which command was benchmarked.</dd>
+ * <dt>Coadd_Length_Ms</dt> <dd>The coadd exposure length in milliseconds (0 for a MultBias).</dd>
+ * <dt>Exposure_Length_Ms</dt> <dd>The nominal exposure length in milliseconds (0 for a MultBias).</dd>
+ * <dt>Exposure_Count</dt> <dd>The number of exposures requested.</dd>
+ * <dt>Noise_Name</dt> <dd>The noise image type, as a string.</dd>
+ * <dt>Flip_Name</dt> <dd>The image flip, as a string.</dd>
+ * <dt>Success</dt> <dd>A boolean, whether the command succeeded.</dd>
+ * <dt>Frame_Count</dt> <dd>The number of FITS images returned by the command.</dd>
+ * <dt>Wall_Time</dt> <dd>The time taken by the command, in seconds.</dd>
+ * <dt>Frames_Per_Second</dt> <dd>The number of FITS images produced per second.</dd>
+ * <dt>Duty_Cycle</dt> <dd>The fraction of the wall time spent exposing (nominal exposure length over wall time).</dd>
+ * <dt>Dead_Time_Ms</dt> <dd>The mean time per exposure not spent exposing, in milliseconds.</dd>
+ * <dt>Startup_Ms</dt> <dd>The time from calling the command to the first exposure starting, in milliseconds.</dd>
+ * <dt>Finish_Ms</dt> <dd>The time from the last exposure ending to the command returning, in milliseconds.</dd>
+ * <dt>Expose</dt> <dd>Percentiles of the time each exposure was in progress (acquire, mean, save).</dd>
+ * <dt>Gap</dt> <dd>Percentiles of the time between one exposure ending and the next starting.</dd>
+ * <dt>Period</dt> <dd>Percentiles of the time between successive exposure starts.</dd>
+ * <dt>Stage_List</dt> <dd>The detector library's latency statistics for each stage (indexed by 
+ *     DETECTOR_LATENCY_STAGE), recorded during this case only.</dd>
+ * <dt>Peak_RSS_KB</dt> <dd>The peak resident set size during the case in kilobytes, or -1 if not available.</dd>
+ * </dl>
+ * @see #COMMAND
+ * @see #Percentile_Struct
+ * @see #Stage_Latency_Struct
+ * @see ../detector/cdocs/detector_latency.html#DETECTOR_LATENCY_STAGE
+ */
+struct Result_Struct
+{
+	enum COMMAND Command;
+	int Coadd_Length_Ms;
+	int Exposure_Length_Ms;
+	int Exposure_Count;
+	char *Noise_Name;
+	char *Flip_Name;
+	int Success;
+	int Frame_Count;
+	double Wall_Time;
+	double Frames_Per_Second;
+	double Duty_Cycle;
+	double Dead_Time_Ms;
+	double Startup_Ms;
+	double Finish_Ms;
+	struct Percentile_Struct Expose;
+	struct Percentile_Struct Gap;
+	struct Percentile_Struct Period;
+	struct Stage_Latency_Struct Stage_List[DETECTOR_LATENCY_STAGE_COUNT];
+	long Peak_RSS_KB;
+};
+
+/* internal variables */
+/**
+ * Revision control system identifier.
+ */
+static char rcsid[] = "$Id$";
+/**
+ * The names of the commands that can be benchmarked, indexed by COMMAND.
+ * @see #COMMAND
+ */
+static char *Command_Name_List[] = {"multrun","multbias","multdark"};
+/**
+ * The names of the noise image types that can be benchmarked, in the same order as DETECTOR_BUFFER_NOISE_TYPE.
+ * These are also the values of the "detector.noise_image.type" config keyword.
+ * @see ../detector/cdocs/detector_buffer.html#DETECTOR_BUFFER_NOISE_TYPE
+ */
+static char *Noise_Name_List[] = {"none","variance","standard_error"};
+/**
+ * The names of the image flips that can be benchmarked. Bit 0 of the index is flip in X, bit 1 flip in Y.
+ */
+static char *Flip_Name_List[] = {"none","x","y","xy"};
+/**
+ * The list of coadd exposure lengths to benchmark, in milliseconds.
+ */
+static int Coadd_Length_List[MAX_LIST_COUNT] = {100};
+/**
+ * The number of coadd exposure lengths in Coadd_Length_List.
+ * @see #Coadd_Length_List
+ */
+static int Coadd_Length_Count = 1;
+/**
+ * The list of exposure counts to benchmark.
+ */
+static int Exposure_Count_List[MAX_LIST_COUNT] = {10};
+/**
+ * The number of exposure counts in Exposure_Count_List.
+ * @see #Exposure_Count_List
+ */
+static int Exposure_Count_Count = 1;
+/**
+ * The list of commands to benchmark, as indexes into Command_Name_List.
+ * @see #Command_Name_List
+ */
+static int Command_List[MAX_LIST_COUNT] = {COMMAND_MULTRUN,COMMAND_MULTBIAS,COMMAND_MULTDARK};
+/**
+ * The number of commands in Command_List.
+ * @see #Command_List
+ */
+static int Command_Count = 3;
+/**
+ * The list of noise image types to benchmark, as indexes into Noise_Name_List.
+ * @see #Noise_Name_List
+ */
+static int Noise_List[MAX_LIST_COUNT] = {0};
+/**
+ * The number of noise image types in Noise_List.
+ * @see #Noise_List
+ */
+static int Noise_Count = 1;
+/**
+ * The list of image flips to benchmark, as indexes into Flip_Name_List.
+ * @see #Flip_Name_List
+ */
+static int Flip_List[MAX_LIST_COUNT] = {0};
+/**
+ * The number of image flips in Flip_List.
+ * @see #Flip_List
+ */
+static int Flip_Count = 1;
+/**
+ * The number of coadds in each Multrun/MultDark exposure.
+ * @see #DEFAULT_COADDS_PER_EXPOSURE
+ */
+static int Coadds_Per_Exposure = DEFAULT_COADDS_PER_EXPOSURE;
+/**
+ * The directory to write the benchmark FITS images into.
+ * @see #DEFAULT_FITS_DIR
+ */
+static char Fits_Dir[STRING_LENGTH] = DEFAULT_FITS_DIR;
+/**
+ * The filename of a CSV file to write the results into, or an empty string to only print them.
+ */
+static char Results_Filename[STRING_LENGTH] = "";
+/**
+ * The filename of the per-case config file, written by Benchmark_Config_Write.
+ * @see #Benchmark_Config_Write
+ */
+static char Case_Config_Filename[STRING_LENGTH] = "";
+/**
+ * A boolean, if TRUE use the frame grabber backend configured in the config file (normally the real hardware),
+ * otherwise the simulated frame grabber.
+ */
+static int Use_Hardware = FALSE;
+/**
+ * A boolean, if TRUE keep the FITS images generated by each case, otherwise delete them.
+ */
+static int Keep_Files = FALSE;
+/**
+ * The exposure timestamps recorded by the monitor thread for the current case.
+ * @see #Monitor_Struct
+ */
+static struct Monitor_Struct Monitor_Data = {DEFAULT_SAMPLE_US,FALSE,NULL,NULL,0,0,0};
+/**
+ * A list of frame counts to run the reply benchmark for.
+ * @see #MAX_LIST_COUNT
+ */
+static int Reply_Frame_Count_List[MAX_LIST_COUNT];
+/**
+ * The number of frame counts in Reply_Frame_Count_List. If this is non-zero, we run the reply benchmark
+ * instead of the throughput benchmark.
+ */
+static int Reply_Frame_Count_Count = 0;
+
+/* internal routines */
+static int Benchmark_Config_Write(int coadd_length_ms,int noise_index,int flip_index);
+static int Benchmark_Detector_Startup(void);
+static int Benchmark_Run_Case(enum COMMAND command,int coadd_length_ms,int exposure_count,int noise_index,
+			      int flip_index,struct Result_Struct *result);
+static int Benchmark_Reply(int frame_count);
+static void *Monitor_Thread(void *user_arg);
+static int Monitor_Start(int exposure_count,pthread_t *thread);
+static void Monitor_Stop(pthread_t thread);
+static int Double_Compare(const void *p1,const void *p2);
+static void Percentile_Compute(double *value_list,int count,struct Percentile_Struct *percentile);
+static void Peak_RSS_Reset(void);
+static long Peak_RSS_Get(void);
+static void Results_Header_Print(FILE *fp);
+static void Results_Print(FILE *fp,struct Result_Struct *result);
+static int Parse_Name_List(char *string,char **name_list,int name_count,int *index_list,int *index_count);
+static int Parse_Integer_List(char *string,int *list,int *count);
+static int Parse_Arguments(int argc, char *argv[]);
+static void Help(void);
+
+/* ------------------------------------------------------------------
+** External functions
+** ------------------------------------------------------------------ */
+/**
+ * Main program.
+ * <ul>
+ * <li>We parse the command line arguments using Parse_Arguments.
+ * <li>If any reply benchmark frame counts were specified, we run Benchmark_Reply for each one and stop.
+ * <li>We generate a per-case config filename (Case_Config_Filename) in the FITS directory.
+ * <li>We write and load an initial case config using Benchmark_Config_Write, and start the detector using
+ *     Benchmark_Detector_Startup.
+ * <li>If Results_Filename is set we open it and write the CSV header row using Results_Header_Print.
+ * <li>For each command, coadd length (MultBias is only run once, at the bias coadd length), exposure count,
+ *     noise image type and flip in the benchmark matrix, we run the case with Benchmark_Run_Case and print the
+ *     results to stdout (and the results file) with Results_Print.
+ * <li>We shutdown the detector with Detector_Setup_Shutdown and Detector_Buffer_Thread_Pool_Stop,
+ *     and delete the per-case config file.
+ * </ul>
+ * @param argc The number of arguments to the program.
+ * @param argv An array of argument strings.
+ * @return This function returns 0 if the program succeeds, and a positive integer if it fails.
+ * @see #Parse_Arguments
+ * @see #Benchmark_Config_Write
+ * @see #Benchmark_Detector_Startup
+ * @see #Benchmark_Run_Case
+ * @see #Benchmark_Reply
+ * @see #Reply_Frame_Count_List
+ * @see #Results_Header_Print
+ * @see #Results_Print
+ * @see #Case_Config_Filename
+ * @see #Results_Filename
+ * @see #Command_List
+ * @see #Coadd_Length_List
+ * @see #Exposure_Count_List
+ * @see #Noise_List
+ * @see #Flip_List
+ * @see liric_general.html#Liric_General_Error
+ * @see ../detector/cdocs/detector_setup.html#Detector_Setup_Shutdown
+ * @see ../detector/cdocs/detector_buffer.html#Detector_Buffer_Thread_Pool_Stop
+ */
+int main(int argc, char *argv[])
+{
+	struct Result_Struct result;
+	FILE *results_fp = NULL;
+	int command_index,coadd_index,count_index,noise_index,flip_index,coadd_length_ms,failure_count;
+
+	/* parse arguments */
+	fprintf(stdout,"liric_benchmark : Parsing Arguments.\n");
+	if(!Parse_Arguments(argc,argv))
+		return 1;
+	if(Reply_Frame_Count_Count > 0)
+	{
+		failure_count = 0;
+		fprintf(stdout,"frames,reply_length,filename_list_ms,add_string_ms,string_builder_ms,speedup\n");
+		for(count_index = 0; count_index < Reply_Frame_Count_Count; count_index++)
+		{
+			if(!Benchmark_Reply(Reply_Frame_Count_List[count_index]))
+			{
+				Liric_General_Error("benchmark","liric_benchmark.c","main",LOG_VERBOSITY_VERY_TERSE,
+						    "BENCHMARK");
+				failure_count++;
+			}
+		}
+		if(failure_count > 0)
+			return 6;
+		return 0;
+	}
+	if(Liric_General_Get_Config_Filename() == NULL)
+	{
+		fprintf(stderr,"liric_benchmark : No config filename specified.\n");
+		return 2;
+	}
+	sprintf(Case_Config_Filename,"%s/liric_benchmark_%d.properties",Fits_Dir,(int)getpid());
+	/* initial config and detector startup */
+	if(!Benchmark_Config_Write(Coadd_Length_List[0],Noise_List[0],Flip_List[0]))
+	{
+		Liric_General_Error("benchmark","liric_benchmark.c","main",LOG_VERBOSITY_VERY_TERSE,"BENCHMARK");
+		return 3;
+	}
+	if(!Benchmark_Detector_Startup())
+	{
+		Liric_General_Error("benchmark","liric_benchmark.c","main",LOG_VERBOSITY_VERY_TERSE,"BENCHMARK");
+		unlink(Case_Config_Filename);
+		return 4;
+	}
+	if(strlen(Results_Filename) > 0)
+	{
+		results_fp = fopen(Results_Filename,"w");
+		if(results_fp == NULL)
+		{
+			fprintf(stderr,"liric_benchmark : Failed to open results file '%s' (%d).\n",Results_Filename,errno);
+			unlink(Case_Config_Filename);
+			return 5;
+		}
+		Results_Header_Print(results_fp);
+	}
+	Results_Header_Print(stdout);
+	failure_count = 0;
+	for(command_index = 0; command_index < Command_Count; command_index++)
+	{
+		for(coadd_index = 0; coadd_index < Coadd_Length_Count; coadd_index++)
+		{
+			/* a multbias always uses the bias coadd length, so only run it once */
+			if((Command_List[command_index] == COMMAND_MULTBIAS)&&(coadd_index > 0))
+				break;
+			coadd_length_ms = Coadd_Length_List[coadd_index];
+			for(count_index = 0; count_index < Exposure_Count_Count; count_index++)
+			{
+				for(noise_index = 0; noise_index < Noise_Count; noise_index++)
+				{
+					for(flip_index = 0; flip_index < Flip_Count; flip_index++)
+					{
+						if(!Benchmark_Run_Case(Command_List[command_index],coadd_length_ms,
+								       Exposure_Count_List[count_index],
+								       Noise_List[noise_index],Flip_List[flip_index],
+								       &result))
+						{
+							Liric_General_Error("benchmark","liric_benchmark.c","main",
+									    LOG_VERBOSITY_VERY_TERSE,"BENCHMARK");
+							failure_count++;
+						}
+						Results_Print(stdout,&result);
+						if(results_fp != NULL)
+							Results_Print(results_fp,&result);
+					}
+				}
+			}
+		}
+	}
+	if(results_fp != NULL)
+		fclose(results_fp);
+	/* shutdown */
+	if(!Detector_Setup_Shutdown())
+		Detector_General_Error();
+	if(!Detector_Buffer_Thread_Pool_Stop())
+		Detector_General_Error();
+	Liric_Config_Shutdown();
+	unlink(Case_Config_Filename);
+	fprintf(stdout,"liric_benchmark : Finished with %d failed cases.\n",failure_count);
+	if(failure_count > 0)
+		return 6;
+	return 0;
+}
+
+/* -----------------------------------------------------------------------------
+**      Internal routines
+** ----------------------------------------------------------------------------- */
+/**
+ * Write a per-case config file, and load it as the current config. The config file is a copy of the
+ * base config file (Liric_General_Get_Config_Filename), with the following keywords overridden:
+ * <ul>
+ * <li>"nudgematic.enable" and "filter_wheel.enable" are set to false, so the mechanisms are not moved.
+ * <li>"detector.grabber.backend" is set to "simulator" and "detector.grabber.simulator.field_period" to 0
+ *     (derive the field period from the format filename), unless Use_Hardware is set.
+ * <li>"detector.coadd_exposure_length.benchmark" is set to coadd_length_ms.
+ * <li>"detector.noise_image.type" is set to the noise image type.
+ * <li>"liric.multrun.image.flip.x" and "liric.multrun.image.flip.y" are set from the flip.
+ * <li>"file.fits.path" is set to Fits_Dir.
+ * </ul>
+ * The new config is written to Case_Config_Filename, and loaded with Liric_Config_Shutdown / Liric_Config_Load.
+ * @param coadd_length_ms The coadd exposure length in milliseconds.
+ * @param noise_index The noise image type, as an index into Noise_Name_List.
+ * @param flip_index The image flip, as an index into Flip_Name_List.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #COADD_EXPOSURE_LENGTH_NAME
+ * @see #Case_Config_Filename
+ * @see #Fits_Dir
+ * @see #Use_Hardware
+ * @see #Noise_Name_List
+ * @see #Flip_Name_List
+ * @see liric_config.html#Liric_Config_Load
+ * @see liric_config.html#Liric_Config_Shutdown
+ * @see liric_general.html#Liric_General_Get_Config_Filename
+ */
+static int Benchmark_Config_Write(int coadd_length_ms,int noise_index,int flip_index)
+{
+	static char *override_key_list[] = {"nudgematic.enable","filter_wheel.enable","detector.grabber.backend",
+					    "detector.grabber.simulator.field_period",
+					    "detector.coadd_exposure_length."COADD_EXPOSURE_LENGTH_NAME,
+					    "detector.noise_image.type","liric.multrun.image.flip.x",
+					    "liric.multrun.image.flip.y","file.fits.path"};
+	FILE *base_fp = NULL;
+	FILE *case_fp = NULL;
+	char line[1024];
+	char key[STRING_LENGTH];
+	int i,override;
+
+	base_fp = fopen(Liric_General_Get_Config_Filename(),"r");
+	if(base_fp == NULL)
+	{
+		fprintf(stderr,"Benchmark_Config_Write:Failed to open base config '%s' (%d).\n",
+			Liric_General_Get_Config_Filename(),errno);
+		return FALSE;
+	}
+	case_fp = fopen(Case_Config_Filename,"w");
+	if(case_fp == NULL)
+	{
+		fprintf(stderr,"Benchmark_Config_Write:Failed to open case config '%s' (%d).\n",
+			Case_Config_Filename,errno);
+		fclose(base_fp);
+		return FALSE;
+	}
+	/* copy the base config, dropping the keywords we override */
+	while(fgets(line,1024,base_fp) != NULL)
+	{
+		override = FALSE;
+		if(sscanf(line," %255[^ \t=]",key) == 1)
+		{
+			for(i = 0; i < (int)(sizeof(override_key_list)/sizeof(override_key_list[0])); i++)
+			{
+				if(strcmp(key,override_key_list[i]) == 0)
+					override = TRUE;
+			}
+		}
+		if(override == FALSE)
+			fputs(line,case_fp);
+	}
+	fclose(base_fp);
+	fprintf(case_fp,"\n# liric_benchmark case overrides\n");
+	fprintf(case_fp,"nudgematic.enable\t\t= false\n");
+	fprintf(case_fp,"filter_wheel.enable\t\t= false\n");
+	if(Use_Hardware)
+		fprintf(case_fp,"detector.grabber.backend\t\t= xclib\n");
+	else
+		fprintf(case_fp,"detector.grabber.backend\t\t= simulator\n");
+	fprintf(case_fp,"detector.grabber.simulator.field_period\t= 0\n");
+	fprintf(case_fp,"detector.coadd_exposure_length.%s\t= %d\n",COADD_EXPOSURE_LENGTH_NAME,coadd_length_ms);
+	fprintf(case_fp,"detector.noise_image.type\t\t= %s\n",Noise_Name_List[noise_index]);
+	fprintf(case_fp,"liric.multrun.image.flip.x\t\t= %s\n",(flip_index & 1) ? "true" : "false");
+	fprintf(case_fp,"liric.multrun.image.flip.y\t\t= %s\n",(flip_index & 2) ? "true" : "false");
+	fprintf(case_fp,"file.fits.path\t\t\t\t= %s\n",Fits_Dir);
+	fclose(case_fp);
+	/* reload the config */
+	Liric_Config_Shutdown();
+	if(!Liric_Config_Load(Case_Config_Filename))
+		return FALSE;
+	return TRUE;
+}
+
+/**
+ * Start the detector library, using the currently loaded (case) config. This follows the detector startup
+ * in liric_main.c, without the fan control.
+ * <ul>
+ * <li>We call Detector_Buffer_Memory_Options_Set with the "detector.buffer.huge_pages" and "detector.buffer.lock"
+ *     config values.
+ * <li>We call Detector_Grabber_Backend_Set with the backend from "detector.grabber.backend",
+ *     and Detector_Grabber_Simulator_Field_Period_Set with "detector.grabber.simulator.field_period".
+ * <li>We call Liric_Command_Initialise_Detector to start the detector using the benchmark coadd exposure length.
+ * <li>We call Detector_Buffer_Saturation_Level_Set with "detector.saturation_level".
+ * <li>We call Detector_Buffer_Thread_Pool_Start with "detector.buffer.thread.count" threads (not pinned).
+ * <li>We call Detector_Buffer_Strip_Row_Count_Set with "detector.buffer.strip.rows".
+ * <li>We call Detector_Fits_Filename_Initialise with "file.fits.instrument_code" and Fits_Dir.
+ * <li>We call Liric_Fits_Header_Initialise.
+ * </ul>
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #COADD_EXPOSURE_LENGTH_NAME
+ * @see #Fits_Dir
+ * @see liric_command.html#Liric_Command_Initialise_Detector
+ * @see liric_config.html#Liric_Config_Get_Boolean
+ * @see liric_config.html#Liric_Config_Get_Character
+ * @see liric_config.html#Liric_Config_Get_Integer
+ * @see liric_config.html#Liric_Config_Get_String
+ * @see liric_fits_header.html#Liric_Fits_Header_Initialise
+ * @see ../detector/cdocs/detector_buffer.html#Detector_Buffer_Memory_Options_Set
+ * @see ../detector/cdocs/detector_buffer.html#Detector_Buffer_Saturation_Level_Set
+ * @see ../detector/cdocs/detector_buffer.html#Detector_Buffer_Thread_Pool_Start
+ * @see ../detector/cdocs/detector_buffer.html#Detector_Buffer_Strip_Row_Count_Set
+ * @see ../detector/cdocs/detector_grabber.html#Detector_Grabber_Backend_Set
+ * @see ../detector/cdocs/detector_grabber_simulator.html#Detector_Grabber_Simulator_Field_Period_Set
+ * @see ../detector/cdocs/detector_fits_filename.html#Detector_Fits_Filename_Initialise
+ */
+static int Benchmark_Detector_Startup(void)
+{
+	enum DETECTOR_GRABBER_BACKEND grabber_backend;
+	int use_huge_pages,lock_memory,field_period,saturation_level,thread_count,strip_row_count;
+	char instrument_code;
+	char *grabber_backend_string = NULL;
+
+	if(!Liric_Config_Get_Boolean("detector.buffer.huge_pages",&use_huge_pages))
+		return FALSE;
+	if(!Liric_Config_Get_Boolean("detector.buffer.lock",&lock_memory))
+		return FALSE;
+	if(!Detector_Buffer_Memory_Options_Set(use_huge_pages,lock_memory))
+		return FALSE;
+	if(!Liric_Config_Get_String("detector.grabber.backend",&grabber_backend_string))
+		return FALSE;
+	if(strcmp(grabber_backend_string,"simulator") == 0)
+		grabber_backend = DETECTOR_GRABBER_BACKEND_SIMULATOR;
+	else
+		grabber_backend = DETECTOR_GRABBER_BACKEND_XCLIB;
+	free(grabber_backend_string);
+	if(!Detector_Grabber_Backend_Set(grabber_backend))
+		return FALSE;
+	if(!Liric_Config_Get_Integer("detector.grabber.simulator.field_period",&field_period))
+		return FALSE;
+	if(!Detector_Grabber_Simulator_Field_Period_Set(field_period))
+		return FALSE;
+	if(!Liric_Command_Initialise_Detector(COADD_EXPOSURE_LENGTH_NAME))
+		return FALSE;
+	if(!Liric_Config_Get_Integer("detector.saturation_level",&saturation_level))
+		return FALSE;
+	if(!Detector_Buffer_Saturation_Level_Set(saturation_level))
+		return FALSE;
+	if(!Liric_Config_Get_Integer("detector.buffer.thread.count",&thread_count))
+		return FALSE;
+	if(!Detector_Buffer_Thread_Pool_Start(thread_count,NULL,0))
+		return FALSE;
+	if(!Liric_Config_Get_Integer("detector.buffer.strip.rows",&strip_row_count))
+		return FALSE;
+	if(!Detector_Buffer_Strip_Row_Count_Set(strip_row_count))
+		return FALSE;
+	if(!Liric_Config_Get_Character("file.fits.instrument_code",&instrument_code))
+		return FALSE;
+	if(!Detector_Fits_Filename_Initialise(instrument_code,Fits_Dir))
+		return FALSE;
+	if(!Liric_Fits_Header_Initialise())
+		return FALSE;
+	return TRUE;
+}
+
+/**
+ * Run one benchmark case.
+ * <ul>
+ * <li>We reset the detector latency statistics with Detector_Latency_Reset, so only this case's latencies
+ *     (including any format switch) are reported.
+ * <li>We write and load the case config using Benchmark_Config_Write.
+ * <li>If the command is not a MultBias, we re-initialise the detector at the case coadd exposure length using
+ *     Liric_Command_Initialise_Detector (a MultBias re-initialises the detector itself).
+ * <li>We set the noise image type with Detector_Buffer_Noise_Type_Set.
+ * <li>We reset the peak RSS with Peak_RSS_Reset, and start the monitor thread with Monitor_Start.
+ * <li>We call Liric_Multrun, Liric_Bias_Dark_MultBias or Liric_Bias_Dark_MultDark, timing the call.
+ * <li>We stop the monitor thread with Monitor_Stop, and get the peak RSS with Peak_RSS_Get.
+ * <li>We compute the frames per second, duty cycle and dead time, and the exposure, gap and period latency
+ *     percentiles from the monitor timestamps using Percentile_Compute.
+ * <li>We get the detector latency statistics of each stage with Detector_Latency_Stage_Statistics_Get.
+ * <li>Unless Keep_Files is set, we delete the generated FITS images.
+ * <li>We free the returned filename list with Detector_Fits_Filename_List_Free.
+ * </ul>
+ * @param command Which command to benchmark.
+ * @param coadd_length_ms The coadd exposure length in milliseconds (ignored for a MultBias).
+ * @param exposure_count The number of exposures to take.
+ * @param noise_index The noise image type, as an index into Noise_Name_List.
+ * @param flip_index The image flip, as an index into Flip_Name_List.
+ * @param result The address of a Result_Struct to fill in with the case results. This is filled in
+ *        (with Success FALSE) even if the case fails.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #COMMAND
+ * @see #Result_Struct
+ * @see #Monitor_Data
+ * @see #Coadds_Per_Exposure
+ * @see #Keep_Files
+ * @see #Benchmark_Config_Write
+ * @see #Monitor_Start
+ * @see #Monitor_Stop
+ * @see #Percentile_Compute
+ * @see #Peak_RSS_Reset
+ * @see #Peak_RSS_Get
+ * @see liric_command.html#Liric_Command_Initialise_Detector
+ * @see liric_multrun.html#Liric_Multrun
+ * @see liric_bias_dark.html#Liric_Bias_Dark_MultBias
+ * @see liric_bias_dark.html#Liric_Bias_Dark_MultDark
+ * @see ../detector/cdocs/detector_buffer.html#Detector_Buffer_Noise_Type_Set
+ * @see ../detector/cdocs/detector_fits_filename.html#Detector_Fits_Filename_List_Free
+ * @see ../detector/cdocs/detector_general.html#fdifftime
+ * @see ../detector/cdocs/detector_latency.html#Detector_Latency_Reset
+ * @see ../detector/cdocs/detector_latency.html#Detector_Latency_Stage_Statistics_Get
+ */
+static int Benchmark_Run_Case(enum COMMAND command,int coadd_length_ms,int exposure_count,int noise_index,
+			      int flip_index,struct Result_Struct *result)
+{
+	struct timespec start_time,end_time;
+	pthread_t monitor_thread;
+	double *value_list = NULL;
+	char **filename_list = NULL;
+	int filename_count = 0;
+	int i,retval,count;
+
+	/* initialise the result */
+	memset(result,0,sizeof(struct Result_Struct));
+	result->Command = command;
+	if(command == COMMAND_MULTBIAS)
+	{
+		result->Coadd_Length_Ms = 0;
+		result->Exposure_Length_Ms = 0;
+	}
+	else
+	{
+		result->Coadd_Length_Ms = coadd_length_ms;
+		result->Exposure_Length_Ms = coadd_length_ms*Coadds_Per_Exposure;
+	}
+	result->Exposure_Count = exposure_count;
+	result->Noise_Name = Noise_Name_List[noise_index];
+	result->Flip_Name = Flip_Name_List[flip_index];
+	result->Success = FALSE;
+	result->Peak_RSS_KB = -1;
+	Detector_Latency_Reset();
+	/* configure the case */
+	if(!Benchmark_Config_Write(coadd_length_ms,noise_index,flip_index))
+		return FALSE;
+	if(command != COMMAND_MULTBIAS)
+	{
+		if(!Liric_Command_Initialise_Detector(COADD_EXPOSURE_LENGTH_NAME))
+			return FALSE;
+	}
+	if(!Detector_Buffer_Noise_Type_Set((enum DETECTOR_BUFFER_NOISE_TYPE)noise_index))
+		return FALSE;
+	/* run the command */
+	Peak_RSS_Reset();
+	if(!Monitor_Start(exposure_count,&monitor_thread))
+		return FALSE;
+	clock_gettime(CLOCK_MONOTONIC,&start_time);
+	switch(command)
+	{
+		case COMMAND_MULTRUN:
+			retval = Liric_Multrun(result->Exposure_Length_Ms,exposure_count,FALSE,&filename_list,
+					       &filename_count);
+			break;
+		case COMMAND_MULTBIAS:
+			retval = Liric_Bias_Dark_MultBias(exposure_count,&filename_list,&filename_count);
+			break;
+		case COMMAND_MULTDARK:
+			retval = Liric_Bias_Dark_MultDark(result->Exposure_Length_Ms,exposure_count,&filename_list,
+							  &filename_count);
+			break;
+		default:
+			retval = FALSE;
+			break;
+	}
+	clock_gettime(CLOCK_MONOTONIC,&end_time);
+	Monitor_Stop(monitor_thread);
+	result->Peak_RSS_KB = Peak_RSS_Get();
+	result->Success = retval;
+	result->Frame_Count = filename_count;
+	/* throughput */
+	result->Wall_Time = fdifftime(end_time,start_time);
+	if(result->Wall_Time > 0.0)
+	{
+		result->Frames_Per_Second = ((double)filename_count)/result->Wall_Time;
+		result->Duty_Cycle = (((double)filename_count)*((double)result->Exposure_Length_Ms)/
+				      DETECTOR_GENERAL_ONE_SECOND_MS)/result->Wall_Time;
+	}
+	if(filename_count > 0)
+	{
+		result->Dead_Time_Ms = ((result->Wall_Time*DETECTOR_GENERAL_ONE_SECOND_MS)-
+					(((double)filename_count)*((double)result->Exposure_Length_Ms)))/
+			((double)filename_count);
+	}
+	/* per stage latencies */
+	if(Monitor_Data.Exposure_Count > 0)
+	{
+		result->Startup_Ms = fdifftime(Monitor_Data.Start_Time_List[0],start_time)*
+			DETECTOR_GENERAL_ONE_SECOND_MS;
+	}
+	if(Monitor_Data.End_Count > 0)
+	{
+		result->Finish_Ms = fdifftime(end_time,Monitor_Data.End_Time_List[Monitor_Data.End_Count-1])*
+			DETECTOR_GENERAL_ONE_SECOND_MS;
+	}
+	value_list = (double *)malloc((Monitor_Data.Allocated_Count+1)*sizeof(double));
+	if(value_list != NULL)
+	{
+		for(i = 0; i < Monitor_Data.End_Count; i++)
+		{
+			value_list[i] = fdifftime(Monitor_Data.End_Time_List[i],Monitor_Data.Start_Time_List[i])*
+				DETECTOR_GENERAL_ONE_SECOND_MS;
+		}
+		Percentile_Compute(value_list,Monitor_Data.End_Count,&(result->Expose));
+		count = 0;
+		for(i = 1; (i < Monitor_Data.Exposure_Count)&&(i <= Monitor_Data.End_Count); i++)
+		{
+			value_list[count++] = fdifftime(Monitor_Data.Start_Time_List[i],Monitor_Data.End_Time_List[i-1])*
+				DETECTOR_GENERAL_ONE_SECOND_MS;
+		}
+		Percentile_Compute(value_list,count,&(result->Gap));
+		count = 0;
+		for(i = 1; i < Monitor_Data.Exposure_Count; i++)
+		{
+			value_list[count++] = fdifftime(Monitor_Data.Start_Time_List[i],
+							Monitor_Data.Start_Time_List[i-1])*DETECTOR_GENERAL_ONE_SECOND_MS;
+		}
+		Percentile_Compute(value_list,count,&(result->Period));
+		free(value_list);
+	}
+	/* the detector library's per-stage latencies */
+	for(i = 0; i < DETECTOR_LATENCY_STAGE_COUNT; i++)
+	{
+		if(!Detector_Latency_Stage_Statistics_Get((enum DETECTOR_LATENCY_STAGE)i,&(result->Stage_List[i].Count),
+							  &(result->Stage_List[i].Min),&(result->Stage_List[i].Mean),
+							  &(result->Stage_List[i].P95),&(result->Stage_List[i].Max)))
+		{
+			Detector_General_Error();
+		}
+	}
+	/* tidy up the generated FITS images */
+	if(Keep_Files == FALSE)
+	{
+		for(i = 0; i < filename_count; i++)
+			unlink(filename_list[i]);
+	}
+	Detector_Fits_Filename_List_Free(&filename_list,&filename_count);
+	return retval;
+}
+
+/**
+ * Benchmark building the filename list and command reply of a multrun of frame_count frames.
+ * <ul>
+ * <li>We build a list of frame_count FITS filenames with Detector_Fits_Filename_List_Add, as a multrun does,
+ *     and time it.
+ * <li>We build a "job frames" style reply (the command reply that grows with the number of frames) for the
+ *     filenames REPLY_REPEAT_COUNT times by appending each frame with Liric_General_Add_String (which reallocates
+ *     the reply on every append), and time it.
+ * <li>We build the same reply REPLY_REPEAT_COUNT times with a string builder using a REPLY_BUFFER_LENGTH stack
+ *     buffer (as liric_server.c does), and time it.
+ * <li>We check the two replies are identical, and print a CSV row of the results to stdout.
+ * </ul>
+ * @param frame_count The number of frames in the multrun.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #REPLY_REPEAT_COUNT
+ * @see #REPLY_BUFFER_LENGTH
+ * @see liric_general.html#Liric_General_Add_String
+ * @see liric_general.html#Liric_General_String_Builder_Initialise
+ * @see liric_general.html#Liric_General_String_Builder_Add
+ * @see liric_general.html#Liric_General_String_Builder_Add_Format
+ * @see liric_general.html#Liric_General_String_Builder_Get
+ * @see liric_general.html#Liric_General_String_Builder_Length_Get
+ * @see liric_general.html#Liric_General_String_Builder_Free
+ * @see ../detector/cdocs/detector_fits_filename.html#Detector_Fits_Filename_List_Add
+ * @see ../detector/cdocs/detector_fits_filename.html#Detector_Fits_Filename_List_Free
+ * @see ../detector/cdocs/detector_general.html#fdifftime
+ */
+static int Benchmark_Reply(int frame_count)
+{
+	struct Liric_General_String_Builder_Struct builder;
+	struct timespec start_time,end_time;
+	char reply_buffer[REPLY_BUFFER_LENGTH];
+	char frame_string[STRING_LENGTH+64];
+	char filename[STRING_LENGTH];
+	char **filename_list = NULL;
+	char *reply_string = NULL;
+	double filename_list_ms,add_string_ms,string_builder_ms;
+	int filename_count,i,repeat,retval;
+
+	/* build the filename list */
+	filename_count = 0;
+	clock_gettime(CLOCK_MONOTONIC,&start_time);
+	for(i = 0; i < frame_count; i++)
+	{
+		sprintf(filename,"%s/l_e_20261018_1_%d_1_0.fits",Fits_Dir,i+1);
+		if(!Detector_Fits_Filename_List_Add(filename,&filename_list,&filename_count))
+		{
+			Detector_General_Error();
+			Detector_Fits_Filename_List_Free(&filename_list,&filename_count);
+			return FALSE;
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC,&end_time);
+	filename_list_ms = fdifftime(end_time,start_time)*LIRIC_GENERAL_ONE_SECOND_MS;
+	/* build the reply with Liric_General_Add_String */
+	clock_gettime(CLOCK_MONOTONIC,&start_time);
+	for(repeat = 0; repeat < REPLY_REPEAT_COUNT; repeat++)
+	{
+		if(reply_string != NULL)
+			free(reply_string);
+		reply_string = NULL;
+		sprintf(frame_string,"0 FINISHED %d",filename_count);
+		retval = Liric_General_Add_String(&reply_string,frame_string);
+		for(i = 0; (i < filename_count)&&retval; i++)
+		{
+			sprintf(frame_string," %d %s 2026-10-18T12:00:00.000 %.3f",i,filename_list[i],1000.0);
+			retval = Liric_General_Add_String(&reply_string,frame_string);
+		}
+		if(retval == FALSE)
+		{
+			if(reply_string != NULL)
+				free(reply_string);
+			Detector_Fits_Filename_List_Free(&filename_list,&filename_count);
+			return FALSE;
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC,&end_time);
+	add_string_ms = fdifftime(end_time,start_time)*LIRIC_GENERAL_ONE_SECOND_MS/REPLY_REPEAT_COUNT;
+	/* build the reply with a string builder */
+	clock_gettime(CLOCK_MONOTONIC,&start_time);
+	for(repeat = 0; repeat < REPLY_REPEAT_COUNT; repeat++)
+	{
+		if(repeat > 0)
+			Liric_General_String_Builder_Free(&builder);
+		Liric_General_String_Builder_Initialise(&builder,reply_buffer,REPLY_BUFFER_LENGTH,0);
+		retval = Liric_General_String_Builder_Add_Format(&builder,"0 FINISHED %d",filename_count);
+		for(i = 0; (i < filename_count)&&retval; i++)
+		{
+			retval = Liric_General_String_Builder_Add_Format(&builder," %d %s 2026-10-18T12:00:00.000 %.3f",i,
+									 filename_list[i],1000.0);
+		}
+		if(retval == FALSE)
+		{
+			free(reply_string);
+			Liric_General_String_Builder_Free(&builder);
+			Detector_Fits_Filename_List_Free(&filename_list,&filename_count);
+			return FALSE;
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC,&end_time);
+	string_builder_ms = fdifftime(end_time,start_time)*LIRIC_GENERAL_ONE_SECOND_MS/REPLY_REPEAT_COUNT;
+	/* check the replies are the same */
+	retval = (strcmp(reply_string,Liric_General_String_Builder_Get(&builder)) == 0);
+	if(retval == FALSE)
+		fprintf(stderr,"Benchmark_Reply:Replies for %d frames differ.\n",frame_count);
+	fprintf(stdout,"%d,%lu,%.4f,%.4f,%.4f,%.2f\n",frame_count,
+		(unsigned long)Liric_General_String_Builder_Length_Get(&builder),filename_list_ms,add_string_ms,
+		string_builder_ms,(string_builder_ms > 0.0) ? add_string_ms/string_builder_ms : 0.0);
+	free(reply_string);
+	Liric_General_String_Builder_Free(&builder);
+	Detector_Fits_Filename_List_Free(&filename_list,&filename_count);
+	return retval;
+}
+
+/**
+ * Monitor thread. Whilst Monitor_Data.Run is TRUE, every Monitor_Data.Sample_Us microseconds we sample
+ * Detector_Exposure_In_Progress, and record a timestamp (CLOCK_MONOTONIC) in Monitor_Data.Start_Time_List
+ * when an exposure starts, and in Monitor_Data.End_Time_List when it ends.
+ * @param user_arg Unused.
+ * @return The routine returns NULL.
+ * @see #Monitor_Data
+ * @see ../detector/cdocs/detector_exposure.html#Detector_Exposure_In_Progress
+ */
+static void *Monitor_Thread(void *user_arg)
+{
+	struct timespec sleep_time;
+	int in_progress,last_in_progress;
+
+	sleep_time.tv_sec = Monitor_Data.Sample_Us/1000000;
+	sleep_time.tv_nsec = (Monitor_Data.Sample_Us%1000000)*1000;
+	last_in_progress = FALSE;
+	while(Monitor_Data.Run)
+	{
+		in_progress = Detector_Exposure_In_Progress();
+		if(in_progress && (last_in_progress == FALSE))
+		{
+			if(Monitor_Data.Exposure_Count < Monitor_Data.Allocated_Count)
+			{
+				clock_gettime(CLOCK_MONOTONIC,&(Monitor_Data.Start_Time_List[Monitor_Data.Exposure_Count]));
+				Monitor_Data.Exposure_Count++;
+			}
+		}
+		else if((in_progress == FALSE) && last_in_progress)
+		{
+			if(Monitor_Data.End_Count < Monitor_Data.Exposure_Count)
+			{
+				clock_gettime(CLOCK_MONOTONIC,&(Monitor_Data.End_Time_List[Monitor_Data.End_Count]));
+				Monitor_Data.End_Count++;
+			}
+		}
+		last_in_progress = in_progress;
+		nanosleep(&sleep_time,NULL);
+	}
+	return NULL;
+}
+
+/**
+ * Allocate the monitor timestamp lists and start the monitor thread.
+ * @param exposure_count The number of exposures the case will take, used to size the timestamp lists.
+ * @param thread The address of a pthread_t, on return filled in with the monitor thread.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Monitor_Data
+ * @see #Monitor_Thread
+ */
+static int Monitor_Start(int exposure_count,pthread_t *thread)
+{
+	int retval;
+
+	Monitor_Data.Start_Time_List = (struct timespec *)realloc(Monitor_Data.Start_Time_List,
+								  exposure_count*sizeof(struct timespec));
+	Monitor_Data.End_Time_List = (struct timespec *)realloc(Monitor_Data.End_Time_List,
+								exposure_count*sizeof(struct timespec));
+	if((Monitor_Data.Start_Time_List == NULL)||(Monitor_Data.End_Time_List == NULL))
+	{
+		fprintf(stderr,"Monitor_Start:Failed to allocate timestamp lists of length %d.\n",exposure_count);
+		return FALSE;
+	}
+	Monitor_Data.Allocated_Count = exposure_count;
+	Monitor_Data.Exposure_Count = 0;
+	Monitor_Data.End_Count = 0;
+	Monitor_Data.Run = TRUE;
+	retval = pthread_create(thread,NULL,Monitor_Thread,NULL);
+	if(retval != 0)
+	{
+		fprintf(stderr,"Monitor_Start:Failed to create monitor thread (%d).\n",retval);
+		Monitor_Data.Run = FALSE;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * Stop the monitor thread, and wait for it to finish.
+ * @param thread The monitor thread.
+ * @see #Monitor_Data
+ */
+static void Monitor_Stop(pthread_t thread)
+{
+	Monitor_Data.Run = FALSE;
+	pthread_join(thread,NULL);
+}
+
+/**
+ * qsort comparison routine for doubles.
+ * @param p1 A pointer to the first double.
+ * @param p2 A pointer to the second double.
+ * @return -1, 0 or 1 depending on whether the first double is less than, equal to or greater than the second.
+ */
+static int Double_Compare(const void *p1,const void *p2)
+{
+	double d1 = *((const double *)p1);
+	double d2 = *((const double *)p2);
+
+	if(d1 < d2)
+		return -1;
+	if(d1 > d2)
+		return 1;
+	return 0;
+}
+
+/**
+ * Compute the nearest-rank percentiles of a list of values. The list is sorted in place.
+ * @param value_list The list of values.
+ * @param count The number of values in the list. If this is zero, all the percentiles are set to zero.
+ * @param percentile The address of a Percentile_Struct to fill in.
+ * @see #Percentile_Struct
+ * @see #Double_Compare
+ */
+static void Percentile_Compute(double *value_list,int count,struct Percentile_Struct *percentile)
+{
+	memset(percentile,0,sizeof(struct Percentile_Struct));
+	percentile->Count = count;
+	if(count < 1)
+		return;
+	qsort(value_list,count,sizeof(double),Double_Compare);
+	percentile->P50 = value_list[((count*50)+99)/100-1];
+	percentile->P90 = value_list[((count*90)+99)/100-1];
+	percentile->P99 = value_list[((count*99)+99)/100-1];
+	percentile->Max = value_list[count-1];
+}
+
+/**
+ * Reset the peak resident set size (VmHWM) of this process to its current resident set size, by writing "5"
+ * to /proc/self/clear_refs. If this fails, Peak_RSS_Get returns the peak since the process started.
+ * @see #Peak_RSS_Get
+ */
+static void Peak_RSS_Reset(void)
+{
+	FILE *fp = NULL;
+
+	fp = fopen("/proc/self/clear_refs","w");
+	if(fp == NULL)
+		return;
+	fputs("5",fp);
+	fclose(fp);
+}
+
+/**
+ * Get the peak resident set size (VmHWM) of this process from /proc/self/status.
+ * @return The peak resident set size in kilobytes, or -1 if it could not be read.
+ * @see #Peak_RSS_Reset
+ */
+static long Peak_RSS_Get(void)
+{
+	FILE *fp = NULL;
+	char line[STRING_LENGTH];
+	long peak_rss_kb = -1;
+
+	fp = fopen("/proc/self/status","r");
+	if(fp == NULL)
+		return -1;
+	while(fgets(line,STRING_LENGTH,fp) != NULL)
+	{
+		if(sscanf(line,"VmHWM: %ld kB",&peak_rss_kb) == 1)
+			break;
+	}
+	fclose(fp);
+	return peak_rss_kb;
+}
+
+/**
+ * Print the CSV header row describing the columns printed by Results_Print. The detector latency stage columns
+ * are named after the stages (Detector_Latency_Stage_Name_Get).
+ * @param fp The file pointer to print to.
+ * @see #Results_Print
+ * @see ../detector/cdocs/detector_latency.html#Detector_Latency_Stage_Name_Get
+ */
+static void Results_Header_Print(FILE *fp)
+{
+	char *stage_name = NULL;
+	int i;
+
+	fprintf(fp,"command,coadd_ms,exposure_ms,exposure_count,noise,flip,success,frames,wall_s,fps,duty_cycle,"
+		"dead_time_ms,startup_ms,finish_ms,"
+		"expose_p50_ms,expose_p90_ms,expose_p99_ms,expose_max_ms,"
+		"gap_p50_ms,gap_p90_ms,gap_p99_ms,gap_max_ms,"
+		"period_p50_ms,period_p90_ms,period_p99_ms,period_max_ms,");
+	for(i = 0; i < DETECTOR_LATENCY_STAGE_COUNT; i++)
+	{
+		stage_name = Detector_Latency_Stage_Name_Get((enum DETECTOR_LATENCY_STAGE)i);
+		fprintf(fp,"%s_count,%s_min_ms,%s_mean_ms,%s_p95_ms,%s_max_ms,",stage_name,stage_name,stage_name,
+			stage_name,stage_name);
+	}
+	fprintf(fp,"peak_rss_kb\n");
+	fflush(fp);
+}
+
+/**
+ * Print the results of a benchmark case as a CSV row.
+ * @param fp The file pointer to print to.
+ * @param result The address of the case results to print.
+ * @see #Results_Header_Print
+ * @see #Result_Struct
+ * @see #Command_Name_List
+ */
+static void Results_Print(FILE *fp,struct Result_Struct *result)
+{
+	int i;
+
+	fprintf(fp,"%s,%d,%d,%d,%s,%s,%d,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,",Command_Name_List[result->Command],
+		result->Coadd_Length_Ms,result->Exposure_Length_Ms,result->Exposure_Count,result->Noise_Name,
+		result->Flip_Name,result->Success,result->Frame_Count,result->Wall_Time,result->Frames_Per_Second,
+		result->Duty_Cycle,result->Dead_Time_Ms,result->Startup_Ms,result->Finish_Ms);
+	fprintf(fp,"%.3f,%.3f,%.3f,%.3f,",result->Expose.P50,result->Expose.P90,result->Expose.P99,
+		result->Expose.Max);
+	fprintf(fp,"%.3f,%.3f,%.3f,%.3f,",result->Gap.P50,result->Gap.P90,result->Gap.P99,result->Gap.Max);
+	fprintf(fp,"%.3f,%.3f,%.3f,%.3f,",result->Period.P50,result->Period.P90,result->Period.P99,
+		result->Period.Max);
+	for(i = 0; i < DETECTOR_LATENCY_STAGE_COUNT; i++)
+	{
+		fprintf(fp,"%d,%.3f,%.3f,%.3f,%.3f,",result->Stage_List[i].Count,result->Stage_List[i].Min,
+			result->Stage_List[i].Mean,result->Stage_List[i].P95,result->Stage_List[i].Max);
+	}
+	fprintf(fp,"%ld\n",result->Peak_RSS_KB);
+	fflush(fp);
+}
+
+/**
+ * Parse a comma separated list of names into a list of indexes into name_list.
+ * @param string The comma separated string to parse. This is modified by strtok.
+ * @param name_list The list of valid names.
+ * @param name_count The number of names in name_list.
+ * @param index_list A list of at least MAX_LIST_COUNT integers, filled in with the index of each parsed name.
+ * @param index_count The address of an integer, filled in with the number of parsed names.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #MAX_LIST_COUNT
+ */
+static int Parse_Name_List(char *string,char **name_list,int name_count,int *index_list,int *index_count)
+{
+	char *token = NULL;
+	int i,found;
+
+	(*index_count) = 0;
+	token = strtok(string,",");
+	while(token != NULL)
+	{
+		if((*index_count) >= MAX_LIST_COUNT)
+		{
+			fprintf(stderr,"Parse_Name_List:Too many values (max %d).\n",MAX_LIST_COUNT);
+			return FALSE;
+		}
+		found = FALSE;
+		for(i = 0; i < name_count; i++)
+		{
+			if(strcmp(token,name_list[i]) == 0)
+			{
+				index_list[(*index_count)++] = i;
+				found = TRUE;
+				break;
+			}
+		}
+		if(found == FALSE)
+		{
+			fprintf(stderr,"Parse_Name_List:Illegal value '%s'.\n",token);
+			return FALSE;
+		}
+		token = strtok(NULL,",");
+	}
+	return TRUE;
+}
+
+/**
+ * Parse a comma separated list of positive integers.
+ * @param string The comma separated string to parse. This is modified by strtok.
+ * @param list A list of at least MAX_LIST_COUNT integers, filled in with the parsed integers.
+ * @param count The address of an integer, filled in with the number of parsed integers.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #MAX_LIST_COUNT
+ */
+static int Parse_Integer_List(char *string,int *list,int *count)
+{
+	char *token = NULL;
+
+	(*count) = 0;
+	token = strtok(string,",");
+	while(token != NULL)
+	{
+		if((*count) >= MAX_LIST_COUNT)
+		{
+			fprintf(stderr,"Parse_Integer_List:Too many values (max %d).\n",MAX_LIST_COUNT);
+			return FALSE;
+		}
+		if((sscanf(token,"%d",&(list[(*count)])) != 1)||(list[(*count)] < 1))
+		{
+			fprintf(stderr,"Parse_Integer_List:Illegal value '%s'.\n",token);
+			return FALSE;
+		}
+		(*count)++;
+		token = strtok(NULL,",");
+	}
+	return TRUE;
+}
+
+/**
+ * Routine to parse command line arguments.
+ * @param argc The number of arguments sent to the program.
+ * @param argv An array of argument strings.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Help
+ * @see #Parse_Name_List
+ * @see #Parse_Integer_List
+ * @see #Coadd_Length_List
+ * @see #Exposure_Count_List
+ * @see #Command_List
+ * @see #Noise_List
+ * @see #Flip_List
+ * @see #Coadds_Per_Exposure
+ * @see #Fits_Dir
+ * @see #Results_Filename
+ * @see #Use_Hardware
+ * @see #Keep_Files
+ * @see #Monitor_Data
+ * @see #Reply_Frame_Count_List
+ * @see #Reply_Frame_Count_Count
+ * @see liric_general.html#Liric_General_Set_Config_Filename
+ * @see liric_general.html#Liric_General_Set_Log_Filter_Level
+ * @see ../detector/cdocs/detector_general.html#Detector_General_Set_Log_Filter_Level
+ */
+static int Parse_Arguments(int argc, char *argv[])
+{
+	int i,retval,log_level;
+
+	for(i=1;i<argc;i++)
+	{
+		if((strcmp(argv[i],"-coadd_lengths")==0)||(strcmp(argv[i],"-cl")==0))
+		{
+			if((i+1)<argc)
+			{
+				if(!Parse_Integer_List(argv[i+1],Coadd_Length_List,&Coadd_Length_Count))
+					return FALSE;
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:-coadd_lengths requires a comma separated list.\n");
+				return FALSE;
+			}
+		}
+		else if(strcmp(argv[i],"-coadds")==0)
+		{
+			if((i+1)<argc)
+			{
+				retval = sscanf(argv[i+1],"%d",&Coadds_Per_Exposure);
+				if((retval != 1)||(Coadds_Per_Exposure < 1))
+				{
+					fprintf(stderr,"Parse_Arguments:Parsing coadds %s failed.\n",argv[i+1]);
+					return FALSE;
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:-coadds requires a number of coadds.\n");
+				return FALSE;
+			}
+		}
+		else if(strcmp(argv[i],"-commands")==0)
+		{
+			if((i+1)<argc)
+			{
+				if(!Parse_Name_List(argv[i+1],Command_Name_List,3,Command_List,&Command_Count))
+					return FALSE;
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:-commands requires a comma separated list.\n");
+				return FALSE;
+			}
+		}
+		else if((strcmp(argv[i],"-config_filename")==0)||(strcmp(argv[i],"-co")==0))
+		{
+			if((i+1)<argc)
+			{
+				if(!Liric_General_Set_Config_Filename(argv[i+1]))
+				{
+					fprintf(stderr,"Parse_Arguments:"
+						"Liric_General_Set_Config_Filename failed.\n");
+					return FALSE;
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:config filename required.\n");
+				return FALSE;
+			}
+		}
+		else if((strcmp(argv[i],"-detector_log_level")==0)||(strcmp(argv[i],"-detll")==0))
+		{
+			if((i+1)<argc)
+			{
+				retval = sscanf(argv[i+1],"%d",&log_level);
+				if(retval != 1)
+				{
+					fprintf(stderr,"Parse_Arguments:Parsing log level %s failed.\n",argv[i+1]);
+					return FALSE;
+				}
+				Detector_General_Set_Log_Filter_Level(log_level);
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:Log Level requires a level.\n");
+				return FALSE;
+			}
+		}
+		else if((strcmp(argv[i],"-exposure_counts")==0)||(strcmp(argv[i],"-ec")==0))
+		{
+			if((i+1)<argc)
+			{
+				if(!Parse_Integer_List(argv[i+1],Exposure_Count_List,&Exposure_Count_Count))
+					return FALSE;
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:-exposure_counts requires a comma separated list.\n");
+				return FALSE;
+			}
+		}
+		else if(strcmp(argv[i],"-fits_dir")==0)
+		{
+			if((i+1)<argc)
+			{
+				strncpy(Fits_Dir,argv[i+1],STRING_LENGTH-1);
+				Fits_Dir[STRING_LENGTH-1] = '\0';
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:-fits_dir requires a directory.\n");
+				return FALSE;
+			}
+		}
+		else if(strcmp(argv[i],"-flip")==0)
+		{
+			if((i+1)<argc)
+			{
+				if(!Parse_Name_List(argv[i+1],Flip_Name_List,4,Flip_List,&Flip_Count))
+					return FALSE;
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:-flip requires a comma separated list.\n");
+				return FALSE;
+			}
+		}
+		else if(strcmp(argv[i],"-hardware")==0)
+		{
+			Use_Hardware = TRUE;
+		}
+		else if((strcmp(argv[i],"-help")==0)||(strcmp(argv[i],"-h")==0))
+		{
+			Help();
+			exit(0);
+		}
+		else if(strcmp(argv[i],"-keep")==0)
+		{
+			Keep_Files = TRUE;
+		}
+		else if((strcmp(argv[i],"-liric_log_level")==0)||(strcmp(argv[i],"-ll")==0))
+		{
+			if((i+1)<argc)
+			{
+				retval = sscanf(argv[i+1],"%d",&log_level);
+				if(retval != 1)
+				{
+					fprintf(stderr,"Parse_Arguments:Parsing log level %s failed.\n",argv[i+1]);
+					return FALSE;
+				}
+				Liric_General_Set_Log_Filter_Level(log_level);
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:Log Level requires a level.\n");
+				return FALSE;
+			}
+		}
+		else if(strcmp(argv[i],"-noise")==0)
+		{
+			if((i+1)<argc)
+			{
+				if(!Parse_Name_List(argv[i+1],Noise_Name_List,3,Noise_List,&Noise_Count))
+					return FALSE;
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:-noise requires a comma separated list.\n");
+				return FALSE;
+			}
+		}
+		else if(strcmp(argv[i],"-reply_benchmark")==0)
+		{
+			if((i+1)<argc)
+			{
+				if(!Parse_Integer_List(argv[i+1],Reply_Frame_Count_List,&Reply_Frame_Count_Count))
+					return FALSE;
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:-reply_benchmark requires a comma separated list.\n");
+				return FALSE;
+			}
+		}
+		else if(strcmp(argv[i],"-results")==0)
+		{
+			if((i+1)<argc)
+			{
+				strncpy(Results_Filename,argv[i+1],STRING_LENGTH-1);
+				Results_Filename[STRING_LENGTH-1] = '\0';
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:-results requires a filename.\n");
+				return FALSE;
+			}
+		}
+		else if(strcmp(argv[i],"-sample_us")==0)
+		{
+			if((i+1)<argc)
+			{
+				retval = sscanf(argv[i+1],"%d",&(Monitor_Data.Sample_Us));
+				if((retval != 1)||(Monitor_Data.Sample_Us < 1))
+				{
+					fprintf(stderr,"Parse_Arguments:Parsing sample interval %s failed.\n",argv[i+1]);
+					return FALSE;
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:-sample_us requires an interval in microseconds.\n");
+				return FALSE;
+			}
+		}
+		else
+		{
+			fprintf(stderr,"Parse_Arguments:argument '%s' not recognized.\n",argv[i]);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/**
+ * Help routine.
+ */
+static void Help(void)
+{
+	fprintf(stdout,"Liric Benchmark:Help.\n");
+	fprintf(stdout,"This program benchmarks multrun, multbias and multdark throughput, normally against the "
+		"simulated frame grabber.\n");
+	fprintf(stdout,"liric_benchmark -co[nfig_filename] <filename>\n");
+	fprintf(stdout,"\t[-cl|-coadd_lengths <ms,ms,...>][-ec|-exposure_counts <n,n,...>][-coadds <n>]\n");
+	fprintf(stdout,"\t[-commands <multrun,multbias,multdark>][-noise <none,variance,standard_error>]\n");
+	fprintf(stdout,"\t[-flip <none,x,y,xy>][-fits_dir <directory>][-results <csv filename>]\n");
+	fprintf(stdout,"\t[-hardware][-keep][-sample_us <us>]\n");
+	fprintf(stdout,"\t[-liric_log_level|-ll <level>][-detector_log_level|-detll <level>]\n");
+	fprintf(stdout,"liric_benchmark -reply_benchmark <frames,frames,...>\n");
+	fprintf(stdout,"\n");
+	fprintf(stdout,"\tEach combination of the comma separated lists is run as a separate case.\n");
+	fprintf(stdout,"\t-coadds is the number of coadds in each multrun/multdark exposure.\n");
+	fprintf(stdout,"\t-hardware uses the frame grabber backend in the config file, rather than the simulator.\n");
+	fprintf(stdout,"\t-keep keeps the generated FITS images, otherwise they are deleted after each case.\n");
+	fprintf(stdout,"\t-sample_us is the interval the exposure state is sampled at, in microseconds.\n");
+	fprintf(stdout,"\t-reply_benchmark times building the filename list and reply of multruns with the\n");
+	fprintf(stdout,"\t\tspecified numbers of frames, and does not need a config file or detector.\n");
+	fprintf(stdout,"\t<level> is an integer from 1..5.\n");
+}
@@ -29,6 +29,8 @@
 #include "detector_exposure.h"
 #include "detector_fits_filename.h"
 #include "detector_fits_header.h"
+#include "detector_latency.h"
+#include "detector_trace.h"
 #include "detector_setup.h"
 #include "detector_temperature.h"
 
@@ -40,7 +42,10 @@
 #include "liric_config.h"
 #include "liric_fits_header.h"
 #include "liric_general.h"
+#include "liric_job.h"
 #include "liric_bias_dark.h"
+#include "liric_shm.h"
+#include "liric_state.h"
 
 /* hash defines */
 /**
@@ -105,6 +110,7 @@ static int Moptop_Abort = FALSE;
 /* internal function declarations */
 static int Bias_Dark_Fits_Headers_Set(int is_bias,int exposure_count);
 static int Bias_Dark_Exposure_Fits_Headers_Set(void);
+static void Bias_Dark_State_Set(int in_progress);
 
 /* ----------------------------------------------------------------------------
 ** 		external functions 
@@ -114,9 +120,10 @@ static int Bias_Dark_Exposure_Fits_Headers_Set(void);
  * <ul>
  * <li>We check the input arguments are valid.
  * <li>We initialise the internal variables.
- * <li>We retrieve the multrun flipping configuration fron config ("liric.multrun.image.flip.[x|y]" and configure
- *     the detector exposure code appropriately (Detector_Exposure_Flip_Set).
- * <li>We move the filter wheel (if configured) to the mirror position.
+ * <li>We retrieve the multrun flipping configuration ("liric.multrun.image.flip.[x|y]") from the typed config
+ *     cache (Liric_Config_Cache_Get), and configure the detector exposure code appropriately 
+ *     (Detector_Exposure_Flip_Set).
+ * <li>We move the filter wheel (if configured) to the mirror position, recording the move as a trace span.
  * <li>We re-configure the detector to use coadds of a minimum per-coadd exposure length, 
  *     by calling Liric_Command_Initialise_Detector with coadd exposure length string "bias".
  * <li>We call Detector_Fits_Filename_Next_Multrun to generate FITS filenames for a new Multbias.
@@ -128,11 +135,17 @@ static int Bias_Dark_Exposure_Fits_Headers_Set(void);
  *     <li>We call Detector_Fits_Filename_Next_Run to increment the run number in the FITS filename generation code.
  *     <li>We call Detector_Fits_Filename_Get_Filename to generate a suitable FITS image filename.
  *     <li>We check Moptop_Abort to see if the multdark has been aborted by another command thread.
- *     <li>We call Bias_Dark_Exposure_Fits_Headers_Set to make any per-exposure FITS header changes here.
+ *     <li>We call Bias_Dark_Exposure_Fits_Headers_Set to make any per-exposure FITS header changes here,
+ *         timing it using Detector_Latency_Stage_Record.
+ *     <li>Each exposure is recorded as a trace span using Detector_Trace_Span_Start and Detector_Trace_Span_End.
  *     <li>We call Detector_Exposure_Bias to take the image (a single frame/coadd) and save it to the FITS image filename.
  *     <li>We call Detector_Fits_Filename_List_Add to add the new FITS image filename to the return list of filenames.
+ *     <li>We call Liric_Shm_Frame_Publish to publish the frame to any local shared memory readers.
+ *     <li>We call Liric_Job_Frame_Saved to record the frame, if the multbias/multdark is running as a job.
  *     </ul>
- * <li>We set Bias_Dark_In_Progress to FALSE, to indicate we have finished the Multbias.
+ * <li>We set Bias_Dark_In_Progress to FALSE (Bias_Dark_State_Set), to indicate we have finished the Multbias.
+ *     Bias_Dark_State_Set also publishes the frame count and index as each frame is started,
+ *     and Liric_State_Exposure_Update publishes the end of each exposure.
  * </ul>
  * @param exposure_count The number of dark exposure to perform in the multbias.
  * @param filename_list The address of a list of strings, on a successful return from this routine an allocated list 
@@ -144,11 +157,14 @@ static int Bias_Dark_Exposure_Fits_Headers_Set(void);
  *         Liric_General_Error_String should be set.
  * @see #Moptop_Abort
  * @see #Bias_Dark_In_Progress
+ * @see #Bias_Dark_State_Set
+ * @see liric_state.html#Liric_State_Exposure_Update
+ * @see liric_state.html#Liric_State_Filter_Wheel_Set
  * @see #Bias_Dark_Data
  * @see #Bias_Dark_Fits_Headers_Set
  * @see #Bias_Dark_Exposure_Fits_Headers_Set
  * @see liric_command.html#Liric_Command_Initialise_Detector
- * @see liric_config.html#Liric_Config_Get_Boolean
+ * @see liric_config.html#Liric_Config_Cache_Get
  * @see liric_config.html#Liric_Config_Filter_Wheel_Is_Enabled
  * @see liric_general.html#LIRIC_GENERAL_IS_BOOLEAN
  * @see liric_general.html#Liric_General_Error_Number
@@ -163,13 +179,22 @@ static int Bias_Dark_Exposure_Fits_Headers_Set(void);
  * @see ../detector/cdocs/detector_fits_filename.html#Detector_Fits_Filename_Next_Run
  * @see ../detector/cdocs/detector_fits_filename.html#Detector_Fits_Filename_Get_Filename
  * @see ../detector/cdocs/detector_fits_filename.html#Detector_Fits_Filename_List_Add
+ * @see liric_job.html#Liric_Job_Frame_Saved
+ * @see liric_shm.html#Liric_Shm_Frame_Publish
+ * @see ../detector/cdocs/detector_latency.html#Detector_Latency_Timestamp
+ * @see ../detector/cdocs/detector_latency.html#Detector_Latency_Stage_Record
+ * @see ../detector/cdocs/detector_latency.html#Detector_Latency_Exposure_Reset
+ * @see ../detector/cdocs/detector_trace.html#Detector_Trace_Span_Start
+ * @see ../detector/cdocs/detector_trace.html#Detector_Trace_Span_End
  * @see ../filter_wheel/cdocs/filter_wheel_config.html#Filter_Wheel_Config_Name_To_Position
  * @see ../filter_wheel/cdocs/filter_wheel_command.html#ilter_Wheel_Command_Move
  */
 int Liric_Bias_Dark_MultBias(int exposure_count,char ***filename_list,int *filename_count)
 {
 	char fits_filename[256];
-	int flip_x,flip_y,mirror_filter_wheel_position;
+	struct timespec latency_time,trace_time;
+	struct Liric_Config_Cache_Struct config_cache;
+	int mirror_filter_wheel_position,retval;
 	
 	/* check arguments */
 	if(exposure_count < 1)
@@ -196,31 +221,36 @@ int Liric_Bias_Dark_MultBias(int exposure_count,char ***filename_list,int *filen
 				  "MULTBIAS","Started with exposure count %d.",exposure_count);
 #endif
 	/* initialise internal variables */
-	Bias_Dark_In_Progress = TRUE;
-	Moptop_Abort = FALSE;
 	Bias_Dark_Data.Image_Count = exposure_count;
+	Bias_Dark_Data.Image_Index = 0;
+	Bias_Dark_State_Set(TRUE);
+	Moptop_Abort = FALSE;
 	(*filename_list) = NULL;
 	(*filename_count) = 0;
 	/* configure flipping of output image */
-	if(!Liric_Config_Get_Boolean("liric.multrun.image.flip.x",&flip_x))
-		return FALSE;		
-	if(!Liric_Config_Get_Boolean("liric.multrun.image.flip.y",&flip_y))
-		return FALSE;		
-	Detector_Exposure_Flip_Set(flip_x,flip_y);
+	Liric_Config_Cache_Get(&config_cache);
+	Detector_Exposure_Flip_Set(config_cache.Multrun_Image_Flip_X,config_cache.Multrun_Image_Flip_Y);
 	/* move filter wheel to mirror position */
 	if(Liric_Config_Filter_Wheel_Is_Enabled())
 	{
 		/* which filter position contains the Mirror filter */
 		if(!Filter_Wheel_Config_Name_To_Position("Mirror",&mirror_filter_wheel_position))
 		{
+			Bias_Dark_State_Set(FALSE);
 			Liric_General_Error_Number = 714;
 			sprintf(Liric_General_Error_String,
 				"Liric_Bias_Dark_MultBias:Failed to find Mirror filter wheel position.");
 			return FALSE;
 		}
 		/* move filter wheel */
-		if(!Filter_Wheel_Command_Move(mirror_filter_wheel_position))
+		Detector_Trace_Span_Start(&trace_time);
+		Liric_State_Filter_Wheel_Set(TRUE,0);
+		retval = Filter_Wheel_Command_Move(mirror_filter_wheel_position);
+		Liric_State_Filter_Wheel_Set(retval,retval ? mirror_filter_wheel_position : 0);
+		Detector_Trace_Span_End("mechanism","filter_wheel_move","Mirror",&trace_time);
+		if(!retval)
 		{
+			Bias_Dark_State_Set(FALSE);
 			Liric_General_Error_Number = 715;
 			sprintf(Liric_General_Error_String,
 				"Liric_Bias_Dark_MultBias:Failed to move filter wheel to  Mirror position %d.",
@@ -231,13 +261,13 @@ int Liric_Bias_Dark_MultBias(int exposure_count,char ***filename_list,int *filen
 	/* setup detector to do minimum coadd exposure lengths for a bias */
 	if(!Liric_Command_Initialise_Detector("bias"))
 	{
-		Bias_Dark_In_Progress = FALSE;
+		Bias_Dark_State_Set(FALSE);
 		return FALSE;
 	}
 	/* intialise FITS filenames for new multrun*/
 	if(!Detector_Fits_Filename_Next_Multrun())
 	{
-		Bias_Dark_In_Progress = FALSE;
+		Bias_Dark_State_Set(FALSE);
 		Liric_General_Error_Number = 716;
 		sprintf(Liric_General_Error_String,"Liric_Bias_Dark_MultBias:Failed to initialise FITS filename multrun.");
 		return FALSE;
@@ -245,11 +275,13 @@ int Liric_Bias_Dark_MultBias(int exposure_count,char ***filename_list,int *filen
 	/* do any per-multbias FITS header changes here */
 	if(!Bias_Dark_Fits_Headers_Set(TRUE,exposure_count))
 	{
-		Bias_Dark_In_Progress = FALSE;
+		Bias_Dark_State_Set(FALSE);
 		return FALSE;
 	}
 	/* take a multrun start timestamp */
 	clock_gettime(CLOCK_REALTIME,&(Bias_Dark_Data.Bias_Dark_Start_Time));
+	/* discard any per-exposure stage latencies left over from a previously failed exposure */
+	Detector_Latency_Exposure_Reset();
 	/* start multbias for loop */
 	for(Bias_Dark_Data.Image_Index = 0; Bias_Dark_Data.Image_Index < Bias_Dark_Data.Image_Count;
 	    Bias_Dark_Data.Image_Index++)
@@ -257,15 +289,17 @@ int Liric_Bias_Dark_MultBias(int exposure_count,char ***filename_list,int *filen
 		/* check for aborts */
 		if(Moptop_Abort)
 		{
-			Bias_Dark_In_Progress = FALSE;
+			Bias_Dark_State_Set(FALSE);
 			Liric_General_Error_Number = 717;
 			sprintf(Liric_General_Error_String,"Liric_Bias_Dark_MultBias:Aborted.");
 			return FALSE;
 		}
+		/* publish which frame we are taking */
+		Bias_Dark_State_Set(TRUE);
 		/* generate new FITS image filename */
 		if(!Detector_Fits_Filename_Next_Run())
 		{
-			Bias_Dark_In_Progress = FALSE;
+			Bias_Dark_State_Set(FALSE);
 			Liric_General_Error_Number = 718;
 			sprintf(Liric_General_Error_String,
 				"Liric_Bias_Dark_MultBias:Failed to generate next FITS filename run number.");
@@ -275,7 +309,7 @@ int Liric_Bias_Dark_MultBias(int exposure_count,char ***filename_list,int *filen
 							DETECTOR_FITS_FILENAME_PIPELINE_FLAG_UNREDUCED,
 							fits_filename,256))
 		{
-			Bias_Dark_In_Progress = FALSE;
+			Bias_Dark_State_Set(FALSE);
 			Liric_General_Error_Number = 719;
 			sprintf(Liric_General_Error_String,
 				"Liric_Bias_Dark_MultBias:Failed to generate next FITS filename.");
@@ -284,21 +318,27 @@ int Liric_Bias_Dark_MultBias(int exposure_count,char ***filename_list,int *filen
 		/* check for aborts */
 		if(Moptop_Abort)
 		{
-			Bias_Dark_In_Progress = FALSE;
+			Bias_Dark_State_Set(FALSE);
 			Liric_General_Error_Number = 710;
 			sprintf(Liric_General_Error_String,"Liric_Bias_Dark_MultBias:Aborted.");
 			return FALSE;
 		}
 		/* do any per-multbias frame FITS header changes here */
+		Detector_Latency_Timestamp(&latency_time);
 		if(!Bias_Dark_Exposure_Fits_Headers_Set())
 		{
-			Bias_Dark_In_Progress = FALSE;
+			Bias_Dark_State_Set(FALSE);
 			return FALSE;
 		}
+		Detector_Latency_Stage_Record(DETECTOR_LATENCY_STAGE_HEADER_SET,&latency_time);
 		/* take an exposure */
-		if(!Detector_Exposure_Bias(fits_filename))
+		Detector_Trace_Span_Start(&trace_time);
+		retval = Detector_Exposure_Bias(fits_filename);
+		Liric_State_Exposure_Update(FALSE);
+		Detector_Trace_Span_End("exposure","bias",NULL,&trace_time);
+		if(!retval)
 		{
-			Bias_Dark_In_Progress = FALSE;
+			Bias_Dark_State_Set(FALSE);
 			Liric_General_Error_Number = 720;
 			sprintf(Liric_General_Error_String,
 				"Liric_Bias_Dark_MultBias:Failed to take bias exposure %d with filename '%s'.",
@@ -308,16 +348,24 @@ int Liric_Bias_Dark_MultBias(int exposure_count,char ***filename_list,int *filen
 		/* add fits image to list */
 		if(!Detector_Fits_Filename_List_Add(fits_filename,filename_list,filename_count))
 		{
-			Bias_Dark_In_Progress = FALSE;
+			Bias_Dark_State_Set(FALSE);
 			Liric_General_Error_Number = 721;
 			sprintf(Liric_General_Error_String,
 				"Liric_Bias_Dark_MultBias:Failed to add filename '%s' to list of length %d.",
 				fits_filename,(*filename_count));
 			return FALSE;
 		}
+		/* publish the frame to local shared memory readers (if enabled), this does not stop the multbias */
+		if(!Liric_Shm_Frame_Publish(fits_filename))
+		{
+			Liric_General_Error("multbias","liric_bias_dark.c","Liric_Bias_Dark_MultBias",LOG_VERBOSITY_TERSE,
+					    "MULTBIAS");
+		}
+		/* record the frame in the job (if any) and wake any clients waiting for it */
+		Liric_Job_Frame_Saved(fits_filename);
 	}/* end for on Bias_Dark_Data.Image_Index */
 	/* we have finished the multbias */
-	Bias_Dark_In_Progress = FALSE;
+	Bias_Dark_State_Set(FALSE);
 #if LIRIC_DEBUG > 1
 	Liric_General_Log("multbias","liric_bias_dark.c","Liric_Bias_Dark_MultBias",LOG_VERBOSITY_TERSE,"MULTBIAS",
 			   "Finished.");
@@ -329,9 +377,10 @@ int Liric_Bias_Dark_MultBias(int exposure_count,char ***filename_list,int *filen
  * Routine to perform a multdark.
  * <ul>
  * <li>We initialise the internal variables.
- * <li>We retrieve the multrun flipping configuration fron config ("liric.multrun.image.flip.[x|y]" and configure
- *     the detector exposure code appropriately (Detector_Exposure_Flip_Set).
- * <li>We move the filter wheel (if configured) to the mirror position.
+ * <li>We retrieve the multrun flipping configuration ("liric.multrun.image.flip.[x|y]") from the typed config
+ *     cache (Liric_Config_Cache_Get), and configure the detector exposure code appropriately 
+ *     (Detector_Exposure_Flip_Set).
+ * <li>We move the filter wheel (if configured) to the mirror position, recording the move as a trace span.
  * <li>We call Detector_Fits_Filename_Next_Multrun to generate FITS filenames for a new MultDark.
  * <li>We call Bias_Dark_Fits_Headers_Set to make any per-multdark FITS header changes here.
  * <li>We take a multdark start timestamp.
@@ -341,11 +390,17 @@ int Liric_Bias_Dark_MultBias(int exposure_count,char ***filename_list,int *filen
  *     <li>We call Detector_Fits_Filename_Next_Run to increment the run number in the FITS filename generation code.
  *     <li>We call Detector_Fits_Filename_Get_Filename to generate a suitable FITS image filename.
  *     <li>We check Moptop_Abort to see if the multdark has been aborted by another command thread.
- *     <li>We call Bias_Dark_Exposure_Fits_Headers_Set to make any per-exposure FITS header changes here.
+ *     <li>We call Bias_Dark_Exposure_Fits_Headers_Set to make any per-exposure FITS header changes here,
+ *         timing it using Detector_Latency_Stage_Record.
+ *     <li>Each exposure is recorded as a trace span using Detector_Trace_Span_Start and Detector_Trace_Span_End.
  *     <li>We call Detector_Exposure_Expose to take the image (a series of coadds) and save it to the FITS image filename.
  *     <li>We call Detector_Fits_Filename_List_Add to add the new FITS image filename to the return list of filenames.
+ *     <li>We call Liric_Shm_Frame_Publish to publish the frame to any local shared memory readers.
+ *     <li>We call Liric_Job_Frame_Saved to record the frame, if the multbias/multdark is running as a job.
  *     </ul>
- * <li>We set Bias_Dark_In_Progress to FALSE, to indicate we have finished the Multdark.
+ * <li>We set Bias_Dark_In_Progress to FALSE (Bias_Dark_State_Set), to indicate we have finished the Multdark.
+ *     Bias_Dark_State_Set also publishes the frame count and index as each frame is started,
+ *     and Liric_State_Exposure_Update publishes the end of each exposure.
  * </ul>
  * @param exposure_length_ms The exposure length of an individual frame in the multdark (itself consisting of a number
  *        of coadds) in milliseconds.
@@ -359,10 +414,13 @@ int Liric_Bias_Dark_MultBias(int exposure_count,char ***filename_list,int *filen
  *         Liric_General_Error_String should be set.
  * @see #Moptop_Abort
  * @see #Bias_Dark_In_Progress
+ * @see #Bias_Dark_State_Set
+ * @see liric_state.html#Liric_State_Exposure_Update
+ * @see liric_state.html#Liric_State_Filter_Wheel_Set
  * @see #Bias_Dark_Data
  * @see #Bias_Dark_Fits_Headers_Set
  * @see #Bias_Dark_Exposure_Fits_Headers_Set
- * @see liric_config.html#Liric_Config_Get_Boolean
+ * @see liric_config.html#Liric_Config_Cache_Get
  * @see liric_config.html#Liric_Config_Filter_Wheel_Is_Enabled
  * @see liric_general.html#LIRIC_GENERAL_IS_BOOLEAN
  * @see liric_general.html#Liric_General_Error_Number
@@ -377,13 +435,22 @@ int Liric_Bias_Dark_MultBias(int exposure_count,char ***filename_list,int *filen
  * @see ../detector/cdocs/detector_fits_filename.html#Detector_Fits_Filename_Next_Run
  * @see ../detector/cdocs/detector_fits_filename.html#Detector_Fits_Filename_Get_Filename
  * @see ../detector/cdocs/detector_fits_filename.html#Detector_Fits_Filename_List_Add
+ * @see liric_job.html#Liric_Job_Frame_Saved
+ * @see liric_shm.html#Liric_Shm_Frame_Publish
+ * @see ../detector/cdocs/detector_latency.html#Detector_Latency_Timestamp
+ * @see ../detector/cdocs/detector_latency.html#Detector_Latency_Stage_Record
+ * @see ../detector/cdocs/detector_latency.html#Detector_Latency_Exposure_Reset
+ * @see ../detector/cdocs/detector_trace.html#Detector_Trace_Span_Start
+ * @see ../detector/cdocs/detector_trace.html#Detector_Trace_Span_End
  * @see ../filter_wheel/cdocs/filter_wheel_config.html#Filter_Wheel_Config_Name_To_Position
  * @see ../filter_wheel/cdocs/filter_wheel_command.html#ilter_Wheel_Command_Move
  */
 int Liric_Bias_Dark_MultDark(int exposure_length_ms,int exposure_count,char ***filename_list,int *filename_count)
 {
 	char fits_filename[256];
-	int flip_x,flip_y,mirror_filter_wheel_position;
+	struct timespec latency_time,trace_time;
+	struct Liric_Config_Cache_Struct config_cache;
+	int mirror_filter_wheel_position,retval;
 	
 	/* check arguments */
 	if(exposure_length_ms < 1)
@@ -418,31 +485,36 @@ int Liric_Bias_Dark_MultDark(int exposure_length_ms,int exposure_count,char ***f
 				  exposure_length_ms,exposure_count);
 #endif
 	/* initialise internal variables */
-	Bias_Dark_In_Progress = TRUE;
-	Moptop_Abort = FALSE;
 	Bias_Dark_Data.Image_Count = exposure_count;
+	Bias_Dark_Data.Image_Index = 0;
+	Bias_Dark_State_Set(TRUE);
+	Moptop_Abort = FALSE;
 	(*filename_list) = NULL;
 	(*filename_count) = 0;
 	/* configure flipping of output image */
-	if(!Liric_Config_Get_Boolean("liric.multrun.image.flip.x",&flip_x))
-		return FALSE;		
-	if(!Liric_Config_Get_Boolean("liric.multrun.image.flip.y",&flip_y))
-		return FALSE;
-	Detector_Exposure_Flip_Set(flip_x,flip_y);
+	Liric_Config_Cache_Get(&config_cache);
+	Detector_Exposure_Flip_Set(config_cache.Multrun_Image_Flip_X,config_cache.Multrun_Image_Flip_Y);
 	/* move filter wheel to mirror position */
 	if(Liric_Config_Filter_Wheel_Is_Enabled())
 	{
 		/* which filter position contains the Mirror filter */
 		if(!Filter_Wheel_Config_Name_To_Position("Mirror",&mirror_filter_wheel_position))
 		{
+			Bias_Dark_State_Set(FALSE);
 			Liric_General_Error_Number = 722;
 			sprintf(Liric_General_Error_String,
 				"Liric_Bias_Dark_MultDark:Failed to find Mirror filter wheel position.");
 			return FALSE;
 		}
 		/* move filter wheel */
-		if(!Filter_Wheel_Command_Move(mirror_filter_wheel_position))
+		Detector_Trace_Span_Start(&trace_time);
+		Liric_State_Filter_Wheel_Set(TRUE,0);
+		retval = Filter_Wheel_Command_Move(mirror_filter_wheel_position);
+		Liric_State_Filter_Wheel_Set(retval,retval ? mirror_filter_wheel_position : 0);
+		Detector_Trace_Span_End("mechanism","filter_wheel_move","Mirror",&trace_time);
+		if(!retval)
 		{
+			Bias_Dark_State_Set(FALSE);
 			Liric_General_Error_Number = 723;
 			sprintf(Liric_General_Error_String,
 				"Liric_Bias_Dark_MultDark:Failed to move filter wheel to  Mirror position %d.",
@@ -453,7 +525,7 @@ int Liric_Bias_Dark_MultDark(int exposure_length_ms,int exposure_count,char ***f
 	/* intialise FITS filenames for new multrun*/
 	if(!Detector_Fits_Filename_Next_Multrun())
 	{
-		Bias_Dark_In_Progress = FALSE;
+		Bias_Dark_State_Set(FALSE);
 		Liric_General_Error_Number = 704;
 		sprintf(Liric_General_Error_String,"Liric_Bias_Dark_MultDark:Failed to initialise FITS filename multrun.");
 		return FALSE;
@@ -461,11 +533,13 @@ int Liric_Bias_Dark_MultDark(int exposure_length_ms,int exposure_count,char ***f
 	/* do any per-multdark FITS header changes here */
 	if(!Bias_Dark_Fits_Headers_Set(FALSE,exposure_count))
 	{
-		Bias_Dark_In_Progress = FALSE;
+		Bias_Dark_State_Set(FALSE);
 		return FALSE;
 	}
 	/* take a multrun start timestamp */
 	clock_gettime(CLOCK_REALTIME,&(Bias_Dark_Data.Bias_Dark_Start_Time));
+	/* discard any per-exposure stage latencies left over from a previously failed exposure */
+	Detector_Latency_Exposure_Reset();
 	/* start multdark for loop */
 	for(Bias_Dark_Data.Image_Index = 0; Bias_Dark_Data.Image_Index < Bias_Dark_Data.Image_Count;
 	    Bias_Dark_Data.Image_Index++)
@@ -473,15 +547,17 @@ int Liric_Bias_Dark_MultDark(int exposure_length_ms,int exposure_count,char ***f
 		/* check for aborts */
 		if(Moptop_Abort)
 		{
-			Bias_Dark_In_Progress = FALSE;
+			Bias_Dark_State_Set(FALSE);
 			Liric_General_Error_Number = 705;
 			sprintf(Liric_General_Error_String,"Liric_Bias_Dark_MultDark:Aborted.");
 			return FALSE;
 		}
+		/* publish which frame we are taking */
+		Bias_Dark_State_Set(TRUE);
 		/* generate new FITS image filename */
 		if(!Detector_Fits_Filename_Next_Run())
 		{
-			Bias_Dark_In_Progress = FALSE;
+			Bias_Dark_State_Set(FALSE);
 			Liric_General_Error_Number = 706;
 			sprintf(Liric_General_Error_String,
 				"Liric_Bias_Dark_MultDark:Failed to generate next FITS filename run number.");
@@ -491,7 +567,7 @@ int Liric_Bias_Dark_MultDark(int exposure_length_ms,int exposure_count,char ***f
 							DETECTOR_FITS_FILENAME_PIPELINE_FLAG_UNREDUCED,
 							fits_filename,256))
 		{
-			Bias_Dark_In_Progress = FALSE;
+			Bias_Dark_State_Set(FALSE);
 			Liric_General_Error_Number = 707;
 			sprintf(Liric_General_Error_String,"Liric_Bias_Dark_MultDark:Failed to generate next FITS filename.");
 			return FALSE;
@@ -499,21 +575,27 @@ int Liric_Bias_Dark_MultDark(int exposure_length_ms,int exposure_count,char ***f
 		/* check for aborts */
 		if(Moptop_Abort)
 		{
-			Bias_Dark_In_Progress = FALSE;
+			Bias_Dark_State_Set(FALSE);
 			Liric_General_Error_Number = 708;
 			sprintf(Liric_General_Error_String,"Liric_Bias_Dark_MultDark:Aborted.");
 			return FALSE;
 		}
 		/* do any per-multdark frame FITS header changes here */
+		Detector_Latency_Timestamp(&latency_time);
 		if(!Bias_Dark_Exposure_Fits_Headers_Set())
 		{
-			Bias_Dark_In_Progress = FALSE;
+			Bias_Dark_State_Set(FALSE);
 			return FALSE;
 		}
+		Detector_Latency_Stage_Record(DETECTOR_LATENCY_STAGE_HEADER_SET,&latency_time);
 		/* take an exposure */
-		if(!Detector_Exposure_Expose(exposure_length_ms,fits_filename))
+		Detector_Trace_Span_Start(&trace_time);
+		retval = Detector_Exposure_Expose(exposure_length_ms,fits_filename);
+		Liric_State_Exposure_Update(FALSE);
+		Detector_Trace_Span_End("exposure","dark",NULL,&trace_time);
+		if(!retval)
 		{
-			Bias_Dark_In_Progress = FALSE;
+			Bias_Dark_State_Set(FALSE);
 			Liric_General_Error_Number = 709;
 			sprintf(Liric_General_Error_String,
 				"Liric_Bias_Dark_MultDark:Failed to take exposure %d of %d ms with filename '%s'.",
@@ -523,16 +605,24 @@ int Liric_Bias_Dark_MultDark(int exposure_length_ms,int exposure_count,char ***f
 		/* add fits image to list */
 		if(!Detector_Fits_Filename_List_Add(fits_filename,filename_list,filename_count))
 		{
-			Bias_Dark_In_Progress = FALSE;
+			Bias_Dark_State_Set(FALSE);
 			Liric_General_Error_Number = 724;
 			sprintf(Liric_General_Error_String,
 				"Liric_Bias_Dark_MultDark:Failed to add filename '%s' to list of length %d.",
 				fits_filename,(*filename_count));
 			return FALSE;
 		}
+		/* publish the frame to local shared memory readers (if enabled), this does not stop the multdark */
+		if(!Liric_Shm_Frame_Publish(fits_filename))
+		{
+			Liric_General_Error("multdark","liric_bias_dark.c","Liric_Bias_Dark_MultDark",LOG_VERBOSITY_TERSE,
+					    "MULTDARK");
+		}
+		/* record the frame in the job (if any) and wake any clients waiting for it */
+		Liric_Job_Frame_Saved(fits_filename);
 	}/* end for on Bias_Dark_Data.Image_Index */
 	/* we have finished the multdark */
-	Bias_Dark_In_Progress = FALSE;
+	Bias_Dark_State_Set(FALSE);
 #if LIRIC_DEBUG > 1
 	Liric_General_Log("multdark","liric_bias_dark.c","Liric_Bias_Dark_MultDark",LOG_VERBOSITY_TERSE,"MULTDARK",
 			   "Finished.");
@@ -582,6 +672,20 @@ int Liric_Bias_Dark_Exposure_Index_Get(void)
 	return Bias_Dark_Data.Image_Index;
 }
 
+/**
+ * Set whether a multbias/multdark is in progress, and publish it's frame count and the index of the frame
+ * being taken, so status commands can read them without calling into this module.
+ * @param in_progress A boolean, TRUE if a multbias/multdark is in progress.
+ * @see #Bias_Dark_In_Progress
+ * @see #Bias_Dark_Data
+ * @see liric_state.html#Liric_State_Sequence_Set
+ */
+static void Bias_Dark_State_Set(int in_progress)
+{
+	Bias_Dark_In_Progress = in_progress;
+	Liric_State_Sequence_Set(in_progress,Bias_Dark_Data.Image_Count,Bias_Dark_Data.Image_Index);
+}
+
 /**
  * Routine to collect and insert FITS headers pertaining to the whole bias/dark multrun.
  * @param is_bias A boolean, set to TRUE for biases and FALSE for darks. Used to set the OBSTYPE FITS header.
@@ -18,6 +18,7 @@
 #include <errno.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 /**
  * Add more fields to struct tm (tm_tm_zone).
@@ -28,11 +29,16 @@
 
 #include "log_udp.h"
 
+#include "detector_buffer.h"
 #include "detector_exposure.h"
 #include "detector_fits_filename.h"
 #include "detector_fits_header.h"
 #include "detector_general.h"
+#include "detector_latency.h"
+#include "detector_trace.h"
+#include "detector_serial.h"
 #include "detector_setup.h"
+#include "detector_telemetry.h"
 #include "detector_temperature.h"
 
 #include "command_server.h"
@@ -47,9 +53,11 @@
 #include "liric_command.h"
 #include "liric_config.h"
 #include "liric_fits_header.h"
+#include "liric_job.h"
 #include "liric_multrun.h"
 #include "liric_general.h"
 #include "liric_server.h"
+#include "liric_state.h"
 
 /* hash defines */
 /**
@@ -60,6 +68,22 @@
  * Timezone offset for BST.
  */
 #define TIMEZONE_OFFSET_BST  (TIMEZONE_OFFSET_HOUR)
+/**
+ * The default number of points returned by "status telemetry history &lt;hours&gt;".
+ */
+#define TELEMETRY_HISTORY_DEFAULT_POINT_COUNT (60)
+/**
+ * The maximum length of one point in the "status telemetry history" reply.
+ */
+#define TELEMETRY_HISTORY_POINT_STRING_LENGTH (96)
+/**
+ * The length of the reply buffer used to build the "status all" snapshot.
+ */
+#define STATUS_ALL_STRING_LENGTH (1024)
+/**
+ * The maximum number of frames returned by one "job frames" command.
+ */
+#define JOB_FRAME_LIST_LENGTH (16)
 
 /* internal data */
 /**
@@ -69,6 +93,12 @@ static char rcsid[] = "$Id$";
 
 /* internal functions */
 static int Command_Parse_Date(char *time_string,int *time_secs);
+static int Command_Telemetry_Sample_Get(int valid_bit,struct Detector_Telemetry_Sample_Struct *sample);
+static int Command_Status_All(struct Liric_General_String_Builder_Struct *reply_string);
+static int Command_State_Filter_Wheel_Get(struct Liric_State_Struct *state,int *position);
+static int Command_State_Nudgematic_Get(struct Liric_State_Struct *state,int *position);
+static void Command_Status_All_Time_Add(char *status_string,char *key_string,struct timespec timestamp);
+static void Command_Time_String_Get(struct timespec timestamp,char *time_string,int string_length);
 
 /* ----------------------------------------------------------------------------
 ** 		external functions 
@@ -82,17 +112,17 @@ static int Command_Parse_Date(char *time_string,int *time_secs);
  * <li>We set the reply_string to a successful message.
  * </ul>
  * @param command_string The command. This is not changed during this routine.
- * @param reply_string The address of a pointer to allocate and set the reply string.
+ * @param reply_string The string builder to build the reply string in.
  * @return The routine returns TRUE on success and FALSE on failure.
  * @see liric_general.html#Liric_General_Log
  * @see liric_general.html#Liric_General_Error_Number
  * @see liric_general.html#Liric_General_Error_String
- * @see liric_general.html#Liric_General_Add_String
+ * @see liric_general.html#Liric_General_String_Builder_Add
  * @see liric_multrun.html#Liric_Multrun_Abort
  * @see liric_bias_dark.html#Liric_Bias_Dark_Abort
  * @see ../detector/cdocs/detector_exposure.html#Detector_Exposure_Abort
  */
-int Liric_Command_Abort(char *command_string,char **reply_string)
+int Liric_Command_Abort(char *command_string,struct Liric_General_String_Builder_Struct *reply_string)
 {
 #if LIRIC_DEBUG > 1
 	Liric_General_Log("command","liric_command.c","Liric_Command_Abort",LOG_VERBOSITY_TERSE,
@@ -116,7 +146,7 @@ int Liric_Command_Abort(char *command_string,char **reply_string)
 #endif
 	Detector_Exposure_Abort();
 	/* return success */
-	if(!Liric_General_Add_String(reply_string,"0 Multrun/Bias/Dark aborted."))
+	if(!Liric_General_String_Builder_Add(reply_string,"0 Multrun/Bias/Dark aborted."))
 		return FALSE;
 #if LIRIC_DEBUG > 1
 	Liric_General_Log("command","liric_command.c","Liric_Command_Abort",LOG_VERBOSITY_TERSE,
@@ -131,27 +161,36 @@ int Liric_Command_Abort(char *command_string,char **reply_string)
  * <li>"config coadd_exp_len <short|long>"
  * <li>"config filter <filtername>"
  * <li>"config nudgematic <none|small|large>"
+ * <li>"config reload" reloads the config file (Liric_Config_Reload), replying with the new config generation.
  * </ul>
  * @param command_string The command. This is not changed during this routine.
- * @param reply_string The address of a pointer to allocate and set the reply string.
+ * @param reply_string The string builder to build the reply string in.
  * @return The routine returns TRUE on success and FALSE on failure.
  * @see #Liric_Command_Initialise_Detector
+ * @see liric_config.html#Liric_Config_Reload
+ * @see liric_config.html#Liric_Config_Cache_Get
  * @see liric_config.html#Liric_Config_Nudgematic_Is_Enabled
  * @see liric_config.html#Liric_Config_Filter_Wheel_Is_Enabled
  * @see liric_general.html#Liric_General_Log
  * @see liric_general.html#Liric_General_Error_Number
  * @see liric_general.html#Liric_General_Error_String
- * @see liric_general.html#Liric_General_Add_String
- * @see liric_general.html#Liric_General_Add_Integer_To_String
+ * @see liric_general.html#Liric_General_String_Builder_Add
+ * @see liric_general.html#Liric_General_String_Builder_Add_Integer
+ * @see liric_general.html#Liric_General_String_Builder_Add_Format
  * @see ../filter_wheel/cdocs/filter_wheel_config.html#Filter_Wheel_Config_Name_To_Position
  * @see ../filter_wheel/cdocs/filter_wheel_command.html#Filter_Wheel_Command_Move
+ * @see liric_state.html#Liric_State_Filter_Wheel_Set
  * @see ../nudgematic/cdocs/nudgematic_command.html#NUDGEMATIC_OFFSET_SIZE_T
  * @see ../nudgematic/cdocs/nudgematic_command.html#Nudgematic_Command_Offset_Size_Set
  * @see ../nudgematic/cdocs/nudgematic_command.html#Nudgematic_Command_Offset_Size_To_String
+ * @see ../detector/cdocs/detector_trace.html#Detector_Trace_Span_Start
+ * @see ../detector/cdocs/detector_trace.html#Detector_Trace_Span_End
  */
-int Liric_Command_Config(char *command_string,char **reply_string)
+int Liric_Command_Config(char *command_string,struct Liric_General_String_Builder_Struct *reply_string)
 {
 	NUDGEMATIC_OFFSET_SIZE_T offset_size;
+	struct Liric_Config_Cache_Struct config_cache;
+	struct timespec trace_time;
 	int retval,bin,parameter_index,filter_position;
 	double camera_exposure_length;
 	char filter_string[32];
@@ -177,7 +216,7 @@ int Liric_Command_Config(char *command_string,char **reply_string)
 		Liric_General_Log("command","liric_command.c","Liric_Command_Config",
 				       LOG_VERBOSITY_TERSE,"COMMAND","finished (command parse failed).");
 #endif
-		if(!Liric_General_Add_String(reply_string,"1 Failed to parse config command."))
+		if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to parse config command."))
 			return FALSE;
 		return TRUE;
 	}
@@ -200,7 +239,7 @@ int Liric_Command_Config(char *command_string,char **reply_string)
 			Liric_General_Log("command","liric_command.c","Liric_Command_Config",
 					   LOG_VERBOSITY_TERSE,"COMMAND","finished (command parse failed).");
 #endif
-			if(!Liric_General_Add_String(reply_string,"1 Failed to parse config coadd_exp_len command."))
+			if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to parse config coadd_exp_len command."))
 				return FALSE;
 			return TRUE;
 		}
@@ -220,16 +259,16 @@ int Liric_Command_Config(char *command_string,char **reply_string)
 						  "Failed to initialise detector with coadd exposure length: '%s'.",
 						  coadd_exposure_length_string);
 #endif
-			if(!Liric_General_Add_String(reply_string,
+			if(!Liric_General_String_Builder_Add(reply_string,
 						      "1 Failed to initialise detector with coadd exposure length:"))
 				return FALSE;
-			if(!Liric_General_Add_String(reply_string,coadd_exposure_length_string))
+			if(!Liric_General_String_Builder_Add(reply_string,coadd_exposure_length_string))
 				return FALSE;
 			return TRUE;
 		}
-		if(!Liric_General_Add_String(reply_string,"0 Coadd exposure length set to:"))
+		if(!Liric_General_String_Builder_Add(reply_string,"0 Coadd exposure length set to:"))
 			return FALSE;
-		if(!Liric_General_Add_String(reply_string,coadd_exposure_length_string))
+		if(!Liric_General_String_Builder_Add(reply_string,coadd_exposure_length_string))
 			return FALSE;
 	}
 	else if(strcmp(sub_config_command_string,"filter") == 0)
@@ -256,9 +295,9 @@ int Liric_Command_Config(char *command_string,char **reply_string)
 							  "Failed to convert filter name '%s' to a valid filter position.",
 							  filter_string);
 #endif
-				if(!Liric_General_Add_String(reply_string,"1 Failed to convert filter name:"))
+				if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to convert filter name:"))
 					return FALSE;
-				if(!Liric_General_Add_String(reply_string,filter_string))
+				if(!Liric_General_String_Builder_Add(reply_string,filter_string))
 					return FALSE;
 				return TRUE;
 			}
@@ -267,7 +306,12 @@ int Liric_Command_Config(char *command_string,char **reply_string)
 					  LOG_VERBOSITY_VERY_VERBOSE,"COMMAND","Filter position: %d.",filter_position);
 #endif
 			/* actually move filter wheel */
-			if(!Filter_Wheel_Command_Move(filter_position))
+			Detector_Trace_Span_Start(&trace_time);
+			Liric_State_Filter_Wheel_Set(TRUE,0);
+			retval = Filter_Wheel_Command_Move(filter_position);
+			Liric_State_Filter_Wheel_Set(retval,retval ? filter_position : 0);
+			Detector_Trace_Span_End("mechanism","filter_wheel_move",filter_string,&trace_time);
+			if(!retval)
 			{
 				Liric_General_Error_Number = 504;
 				sprintf(Liric_General_Error_String,"Liric_Command_Config:"
@@ -281,22 +325,22 @@ int Liric_Command_Config(char *command_string,char **reply_string)
 							  "Failed to move filter wheel to filter '%s', position %d.",
 							  filter_string,filter_position);
 #endif
-				if(!Liric_General_Add_String(reply_string,"1 Failed to move filter wheel to filter:"))
+				if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to move filter wheel to filter:"))
 					return FALSE;
-				if(!Liric_General_Add_String(reply_string,filter_string))
+				if(!Liric_General_String_Builder_Add(reply_string,filter_string))
 					return FALSE;
 				return TRUE;
 			}
 			/* success */
-			if(!Liric_General_Add_String(reply_string,"0 Filter wheel moved to position:"))
+			if(!Liric_General_String_Builder_Add(reply_string,"0 Filter wheel moved to position:"))
 				return FALSE;
-			if(!Liric_General_Add_String(reply_string,filter_string))
+			if(!Liric_General_String_Builder_Add(reply_string,filter_string))
 				return FALSE;
 		}
 		else /* filter wheel is not enabled */
 		{
 			/* success */
-			if(!Liric_General_Add_String(reply_string,"0 Filter Wheel not enabled."))
+			if(!Liric_General_String_Builder_Add(reply_string,"0 Filter Wheel not enabled."))
 				return FALSE;
 		}
 	}
@@ -314,7 +358,7 @@ int Liric_Command_Config(char *command_string,char **reply_string)
 			Liric_General_Log("command","liric_command.c","Liric_Command_Config",
 					   LOG_VERBOSITY_TERSE,"COMMAND","finished (command parse failed).");
 #endif
-			if(!Liric_General_Add_String(reply_string,"1 Failed to parse config nudgematic command."))
+			if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to parse config nudgematic command."))
 				return FALSE;
 			return TRUE;
 		}
@@ -348,16 +392,20 @@ int Liric_Command_Config(char *command_string,char **reply_string)
 						  "finished (Unknown nudgematic offset size %s).",
 						  nudgematic_offset_size_string);
 #endif
-			if(!Liric_General_Add_String(reply_string,"1 Failed to parse config nudgematic command:"))
+			if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to parse config nudgematic command:"))
 				return FALSE;
-			if(!Liric_General_Add_String(reply_string,command_string))
+			if(!Liric_General_String_Builder_Add(reply_string,command_string))
 				return FALSE;
 			return TRUE;
 		}
 		/* actually configure offset size, if nudgematic is enabled */
 		if(Liric_Config_Nudgematic_Is_Enabled())
 		{
-			if(!Nudgematic_Command_Offset_Size_Set(offset_size))
+			Detector_Trace_Span_Start(&trace_time);
+			retval = Nudgematic_Command_Offset_Size_Set(offset_size);
+			Detector_Trace_Span_End("mechanism","nudgematic_offset_size",
+						Nudgematic_Command_Offset_Size_To_String(offset_size),&trace_time);
+			if(!retval)
 			{
 				Liric_General_Error_Number = 508;
 				sprintf(Liric_General_Error_String,"Liric_Command_Config:Failed to configure offset size %s.",
@@ -370,22 +418,37 @@ int Liric_Command_Config(char *command_string,char **reply_string)
 							  "finished Failed to configure offset size %s.",
 							  Nudgematic_Command_Offset_Size_To_String(offset_size));
 #endif
-				if(!Liric_General_Add_String(reply_string,"1 Failed to parse config nudgematic command:"))
+				if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to parse config nudgematic command:"))
 					return FALSE;
-				if(!Liric_General_Add_String(reply_string,command_string))
+				if(!Liric_General_String_Builder_Add(reply_string,command_string))
 					return FALSE;
 				return TRUE;
 			}
 			/* cache the nudgematic offset size setting in the multrun data for FITS header generation */
 		}/* end if nudgematic is enabled */
-		if(!Liric_General_Add_String(reply_string,"0 Config nudgematic completed."))
+		if(!Liric_General_String_Builder_Add(reply_string,"0 Config nudgematic completed."))
+			return FALSE;
+	}
+	else if(strcmp(sub_config_command_string,"reload") == 0)
+	{
+		if(!Liric_Config_Reload())
+		{
+			Liric_General_Error("command","liric_command.c","Liric_Command_Config",
+					     LOG_VERBOSITY_TERSE,"COMMAND");
+			if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to reload config."))
+				return FALSE;
+			return TRUE;
+		}
+		Liric_Config_Cache_Get(&config_cache);
+		if(!Liric_General_String_Builder_Add_Format(reply_string,"0 Config reloaded: generation %d.",
+							    config_cache.Generation))
 			return FALSE;
 	}
 	else
 	{
-		if(!Liric_General_Add_String(reply_string,"1 Unknown config sub-command:"))
+		if(!Liric_General_String_Builder_Add(reply_string,"1 Unknown config sub-command:"))
 			return FALSE;
-		if(!Liric_General_Add_String(reply_string,sub_config_command_string))
+		if(!Liric_General_String_Builder_Add(reply_string,sub_config_command_string))
 			return FALSE;
 	}
 #if LIRIC_DEBUG > 1
@@ -398,16 +461,16 @@ int Liric_Command_Config(char *command_string,char **reply_string)
 /**
  * Command to turn the camera head fan on or off: "fan <on|off>".
  * @param command_string The command. This is not changed during this routine.
- * @param reply_string The address of a pointer to allocate and set the reply string.
+ * @param reply_string The string builder to build the reply string in.
  * @return The routine returns TRUE on success and FALSE on failure.
  * @see liric_general.html#Liric_General_Log
  * @see liric_general.html#Liric_General_Error_Number
  * @see liric_general.html#Liric_General_Error_String
- * @see liric_general.html#Liric_General_Add_String
- * @see liric_general.html#Liric_General_Add_Integer_To_String
+ * @see liric_general.html#Liric_General_String_Builder_Add
+ * @see liric_general.html#Liric_General_String_Builder_Add_Integer
  * @see ../detector/cdocs/detector_temperature.html#Detector_Temperature_Set_Fan
  */
-int Liric_Command_Fan(char *command_string,char **reply_string)
+int Liric_Command_Fan(char *command_string,struct Liric_General_String_Builder_Struct *reply_string)
 {
 	int retval,onoff,parameter_index;
 	char onoff_string[16];
@@ -429,7 +492,7 @@ int Liric_Command_Fan(char *command_string,char **reply_string)
 		Liric_General_Log("command","liric_command.c","Liric_Command_Fan",
 				       LOG_VERBOSITY_TERSE,"COMMAND","finished (command parse failed).");
 #endif
-		if(!Liric_General_Add_String(reply_string,"1 Failed to parse fan command."))
+		if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to parse fan command."))
 			return FALSE;
 		return TRUE;
 	}
@@ -455,7 +518,7 @@ int Liric_Command_Fan(char *command_string,char **reply_string)
 					  "COMMAND","Unknown fan state %s:Failed to parse command %s.",
 					  onoff_string,command_string);
 #endif
-		if(!Liric_General_Add_String(reply_string,"1 Failed to parse fan command: Unknown fan state."))
+		if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to parse fan command: Unknown fan state."))
 			return FALSE;
 		return TRUE;
 	}
@@ -471,7 +534,7 @@ int Liric_Command_Fan(char *command_string,char **reply_string)
 		Liric_General_Log("command","liric_command.c","Liric_Command_Fan",
 				   LOG_VERBOSITY_TERSE,"COMMAND","Failed to set fan state.");
 #endif
-		if(!Liric_General_Add_String(reply_string,"1 Failed to set fan state."))
+		if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to set fan state."))
 			return FALSE;
 		return TRUE;
 	}
@@ -485,12 +548,12 @@ int Liric_Command_Fan(char *command_string,char **reply_string)
 /**
  * Implementation of FITS Header commands.
  * @param command_string The command. This is not changed during this routine.
- * @param reply_string The address of a pointer to allocate and set the reply string.
+ * @param reply_string The string builder to build the reply string in.
  * @return The routine returns TRUE on success and FALSE on failure.
  * @see liric_general.html#Liric_General_Log
  * @see liric_general.html#Liric_General_Error_Number
  * @see liric_general.html#Liric_General_Error_String
- * @see liric_general.html#Liric_General_Add_String
+ * @see liric_general.html#Liric_General_String_Builder_Add
  * @see liric_fits_header.html#Liric_Fits_Header_Logical_Add
  * @see liric_fits_header.html#Liric_Fits_Header_Float_Add
  * @see liric_fits_header.html#Liric_Fits_Header_Integer_Add
@@ -498,7 +561,7 @@ int Liric_Command_Fan(char *command_string,char **reply_string)
  * @see liric_fits_header.html#Liric_Fits_Header_Clear
  * @see liric_fits_header.html#Liric_Fits_Header_Delete
  */
-int Liric_Command_Fits_Header(char *command_string,char **reply_string)
+int Liric_Command_Fits_Header(char *command_string,struct Liric_General_String_Builder_Struct *reply_string)
 {
 	char operation_string[8];
 	char keyword_string[13];
@@ -518,7 +581,7 @@ int Liric_Command_Fits_Header(char *command_string,char **reply_string)
 		Liric_General_Log("command","liric_command.c","Liric_Command_Fits_Header",
 				       LOG_VERBOSITY_TERSE,"COMMAND","finished (command parse failed).");
 #endif
-		if(!Liric_General_Add_String(reply_string,"1 Failed to parse fitsheader command."))
+		if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to parse fitsheader command."))
 			return FALSE;
 		return TRUE;
 	}
@@ -538,7 +601,7 @@ int Liric_Command_Fits_Header(char *command_string,char **reply_string)
 			Liric_General_Log("command","liric_command.c","Liric_Command_Fits_Header",
 					   LOG_VERBOSITY_TERSE,"COMMAND","finished (add command parse failed).");
 #endif
-			if(!Liric_General_Add_String(reply_string,"1 Failed to parse fitsheader add command."))
+			if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to parse fitsheader add command."))
 				return FALSE;
 			return TRUE;
 		}
@@ -563,7 +626,7 @@ int Liric_Command_Fits_Header(char *command_string,char **reply_string)
 							  LOG_VERBOSITY_TERSE,"COMMAND",
 							  "Add boolean command had unknown value %s.",value_string);
 #endif
-				if(!Liric_General_Add_String(reply_string,
+				if(!Liric_General_String_Builder_Add(reply_string,
 							   "1 Failed to parse fitsheader add boolean command value."))
 					return FALSE;
 				return TRUE;
@@ -578,7 +641,7 @@ int Liric_Command_Fits_Header(char *command_string,char **reply_string)
 							  LOG_VERBOSITY_TERSE,"COMMAND",
 							  "Failed to add boolean to FITS header.");
 #endif
-				if(!Liric_General_Add_String(reply_string,"1 Failed to add boolean fits header."))
+				if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to add boolean fits header."))
 					return FALSE;
 				return TRUE;
 			}
@@ -595,7 +658,7 @@ int Liric_Command_Fits_Header(char *command_string,char **reply_string)
 							  LOG_VERBOSITY_TERSE,"COMMAND",
 							  "Failed to add comment to FITS header.");
 #endif
-				if(!Liric_General_Add_String(reply_string,"1 Failed to add comment to fits header."))
+				if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to add comment to fits header."))
 					return FALSE;
 				return TRUE;
 			}
@@ -616,7 +679,7 @@ int Liric_Command_Fits_Header(char *command_string,char **reply_string)
 							  LOG_VERBOSITY_TERSE,"COMMAND",
 							  "Add float command had unknown value %s.",value_string);
 #endif
-				if(!Liric_General_Add_String(reply_string,
+				if(!Liric_General_String_Builder_Add(reply_string,
 							   "1 Failed to parse fitsheader add float command value."))
 					return FALSE;
 				return TRUE;
@@ -631,7 +694,7 @@ int Liric_Command_Fits_Header(char *command_string,char **reply_string)
 							  LOG_VERBOSITY_TERSE,"COMMAND",
 							  "Failed to add float to FITS header.");
 #endif
-				if(!Liric_General_Add_String(reply_string,"1 Failed to add float fits header."))
+				if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to add float fits header."))
 					return FALSE;
 				return TRUE;
 			}
@@ -652,7 +715,7 @@ int Liric_Command_Fits_Header(char *command_string,char **reply_string)
 							  LOG_VERBOSITY_TERSE,"COMMAND",
 							  "Add integer command had unknown value %s.",value_string);
 #endif
-				if(!Liric_General_Add_String(reply_string,
+				if(!Liric_General_String_Builder_Add(reply_string,
 							   "1 Failed to parse fitsheader add integer command value."))
 					return FALSE;
 				return TRUE;
@@ -667,7 +730,7 @@ int Liric_Command_Fits_Header(char *command_string,char **reply_string)
 							  LOG_VERBOSITY_TERSE,"COMMAND",
 							  "Failed to add integer to FITS header.");
 #endif
-				if(!Liric_General_Add_String(reply_string,"1 Failed to add integer fits header."))
+				if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to add integer fits header."))
 					return FALSE;
 				return TRUE;
 			}
@@ -684,7 +747,7 @@ int Liric_Command_Fits_Header(char *command_string,char **reply_string)
 							  LOG_VERBOSITY_TERSE,"COMMAND",
 							  "Failed to add string to FITS header.");
 #endif
-				if(!Liric_General_Add_String(reply_string,"1 Failed to add string fits header."))
+				if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to add string fits header."))
 					return FALSE;
 				return TRUE;
 			}
@@ -701,7 +764,7 @@ int Liric_Command_Fits_Header(char *command_string,char **reply_string)
 							  LOG_VERBOSITY_TERSE,"COMMAND",
 							  "Failed to add units to FITS header.");
 #endif
-				if(!Liric_General_Add_String(reply_string,"1 Failed to add units to fits header."))
+				if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to add units to fits header."))
 					return FALSE;
 				return TRUE;
 			}
@@ -717,7 +780,7 @@ int Liric_Command_Fits_Header(char *command_string,char **reply_string)
 			Liric_General_Log_Format("command","liric_command.c","Liric_Command_Fits_Header",
 				       LOG_VERBOSITY_TERSE,"COMMAND","Add command had unknown type %s.",type_string);
 #endif
-			if(!Liric_General_Add_String(reply_string,"1 Failed to parse fitsheader add command type."))
+			if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to parse fitsheader add command type."))
 				return FALSE;
 			return TRUE;
 		}
@@ -736,7 +799,7 @@ int Liric_Command_Fits_Header(char *command_string,char **reply_string)
 			Liric_General_Log("command","liric_command.c","Liric_Command_Fits_Header",
 					   LOG_VERBOSITY_TERSE,"COMMAND","finished (delete command parse failed).");
 #endif
-			if(!Liric_General_Add_String(reply_string,"1 Failed to parse fitsheader delete command."))
+			if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to parse fitsheader delete command."))
 				return FALSE;
 			return TRUE;
 		}
@@ -750,7 +813,7 @@ int Liric_Command_Fits_Header(char *command_string,char **reply_string)
 						  LOG_VERBOSITY_TERSE,"COMMAND",
 						  "Failed to delete FITS header with keyword '%s'.",keyword_string);
 #endif
-			if(!Liric_General_Add_String(reply_string,"1 Failed to delete fits header."))
+			if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to delete fits header."))
 				return FALSE;
 			return TRUE;
 		}
@@ -766,7 +829,7 @@ int Liric_Command_Fits_Header(char *command_string,char **reply_string)
 			Liric_General_Log("command","liric_command.c","Liric_Command_Fits_Header",
 					   LOG_VERBOSITY_TERSE,"COMMAND","Failed to clear FITS header.");
 #endif
-			if(!Liric_General_Add_String(reply_string,"1 Failed to clear fits header."))
+			if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to clear fits header."))
 				return FALSE;
 			return TRUE;
 		}
@@ -784,11 +847,11 @@ int Liric_Command_Fits_Header(char *command_string,char **reply_string)
 					  "COMMAND","Unknown operation %s:Failed to parse command %s.",
 					  operation_string,command_string);
 #endif
-		if(!Liric_General_Add_String(reply_string,"1 Failed to parse fitsheader command: Unknown operation."))
+		if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to parse fitsheader command: Unknown operation."))
 			return FALSE;
 		return TRUE;
 	}
-	if(!Liric_General_Add_String(reply_string,"0 FITS Header command succeeded."))
+	if(!Liric_General_String_Builder_Add(reply_string,"0 FITS Header command succeeded."))
 		return FALSE;
 #if LIRIC_DEBUG > 1
 	Liric_General_Log("command","liric_command.c","Liric_Command_Fits_Header",LOG_VERBOSITY_TERSE,
@@ -797,29 +860,265 @@ int Liric_Command_Fits_Header(char *command_string,char **reply_string)
 	return TRUE;
 }
 
+/**
+ * Handle job commands, which run a multrun/multbias/multdark asynchronously. The forms are:
+ * <ul>
+ * <li>"job multrun <length> <count> <standard>" - submit a multrun job. The reply is "0 <job id>", returned as soon
+ *     as the job has started.
+ * <li>"job multbias <count>" - submit a multbias job. The reply is "0 <job id>".
+ * <li>"job multdark <length> <count>" - submit a multdark job. The reply is "0 <job id>".
+ * <li>"job status <job id>" - The reply is of the form
+ *     "0 <job id> <type> <state> <frames saved> <frame count> <multrun number>[ <error string>]".
+ * <li>"job frames <job id> <first frame index> [<timeout ms>]" - return the frames saved by the job, starting from
+ *     the specified frame index. If the frame has not been saved yet, and the job is still in progress, wait up to
+ *     timeout_ms (default 0) for it. The reply is of the form "0 <state> <frame count>" followed, for each frame,
+ *     by " <frame index> <FITS filename> <time saved> <frame length ms>". A client can follow a job by repeatedly
+ *     sending this command with the index after the last frame it received, until the job state is finished.
+ * <li>"job abort <job id>" - abort the job.
+ * </ul>
+ * @param command_string The command. This is not changed during this routine.
+ * @param reply_string The string builder to build the reply string in.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #JOB_FRAME_LIST_LENGTH
+ * @see #Command_Time_String_Get
+ * @see liric_general.html#Liric_General_Log
+ * @see liric_general.html#Liric_General_Error_Number
+ * @see liric_general.html#Liric_General_Error_String
+ * @see liric_general.html#Liric_General_String_Builder_Add
+ * @see liric_general.html#Liric_General_String_Builder_Add_Format
+ * @see liric_job.html#LIRIC_JOB_TYPE
+ * @see liric_job.html#LIRIC_JOB_STATE
+ * @see liric_job.html#LIRIC_JOB_FILENAME_LENGTH
+ * @see liric_job.html#Liric_Job_Status_Struct
+ * @see liric_job.html#Liric_Job_Frame_Struct
+ * @see liric_job.html#Liric_Job_Submit
+ * @see liric_job.html#Liric_Job_Status_Get
+ * @see liric_job.html#Liric_Job_Frames_Get
+ * @see liric_job.html#Liric_Job_Abort
+ * @see liric_job.html#Liric_Job_Type_To_String
+ * @see liric_job.html#Liric_Job_State_To_String
+ */
+int Liric_Command_Job(char *command_string,struct Liric_General_String_Builder_Struct *reply_string)
+{
+	struct Liric_Job_Status_Struct status;
+	struct Liric_Job_Frame_Struct frame_list[JOB_FRAME_LIST_LENGTH];
+	enum LIRIC_JOB_STATE state;
+	char return_string[LIRIC_JOB_ERROR_STRING_LENGTH+128];
+	char operation_string[16];
+	char standard_string[8];
+	char time_string[32];
+	int retval,job_id,exposure_length,exposure_count,do_standard,first_frame_index,timeout_ms,frame_count,i;
+
+#if LIRIC_DEBUG > 1
+	Liric_General_Log("command","liric_command.c","Liric_Command_Job",LOG_VERBOSITY_TERSE,
+			   "COMMAND","started.");
+#endif
+	retval = sscanf(command_string,"job %15s",operation_string);
+	if(retval != 1)
+	{
+		Liric_General_Error_Number = 571;
+		sprintf(Liric_General_Error_String,"Liric_Command_Job:Failed to parse command %s (%d).",
+			command_string,retval);
+		Liric_General_Error("command","liric_command.c","Liric_Command_Job",LOG_VERBOSITY_TERSE,"COMMAND");
+		if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to parse job command."))
+			return FALSE;
+		return TRUE;
+	}
+	if((strcmp(operation_string,"multrun") == 0)||(strcmp(operation_string,"multbias") == 0)||
+	   (strcmp(operation_string,"multdark") == 0))
+	{
+		exposure_length = 0;
+		do_standard = FALSE;
+		if(strcmp(operation_string,"multrun") == 0)
+		{
+			retval = sscanf(command_string,"job multrun %d %d %7s",&exposure_length,&exposure_count,
+					standard_string);
+			if(retval == 3)
+			{
+				if(strcmp(standard_string,"true") == 0)
+					do_standard = TRUE;
+				else if(strcmp(standard_string,"false") == 0)
+					do_standard = FALSE;
+				else
+					retval = 0;
+			}
+			retval = (retval == 3);
+		}
+		else if(strcmp(operation_string,"multbias") == 0)
+			retval = (sscanf(command_string,"job multbias %d",&exposure_count) == 1);
+		else
+			retval = (sscanf(command_string,"job multdark %d %d",&exposure_length,&exposure_count) == 2);
+		if(retval == FALSE)
+		{
+			Liric_General_Error_Number = 572;
+			sprintf(Liric_General_Error_String,"Liric_Command_Job:Failed to parse job %s command %s.",
+				operation_string,command_string);
+			Liric_General_Error("command","liric_command.c","Liric_Command_Job",LOG_VERBOSITY_TERSE,
+					    "COMMAND");
+			if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to parse job submit command."))
+				return FALSE;
+			return TRUE;
+		}
+		if(strcmp(operation_string,"multrun") == 0)
+		{
+			retval = Liric_Job_Submit(LIRIC_JOB_TYPE_MULTRUN,exposure_length,exposure_count,do_standard,
+						  &job_id);
+		}
+		else if(strcmp(operation_string,"multbias") == 0)
+			retval = Liric_Job_Submit(LIRIC_JOB_TYPE_MULTBIAS,0,exposure_count,FALSE,&job_id);
+		else
+			retval = Liric_Job_Submit(LIRIC_JOB_TYPE_MULTDARK,exposure_length,exposure_count,FALSE,&job_id);
+		if(retval == FALSE)
+		{
+			Liric_General_Error("command","liric_command.c","Liric_Command_Job",LOG_VERBOSITY_TERSE,
+					    "COMMAND");
+			if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to submit job."))
+				return FALSE;
+			return TRUE;
+		}
+		sprintf(return_string,"0 %d",job_id);
+	}
+	else if(strcmp(operation_string,"status") == 0)
+	{
+		retval = sscanf(command_string,"job status %d",&job_id);
+		if(retval != 1)
+		{
+			Liric_General_Error_Number = 573;
+			sprintf(Liric_General_Error_String,"Liric_Command_Job:Failed to parse job status command %s.",
+				command_string);
+			Liric_General_Error("command","liric_command.c","Liric_Command_Job",LOG_VERBOSITY_TERSE,
+					    "COMMAND");
+			if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to parse job status command."))
+				return FALSE;
+			return TRUE;
+		}
+		if(!Liric_Job_Status_Get(job_id,&status))
+		{
+			Liric_General_Error("command","liric_command.c","Liric_Command_Job",LOG_VERBOSITY_TERSE,
+					    "COMMAND");
+			if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to get job status."))
+				return FALSE;
+			return TRUE;
+		}
+		sprintf(return_string,"0 %d %s %s %d %d %d",status.Id,Liric_Job_Type_To_String(status.Type),
+			Liric_Job_State_To_String(status.State),status.Frame_Count,status.Exposure_Count,
+			status.Multrun_Number);
+		if(strlen(status.Error_String) > 0)
+			sprintf(return_string+strlen(return_string)," %s",status.Error_String);
+	}
+	else if(strcmp(operation_string,"frames") == 0)
+	{
+		timeout_ms = 0;
+		retval = sscanf(command_string,"job frames %d %d %d",&job_id,&first_frame_index,&timeout_ms);
+		if(retval < 2)
+		{
+			Liric_General_Error_Number = 574;
+			sprintf(Liric_General_Error_String,"Liric_Command_Job:Failed to parse job frames command %s.",
+				command_string);
+			Liric_General_Error("command","liric_command.c","Liric_Command_Job",LOG_VERBOSITY_TERSE,
+					    "COMMAND");
+			if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to parse job frames command."))
+				return FALSE;
+			return TRUE;
+		}
+		if(!Liric_Job_Frames_Get(job_id,first_frame_index,timeout_ms,frame_list,JOB_FRAME_LIST_LENGTH,
+					 &frame_count,&state))
+		{
+			Liric_General_Error("command","liric_command.c","Liric_Command_Job",LOG_VERBOSITY_TERSE,
+					    "COMMAND");
+			if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to get job frames."))
+				return FALSE;
+			return TRUE;
+		}
+		sprintf(return_string,"0 %s %d",Liric_Job_State_To_String(state),frame_count);
+		if(!Liric_General_String_Builder_Add(reply_string,return_string))
+			return FALSE;
+		for(i = 0; i < frame_count; i++)
+		{
+			Command_Time_String_Get(frame_list[i].Saved_Time,time_string,31);
+			if(!Liric_General_String_Builder_Add_Format(reply_string," %d %s %s %.3f",frame_list[i].Index,
+								    frame_list[i].Filename,time_string,
+								    frame_list[i].Frame_Length_Ms))
+				return FALSE;
+		}
+#if LIRIC_DEBUG > 1
+		Liric_General_Log("command","liric_command.c","Liric_Command_Job",LOG_VERBOSITY_TERSE,
+				   "COMMAND","finished.");
+#endif
+		return TRUE;
+	}
+	else if(strcmp(operation_string,"abort") == 0)
+	{
+		retval = sscanf(command_string,"job abort %d",&job_id);
+		if(retval != 1)
+		{
+			Liric_General_Error_Number = 575;
+			sprintf(Liric_General_Error_String,"Liric_Command_Job:Failed to parse job abort command %s.",
+				command_string);
+			Liric_General_Error("command","liric_command.c","Liric_Command_Job",LOG_VERBOSITY_TERSE,
+					    "COMMAND");
+			if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to parse job abort command."))
+				return FALSE;
+			return TRUE;
+		}
+		if(!Liric_Job_Abort(job_id))
+		{
+			Liric_General_Error("command","liric_command.c","Liric_Command_Job",LOG_VERBOSITY_TERSE,
+					    "COMMAND");
+			if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to abort job."))
+				return FALSE;
+			return TRUE;
+		}
+		sprintf(return_string,"0 Job %d aborted.",job_id);
+	}
+	else
+	{
+		Liric_General_Error_Number = 576;
+		sprintf(Liric_General_Error_String,"Liric_Command_Job:Unknown operation %s:Failed to parse command %s.",
+			operation_string,command_string);
+		Liric_General_Error("command","liric_command.c","Liric_Command_Job",LOG_VERBOSITY_TERSE,"COMMAND");
+		if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to parse job command: Unknown operation."))
+			return FALSE;
+		return TRUE;
+	}
+	if(!Liric_General_String_Builder_Add(reply_string,return_string))
+		return FALSE;
+#if LIRIC_DEBUG > 1
+	Liric_General_Log("command","liric_command.c","Liric_Command_Job",LOG_VERBOSITY_TERSE,
+			   "COMMAND","finished.");
+#endif
+	return TRUE;
+}
+
 /**
  * Handle a command of the form: "multrun <length> <count> <standard>".
  * <ul>
  * <li>The multrun command is parsed to get the exposure length, count and standard (true|false) values.
- * <li>We call Liric_Multrun to take the multrun images.
+ * <li>We claim the detector (Liric_Job_Detector_Claim), failing if a job or another sequence is using it.
+ * <li>We call Liric_Multrun to take the multrun images, and then release the detector (Liric_Job_Detector_Release).
  * <li>The reply string is constructed of the form "0 <filename count> <multrun number> <last FITS filename>".
  * <li>We log the returned filenames.
  * <li>We free the returned filenames.
  * </ul>
  * @param command_string The command. This is not changed during this routine.
- * @param reply_string The address of a pointer to allocate and set the reply string.
+ * @param reply_string The string builder to build the reply string in.
  * @return The routine returns TRUE on success and FALSE on failure.
  * @see liric_general.html#Liric_General_Log
  * @see liric_general.html#Liric_General_Error_Number
  * @see liric_general.html#Liric_General_Error_String
- * @see liric_general.html#Liric_General_Add_String
+ * @see liric_general.html#Liric_General_String_Builder_Add
  * @see liric_multrun.html#Liric_Multrun
+ * @see liric_job.html#Liric_Job_Detector_Claim
+ * @see liric_job.html#Liric_Job_Detector_Release
  * @see ../detector/cdocs/detector_fits_filename.html#Detector_Fits_Filename_Multrun_Get
  * @see ../detector/cdocs/detector_fits_filename.html#Detector_Fits_Filename_List_Free
+ * @see ../detector/cdocs/detector_trace.html#Detector_Trace_Span_Start
+ * @see ../detector/cdocs/detector_trace.html#Detector_Trace_Span_End
  */
-int Liric_Command_Multrun(char *command_string,char **reply_string)
+int Liric_Command_Multrun(char *command_string,struct Liric_General_String_Builder_Struct *reply_string)
 {
 	struct timespec start_time = {0L,0L};
+	struct timespec trace_time;
 	char **filename_list = NULL;
 	char standard_string[8];
 	char count_string[16];
@@ -842,7 +1141,7 @@ int Liric_Command_Multrun(char *command_string,char **reply_string)
 		Liric_General_Log("command","liric_command.c","Liric_Command_Multrun",
 				       LOG_VERBOSITY_TERSE,"COMMAND","finished (command parse failed).");
 #endif
-		if(!Liric_General_Add_String(reply_string,"1 Failed to parse multrun command."))
+		if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to parse multrun command."))
 			return FALSE;
 		return TRUE;
 	}
@@ -858,12 +1157,23 @@ int Liric_Command_Multrun(char *command_string,char **reply_string)
 			standard_string);
 		Liric_General_Error("command","liric_command.c","Liric_Command_Multrun",
 				     LOG_VERBOSITY_TERSE,"COMMAND");
-		if(!Liric_General_Add_String(reply_string,"1 Multrun failed:Illegal standard value."))
+		if(!Liric_General_String_Builder_Add(reply_string,"1 Multrun failed:Illegal standard value."))
+			return FALSE;
+		return TRUE;
+	}
+	/* claim the detector, so a job (or another multrun/multbias/multdark) cannot start until we have finished */
+	if(!Liric_Job_Detector_Claim())
+	{
+		Liric_General_Error("command","liric_command.c","Liric_Command_Multrun",LOG_VERBOSITY_TERSE,"COMMAND");
+		if(!Liric_General_String_Builder_Add(reply_string,"1 Multrun failed:The detector is in use."))
 			return FALSE;
 		return TRUE;
 	}
 	/* do multrun */
+	Detector_Trace_Span_Start(&trace_time);
 	retval = Liric_Multrun(exposure_length,exposure_count,do_standard,&filename_list,&filename_count);
+	Detector_Trace_Span_End("multrun","multrun",NULL,&trace_time);
+	Liric_Job_Detector_Release();
 	if(retval == FALSE)
 	{
 		Liric_General_Error("command","liric_command.c","Liric_Command_Multrun",
@@ -872,19 +1182,19 @@ int Liric_Command_Multrun(char *command_string,char **reply_string)
 		Liric_General_Log("command","liric_command.c","Liric_Command_Multrun",
 				   LOG_VERBOSITY_TERSE,"COMMAND","Multrun failed.");
 #endif
-		if(!Liric_General_Add_String(reply_string,"1 Multrun failed."))
+		if(!Liric_General_String_Builder_Add(reply_string,"1 Multrun failed."))
 			return FALSE;
 		return TRUE;
 	}
 	/* success */
-	if(!Liric_General_Add_String(reply_string,"0 "))
+	if(!Liric_General_String_Builder_Add(reply_string,"0 "))
 	{
 		Detector_Fits_Filename_List_Free(&filename_list,&filename_count);
 		return FALSE;
 	}
 	/* add number of FITS images */
 	sprintf(count_string,"%d ",filename_count);
-	if(!Liric_General_Add_String(reply_string,count_string))
+	if(!Liric_General_String_Builder_Add(reply_string,count_string))
 	{
 		Detector_Fits_Filename_List_Free(&filename_list,&filename_count);
 		return FALSE;
@@ -892,7 +1202,7 @@ int Liric_Command_Multrun(char *command_string,char **reply_string)
 	/* get multrun number */
 	multrun_number = Detector_Fits_Filename_Multrun_Get();
 	sprintf(count_string,"%d ",multrun_number);
-	if(!Liric_General_Add_String(reply_string,count_string))
+	if(!Liric_General_String_Builder_Add(reply_string,count_string))
 	{
 		Detector_Fits_Filename_List_Free(&filename_list,&filename_count);
 		return FALSE;
@@ -900,7 +1210,7 @@ int Liric_Command_Multrun(char *command_string,char **reply_string)
 	/* add last filename */
 	if(filename_count > 0)
 	{
-		if(!Liric_General_Add_String(reply_string,filename_list[filename_count-1]))
+		if(!Liric_General_String_Builder_Add(reply_string,filename_list[filename_count-1]))
 		{
 			Detector_Fits_Filename_List_Free(&filename_list,&filename_count);
 			return FALSE;
@@ -908,7 +1218,7 @@ int Liric_Command_Multrun(char *command_string,char **reply_string)
 	}
 	else
 	{
-		if(!Liric_General_Add_String(reply_string,"none"))
+		if(!Liric_General_String_Builder_Add(reply_string,"none"))
 		{
 			Detector_Fits_Filename_List_Free(&filename_list,&filename_count);
 			return FALSE;
@@ -928,7 +1238,7 @@ int Liric_Command_Multrun(char *command_string,char **reply_string)
 		sprintf(Liric_General_Error_String,"Liric_Command_Multrun:Detector_Fits_Filename_List_Free failed.");
 		Liric_General_Error("command","liric_command.c","Liric_Command_Multrun",
 				     LOG_VERBOSITY_TERSE,"COMMAND");
-		if(!Liric_General_Add_String(reply_string,"1 Multrun failed (freeing filename list)."))
+		if(!Liric_General_String_Builder_Add(reply_string,"1 Multrun failed (freeing filename list)."))
 			return FALSE;
 		return TRUE;
 	}
@@ -943,25 +1253,32 @@ int Liric_Command_Multrun(char *command_string,char **reply_string)
  * Handle a command of the form: "multbias <count>".
  * <ul>
  * <li>The multbias command is parsed to get the exposure count value.
- * <li>We call Liric_Bias_Dark_MultBias to take the multiple bias images.
+ * <li>We claim the detector (Liric_Job_Detector_Claim), failing if a job or another sequence is using it.
+ * <li>We call Liric_Bias_Dark_MultBias to take the multiple bias images, and then release the detector
+ *     (Liric_Job_Detector_Release).
  * <li>The reply string is constructed of the form "0 <filename count> <multrun number> <last FITS filename>".
  * <li>We log the returned filenames.
  * <li>We free the returned filenames.
  * </ul>
  * @param command_string The command. This is not changed during this routine.
- * @param reply_string The address of a pointer to allocate and set the reply string.
+ * @param reply_string The string builder to build the reply string in.
  * @return The routine returns TRUE on success and FALSE on failure.
  * @see liric_general.html#Liric_General_Log
  * @see liric_general.html#Liric_General_Error_Number
  * @see liric_general.html#Liric_General_Error_String
- * @see liric_general.html#Liric_General_Add_String
+ * @see liric_general.html#Liric_General_String_Builder_Add
  * @see liric_bias_dark.html#Liric_Bias_Dark_MultBias
+ * @see liric_job.html#Liric_Job_Detector_Claim
+ * @see liric_job.html#Liric_Job_Detector_Release
  * @see ../detector/cdocs/detector_fits_filename.html#Detector_Fits_Filename_Multrun_Get
  * @see ../detector/cdocs/detector_fits_filename.html#Detector_Fits_Filename_List_Free
+ * @see ../detector/cdocs/detector_trace.html#Detector_Trace_Span_Start
+ * @see ../detector/cdocs/detector_trace.html#Detector_Trace_Span_End
  */
-int Liric_Command_MultBias(char *command_string,char **reply_string)
+int Liric_Command_MultBias(char *command_string,struct Liric_General_String_Builder_Struct *reply_string)
 {
 	struct timespec start_time = {0L,0L};
+	struct timespec trace_time;
 	char **filename_list = NULL;
 	char standard_string[8];
 	char count_string[16];
@@ -984,12 +1301,23 @@ int Liric_Command_MultBias(char *command_string,char **reply_string)
 		Liric_General_Log("command","liric_command.c","Liric_Command_MultBias",
 				       LOG_VERBOSITY_TERSE,"COMMAND","finished (command parse failed).");
 #endif
-		if(!Liric_General_Add_String(reply_string,"1 Failed to parse multbias command."))
+		if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to parse multbias command."))
+			return FALSE;
+		return TRUE;
+	}
+	/* claim the detector, so a job (or another multrun/multbias/multdark) cannot start until we have finished */
+	if(!Liric_Job_Detector_Claim())
+	{
+		Liric_General_Error("command","liric_command.c","Liric_Command_MultBias",LOG_VERBOSITY_TERSE,"COMMAND");
+		if(!Liric_General_String_Builder_Add(reply_string,"1 MultBias failed:The detector is in use."))
 			return FALSE;
 		return TRUE;
 	}
 	/* do multbias */
+	Detector_Trace_Span_Start(&trace_time);
 	retval = Liric_Bias_Dark_MultBias(exposure_count,&filename_list,&filename_count);
+	Detector_Trace_Span_End("multrun","multbias",NULL,&trace_time);
+	Liric_Job_Detector_Release();
 	if(retval == FALSE)
 	{
 		Liric_General_Error("command","liric_command.c","Liric_Command_MultBias",
@@ -998,19 +1326,19 @@ int Liric_Command_MultBias(char *command_string,char **reply_string)
 		Liric_General_Log("command","liric_command.c","Liric_Command_MultBias",
 				   LOG_VERBOSITY_TERSE,"COMMAND","MultBias failed.");
 #endif
-		if(!Liric_General_Add_String(reply_string,"1 MultBias failed."))
+		if(!Liric_General_String_Builder_Add(reply_string,"1 MultBias failed."))
 			return FALSE;
 		return TRUE;
 	}
 	/* success */
-	if(!Liric_General_Add_String(reply_string,"0 "))
+	if(!Liric_General_String_Builder_Add(reply_string,"0 "))
 	{
 		Detector_Fits_Filename_List_Free(&filename_list,&filename_count);
 		return FALSE;
 	}
 	/* add number of FITS images */
 	sprintf(count_string,"%d ",filename_count);
-	if(!Liric_General_Add_String(reply_string,count_string))
+	if(!Liric_General_String_Builder_Add(reply_string,count_string))
 	{
 		Detector_Fits_Filename_List_Free(&filename_list,&filename_count);
 		return FALSE;
@@ -1018,7 +1346,7 @@ int Liric_Command_MultBias(char *command_string,char **reply_string)
 	/* get multrun number */
 	multrun_number = Detector_Fits_Filename_Multrun_Get();
 	sprintf(count_string,"%d ",multrun_number);
-	if(!Liric_General_Add_String(reply_string,count_string))
+	if(!Liric_General_String_Builder_Add(reply_string,count_string))
 	{
 		Detector_Fits_Filename_List_Free(&filename_list,&filename_count);
 		return FALSE;
@@ -1026,7 +1354,7 @@ int Liric_Command_MultBias(char *command_string,char **reply_string)
 	/* add last filename */
 	if(filename_count > 0)
 	{
-		if(!Liric_General_Add_String(reply_string,filename_list[filename_count-1]))
+		if(!Liric_General_String_Builder_Add(reply_string,filename_list[filename_count-1]))
 		{
 			Detector_Fits_Filename_List_Free(&filename_list,&filename_count);
 			return FALSE;
@@ -1034,7 +1362,7 @@ int Liric_Command_MultBias(char *command_string,char **reply_string)
 	}
 	else
 	{
-		if(!Liric_General_Add_String(reply_string,"none"))
+		if(!Liric_General_String_Builder_Add(reply_string,"none"))
 		{
 			Detector_Fits_Filename_List_Free(&filename_list,&filename_count);
 			return FALSE;
@@ -1054,7 +1382,7 @@ int Liric_Command_MultBias(char *command_string,char **reply_string)
 		sprintf(Liric_General_Error_String,"Liric_Command_MultBias:Detector_Fits_Filename_List_Free failed.");
 		Liric_General_Error("command","liric_command.c","Liric_Command_MultBias",
 				     LOG_VERBOSITY_TERSE,"COMMAND");
-		if(!Liric_General_Add_String(reply_string,"1 MultBias failed (freeing filename list)."))
+		if(!Liric_General_String_Builder_Add(reply_string,"1 MultBias failed (freeing filename list)."))
 			return FALSE;
 		return TRUE;
 	}
@@ -1069,25 +1397,32 @@ int Liric_Command_MultBias(char *command_string,char **reply_string)
  * Handle a command of the form: "multdark <length> <count>".
  * <ul>
  * <li>The multdark command is parsed to get the exposure length, and exposure count values.
- * <li>We call Liric_Bias_Dark_MultDark to take the dark images.
+ * <li>We claim the detector (Liric_Job_Detector_Claim), failing if a job or another sequence is using it.
+ * <li>We call Liric_Bias_Dark_MultDark to take the dark images, and then release the detector
+ *     (Liric_Job_Detector_Release).
  * <li>The reply string is constructed of the form "0 <filename count> <multrun number> <last FITS filename>".
  * <li>We log the returned filenames.
  * <li>We free the returned filenames.
  * </ul>
  * @param command_string The command. This is not changed during this routine.
- * @param reply_string The address of a pointer to allocate and set the reply string.
+ * @param reply_string The string builder to build the reply string in.
  * @return The routine returns TRUE on success and FALSE on failure.
  * @see liric_general.html#Liric_General_Log
  * @see liric_general.html#Liric_General_Error_Number
  * @see liric_general.html#Liric_General_Error_String
- * @see liric_general.html#Liric_General_Add_String
+ * @see liric_general.html#Liric_General_String_Builder_Add
  * @see liric_bias_dark.html#Liric_Bias_Dark_MultDark
+ * @see liric_job.html#Liric_Job_Detector_Claim
+ * @see liric_job.html#Liric_Job_Detector_Release
  * @see ../detector/cdocs/detector_fits_filename.html#Detector_Fits_Filename_Multrun_Get
  * @see ../detector/cdocs/detector_fits_filename.html#Detector_Fits_Filename_List_Free
+ * @see ../detector/cdocs/detector_trace.html#Detector_Trace_Span_Start
+ * @see ../detector/cdocs/detector_trace.html#Detector_Trace_Span_End
  */
-int Liric_Command_MultDark(char *command_string,char **reply_string)
+int Liric_Command_MultDark(char *command_string,struct Liric_General_String_Builder_Struct *reply_string)
 {
 	struct timespec start_time = {0L,0L};
+	struct timespec trace_time;
 	char **filename_list = NULL;
 	char count_string[16];
 	int i,retval,exposure_length,exposure_count,filename_count,multrun_number;
@@ -1109,12 +1444,23 @@ int Liric_Command_MultDark(char *command_string,char **reply_string)
 		Liric_General_Log("command","liric_command.c","Liric_Command_MultDark",
 				       LOG_VERBOSITY_TERSE,"COMMAND","finished (command parse failed).");
 #endif
-		if(!Liric_General_Add_String(reply_string,"1 Failed to parse multdark command."))
+		if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to parse multdark command."))
+			return FALSE;
+		return TRUE;
+	}
+	/* claim the detector, so a job (or another multrun/multbias/multdark) cannot start until we have finished */
+	if(!Liric_Job_Detector_Claim())
+	{
+		Liric_General_Error("command","liric_command.c","Liric_Command_MultDark",LOG_VERBOSITY_TERSE,"COMMAND");
+		if(!Liric_General_String_Builder_Add(reply_string,"1 MultDark failed:The detector is in use."))
 			return FALSE;
 		return TRUE;
 	}
 	/* do multdark */
+	Detector_Trace_Span_Start(&trace_time);
 	retval = Liric_Bias_Dark_MultDark(exposure_length,exposure_count,&filename_list,&filename_count);
+	Detector_Trace_Span_End("multrun","multdark",NULL,&trace_time);
+	Liric_Job_Detector_Release();
 	if(retval == FALSE)
 	{
 		Liric_General_Error("command","liric_command.c","Liric_Command_MultDark",
@@ -1123,19 +1469,19 @@ int Liric_Command_MultDark(char *command_string,char **reply_string)
 		Liric_General_Log("command","liric_command.c","Liric_Command_MultDark",
 				   LOG_VERBOSITY_TERSE,"COMMAND","MultDark failed.");
 #endif
-		if(!Liric_General_Add_String(reply_string,"1 MultDark failed."))
+		if(!Liric_General_String_Builder_Add(reply_string,"1 MultDark failed."))
 			return FALSE;
 		return TRUE;
 	}
 	/* success */
-	if(!Liric_General_Add_String(reply_string,"0 "))
+	if(!Liric_General_String_Builder_Add(reply_string,"0 "))
 	{
 		Detector_Fits_Filename_List_Free(&filename_list,&filename_count);
 		return FALSE;
 	}
 	/* add number of FITS images */
 	sprintf(count_string,"%d ",filename_count);
-	if(!Liric_General_Add_String(reply_string,count_string))
+	if(!Liric_General_String_Builder_Add(reply_string,count_string))
 	{
 		Detector_Fits_Filename_List_Free(&filename_list,&filename_count);
 		return FALSE;
@@ -1143,7 +1489,7 @@ int Liric_Command_MultDark(char *command_string,char **reply_string)
 	/* get multrun number */
 	multrun_number = Detector_Fits_Filename_Multrun_Get();
 	sprintf(count_string,"%d ",multrun_number);
-	if(!Liric_General_Add_String(reply_string,count_string))
+	if(!Liric_General_String_Builder_Add(reply_string,count_string))
 	{
 		Detector_Fits_Filename_List_Free(&filename_list,&filename_count);
 		return FALSE;
@@ -1151,7 +1497,7 @@ int Liric_Command_MultDark(char *command_string,char **reply_string)
 	/* add last filename */
 	if(filename_count > 0)
 	{
-		if(!Liric_General_Add_String(reply_string,filename_list[filename_count-1]))
+		if(!Liric_General_String_Builder_Add(reply_string,filename_list[filename_count-1]))
 		{
 			Detector_Fits_Filename_List_Free(&filename_list,&filename_count);
 			return FALSE;
@@ -1159,7 +1505,7 @@ int Liric_Command_MultDark(char *command_string,char **reply_string)
 	}
 	else
 	{
-		if(!Liric_General_Add_String(reply_string,"none"))
+		if(!Liric_General_String_Builder_Add(reply_string,"none"))
 		{
 			Detector_Fits_Filename_List_Free(&filename_list,&filename_count);
 			return FALSE;
@@ -1179,7 +1525,7 @@ int Liric_Command_MultDark(char *command_string,char **reply_string)
 		sprintf(Liric_General_Error_String,"Liric_Command_MultDark:Detector_Fits_Filename_List_Free failed.");
 		Liric_General_Error("command","liric_command.c","Liric_Command_MultDark",
 				     LOG_VERBOSITY_TERSE,"COMMAND");
-		if(!Liric_General_Add_String(reply_string,"1 MultDark failed (freeing filename list)."))
+		if(!Liric_General_String_Builder_Add(reply_string,"1 MultDark failed (freeing filename list)."))
 			return FALSE;
 		return TRUE;
 	}
@@ -1193,60 +1539,140 @@ int Liric_Command_MultDark(char *command_string,char **reply_string)
 /**
  * Handle a status command. Possible forms: 
  * <ul>
- * <li>status temperature [get|status]
+ * <li>status temperature [get|pcb|tec|fpga]
+ * <li>status telemetry
+ * <li>status telemetry history &lt;hours&gt; [&lt;points&gt;]
  * <li>status filterwheel [filter|position|status]
  * <li>status nudgematic [position|status|offsetsize]
  * <li>status exposure [status|count|length|start_time]
  * <li>status exposure [index|multrun|run]
+ * <li>status exposure stats
+ * <li>status exposure accumulator
+ * <li>status latency [&lt;stage&gt;]
+ * <li>status log
+ * <li>status serial
+ * <li>status server
+ * <li>status startup
+ * <li>status all
  * </ul>
  * <ul>
  * <li>The status command is parsed to retrieve the subsystem (1st parameter).
  * <li>Based on the subsystem, further parsing occurs.
  * <li>The relevant status is retrieved, and a suitable reply constructed.
+ * <li>The exposure, filterwheel and nudgematic status come from a snapshot of the published instrument state
+ *     (Liric_State_Get), so they are consistent, don't race with the acquisition thread, and need no hardware I/O
+ *     (the mechanisms are only read if their position has not been published yet).
+ * <li>"status latency &lt;stage&gt;" returns "count=&lt;n&gt; min=&lt;ms&gt; mean=&lt;ms&gt; p95=&lt;ms&gt; max=&lt;ms&gt;" for
+ *     the named exposure stage. "status latency" returns the same statistics for every stage, as a space separated
+ *     list of "&lt;stage&gt;:n=&lt;n&gt;,min=&lt;ms&gt;,mean=&lt;ms&gt;,p95=&lt;ms&gt;,max=&lt;ms&gt;". 
+ *     This reply is too long for return_string, and is added to the reply string directly.
+ * <li>"status temperature get|pcb|tec|fpga" return the time and value of the sensor temperature, PCB temperature,
+ *     TEC set-point or FPGA status byte (in hex). If the telemetry sampler is running these come from its
+ *     latest sample (and the time is when the sample was taken), without any serial I/O to the camera head.
+ *     Otherwise the camera head is queried directly.
+ * <li>"status telemetry" returns "running=&lt;true|false&gt; period=&lt;ms&gt; samples=&lt;n&gt; failures=&lt;n&gt;".
+ * <li>"status telemetry history &lt;hours&gt; [&lt;points&gt;]" returns the sampled telemetry over the last
+ *     &lt;hours&gt; hours, downsampled to at most &lt;points&gt; points (default TELEMETRY_HISTORY_DEFAULT_POINT_COUNT),
+ *     as "n=&lt;count&gt;" followed by a space separated list of 
+ *     "&lt;time&gt;,&lt;sensor C&gt;,&lt;pcb C&gt;,&lt;TEC set-point C&gt;,&lt;FPGA status&gt;", oldest first. 
+ *     This reply is too long for return_string, and is added to the reply string directly.
+ * <li>"status log" returns "async=&lt;true|false&gt; written=&lt;n&gt; dropped=&lt;n&gt;": whether the asynchronous
+ *     logging core is running, and how many log records it has written, and dropped because it's ring was full,
+ *     since it was started (Liric_General_Log_Async_Statistics_Get).
+ * <li>"status serial" returns the round trip statistics of each kind of serial command sent to the camera head,
+ *     as a space separated list of "&lt;command&gt;:n=&lt;n&gt;,fail=&lt;n&gt;,timeout=&lt;n&gt;,min=&lt;ms&gt;,mean=&lt;ms&gt;,
+ *     max=&lt;ms&gt;,queue=&lt;ms&gt;", where &lt;command&gt; is the command byte (and sub-command byte for
+ *     register/EPROM access commands) in hex. 
+ *     This reply is too long for return_string, and is added to the reply string directly.
+ * <li>"status server" returns "unknown=&lt;n&gt;" (the number of unknown commands received), followed by the
+ *     processing statistics of each command the server understands, as a space separated list of 
+ *     "&lt;keyword&gt;:n=&lt;n&gt;,fail=&lt;n&gt;,rejected=&lt;n&gt;,min=&lt;ms&gt;,mean=&lt;ms&gt;,max=&lt;ms&gt;,
+ *     hist=&lt;n&gt;/&lt;n&gt;/...", where hist is the latency histogram (see LIRIC_SERVER_HISTOGRAM_BIN_COUNT).
+ *     This reply is too long for return_string, and is added to the reply string directly.
+ * <li>"status startup" returns "total=&lt;ms&gt;" (how long liric took from starting to being ready to accept
+ *     commands), followed by how long each startup phase took, as a space separated list of
+ *     "&lt;phase&gt;:ok=&lt;true|false&gt;,time=&lt;ms&gt;" in the order the phases finished 
+ *     (Liric_State_Startup_Get). The mechanism phases (detector, nudgematic, filter_wheel) run concurrently, 
+ *     the "mechanisms" phase is how long they took altogether.
+ * <li>"status all" returns a snapshot of all the status GET_STATUS needs in one reply, built by 
+ *     Command_Status_All.
  * </ul>
  * @param command_string The command. This is not changed during this routine.
- * @param reply_string The address of a pointer to allocate and set the reply string.
+ * @param reply_string The string builder to build the reply string in.
  * @return The routine returns TRUE on success and FALSE on failure.
- * @see liric_bias_dark.html#Liric_Bias_Dark_In_Progress
- * @see liric_bias_dark.html#Liric_Bias_Dark_Count_Get
- * @see liric_bias_dark.html#Liric_Bias_Dark_Exposure_Index_Get
+ * @see #Command_Status_All
+ * @see #Command_State_Filter_Wheel_Get
+ * @see #Command_State_Nudgematic_Get
+ * @see liric_state.html#Liric_State_Get
+ * @see liric_state.html#Liric_State_Startup_Get
  * @see liric_config.html#Liric_Config_Filter_Wheel_Is_Enabled
  * @see liric_config.html#Liric_Config_Nudgematic_Is_Enabled
  * @see liric_general.html#Liric_General_Log
  * @see liric_general.html#Liric_General_Error_Number
  * @see liric_general.html#Liric_General_Error_String
- * @see liric_general.html#Liric_General_Add_String
+ * @see liric_general.html#Liric_General_String_Builder_Add
+ * @see liric_general.html#Liric_General_String_Builder_Add_Format
  * @see liric_general.html#Liric_General_Get_Time_String
  * @see liric_general.html#Liric_General_Get_Current_Time_String
- * @see liric_multrun.html#Liric_Multrun_In_Progress
- * @see liric_multrun.html#Liric_Multrun_Count_Get
- * @see liric_multrun.html#Liric_Multrun_Exposure_Index_Get
- * @see ../detector/cdocs/detector_exposure.html#Detector_Exposure_Exposure_Length_Get
- * @see ../detector/cdocs/detector_exposure.html#Detector_Exposure_Start_Time_Get
- * @see ../detector/cdocs/detector_exposure.html#Detector_Exposure_In_Progress
- * @see ../detector/cdocs/detector_fits_filename.html#Detector_Fits_Filename_Multrun_Get
- * @see ../detector/cdocs/detector_fits_filename.html#Detector_Fits_Filename_Run_Get
+ * @see liric_general.html#Liric_General_Log_Async_Statistics_Get
+ * @see ../detector/cdocs/detector_buffer.html#Detector_Buffer_Statistics_Get
+ * @see ../detector/cdocs/detector_buffer.html#Detector_Buffer_Accumulator_Get
+ * @see ../detector/cdocs/detector_latency.html#DETECTOR_LATENCY_STAGE
+ * @see ../detector/cdocs/detector_latency.html#Detector_Latency_Stage_From_Name
+ * @see ../detector/cdocs/detector_latency.html#Detector_Latency_Stage_Name_Get
+ * @see ../detector/cdocs/detector_latency.html#Detector_Latency_Stage_Statistics_Get
+ * @see #TELEMETRY_HISTORY_DEFAULT_POINT_COUNT
+ * @see #TELEMETRY_HISTORY_POINT_STRING_LENGTH
+ * @see #Command_Telemetry_Sample_Get
+ * @see ../detector/cdocs/detector_serial.html#Detector_Serial_Command_Get_FPGA_Status
+ * @see ../detector/cdocs/detector_serial.html#Detector_Serial_Statistics_Get
+ * @see ../detector/cdocs/detector_serial.html#DETECTOR_SERIAL_MAX_STATISTICS_COUNT
+ * @see liric_server.html#Liric_Server_Statistics_Get
+ * @see liric_server.html#LIRIC_SERVER_MAX_COMMAND_COUNT
+ * @see liric_server.html#LIRIC_SERVER_HISTOGRAM_BIN_COUNT
+ * @see ../detector/cdocs/detector_telemetry.html#Detector_Telemetry_Is_Running
+ * @see ../detector/cdocs/detector_telemetry.html#Detector_Telemetry_Statistics_Get
+ * @see ../detector/cdocs/detector_telemetry.html#Detector_Telemetry_History_Get
  * @see ../detector/cdocs/detector_temperature.html#Detector_Temperature_Get
  * @see ../detector/cdocs/detector_temperature.html#Detector_Temperature_PCB_Get
+ * @see ../detector/cdocs/detector_temperature.html#Detector_Temperature_Get_TEC_Setpoint
  * @see ../filter_wheel/cdocs/filter_wheel_command.html#Filter_Wheel_Command_Get_Position
  * @see ../nudgematic/cdocs/nudgematic_command.html#Nudgematic_Command_Position_Get
  * @see ../nudgematic/cdocs/nudgematic_command.html#NUDGEMATIC_OFFSET_SIZE_T
  * @see ../nudgematic/cdocs/nudgematic_command.html#Nudgematic_Command_Offset_Size_Get
  */
-int Liric_Command_Status(char *command_string,char **reply_string)
+int Liric_Command_Status(char *command_string,struct Liric_General_String_Builder_Struct *reply_string)
 {
 	NUDGEMATIC_OFFSET_SIZE_T offset_size;
+	enum DETECTOR_LATENCY_STAGE latency_stage;
+	struct Detector_Telemetry_Sample_Struct telemetry_sample;
+	struct Detector_Telemetry_Sample_Struct *telemetry_point_list = NULL;
+	struct Detector_Serial_Statistics_Struct serial_statistics_list[DETECTOR_SERIAL_MAX_STATISTICS_COUNT];
+	struct Liric_Server_Command_Statistics_Struct server_statistics_list[LIRIC_SERVER_MAX_COMMAND_COUNT];
+	struct Liric_State_Struct state;
+	struct Liric_State_Startup_Struct startup;
 	struct timespec status_time;
 	char time_string[32];
-	char return_string[128];
+	char return_string[256];
+	char latency_string[DETECTOR_LATENCY_STAGE_COUNT*128];
+	char serial_string[DETECTOR_SERIAL_MAX_STATISTICS_COUNT*96];
+	char server_string[LIRIC_SERVER_MAX_COMMAND_COUNT*256];
 	char subsystem_string[32];
+	char stage_name_string[32];
 	char get_set_string[16];
 	char key_string[64];
 	char temperature_status_string[32];
 	char filter_name_string[32];
 	char *camera_name_string = NULL;
-	int retval,command_string_index,ivalue,filter_wheel_position,nudgematic_position;
-	double temperature;
+	char *telemetry_string = NULL;
+	unsigned char fpga_status;
+	unsigned int telemetry_sample_count,telemetry_failure_count,server_unknown_count;
+	unsigned int log_written_count,log_dropped_count;
+	int retval,command_string_index,ivalue,filter_wheel_position,nudgematic_position,saturated_count;
+	int latency_count,telemetry_period_ms,history_point_count,returned_point_count,serial_statistics_count,i;
+	int server_statistics_count,bin;
+	double history_hours;
+	double temperature,minimum,maximum,mean,median,p95;
 
 	/* parse command */
 	retval = sscanf(command_string,"status %31s %n",subsystem_string,&command_string_index);
@@ -1261,7 +1687,7 @@ int Liric_Command_Status(char *command_string,char **reply_string)
 		Liric_General_Log("command","liric_command.c","Liric_Command_Status",
 				       LOG_VERBOSITY_TERSE,"COMMAND","finished (command parse failed).");
 #endif
-		if(!Liric_General_Add_String(reply_string,"1 Failed to parse status command."))
+		if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to parse status command."))
 			return FALSE;
 		return TRUE;
 	}
@@ -1269,72 +1695,88 @@ int Liric_Command_Status(char *command_string,char **reply_string)
 	/* initialise return string */
 	strcpy(return_string,"0 ");
 	/* parse subsystem */
-	if(strncmp(subsystem_string,"exposure",8) == 0)
+	if(strcmp(subsystem_string,"all") == 0)
+	{
+		return Command_Status_All(reply_string);
+	}
+	else if(strncmp(subsystem_string,"exposure",8) == 0)
 	{
+		/* the exposure status comes from the published state, a consistent snapshot */
+		Liric_State_Get(&state);
 		if(strncmp(command_string+command_string_index,"status",6)==0)
 		{
-			if(Detector_Exposure_In_Progress())
-				strcat(return_string,"true");
-			else
-				strcat(return_string,"false");
-			/*
-			if(Liric_Multrun_In_Progress())
-				strcat(return_string,"true");
-			else if(Liric_Bias_Dark_In_Progress())
+			if(state.Exposure_In_Progress)
 				strcat(return_string,"true");
 			else
 				strcat(return_string,"false");
-			*/
+		}
+		else if(strncmp(command_string+command_string_index,"accumulator",11)==0)
+		{
+			ivalue = Detector_Buffer_Accumulator_Get();
+			sprintf(return_string+strlen(return_string),"%d",ivalue);
 		}
 		else if(strncmp(command_string+command_string_index,"coadd-length",12)==0)
 		{
-			ivalue = Detector_Exposure_Coadd_Frame_Exposure_Length_Get();
+			ivalue = state.Coadd_Frame_Exposure_Length_Ms;
 			sprintf(return_string+strlen(return_string),"%d",ivalue);
 		}
 		else if(strncmp(command_string+command_string_index,"coadd-count",12)==0)
 		{
-			ivalue = Detector_Exposure_Coadd_Count_Get();
+			ivalue = state.Coadd_Count;
 			sprintf(return_string+strlen(return_string),"%d",ivalue);
 		}
 		else if(strncmp(command_string+command_string_index,"count",5)==0)
 		{
-			if(Liric_Multrun_In_Progress())
-				ivalue = Liric_Multrun_Count_Get();
-			else if(Liric_Bias_Dark_In_Progress())
-				ivalue = Liric_Bias_Dark_Count_Get();
+			if(state.Sequence_In_Progress)
+				ivalue = state.Sequence_Count;
 			else
 				ivalue = 0;
 			sprintf(return_string+strlen(return_string),"%d",ivalue);
 		}
 		else if(strncmp(command_string+command_string_index,"length",6)==0)
 		{
-			ivalue = Detector_Exposure_Exposure_Length_Get();
+			ivalue = state.Exposure_Length_Ms;
 			sprintf(return_string+strlen(return_string),"%d",ivalue);
 		}
+		else if(strncmp(command_string+command_string_index,"stats",5)==0)
+		{
+			if(!Detector_Buffer_Statistics_Get(&minimum,&maximum,&mean,&median,&saturated_count))
+			{
+				Liric_General_Error_Number = 553;
+				sprintf(Liric_General_Error_String,"Liric_Command_Status:"
+					"Failed to get exposure statistics.");
+				Liric_General_Error("command","liric_command.c","Liric_Command_Status",
+						     LOG_VERBOSITY_TERSE,"COMMAND");
+				if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to get exposure statistics."))
+					return FALSE;
+				return TRUE;
+			}
+			sprintf(return_string+strlen(return_string),
+				"min=%.3f max=%.3f mean=%.3f median=%.3f saturated=%d pixels=%d",
+				minimum,maximum,mean,median,saturated_count,Detector_Buffer_Get_Pixel_Count());
+		}
 		else if(strncmp(command_string+command_string_index,"start_time",10)==0)
 		{
-			status_time = Detector_Exposure_Start_Time_Get();
+			status_time = state.Exposure_Start_Time;
 			Liric_General_Get_Time_String(status_time,time_string,31);
 			sprintf(return_string+strlen(return_string),"%s",time_string);
 		}
 		else if(strncmp(command_string+command_string_index,"index",5)==0)
 		{
-			if(Liric_Multrun_In_Progress())
-				ivalue = Liric_Multrun_Exposure_Index_Get();
-			else if(Liric_Bias_Dark_In_Progress())
-				ivalue = Liric_Bias_Dark_Exposure_Index_Get();
+			if(state.Sequence_In_Progress)
+				ivalue = state.Sequence_Index;
 			else
 				ivalue = 0;
 			sprintf(return_string+strlen(return_string),"%d",ivalue);
 		}
 		else if(strncmp(command_string+command_string_index,"multrun",7)==0)
 		{
-			ivalue = Detector_Fits_Filename_Multrun_Get();
+			ivalue = state.Multrun_Number;
 			sprintf(return_string+strlen(return_string),"%d",ivalue);
 		}
 		else if(strncmp(command_string+command_string_index,"run",3)==0)
 		{
-			ivalue = Detector_Fits_Filename_Run_Get();
+			ivalue = state.Run_Number;
 			sprintf(return_string+strlen(return_string),"%d",ivalue);
 		}
 		else
@@ -1350,7 +1792,7 @@ int Liric_Command_Status(char *command_string,char **reply_string)
 						  "Failed to parse exposure status command %s.",
 						  command_string+command_string_index);
 #endif
-			if(!Liric_General_Add_String(reply_string,"1 Failed to parse exposure status command."))
+			if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to parse exposure status command."))
 				return FALSE;
 			return TRUE;
 		}
@@ -1359,7 +1801,8 @@ int Liric_Command_Status(char *command_string,char **reply_string)
 	{
 		if(Liric_Config_Filter_Wheel_Is_Enabled())
 		{
-			if(!Filter_Wheel_Command_Get_Position(&filter_wheel_position))
+			Liric_State_Get(&state);
+			if(!Command_State_Filter_Wheel_Get(&state,&filter_wheel_position))
 			{
 				Liric_General_Error_Number = 509;
 				sprintf(Liric_General_Error_String,"Liric_Command_Status:"
@@ -1370,7 +1813,7 @@ int Liric_Command_Status(char *command_string,char **reply_string)
 				Liric_General_Log("command","liric_command.c","Liric_Command_Status",
 						   LOG_VERBOSITY_TERSE,"COMMAND","Failed to get filter wheel position.");
 #endif
-				if(!Liric_General_Add_String(reply_string,"1 Failed to get filter wheel position."))
+				if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to get filter wheel position."))
 					return FALSE;
 				return TRUE;
 			}
@@ -1407,10 +1850,10 @@ int Liric_Command_Status(char *command_string,char **reply_string)
 						  "Failed to get filter wheel filter name from position %d.",
 								  filter_wheel_position);
 #endif
-					if(!Liric_General_Add_String(reply_string,
+					if(!Liric_General_String_Builder_Add(reply_string,
 							"1 Failed to get filter wheel filter name from position:"))
 						return FALSE;
-					if(!Liric_General_Add_Integer_To_String(reply_string,filter_wheel_position))
+					if(!Liric_General_String_Builder_Add_Integer(reply_string,filter_wheel_position))
 						return FALSE;
 					return TRUE;
 				}
@@ -1441,7 +1884,7 @@ int Liric_Command_Status(char *command_string,char **reply_string)
 						  "Failed to parse filterwheel command %s.",
 						  command_string+command_string_index);
 #endif
-			if(!Liric_General_Add_String(reply_string,"1 Failed to parse filterwheel status command."))
+			if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to parse filterwheel status command."))
 				return FALSE;
 			return TRUE;
 		}
@@ -1450,7 +1893,8 @@ int Liric_Command_Status(char *command_string,char **reply_string)
 	{
 		if(Liric_Config_Nudgematic_Is_Enabled())
 		{
-			if(!Nudgematic_Command_Position_Get(&nudgematic_position))
+			Liric_State_Get(&state);
+			if(!Command_State_Nudgematic_Get(&state,&nudgematic_position))
 			{
 				Liric_General_Error_Number = 541;
 				sprintf(Liric_General_Error_String,"Liric_Command_Status:"
@@ -1461,7 +1905,7 @@ int Liric_Command_Status(char *command_string,char **reply_string)
 				Liric_General_Log("command","liric_command.c","Liric_Command_Status",
 						   LOG_VERBOSITY_TERSE,"COMMAND","Failed to get nudgematic position.");
 #endif
-				if(!Liric_General_Add_String(reply_string,"1 Failed to get nudgematic position."))
+				if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to get nudgematic position."))
 					return FALSE;
 				return TRUE;
 			}
@@ -1510,7 +1954,7 @@ int Liric_Command_Status(char *command_string,char **reply_string)
 							  "Failed to parse status nudgematic command %s.",
 							  command_string+command_string_index);
 #endif
-				if(!Liric_General_Add_String(reply_string,"1 Failed to parse status nudgematic command."))
+				if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to parse status nudgematic command."))
 					return FALSE;
 				return TRUE;
 			}
@@ -1543,7 +1987,7 @@ int Liric_Command_Status(char *command_string,char **reply_string)
 							  "Failed to parse status nudgematic command %s.",
 							  command_string+command_string_index);
 #endif
-				if(!Liric_General_Add_String(reply_string,"1 Failed to parse status nudgematic command."))
+				if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to parse status nudgematic command."))
 					return FALSE;
 				return TRUE;
 			}			
@@ -1563,7 +2007,7 @@ int Liric_Command_Status(char *command_string,char **reply_string)
 			Liric_General_Log("command","liric_command.c","Liric_Command_Status",
 					   LOG_VERBOSITY_TERSE,"COMMAND","finished (command parse failed).");
 #endif
-			if(!Liric_General_Add_String(reply_string,
+			if(!Liric_General_String_Builder_Add(reply_string,
 						      "1 Failed to parse status temperature ."))
 				return FALSE;
 			return TRUE;
@@ -1571,7 +2015,14 @@ int Liric_Command_Status(char *command_string,char **reply_string)
 		/* check subcommand */
 		if(strncmp(get_set_string,"get",3)==0)
 		{
-			if(!Detector_Temperature_Get(&temperature))
+			if(Command_Telemetry_Sample_Get(DETECTOR_TELEMETRY_VALID_SENSOR_TEMPERATURE,&telemetry_sample))
+			{
+				temperature = telemetry_sample.Sensor_Temperature_C;
+				status_time = telemetry_sample.Timestamp;
+			}
+			else if(Detector_Temperature_Get(&temperature))
+				clock_gettime(CLOCK_REALTIME,&status_time);
+			else
 			{
 				Liric_General_Error_Number = 513;
 				sprintf(Liric_General_Error_String,"Liric_Command_Status:"
@@ -1582,16 +2033,23 @@ int Liric_Command_Status(char *command_string,char **reply_string)
 				Liric_General_Log("command","liric_command.c","Liric_Command_Status",
 						   LOG_VERBOSITY_TERSE,"COMMAND","Failed to get temperature.");
 #endif
-				if(!Liric_General_Add_String(reply_string,"1 Failed to get temperature."))
+				if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to get temperature."))
 					return FALSE;
 				return TRUE;
 			}
-			Liric_General_Get_Current_Time_String(time_string,31);
+			Liric_General_Get_Time_String(status_time,time_string,31);
 			sprintf(return_string+strlen(return_string),"%s %.2f",time_string,temperature);
 		}
 		else if(strncmp(get_set_string,"pcb",6)==0)
 		{
-			if(!Detector_Temperature_PCB_Get(&temperature))
+			if(Command_Telemetry_Sample_Get(DETECTOR_TELEMETRY_VALID_PCB_TEMPERATURE,&telemetry_sample))
+			{
+				temperature = telemetry_sample.PCB_Temperature_C;
+				status_time = telemetry_sample.Timestamp;
+			}
+			else if(Detector_Temperature_PCB_Get(&temperature))
+				clock_gettime(CLOCK_REALTIME,&status_time);
+			else
 			{
 				Liric_General_Error_Number = 507;
 				sprintf(Liric_General_Error_String,"Liric_Command_Status:"
@@ -1602,13 +2060,67 @@ int Liric_Command_Status(char *command_string,char **reply_string)
 				Liric_General_Log("command","liric_command.c","Liric_Command_Status",
 						   LOG_VERBOSITY_TERSE,"COMMAND","Failed to get PCB temperature.");
 #endif
-				if(!Liric_General_Add_String(reply_string,"1 Failed to get PCB temperature."))
+				if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to get PCB temperature."))
 					return FALSE;
 				return TRUE;
 			}
-			Liric_General_Get_Current_Time_String(time_string,31);
+			Liric_General_Get_Time_String(status_time,time_string,31);
 			sprintf(return_string+strlen(return_string),"%s %.2f",time_string,temperature);
 		}
+		else if(strncmp(get_set_string,"tec",3)==0)
+		{
+			if(Command_Telemetry_Sample_Get(DETECTOR_TELEMETRY_VALID_TEC_SETPOINT,&telemetry_sample))
+			{
+				temperature = telemetry_sample.TEC_Setpoint_C;
+				status_time = telemetry_sample.Timestamp;
+			}
+			else if(Detector_Temperature_Get_TEC_Setpoint(&temperature))
+				clock_gettime(CLOCK_REALTIME,&status_time);
+			else
+			{
+				Liric_General_Error_Number = 561;
+				sprintf(Liric_General_Error_String,"Liric_Command_Status:"
+					"Failed to get TEC set-point.");
+				Liric_General_Error("command","liric_command.c","Liric_Command_Status",
+						     LOG_VERBOSITY_TERSE,"COMMAND");
+#if LIRIC_DEBUG > 1
+				Liric_General_Log("command","liric_command.c","Liric_Command_Status",
+						   LOG_VERBOSITY_TERSE,"COMMAND","Failed to get TEC set-point.");
+#endif
+				if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to get TEC set-point."))
+					return FALSE;
+				return TRUE;
+			}
+			Liric_General_Get_Time_String(status_time,time_string,31);
+			sprintf(return_string+strlen(return_string),"%s %.2f",time_string,temperature);
+		}
+		else if(strncmp(get_set_string,"fpga",4)==0)
+		{
+			if(Command_Telemetry_Sample_Get(DETECTOR_TELEMETRY_VALID_FPGA_STATUS,&telemetry_sample))
+			{
+				fpga_status = (unsigned char)(telemetry_sample.FPGA_Status);
+				status_time = telemetry_sample.Timestamp;
+			}
+			else if(Detector_Serial_Command_Get_FPGA_Status(&fpga_status))
+				clock_gettime(CLOCK_REALTIME,&status_time);
+			else
+			{
+				Liric_General_Error_Number = 562;
+				sprintf(Liric_General_Error_String,"Liric_Command_Status:"
+					"Failed to get FPGA status.");
+				Liric_General_Error("command","liric_command.c","Liric_Command_Status",
+						     LOG_VERBOSITY_TERSE,"COMMAND");
+#if LIRIC_DEBUG > 1
+				Liric_General_Log("command","liric_command.c","Liric_Command_Status",
+						   LOG_VERBOSITY_TERSE,"COMMAND","Failed to get FPGA status.");
+#endif
+				if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to get FPGA status."))
+					return FALSE;
+				return TRUE;
+			}
+			Liric_General_Get_Time_String(status_time,time_string,31);
+			sprintf(return_string+strlen(return_string),"%s %#04x",time_string,fpga_status);
+		}
 		else
 		{
 			Liric_General_Error_Number = 515;
@@ -1622,11 +2134,263 @@ int Liric_Command_Status(char *command_string,char **reply_string)
 						  "Failed to parse temperature command %s from %d.",
 						  command_string,command_string_index);
 #endif
-			if(!Liric_General_Add_String(reply_string,"1 Failed to parse temperature status command."))
+			if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to parse temperature status command."))
 				return FALSE;
 			return TRUE;
 		}
 	}
+	else if(strncmp(subsystem_string,"telemetry",9) == 0)
+	{
+		if(strncmp(command_string+command_string_index,"history",7)==0)
+		{
+			history_point_count = TELEMETRY_HISTORY_DEFAULT_POINT_COUNT;
+			retval = sscanf(command_string+command_string_index,"history %lf %d",&history_hours,
+					&history_point_count);
+			if((retval < 1)||(history_hours <= 0.0)||(history_point_count < 1))
+			{
+				Liric_General_Error_Number = 563;
+				sprintf(Liric_General_Error_String,"Liric_Command_Status:"
+					"Failed to parse telemetry history command %s.",command_string);
+				Liric_General_Error("command","liric_command.c","Liric_Command_Status",
+						     LOG_VERBOSITY_TERSE,"COMMAND");
+				if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to parse status telemetry history command."))
+					return FALSE;
+				return TRUE;
+			}
+			if(history_point_count > DETECTOR_TELEMETRY_MAX_HISTORY_POINT_COUNT)
+				history_point_count = DETECTOR_TELEMETRY_MAX_HISTORY_POINT_COUNT;
+			telemetry_point_list = (struct Detector_Telemetry_Sample_Struct *)malloc(history_point_count*
+									 sizeof(struct Detector_Telemetry_Sample_Struct));
+			telemetry_string = (char *)malloc((history_point_count+1)*TELEMETRY_HISTORY_POINT_STRING_LENGTH*
+							  sizeof(char));
+			if((telemetry_point_list == NULL)||(telemetry_string == NULL))
+			{
+				if(telemetry_point_list != NULL)
+					free(telemetry_point_list);
+				if(telemetry_string != NULL)
+					free(telemetry_string);
+				Liric_General_Error_Number = 564;
+				sprintf(Liric_General_Error_String,"Liric_Command_Status:"
+					"Failed to allocate telemetry history of %d points.",history_point_count);
+				Liric_General_Error("command","liric_command.c","Liric_Command_Status",
+						     LOG_VERBOSITY_TERSE,"COMMAND");
+				if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to get telemetry history."))
+					return FALSE;
+				return TRUE;
+			}
+			if(!Detector_Telemetry_History_Get((int)(history_hours*3600.0),history_point_count,
+							   telemetry_point_list,&returned_point_count))
+			{
+				free(telemetry_point_list);
+				free(telemetry_string);
+				Liric_General_Error_Number = 565;
+				sprintf(Liric_General_Error_String,"Liric_Command_Status:"
+					"Failed to get telemetry history over %.2f hours.",history_hours);
+				Liric_General_Error("command","liric_command.c","Liric_Command_Status",
+						     LOG_VERBOSITY_TERSE,"COMMAND");
+				if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to get telemetry history."))
+					return FALSE;
+				return TRUE;
+			}
+			/* the history won't fit in return_string, build the reply in telemetry_string instead */
+			sprintf(telemetry_string,"0 n=%d",returned_point_count);
+			for(i = 0; i < returned_point_count; i++)
+			{
+				Liric_General_Get_Time_String(telemetry_point_list[i].Timestamp,time_string,31);
+				sprintf(telemetry_string+strlen(telemetry_string)," %s,%.2f,%.2f,%.2f,%#04x",time_string,
+					telemetry_point_list[i].Sensor_Temperature_C,
+					telemetry_point_list[i].PCB_Temperature_C,
+					telemetry_point_list[i].TEC_Setpoint_C,telemetry_point_list[i].FPGA_Status);
+			}
+			free(telemetry_point_list);
+			retval = Liric_General_String_Builder_Add(reply_string,telemetry_string);
+			free(telemetry_string);
+			if(!retval)
+				return FALSE;
+#if LIRIC_DEBUG > 1
+			Liric_General_Log("command","liric_command.c","Liric_Command_Status",LOG_VERBOSITY_TERSE,
+					   "COMMAND","finished.");
+#endif
+			return TRUE;
+		}
+		Detector_Telemetry_Statistics_Get(&telemetry_period_ms,&telemetry_sample_count,
+						  &telemetry_failure_count);
+		sprintf(return_string+strlen(return_string),"running=%s period=%d samples=%u failures=%u",
+			Detector_Telemetry_Is_Running() ? "true" : "false",telemetry_period_ms,telemetry_sample_count,
+			telemetry_failure_count);
+	}
+	else if(strncmp(subsystem_string,"log",3) == 0)
+	{
+		retval = Liric_General_Log_Async_Statistics_Get(&log_written_count,&log_dropped_count);
+		sprintf(return_string+strlen(return_string),"async=%s written=%u dropped=%u",
+			retval ? "true" : "false",log_written_count,log_dropped_count);
+	}
+	else if(strncmp(subsystem_string,"serial",6) == 0)
+	{
+		if(!Detector_Serial_Statistics_Get(serial_statistics_list,DETECTOR_SERIAL_MAX_STATISTICS_COUNT,
+						   &serial_statistics_count))
+		{
+			Liric_General_Error_Number = 566;
+			sprintf(Liric_General_Error_String,"Liric_Command_Status:Failed to get serial statistics.");
+			Liric_General_Error("command","liric_command.c","Liric_Command_Status",
+					     LOG_VERBOSITY_TERSE,"COMMAND");
+			if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to get serial statistics."))
+				return FALSE;
+			return TRUE;
+		}
+		/* all the commands won't fit in return_string, build the reply in serial_string instead */
+		strcpy(serial_string,"0");
+		for(i = 0; i < serial_statistics_count; i++)
+		{
+			if(serial_statistics_list[i].Sub_Command_Byte != 0)
+			{
+				sprintf(serial_string+strlen(serial_string)," 0x%02x%02x",
+					serial_statistics_list[i].Command_Byte,serial_statistics_list[i].Sub_Command_Byte);
+			}
+			else
+			{
+				sprintf(serial_string+strlen(serial_string)," 0x%02x",
+					serial_statistics_list[i].Command_Byte);
+			}
+			sprintf(serial_string+strlen(serial_string),
+				":n=%u,fail=%u,timeout=%u,min=%.3f,mean=%.3f,max=%.3f,queue=%.3f",
+				serial_statistics_list[i].Count,serial_statistics_list[i].Failure_Count,
+				serial_statistics_list[i].Timeout_Count,serial_statistics_list[i].Min_Ms,
+				serial_statistics_list[i].Mean_Ms,serial_statistics_list[i].Max_Ms,
+				serial_statistics_list[i].Queue_Mean_Ms);
+		}
+		if(!Liric_General_String_Builder_Add(reply_string,serial_string))
+			return FALSE;
+#if LIRIC_DEBUG > 1
+		Liric_General_Log("command","liric_command.c","Liric_Command_Status",LOG_VERBOSITY_TERSE,
+				   "COMMAND","finished.");
+#endif
+		return TRUE;
+	}
+	else if(strncmp(subsystem_string,"server",6) == 0)
+	{
+		if(!Liric_Server_Statistics_Get(server_statistics_list,LIRIC_SERVER_MAX_COMMAND_COUNT,
+						&server_statistics_count,&server_unknown_count))
+		{
+			Liric_General_Error_Number = 577;
+			sprintf(Liric_General_Error_String,"Liric_Command_Status:Failed to get server statistics.");
+			Liric_General_Error("command","liric_command.c","Liric_Command_Status",
+					     LOG_VERBOSITY_TERSE,"COMMAND");
+			if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to get server statistics."))
+				return FALSE;
+			return TRUE;
+		}
+		/* all the commands won't fit in return_string, build the reply in server_string instead */
+		sprintf(server_string,"0 unknown=%u",server_unknown_count);
+		for(i = 0; i < server_statistics_count; i++)
+		{
+			sprintf(server_string+strlen(server_string),
+				" %s:n=%u,fail=%u,rejected=%u,min=%.3f,mean=%.3f,max=%.3f,hist=",
+				server_statistics_list[i].Keyword,server_statistics_list[i].Count,
+				server_statistics_list[i].Failure_Count,server_statistics_list[i].Rejected_Count,
+				server_statistics_list[i].Min_Ms,server_statistics_list[i].Mean_Ms,
+				server_statistics_list[i].Max_Ms);
+			for(bin = 0; bin < LIRIC_SERVER_HISTOGRAM_BIN_COUNT; bin++)
+			{
+				sprintf(server_string+strlen(server_string),"%s%u",(bin > 0) ? "/" : "",
+					server_statistics_list[i].Histogram[bin]);
+			}
+		}
+		if(!Liric_General_String_Builder_Add(reply_string,server_string))
+			return FALSE;
+#if LIRIC_DEBUG > 1
+		Liric_General_Log("command","liric_command.c","Liric_Command_Status",LOG_VERBOSITY_TERSE,
+				   "COMMAND","finished.");
+#endif
+		return TRUE;
+	}
+	else if(strncmp(subsystem_string,"startup",7) == 0)
+	{
+		Liric_State_Startup_Get(&startup);
+		if(!Liric_General_String_Builder_Add_Format(reply_string,"0 total=%.3f",startup.Total_Time_Ms))
+			return FALSE;
+		for(i = 0; i < startup.Phase_Count; i++)
+		{
+			if(!Liric_General_String_Builder_Add_Format(reply_string," %s:ok=%s,time=%.3f",
+								    startup.Phase_List[i].Name,
+								    startup.Phase_List[i].Success ? "true" : "false",
+								    startup.Phase_List[i].Time_Ms))
+				return FALSE;
+		}
+#if LIRIC_DEBUG > 1
+		Liric_General_Log("command","liric_command.c","Liric_Command_Status",LOG_VERBOSITY_TERSE,
+				   "COMMAND","finished.");
+#endif
+		return TRUE;
+	}
+	else if(strncmp(subsystem_string,"latency",7) == 0)
+	{
+		if(sscanf(command_string+command_string_index,"%31s",stage_name_string) == 1)
+		{
+			if(!Detector_Latency_Stage_From_Name(stage_name_string,&latency_stage))
+			{
+				Liric_General_Error_Number = 554;
+				sprintf(Liric_General_Error_String,"Liric_Command_Status:"
+					"Unknown latency stage %s.",stage_name_string);
+				Liric_General_Error("command","liric_command.c","Liric_Command_Status",
+						     LOG_VERBOSITY_TERSE,"COMMAND");
+#if LIRIC_DEBUG > 1
+				Liric_General_Log_Format("command","liric_command.c","Liric_Command_Status",
+							  LOG_VERBOSITY_TERSE,"COMMAND","Unknown latency stage %s.",
+							  stage_name_string);
+#endif
+				if(!Liric_General_String_Builder_Add(reply_string,"1 Unknown latency stage."))
+					return FALSE;
+				return TRUE;
+			}
+			if(!Detector_Latency_Stage_Statistics_Get(latency_stage,&latency_count,&minimum,&mean,&p95,
+								  &maximum))
+			{
+				Liric_General_Error_Number = 555;
+				sprintf(Liric_General_Error_String,"Liric_Command_Status:"
+					"Failed to get latency statistics for stage %s.",stage_name_string);
+				Liric_General_Error("command","liric_command.c","Liric_Command_Status",
+						     LOG_VERBOSITY_TERSE,"COMMAND");
+				if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to get latency statistics."))
+					return FALSE;
+				return TRUE;
+			}
+			sprintf(return_string+strlen(return_string),"count=%d min=%.3f mean=%.3f p95=%.3f max=%.3f",
+				latency_count,minimum,mean,p95,maximum);
+		}
+		else
+		{
+			/* all the stages won't fit in return_string, build the reply in latency_string instead */
+			strcpy(latency_string,"0");
+			for(latency_stage = DETECTOR_LATENCY_STAGE_NUDGEMATIC_MOVE;
+			    latency_stage < DETECTOR_LATENCY_STAGE_COUNT; latency_stage++)
+			{
+				if(!Detector_Latency_Stage_Statistics_Get(latency_stage,&latency_count,&minimum,&mean,
+									  &p95,&maximum))
+				{
+					Liric_General_Error_Number = 556;
+					sprintf(Liric_General_Error_String,"Liric_Command_Status:"
+						"Failed to get latency statistics for stage %d.",latency_stage);
+					Liric_General_Error("command","liric_command.c","Liric_Command_Status",
+							     LOG_VERBOSITY_TERSE,"COMMAND");
+					if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to get latency statistics."))
+						return FALSE;
+					return TRUE;
+				}
+				sprintf(latency_string+strlen(latency_string),
+					" %s:n=%d,min=%.3f,mean=%.3f,p95=%.3f,max=%.3f",
+					Detector_Latency_Stage_Name_Get(latency_stage),latency_count,minimum,mean,p95,
+					maximum);
+			}
+			if(!Liric_General_String_Builder_Add(reply_string,latency_string))
+				return FALSE;
+#if LIRIC_DEBUG > 1
+			Liric_General_Log("command","liric_command.c","Liric_Command_Status",LOG_VERBOSITY_TERSE,
+					   "COMMAND","finished.");
+#endif
+			return TRUE;
+		}
+	}
 	else
 	{
 		Liric_General_Error_Number = 516;
@@ -1639,12 +2403,12 @@ int Liric_Command_Status(char *command_string,char **reply_string)
 					  "COMMAND","Unknown subsystem %s:Failed to parse command %s.",
 					  subsystem_string,command_string);
 #endif
-		if(!Liric_General_Add_String(reply_string,"1 Failed to parse status command."))
+		if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to parse status command."))
 			return FALSE;
 		return TRUE;
 	}
 	/* success */
-	if(!Liric_General_Add_String(reply_string,return_string))
+	if(!Liric_General_String_Builder_Add(reply_string,return_string))
 		return FALSE;
 #if LIRIC_DEBUG > 1
 	Liric_General_Log("command","liric_command.c","Liric_Command_Status",LOG_VERBOSITY_TERSE,
@@ -1658,16 +2422,18 @@ int Liric_Command_Status(char *command_string,char **reply_string)
  * Note this will only take effect until the next Config/coadd exposure length change occurs,
  * as loading a new .fmt file will reset the target to that contained in the .fmt file.
  * @param command_string The command. This is not changed during this routine.
- * @param reply_string The address of a pointer to allocate and set the reply string.
+ * @param reply_string The string builder to build the reply string in.
  * @return The routine returns TRUE on success and FALSE on failure.
  * @see liric_general.html#Liric_General_Log
  * @see liric_general.html#Liric_General_Error_Number
  * @see liric_general.html#Liric_General_Error_String
- * @see liric_general.html#Liric_General_Add_String
- * @see liric_general.html#Liric_General_Add_Integer_To_String
+ * @see liric_general.html#Liric_General_String_Builder_Add
+ * @see liric_general.html#Liric_General_String_Builder_Add_Integer
  * @see ../detector/cdocs/detector_temperature.html#Detector_Temperature_Set_TEC_Setpoint
+ * @see ../detector/cdocs/detector_telemetry.html#Detector_Telemetry_Is_Running
+ * @see ../detector/cdocs/detector_telemetry.html#Detector_Telemetry_Sample_Request
  */
-int Liric_Command_Temperature(char *command_string,char **reply_string)
+int Liric_Command_Temperature(char *command_string,struct Liric_General_String_Builder_Struct *reply_string)
 {
 	int retval,parameter_index;
 	double target_temperature;
@@ -1689,7 +2455,7 @@ int Liric_Command_Temperature(char *command_string,char **reply_string)
 		Liric_General_Log("command","liric_command.c","Liric_Command_Temperature",
 				       LOG_VERBOSITY_TERSE,"COMMAND","finished (command parse failed).");
 #endif
-		if(!Liric_General_Add_String(reply_string,"1 Failed to parse temperature command."))
+		if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to parse temperature command."))
 			return FALSE;
 		return TRUE;
 	}
@@ -1709,10 +2475,13 @@ int Liric_Command_Temperature(char *command_string,char **reply_string)
 					 "Failed to set detector target temperature to %.2f C.",
 					 target_temperature);
 #endif
-		if(!Liric_General_Add_String(reply_string,"1 Failed to set detector target temperatur."))
+		if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to set detector target temperatur."))
 			return FALSE;
 		return TRUE;
 	}
+	/* get the telemetry sampler to pick up the new set-point now, rather than at the end of it's period */
+	if(Detector_Telemetry_Is_Running())
+		Detector_Telemetry_Sample_Request();
 #if LIRIC_DEBUG > 1
 	Liric_General_Log("command","liric_command.c","Liric_Command_Temperature",LOG_VERBOSITY_TERSE,
 			   "COMMAND","finished.");
@@ -1721,39 +2490,187 @@ int Liric_Command_Temperature(char *command_string,char **reply_string)
 }
 
 /**
- * On a change in coadd exposure length, the whole connection to xclib / the detector needs to be closed and
- * re-opened again: the library needs to read a different format '.fmt' file.
+ * Command to control the span event tracing: "trace <on|off|clear|dump <filename>>".
+ * <ul>
+ * <li>"trace on" and "trace off" start and stop recording span events, by calling Detector_Trace_Enable_Set.
+ * <li>"trace clear" discards the span events recorded so far, by calling Detector_Trace_Clear.
+ * <li>"trace dump &lt;filename&gt;" writes the recorded span events to the specified file as Chrome trace event
+ *     JSON, by calling Detector_Trace_Dump. The reply contains the number of events written. The filename must be a 
+ *     bare filename (no '/' or ".."), and the file is created in the directory specified by the 
+ *     "logging.trace.dump_directory" config item, so a client cannot overwrite an arbitrary file.
+ * </ul>
+ * @param command_string The command. This is not changed during this routine.
+ * @param reply_string The string builder to build the reply string in.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see liric_general.html#Liric_General_Log
+ * @see liric_general.html#Liric_General_Error_Number
+ * @see liric_general.html#Liric_General_Error_String
+ * @see liric_general.html#Liric_General_String_Builder_Add
+ * @see liric_general.html#Liric_General_String_Builder_Add_Integer
+ * @see liric_config.html#Liric_Config_Get_String
+ * @see ../detector/cdocs/detector_trace.html#Detector_Trace_Enable_Set
+ * @see ../detector/cdocs/detector_trace.html#Detector_Trace_Clear
+ * @see ../detector/cdocs/detector_trace.html#Detector_Trace_Dump
+ */
+int Liric_Command_Trace(char *command_string,struct Liric_General_String_Builder_Struct *reply_string)
+{
+	char operation_string[16];
+	char filename_string[256];
+	char dump_filename[512];
+	char *dump_directory_string = NULL;
+	int retval,event_count;
+
+#if LIRIC_DEBUG > 1
+	Liric_General_Log("command","liric_command.c","Liric_Command_Trace",LOG_VERBOSITY_TERSE,
+			   "COMMAND","started.");
+#endif
+	/* parse command */
+	retval = sscanf(command_string,"trace %15s %255s",operation_string,filename_string);
+	if(retval < 1)
+	{
+		Liric_General_Error_Number = 557;
+		sprintf(Liric_General_Error_String,"Liric_Command_Trace:"
+			"Failed to parse command %s (%d).",command_string,retval);
+		Liric_General_Error("command","liric_command.c","Liric_Command_Trace",
+				     LOG_VERBOSITY_TERSE,"COMMAND");
+		if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to parse trace command."))
+			return FALSE;
+		return TRUE;
+	}
+	if((strcmp(operation_string,"on") == 0)||(strcmp(operation_string,"off") == 0))
+	{
+		if(!Detector_Trace_Enable_Set(strcmp(operation_string,"on") == 0))
+		{
+			Liric_General_Error_Number = 558;
+			sprintf(Liric_General_Error_String,"Liric_Command_Trace:Failed to turn tracing %s.",
+				operation_string);
+			Liric_General_Error("command","liric_command.c","Liric_Command_Trace",
+					     LOG_VERBOSITY_TERSE,"COMMAND");
+			if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to set tracing."))
+				return FALSE;
+			return TRUE;
+		}
+		if(!Liric_General_String_Builder_Add(reply_string,"0 ok"))
+			return FALSE;
+	}
+	else if(strcmp(operation_string,"clear") == 0)
+	{
+		Detector_Trace_Clear();
+		if(!Liric_General_String_Builder_Add(reply_string,"0 ok"))
+			return FALSE;
+	}
+	else if((strcmp(operation_string,"dump") == 0)&&(retval == 2))
+	{
+		/* only allow a bare filename, created in the configured trace dump directory */
+		if((strchr(filename_string,'/') != NULL)||(strstr(filename_string,"..") != NULL))
+		{
+			Liric_General_Error_Number = 581;
+			sprintf(Liric_General_Error_String,"Liric_Command_Trace:Illegal trace dump filename '%s'.",
+				filename_string);
+			Liric_General_Error("command","liric_command.c","Liric_Command_Trace",
+					     LOG_VERBOSITY_TERSE,"COMMAND");
+			if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to dump trace:Illegal filename."))
+				return FALSE;
+			return TRUE;
+		}
+		if(!Liric_Config_Get_String("logging.trace.dump_directory",&dump_directory_string))
+		{
+			Liric_General_Error_Number = 582;
+			sprintf(Liric_General_Error_String,"Liric_Command_Trace:Failed to get trace dump directory.");
+			Liric_General_Error("command","liric_command.c","Liric_Command_Trace",
+					     LOG_VERBOSITY_TERSE,"COMMAND");
+			if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to dump trace:No dump directory."))
+				return FALSE;
+			return TRUE;
+		}
+		retval = snprintf(dump_filename,sizeof(dump_filename),"%s/%s",dump_directory_string,filename_string);
+		free(dump_directory_string);
+		if((retval < 0)||(retval >= (int)sizeof(dump_filename)))
+		{
+			Liric_General_Error_Number = 583;
+			sprintf(Liric_General_Error_String,"Liric_Command_Trace:Trace dump filename too long (%d).",retval);
+			Liric_General_Error("command","liric_command.c","Liric_Command_Trace",
+					     LOG_VERBOSITY_TERSE,"COMMAND");
+			if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to dump trace:Filename too long."))
+				return FALSE;
+			return TRUE;
+		}
+		if(!Detector_Trace_Dump(dump_filename,&event_count))
+		{
+			Liric_General_Error_Number = 559;
+			sprintf(Liric_General_Error_String,"Liric_Command_Trace:Failed to dump trace to '%s'.",
+				dump_filename);
+			Liric_General_Error("command","liric_command.c","Liric_Command_Trace",
+					     LOG_VERBOSITY_TERSE,"COMMAND");
+			if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to dump trace."))
+				return FALSE;
+			return TRUE;
+		}
+		if(!Liric_General_String_Builder_Add(reply_string,"0 "))
+			return FALSE;
+		if(!Liric_General_String_Builder_Add_Integer(reply_string,event_count))
+			return FALSE;
+		if(!Liric_General_String_Builder_Add(reply_string," events written to "))
+			return FALSE;
+		if(!Liric_General_String_Builder_Add(reply_string,dump_filename))
+			return FALSE;
+	}
+	else
+	{
+		Liric_General_Error_Number = 560;
+		sprintf(Liric_General_Error_String,"Liric_Command_Trace:"
+			"Unknown trace operation:Failed to parse command %s.",command_string);
+		Liric_General_Error("command","liric_command.c","Liric_Command_Trace",
+				     LOG_VERBOSITY_TERSE,"COMMAND");
+		if(!Liric_General_String_Builder_Add(reply_string,"1 Failed to parse trace command:Unknown operation."))
+			return FALSE;
+		return TRUE;
+	}
+#if LIRIC_DEBUG > 1
+	Liric_General_Log("command","liric_command.c","Liric_Command_Trace",LOG_VERBOSITY_TERSE,
+			   "COMMAND","finished.");
+#endif
+	return TRUE;
+}
+
+/**
+ * On a change in coadd exposure length, the detector needs to be switched to a different format '.fmt' file.
+ * This is done with Detector_Setup_Format_Switch, which only re-opens the frame grabber with the new format (and 
+ * does nothing if the new format is the same as the current one), rather than re-initialising the whole detector.
+ * The formats are preloaded at startup (Liric_Startup_Detector_Formats in liric_main.c). How long each switch
+ * takes is recorded in the "format_switch" latency stage, retrieved with "status latency format_switch".
  * <ul>
- * <li>We retrieve the "detector.enable" flag from config. If it is FALSE (detector not enabled) we just return from
+ * <li>We get a copy of the typed config cache (Liric_Config_Cache_Get), so the config values below are read without
+ *     any keyword lookups, and are consistent with each other across a config reload.
+ * <li>We check the "detector.enable" flag. If it is FALSE (detector not enabled) we just return from
  *     this routine successfully with a suitable log message.
- * <li>We construct a suitable config keyword ""detector.coadd_exposure_length." with the coadd_exposure_length_string
- *     argument appended.
- * <li>We retrieve a suitable config exposure length (in milliseconds) from the constructed keyword.
- * <li>We retrieve the detector format file directory from the "detector.format_dir" config item.
- * <li>We construct a suitable format_filename from the above information.
- * <li>We call Detector_Setup_Startup with the specified format_filename.
+ * <li>We find the coadd exposure length (in milliseconds) named coadd_exposure_length_string 
+ *     ("detector.coadd_exposure_length.&lt;name&gt;") in the cache.
+ * <li>We construct a suitable format_filename from the cached detector format file directory ("detector.format_dir")
+ *     and the coadd exposure length.
+ * <li>We call Detector_Setup_Format_Switch with the specified format_filename.
  * <li>We call Detector_Exposure_Set_Coadd_Frame_Exposure_Length so the detector exposure code knows what
  *     the new coadd exposure length is.
+ * <li>We call Liric_State_Exposure_Update to publish the new coadd exposure length.
  * </ul>
  * @param coadd_exposure_length_string A string representing the length of coadd exposure, should normally be
  *        one of "short" or "long".
  * @return The routine returns TRUE on success and FALSE on failure.
- * @see liric_config.html#Liric_Config_Get_Integer
- * @see liric_config.html#Liric_Config_Get_Boolean
- * @see liric_config.html#Liric_Config_Get_String
+ * @see liric_config.html#Liric_Config_Cache_Struct
+ * @see liric_config.html#Liric_Config_Cache_Get
  * @see liric_general.html#Liric_General_Error_Number
  * @see liric_general.html#Liric_General_Error_String
  * @see liric_general.html#Liric_General_Log
  * @see liric_general.html#Liric_General_Log_Format
- * @see ../detector/cdocs/detector_setup.html#Detector_Setup_Startup
+ * @see ../detector/cdocs/detector_setup.html#Detector_Setup_Format_Switch
  * @see ../detector/cdocs/detector_exposure.html#Detector_Exposure_Set_Coadd_Frame_Exposure_Length
+ * @see liric_state.html#Liric_State_Exposure_Update
  */
 int Liric_Command_Initialise_Detector(char *coadd_exposure_length_string)
 {
-	int enabled,coadd_exposure_length;
-	char format_filename[256];
-	char keyword_string[64];
-	char* format_dir_string = NULL;
+	struct Liric_Config_Cache_Struct config_cache;
+	int i,coadd_exposure_length;
+	char format_filename[LIRIC_CONFIG_FORMAT_DIR_LENGTH+32];
 	
 	if(coadd_exposure_length_string == NULL)
 	{
@@ -1769,15 +2686,9 @@ int Liric_Command_Initialise_Detector(char *coadd_exposure_length_string)
 	/* do we want to initialise the detector.
 	** The C layer always has a detector attached, but if it is unplugged/broken, setting "detector.enable" to FALSE
 	** allows the C layer to initialise to enable control of other mechanisms from the C layer. */
-	if(!Liric_Config_Get_Boolean("detector.enable",&enabled))
-	{
-		Liric_General_Error_Number = 535;
-		sprintf(Liric_General_Error_String,"Liric_Command_Initialise_Detector:"
-			"Failed to get whether the detector is enabled for initialisation.");
-		return FALSE;
-	}
+	Liric_Config_Cache_Get(&config_cache);
 	/* if we don't want to initialise the detector, just return here. */
-	if(enabled == FALSE)
+	if(config_cache.Detector_Enable == FALSE)
 	{
 #if LIRIC_DEBUG > 1
 		Liric_General_Log("command","liric_command.c","Liric_Command_Initialise_Detector",
@@ -1785,38 +2696,33 @@ int Liric_Command_Initialise_Detector(char *coadd_exposure_length_string)
 #endif
 		return TRUE;
 	}
-	/* get the coadd exposure length from the passed in string, via the config. */
-	sprintf(keyword_string,"detector.coadd_exposure_length.%s",coadd_exposure_length_string);
-	if(!Liric_Config_Get_Integer(keyword_string,&coadd_exposure_length))
+	/* get the coadd exposure length from the passed in string, via the config cache. */
+	coadd_exposure_length = -1;
+	for(i = 0; i < config_cache.Coadd_Exposure_Length_Count; i++)
 	{
-		Liric_General_Error_Number = 536;
-		sprintf(Liric_General_Error_String,
-			"Liric_Command_Initialise_Detector:Failed to get coadd exposure length for keyword '%s'.",
-			keyword_string);
-		return FALSE;
+		if(strcmp(config_cache.Coadd_Exposure_Length_List[i].Name,coadd_exposure_length_string) == 0)
+			coadd_exposure_length = config_cache.Coadd_Exposure_Length_List[i].Length;
 	}
-	/* get the '.fmt' format directory from config */
-	if(!Liric_Config_Get_String("detector.format_dir",&format_dir_string))
+	if(coadd_exposure_length < 0)
 	{
-		Liric_General_Error_Number = 537;
+		Liric_General_Error_Number = 536;
 		sprintf(Liric_General_Error_String,
-			"Liric_Command_Initialise_Detector:Failed to get detector format directory.");
+			"Liric_Command_Initialise_Detector:No coadd exposure length configured for '%.32s'.",
+			coadd_exposure_length_string);
 		return FALSE;
 	}
-	sprintf(format_filename,"%s/rap_%dms.fmt",format_dir_string,coadd_exposure_length);	
-	if(format_dir_string != NULL)
-		free(format_dir_string);
+	sprintf(format_filename,"%s/rap_%dms.fmt",config_cache.Detector_Format_Dir,coadd_exposure_length);
 	/* actually do initialisation of the detector library */
 #if LIRIC_DEBUG > 1
 	Liric_General_Log_Format("command","liric_command.c","Liric_Command_Initialise_Detector",LOG_VERBOSITY_TERSE,
-				  "COMMAND","Calling Detector_Setup_Startup with format filename '%s'.",
+				  "COMMAND","Calling Detector_Setup_Format_Switch with format filename '%s'.",
 				  format_filename);
 #endif
-	if(!Detector_Setup_Startup(format_filename))
+	if(!Detector_Setup_Format_Switch(format_filename))
 	{
 		Liric_General_Error_Number = 538;
 		sprintf(Liric_General_Error_String,
-			"Liric_Command_Initialise_Detector:Detector_Setup_Startup failed.");
+			"Liric_Command_Initialise_Detector:Detector_Setup_Format_Switch failed.");
 		return FALSE;
 	}
 	/* setup coadd exposure length */
@@ -1827,6 +2733,8 @@ int Liric_Command_Initialise_Detector(char *coadd_exposure_length_string)
 			"Liric_Command_Initialise_Detector:Detector_Exposure_Set_Coadd_Frame_Exposure_Length failed.");
 		return FALSE;
 	}
+	/* publish the new coadd exposure length */
+	Liric_State_Exposure_Update(FALSE);
 #if LIRIC_DEBUG > 1
 	Liric_General_Log("command","liric_command.c","Liric_Command_Initialise_Detector",LOG_VERBOSITY_TERSE,
 			   "COMMAND","finished.");
@@ -1933,3 +2841,280 @@ static int Command_Parse_Date(char *time_string,int *time_secs)
 	}
 	return TRUE;
 }
+
+/**
+ * Get the telemetry sampler's latest sample, if the sampler is running and the field we are interested in
+ * was read successfully. This lets status commands avoid querying the camera head over the serial link.
+ * @param valid_bit Which DETECTOR_TELEMETRY_VALID_* bit must be set in the sample's Valid_Mask.
+ * @param sample The address of a sample structure, on a successful return filled in with the latest sample.
+ * @return The routine returns TRUE if the sample was retrieved and the requested field is valid, and FALSE
+ *         otherwise, in which case the caller should query the camera head directly.
+ * @see ../detector/cdocs/detector_telemetry.html#Detector_Telemetry_Is_Running
+ * @see ../detector/cdocs/detector_telemetry.html#Detector_Telemetry_Latest_Get
+ */
+static int Command_Telemetry_Sample_Get(int valid_bit,struct Detector_Telemetry_Sample_Struct *sample)
+{
+	if(!Detector_Telemetry_Is_Running())
+		return FALSE;
+	if(!Detector_Telemetry_Latest_Get(sample,NULL))
+		return FALSE;
+	return ((sample->Valid_Mask & valid_bit) != 0);
+}
+
+/**
+ * Get the filter wheel position from a snapshot of the published state. If the position has not been published
+ * (no move has been made since startup, or the last move failed), we read it from the filter wheel, and publish it
+ * (and update the snapshot) so later status commands do not need to.
+ * @param state The address of a snapshot of the published state, from Liric_State_Get.
+ * @param position The address of an integer, on a successful return filled in with the filter wheel position
+ *        (0 if it is moving).
+ * @return The routine returns TRUE on success, and FALSE if the position could not be read.
+ * @see liric_state.html#Liric_State_Filter_Wheel_Set
+ * @see ../filter_wheel/cdocs/filter_wheel_command.html#Filter_Wheel_Command_Get_Position
+ */
+static int Command_State_Filter_Wheel_Get(struct Liric_State_Struct *state,int *position)
+{
+	if(!state->Filter_Wheel_Valid)
+	{
+		if(!Filter_Wheel_Command_Get_Position(&(state->Filter_Wheel_Position)))
+			return FALSE;
+		/* don't cache a position read mid-move, as we won't be told when the move finishes */
+		if(state->Filter_Wheel_Position != 0)
+		{
+			state->Filter_Wheel_Valid = TRUE;
+			Liric_State_Filter_Wheel_Set(TRUE,state->Filter_Wheel_Position);
+		}
+	}
+	(*position) = state->Filter_Wheel_Position;
+	return TRUE;
+}
+
+/**
+ * Get the nudgematic position from a snapshot of the published state. If the position has not been published
+ * (no move has been made since startup, or the last move failed), we read it from the nudgematic, and publish it
+ * (and update the snapshot) so later status commands do not need to.
+ * @param state The address of a snapshot of the published state, from Liric_State_Get.
+ * @param position The address of an integer, on a successful return filled in with the nudgematic position
+ *        (-1 if it is moving).
+ * @return The routine returns TRUE on success, and FALSE if the position could not be read.
+ * @see liric_state.html#Liric_State_Nudgematic_Set
+ * @see ../nudgematic/cdocs/nudgematic_command.html#Nudgematic_Command_Position_Get
+ */
+static int Command_State_Nudgematic_Get(struct Liric_State_Struct *state,int *position)
+{
+	if(!state->Nudgematic_Valid)
+	{
+		if(!Nudgematic_Command_Position_Get(&(state->Nudgematic_Position)))
+			return FALSE;
+		/* don't cache a position read mid-move, as we won't be told when the move finishes */
+		if(state->Nudgematic_Position != -1)
+		{
+			state->Nudgematic_Valid = TRUE;
+			Liric_State_Nudgematic_Set(TRUE,state->Nudgematic_Position);
+		}
+	}
+	(*position) = state->Nudgematic_Position;
+	return TRUE;
+}
+
+/**
+ * Build the reply to a "status all" command. This is a snapshot of all the status fields GET_STATUS needs,
+ * returned in one reply so the Java layer does not have to make a connection per field. 
+ * The reply is of the form "0 &lt;key&gt;=&lt;value&gt; &lt;key&gt;=&lt;value&gt; ...", with the following keys:
+ * <ul>
+ * <li><b>filterwheel.filter, filterwheel.position, filterwheel.status</b> As "status filterwheel ...".
+ * <li><b>nudgematic.position, nudgematic.status, nudgematic.offsetsize</b> As "status nudgematic ...".
+ * <li><b>temperature, temperature.time</b> As "status temperature get".
+ * <li><b>exposure.status, exposure.count, exposure.length, exposure.start_time, exposure.index, 
+ *     exposure.coadd_count, exposure.coadd_length, exposure.multrun, exposure.run</b> As "status exposure ...".
+ * </ul>
+ * Values never contain spaces: times are of the form '2020-04-15T13:59:59.123+0000'. If a mechanism or the
+ * detector temperature cannot be read, its keys have the value "error" and the rest of the snapshot is still
+ * returned. The reply is built from one snapshot of the published instrument state (Liric_State_Get), so the fields
+ * are consistent with each other and no hardware I/O is needed. The mechanisms are only read from the hardware if
+ * their position has not been published yet (see Command_State_Filter_Wheel_Get), and the temperature is only read
+ * from the camera head if the telemetry sampler is not running.
+ * @param reply_string The string builder to build the reply string in.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #STATUS_ALL_STRING_LENGTH
+ * @see #Command_State_Filter_Wheel_Get
+ * @see #Command_State_Nudgematic_Get
+ * @see #Command_Status_All_Time_Add
+ * @see liric_state.html#Liric_State_Get
+ * @see liric_config.html#Liric_Config_Filter_Wheel_Is_Enabled
+ * @see liric_config.html#Liric_Config_Nudgematic_Is_Enabled
+ * @see liric_general.html#Liric_General_Error_Number
+ * @see liric_general.html#Liric_General_Error_String
+ * @see liric_general.html#Liric_General_Error
+ * @see liric_general.html#Liric_General_String_Builder_Add
+ * @see ../detector/cdocs/detector_telemetry.html#Detector_Telemetry_Is_Running
+ * @see ../detector/cdocs/detector_temperature.html#Detector_Temperature_Get
+ * @see ../filter_wheel/cdocs/filter_wheel_config.html#Filter_Wheel_Config_Position_To_Name
+ * @see ../nudgematic/cdocs/nudgematic_command.html#Nudgematic_Command_Offset_Size_Get
+ */
+static int Command_Status_All(struct Liric_General_String_Builder_Struct *reply_string)
+{
+	NUDGEMATIC_OFFSET_SIZE_T offset_size;
+	struct Liric_State_Struct state;
+	struct timespec temperature_time;
+	char status_string[STATUS_ALL_STRING_LENGTH];
+	char filter_name_string[32];
+	double temperature;
+	int filter_wheel_position,nudgematic_position,count,index;
+
+	strcpy(status_string,"0");
+	/* take one snapshot of the published state, and build the whole reply from it */
+	Liric_State_Get(&state);
+	/* filter wheel */
+	if(Liric_Config_Filter_Wheel_Is_Enabled())
+	{
+		if(!Command_State_Filter_Wheel_Get(&state,&filter_wheel_position))
+		{
+			Liric_General_Error_Number = 567;
+			sprintf(Liric_General_Error_String,"Command_Status_All:Failed to get filter wheel position.");
+			Liric_General_Error("command","liric_command.c","Command_Status_All",LOG_VERBOSITY_TERSE,
+					     "COMMAND");
+			filter_wheel_position = -1;
+		}
+	}
+	else
+	{
+		/* we pretend the filter wheel is moving when it is not enabled */
+		filter_wheel_position = 0;
+	}
+	if(filter_wheel_position < 0)
+	{
+		strcat(status_string," filterwheel.filter=error filterwheel.position=error filterwheel.status=error");
+	}
+	else if(filter_wheel_position == 0) /* moving */
+	{
+		strcat(status_string," filterwheel.filter=moving filterwheel.position=0 filterwheel.status=moving");
+	}
+	else
+	{
+		if(Filter_Wheel_Config_Position_To_Name(filter_wheel_position,filter_name_string))
+		{
+			sprintf(status_string+strlen(status_string)," filterwheel.filter=%s",filter_name_string);
+		}
+		else
+		{
+			Liric_General_Error_Number = 568;
+			sprintf(Liric_General_Error_String,"Command_Status_All:"
+				"Failed to get filter wheel filter name from position %d.",filter_wheel_position);
+			Liric_General_Error("command","liric_command.c","Command_Status_All",LOG_VERBOSITY_TERSE,
+					     "COMMAND");
+			strcat(status_string," filterwheel.filter=error");
+		}
+		sprintf(status_string+strlen(status_string)," filterwheel.position=%d filterwheel.status=in_position",
+			filter_wheel_position);
+	}
+	/* nudgematic */
+	if(Liric_Config_Nudgematic_Is_Enabled())
+	{
+		if(Command_State_Nudgematic_Get(&state,&nudgematic_position))
+		{
+			sprintf(status_string+strlen(status_string)," nudgematic.position=%d nudgematic.status=%s",
+				nudgematic_position,(nudgematic_position == -1) ? "moving" : "stopped");
+		}
+		else
+		{
+			Liric_General_Error_Number = 569;
+			sprintf(Liric_General_Error_String,"Command_Status_All:Failed to get nudgematic position.");
+			Liric_General_Error("command","liric_command.c","Command_Status_All",LOG_VERBOSITY_TERSE,
+					     "COMMAND");
+			strcat(status_string," nudgematic.position=error nudgematic.status=error");
+		}
+		Nudgematic_Command_Offset_Size_Get(&offset_size);
+		if(offset_size == OFFSET_SIZE_NONE)
+			strcat(status_string," nudgematic.offsetsize=none");
+		else if(offset_size == OFFSET_SIZE_SMALL)
+			strcat(status_string," nudgematic.offsetsize=small");
+		else if(offset_size == OFFSET_SIZE_LARGE)
+			strcat(status_string," nudgematic.offsetsize=large");
+		else
+			strcat(status_string," nudgematic.offsetsize=UNKNOWN");
+	}
+	else
+	{
+		strcat(status_string," nudgematic.position=-1 nudgematic.status=stopped nudgematic.offsetsize=UNKNOWN");
+	}
+	/* detector temperature */
+	if(state.Temperature_Valid && Detector_Telemetry_Is_Running())
+	{
+		temperature = state.Temperature_C;
+		temperature_time = state.Temperature_Time;
+		sprintf(status_string+strlen(status_string)," temperature=%.2f",temperature);
+		Command_Status_All_Time_Add(status_string,"temperature.time",temperature_time);
+	}
+	else if(Detector_Temperature_Get(&temperature))
+	{
+		clock_gettime(CLOCK_REALTIME,&temperature_time);
+		sprintf(status_string+strlen(status_string)," temperature=%.2f",temperature);
+		Command_Status_All_Time_Add(status_string,"temperature.time",temperature_time);
+	}
+	else
+	{
+		Liric_General_Error_Number = 570;
+		sprintf(Liric_General_Error_String,"Command_Status_All:Failed to get temperature.");
+		Liric_General_Error("command","liric_command.c","Command_Status_All",LOG_VERBOSITY_TERSE,"COMMAND");
+		strcat(status_string," temperature=error temperature.time=error");
+	}
+	/* exposure status */
+	if(state.Sequence_In_Progress)
+	{
+		count = state.Sequence_Count;
+		index = state.Sequence_Index;
+	}
+	else
+	{
+		count = 0;
+		index = 0;
+	}
+	sprintf(status_string+strlen(status_string),
+		" exposure.status=%s exposure.count=%d exposure.length=%d exposure.index=%d"
+		" exposure.coadd_count=%d exposure.coadd_length=%d exposure.multrun=%d exposure.run=%d",
+		state.Exposure_In_Progress ? "true" : "false",count,state.Exposure_Length_Ms,index,state.Coadd_Count,
+		state.Coadd_Frame_Exposure_Length_Ms,state.Multrun_Number,state.Run_Number);
+	Command_Status_All_Time_Add(status_string,"exposure.start_time",state.Exposure_Start_Time);
+	if(!Liric_General_String_Builder_Add(reply_string,status_string))
+		return FALSE;
+#if LIRIC_DEBUG > 1
+	Liric_General_Log("command","liric_command.c","Command_Status_All",LOG_VERBOSITY_TERSE,"COMMAND",
+			   "finished.");
+#endif
+	return TRUE;
+}
+
+/**
+ * Append a " &lt;key&gt;=&lt;time&gt;" pair to a "status all" reply. The time is formatted by 
+ * Command_Time_String_Get, so the value contains no spaces, i.e. '2020-04-15T13:59:59.123+0000'.
+ * @param status_string The reply string to append to.
+ * @param key_string The key.
+ * @param timestamp The time to append.
+ * @see #Command_Time_String_Get
+ */
+static void Command_Status_All_Time_Add(char *status_string,char *key_string,struct timespec timestamp)
+{
+	char time_string[32];
+
+	Command_Time_String_Get(timestamp,time_string,31);
+	sprintf(status_string+strlen(status_string)," %s=%s",key_string,time_string);
+}
+
+/**
+ * Format a timestamp as a string without spaces, of the form '2020-04-15T13:59:59.123+0000', so it can be
+ * used as one token in a reply.
+ * @param timestamp The timestamp to format.
+ * @param time_string The string to fill in with the formatted time.
+ * @param string_length The length of time_string.
+ * @see liric_general.html#Liric_General_Get_Time_String
+ */
+static void Command_Time_String_Get(struct timespec timestamp,char *time_string,int string_length)
+{
+	char *space_ptr = NULL;
+
+	Liric_General_Get_Time_String(timestamp,time_string,string_length);
+	space_ptr = strchr(time_string,' ');
+	if(space_ptr != NULL)
+		memmove(space_ptr,space_ptr+1,strlen(space_ptr+1)+1);
+}
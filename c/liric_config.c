@@ -3,7 +3,11 @@
 */
 /**
  * Config routines for liric.
- * Just a a wrapper  for the eSTAR_Config routines at the moment.
+ * Mostly a wrapper for the eSTAR_Config routines. The values read on hot paths are also parsed once, when the 
+ * config is loaded, into a typed cache (Liric_Config_Cache_Struct) published under a sequence lock. 
+ * The config file can be reloaded whilst liric is running (Liric_Config_Reload), either by the "config reload"
+ * command or when a watcher thread (Liric_Config_Watch_Start) sees the file change. A reload parses and 
+ * validates the new file before swapping it in, so a bad edit leaves the current config in place.
  * @author Chris Mottram
  * @version $Revision$
  */
@@ -16,10 +20,15 @@
  */
 #define _POSIX_C_SOURCE 199309L
 
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <sys/inotify.h>
 #include "estar_config.h"
 #include "log_udp.h"
 #include "liric_general.h"
@@ -27,7 +36,50 @@
 
 #include "filter_wheel_config.h"
 
+/* hash defines */
+/**
+ * The maximum length of the config filename.
+ */
+#define CONFIG_FILENAME_LENGTH		(256)
+/**
+ * How often the config watch thread checks whether it has been asked to stop, in milliseconds.
+ */
+#define CONFIG_WATCH_POLL_MS		(500)
+/**
+ * The length of the buffer the config watch thread reads inotify events into.
+ */
+#define CONFIG_WATCH_EVENT_BUFFER_LENGTH	(4096)
+
 /* data types */
+/**
+ * Data type holding local data to liric_config:
+ * <dl>
+ * <dt>Properties_Mutex</dt> <dd>Mutex held whilst Config_Properties is read, or swapped by a reload.</dd>
+ * <dt>Reload_Mutex</dt> <dd>Mutex held whilst the config is being (re)loaded, so only one reload happens 
+ *     at once.</dd>
+ * <dt>Filename</dt> <dd>The config filename last loaded, which Liric_Config_Reload reloads.</dd>
+ * <dt>Cache_Sequence</dt> <dd>The sequence lock counter of Cache. Odd whilst a reload is changing it.</dd>
+ * <dt>Cache</dt> <dd>The typed values parsed from the config file.</dd>
+ * <dt>Watch_Fd</dt> <dd>The inotify file descriptor used by the config watch thread, or -1.</dd>
+ * <dt>Watch_Thread</dt> <dd>The config watch thread.</dd>
+ * <dt>Watch_Run</dt> <dd>A boolean, the config watch thread runs whilst this is TRUE.</dd>
+ * <dt>Watch_Thread_Started</dt> <dd>A boolean, TRUE if the config watch thread has been started.</dd>
+ * </dl>
+ * @see liric_config.html#Liric_Config_Cache_Struct
+ */
+struct Config_Struct
+{
+	pthread_mutex_t Properties_Mutex;
+	pthread_mutex_t Reload_Mutex;
+	char Filename[CONFIG_FILENAME_LENGTH];
+	volatile unsigned int Cache_Sequence;
+	struct Liric_Config_Cache_Struct Cache;
+	int Watch_Fd;
+	pthread_t Watch_Thread;
+	volatile int Watch_Run;
+	int Watch_Thread_Started;
+};
+
 /* internal data */
 /**
  * Revision Control System identifier.
@@ -38,6 +90,31 @@ static char rcsid[] = "$Id$";
  * @see ../../estar/config/estar_config.html#eSTAR_Config_Properties_t
  */
 static eSTAR_Config_Properties_t Config_Properties;
+/**
+ * The instance of Config_Struct that contains local data for this module. This is initialised as follows:
+ * <dl>
+ * <dt>Properties_Mutex</dt> <dd>PTHREAD_MUTEX_INITIALIZER</dd>
+ * <dt>Reload_Mutex</dt> <dd>PTHREAD_MUTEX_INITIALIZER</dd>
+ * <dt>Filename</dt> <dd>""</dd>
+ * <dt>Cache_Sequence</dt> <dd>0</dd>
+ * <dt>Cache</dt> <dd>All zero/FALSE, generation 0 (not loaded).</dd>
+ * <dt>Watch_Fd</dt> <dd>-1</dd>
+ * <dt>Watch_Thread</dt> <dd>0</dd>
+ * <dt>Watch_Run</dt> <dd>FALSE</dd>
+ * <dt>Watch_Thread_Started</dt> <dd>FALSE</dd>
+ * </dl>
+ * @see #Config_Struct
+ */
+static struct Config_Struct Config_Data = 
+{
+	PTHREAD_MUTEX_INITIALIZER,PTHREAD_MUTEX_INITIALIZER,"",0,{0,FALSE,FALSE,FALSE,FALSE,FALSE,0,0},-1,0,FALSE,FALSE
+};
+
+/* internal functions */
+static int Config_Cache_Parse(eSTAR_Config_Properties_t *properties,struct Liric_Config_Cache_Struct *cache);
+static void Config_Cache_Publish(struct Liric_Config_Cache_Struct *cache);
+static int Config_Filename_Set(char *filename);
+static void *Config_Watch_Thread(void *user_arg);
 
 /* ----------------------------------------------------------------------------
 ** 		external functions 
@@ -45,14 +122,21 @@ static eSTAR_Config_Properties_t Config_Properties;
 /**
  * Load the configuration file. 
  * <ul>
+ * <li>We save the filename (Config_Filename_Set), so Liric_Config_Reload can reload it.
  * <li>Calls eSTAR_Config_Parse_File with the specified filename.
  * <li>We call Filter_Wheel_Config_Initialise to load the filter configuration
  *     into the filter wheel library. We do this even if the filter wheel is not enabled, as the
  *     filter wheel name -> Id mapping is used for FITS header generation.
+ * <li>We parse and validate the typed config values (Config_Cache_Parse), and publish them 
+ *     (Config_Cache_Publish).
  * </ul>
  * @param filename The filename to load from.
  * @return The routine returns TRUE on sucess, FALSE on failure.
  * @see #Config_Properties
+ * @see #Config_Filename_Set
+ * @see #Config_Cache_Parse
+ * @see #Config_Cache_Publish
+ * @see #Config_Data
  * @see #Liric_Config_Get_Boolean
  * @see liric_general.html#Liric_General_Log_Format
  * @see liric_general.html#Liric_General_Log
@@ -63,6 +147,7 @@ static eSTAR_Config_Properties_t Config_Properties;
  */
 int Liric_Config_Load(char *filename)
 {
+	struct Liric_Config_Cache_Struct cache;
 	int retval,filter_wheel_enabled;
 
 	if(filename == NULL)
@@ -75,6 +160,8 @@ int Liric_Config_Load(char *filename)
 	Liric_General_Log_Format("liric","liric_config.c","Liric_Config_Load",LOG_VERBOSITY_INTERMEDIATE,NULL,
 				  "started(%s).",filename);
 #endif
+	if(!Config_Filename_Set(filename))
+		return FALSE;
 	retval = eSTAR_Config_Parse_File(filename,&Config_Properties);
 	if(retval == FALSE)
 	{
@@ -94,6 +181,9 @@ int Liric_Config_Load(char *filename)
 			"Failed to initialise filter wheel configuration.");
 		return FALSE;
 	}
+	if(!Config_Cache_Parse(&Config_Properties,&cache))
+		return FALSE;
+	Config_Cache_Publish(&cache);
 #if LIRIC_DEBUG > 1
 	Liric_General_Log_Format("liric","liric_config.c","Liric_Config_Load",LOG_VERBOSITY_INTERMEDIATE,NULL,
 				  "(%s) returned %d.",filename,retval);
@@ -101,10 +191,80 @@ int Liric_Config_Load(char *filename)
 	return retval;
 }
 
+/**
+ * Reload the config file last loaded by Liric_Config_Load, whilst liric is running.
+ * <ul>
+ * <li>We lock Config_Data.Reload_Mutex, so only one reload happens at once.
+ * <li>We parse the config file into a new set of properties using eSTAR_Config_Parse_File.
+ * <li>We parse and validate the typed config values from the new properties (Config_Cache_Parse). If this fails
+ *     we destroy the new properties and leave the current config in place.
+ * <li>We swap the new properties in (under Config_Data.Properties_Mutex), and destroy the old ones.
+ * <li>We publish the new typed values (Config_Cache_Publish).
+ * </ul>
+ * Values that are only read when liric starts (i.e. logging, the server port, the detector and mechanism setup,
+ * and the filter wheel filter names) still need a restart to change.
+ * @return The routine returns TRUE on sucess, FALSE on failure.
+ * @see #Config_Data
+ * @see #Config_Properties
+ * @see #Config_Cache_Parse
+ * @see #Config_Cache_Publish
+ * @see liric_general.html#Liric_General_Log_Format
+ * @see liric_general.html#Liric_General_Error_Number
+ * @see liric_general.html#Liric_General_Error_String
+ * @see ../../estar/config/estar_config.html#eSTAR_Config_Parse_File
+ * @see ../../estar/config/estar_config.html#eSTAR_Config_Destroy_Properties
+ */
+int Liric_Config_Reload(void)
+{
+	eSTAR_Config_Properties_t new_properties,old_properties;
+	struct Liric_Config_Cache_Struct cache;
+
+	pthread_mutex_lock(&(Config_Data.Reload_Mutex));
+	if(strlen(Config_Data.Filename) == 0)
+	{
+		pthread_mutex_unlock(&(Config_Data.Reload_Mutex));
+		Liric_General_Error_Number = 314;
+		sprintf(Liric_General_Error_String,"Liric_Config_Reload:No config file has been loaded.");
+		return FALSE;
+	}
+#if LIRIC_DEBUG > 1
+	Liric_General_Log_Format("liric","liric_config.c","Liric_Config_Reload",LOG_VERBOSITY_INTERMEDIATE,NULL,
+				  "started(%s).",Config_Data.Filename);
+#endif
+	memset(&new_properties,0,sizeof(eSTAR_Config_Properties_t));
+	if(!eSTAR_Config_Parse_File(Config_Data.Filename,&new_properties))
+	{
+		pthread_mutex_unlock(&(Config_Data.Reload_Mutex));
+		Liric_General_Error_Number = 315;
+		sprintf(Liric_General_Error_String,"Liric_Config_Reload(%s) failed:",Config_Data.Filename);
+		eSTAR_Config_Error_To_String(Liric_General_Error_String+strlen(Liric_General_Error_String));
+		return FALSE;
+	}
+	if(!Config_Cache_Parse(&new_properties,&cache))
+	{
+		eSTAR_Config_Destroy_Properties(&new_properties);
+		pthread_mutex_unlock(&(Config_Data.Reload_Mutex));
+		return FALSE;
+	}
+	pthread_mutex_lock(&(Config_Data.Properties_Mutex));
+	old_properties = Config_Properties;
+	Config_Properties = new_properties;
+	pthread_mutex_unlock(&(Config_Data.Properties_Mutex));
+	eSTAR_Config_Destroy_Properties(&old_properties);
+	Config_Cache_Publish(&cache);
+	pthread_mutex_unlock(&(Config_Data.Reload_Mutex));
+#if LIRIC_DEBUG > 1
+	Liric_General_Log_Format("liric","liric_config.c","Liric_Config_Reload",LOG_VERBOSITY_INTERMEDIATE,NULL,
+				  "finished(%s).",Config_Data.Filename);
+#endif
+	return TRUE;
+}
+
 /**
  * Shutdown anything associated with config. Calls eSTAR_Config_Destroy_Properties.
  * @see ../../../estar/config/estar_config.html#eSTAR_Config_Destroy_Properties
  * @see #Config_Properties
+ * @see #Config_Data
  */
 int Liric_Config_Shutdown(void)
 {
@@ -114,13 +274,137 @@ int Liric_Config_Shutdown(void)
 	Liric_General_Log("liric","liric_config.c","Liric_Config_Shutdown",LOG_VERBOSITY_VERBOSE,NULL,
 			"started: About to call eSTAR_Config_Destroy_Properties.");
 #endif
+	pthread_mutex_lock(&(Config_Data.Properties_Mutex));
 	eSTAR_Config_Destroy_Properties(&Config_Properties);
+	pthread_mutex_unlock(&(Config_Data.Properties_Mutex));
 #if LIRIC_DEBUG > 1
 	Liric_General_Log("liric","liric_config.c","Liric_Config_Shutdown",LOG_VERBOSITY_VERBOSE,NULL,"finished.");
 #endif
 	return retval;
 }
 
+/**
+ * Get a consistent copy of the typed config values. This never blocks: if a reload is publishing new values
+ * whilst we are copying them, we retry.
+ * @param cache The address of a structure, on return filled in with the typed config values.
+ * @see #Config_Data
+ */
+void Liric_Config_Cache_Get(struct Liric_Config_Cache_Struct *cache)
+{
+	unsigned int start_sequence,end_sequence;
+
+	do
+	{
+		start_sequence = Config_Data.Cache_Sequence;
+		if(start_sequence & 1)
+		{
+			/* a reload is publishing, let it finish */
+			sched_yield();
+			end_sequence = start_sequence+1;
+			continue;
+		}
+		__sync_synchronize();
+		memcpy(cache,&(Config_Data.Cache),sizeof(struct Liric_Config_Cache_Struct));
+		__sync_synchronize();
+		end_sequence = Config_Data.Cache_Sequence;
+	}
+	while(start_sequence != end_sequence);
+}
+
+/**
+ * Start a thread that reloads the config file (Liric_Config_Reload) whenever it changes. We watch the directory
+ * containing the config file with inotify, for files being closed after writing or moved into the directory,
+ * so both editors that rewrite the file in place and those that save a new file and rename it are seen.
+ * @return The routine returns TRUE on sucess, FALSE on failure.
+ * @see #Config_Data
+ * @see #Config_Watch_Thread
+ * @see liric_general.html#Liric_General_Error_Number
+ * @see liric_general.html#Liric_General_Error_String
+ */
+int Liric_Config_Watch_Start(void)
+{
+	char directory_name[CONFIG_FILENAME_LENGTH];
+	char *ch = NULL;
+	int retval;
+
+	if(Config_Data.Watch_Thread_Started)
+		return TRUE;
+	if(strlen(Config_Data.Filename) == 0)
+	{
+		Liric_General_Error_Number = 316;
+		sprintf(Liric_General_Error_String,"Liric_Config_Watch_Start:No config file has been loaded.");
+		return FALSE;
+	}
+	strcpy(directory_name,Config_Data.Filename);
+	ch = strrchr(directory_name,'/');
+	if(ch == NULL)
+		strcpy(directory_name,".");
+	else if(ch == directory_name)
+		directory_name[1] = '\0';
+	else
+		(*ch) = '\0';
+	Config_Data.Watch_Fd = inotify_init();
+	if(Config_Data.Watch_Fd < 0)
+	{
+		Liric_General_Error_Number = 317;
+		sprintf(Liric_General_Error_String,"Liric_Config_Watch_Start:inotify_init failed (%d).",errno);
+		return FALSE;
+	}
+	if(inotify_add_watch(Config_Data.Watch_Fd,directory_name,IN_CLOSE_WRITE|IN_MOVED_TO) < 0)
+	{
+		Liric_General_Error_Number = 318;
+		sprintf(Liric_General_Error_String,"Liric_Config_Watch_Start:inotify_add_watch(%s) failed (%d).",
+			directory_name,errno);
+		close(Config_Data.Watch_Fd);
+		Config_Data.Watch_Fd = -1;
+		return FALSE;
+	}
+	Config_Data.Watch_Run = TRUE;
+	retval = pthread_create(&(Config_Data.Watch_Thread),NULL,Config_Watch_Thread,NULL);
+	if(retval != 0)
+	{
+		Config_Data.Watch_Run = FALSE;
+		close(Config_Data.Watch_Fd);
+		Config_Data.Watch_Fd = -1;
+		Liric_General_Error_Number = 319;
+		sprintf(Liric_General_Error_String,"Liric_Config_Watch_Start:pthread_create failed (%d).",retval);
+		return FALSE;
+	}
+	Config_Data.Watch_Thread_Started = TRUE;
+#if LIRIC_DEBUG > 1
+	Liric_General_Log_Format("liric","liric_config.c","Liric_Config_Watch_Start",LOG_VERBOSITY_INTERMEDIATE,
+				  NULL,"Watching '%s' for changes to '%s'.",directory_name,Config_Data.Filename);
+#endif
+	return TRUE;
+}
+
+/**
+ * Stop the config watch thread (if it was started), and wait for it to finish.
+ * @return The routine returns TRUE on sucess, FALSE on failure.
+ * @see #Config_Data
+ * @see liric_general.html#Liric_General_Error_Number
+ * @see liric_general.html#Liric_General_Error_String
+ */
+int Liric_Config_Watch_Stop(void)
+{
+	int retval;
+
+	if(Config_Data.Watch_Thread_Started == FALSE)
+		return TRUE;
+	Config_Data.Watch_Run = FALSE;
+	retval = pthread_join(Config_Data.Watch_Thread,NULL);
+	Config_Data.Watch_Thread_Started = FALSE;
+	close(Config_Data.Watch_Fd);
+	Config_Data.Watch_Fd = -1;
+	if(retval != 0)
+	{
+		Liric_General_Error_Number = 320;
+		sprintf(Liric_General_Error_String,"Liric_Config_Watch_Stop:pthread_join failed (%d).",retval);
+		return FALSE;
+	}
+	return TRUE;
+}
+
 /**
  * Get a string value from the configuration file. Calls eSTAR_Config_Get_String.
  * @param key The config keyword.
@@ -129,6 +413,7 @@ int Liric_Config_Shutdown(void)
  * @return The routine returns TRUE on sucess, FALSE on failure.
  * @see ../../../estar/config/estar_config.html#eSTAR_Config_Get_String
  * @see #Config_Properties
+ * @see #Config_Data
  * @see liric_general.html#Liric_General_Log_Format
  * @see liric_general.html#Liric_General_Log
  * @see liric_general.html#Liric_General_Error_Number
@@ -142,7 +427,9 @@ int Liric_Config_Get_String(char *key, char **value)
 	Liric_General_Log_Format("liric","liric_config.c","Liric_Config_Get_String",LOG_VERBOSITY_VERBOSE,NULL,
 				  "started(%s,%p).",key,value);
 #endif
+	pthread_mutex_lock(&(Config_Data.Properties_Mutex));
 	retval = eSTAR_Config_Get_String(&Config_Properties,key,value);
+	pthread_mutex_unlock(&(Config_Data.Properties_Mutex));
 	if(retval == FALSE)
 	{
 		Liric_General_Error_Number = 302;
@@ -166,6 +453,7 @@ int Liric_Config_Get_String(char *key, char **value)
  * @return The routine returns TRUE on sucess, FALSE on failure.
  * @see ../../../estar/config/estar_config.html#eSTAR_Config_Get_String
  * @see #Config_Properties
+ * @see #Config_Data
  * @see liric_general.html#Liric_General_Log_Format
  * @see liric_general.html#Liric_General_Log
  * @see liric_general.html#Liric_General_Error_Number
@@ -180,7 +468,9 @@ int Liric_Config_Get_Character(char *key, char *value)
 	Liric_General_Log_Format("liric","liric_config.c","Liric_Config_Get_Character",LOG_VERBOSITY_VERBOSE,NULL,
 			       "started(%s,%p).",key,value);
 #endif
+	pthread_mutex_lock(&(Config_Data.Properties_Mutex));
 	retval = eSTAR_Config_Get_String(&Config_Properties,key,&string_value);
+	pthread_mutex_unlock(&(Config_Data.Properties_Mutex));
 	if(retval == FALSE)
 	{
 		Liric_General_Error_Number = 309;
@@ -220,6 +510,7 @@ int Liric_Config_Get_Character(char *key, char *value)
  * @return The routine returns TRUE on sucess, FALSE on failure.
  * @see ../../../estar/config/estar_config.html#eSTAR_Config_Get_Int
  * @see #Config_Properties
+ * @see #Config_Data
  * @see liric_general.html#Liric_General_Log_Format
  * @see liric_general.html#Liric_General_Log
  * @see liric_general.html#Liric_General_Error_Number
@@ -233,7 +524,9 @@ int Liric_Config_Get_Integer(char *key, int *i)
 	Liric_General_Log_Format("liric","liric_config.c","Liric_Config_Get_Integer",LOG_VERBOSITY_VERBOSE,NULL,
 			       "started(%s,%p).",key,i);
 #endif
+	pthread_mutex_lock(&(Config_Data.Properties_Mutex));
 	retval = eSTAR_Config_Get_Int(&Config_Properties,key,i);
+	pthread_mutex_unlock(&(Config_Data.Properties_Mutex));
 	if(retval == FALSE)
 	{
 		Liric_General_Error_Number = 303;
@@ -255,6 +548,7 @@ int Liric_Config_Get_Integer(char *key, int *i)
  * @return The routine returns TRUE on sucess, FALSE on failure.
  * @see ../../../estar/config/estar_config.html#eSTAR_Config_Get_Long
  * @see #Config_Properties
+ * @see #Config_Data
  * @see liric_general.html#Liric_General_Log_Format
  * @see liric_general.html#Liric_General_Log
  * @see liric_general.html#Liric_General_Error_Number
@@ -268,7 +562,9 @@ int Liric_Config_Get_Long(char *key, long *l)
 	Liric_General_Log_Format("liric","liric_config.c","Liric_Config_Get_Long",LOG_VERBOSITY_VERBOSE,NULL,
 				  "started(%s,%p).",key,l);
 #endif
+	pthread_mutex_lock(&(Config_Data.Properties_Mutex));
 	retval = eSTAR_Config_Get_Long(&Config_Properties,key,l);
+	pthread_mutex_unlock(&(Config_Data.Properties_Mutex));
 	if(retval == FALSE)
 	{
 		Liric_General_Error_Number = 304;
@@ -290,6 +586,7 @@ int Liric_Config_Get_Long(char *key, long *l)
  * @return The routine returns TRUE on sucess, FALSE on failure.
  * @see ../../../estar/config/estar_config.html#eSTAR_Config_Get_Unsigned_Short
  * @see #Config_Properties
+ * @see #Config_Data
  * @see liric_general.html#Liric_General_Log_Format
  * @see liric_general.html#Liric_General_Log
  * @see liric_general.html#Liric_General_Error_Number
@@ -303,7 +600,9 @@ int Liric_Config_Get_Unsigned_Short(char *key,unsigned short *us)
 	Liric_General_Log_Format("liric","liric_config.c","Liric_Config_Get_Unsigned_Short",
 				  LOG_VERBOSITY_VERBOSE,NULL,"started(%s,%p).",key,us);
 #endif
+	pthread_mutex_lock(&(Config_Data.Properties_Mutex));
 	retval = eSTAR_Config_Get_Unsigned_Short(&Config_Properties,key,us);
+	pthread_mutex_unlock(&(Config_Data.Properties_Mutex));
 	if(retval == FALSE)
 	{
 		Liric_General_Error_Number = 305;
@@ -325,6 +624,7 @@ int Liric_Config_Get_Unsigned_Short(char *key,unsigned short *us)
  * @return The routine returns TRUE on sucess, FALSE on failure.
  * @see ../../../estar/config/estar_config.html#eSTAR_Config_Get_Double
  * @see #Config_Properties
+ * @see #Config_Data
  * @see liric_general.html#Liric_General_Log_Format
  * @see liric_general.html#Liric_General_Log
  * @see liric_general.html#Liric_General_Error_Number
@@ -338,7 +638,9 @@ int Liric_Config_Get_Double(char *key, double *d)
 	Liric_General_Log_Format("liric","liric_config.c","Liric_Config_Get_Double",LOG_VERBOSITY_VERBOSE,NULL,
 				  "started(%s,%p).",key,d);
 #endif
+	pthread_mutex_lock(&(Config_Data.Properties_Mutex));
 	retval = eSTAR_Config_Get_Double(&Config_Properties,key,d);
+	pthread_mutex_unlock(&(Config_Data.Properties_Mutex));
 	if(retval == FALSE)
 	{
 		Liric_General_Error_Number = 306;
@@ -360,6 +662,7 @@ int Liric_Config_Get_Double(char *key, double *d)
  * @return The routine returns TRUE on sucess, FALSE on failure.
  * @see ../../../estar/config/estar_config.html#eSTAR_Config_Get_Float
  * @see #Config_Properties
+ * @see #Config_Data
  * @see liric_general.html#Liric_General_Log_Format
  * @see liric_general.html#Liric_General_Log
  * @see liric_general.html#Liric_General_Error_Number
@@ -373,7 +676,9 @@ int Liric_Config_Get_Float(char *key,float *f)
 	Liric_General_Log_Format("liric","liric_config.c","Liric_Config_Get_Float",LOG_VERBOSITY_VERBOSE,NULL,
 				  "started(%s,%p).",key,f);
 #endif
+	pthread_mutex_lock(&(Config_Data.Properties_Mutex));
 	retval = eSTAR_Config_Get_Float(&Config_Properties,key,f);
+	pthread_mutex_unlock(&(Config_Data.Properties_Mutex));
 	if(retval == FALSE)
 	{
 		Liric_General_Error_Number = 307;
@@ -396,6 +701,7 @@ int Liric_Config_Get_Float(char *key,float *f)
  * @return The routine returns TRUE on sucess, FALSE on failure.
  * @see ../../../estar/config/estar_config.html#eSTAR_Config_Get_Boolean
  * @see #Config_Properties
+ * @see #Config_Data
  * @see liric_general.html#Liric_General_Log_Format
  * @see liric_general.html#Liric_General_Log
  * @see liric_general.html#Liric_General_Error_Number
@@ -409,7 +715,9 @@ int Liric_Config_Get_Boolean(char *key, int *boolean)
 	Liric_General_Log_Format("liric","liric_config.c","Liric_Config_Get_Boolean",LOG_VERBOSITY_VERBOSE,NULL,
 				  "started(%s,%p).",key,boolean);
 #endif
+	pthread_mutex_lock(&(Config_Data.Properties_Mutex));
 	retval = eSTAR_Config_Get_Boolean(&Config_Properties,key,boolean);
+	pthread_mutex_unlock(&(Config_Data.Properties_Mutex));
 	if(retval == FALSE)
 	{
 		Liric_General_Error_Number = 308;
@@ -428,61 +736,248 @@ int Liric_Config_Get_Boolean(char *key, int *boolean)
  * Wrapper routine to make testing whether the detector is enabled easier.
  * @return The routine returns TRUE if the detector is enabled (detector.enable=true) 
  *         and FALSE if it is not enabled, or an error occurs.
- * @see #Liric_Config_Get_Boolean
- * @see liric_general.html#Liric_General_Error
+ * The value is read from the typed config cache, so no keyword lookup is done.
+ * @see #Liric_Config_Cache_Get
  */
 int Liric_Config_Detector_Is_Enabled(void)
 {
-	int enabled;
-	
-	if(!Liric_Config_Get_Boolean("detector.enable",&enabled))
-	{
-		/* log the failure */
-		Liric_General_Error("config","liric_config.c","Liric_Config_Detector_Is_Enabled",
-				     LOG_VERBOSITY_TERSE,"CONFIG");
-		return FALSE;
-	}
-	return enabled;
+	struct Liric_Config_Cache_Struct cache;
+
+	Liric_Config_Cache_Get(&cache);
+	return cache.Detector_Enable;
 }
 
 /**
  * Wrapper routine to make testing whether the nudgematic (internal offset mechanism) is enabled easier.
  * @return The routine returns TRUE if the detector is enabled (nudgematic.enable=true) 
  *         and FALSE if it is not enabled, or an error occurs.
- * @see #Liric_Config_Get_Boolean
- * @see liric_general.html#Liric_General_Error
+ * The value is read from the typed config cache, so no keyword lookup is done.
+ * @see #Liric_Config_Cache_Get
  */
 int Liric_Config_Nudgematic_Is_Enabled(void)
 {
-	int enabled;
-	
-	if(!Liric_Config_Get_Boolean("nudgematic.enable",&enabled))
-	{
-		/* log the failure */
-		Liric_General_Error("config","liric_config.c","Liric_Config_Nudgematic_Is_Enabled",
-				     LOG_VERBOSITY_TERSE,"CONFIG");
-		return FALSE;
-	}
-	return enabled;
+	struct Liric_Config_Cache_Struct cache;
+
+	Liric_Config_Cache_Get(&cache);
+	return cache.Nudgematic_Enable;
 }
 
 /**
  * Wrapper routine to make testing whether the filter wheel is enabled easier.
  * @return The routine returns TRUE if the filter wheel is enabled (filter_wheel.enable=true) 
  *         and FALSE if it is not enabled, or an error occurs.
- * @see #Liric_Config_Get_Boolean
- * @see liric_general.html#Liric_General_Error
+ * The value is read from the typed config cache, so no keyword lookup is done.
+ * @see #Liric_Config_Cache_Get
  */
 int Liric_Config_Filter_Wheel_Is_Enabled(void)
 {
-	int enabled;
-	
-	if(!Liric_Config_Get_Boolean("filter_wheel.enable",&enabled))
+	struct Liric_Config_Cache_Struct cache;
+
+	Liric_Config_Cache_Get(&cache);
+	return cache.Filter_Wheel_Enable;
+}
+
+/* ----------------------------------------------------------------------------
+** 		internal functions 
+** ---------------------------------------------------------------------------- */
+/**
+ * Parse and validate the typed config values from a set of config properties. 
+ * If the detector is enabled, the detector format directory and the coadd exposure lengths are also parsed.
+ * The coadd exposure length names are fixed: "short", "long" and "bias" are used by the config, multbias
+ * and multdark commands, "benchmark" is written into the config files generated by liric_benchmark. 
+ * A name with no coadd exposure length configured is left out of the cache.
+ * @param properties The address of the config properties to parse.
+ * @param cache The address of a structure to fill in with the typed config values. The Generation is not set.
+ * @return The routine returns TRUE on sucess, FALSE if a value is missing or out of range.
+ * @see liric_config.html#Liric_Config_Cache_Struct
+ * @see liric_general.html#Liric_General_Error_Number
+ * @see liric_general.html#Liric_General_Error_String
+ * @see ../../estar/config/estar_config.html#eSTAR_Config_Get_Boolean
+ * @see ../../estar/config/estar_config.html#eSTAR_Config_Get_Int
+ * @see ../../estar/config/estar_config.html#eSTAR_Config_Get_String
+ * @see liric_config.html#LIRIC_CONFIG_FORMAT_DIR_LENGTH
+ * @see liric_config.html#LIRIC_CONFIG_COADD_EXPOSURE_LENGTH_COUNT
+ */
+static int Config_Cache_Parse(eSTAR_Config_Properties_t *properties,struct Liric_Config_Cache_Struct *cache)
+{
+	char *boolean_key_list[] = {"detector.enable","nudgematic.enable","filter_wheel.enable",
+				    "liric.multrun.image.flip.x","liric.multrun.image.flip.y"};
+	int *boolean_value_list[] = {&(cache->Detector_Enable),&(cache->Nudgematic_Enable),
+				     &(cache->Filter_Wheel_Enable),&(cache->Multrun_Image_Flip_X),
+				     &(cache->Multrun_Image_Flip_Y)};
+	char *priority_key_list[] = {"thread.priority.normal","thread.priority.exposure"};
+	int *priority_value_list[] = {&(cache->Thread_Priority_Normal),&(cache->Thread_Priority_Exposure)};
+	char *coadd_exposure_length_name_list[LIRIC_CONFIG_COADD_EXPOSURE_LENGTH_COUNT] = {"short","long","bias",
+											    "benchmark"};
+	struct Liric_Config_Coadd_Exposure_Length_Struct *coadd_exposure_length = NULL;
+	char keyword_string[64];
+	char *format_dir_string = NULL;
+	int i,min_priority,max_priority;
+
+	cache->Generation = 0;
+	strcpy(cache->Detector_Format_Dir,"");
+	cache->Coadd_Exposure_Length_Count = 0;
+	for(i = 0; i < (int)(sizeof(boolean_key_list)/sizeof(boolean_key_list[0])); i++)
+	{
+		if(!eSTAR_Config_Get_Boolean(properties,boolean_key_list[i],boolean_value_list[i]))
+		{
+			Liric_General_Error_Number = 321;
+			sprintf(Liric_General_Error_String,"Config_Cache_Parse(%s) failed:",boolean_key_list[i]);
+			eSTAR_Config_Error_To_String(Liric_General_Error_String+strlen(Liric_General_Error_String));
+			return FALSE;
+		}
+	}
+	min_priority = sched_get_priority_min(SCHED_FIFO);
+	max_priority = sched_get_priority_max(SCHED_FIFO);
+	for(i = 0; i < (int)(sizeof(priority_key_list)/sizeof(priority_key_list[0])); i++)
+	{
+		if(!eSTAR_Config_Get_Int(properties,priority_key_list[i],priority_value_list[i]))
+		{
+			Liric_General_Error_Number = 322;
+			sprintf(Liric_General_Error_String,"Config_Cache_Parse(%s) failed:",priority_key_list[i]);
+			eSTAR_Config_Error_To_String(Liric_General_Error_String+strlen(Liric_General_Error_String));
+			return FALSE;
+		}
+		if(((*(priority_value_list[i])) < min_priority)||((*(priority_value_list[i])) > max_priority))
+		{
+			Liric_General_Error_Number = 323;
+			sprintf(Liric_General_Error_String,"Config_Cache_Parse:%s value %d out of range (%d,%d).",
+				priority_key_list[i],(*(priority_value_list[i])),min_priority,max_priority);
+			return FALSE;
+		}
+	}
+	/* the detector format values are only needed (and may only be configured) when the detector is enabled */
+	if(cache->Detector_Enable == FALSE)
+		return TRUE;
+	if(!eSTAR_Config_Get_String(properties,"detector.format_dir",&format_dir_string))
+	{
+		Liric_General_Error_Number = 325;
+		sprintf(Liric_General_Error_String,"Config_Cache_Parse(detector.format_dir) failed:");
+		eSTAR_Config_Error_To_String(Liric_General_Error_String+strlen(Liric_General_Error_String));
+		return FALSE;
+	}
+	if(strlen(format_dir_string) >= LIRIC_CONFIG_FORMAT_DIR_LENGTH)
+	{
+		Liric_General_Error_Number = 326;
+		sprintf(Liric_General_Error_String,"Config_Cache_Parse:detector.format_dir is too long (%lu vs %d).",
+			(unsigned long)strlen(format_dir_string),LIRIC_CONFIG_FORMAT_DIR_LENGTH);
+		free(format_dir_string);
+		return FALSE;
+	}
+	strcpy(cache->Detector_Format_Dir,format_dir_string);
+	free(format_dir_string);
+	for(i = 0; i < LIRIC_CONFIG_COADD_EXPOSURE_LENGTH_COUNT; i++)
+	{
+		coadd_exposure_length = &(cache->Coadd_Exposure_Length_List[cache->Coadd_Exposure_Length_Count]);
+		sprintf(keyword_string,"detector.coadd_exposure_length.%s",coadd_exposure_length_name_list[i]);
+		if(eSTAR_Config_Get_Int(properties,keyword_string,&(coadd_exposure_length->Length)))
+		{
+			strcpy(coadd_exposure_length->Name,coadd_exposure_length_name_list[i]);
+			cache->Coadd_Exposure_Length_Count++;
+		}
+	}
+	return TRUE;
+}
+
+/**
+ * Publish a new set of typed config values under the cache sequence lock. The generation is set to one more
+ * than the previous one. Callers serialise publication (Liric_Config_Load is called before any other threads
+ * are started, Liric_Config_Reload holds Config_Data.Reload_Mutex).
+ * @param cache The address of the typed config values to publish.
+ * @see #Config_Data
+ */
+static void Config_Cache_Publish(struct Liric_Config_Cache_Struct *cache)
+{
+	cache->Generation = Config_Data.Cache.Generation+1;
+	Config_Data.Cache_Sequence++;
+	__sync_synchronize();
+	Config_Data.Cache = (*cache);
+	__sync_synchronize();
+	Config_Data.Cache_Sequence++;
+}
+
+/**
+ * Save the config filename, so it can be reloaded.
+ * @param filename The config filename.
+ * @return The routine returns TRUE on sucess, FALSE if the filename is too long.
+ * @see #Config_Data
+ * @see #CONFIG_FILENAME_LENGTH
+ * @see liric_general.html#Liric_General_Error_Number
+ * @see liric_general.html#Liric_General_Error_String
+ */
+static int Config_Filename_Set(char *filename)
+{
+	if(strlen(filename) >= CONFIG_FILENAME_LENGTH)
 	{
-		/* log the failure */
-		Liric_General_Error("config","liric_config.c","Liric_Config_Filter_Wheel_Is_Enabled",
-				     LOG_VERBOSITY_TERSE,"CONFIG");
+		Liric_General_Error_Number = 324;
+		sprintf(Liric_General_Error_String,"Config_Filename_Set:Filename too long (%lu).",
+			(unsigned long)strlen(filename));
 		return FALSE;
 	}
-	return enabled;
+	pthread_mutex_lock(&(Config_Data.Reload_Mutex));
+	strcpy(Config_Data.Filename,filename);
+	pthread_mutex_unlock(&(Config_Data.Reload_Mutex));
+	return TRUE;
+}
+
+/**
+ * The config watch thread. Whilst Config_Data.Watch_Run is TRUE, we poll the inotify file descriptor 
+ * (every CONFIG_WATCH_POLL_MS milliseconds, so we notice when we are asked to stop), read any events, and 
+ * if any of them were for the config file we reload it with Liric_Config_Reload. A failed reload is logged, 
+ * and the current config is kept.
+ * @param user_arg Not used.
+ * @return Always NULL.
+ * @see #Config_Data
+ * @see #CONFIG_WATCH_POLL_MS
+ * @see #CONFIG_WATCH_EVENT_BUFFER_LENGTH
+ * @see #Liric_Config_Reload
+ * @see liric_general.html#Liric_General_Error
+ * @see liric_general.html#Liric_General_Log_Format
+ */
+static void *Config_Watch_Thread(void *user_arg)
+{
+	struct pollfd poll_fd;
+	struct inotify_event *event = NULL;
+	char event_buffer[CONFIG_WATCH_EVENT_BUFFER_LENGTH]
+		__attribute__ ((aligned(__alignof__(struct inotify_event))));
+	char *base_name = NULL;
+	ssize_t read_length;
+	int offset,changed;
+
+	base_name = strrchr(Config_Data.Filename,'/');
+	if(base_name == NULL)
+		base_name = Config_Data.Filename;
+	else
+		base_name++;
+	while(Config_Data.Watch_Run)
+	{
+		poll_fd.fd = Config_Data.Watch_Fd;
+		poll_fd.events = POLLIN;
+		poll_fd.revents = 0;
+		if(poll(&poll_fd,1,CONFIG_WATCH_POLL_MS) <= 0)
+			continue;
+		read_length = read(Config_Data.Watch_Fd,event_buffer,CONFIG_WATCH_EVENT_BUFFER_LENGTH);
+		if(read_length <= 0)
+			continue;
+		changed = FALSE;
+		for(offset = 0; offset < read_length; offset += sizeof(struct inotify_event)+event->len)
+		{
+			event = (struct inotify_event *)(event_buffer+offset);
+			if((event->len > 0)&&(strcmp(event->name,base_name) == 0))
+				changed = TRUE;
+		}
+		if(changed)
+		{
+#if LIRIC_DEBUG > 1
+			Liric_General_Log_Format("config","liric_config.c","Config_Watch_Thread",LOG_VERBOSITY_TERSE,
+						 "CONFIG","Config file '%s' changed, reloading.",Config_Data.Filename);
+#endif
+			if(!Liric_Config_Reload())
+			{
+				Liric_General_Error("config","liric_config.c","Config_Watch_Thread",
+						    LOG_VERBOSITY_TERSE,"CONFIG");
+			}
+		}
+	}
+	return NULL;
 }
@@ -41,6 +41,7 @@
 
 #include "liric_config.h"
 #include "liric_general.h"
+#include "liric_log_binary.h"
 
 /* typedefs */
 /**
@@ -58,17 +59,43 @@ typedef void (*Log_Handler_Function)(char *sub_system,char *source_filename,char
  * Number of log handlers in the log handler list.
  */
 #define LOG_HANDLER_LIST_COUNT                  (5)
+/**
+ * The number of log records in the asynchronous log ring. This must be a power of two.
+ */
+#define LOG_ASYNC_RING_LENGTH			(1024)
+/**
+ * The length of the sub_system/source_filename/function/category strings copied into each asynchronous log record,
+ * including the NULL terminator. Longer strings are truncated.
+ */
+#define LOG_ASYNC_FIELD_LENGTH			(64)
+/**
+ * How long the asynchronous log writer thread sleeps when the log ring is empty, in nanoseconds (5 ms).
+ */
+#define LOG_ASYNC_POLL_NS			(5000000)
+/**
+ * Asynchronous log record type: the Message field contains a formatted text message, to be passed to the
+ * log handlers.
+ */
+#define LOG_ASYNC_RECORD_TYPE_TEXT		(0)
+/**
+ * Asynchronous log record type: the Message field contains the packed arguments of a message, to be written to
+ * the binary log file.
+ */
+#define LOG_ASYNC_RECORD_TYPE_BINARY		(1)
 
 /* external variables */
 /**
- * Variable holding error code of last operation performed.
+ * Variable holding error code of last operation performed. This is thread local, so threads that fail at the
+ * same time (for instance the mechanism startup threads) do not overwrite each others errors.
  */
-int Liric_General_Error_Number = 0;
+__thread int Liric_General_Error_Number = 0;
 /**
- * Internal variable holding description of the last error that occured.
+ * Internal variable holding description of the last error that occured. This is thread local, like
+ * Liric_General_Error_Number.
  * @see #LIRIC_GENERAL_ERROR_STRING_LENGTH
+ * @see #Liric_General_Error_Number
  */
-char Liric_General_Error_String[LIRIC_GENERAL_ERROR_STRING_LENGTH] = "";
+__thread char Liric_General_Error_String[LIRIC_GENERAL_ERROR_STRING_LENGTH] = "";
 
 /* data types */
 /**
@@ -122,6 +149,77 @@ struct General_Struct
 	int Log_UDP_Socket_Id;
 };
 
+/**
+ * Data type holding one log record in the asynchronous log ring:
+ * <dl>
+ * <dt>Sequence</dt> <dd>The ring sequence number of this slot. A producer may fill the slot when the sequence
+ *     equals the enqueue position, the writer may consume it when the sequence equals the dequeue position plus one.</dd>
+ * <dt>Type</dt> <dd>The type of record, LOG_ASYNC_RECORD_TYPE_TEXT or LOG_ASYNC_RECORD_TYPE_BINARY.</dd>
+ * <dt>Timestamp</dt> <dd>The time (CLOCK_REALTIME) the message was logged.</dd>
+ * <dt>Null_Mask</dt> <dd>A bit mask of which of the sub_system (1), source_filename (2), function (4) and
+ *     category (8) parameters were NULL when logged.</dd>
+ * <dt>Level</dt> <dd>The log level of the message.</dd>
+ * <dt>Sub_System</dt> <dd>A copy of the sub system.</dd>
+ * <dt>Source_Filename</dt> <dd>A copy of the source filename.</dd>
+ * <dt>Function</dt> <dd>A copy of the function name.</dd>
+ * <dt>Category</dt> <dd>A copy of the category.</dd>
+ * <dt>Format</dt> <dd>For binary records, the message format string (which must be a string literal).</dd>
+ * <dt>Arg_Count</dt> <dd>For binary records, the number of packed arguments in Message.</dd>
+ * <dt>Packed_Length</dt> <dd>For binary records, the number of bytes of packed arguments in Message.</dd>
+ * <dt>Message</dt> <dd>A copy of the message, or for binary records the packed arguments.</dd>
+ * </dl>
+ * @see #LOG_ASYNC_FIELD_LENGTH
+ * @see #LOG_ASYNC_RECORD_TYPE_TEXT
+ * @see #LOG_ASYNC_RECORD_TYPE_BINARY
+ * @see #LIRIC_GENERAL_ERROR_STRING_LENGTH
+ */
+struct General_Log_Record_Struct
+{
+	volatile unsigned int Sequence;
+	int Type;
+	struct timespec Timestamp;
+	int Null_Mask;
+	int Level;
+	char Sub_System[LOG_ASYNC_FIELD_LENGTH];
+	char Source_Filename[LOG_ASYNC_FIELD_LENGTH];
+	char Function[LOG_ASYNC_FIELD_LENGTH];
+	char Category[LOG_ASYNC_FIELD_LENGTH];
+	char *Format;
+	int Arg_Count;
+	int Packed_Length;
+	char Message[LIRIC_GENERAL_ERROR_STRING_LENGTH];
+};
+
+/**
+ * Data type holding the state of the asynchronous logging core. Log records are pushed into a bounded
+ * lock-free multiple producer/single consumer ring by the logging threads, and passed to the log handlers
+ * by a background writer thread:
+ * <dl>
+ * <dt>Run</dt> <dd>A boolean, TRUE whilst the writer thread is running and log records should be pushed into
+ *     the ring rather than passed directly to the log handlers.</dd>
+ * <dt>Thread</dt> <dd>The writer thread.</dd>
+ * <dt>Enqueue_Position</dt> <dd>The ring position the next producer will claim.</dd>
+ * <dt>Dequeue_Position</dt> <dd>The ring position the writer will consume next.</dd>
+ * <dt>Written_Count</dt> <dd>The number of log records passed to the log handlers by the writer.</dd>
+ * <dt>Dropped_Count</dt> <dd>The number of log records dropped because the ring was full.</dd>
+ * <dt>Reported_Dropped_Count</dt> <dd>The value of Dropped_Count the last time the writer logged it.</dd>
+ * <dt>Ring</dt> <dd>The ring of log records.</dd>
+ * </dl>
+ * @see #General_Log_Record_Struct
+ * @see #LOG_ASYNC_RING_LENGTH
+ */
+struct General_Log_Async_Struct
+{
+	volatile int Run;
+	pthread_t Thread;
+	volatile unsigned int Enqueue_Position;
+	unsigned int Dequeue_Position;
+	volatile unsigned int Written_Count;
+	volatile unsigned int Dropped_Count;
+	unsigned int Reported_Dropped_Count;
+	struct General_Log_Record_Struct Ring[LOG_ASYNC_RING_LENGTH];
+};
+
 /* internal data */
 /**
  * Revision Control System identifier.
@@ -154,11 +252,38 @@ static struct General_Struct General_Data =
         {NULL,NULL,NULL,NULL,NULL},NULL,0,"","liric_c_log","liric_c_log.txt",NULL,
 	"liric_c_error","liric_c_error.txt",NULL,NULL,FALSE,"",0,-1
 };
+/**
+ * The state of the asynchronous logging core. Statically initialised to not running, with an empty ring.
+ * The ring sequence numbers are initialised by Liric_General_Log_Async_Start.
+ * @see #General_Log_Async_Struct
+ * @see #Liric_General_Log_Async_Start
+ */
+static struct General_Log_Async_Struct Log_Async_Data;
+/**
+ * Per-thread boolean, TRUE in the asynchronous log writer thread. Log messages generated by the log handlers
+ * themselves are passed straight through rather than re-queued, and the hourly file handler leaves flushing
+ * to the writer.
+ */
+static __thread int Log_Async_Writer_Thread = FALSE;
+/**
+ * Per-thread pointer to the timestamp of the log record currently being passed to the log handlers by
+ * the asynchronous log writer, or NULL. The hourly file handler uses it so messages are stamped with the time they
+ * were logged, not the time they were written.
+ */
+static __thread struct timespec *Log_Async_Record_Timestamp = NULL;
 
 /* internal functions */
 static void General_Log_Handler_Hourly_File_Set_Fp(char *directory,char *basename,char *log_filename,FILE **log_fp);
 static void General_Log_Handler_Get_Hourly_Filename(char *directory,char *basename,char *filename);
 static void General_Log_Handler_Filename_To_Fp(char *log_filename,FILE **log_fp);
+static void General_Log_Async_Push(char *sub_system,char *source_filename,char *function,int level,
+				   char *category,char *message);
+static struct General_Log_Record_Struct *General_Log_Async_Claim(unsigned int *position);
+static void General_Log_Async_Publish(struct General_Log_Record_Struct *record,unsigned int position);
+static void General_Log_Async_Field_Copy(char *field,char *value,int null_bit,int *null_mask);
+static int General_Log_Async_Drain(void);
+static void *General_Log_Async_Thread(void *user_arg);
+static int General_String_Builder_Reserve(struct Liric_General_String_Builder_Struct *builder,size_t add_length);
 
 /* ----------------------------------------------------------------------------
 ** 		external functions 
@@ -362,7 +487,12 @@ void Liric_General_Get_Time_String(struct timespec timestamp,char *time_string,i
  * @param category What sort of information is the message. Designed to be used as a filter. Can be NULL.
  * @param format A string, with formatting statements the same as fprintf would use to determine the type
  * 	of the following arguments.
+ * If General_Data.Log_Filter is one of the level only filters (Liric_General_Log_Filter_Level_Absolute or
+ * Liric_General_Log_Filter_Level_Bitwise), we call it before formatting the message, so messages that will be
+ * filtered out are not formatted.
  * @see #Liric_General_Log
+ * @see #Liric_General_Log_Filter_Level_Absolute
+ * @see #Liric_General_Log_Filter_Level_Bitwise
  * @see #LIRIC_GENERAL_ERROR_STRING_LENGTH
  */
 void Liric_General_Log_Format(char *sub_system,char *source_filename,char *function,int level,
@@ -371,9 +501,16 @@ void Liric_General_Log_Format(char *sub_system,char *source_filename,char *funct
 	va_list ap;
 	char buff[LIRIC_GENERAL_ERROR_STRING_LENGTH];
 
+/* don't format messages that will be filtered out */
+	if((General_Data.Log_Filter == Liric_General_Log_Filter_Level_Absolute)||
+	   (General_Data.Log_Filter == Liric_General_Log_Filter_Level_Bitwise))
+	{
+		if(General_Data.Log_Filter(sub_system,source_filename,function,level,category,NULL) == FALSE)
+			return;
+	}
 /* format the arguments */
 	va_start(ap,format);
-	vsprintf(buff,format,ap);
+	vsnprintf(buff,LIRIC_GENERAL_ERROR_STRING_LENGTH,format,ap);
 	va_end(ap);
 /* call the log routine to log the results */
 	Liric_General_Log(sub_system,source_filename,function,level,category,buff);
@@ -415,6 +552,9 @@ void Liric_General_Log(char *sub_system,char *source_filename,char *function,int
 
 /**
  * Routine that goes through the General_Data.Log_Handler_List and invokes each non-null handler.
+ * If the asynchronous logging core is running (and we are not the writer thread), the message is instead
+ * pushed into the asynchronous log ring using General_Log_Async_Push, and the handlers are invoked later by
+ * the writer thread.
  * @param sub_system The sub system. Can be NULL.
  * @param source_file The source filename. Can be NULL.
  * @param function The function calling the log. Can be NULL.
@@ -422,12 +562,20 @@ void Liric_General_Log(char *sub_system,char *source_filename,char *function,int
  *         a valid member of LOG_VERBOSITY.
  * @param category What sort of information is the message. Designed to be used as a filter. Can be NULL.
  * @param message The message to log.
+ * @see #Log_Async_Data
+ * @see #Log_Async_Writer_Thread
+ * @see #General_Log_Async_Push
  */
 void Liric_General_Call_Log_Handlers(char *sub_system,char *source_filename,char *function,int level,
 					  char *category,char *message)
 {
 	int i;
 
+	if(Log_Async_Data.Run && (!Log_Async_Writer_Thread))
+	{
+		General_Log_Async_Push(sub_system,source_filename,function,level,category,message);
+		return;
+	}
 	for(i=0;i<LOG_HANDLER_LIST_COUNT;i++)
 	{
 		if(General_Data.Log_Handler_List[i] != NULL)
@@ -483,6 +631,76 @@ void Liric_General_Call_Log_Handlers_Nudgematic(int level,char *message)
 	Liric_General_Call_Log_Handlers("Nudgematic","","",level,"Nudgematic",message);
 }
 
+/**
+ * Log a message to the binary log file, without formatting it. The message arguments are packed using
+ * Liric_Log_Binary_Pack, and the message id, timestamp and packed arguments written as a binary record, which can
+ * be turned back into text by liric_log_decode.
+ * <ul>
+ * <li>If the asynchronous logging core is running (and we are not the writer thread), we claim a ring record,
+ *     pack the arguments straight into it, and publish it; the writer thread writes it to the binary log file.
+ * <li>Otherwise we pack the arguments onto the stack, and write and flush the record ourselves.
+ * </ul>
+ * @param sub_system The sub system. Can be NULL.
+ * @param level At what level is the log message (TERSE/high level or VERBOSE/low level), 
+ *         a valid member of LOG_VERBOSITY.
+ * @param format The message format string. This must be a string literal, as its address identifies the message.
+ * @param ap The message arguments.
+ * @see #Log_Async_Data
+ * @see #Log_Async_Writer_Thread
+ * @see #General_Log_Async_Claim
+ * @see #General_Log_Async_Publish
+ * @see #LOG_ASYNC_RECORD_TYPE_BINARY
+ * @see ../cdocs/liric_log_binary.html#Liric_Log_Binary_Pack
+ * @see ../cdocs/liric_log_binary.html#Liric_Log_Binary_Write
+ * @see ../cdocs/liric_log_binary.html#Liric_Log_Binary_Flush
+ */
+void Liric_General_Log_Binary(char *sub_system,int level,char *format,va_list ap)
+{
+	struct General_Log_Record_Struct *record = NULL;
+	struct timespec timestamp;
+	char packed_args[LIRIC_LOG_BINARY_MAX_ARGS_LENGTH];
+	unsigned int position;
+	int arg_count,packed_length;
+
+	if(format == NULL)
+		return;
+	if(Log_Async_Data.Run && (!Log_Async_Writer_Thread))
+	{
+		record = General_Log_Async_Claim(&position);
+		if(record == NULL)
+			return;
+		record->Type = LOG_ASYNC_RECORD_TYPE_BINARY;
+		record->Level = level;
+		record->Null_Mask = 0;
+		General_Log_Async_Field_Copy(record->Sub_System,sub_system,1,&(record->Null_Mask));
+		record->Format = format;
+		Liric_Log_Binary_Pack(format,ap,record->Message,LIRIC_LOG_BINARY_MAX_ARGS_LENGTH,
+				      &(record->Arg_Count),&(record->Packed_Length));
+		General_Log_Async_Publish(record,position);
+		return;
+	}
+	clock_gettime(CLOCK_REALTIME,&timestamp);
+	Liric_Log_Binary_Pack(format,ap,packed_args,LIRIC_LOG_BINARY_MAX_ARGS_LENGTH,&arg_count,&packed_length);
+	Liric_Log_Binary_Write(timestamp,level,sub_system,format,arg_count,packed_args,packed_length);
+	Liric_Log_Binary_Flush();
+}
+
+/**
+ * Routine that logs a message from the Detector subsystem to the binary log file. This is installed as the
+ * detector library's log format handler (using Detector_General_Set_Log_Format_Handler_Function), so detector
+ * messages are packed rather than formatted. We call Liric_General_Log_Binary with "sub_system" set to "DETECTOR".
+ * @param level At what level is the log message (TERSE/high level or VERBOSE/low level), 
+ *         a valid member of LOG_VERBOSITY.
+ * @param format The message format string.
+ * @param ap The message arguments.
+ * @see #Liric_General_Log_Binary
+ * @see ../detector/cdocs/detector_general.html#Detector_General_Set_Log_Format_Handler_Function
+ */
+void Liric_General_Call_Log_Binary_Detector(int level,char *format,va_list ap)
+{
+	Liric_General_Log_Binary("DETECTOR",level,format,ap);
+}
+
 /**
  * Routine to add the log handler to the General_Data.Log_Handler_List used by Liric_General_Log.
  * @param log_fn A function pointer to a suitable handler.
@@ -673,6 +891,8 @@ void Liric_General_Log_Handler_Log_Fp(char *sub_system,char *source_filename,cha
  * A log handler to be used for the General_Data.Log_Handler function.
  * First calls General_Log_Handler_Hourly_File_Set_Fp to open/check the right log file is open.
  * Prints the message to General_Data.Log_Fp, terminated by a newline, and then flushes the stream.
+ * When called from the asynchronous log writer thread, the message is stamped with the time it was logged
+ * (Log_Async_Record_Timestamp), and the stream is flushed by the writer once per batch of records instead.
  * @param sub_system The sub system. Can be NULL.
  * @param source_file The source filename. Can be NULL.
  * @param function The function calling the log. Can be NULL.
@@ -683,6 +903,9 @@ void Liric_General_Log_Handler_Log_Fp(char *sub_system,char *source_filename,cha
  * @see #Liric_General_Get_Current_Time_String
  * @see #General_Data
  * @see #General_Log_Handler_Log_Hourly_File_Set_Fp
+ * @see #Liric_General_Get_Time_String
+ * @see #Log_Async_Writer_Thread
+ * @see #Log_Async_Record_Timestamp
  */
 void Liric_General_Log_Handler_Log_Hourly_File(char *sub_system,char *source_filename,char *function,
 						    int level,char *category,char *message)
@@ -693,9 +916,13 @@ void Liric_General_Log_Handler_Log_Hourly_File(char *sub_system,char *source_fil
 		return;
 	General_Log_Handler_Hourly_File_Set_Fp(General_Data.Log_Directory,General_Data.Log_Filename_Root,
 					       General_Data.Log_Filename,&General_Data.Log_Fp);
-	Liric_General_Get_Current_Time_String(time_string,32);
+	if(Log_Async_Record_Timestamp != NULL)
+		Liric_General_Get_Time_String(*Log_Async_Record_Timestamp,time_string,32);
+	else
+		Liric_General_Get_Current_Time_String(time_string,32);
 	fprintf(General_Data.Log_Fp,"%s : %s: %s:%s\n",time_string,sub_system,function,message);
-	fflush(General_Data.Log_Fp);
+	if(!Log_Async_Writer_Thread)
+		fflush(General_Data.Log_Fp);
 }
 
 /**
@@ -753,6 +980,107 @@ void Liric_General_Log_Handler_Log_UDP(char *sub_system,char *source_filename,ch
 	}
 }
 
+/**
+ * Start the asynchronous logging core. From now on, messages passed to Liric_General_Call_Log_Handlers
+ * (including those from the detector, filter wheel, nudgematic and command server libraries) are pushed into a
+ * bounded lock-free ring, and formatted and written by a background writer thread, so logging no longer blocks
+ * the calling (e.g. exposure) thread on file or network I/O. If the ring is full, the record is dropped and
+ * counted. Errors logged with Liric_General_Error are still written synchronously.
+ * <ul>
+ * <li>We initialise the ring sequence numbers and positions.
+ * <li>We set Log_Async_Data.Run to TRUE, and start the writer thread General_Log_Async_Thread.
+ * </ul>
+ * This should be called after the log handlers have been configured.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Log_Async_Data
+ * @see #General_Log_Async_Thread
+ * @see #LOG_ASYNC_RING_LENGTH
+ * @see #Liric_General_Log_Async_Stop
+ */
+int Liric_General_Log_Async_Start(void)
+{
+	int i,retval;
+
+	if(Log_Async_Data.Run)
+	{
+		Liric_General_Error_Number = 121;
+		sprintf(Liric_General_Error_String,"Liric_General_Log_Async_Start:Already running.");
+		return FALSE;
+	}
+	for(i=0;i<LOG_ASYNC_RING_LENGTH;i++)
+	{
+		Log_Async_Data.Ring[i].Sequence = i;
+	}
+	Log_Async_Data.Enqueue_Position = 0;
+	Log_Async_Data.Dequeue_Position = 0;
+	Log_Async_Data.Written_Count = 0;
+	Log_Async_Data.Dropped_Count = 0;
+	Log_Async_Data.Reported_Dropped_Count = 0;
+	__sync_synchronize();
+	Log_Async_Data.Run = TRUE;
+	retval = pthread_create(&(Log_Async_Data.Thread),NULL,General_Log_Async_Thread,NULL);
+	if(retval != 0)
+	{
+		Log_Async_Data.Run = FALSE;
+		Liric_General_Error_Number = 122;
+		sprintf(Liric_General_Error_String,"Liric_General_Log_Async_Start:"
+			"Failed to create writer thread (%d).",retval);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * Stop the asynchronous logging core. We set Log_Async_Data.Run to FALSE, so new messages are passed
+ * directly to the log handlers again, and wait for the writer thread to drain the ring and exit. We then drain
+ * any records pushed by threads that were mid-push when the core stopped.
+ * This routine does nothing if the core is not running.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Log_Async_Data
+ * @see #General_Log_Async_Drain
+ * @see #Liric_General_Log_Async_Start
+ */
+int Liric_General_Log_Async_Stop(void)
+{
+	int retval;
+
+	if(!Log_Async_Data.Run)
+		return TRUE;
+	Log_Async_Data.Run = FALSE;
+	__sync_synchronize();
+	retval = pthread_join(Log_Async_Data.Thread,NULL);
+	if(retval != 0)
+	{
+		Liric_General_Error_Number = 123;
+		sprintf(Liric_General_Error_String,"Liric_General_Log_Async_Stop:"
+			"Failed to join writer thread (%d).",retval);
+		return FALSE;
+	}
+	General_Log_Async_Drain();
+	if(General_Data.Log_Fp != NULL)
+		fflush(General_Data.Log_Fp);
+	Liric_Log_Binary_Flush();
+	return TRUE;
+}
+
+/**
+ * Get the asynchronous logging core counters.
+ * @param written_count The address of an unsigned integer, on return filled in with the number of log records
+ *        written by the writer thread since the core was started. Can be NULL.
+ * @param dropped_count The address of an unsigned integer, on return filled in with the number of log records
+ *        dropped because the ring was full since the core was started. Can be NULL.
+ * @return The routine returns TRUE if the asynchronous logging core is running, and FALSE if it is not.
+ * @see #Log_Async_Data
+ */
+int Liric_General_Log_Async_Statistics_Get(unsigned int *written_count,unsigned int *dropped_count)
+{
+	if(written_count != NULL)
+		(*written_count) = Log_Async_Data.Written_Count;
+	if(dropped_count != NULL)
+		(*dropped_count) = Log_Async_Data.Dropped_Count;
+	return Log_Async_Data.Run;
+}
+
 /**
  * Routine to set the General_Data.Log_Filter_Level.
  * @see #General_Data
@@ -863,6 +1191,175 @@ int Liric_General_Add_Integer_To_String(char **string,int i)
 	return Liric_General_Add_String(string,integer_buff);
 }
 
+/**
+ * Initialise a string builder, so it builds it's string in the supplied buffer. The string is initially empty.
+ * @param builder The address of the string builder to initialise.
+ * @param buffer A buffer to build the string in, normally on the caller's stack. If the string grows too long 
+ *        for it (including the head room), the string is moved to a heap allocated buffer.
+ * @param buffer_length The length of buffer, in bytes. This must be greater than head_room.
+ * @param head_room The number of bytes to reserve at the start of the buffer, so a prefix of up to this length
+ *        can be added with Liric_General_String_Builder_Prefix without copying the string.
+ * @see #Liric_General_String_Builder_Struct
+ */
+void Liric_General_String_Builder_Initialise(struct Liric_General_String_Builder_Struct *builder,
+					     char *buffer,size_t buffer_length,size_t head_room)
+{
+	builder->Buffer = buffer;
+	builder->Buffer_Length = buffer_length;
+	builder->Head_Room = head_room;
+	builder->Length = 0;
+	builder->Initial_Buffer = buffer;
+	builder->Is_Allocated = FALSE;
+	builder->Buffer[builder->Head_Room] = '\0';
+}
+
+/**
+ * Append a string to a string builder.
+ * @param builder The address of the string builder.
+ * @param add The string to append. If this is NULL, nothing is appended.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #General_String_Builder_Reserve
+ * @see #Liric_General_Error_Number
+ * @see #Liric_General_Error_String
+ */
+int Liric_General_String_Builder_Add(struct Liric_General_String_Builder_Struct *builder,char *add)
+{
+	size_t add_length;
+
+	if(builder == NULL)
+	{
+		Liric_General_Error_Number = 124;
+		sprintf(Liric_General_Error_String,"Liric_General_String_Builder_Add:NULL builder to add %.80s to.",add);
+		return FALSE;
+	}
+	if(add == NULL)
+		return TRUE;
+	add_length = strlen(add);
+	if(!General_String_Builder_Reserve(builder,add_length))
+		return FALSE;
+	memcpy(builder->Buffer+builder->Head_Room+builder->Length,add,add_length+1);
+	builder->Length += add_length;
+	return TRUE;
+}
+
+/**
+ * Append a string representation of an integer to a string builder.
+ * @param builder The address of the string builder.
+ * @param i The integer to append.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Liric_General_String_Builder_Add_Format
+ */
+int Liric_General_String_Builder_Add_Integer(struct Liric_General_String_Builder_Struct *builder,int i)
+{
+	return Liric_General_String_Builder_Add_Format(builder,"%d",i);
+}
+
+/**
+ * Append a formatted string to a string builder. The string is formatted directly into the builder's buffer,
+ * there is no intermediate buffer to size.
+ * @param builder The address of the string builder.
+ * @param format The printf style format string.
+ * @param ... The arguments to the format string.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #General_String_Builder_Reserve
+ * @see #Liric_General_Error_Number
+ * @see #Liric_General_Error_String
+ */
+int Liric_General_String_Builder_Add_Format(struct Liric_General_String_Builder_Struct *builder,char *format,...)
+{
+	va_list ap;
+	size_t available_length;
+	int retval;
+
+	if((builder == NULL)||(format == NULL))
+	{
+		Liric_General_Error_Number = 125;
+		sprintf(Liric_General_Error_String,"Liric_General_String_Builder_Add_Format:NULL builder or format.");
+		return FALSE;
+	}
+	/* try formatting into the space left in the buffer */
+	available_length = builder->Buffer_Length-builder->Head_Room-builder->Length;
+	va_start(ap,format);
+	retval = vsnprintf(builder->Buffer+builder->Head_Room+builder->Length,available_length,format,ap);
+	va_end(ap);
+	if(retval < 0)
+	{
+		builder->Buffer[builder->Head_Room+builder->Length] = '\0';
+		Liric_General_Error_Number = 126;
+		sprintf(Liric_General_Error_String,"Liric_General_String_Builder_Add_Format:"
+			"Failed to format '%.80s'.",format);
+		return FALSE;
+	}
+	/* if it did not fit, grow the buffer and format it again */
+	if(((size_t)retval) >= available_length)
+	{
+		if(!General_String_Builder_Reserve(builder,retval))
+		{
+			builder->Buffer[builder->Head_Room+builder->Length] = '\0';
+			return FALSE;
+		}
+		va_start(ap,format);
+		vsnprintf(builder->Buffer+builder->Head_Room+builder->Length,retval+1,format,ap);
+		va_end(ap);
+	}
+	builder->Length += retval;
+	return TRUE;
+}
+
+/**
+ * Get the string built by a string builder. The string remains owned by the builder, and is no longer valid 
+ * once the builder is appended to or freed.
+ * @param builder The address of the string builder.
+ * @return The NULL terminated string.
+ */
+char *Liric_General_String_Builder_Get(struct Liric_General_String_Builder_Struct *builder)
+{
+	return builder->Buffer+builder->Head_Room;
+}
+
+/**
+ * Get the length of the string built by a string builder.
+ * @param builder The address of the string builder.
+ * @return The length of the string, in characters (excluding the NULL terminator).
+ */
+size_t Liric_General_String_Builder_Length_Get(struct Liric_General_String_Builder_Struct *builder)
+{
+	return builder->Length;
+}
+
+/**
+ * Put a prefix in front of the string built by a string builder, in the head room reserved when the builder was
+ * initialised, so the string does not have to be copied. The string returned by Liric_General_String_Builder_Get
+ * does not include the prefix.
+ * @param builder The address of the string builder.
+ * @param prefix The prefix.
+ * @return The prefixed string (which remains owned by the builder), or NULL if the prefix was longer than
+ *         the head room.
+ */
+char *Liric_General_String_Builder_Prefix(struct Liric_General_String_Builder_Struct *builder,char *prefix)
+{
+	size_t prefix_length;
+
+	prefix_length = strlen(prefix);
+	if(prefix_length > builder->Head_Room)
+		return NULL;
+	memcpy(builder->Buffer+builder->Head_Room-prefix_length,prefix,prefix_length);
+	return builder->Buffer+builder->Head_Room-prefix_length;
+}
+
+/**
+ * Free any heap buffer allocated by a string builder. The builder must be re-initialised before it is used again.
+ * @param builder The address of the string builder.
+ */
+void Liric_General_String_Builder_Free(struct Liric_General_String_Builder_Struct *builder)
+{
+	if(builder->Is_Allocated)
+		free(builder->Buffer);
+	builder->Buffer = builder->Initial_Buffer;
+	builder->Is_Allocated = FALSE;
+	builder->Length = 0;
+}
+
 /**
  * Add an integer to a list of integers.
  * @param add The integer value to add.
@@ -955,37 +1452,37 @@ int Liric_General_Mutex_Unlock(pthread_mutex_t *mutex)
 }
 
 /**
- * Set the priority of the thread running this routine to the "normal" priority.
+ * Set the priority of the thread running this routine to the "normal" priority. This is called for every command,
+ * so the priority ("thread.priority.normal") is read from the typed config cache rather than looked up by keyword.
  * @return The routine returns TRUE if the priority of the thread that has called this function is changed,
  *         and FALSE otherwise.
- * @see liric_config.html#Liric_Config_Get_Integer
+ * @see liric_config.html#Liric_Config_Cache_Get
  * @see liric_general.html#Liric_General_Thread_Priority_Set
  */
 int Liric_General_Thread_Priority_Set_Normal(void)
 {
-	int normal_priority;
+	struct Liric_Config_Cache_Struct cache;
 
-	if(!Liric_Config_Get_Integer("thread.priority.normal",&normal_priority))
-		return FALSE;
-	if(!Liric_General_Thread_Priority_Set(normal_priority))
+	Liric_Config_Cache_Get(&cache);
+	if(!Liric_General_Thread_Priority_Set(cache.Thread_Priority_Normal))
 		return FALSE;
 	return TRUE;
 }
 
 /**
- * Set the priority of the thread running this routine to the "exposure" priority.
+ * Set the priority of the thread running this routine to the "exposure" priority. This is called for every command,
+ * so the priority ("thread.priority.exposure") is read from the typed config cache rather than looked up by keyword.
  * @return The routine returns TRUE if the priority of the thread that has called this function is changed,
  *         and FALSE otherwise.
- * @see liric_config.html#Liric_Config_Get_Integer
+ * @see liric_config.html#Liric_Config_Cache_Get
  * @see liric_general.html#Liric_General_Thread_Priority_Set
  */
 int Liric_General_Thread_Priority_Set_Exposure(void)
 {
-	int exposure_priority;
+	struct Liric_Config_Cache_Struct cache;
 
-	if(!Liric_Config_Get_Integer("thread.priority.exposure",&exposure_priority))
-		return FALSE;
-	if(!Liric_General_Thread_Priority_Set(exposure_priority))
+	Liric_Config_Cache_Get(&cache);
+	if(!Liric_General_Thread_Priority_Set(cache.Thread_Priority_Exposure))
 		return FALSE;
 	return TRUE;
 }
@@ -1170,3 +1667,277 @@ static void General_Log_Handler_Filename_To_Fp(char *log_filename,FILE **log_fp)
 			fopen_errno);
 	}
 }
+
+/**
+ * Push a text log record into the asynchronous log ring. This is a bounded lock-free multiple producer/single
+ * consumer queue: each slot has a sequence number, and the slot is claimed using General_Log_Async_Claim.
+ * If the ring is full the record is dropped.
+ * @param sub_system The sub system. Can be NULL.
+ * @param source_file The source filename. Can be NULL.
+ * @param function The function calling the log. Can be NULL.
+ * @param level At what level is the log message (TERSE/high level or VERBOSE/low level), 
+ *         a valid member of LOG_VERBOSITY.
+ * @param category What sort of information is the message. Designed to be used as a filter. Can be NULL.
+ * @param message The message to log.
+ * @see #Log_Async_Data
+ * @see #General_Log_Async_Claim
+ * @see #General_Log_Async_Publish
+ * @see #General_Log_Async_Field_Copy
+ */
+static void General_Log_Async_Push(char *sub_system,char *source_filename,char *function,int level,
+				   char *category,char *message)
+{
+	struct General_Log_Record_Struct *record = NULL;
+	unsigned int position;
+
+	if(message == NULL)
+		return;
+	record = General_Log_Async_Claim(&position);
+	if(record == NULL)
+		return;
+	record->Type = LOG_ASYNC_RECORD_TYPE_TEXT;
+	record->Level = level;
+	record->Null_Mask = 0;
+	General_Log_Async_Field_Copy(record->Sub_System,sub_system,1,&(record->Null_Mask));
+	General_Log_Async_Field_Copy(record->Source_Filename,source_filename,2,&(record->Null_Mask));
+	General_Log_Async_Field_Copy(record->Function,function,4,&(record->Null_Mask));
+	General_Log_Async_Field_Copy(record->Category,category,8,&(record->Null_Mask));
+	strncpy(record->Message,message,LIRIC_GENERAL_ERROR_STRING_LENGTH-1);
+	record->Message[LIRIC_GENERAL_ERROR_STRING_LENGTH-1] = '\0';
+	General_Log_Async_Publish(record,position);
+}
+
+/**
+ * Claim the next free slot in the asynchronous log ring. Producers claim a position by compare-and-swapping
+ * Log_Async_Data.Enqueue_Position when the slot at that position is free. If the ring is full
+ * Log_Async_Data.Dropped_Count is incremented and NULL returned; we never block the logging thread.
+ * The claimed record's Timestamp is filled in. The caller must fill in the rest of the record, and then
+ * pass it to General_Log_Async_Publish.
+ * @param position The address of an unsigned integer, on return filled in with the claimed ring position.
+ * @return A pointer to the claimed record, or NULL if the ring is full.
+ * @see #Log_Async_Data
+ * @see #LOG_ASYNC_RING_LENGTH
+ * @see #General_Log_Async_Publish
+ */
+static struct General_Log_Record_Struct *General_Log_Async_Claim(unsigned int *position)
+{
+	struct General_Log_Record_Struct *record = NULL;
+	unsigned int sequence;
+	int difference;
+
+	(*position) = Log_Async_Data.Enqueue_Position;
+	while(TRUE)
+	{
+		record = &(Log_Async_Data.Ring[(*position)&(LOG_ASYNC_RING_LENGTH-1)]);
+		sequence = record->Sequence;
+		__sync_synchronize();
+		difference = (int)(sequence-(*position));
+		if(difference == 0)
+		{
+			if(__sync_bool_compare_and_swap(&(Log_Async_Data.Enqueue_Position),(*position),(*position)+1))
+				break;
+			(*position) = Log_Async_Data.Enqueue_Position;
+		}
+		else if(difference < 0)
+		{
+			/* the ring is full */
+			__sync_fetch_and_add(&(Log_Async_Data.Dropped_Count),1);
+			return NULL;
+		}
+		else
+			(*position) = Log_Async_Data.Enqueue_Position;
+	}
+	clock_gettime(CLOCK_REALTIME,&(record->Timestamp));
+	return record;
+}
+
+/**
+ * Publish a filled in record, claimed by General_Log_Async_Claim, to the asynchronous log writer.
+ * @param record The record.
+ * @param position The ring position of the record, as returned by General_Log_Async_Claim.
+ * @see #General_Log_Async_Claim
+ */
+static void General_Log_Async_Publish(struct General_Log_Record_Struct *record,unsigned int position)
+{
+	/* make sure the record is written before it is published to the writer */
+	__sync_synchronize();
+	record->Sequence = position+1;
+}
+
+/**
+ * Copy a (possibly NULL) log string parameter into a fixed length log record field.
+ * @param field The record field to copy into, of length LOG_ASYNC_FIELD_LENGTH.
+ * @param value The value to copy. Can be NULL.
+ * @param null_bit The bit to set in the null mask if the value is NULL.
+ * @param null_mask The address of the record's null mask.
+ * @see #LOG_ASYNC_FIELD_LENGTH
+ */
+static void General_Log_Async_Field_Copy(char *field,char *value,int null_bit,int *null_mask)
+{
+	if(value == NULL)
+	{
+		field[0] = '\0';
+		(*null_mask) |= null_bit;
+		return;
+	}
+	strncpy(field,value,LOG_ASYNC_FIELD_LENGTH-1);
+	field[LOG_ASYNC_FIELD_LENGTH-1] = '\0';
+}
+
+/**
+ * Pass every log record currently in the asynchronous log ring to the log handlers (in the order they were
+ * pushed), and release their slots. Binary records are written to the binary log file using
+ * Liric_Log_Binary_Write instead. Only one thread may drain the ring at a time (the writer thread, or
+ * Liric_General_Log_Async_Stop after the writer has exited).
+ * @return The number of log records passed to the log handlers.
+ * @see #Log_Async_Data
+ * @see #Log_Async_Record_Timestamp
+ * @see #LOG_HANDLER_LIST_COUNT
+ * @see #LOG_ASYNC_RECORD_TYPE_BINARY
+ * @see ../cdocs/liric_log_binary.html#Liric_Log_Binary_Write
+ */
+static int General_Log_Async_Drain(void)
+{
+	struct General_Log_Record_Struct *record = NULL;
+	unsigned int position,sequence;
+	int i,count;
+
+	count = 0;
+	while(TRUE)
+	{
+		position = Log_Async_Data.Dequeue_Position;
+		record = &(Log_Async_Data.Ring[position&(LOG_ASYNC_RING_LENGTH-1)]);
+		sequence = record->Sequence;
+		__sync_synchronize();
+		if(sequence != (position+1))
+			break;
+		if(record->Type == LOG_ASYNC_RECORD_TYPE_BINARY)
+		{
+			Liric_Log_Binary_Write(record->Timestamp,record->Level,record->Sub_System,record->Format,
+					       record->Arg_Count,record->Message,record->Packed_Length);
+		}
+		else
+		{
+			Log_Async_Record_Timestamp = &(record->Timestamp);
+			for(i=0;i<LOG_HANDLER_LIST_COUNT;i++)
+			{
+				if(General_Data.Log_Handler_List[i] != NULL)
+				{
+					(*(General_Data.Log_Handler_List[i]))((record->Null_Mask&1) ? NULL :
+									      record->Sub_System,
+							(record->Null_Mask&2) ? NULL : record->Source_Filename,
+							(record->Null_Mask&4) ? NULL : record->Function,
+							record->Level,
+							(record->Null_Mask&8) ? NULL : record->Category,
+							record->Message);
+				}
+			}
+			Log_Async_Record_Timestamp = NULL;
+		}
+		/* release the slot for the producers, one lap further on */
+		__sync_synchronize();
+		record->Sequence = position+LOG_ASYNC_RING_LENGTH;
+		Log_Async_Data.Dequeue_Position = position+1;
+		count++;
+	}
+	Log_Async_Data.Written_Count += count;
+	return count;
+}
+
+/**
+ * The asynchronous log writer thread. Whilst Log_Async_Data.Run is TRUE:
+ * <ul>
+ * <li>We drain the ring using General_Log_Async_Drain.
+ * <li>If any records were written, we flush the log file (and binary log file) once for the batch.
+ * <li>If more records have been dropped since we last checked, we log how many.
+ * <li>If the ring was empty, we sleep for LOG_ASYNC_POLL_NS.
+ * </ul>
+ * We drain the ring one final time before exiting.
+ * @param user_arg Unused.
+ * @return NULL.
+ * @see #Log_Async_Data
+ * @see #Log_Async_Writer_Thread
+ * @see #General_Log_Async_Drain
+ * @see #LOG_ASYNC_POLL_NS
+ * @see #Liric_General_Log_Format
+ */
+static void *General_Log_Async_Thread(void *user_arg)
+{
+	struct timespec sleep_time;
+	unsigned int dropped_count;
+	int count;
+
+	Log_Async_Writer_Thread = TRUE;
+	while(Log_Async_Data.Run)
+	{
+		count = General_Log_Async_Drain();
+		if(count > 0)
+		{
+			if(General_Data.Log_Fp != NULL)
+				fflush(General_Data.Log_Fp);
+			Liric_Log_Binary_Flush();
+		}
+		dropped_count = Log_Async_Data.Dropped_Count;
+		if(dropped_count != Log_Async_Data.Reported_Dropped_Count)
+		{
+			Liric_General_Log_Format("general","liric_general.c","General_Log_Async_Thread",
+						 LOG_VERBOSITY_VERY_TERSE,"LOGGING",
+						 "Asynchronous log ring full:%u records dropped (%u in total).",
+						 dropped_count-Log_Async_Data.Reported_Dropped_Count,dropped_count);
+			Log_Async_Data.Reported_Dropped_Count = dropped_count;
+		}
+		if(count == 0)
+		{
+			sleep_time.tv_sec = 0;
+			sleep_time.tv_nsec = LOG_ASYNC_POLL_NS;
+			nanosleep(&sleep_time,NULL);
+		}
+	}
+	General_Log_Async_Drain();
+	if(General_Data.Log_Fp != NULL)
+		fflush(General_Data.Log_Fp);
+	Liric_Log_Binary_Flush();
+	return NULL;
+}
+
+/**
+ * Make sure a string builder's buffer has room to append a string of the specified length (plus a NULL 
+ * terminator). If it does not, we move the string to a heap buffer (or reallocate the heap buffer) at least
+ * twice the length of the old one.
+ * @param builder The address of the string builder.
+ * @param add_length The length of the string about to be appended, excluding the NULL terminator.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Liric_General_Error_Number
+ * @see #Liric_General_Error_String
+ */
+static int General_String_Builder_Reserve(struct Liric_General_String_Builder_Struct *builder,size_t add_length)
+{
+	char *new_buffer = NULL;
+	size_t required_length,new_length;
+
+	required_length = builder->Head_Room+builder->Length+add_length+1;
+	if(required_length <= builder->Buffer_Length)
+		return TRUE;
+	new_length = builder->Buffer_Length*2;
+	if(new_length < required_length)
+		new_length = required_length;
+	if(builder->Is_Allocated)
+		new_buffer = (char *)realloc(builder->Buffer,new_length);
+	else
+	{
+		new_buffer = (char *)malloc(new_length);
+		if(new_buffer != NULL)
+			memcpy(new_buffer,builder->Buffer,builder->Head_Room+builder->Length+1);
+	}
+	if(new_buffer == NULL)
+	{
+		Liric_General_Error_Number = 127;
+		sprintf(Liric_General_Error_String,"General_String_Builder_Reserve:"
+			"Failed to allocate string builder buffer of length %lu.",(unsigned long)new_length);
+		return FALSE;
+	}
+	builder->Buffer = new_buffer;
+	builder->Buffer_Length = new_length;
+	builder->Is_Allocated = TRUE;
+	return TRUE;
+}
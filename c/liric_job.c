@@ -0,0 +1,772 @@
+/* liric_job.c
+** Liric asynchronous job routines
+*/
+/**
+ * Asynchronous job routines for the liric program. A multrun, multbias or multdark can be submitted as a job,
+ * which is run in it's own thread. The submitting client is given a job id immediately, rather than holding it's
+ * connection open until every frame has been taken. Each frame saved by the job is recorded (filename, time saved
+ * and time taken), so clients can retrieve frames as soon as they are saved (see Liric_Job_Frames_Get, which waits
+ * for the next frame), and the job's status can be queried, and the job aborted, by job id.
+ * Only one job can be in progress at a time. The status and frames of the last LIRIC_JOB_MAX_COUNT jobs are kept.
+ * @author Chris Mottram
+ * @version $Revision$
+ */
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_SOURCE 1
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_C_SOURCE 199309L
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "log_udp.h"
+
+#include "detector_exposure.h"
+#include "detector_fits_filename.h"
+#include "detector_trace.h"
+
+#include "liric_bias_dark.h"
+#include "liric_general.h"
+#include "liric_job.h"
+#include "liric_multrun.h"
+
+/* data types */
+/**
+ * Data type holding one job:
+ * <dl>
+ * <dt>Status</dt> <dd>The job's status, returned by Liric_Job_Status_Get.</dd>
+ * <dt>Do_Standard</dt> <dd>For a multrun, whether the frames are of a standard.</dd>
+ * <dt>Abort_Requested</dt> <dd>Set by Liric_Job_Abort, so a job that fails after being aborted is put into the
+ *     LIRIC_JOB_STATE_ABORTED state rather than LIRIC_JOB_STATE_FAILED.</dd>
+ * <dt>Thread</dt> <dd>The thread running the job. Only frames saved by this thread are recorded.</dd>
+ * <dt>Last_Frame_Time</dt> <dd>The time the last frame was saved, or the job started if no frames have been
+ *     saved yet. Used to calculate Frame_Length_Ms of the next frame.</dd>
+ * <dt>Frame_List</dt> <dd>An allocated list of the frames saved by the job, Status.Frame_Count long.</dd>
+ * <dt>Frame_Allocated_Count</dt> <dd>The number of frames allocated in Frame_List.</dd>
+ * </dl>
+ * @see #Liric_Job_Status_Struct
+ * @see #Liric_Job_Frame_Struct
+ */
+struct Job_Struct
+{
+	struct Liric_Job_Status_Struct Status;
+	int Do_Standard;
+	int Abort_Requested;
+	pthread_t Thread;
+	struct timespec Last_Frame_Time;
+	struct Liric_Job_Frame_Struct *Frame_List;
+	int Frame_Allocated_Count;
+};
+
+/**
+ * Data type holding local data to liric_job:
+ * <dl>
+ * <dt>Mutex</dt> <dd>Mutex held whilst reading or modifying the job list.</dd>
+ * <dt>Condition</dt> <dd>Condition variable broadcast (with Mutex held) whenever a job saves a frame or changes
+ *     state. Liric_Job_Frames_Get waits on this for new frames.</dd>
+ * <dt>Next_Job_Id</dt> <dd>The id to give the next submitted job. A job is stored in
+ *     Job_List[id % LIRIC_JOB_MAX_COUNT].</dd>
+ * <dt>Current_Index</dt> <dd>The index in Job_List of the job in progress, or -1 if no job is in progress.</dd>
+ * <dt>Detector_Claimed</dt> <dd>A boolean, TRUE whilst a job, or a synchronous multrun/multbias/multdark,
+ *     owns the detector (see Liric_Job_Detector_Claim).</dd>
+ * <dt>Job_List</dt> <dd>The list of jobs.</dd>
+ * </dl>
+ * @see #Job_Struct
+ * @see #LIRIC_JOB_MAX_COUNT
+ */
+struct Job_Data_Struct
+{
+	pthread_mutex_t Mutex;
+	pthread_cond_t Condition;
+	int Next_Job_Id;
+	int Current_Index;
+	int Detector_Claimed;
+	struct Job_Struct Job_List[LIRIC_JOB_MAX_COUNT];
+};
+
+/* internal data */
+/**
+ * Revision Control System identifier.
+ */
+static char rcsid[] = "$Id$";
+/**
+ * The instance of Job_Data_Struct that contains local data for this module.
+ * This is statically initialised to the following:
+ * <dl>
+ * <dt>Mutex</dt> <dd>PTHREAD_MUTEX_INITIALIZER</dd>
+ * <dt>Condition</dt> <dd>PTHREAD_COND_INITIALIZER</dd>
+ * <dt>Next_Job_Id</dt> <dd>1</dd>
+ * <dt>Current_Index</dt> <dd>-1</dd>
+ * <dt>Detector_Claimed</dt> <dd>FALSE</dd>
+ * <dt>Job_List</dt> <dd>All zero (job id 0 is never used)</dd>
+ * </dl>
+ * @see #Job_Data_Struct
+ */
+static struct Job_Data_Struct Job_Data =
+{
+	PTHREAD_MUTEX_INITIALIZER,PTHREAD_COND_INITIALIZER,1,-1,FALSE,
+};
+
+/* internal function declarations */
+static void *Job_Thread(void *arg);
+static int Job_Find(int job_id,int *index);
+
+/* ----------------------------------------------------------------------------
+** 		external functions
+** ---------------------------------------------------------------------------- */
+/**
+ * Submit a job. The job is started in a new (detached) thread, and this routine returns as soon as the thread
+ * has been created.
+ * <ul>
+ * <li>We check the arguments.
+ * <li>We lock the job mutex.
+ * <li>We check no job is in progress, and that the detector is not claimed by a (synchronous)
+ *     multrun/multbias/multdark. As this is done with the job mutex held, the check and the claim are atomic.
+ * <li>We pick a slot for the job in the job list (the oldest job's slot), freeing it's frame list.
+ * <li>We initialise the job's status.
+ * <li>We claim the detector, and create a detached thread to run the job (Job_Thread). Job_Thread releases the
+ *     detector when the job has finished. If the thread cannot be created, we release the detector again.
+ * <li>We unlock the job mutex.
+ * </ul>
+ * @param type The type of job.
+ * @param exposure_length_ms The exposure length of each frame, in milliseconds. Ignored for a multbias.
+ * @param exposure_count The number of frames to take.
+ * @param do_standard For a multrun, a boolean, whether the frames are of a standard. Ignored otherwise.
+ * @param job_id The address of an integer, on a successful return filled in with the submitted job's id.
+ * @return The routine returns TRUE on success and FALSE on failure. On failure, Liric_General_Error_Number and
+ *         Liric_General_Error_String should be set.
+ * @see #Job_Data
+ * @see #Job_Thread
+ * @see #LIRIC_JOB_TYPE
+ * @see liric_general.html#LIRIC_GENERAL_IS_BOOLEAN
+ * @see liric_general.html#Liric_General_Error_Number
+ * @see liric_general.html#Liric_General_Error_String
+ * @see liric_general.html#Liric_General_Mutex_Lock
+ * @see liric_general.html#Liric_General_Mutex_Unlock
+ */
+int Liric_Job_Submit(enum LIRIC_JOB_TYPE type,int exposure_length_ms,int exposure_count,int do_standard,
+		     int *job_id)
+{
+	struct Job_Struct *job = NULL;
+	pthread_attr_t attr;
+	int index,retval;
+
+	if((type != LIRIC_JOB_TYPE_MULTRUN)&&(type != LIRIC_JOB_TYPE_MULTBIAS)&&(type != LIRIC_JOB_TYPE_MULTDARK))
+	{
+		Liric_General_Error_Number = 900;
+		sprintf(Liric_General_Error_String,"Liric_Job_Submit:Illegal job type %d.",type);
+		return FALSE;
+	}
+	if(type == LIRIC_JOB_TYPE_MULTBIAS)
+		exposure_length_ms = 0;
+	else if(exposure_length_ms < 1)
+	{
+		Liric_General_Error_Number = 901;
+		sprintf(Liric_General_Error_String,"Liric_Job_Submit:Illegal exposure length %d ms.",
+			exposure_length_ms);
+		return FALSE;
+	}
+	if(exposure_count < 1)
+	{
+		Liric_General_Error_Number = 902;
+		sprintf(Liric_General_Error_String,"Liric_Job_Submit:Illegal exposure count %d.",exposure_count);
+		return FALSE;
+	}
+	if(!LIRIC_GENERAL_IS_BOOLEAN(do_standard))
+	{
+		Liric_General_Error_Number = 903;
+		sprintf(Liric_General_Error_String,"Liric_Job_Submit:Illegal do_standard %d.",do_standard);
+		return FALSE;
+	}
+	if(job_id == NULL)
+	{
+		Liric_General_Error_Number = 904;
+		sprintf(Liric_General_Error_String,"Liric_Job_Submit:job_id was NULL.");
+		return FALSE;
+	}
+	if(!Liric_General_Mutex_Lock(&(Job_Data.Mutex)))
+		return FALSE;
+	if(Job_Data.Current_Index >= 0)
+	{
+		Liric_General_Error_Number = 905;
+		sprintf(Liric_General_Error_String,"Liric_Job_Submit:Job %d is already in progress.",
+			Job_Data.Job_List[Job_Data.Current_Index].Status.Id);
+		Liric_General_Mutex_Unlock(&(Job_Data.Mutex));
+		return FALSE;
+	}
+	if(Job_Data.Detector_Claimed)
+	{
+		Liric_General_Error_Number = 906;
+		sprintf(Liric_General_Error_String,"Liric_Job_Submit:A multrun/multbias/multdark is already in progress.");
+		Liric_General_Mutex_Unlock(&(Job_Data.Mutex));
+		return FALSE;
+	}
+	/* only one job is in progress at a time, so the slot we reuse always holds a finished job */
+	index = Job_Data.Next_Job_Id % LIRIC_JOB_MAX_COUNT;
+	job = &(Job_Data.Job_List[index]);
+	if(job->Frame_List != NULL)
+		free(job->Frame_List);
+	job->Frame_List = NULL;
+	job->Frame_Allocated_Count = 0;
+	job->Status.Id = Job_Data.Next_Job_Id;
+	job->Status.Type = type;
+	job->Status.State = LIRIC_JOB_STATE_QUEUED;
+	job->Status.Exposure_Length_Ms = exposure_length_ms;
+	job->Status.Exposure_Count = exposure_count;
+	job->Status.Frame_Count = 0;
+	job->Status.Multrun_Number = -1;
+	clock_gettime(CLOCK_REALTIME,&(job->Status.Submit_Time));
+	job->Status.End_Time.tv_sec = 0;
+	job->Status.End_Time.tv_nsec = 0;
+	strcpy(job->Status.Error_String,"");
+	job->Do_Standard = do_standard;
+	job->Abort_Requested = FALSE;
+	job->Last_Frame_Time = job->Status.Submit_Time;
+	Job_Data.Detector_Claimed = TRUE;
+	/* create the job thread. Job_Thread locks the mutex before reading the job, so job->Thread is
+	** set before it is used */
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr,PTHREAD_CREATE_DETACHED);
+	retval = pthread_create(&(job->Thread),&attr,Job_Thread,(void*)(intptr_t)index);
+	pthread_attr_destroy(&attr);
+	if(retval != 0)
+	{
+		job->Status.State = LIRIC_JOB_STATE_FAILED;
+		sprintf(job->Status.Error_String,"Failed to create job thread (%d).",retval);
+		Job_Data.Detector_Claimed = FALSE;
+		Liric_General_Mutex_Unlock(&(Job_Data.Mutex));
+		Liric_General_Error_Number = 907;
+		sprintf(Liric_General_Error_String,"Liric_Job_Submit:Failed to create job thread (%d).",retval);
+		return FALSE;
+	}
+	Job_Data.Current_Index = index;
+	(*job_id) = Job_Data.Next_Job_Id++;
+	if(!Liric_General_Mutex_Unlock(&(Job_Data.Mutex)))
+		return FALSE;
+#if LIRIC_DEBUG > 1
+	Liric_General_Log_Format("job","liric_job.c","Liric_Job_Submit",LOG_VERBOSITY_TERSE,"JOB",
+				 "Submitted job %d:%s of %d frames of length %d ms.",(*job_id),
+				 Liric_Job_Type_To_String(type),exposure_count,exposure_length_ms);
+#endif
+	return TRUE;
+}
+
+/**
+ * Abort a job. If the job is still in progress, we set it's Abort_Requested flag, and then abort the
+ * multrun or bias/dark and the detector exposure, which causes the job thread to finish with the job in the
+ * LIRIC_JOB_STATE_ABORTED state. Aborting a job that has already finished does nothing.
+ * @param job_id The id of the job to abort.
+ * @return The routine returns TRUE on success and FALSE on failure (the job id is unknown).
+ * @see #Job_Data
+ * @see #Job_Find
+ * @see liric_general.html#Liric_General_Mutex_Lock
+ * @see liric_general.html#Liric_General_Mutex_Unlock
+ * @see liric_multrun.html#Liric_Multrun_Abort
+ * @see liric_bias_dark.html#Liric_Bias_Dark_Abort
+ * @see ../detector/cdocs/detector_exposure.html#Detector_Exposure_Abort
+ */
+int Liric_Job_Abort(int job_id)
+{
+	enum LIRIC_JOB_TYPE type;
+	int index,in_progress;
+
+	if(!Liric_General_Mutex_Lock(&(Job_Data.Mutex)))
+		return FALSE;
+	if(!Job_Find(job_id,&index))
+	{
+		Liric_General_Mutex_Unlock(&(Job_Data.Mutex));
+		return FALSE;
+	}
+	in_progress = (index == Job_Data.Current_Index);
+	if(in_progress)
+		Job_Data.Job_List[index].Abort_Requested = TRUE;
+	type = Job_Data.Job_List[index].Status.Type;
+	if(!Liric_General_Mutex_Unlock(&(Job_Data.Mutex)))
+		return FALSE;
+	if(!in_progress)
+		return TRUE;
+#if LIRIC_DEBUG > 1
+	Liric_General_Log_Format("job","liric_job.c","Liric_Job_Abort",LOG_VERBOSITY_TERSE,"JOB",
+				 "Aborting job %d.",job_id);
+#endif
+	if(type == LIRIC_JOB_TYPE_MULTRUN)
+		Liric_Multrun_Abort();
+	else
+		Liric_Bias_Dark_Abort();
+	Detector_Exposure_Abort();
+	return TRUE;
+}
+
+/**
+ * Return whether a job is currently in progress. This is TRUE from when Liric_Job_Submit accepts the job
+ * (before the job thread has started the multrun or bias/dark), until the job thread has finished.
+ * Job_Data.Current_Index is read with the job mutex held.
+ * @return A boolean, TRUE if a job is in progress and FALSE if it is not in progress.
+ * @see #Job_Data
+ */
+int Liric_Job_In_Progress(void)
+{
+	int in_progress;
+
+	pthread_mutex_lock(&(Job_Data.Mutex));
+	in_progress = (Job_Data.Current_Index != -1);
+	pthread_mutex_unlock(&(Job_Data.Mutex));
+	return in_progress;
+}
+
+/**
+ * Claim the detector for a synchronous multrun/multbias/multdark. The claim is tested and set with the job mutex
+ * held, so only one of a job (see Liric_Job_Submit) or a synchronous command can own the detector at a time.
+ * The claim must be released with Liric_Job_Detector_Release when the multrun/multbias/multdark has finished.
+ * @return The routine returns TRUE if the detector was claimed, and FALSE if it is already claimed
+ *         (Liric_General_Error_Number and Liric_General_Error_String are set).
+ * @see #Job_Data
+ * @see #Liric_Job_Detector_Release
+ * @see liric_general.html#Liric_General_Error_Number
+ * @see liric_general.html#Liric_General_Error_String
+ * @see liric_general.html#Liric_General_Mutex_Lock
+ * @see liric_general.html#Liric_General_Mutex_Unlock
+ */
+int Liric_Job_Detector_Claim(void)
+{
+	if(!Liric_General_Mutex_Lock(&(Job_Data.Mutex)))
+		return FALSE;
+	if(Job_Data.Detector_Claimed)
+	{
+		Liric_General_Error_Number = 914;
+		if(Job_Data.Current_Index >= 0)
+		{
+			sprintf(Liric_General_Error_String,"Liric_Job_Detector_Claim:Job %d is in progress.",
+				Job_Data.Job_List[Job_Data.Current_Index].Status.Id);
+		}
+		else
+		{
+			sprintf(Liric_General_Error_String,"Liric_Job_Detector_Claim:"
+				"A multrun/multbias/multdark is already in progress.");
+		}
+		Liric_General_Mutex_Unlock(&(Job_Data.Mutex));
+		return FALSE;
+	}
+	Job_Data.Detector_Claimed = TRUE;
+	if(!Liric_General_Mutex_Unlock(&(Job_Data.Mutex)))
+		return FALSE;
+	return TRUE;
+}
+
+/**
+ * Release a claim on the detector made by Liric_Job_Detector_Claim.
+ * @see #Job_Data
+ * @see #Liric_Job_Detector_Claim
+ */
+void Liric_Job_Detector_Release(void)
+{
+	pthread_mutex_lock(&(Job_Data.Mutex));
+	Job_Data.Detector_Claimed = FALSE;
+	pthread_mutex_unlock(&(Job_Data.Mutex));
+}
+
+/**
+ * Return whether the detector is currently claimed, by a job or by a synchronous multrun/multbias/multdark.
+ * @return A boolean, TRUE if the detector is claimed and FALSE if it is not.
+ * @see #Job_Data
+ * @see #Liric_Job_Detector_Claim
+ */
+int Liric_Job_Detector_Claimed(void)
+{
+	int claimed;
+
+	pthread_mutex_lock(&(Job_Data.Mutex));
+	claimed = Job_Data.Detector_Claimed;
+	pthread_mutex_unlock(&(Job_Data.Mutex));
+	return claimed;
+}
+
+/**
+ * Get the status of a job.
+ * @param job_id The id of the job.
+ * @param status The address of a structure to fill in with a copy of the job's status.
+ * @return The routine returns TRUE on success and FALSE on failure (the job id is unknown).
+ * @see #Job_Data
+ * @see #Job_Find
+ * @see liric_general.html#Liric_General_Mutex_Lock
+ * @see liric_general.html#Liric_General_Mutex_Unlock
+ */
+int Liric_Job_Status_Get(int job_id,struct Liric_Job_Status_Struct *status)
+{
+	int index;
+
+	if(status == NULL)
+	{
+		Liric_General_Error_Number = 908;
+		sprintf(Liric_General_Error_String,"Liric_Job_Status_Get:status was NULL.");
+		return FALSE;
+	}
+	if(!Liric_General_Mutex_Lock(&(Job_Data.Mutex)))
+		return FALSE;
+	if(!Job_Find(job_id,&index))
+	{
+		Liric_General_Mutex_Unlock(&(Job_Data.Mutex));
+		return FALSE;
+	}
+	(*status) = Job_Data.Job_List[index].Status;
+	if(!Liric_General_Mutex_Unlock(&(Job_Data.Mutex)))
+		return FALSE;
+	return TRUE;
+}
+
+/**
+ * Get the frames saved by a job, starting from a specified frame index. If the job has not saved that frame yet,
+ * and is still in progress, we wait (up to timeout_ms) for it to be saved, so a client can follow a job's progress
+ * by repeatedly calling this routine with the index after the last frame it received, and be given each frame
+ * as soon as it is saved.
+ * <ul>
+ * <li>We check the arguments.
+ * <li>We lock the job mutex, and find the job.
+ * <li>If timeout_ms is positive, we wait on the job condition variable until the job has saved frame
+ *     first_frame_index, the job finishes, or the timeout expires. The job is re-found after each wait, in
+ *     case it's slot has been re-used.
+ * <li>We copy up to max_frame_count frames, from first_frame_index onwards, into frame_list.
+ * <li>We return the job's state and unlock the job mutex.
+ * </ul>
+ * @param job_id The id of the job.
+ * @param first_frame_index The index of the first frame to return.
+ * @param timeout_ms How long to wait for frame first_frame_index to be saved, in milliseconds, between 0 (don't
+ *        wait) and LIRIC_JOB_MAX_WAIT_MS.
+ * @param frame_list A list of frames, max_frame_count long, to fill in.
+ * @param max_frame_count The maximum number of frames to return.
+ * @param frame_count The address of an integer, on a successful return filled in with the number of frames
+ *        returned in frame_list. This can be zero, if the wait timed out or the job finished without saving the
+ *        frame.
+ * @param state The address of an enum, on a successful return filled in with the state of the job.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Job_Data
+ * @see #Job_Find
+ * @see #LIRIC_JOB_MAX_WAIT_MS
+ * @see #LIRIC_JOB_STATE_IS_FINISHED
+ * @see liric_general.html#LIRIC_GENERAL_ONE_SECOND_NS
+ * @see liric_general.html#LIRIC_GENERAL_ONE_MILLISECOND_NS
+ * @see liric_general.html#Liric_General_Mutex_Lock
+ * @see liric_general.html#Liric_General_Mutex_Unlock
+ */
+int Liric_Job_Frames_Get(int job_id,int first_frame_index,int timeout_ms,
+			 struct Liric_Job_Frame_Struct *frame_list,int max_frame_count,int *frame_count,
+			 enum LIRIC_JOB_STATE *state)
+{
+	struct Job_Struct *job = NULL;
+	struct timespec deadline;
+	int index,i,retval;
+
+	if(first_frame_index < 0)
+	{
+		Liric_General_Error_Number = 909;
+		sprintf(Liric_General_Error_String,"Liric_Job_Frames_Get:Illegal first frame index %d.",
+			first_frame_index);
+		return FALSE;
+	}
+	if((timeout_ms < 0)||(timeout_ms > LIRIC_JOB_MAX_WAIT_MS))
+	{
+		Liric_General_Error_Number = 910;
+		sprintf(Liric_General_Error_String,"Liric_Job_Frames_Get:Illegal timeout %d ms (0..%d).",
+			timeout_ms,LIRIC_JOB_MAX_WAIT_MS);
+		return FALSE;
+	}
+	if((frame_list == NULL)||(max_frame_count < 1)||(frame_count == NULL)||(state == NULL))
+	{
+		Liric_General_Error_Number = 911;
+		sprintf(Liric_General_Error_String,"Liric_Job_Frames_Get:Illegal frame list arguments.");
+		return FALSE;
+	}
+	(*frame_count) = 0;
+	if(!Liric_General_Mutex_Lock(&(Job_Data.Mutex)))
+		return FALSE;
+	if(!Job_Find(job_id,&index))
+	{
+		Liric_General_Mutex_Unlock(&(Job_Data.Mutex));
+		return FALSE;
+	}
+	job = &(Job_Data.Job_List[index]);
+	if((timeout_ms > 0)&&(job->Status.Frame_Count <= first_frame_index)&&
+	   (!LIRIC_JOB_STATE_IS_FINISHED(job->Status.State)))
+	{
+		clock_gettime(CLOCK_REALTIME,&deadline);
+		deadline.tv_sec += timeout_ms/LIRIC_GENERAL_ONE_SECOND_MS;
+		deadline.tv_nsec += (timeout_ms%LIRIC_GENERAL_ONE_SECOND_MS)*LIRIC_GENERAL_ONE_MILLISECOND_NS;
+		if(deadline.tv_nsec >= LIRIC_GENERAL_ONE_SECOND_NS)
+		{
+			deadline.tv_sec++;
+			deadline.tv_nsec -= LIRIC_GENERAL_ONE_SECOND_NS;
+		}
+		retval = 0;
+		while((retval != ETIMEDOUT)&&(job->Status.Id == job_id)&&
+		      (job->Status.Frame_Count <= first_frame_index)&&(!LIRIC_JOB_STATE_IS_FINISHED(job->Status.State)))
+		{
+			retval = pthread_cond_timedwait(&(Job_Data.Condition),&(Job_Data.Mutex),&deadline);
+		}
+		/* the job's slot may have been re-used whilst we waited */
+		if(!Job_Find(job_id,&index))
+		{
+			Liric_General_Mutex_Unlock(&(Job_Data.Mutex));
+			return FALSE;
+		}
+	}
+	for(i = first_frame_index; (i < job->Status.Frame_Count)&&((*frame_count) < max_frame_count); i++)
+	{
+		frame_list[(*frame_count)++] = job->Frame_List[i];
+	}
+	(*state) = job->Status.State;
+	if(!Liric_General_Mutex_Unlock(&(Job_Data.Mutex)))
+		return FALSE;
+	return TRUE;
+}
+
+/**
+ * Record that a frame has been saved. This is called by the multrun and bias/dark routines after each frame
+ * has been saved. If the calling thread is running the job in progress, the frame is added to the job's frame
+ * list, the job's multrun number is updated, and any clients waiting in Liric_Job_Frames_Get are woken.
+ * Otherwise (the frame is part of a multrun/multbias/multdark not started as a job) this routine does nothing.
+ * Failures are logged, rather than returned, so they do not stop the multrun.
+ * @param filename The FITS filename the frame was saved to.
+ * @see #Job_Data
+ * @see #LIRIC_JOB_FILENAME_LENGTH
+ * @see liric_general.html#fdifftime
+ * @see liric_general.html#Liric_General_Error
+ * @see liric_general.html#Liric_General_Mutex_Lock
+ * @see liric_general.html#Liric_General_Mutex_Unlock
+ * @see ../detector/cdocs/detector_fits_filename.html#Detector_Fits_Filename_Multrun_Get
+ */
+void Liric_Job_Frame_Saved(char *filename)
+{
+	struct Liric_Job_Frame_Struct *new_frame_list = NULL;
+	struct Liric_Job_Frame_Struct *frame = NULL;
+	struct Job_Struct *job = NULL;
+	int new_allocated_count,job_id,frame_index;
+
+	if(filename == NULL)
+		return;
+	if(!Liric_General_Mutex_Lock(&(Job_Data.Mutex)))
+	{
+		Liric_General_Error("job","liric_job.c","Liric_Job_Frame_Saved",LOG_VERBOSITY_TERSE,"JOB");
+		return;
+	}
+	if((Job_Data.Current_Index < 0)||
+	   (!pthread_equal(Job_Data.Job_List[Job_Data.Current_Index].Thread,pthread_self())))
+	{
+		Liric_General_Mutex_Unlock(&(Job_Data.Mutex));
+		return;
+	}
+	job = &(Job_Data.Job_List[Job_Data.Current_Index]);
+	if(job->Status.Frame_Count >= job->Frame_Allocated_Count)
+	{
+		new_allocated_count = MAX(job->Status.Exposure_Count,job->Frame_Allocated_Count*2);
+		new_frame_list = (struct Liric_Job_Frame_Struct *)realloc(job->Frame_List,
+							new_allocated_count*sizeof(struct Liric_Job_Frame_Struct));
+		if(new_frame_list == NULL)
+		{
+			Liric_General_Error_Number = 912;
+			sprintf(Liric_General_Error_String,"Liric_Job_Frame_Saved:"
+				"Failed to reallocate frame list of job %d to %d frames.",job->Status.Id,
+				new_allocated_count);
+			Liric_General_Mutex_Unlock(&(Job_Data.Mutex));
+			Liric_General_Error("job","liric_job.c","Liric_Job_Frame_Saved",LOG_VERBOSITY_TERSE,"JOB");
+			return;
+		}
+		job->Frame_List = new_frame_list;
+		job->Frame_Allocated_Count = new_allocated_count;
+	}
+	frame = &(job->Frame_List[job->Status.Frame_Count]);
+	frame->Index = job->Status.Frame_Count;
+	strncpy(frame->Filename,filename,LIRIC_JOB_FILENAME_LENGTH-1);
+	frame->Filename[LIRIC_JOB_FILENAME_LENGTH-1] = '\0';
+	clock_gettime(CLOCK_REALTIME,&(frame->Saved_Time));
+	frame->Frame_Length_Ms = fdifftime(frame->Saved_Time,job->Last_Frame_Time)*LIRIC_GENERAL_ONE_SECOND_MS;
+	job->Last_Frame_Time = frame->Saved_Time;
+	job->Status.Frame_Count++;
+	job->Status.Multrun_Number = Detector_Fits_Filename_Multrun_Get();
+	/* copy what we log, the job slot can be re-used once the mutex is released */
+	job_id = job->Status.Id;
+	frame_index = frame->Index;
+	pthread_cond_broadcast(&(Job_Data.Condition));
+	Liric_General_Mutex_Unlock(&(Job_Data.Mutex));
+#if LIRIC_DEBUG > 5
+	Liric_General_Log_Format("job","liric_job.c","Liric_Job_Frame_Saved",LOG_VERBOSITY_INTERMEDIATE,"JOB",
+				 "Job %d saved frame %d:%s.",job_id,frame_index,filename);
+#endif
+}
+
+/**
+ * Return a string describing a job type.
+ * @param type The job type.
+ * @return A string, one of "multrun", "multbias", "multdark" or "unknown".
+ * @see #LIRIC_JOB_TYPE
+ */
+char *Liric_Job_Type_To_String(enum LIRIC_JOB_TYPE type)
+{
+	switch(type)
+	{
+		case LIRIC_JOB_TYPE_MULTRUN:
+			return "multrun";
+		case LIRIC_JOB_TYPE_MULTBIAS:
+			return "multbias";
+		case LIRIC_JOB_TYPE_MULTDARK:
+			return "multdark";
+		default:
+			return "unknown";
+	}
+}
+
+/**
+ * Return a string describing a job state.
+ * @param state The job state.
+ * @return A string, one of "queued", "running", "done", "failed", "aborted" or "unknown".
+ * @see #LIRIC_JOB_STATE
+ */
+char *Liric_Job_State_To_String(enum LIRIC_JOB_STATE state)
+{
+	switch(state)
+	{
+		case LIRIC_JOB_STATE_QUEUED:
+			return "queued";
+		case LIRIC_JOB_STATE_RUNNING:
+			return "running";
+		case LIRIC_JOB_STATE_DONE:
+			return "done";
+		case LIRIC_JOB_STATE_FAILED:
+			return "failed";
+		case LIRIC_JOB_STATE_ABORTED:
+			return "aborted";
+		default:
+			return "unknown";
+	}
+}
+
+/* ----------------------------------------------------------------------------
+** 		internal functions
+** ---------------------------------------------------------------------------- */
+/**
+ * The job thread.
+ * <ul>
+ * <li>We name the thread "job" in the trace, and set the exposure thread priority.
+ * <li>We lock the job mutex, put the job into the LIRIC_JOB_STATE_RUNNING state, copy the job parameters and
+ *     unlock the mutex.
+ * <li>We call Liric_Multrun, Liric_Bias_Dark_MultBias or Liric_Bias_Dark_MultDark, depending on the job type,
+ *     timed as a trace span. Each frame saved is recorded in the job by Liric_Job_Frame_Saved.
+ * <li>We lock the job mutex, and put the job into the LIRIC_JOB_STATE_DONE, LIRIC_JOB_STATE_FAILED or
+ *     LIRIC_JOB_STATE_ABORTED state, saving the error string on failure. We set Job_Data.Current_Index to -1,
+ *     release the detector claim made by Liric_Job_Submit, broadcast the job condition and unlock the mutex.
+ *     The job id and state are copied before the mutex is unlocked, as the job slot can then be re-used.
+ * <li>We free the filename list returned by the multrun.
+ * </ul>
+ * @param arg The index of the job in Job_Data.Job_List, cast to a void pointer.
+ * @return The routine always returns NULL.
+ * @see #Job_Data
+ * @see #Liric_Job_Frame_Saved
+ * @see liric_general.html#Liric_General_Error
+ * @see liric_general.html#Liric_General_Error_Number
+ * @see liric_general.html#Liric_General_Error_String
+ * @see liric_general.html#Liric_General_Mutex_Lock
+ * @see liric_general.html#Liric_General_Mutex_Unlock
+ * @see liric_general.html#Liric_General_Thread_Priority_Set_Exposure
+ * @see liric_multrun.html#Liric_Multrun
+ * @see liric_bias_dark.html#Liric_Bias_Dark_MultBias
+ * @see liric_bias_dark.html#Liric_Bias_Dark_MultDark
+ * @see ../detector/cdocs/detector_fits_filename.html#Detector_Fits_Filename_List_Free
+ * @see ../detector/cdocs/detector_trace.html#Detector_Trace_Thread_Name_Set
+ * @see ../detector/cdocs/detector_trace.html#Detector_Trace_Span_Start
+ * @see ../detector/cdocs/detector_trace.html#Detector_Trace_Span_End
+ */
+static void *Job_Thread(void *arg)
+{
+	struct Job_Struct *job = NULL;
+	struct timespec trace_time;
+	enum LIRIC_JOB_TYPE type;
+	enum LIRIC_JOB_STATE state;
+	char **filename_list = NULL;
+	int job_id,index,exposure_length_ms,exposure_count,do_standard,filename_count,retval;
+
+	index = (int)(intptr_t)arg;
+	job = &(Job_Data.Job_List[index]);
+	Detector_Trace_Thread_Name_Set("job");
+	if(!Liric_General_Thread_Priority_Set_Exposure())
+		Liric_General_Error("job","liric_job.c","Job_Thread",LOG_VERBOSITY_TERSE,"JOB");
+	/* the job slot cannot be re-used whilst this job is in progress, so the job is only locked to
+	** synchronise with the clients reading it's status */
+	pthread_mutex_lock(&(Job_Data.Mutex));
+	job->Status.State = LIRIC_JOB_STATE_RUNNING;
+	clock_gettime(CLOCK_REALTIME,&(job->Last_Frame_Time));
+	type = job->Status.Type;
+	exposure_length_ms = job->Status.Exposure_Length_Ms;
+	exposure_count = job->Status.Exposure_Count;
+	do_standard = job->Do_Standard;
+	pthread_cond_broadcast(&(Job_Data.Condition));
+	pthread_mutex_unlock(&(Job_Data.Mutex));
+	/* do the job */
+	Detector_Trace_Span_Start(&trace_time);
+	if(type == LIRIC_JOB_TYPE_MULTRUN)
+		retval = Liric_Multrun(exposure_length_ms,exposure_count,do_standard,&filename_list,&filename_count);
+	else if(type == LIRIC_JOB_TYPE_MULTBIAS)
+		retval = Liric_Bias_Dark_MultBias(exposure_count,&filename_list,&filename_count);
+	else
+		retval = Liric_Bias_Dark_MultDark(exposure_length_ms,exposure_count,&filename_list,&filename_count);
+	Detector_Trace_Span_End("job",Liric_Job_Type_To_String(type),NULL,&trace_time);
+	/* update job state */
+	pthread_mutex_lock(&(Job_Data.Mutex));
+	if(retval)
+		job->Status.State = LIRIC_JOB_STATE_DONE;
+	else
+	{
+		if(job->Abort_Requested)
+			job->Status.State = LIRIC_JOB_STATE_ABORTED;
+		else
+			job->Status.State = LIRIC_JOB_STATE_FAILED;
+		snprintf(job->Status.Error_String,LIRIC_JOB_ERROR_STRING_LENGTH,"Error(%d):%s",
+			 Liric_General_Error_Number,Liric_General_Error_String);
+	}
+	clock_gettime(CLOCK_REALTIME,&(job->Status.End_Time));
+	job_id = job->Status.Id;
+	state = job->Status.State;
+	Job_Data.Current_Index = -1;
+	Job_Data.Detector_Claimed = FALSE;
+	pthread_cond_broadcast(&(Job_Data.Condition));
+	pthread_mutex_unlock(&(Job_Data.Mutex));
+	if(!retval)
+		Liric_General_Error("job","liric_job.c","Job_Thread",LOG_VERBOSITY_TERSE,"JOB");
+#if LIRIC_DEBUG > 1
+	Liric_General_Log_Format("job","liric_job.c","Job_Thread",LOG_VERBOSITY_TERSE,"JOB",
+				 "Job %d finished with state %s.",job_id,Liric_Job_State_To_String(state));
+#endif
+	if(filename_list != NULL)
+		Detector_Fits_Filename_List_Free(&filename_list,&filename_count);
+	return NULL;
+}
+
+/**
+ * Find a job in the job list. This should be called with Job_Data.Mutex held.
+ * @param job_id The id of the job to find.
+ * @param index The address of an integer, on a successful return filled in with the index of the job in
+ *        Job_Data.Job_List.
+ * @return The routine returns TRUE if the job was found, and FALSE if the job id is unknown (never submitted,
+ *         or so old it's slot has been re-used).
+ * @see #Job_Data
+ * @see #LIRIC_JOB_MAX_COUNT
+ * @see liric_general.html#Liric_General_Error_Number
+ * @see liric_general.html#Liric_General_Error_String
+ */
+static int Job_Find(int job_id,int *index)
+{
+	if((job_id < 1)||(Job_Data.Job_List[job_id % LIRIC_JOB_MAX_COUNT].Status.Id != job_id))
+	{
+		Liric_General_Error_Number = 913;
+		sprintf(Liric_General_Error_String,"Job_Find:Unknown job id %d.",job_id);
+		return FALSE;
+	}
+	(*index) = job_id % LIRIC_JOB_MAX_COUNT;
+	return TRUE;
+}
@@ -0,0 +1,1049 @@
+/* liric_log_binary.c
+** Liric binary log routines
+*/
+/**
+ * Binary structured log routines for the liric program. Rather than formatting each log message into text,
+ * the message's arguments are packed (according to the conversions in its format string) into a compact binary
+ * record, tagged with a message id and timestamp. The format string itself is written once per log file, in a
+ * definition record for the message id. The records are written into hourly binary log files, and turned back into
+ * text or CSV offline by liric_log_decode.
+ * @author Chris Mottram
+ * @version $Revision$
+ */
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_SOURCE 1
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_C_SOURCE 199309L
+#include <ctype.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "liric_general.h"
+#include "liric_log_binary.h"
+
+/* hash defines */
+/**
+ * Length of some filenames.
+ */
+#define BINARY_FILENAME_LENGTH		(256)
+/**
+ * The number of entries in the format string to message id hash table. This must be a power of two.
+ * The table is cleared (and the definitions re-written) when it becomes three quarters full.
+ */
+#define BINARY_MESSAGE_TABLE_LENGTH	(4096)
+/**
+ * The maximum length of one printf conversion specification, e.g. "%-+08.3lf".
+ */
+#define BINARY_SPEC_LENGTH		(32)
+
+/* enums */
+/**
+ * Enum of the printf length modifiers we understand.
+ * <ul>
+ * <li>LENGTH_MODIFIER_NONE
+ * <li>LENGTH_MODIFIER_HH
+ * <li>LENGTH_MODIFIER_H
+ * <li>LENGTH_MODIFIER_L
+ * <li>LENGTH_MODIFIER_LL
+ * <li>LENGTH_MODIFIER_J
+ * <li>LENGTH_MODIFIER_Z
+ * <li>LENGTH_MODIFIER_T
+ * <li>LENGTH_MODIFIER_LONG_DOUBLE
+ * </ul>
+ */
+enum LENGTH_MODIFIER
+{
+	LENGTH_MODIFIER_NONE=0,LENGTH_MODIFIER_HH,LENGTH_MODIFIER_H,LENGTH_MODIFIER_L,LENGTH_MODIFIER_LL,
+	LENGTH_MODIFIER_J,LENGTH_MODIFIER_Z,LENGTH_MODIFIER_T,LENGTH_MODIFIER_LONG_DOUBLE
+};
+
+/* data types */
+/**
+ * Data type holding one entry in the format string to message id hash table.
+ * <dl>
+ * <dt>Format</dt> <dd>The format string pointer (the key). Format strings are string literals, so the pointer
+ *     identifies the message.</dd>
+ * <dt>Message_Id</dt> <dd>The message id assigned to the format string in the current log file.</dd>
+ * </dl>
+ */
+struct Binary_Message_Struct
+{
+	char *Format;
+	uint32_t Message_Id;
+};
+
+/**
+ * Data type holding local data to liric_log_binary:
+ * <dl>
+ * <dt>Mutex</dt> <dd>Mutex held whilst writing to the log file and using the message table.</dd>
+ * <dt>Directory</dt> <dd>The directory to write the binary log files into.</dd>
+ * <dt>Filename_Root</dt> <dd>The root of the binary log filenames.</dd>
+ * <dt>Filename</dt> <dd>The current binary log filename.</dd>
+ * <dt>Fp</dt> <dd>The file pointer of the open binary log file, or NULL.</dd>
+ * <dt>Next_Message_Id</dt> <dd>The next message id to assign.</dd>
+ * <dt>Message_Count</dt> <dd>The number of entries in Message_Table.</dd>
+ * <dt>Message_Table</dt> <dd>Hash table of format string to message id, for the messages defined in the current
+ *     log file.</dd>
+ * </dl>
+ * @see #BINARY_FILENAME_LENGTH
+ * @see #BINARY_MESSAGE_TABLE_LENGTH
+ */
+struct Binary_Struct
+{
+	pthread_mutex_t Mutex;
+	char Directory[BINARY_FILENAME_LENGTH];
+	char Filename_Root[BINARY_FILENAME_LENGTH];
+	char Filename[BINARY_FILENAME_LENGTH];
+	FILE *Fp;
+	uint32_t Next_Message_Id;
+	int Message_Count;
+	struct Binary_Message_Struct Message_Table[BINARY_MESSAGE_TABLE_LENGTH];
+};
+
+/* internal data */
+/**
+ * Revision Control System identifier.
+ */
+static char rcsid[] = "$Id$";
+/**
+ * The instance of Binary_Struct that contains local data for this module.
+ * This is statically initialised to the following:
+ * <dl>
+ * <dt>Mutex</dt> <dd>PTHREAD_MUTEX_INITIALIZER</dd>
+ * <dt>Directory</dt> <dd>""</dd>
+ * <dt>Filename_Root</dt> <dd>liric_c_binary_log</dd>
+ * <dt>Filename</dt> <dd>""</dd>
+ * <dt>Fp</dt> <dd>NULL</dd>
+ * <dt>Next_Message_Id</dt> <dd>1</dd>
+ * <dt>Message_Count</dt> <dd>0</dd>
+ * <dt>Message_Table</dt> <dd>All NULL</dd>
+ * </dl>
+ * @see #Binary_Struct
+ */
+static struct Binary_Struct Binary_Data =
+{
+	PTHREAD_MUTEX_INITIALIZER,"","liric_c_binary_log","",NULL,1,0,
+};
+
+/* internal functions */
+static int Binary_Pack_Arg(char *packed_args,int packed_args_length,int *packed_length,char type,
+			   void *value,int value_length);
+static int Binary_Pack_String(char *packed_args,int packed_args_length,int *packed_length,char *value);
+static int Binary_String_Length(char *string,int max_length);
+static char *Binary_Parse_Spec(char *spec_start,int *star_count,enum LENGTH_MODIFIER *length_modifier);
+static int Binary_Unpack_Arg(char *packed_args,int packed_length,int *offset,char *type,int64_t *integer_value,
+			     double *double_value,char *string_value,int string_length);
+static void Binary_Hourly_Filename_Get(char *filename);
+static int Binary_File_Check(void);
+static int Binary_Message_Id_Get(char *sub_system,char *format,struct timespec timestamp,uint32_t *message_id);
+static int Binary_Record_Write(int type,int level,int arg_count,uint32_t message_id,struct timespec timestamp,
+			       char *payload,int payload_length);
+
+/* ----------------------------------------------------------------------------
+** 		external functions
+** ---------------------------------------------------------------------------- */
+/**
+ * Set the directory the binary log files are written into.
+ * @param directory The directory name.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Binary_Data
+ * @see #BINARY_FILENAME_LENGTH
+ */
+int Liric_Log_Binary_Set_Directory(char *directory)
+{
+	if(directory == NULL)
+	{
+		Liric_General_Error_Number = 800;
+		sprintf(Liric_General_Error_String,"Liric_Log_Binary_Set_Directory:Directory is NULL.");
+		return FALSE;
+	}
+	if(strlen(directory) >= BINARY_FILENAME_LENGTH)
+	{
+		Liric_General_Error_Number = 801;
+		sprintf(Liric_General_Error_String,"Liric_Log_Binary_Set_Directory:Directory too long (%lu).",
+			strlen(directory));
+		return FALSE;
+	}
+	strcpy(Binary_Data.Directory,directory);
+	return TRUE;
+}
+
+/**
+ * Set the root of the binary log filenames. The files are called &lt;root&gt;_&lt;day of year&gt;_&lt;hour&gt;.bin.
+ * @param filename_root The filename root.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Binary_Data
+ * @see #BINARY_FILENAME_LENGTH
+ */
+int Liric_Log_Binary_Set_Root(char *filename_root)
+{
+	if(filename_root == NULL)
+	{
+		Liric_General_Error_Number = 802;
+		sprintf(Liric_General_Error_String,"Liric_Log_Binary_Set_Root:Filename root is NULL.");
+		return FALSE;
+	}
+	if(strlen(filename_root) >= BINARY_FILENAME_LENGTH)
+	{
+		Liric_General_Error_Number = 803;
+		sprintf(Liric_General_Error_String,"Liric_Log_Binary_Set_Root:Filename root too long (%lu).",
+			strlen(filename_root));
+		return FALSE;
+	}
+	strcpy(Binary_Data.Filename_Root,filename_root);
+	return TRUE;
+}
+
+/**
+ * Pack the arguments of a log message into a buffer, without formatting them. We walk the format string,
+ * and for each conversion specification retrieve the argument(s) from ap using the type implied by the
+ * conversion and length modifier, and append them to the buffer with a type tag:
+ * <ul>
+ * <li>'*' field widths and precisions are packed as 32 bit integers.
+ * <li>Integer conversions (d,i,o,u,x,X,c) are packed as 32 bit integers, unless they have a l, ll, j, z or t length
+ *     modifier, in which case they are packed as 64 bit integers.
+ * <li>Floating point conversions (f,F,e,E,g,G,a,A) are packed as doubles.
+ * <li>String conversions (s) are packed as a 16 bit length and the characters (truncated to
+ *     LIRIC_LOG_BINARY_MAX_STRING_LENGTH).
+ * <li>Pointer conversions (p) are packed as a 64 bit integer.
+ * <li>%n conversions are skipped, %% does not take an argument.
+ * </ul>
+ * If the buffer is too small, the remaining arguments are not packed (and are shown as missing when decoded).
+ * This routine is called on the logging thread, so it must be cheap, and must not log.
+ * @param format The message format string, as passed to a printf style logging routine.
+ * @param ap The message arguments.
+ * @param packed_args The buffer to pack the arguments into.
+ * @param packed_args_length The length of the buffer.
+ * @param arg_count The address of an integer, on return filled in with the number of packed arguments.
+ * @param packed_length The address of an integer, on return filled in with the number of bytes used in the buffer.
+ * @return The routine returns TRUE if all the arguments were packed, and FALSE if the buffer was too small,
+ *         or the format contained a conversion we don't understand (the arguments before it are still packed).
+ * @see #Binary_Parse_Spec
+ * @see #Binary_Pack_Arg
+ * @see #Binary_Pack_String
+ * @see #LIRIC_LOG_BINARY_ARG_TYPE_INT32
+ * @see #LIRIC_LOG_BINARY_ARG_TYPE_INT64
+ * @see #LIRIC_LOG_BINARY_ARG_TYPE_DOUBLE
+ * @see #LIRIC_LOG_BINARY_ARG_TYPE_POINTER
+ */
+int Liric_Log_Binary_Pack(char *format,va_list ap,char *packed_args,int packed_args_length,
+			  int *arg_count,int *packed_length)
+{
+	enum LENGTH_MODIFIER length_modifier;
+	char *ch = NULL;
+	int32_t integer32_value;
+	int64_t integer64_value;
+	double double_value;
+	int i,star_count;
+
+	(*arg_count) = 0;
+	(*packed_length) = 0;
+	if(format == NULL)
+		return TRUE;
+	ch = format;
+	while((*ch) != '\0')
+	{
+		if((*ch) != '%')
+		{
+			ch++;
+			continue;
+		}
+		ch = Binary_Parse_Spec(ch,&star_count,&length_modifier);
+		if(ch == NULL)
+			return FALSE;
+		/* '*' field widths and precisions come before the argument */
+		for(i = 0; i < star_count; i++)
+		{
+			integer32_value = va_arg(ap,int);
+			if(!Binary_Pack_Arg(packed_args,packed_args_length,packed_length,
+					    LIRIC_LOG_BINARY_ARG_TYPE_INT32,&integer32_value,sizeof(int32_t)))
+				return FALSE;
+			(*arg_count)++;
+		}
+		switch(*ch)
+		{
+			case '%':
+				break;
+			case 'd': case 'i': case 'o': case 'u': case 'x': case 'X': case 'c':
+				switch(length_modifier)
+				{
+					case LENGTH_MODIFIER_L:
+						integer64_value = (int64_t)va_arg(ap,long);
+						break;
+					case LENGTH_MODIFIER_LL:
+						integer64_value = (int64_t)va_arg(ap,long long);
+						break;
+					case LENGTH_MODIFIER_J:
+						integer64_value = (int64_t)va_arg(ap,intmax_t);
+						break;
+					case LENGTH_MODIFIER_Z:
+						integer64_value = (int64_t)va_arg(ap,size_t);
+						break;
+					case LENGTH_MODIFIER_T:
+						integer64_value = (int64_t)va_arg(ap,ptrdiff_t);
+						break;
+					default:
+						integer32_value = (int32_t)va_arg(ap,int);
+						if(!Binary_Pack_Arg(packed_args,packed_args_length,packed_length,
+								    LIRIC_LOG_BINARY_ARG_TYPE_INT32,&integer32_value,
+								    sizeof(int32_t)))
+							return FALSE;
+						(*arg_count)++;
+						ch++;
+						continue;
+				}
+				if(!Binary_Pack_Arg(packed_args,packed_args_length,packed_length,
+						    LIRIC_LOG_BINARY_ARG_TYPE_INT64,&integer64_value,sizeof(int64_t)))
+					return FALSE;
+				(*arg_count)++;
+				break;
+			case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+				if(length_modifier == LENGTH_MODIFIER_LONG_DOUBLE)
+					double_value = (double)va_arg(ap,long double);
+				else
+					double_value = va_arg(ap,double);
+				if(!Binary_Pack_Arg(packed_args,packed_args_length,packed_length,
+						    LIRIC_LOG_BINARY_ARG_TYPE_DOUBLE,&double_value,sizeof(double)))
+					return FALSE;
+				(*arg_count)++;
+				break;
+			case 's':
+				if(!Binary_Pack_String(packed_args,packed_args_length,packed_length,va_arg(ap,char *)))
+					return FALSE;
+				(*arg_count)++;
+				break;
+			case 'p':
+				integer64_value = (int64_t)(intptr_t)va_arg(ap,void *);
+				if(!Binary_Pack_Arg(packed_args,packed_args_length,packed_length,
+						    LIRIC_LOG_BINARY_ARG_TYPE_POINTER,&integer64_value,sizeof(int64_t)))
+					return FALSE;
+				(*arg_count)++;
+				break;
+			case 'n':
+				/* never write through a log argument, just skip it */
+				va_arg(ap,void *);
+				break;
+			default:
+				/* we don't know how big the argument is, so we can't pack any more */
+				return FALSE;
+		}
+		ch++;
+	}
+	return TRUE;
+}
+
+/**
+ * Write a message record into the current hourly binary log file. If the message's format string has not yet been
+ * written into the current file, a definition record for it is written first. The file is not flushed, call
+ * Liric_Log_Binary_Flush to do that. This routine is thread safe (it holds Binary_Data.Mutex).
+ * Failures to open or write the file are reported on stderr, as we can't log them.
+ * @param timestamp The time the message was logged.
+ * @param level The log level of the message.
+ * @param sub_system The sub system that logged the message. Can be NULL.
+ * @param format The message format string. This must remain valid (e.g. be a string literal), as it is used as
+ *        the key for the message id.
+ * @param arg_count The number of packed arguments.
+ * @param packed_args The packed arguments, as returned by Liric_Log_Binary_Pack.
+ * @param packed_length The length of the packed arguments, in bytes.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Binary_Data
+ * @see #Binary_File_Check
+ * @see #Binary_Message_Id_Get
+ * @see #Binary_Record_Write
+ * @see #LIRIC_LOG_BINARY_RECORD_TYPE_MESSAGE
+ */
+int Liric_Log_Binary_Write(struct timespec timestamp,int level,char *sub_system,char *format,
+			   int arg_count,char *packed_args,int packed_length)
+{
+	uint32_t message_id;
+	int retval;
+
+	if(format == NULL)
+		return FALSE;
+	pthread_mutex_lock(&(Binary_Data.Mutex));
+	retval = Binary_File_Check();
+	if(retval)
+		retval = Binary_Message_Id_Get(sub_system,format,timestamp,&message_id);
+	if(retval)
+	{
+		retval = Binary_Record_Write(LIRIC_LOG_BINARY_RECORD_TYPE_MESSAGE,level,arg_count,message_id,timestamp,
+					     packed_args,packed_length);
+	}
+	pthread_mutex_unlock(&(Binary_Data.Mutex));
+	return retval;
+}
+
+/**
+ * Flush the current binary log file, if it is open.
+ * @see #Binary_Data
+ */
+void Liric_Log_Binary_Flush(void)
+{
+	pthread_mutex_lock(&(Binary_Data.Mutex));
+	if(Binary_Data.Fp != NULL)
+		fflush(Binary_Data.Fp);
+	pthread_mutex_unlock(&(Binary_Data.Mutex));
+}
+
+/**
+ * Reconstruct the text of a message from its format string and packed arguments. Each conversion specification
+ * in the format is formatted with snprintf, using the next packed argument cast to the type the conversion
+ * expects. Missing (or mismatched) arguments are shown as "&lt;?&gt;".
+ * @param format The message format string, from the message id's definition record.
+ * @param arg_count The number of packed arguments.
+ * @param packed_args The packed arguments.
+ * @param packed_length The length of the packed arguments, in bytes.
+ * @param message A buffer to fill with the reconstructed message.
+ * @param message_length The length of the message buffer.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Binary_Parse_Spec
+ * @see #Binary_Unpack_Arg
+ * @see #BINARY_SPEC_LENGTH
+ */
+int Liric_Log_Binary_Format(char *format,int arg_count,char *packed_args,int packed_length,
+			    char *message,int message_length)
+{
+	enum LENGTH_MODIFIER length_modifier;
+	char spec[BINARY_SPEC_LENGTH];
+	char expanded_spec[BINARY_SPEC_LENGTH*2];
+	char string_value[LIRIC_LOG_BINARY_MAX_STRING_LENGTH+1];
+	char buff[LIRIC_LOG_BINARY_MAX_STRING_LENGTH+64];
+	char *ch = NULL;
+	char *spec_end = NULL;
+	char *spec_ch = NULL;
+	char type;
+	int64_t integer_value,star_value;
+	double double_value;
+	int offset,star_count,i,message_index,spec_index,buff_length,missing;
+
+	if((format == NULL)||(message == NULL)||(message_length < 1))
+	{
+		Liric_General_Error_Number = 804;
+		sprintf(Liric_General_Error_String,"Liric_Log_Binary_Format:Illegal arguments (%p,%p,%d).",
+			format,message,message_length);
+		return FALSE;
+	}
+	offset = 0;
+	message_index = 0;
+	message[0] = '\0';
+	ch = format;
+	while(((*ch) != '\0')&&(message_index < (message_length-1)))
+	{
+		if((*ch) != '%')
+		{
+			message[message_index++] = (*ch);
+			ch++;
+			continue;
+		}
+		spec_end = Binary_Parse_Spec(ch,&star_count,&length_modifier);
+		if((spec_end == NULL)||((spec_end-ch+1) >= BINARY_SPEC_LENGTH))
+		{
+			/* copy the rest of the format verbatim */
+			strncpy(message+message_index,ch,message_length-message_index-1);
+			message[message_length-1] = '\0';
+			return TRUE;
+		}
+		strncpy(spec,ch,spec_end-ch+1);
+		spec[spec_end-ch+1] = '\0';
+		missing = FALSE;
+		/* substitute any '*' widths/precisions with their packed values */
+		spec_index = 0;
+		for(spec_ch = spec; (*spec_ch) != '\0'; spec_ch++)
+		{
+			if((*spec_ch) == '*')
+			{
+				if(!Binary_Unpack_Arg(packed_args,packed_length,&offset,&type,&star_value,&double_value,
+						      string_value,sizeof(string_value)))
+				{
+					missing = TRUE;
+					star_value = 0;
+				}
+				spec_index += sprintf(expanded_spec+spec_index,"%d",(int)star_value);
+			}
+			else
+				expanded_spec[spec_index++] = (*spec_ch);
+		}
+		expanded_spec[spec_index] = '\0';
+		buff[0] = '\0';
+		switch(*spec_end)
+		{
+			case '%':
+				strcpy(buff,"%");
+				break;
+			case 'n':
+				break;
+			case 'd': case 'i': case 'o': case 'u': case 'x': case 'X': case 'c': case 'p':
+				if(!Binary_Unpack_Arg(packed_args,packed_length,&offset,&type,&integer_value,&double_value,
+						      string_value,sizeof(string_value)))
+				{
+					missing = TRUE;
+					break;
+				}
+				if((type != LIRIC_LOG_BINARY_ARG_TYPE_INT32)&&(type != LIRIC_LOG_BINARY_ARG_TYPE_INT64)&&
+				   (type != LIRIC_LOG_BINARY_ARG_TYPE_POINTER))
+				{
+					missing = TRUE;
+					break;
+				}
+				if((*spec_end) == 'p')
+					snprintf(buff,sizeof(buff),expanded_spec,(void *)(intptr_t)integer_value);
+				else if(((*spec_end) == 'd')||((*spec_end) == 'i'))
+				{
+					switch(length_modifier)
+					{
+						case LENGTH_MODIFIER_L:
+							snprintf(buff,sizeof(buff),expanded_spec,(long)integer_value);
+							break;
+						case LENGTH_MODIFIER_LL:
+							snprintf(buff,sizeof(buff),expanded_spec,(long long)integer_value);
+							break;
+						case LENGTH_MODIFIER_J:
+							snprintf(buff,sizeof(buff),expanded_spec,(intmax_t)integer_value);
+							break;
+						case LENGTH_MODIFIER_Z:
+							snprintf(buff,sizeof(buff),expanded_spec,(ssize_t)integer_value);
+							break;
+						case LENGTH_MODIFIER_T:
+							snprintf(buff,sizeof(buff),expanded_spec,(ptrdiff_t)integer_value);
+							break;
+						default:
+							snprintf(buff,sizeof(buff),expanded_spec,(int)integer_value);
+							break;
+					}
+				}
+				else
+				{
+					switch(length_modifier)
+					{
+						case LENGTH_MODIFIER_L:
+							snprintf(buff,sizeof(buff),expanded_spec,(unsigned long)integer_value);
+							break;
+						case LENGTH_MODIFIER_LL:
+							snprintf(buff,sizeof(buff),expanded_spec,
+								 (unsigned long long)integer_value);
+							break;
+						case LENGTH_MODIFIER_J:
+							snprintf(buff,sizeof(buff),expanded_spec,(uintmax_t)integer_value);
+							break;
+						case LENGTH_MODIFIER_Z:
+							snprintf(buff,sizeof(buff),expanded_spec,(size_t)integer_value);
+							break;
+						case LENGTH_MODIFIER_T:
+							snprintf(buff,sizeof(buff),expanded_spec,(ptrdiff_t)integer_value);
+							break;
+						default:
+							snprintf(buff,sizeof(buff),expanded_spec,(unsigned int)integer_value);
+							break;
+					}
+				}
+				break;
+			case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+				if((!Binary_Unpack_Arg(packed_args,packed_length,&offset,&type,&integer_value,&double_value,
+						       string_value,sizeof(string_value)))||
+				   (type != LIRIC_LOG_BINARY_ARG_TYPE_DOUBLE))
+				{
+					missing = TRUE;
+					break;
+				}
+				if(length_modifier == LENGTH_MODIFIER_LONG_DOUBLE)
+					snprintf(buff,sizeof(buff),expanded_spec,(long double)double_value);
+				else
+					snprintf(buff,sizeof(buff),expanded_spec,double_value);
+				break;
+			case 's':
+				if((!Binary_Unpack_Arg(packed_args,packed_length,&offset,&type,&integer_value,&double_value,
+						       string_value,sizeof(string_value)))||
+				   (type != LIRIC_LOG_BINARY_ARG_TYPE_STRING))
+				{
+					missing = TRUE;
+					break;
+				}
+				snprintf(buff,sizeof(buff),expanded_spec,string_value);
+				break;
+			default:
+				missing = TRUE;
+				break;
+		}
+		if(missing)
+			strcpy(buff,"<?>");
+		buff_length = strlen(buff);
+		for(i = 0; (i < buff_length)&&(message_index < (message_length-1)); i++)
+			message[message_index++] = buff[i];
+		ch = spec_end+1;
+	}
+	message[message_index] = '\0';
+	return TRUE;
+}
+
+/**
+ * Convert the packed arguments of a message into comma separated values. Integers are written in decimal,
+ * doubles with 9 significant figures, pointers in hexadecimal, and strings in double quotes (with embedded
+ * double quotes doubled).
+ * @param arg_count The number of packed arguments.
+ * @param packed_args The packed arguments.
+ * @param packed_length The length of the packed arguments, in bytes.
+ * @param csv_string A buffer to fill with the comma separated values.
+ * @param csv_length The length of the buffer.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Binary_Unpack_Arg
+ */
+int Liric_Log_Binary_Args_To_CSV(int arg_count,char *packed_args,int packed_length,
+				 char *csv_string,int csv_length)
+{
+	char string_value[LIRIC_LOG_BINARY_MAX_STRING_LENGTH+1];
+	char buff[(LIRIC_LOG_BINARY_MAX_STRING_LENGTH*2)+64];
+	char type;
+	int64_t integer_value;
+	double double_value;
+	int offset,arg_index,csv_index,buff_index,i;
+
+	if((csv_string == NULL)||(csv_length < 1))
+	{
+		Liric_General_Error_Number = 805;
+		sprintf(Liric_General_Error_String,"Liric_Log_Binary_Args_To_CSV:Illegal arguments (%p,%d).",
+			csv_string,csv_length);
+		return FALSE;
+	}
+	offset = 0;
+	csv_index = 0;
+	csv_string[0] = '\0';
+	for(arg_index = 0; arg_index < arg_count; arg_index++)
+	{
+		if(!Binary_Unpack_Arg(packed_args,packed_length,&offset,&type,&integer_value,&double_value,
+				      string_value,sizeof(string_value)))
+			break;
+		buff_index = 0;
+		if(arg_index > 0)
+			buff[buff_index++] = ',';
+		switch(type)
+		{
+			case LIRIC_LOG_BINARY_ARG_TYPE_INT32:
+			case LIRIC_LOG_BINARY_ARG_TYPE_INT64:
+				buff_index += sprintf(buff+buff_index,"%lld",(long long)integer_value);
+				break;
+			case LIRIC_LOG_BINARY_ARG_TYPE_POINTER:
+				buff_index += sprintf(buff+buff_index,"0x%llx",(unsigned long long)integer_value);
+				break;
+			case LIRIC_LOG_BINARY_ARG_TYPE_DOUBLE:
+				buff_index += sprintf(buff+buff_index,"%.9g",double_value);
+				break;
+			case LIRIC_LOG_BINARY_ARG_TYPE_STRING:
+				buff[buff_index++] = '"';
+				for(i = 0; string_value[i] != '\0'; i++)
+				{
+					if(string_value[i] == '"')
+						buff[buff_index++] = '"';
+					buff[buff_index++] = string_value[i];
+				}
+				buff[buff_index++] = '"';
+				break;
+		}
+		buff[buff_index] = '\0';
+		if((csv_index+buff_index) >= csv_length)
+			break;
+		strcpy(csv_string+csv_index,buff);
+		csv_index += buff_index;
+	}
+	return TRUE;
+}
+
+/* ----------------------------------------------------------------------------
+** 		internal functions
+** ---------------------------------------------------------------------------- */
+/**
+ * Append a type tag and a fixed length value to the packed arguments buffer.
+ * @param packed_args The buffer to pack the argument into.
+ * @param packed_args_length The length of the buffer.
+ * @param packed_length The address of the number of bytes used in the buffer, updated on success.
+ * @param type The type tag, e.g. LIRIC_LOG_BINARY_ARG_TYPE_INT32.
+ * @param value A pointer to the value to pack.
+ * @param value_length The length of the value, in bytes.
+ * @return The routine returns TRUE on success, and FALSE if the buffer is too small.
+ */
+static int Binary_Pack_Arg(char *packed_args,int packed_args_length,int *packed_length,char type,
+			   void *value,int value_length)
+{
+	if(((*packed_length)+1+value_length) > packed_args_length)
+		return FALSE;
+	packed_args[(*packed_length)++] = type;
+	memcpy(packed_args+(*packed_length),value,value_length);
+	(*packed_length) += value_length;
+	return TRUE;
+}
+
+/**
+ * Append a string argument (type tag, 16 bit length and characters) to the packed arguments buffer.
+ * NULL strings are packed as "(null)", as printf would print them. Strings longer than
+ * LIRIC_LOG_BINARY_MAX_STRING_LENGTH are truncated.
+ * @param packed_args The buffer to pack the argument into.
+ * @param packed_args_length The length of the buffer.
+ * @param packed_length The address of the number of bytes used in the buffer, updated on success.
+ * @param value The string to pack.
+ * @return The routine returns TRUE on success, and FALSE if the buffer is too small.
+ * @see #LIRIC_LOG_BINARY_ARG_TYPE_STRING
+ * @see #LIRIC_LOG_BINARY_MAX_STRING_LENGTH
+ */
+static int Binary_Pack_String(char *packed_args,int packed_args_length,int *packed_length,char *value)
+{
+	uint16_t string_length;
+
+	if(value == NULL)
+		value = "(null)";
+	string_length = (uint16_t)Binary_String_Length(value,LIRIC_LOG_BINARY_MAX_STRING_LENGTH);
+	if(((*packed_length)+1+sizeof(uint16_t)+string_length) > packed_args_length)
+		return FALSE;
+	packed_args[(*packed_length)++] = LIRIC_LOG_BINARY_ARG_TYPE_STRING;
+	memcpy(packed_args+(*packed_length),&string_length,sizeof(uint16_t));
+	(*packed_length) += sizeof(uint16_t);
+	memcpy(packed_args+(*packed_length),value,string_length);
+	(*packed_length) += string_length;
+	return TRUE;
+}
+
+/**
+ * Get the length of a string, up to a maximum length (strnlen is not available at our POSIX level).
+ * @param string The string.
+ * @param max_length The maximum length to return.
+ * @return The length of the string, or max_length if the string is longer.
+ */
+static int Binary_String_Length(char *string,int max_length)
+{
+	char *end = NULL;
+
+	end = memchr(string,'\0',max_length);
+	if(end == NULL)
+		return max_length;
+	return end-string;
+}
+
+/**
+ * Parse a printf conversion specification (flags, field width, precision and length modifier).
+ * @param spec_start A pointer to the '%' starting the specification.
+ * @param star_count The address of an integer, on return filled in with the number of '*' field width/precision
+ *        arguments the specification takes.
+ * @param length_modifier The address of an enum, on return filled in with the length modifier.
+ * @return A pointer to the conversion character (which may be '%'), or NULL if the format string ended first.
+ * @see #LENGTH_MODIFIER
+ */
+static char *Binary_Parse_Spec(char *spec_start,int *star_count,enum LENGTH_MODIFIER *length_modifier)
+{
+	char *ch = spec_start+1;
+
+	(*star_count) = 0;
+	(*length_modifier) = LENGTH_MODIFIER_NONE;
+	/* flags */
+	while(((*ch) == '-')||((*ch) == '+')||((*ch) == ' ')||((*ch) == '#')||((*ch) == '0')||((*ch) == '\''))
+		ch++;
+	/* field width */
+	if((*ch) == '*')
+	{
+		(*star_count)++;
+		ch++;
+	}
+	else
+	{
+		while(isdigit((int)(*ch)))
+			ch++;
+	}
+	/* precision */
+	if((*ch) == '.')
+	{
+		ch++;
+		if((*ch) == '*')
+		{
+			(*star_count)++;
+			ch++;
+		}
+		else
+		{
+			while(isdigit((int)(*ch)))
+				ch++;
+		}
+	}
+	/* length modifier */
+	switch(*ch)
+	{
+		case 'h':
+			ch++;
+			if((*ch) == 'h')
+			{
+				(*length_modifier) = LENGTH_MODIFIER_HH;
+				ch++;
+			}
+			else
+				(*length_modifier) = LENGTH_MODIFIER_H;
+			break;
+		case 'l':
+			ch++;
+			if((*ch) == 'l')
+			{
+				(*length_modifier) = LENGTH_MODIFIER_LL;
+				ch++;
+			}
+			else
+				(*length_modifier) = LENGTH_MODIFIER_L;
+			break;
+		case 'q':
+			(*length_modifier) = LENGTH_MODIFIER_LL;
+			ch++;
+			break;
+		case 'j':
+			(*length_modifier) = LENGTH_MODIFIER_J;
+			ch++;
+			break;
+		case 'z':
+			(*length_modifier) = LENGTH_MODIFIER_Z;
+			ch++;
+			break;
+		case 't':
+			(*length_modifier) = LENGTH_MODIFIER_T;
+			ch++;
+			break;
+		case 'L':
+			(*length_modifier) = LENGTH_MODIFIER_LONG_DOUBLE;
+			ch++;
+			break;
+		default:
+			break;
+	}
+	if((*ch) == '\0')
+		return NULL;
+	return ch;
+}
+
+/**
+ * Retrieve the next packed argument.
+ * @param packed_args The packed arguments.
+ * @param packed_length The length of the packed arguments, in bytes.
+ * @param offset The address of the offset of the next argument in packed_args, updated on success.
+ * @param type The address of a character, on return filled in with the argument's type tag.
+ * @param integer_value The address of a 64 bit integer, on return filled in with the value of
+ *        integer and pointer arguments.
+ * @param double_value The address of a double, on return filled in with the value of double arguments.
+ * @param string_value A buffer, on return filled in with the (NULL terminated) value of string arguments.
+ * @param string_length The length of the string_value buffer.
+ * @return The routine returns TRUE on success, and FALSE if there are no more arguments (or they are corrupt).
+ */
+static int Binary_Unpack_Arg(char *packed_args,int packed_length,int *offset,char *type,int64_t *integer_value,
+			     double *double_value,char *string_value,int string_length)
+{
+	int32_t integer32_value;
+	uint16_t packed_string_length;
+
+	if((packed_args == NULL)||((*offset) >= packed_length))
+		return FALSE;
+	(*type) = packed_args[(*offset)++];
+	switch(*type)
+	{
+		case LIRIC_LOG_BINARY_ARG_TYPE_INT32:
+			if(((*offset)+sizeof(int32_t)) > packed_length)
+				return FALSE;
+			memcpy(&integer32_value,packed_args+(*offset),sizeof(int32_t));
+			(*integer_value) = integer32_value;
+			(*offset) += sizeof(int32_t);
+			break;
+		case LIRIC_LOG_BINARY_ARG_TYPE_INT64:
+		case LIRIC_LOG_BINARY_ARG_TYPE_POINTER:
+			if(((*offset)+sizeof(int64_t)) > packed_length)
+				return FALSE;
+			memcpy(integer_value,packed_args+(*offset),sizeof(int64_t));
+			(*offset) += sizeof(int64_t);
+			break;
+		case LIRIC_LOG_BINARY_ARG_TYPE_DOUBLE:
+			if(((*offset)+sizeof(double)) > packed_length)
+				return FALSE;
+			memcpy(double_value,packed_args+(*offset),sizeof(double));
+			(*offset) += sizeof(double);
+			break;
+		case LIRIC_LOG_BINARY_ARG_TYPE_STRING:
+			if(((*offset)+sizeof(uint16_t)) > packed_length)
+				return FALSE;
+			memcpy(&packed_string_length,packed_args+(*offset),sizeof(uint16_t));
+			(*offset) += sizeof(uint16_t);
+			if(((*offset)+packed_string_length) > packed_length)
+				return FALSE;
+			if(packed_string_length >= string_length)
+				packed_string_length = string_length-1;
+			memcpy(string_value,packed_args+(*offset),packed_string_length);
+			string_value[packed_string_length] = '\0';
+			(*offset) += packed_string_length;
+			break;
+		default:
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * Construct the current hourly binary log filename, &lt;directory&gt;/&lt;root&gt;_&lt;day of year&gt;_&lt;hour&gt;.bin
+ * (the same naming as the hourly text log files).
+ * @param filename A string of length BINARY_FILENAME_LENGTH to fill in with the filename.
+ * @see #Binary_Data
+ * @see #BINARY_FILENAME_LENGTH
+ */
+static void Binary_Hourly_Filename_Get(char *filename)
+{
+	struct tm now_tm;
+	time_t now_time;
+
+	now_time = time(NULL);
+	gmtime_r(&now_time,&now_tm);
+	if(strlen(Binary_Data.Directory) > 0)
+	{
+		snprintf(filename,BINARY_FILENAME_LENGTH,"%s/%s_%03d_%02d.bin",Binary_Data.Directory,
+			 Binary_Data.Filename_Root,now_tm.tm_yday+1,now_tm.tm_hour);
+	}
+	else
+	{
+		snprintf(filename,BINARY_FILENAME_LENGTH,"%s_%03d_%02d.bin",Binary_Data.Filename_Root,
+			 now_tm.tm_yday+1,now_tm.tm_hour);
+	}
+}
+
+/**
+ * Make sure the right hourly binary log file is open. If the hourly filename has changed (or no file is open),
+ * we close the old file and open the new one for appending. If the new file is empty, we write the magic string
+ * and version at the start of it. The message table is cleared, so each message is defined again in the new file
+ * (or in this part of an existing file). Must be called with Binary_Data.Mutex held.
+ * @return The routine returns TRUE if a file is open, and FALSE if it could not be opened.
+ * @see #Binary_Data
+ * @see #Binary_Hourly_Filename_Get
+ * @see #LIRIC_LOG_BINARY_MAGIC
+ * @see #LIRIC_LOG_BINARY_VERSION
+ */
+static int Binary_File_Check(void)
+{
+	char new_filename[BINARY_FILENAME_LENGTH];
+	uint32_t version;
+	int fopen_errno;
+
+	Binary_Hourly_Filename_Get(new_filename);
+	if((Binary_Data.Fp != NULL)&&(strcmp(new_filename,Binary_Data.Filename) == 0))
+		return TRUE;
+	if(Binary_Data.Fp != NULL)
+	{
+		fclose(Binary_Data.Fp);
+		Binary_Data.Fp = NULL;
+	}
+	strcpy(Binary_Data.Filename,new_filename);
+	Binary_Data.Fp = fopen(Binary_Data.Filename,"ab");
+	if(Binary_Data.Fp == NULL)
+	{
+		fopen_errno = errno;
+		fprintf(stderr,"Binary_File_Check:fopen '%s' failed %d.\n",Binary_Data.Filename,fopen_errno);
+		return FALSE;
+	}
+	if(ftell(Binary_Data.Fp) == 0)
+	{
+		version = LIRIC_LOG_BINARY_VERSION;
+		fwrite(LIRIC_LOG_BINARY_MAGIC,1,LIRIC_LOG_BINARY_MAGIC_LENGTH,Binary_Data.Fp);
+		fwrite(&version,sizeof(uint32_t),1,Binary_Data.Fp);
+	}
+	memset(Binary_Data.Message_Table,0,sizeof(Binary_Data.Message_Table));
+	Binary_Data.Message_Count = 0;
+	return TRUE;
+}
+
+/**
+ * Get the message id of a format string in the current log file. If the format string has not been seen in this
+ * file, we assign it the next message id, add it to the hash table, and write a definition record containing the
+ * sub system and format string. Must be called with Binary_Data.Mutex held.
+ * @param sub_system The sub system that logged the message. Can be NULL.
+ * @param format The message format string.
+ * @param timestamp The time the message was logged, used to timestamp the definition record.
+ * @param message_id The address of a message id, on return filled in.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Binary_Data
+ * @see #Binary_Record_Write
+ * @see #BINARY_MESSAGE_TABLE_LENGTH
+ * @see #LIRIC_LOG_BINARY_RECORD_TYPE_DEFINE
+ */
+static int Binary_Message_Id_Get(char *sub_system,char *format,struct timespec timestamp,uint32_t *message_id)
+{
+	char payload[LIRIC_LOG_BINARY_MAX_ARGS_LENGTH];
+	unsigned int index;
+	int sub_system_length,format_length;
+
+	index = (unsigned int)((((uintptr_t)format)>>3)*2654435761u)&(BINARY_MESSAGE_TABLE_LENGTH-1);
+	while(Binary_Data.Message_Table[index].Format != NULL)
+	{
+		if(Binary_Data.Message_Table[index].Format == format)
+		{
+			(*message_id) = Binary_Data.Message_Table[index].Message_Id;
+			return TRUE;
+		}
+		index = (index+1)&(BINARY_MESSAGE_TABLE_LENGTH-1);
+	}
+	/* a new message, if the table is getting full start again, and let the definitions be re-written */
+	if(Binary_Data.Message_Count >= ((BINARY_MESSAGE_TABLE_LENGTH*3)/4))
+	{
+		memset(Binary_Data.Message_Table,0,sizeof(Binary_Data.Message_Table));
+		Binary_Data.Message_Count = 0;
+		index = (unsigned int)((((uintptr_t)format)>>3)*2654435761u)&(BINARY_MESSAGE_TABLE_LENGTH-1);
+	}
+	Binary_Data.Message_Table[index].Format = format;
+	Binary_Data.Message_Table[index].Message_Id = Binary_Data.Next_Message_Id++;
+	Binary_Data.Message_Count++;
+	(*message_id) = Binary_Data.Message_Table[index].Message_Id;
+	/* write the definition, sub system and format as NULL terminated strings */
+	if(sub_system == NULL)
+		sub_system = "";
+	sub_system_length = Binary_String_Length(sub_system,LIRIC_LOG_BINARY_MAX_STRING_LENGTH);
+	format_length = Binary_String_Length(format,LIRIC_LOG_BINARY_MAX_ARGS_LENGTH-sub_system_length-2);
+	memcpy(payload,sub_system,sub_system_length);
+	payload[sub_system_length] = '\0';
+	memcpy(payload+sub_system_length+1,format,format_length);
+	payload[sub_system_length+1+format_length] = '\0';
+	return Binary_Record_Write(LIRIC_LOG_BINARY_RECORD_TYPE_DEFINE,0,0,(*message_id),timestamp,payload,
+				   sub_system_length+format_length+2);
+}
+
+/**
+ * Write a record header and payload into the current binary log file. Must be called with Binary_Data.Mutex held.
+ * @param type The record type.
+ * @param level The log level of the message.
+ * @param arg_count The number of packed arguments in the payload.
+ * @param message_id The message id.
+ * @param timestamp The time the message was logged.
+ * @param payload The payload.
+ * @param payload_length The length of the payload, in bytes.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Binary_Data
+ * @see #Liric_Log_Binary_Record_Header_Struct
+ */
+static int Binary_Record_Write(int type,int level,int arg_count,uint32_t message_id,struct timespec timestamp,
+			       char *payload,int payload_length)
+{
+	struct Liric_Log_Binary_Record_Header_Struct header;
+
+	if(Binary_Data.Fp == NULL)
+		return FALSE;
+	header.Length = payload_length;
+	header.Type = type;
+	header.Level = level;
+	header.Arg_Count = arg_count;
+	header.Message_Id = message_id;
+	header.Nanoseconds = timestamp.tv_nsec;
+	header.Seconds = timestamp.tv_sec;
+	if(fwrite(&header,sizeof(header),1,Binary_Data.Fp) != 1)
+		return FALSE;
+	if(payload_length > 0)
+	{
+		if(fwrite(payload,1,payload_length,Binary_Data.Fp) != payload_length)
+			return FALSE;
+	}
+	return TRUE;
+}
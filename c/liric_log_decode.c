@@ -0,0 +1,402 @@
+/* liric_log_decode.c */
+/**
+ * Liric binary log decoder. This reads one or more binary log files written by liric_log_binary, and
+ * reconstructs each message as text (in the same layout as the hourly text log files), or writes the message
+ * fields and packed arguments as CSV for offline analysis.
+ * @author $Author$
+ */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "liric_general.h"
+#include "liric_log_binary.h"
+
+/* hash defines */
+/**
+ * Length of some of the strings used in this program.
+ */
+#define STRING_LENGTH                   (256)
+/**
+ * The length of the reconstructed message / CSV argument strings.
+ */
+#define MESSAGE_LENGTH                  (4096)
+
+/* data types */
+/**
+ * Data type holding the definition of a message id, read from a definition record:
+ * <dl>
+ * <dt>Sub_System</dt> <dd>The sub system that logged the message.</dd>
+ * <dt>Format</dt> <dd>The message format string.</dd>
+ * </dl>
+ */
+struct Message_Definition_Struct
+{
+	char *Sub_System;
+	char *Format;
+};
+
+/* internal variables */
+/**
+ * Revision control system identifier.
+ */
+static char rcsid[] = "$Id$";
+/**
+ * Boolean, if TRUE write the records as CSV rather than text.
+ */
+static int CSV = FALSE;
+/**
+ * The list of binary log filenames to decode.
+ */
+static char **Filename_List = NULL;
+/**
+ * The number of filenames in Filename_List.
+ */
+static int Filename_Count = 0;
+/**
+ * The list of message definitions, indexed by message id. Reallocated as higher message ids are defined.
+ * @see #Message_Definition_Struct
+ */
+static struct Message_Definition_Struct *Definition_List = NULL;
+/**
+ * The number of entries allocated in Definition_List.
+ */
+static int Definition_Count = 0;
+
+/* internal routines */
+static int Decode_File(char *filename,int *record_count);
+static int Definition_Add(uint32_t message_id,char *payload,int payload_length);
+static void Definitions_Free(void);
+static void CSV_Header_Print(void);
+static void CSV_String_Print(char *string);
+static int Parse_Arguments(int argc, char *argv[]);
+static void Help(void);
+
+/* ------------------------------------------------------------------
+** External functions
+** ------------------------------------------------------------------ */
+/**
+ * Main program.
+ * <ul>
+ * <li>We parse the command line arguments using Parse_Arguments.
+ * <li>If we are writing CSV, we print the header row using CSV_Header_Print.
+ * <li>We decode each file in Filename_List using Decode_File.
+ * <li>We free the message definitions using Definitions_Free.
+ * </ul>
+ * @param argc The number of arguments to the program.
+ * @param argv An array of argument strings.
+ * @return This function returns 0 if the program succeeds, and a positive integer if it fails.
+ * @see #Parse_Arguments
+ * @see #CSV_Header_Print
+ * @see #Decode_File
+ * @see #Definitions_Free
+ * @see #Filename_List
+ * @see #CSV
+ */
+int main(int argc, char *argv[])
+{
+	int i,record_count,failure_count;
+
+	if(!Parse_Arguments(argc,argv))
+		return 1;
+	if(Filename_Count == 0)
+	{
+		fprintf(stderr,"liric_log_decode : No binary log files specified.\n");
+		Help();
+		return 2;
+	}
+	if(CSV)
+		CSV_Header_Print();
+	failure_count = 0;
+	for(i=0; i < Filename_Count; i++)
+	{
+		if(!Decode_File(Filename_List[i],&record_count))
+		{
+			fprintf(stderr,"liric_log_decode : Decoding '%s' failed after %d records.\n",Filename_List[i],
+				record_count);
+			failure_count++;
+		}
+	}
+	Definitions_Free();
+	if(Filename_List != NULL)
+		free(Filename_List);
+	if(failure_count > 0)
+		return 3;
+	return 0;
+}
+
+/* ------------------------------------------------------------------
+** Internal functions
+** ------------------------------------------------------------------ */
+/**
+ * Decode a binary log file.
+ * <ul>
+ * <li>We open the file, and check it starts with LIRIC_LOG_BINARY_MAGIC, and a version we understand.
+ * <li>We read each record header and payload in turn.
+ * <li>Definition records are added to the Definition_List using Definition_Add.
+ * <li>For message records, we look up the message id's definition. When writing CSV, we print the timestamp, level,
+ *     sub system, message id, format and the arguments (Liric_Log_Binary_Args_To_CSV). Otherwise we reconstruct
+ *     the message using Liric_Log_Binary_Format and print it in the same layout as the hourly text log.
+ * </ul>
+ * A truncated last record (e.g. the file is still being written) is silently ignored.
+ * @param filename The binary log filename.
+ * @param record_count The address of an integer, on return filled in with the number of records decoded.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Definition_Add
+ * @see #Definition_List
+ * @see #CSV_String_Print
+ * @see #CSV
+ * @see #MESSAGE_LENGTH
+ * @see liric_log_binary.html#Liric_Log_Binary_Record_Header_Struct
+ * @see liric_log_binary.html#Liric_Log_Binary_Format
+ * @see liric_log_binary.html#Liric_Log_Binary_Args_To_CSV
+ * @see liric_general.html#Liric_General_Get_Time_String
+ */
+static int Decode_File(char *filename,int *record_count)
+{
+	struct Liric_Log_Binary_Record_Header_Struct header;
+	struct timespec timestamp;
+	char magic[LIRIC_LOG_BINARY_MAGIC_LENGTH];
+	char payload[LIRIC_LOG_BINARY_MAX_ARGS_LENGTH];
+	char message[MESSAGE_LENGTH];
+	char time_string[32];
+	char *sub_system = NULL;
+	char *format = NULL;
+	FILE *fp = NULL;
+	uint32_t version;
+
+	(*record_count) = 0;
+	fp = fopen(filename,"rb");
+	if(fp == NULL)
+	{
+		fprintf(stderr,"Decode_File:Failed to open '%s' (%d).\n",filename,errno);
+		return FALSE;
+	}
+	if((fread(magic,1,LIRIC_LOG_BINARY_MAGIC_LENGTH,fp) != LIRIC_LOG_BINARY_MAGIC_LENGTH)||
+	   (memcmp(magic,LIRIC_LOG_BINARY_MAGIC,LIRIC_LOG_BINARY_MAGIC_LENGTH) != 0))
+	{
+		fprintf(stderr,"Decode_File:'%s' is not a liric binary log file.\n",filename);
+		fclose(fp);
+		return FALSE;
+	}
+	if((fread(&version,sizeof(uint32_t),1,fp) != 1)||(version != LIRIC_LOG_BINARY_VERSION))
+	{
+		fprintf(stderr,"Decode_File:'%s' has an unsupported version.\n",filename);
+		fclose(fp);
+		return FALSE;
+	}
+	while(fread(&header,sizeof(header),1,fp) == 1)
+	{
+		if(header.Length > LIRIC_LOG_BINARY_MAX_ARGS_LENGTH)
+		{
+			fprintf(stderr,"Decode_File:'%s' record %d has an illegal length %u.\n",filename,
+				(*record_count),header.Length);
+			fclose(fp);
+			return FALSE;
+		}
+		if(fread(payload,1,header.Length,fp) != header.Length)
+			break;
+		(*record_count)++;
+		if(header.Type == LIRIC_LOG_BINARY_RECORD_TYPE_DEFINE)
+		{
+			if(!Definition_Add(header.Message_Id,payload,header.Length))
+			{
+				fclose(fp);
+				return FALSE;
+			}
+			continue;
+		}
+		if(header.Type != LIRIC_LOG_BINARY_RECORD_TYPE_MESSAGE)
+			continue;
+		if((header.Message_Id < Definition_Count)&&(Definition_List[header.Message_Id].Format != NULL))
+		{
+			sub_system = Definition_List[header.Message_Id].Sub_System;
+			format = Definition_List[header.Message_Id].Format;
+		}
+		else
+		{
+			sub_system = "";
+			format = "<undefined message>";
+		}
+		timestamp.tv_sec = header.Seconds;
+		timestamp.tv_nsec = header.Nanoseconds;
+		Liric_General_Get_Time_String(timestamp,time_string,32);
+		if(CSV)
+		{
+			Liric_Log_Binary_Args_To_CSV(header.Arg_Count,payload,header.Length,message,MESSAGE_LENGTH);
+			fprintf(stdout,"%s,%d,",time_string,header.Level);
+			CSV_String_Print(sub_system);
+			fprintf(stdout,",%u,",header.Message_Id);
+			CSV_String_Print(format);
+			fprintf(stdout,",%s\n",message);
+		}
+		else
+		{
+			Liric_Log_Binary_Format(format,header.Arg_Count,payload,header.Length,message,MESSAGE_LENGTH);
+			fprintf(stdout,"%s : %s: level %d:%s\n",time_string,sub_system,header.Level,message);
+		}
+	}
+	fclose(fp);
+	return TRUE;
+}
+
+/**
+ * Add (or replace) a message definition in Definition_List.
+ * @param message_id The message id.
+ * @param payload The definition record payload, the NULL terminated sub system followed by the NULL terminated
+ *        format string.
+ * @param payload_length The length of the payload.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Definition_List
+ * @see #Definition_Count
+ */
+static int Definition_Add(uint32_t message_id,char *payload,int payload_length)
+{
+	int sub_system_length,new_count,i;
+
+	if((payload_length < 2)||(payload[payload_length-1] != '\0'))
+	{
+		fprintf(stderr,"Definition_Add:Illegal definition for message id %u.\n",message_id);
+		return FALSE;
+	}
+	if(message_id >= Definition_Count)
+	{
+		new_count = message_id+STRING_LENGTH;
+		Definition_List = (struct Message_Definition_Struct *)realloc(Definition_List,
+						 new_count*sizeof(struct Message_Definition_Struct));
+		if(Definition_List == NULL)
+		{
+			fprintf(stderr,"Definition_Add:Failed to reallocate definition list (%d).\n",new_count);
+			Definition_Count = 0;
+			return FALSE;
+		}
+		for(i = Definition_Count; i < new_count; i++)
+		{
+			Definition_List[i].Sub_System = NULL;
+			Definition_List[i].Format = NULL;
+		}
+		Definition_Count = new_count;
+	}
+	if(Definition_List[message_id].Sub_System != NULL)
+		free(Definition_List[message_id].Sub_System);
+	if(Definition_List[message_id].Format != NULL)
+		free(Definition_List[message_id].Format);
+	sub_system_length = strlen(payload);
+	Definition_List[message_id].Sub_System = strdup(payload);
+	if(sub_system_length+1 < payload_length)
+		Definition_List[message_id].Format = strdup(payload+sub_system_length+1);
+	else
+		Definition_List[message_id].Format = strdup("");
+	if((Definition_List[message_id].Sub_System == NULL)||(Definition_List[message_id].Format == NULL))
+	{
+		fprintf(stderr,"Definition_Add:Failed to copy definition for message id %u.\n",message_id);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * Free the message definitions in Definition_List.
+ * @see #Definition_List
+ * @see #Definition_Count
+ */
+static void Definitions_Free(void)
+{
+	int i;
+
+	for(i = 0; i < Definition_Count; i++)
+	{
+		if(Definition_List[i].Sub_System != NULL)
+			free(Definition_List[i].Sub_System);
+		if(Definition_List[i].Format != NULL)
+			free(Definition_List[i].Format);
+	}
+	if(Definition_List != NULL)
+		free(Definition_List);
+	Definition_List = NULL;
+	Definition_Count = 0;
+}
+
+/**
+ * Print the CSV header row. The argument columns are variable in number, so are all headed "args".
+ */
+static void CSV_Header_Print(void)
+{
+	fprintf(stdout,"time,level,sub_system,message_id,format,args\n");
+}
+
+/**
+ * Print a string to stdout as a CSV field, in double quotes with embedded double quotes doubled.
+ * @param string The string to print.
+ */
+static void CSV_String_Print(char *string)
+{
+	char *ch = NULL;
+
+	fputc('"',stdout);
+	for(ch = string; (*ch) != '\0'; ch++)
+	{
+		if((*ch) == '"')
+			fputc('"',stdout);
+		fputc((*ch),stdout);
+	}
+	fputc('"',stdout);
+}
+
+/**
+ * Routine to parse command line arguments. Arguments that are not options are added to the Filename_List.
+ * @param argc The number of arguments sent to the program.
+ * @param argv An array of argument strings.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Help
+ * @see #CSV
+ * @see #Filename_List
+ * @see #Filename_Count
+ */
+static int Parse_Arguments(int argc, char *argv[])
+{
+	int i;
+
+	for(i=1;i<argc;i++)
+	{
+		if(strcmp(argv[i],"-csv")==0)
+		{
+			CSV = TRUE;
+		}
+		else if((strcmp(argv[i],"-help")==0)||(strcmp(argv[i],"-h")==0))
+		{
+			Help();
+			exit(0);
+		}
+		else if(argv[i][0] == '-')
+		{
+			fprintf(stderr,"Parse_Arguments:argument '%s' not recognized.\n",argv[i]);
+			return FALSE;
+		}
+		else
+		{
+			Filename_List = (char **)realloc(Filename_List,(Filename_Count+1)*sizeof(char *));
+			if(Filename_List == NULL)
+			{
+				fprintf(stderr,"Parse_Arguments:Failed to reallocate filename list.\n");
+				return FALSE;
+			}
+			Filename_List[Filename_Count++] = argv[i];
+		}
+	}
+	return TRUE;
+}
+
+/**
+ * Help routine.
+ */
+static void Help(void)
+{
+	fprintf(stdout,"Liric Binary Log Decoder:Help.\n");
+	fprintf(stdout,"liric_log_decode [-csv][-h[elp]] <binary log filename> [<binary log filename>...]\n");
+	fprintf(stdout,"\t-csv writes the records as comma separated values (time,level,sub_system,message_id,"
+		"format,args...),\n");
+	fprintf(stdout,"\t\totherwise the messages are reconstructed as text.\n");
+}
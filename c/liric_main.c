@@ -4,6 +4,7 @@
  * the filter_wheel and the nudgematic offseting mechanism.
  * @author $Author$
  */
+#include <pthread.h>
 #include <signal.h> /* signal handling */
 #include <stdio.h>
 #include <stdlib.h>
@@ -18,8 +19,13 @@
 #include "detector_exposure.h"
 #include "detector_fits_filename.h"
 #include "detector_general.h"
+#include "detector_grabber.h"
+#include "detector_grabber_simulator.h"
+#include "detector_latency.h"
 #include "detector_setup.h"
+#include "detector_telemetry.h"
 #include "detector_temperature.h"
+#include "detector_trace.h"
 
 #include "filter_wheel_command.h"
 #include "filter_wheel_general.h"
@@ -30,13 +36,42 @@
 #include "liric_config.h"
 #include "liric_general.h"
 #include "liric_fits_header.h"
+#include "liric_log_binary.h"
 #include "liric_server.h"
+#include "liric_shm.h"
+#include "liric_state.h"
+
+/* data types */
+/**
+ * Data type holding one of the mechanism startup phases, which are run concurrently:
+ * <dl>
+ * <dt>Name</dt> <dd>The name of the phase, used when logging and reporting the phase time.</dd>
+ * <dt>Startup</dt> <dd>The startup routine run by the phase. It returns TRUE on success and FALSE on failure.</dd>
+ * <dt>Thread</dt> <dd>The thread running the phase.</dd>
+ * <dt>Thread_Started</dt> <dd>A boolean, TRUE if Thread was created and needs joining.</dd>
+ * <dt>Retval</dt> <dd>The value returned by Startup.</dd>
+ * <dt>Time_Ms</dt> <dd>How long Startup took, in milliseconds.</dd>
+ * </dl>
+ */
+struct Startup_Phase_Struct
+{
+	char *Name;
+	int (*Startup)(void);
+	pthread_t Thread;
+	int Thread_Started;
+	int Retval;
+	double Time_Ms;
+};
 
 /* internal variables */
 /**
  * Revision control system identifier.
  */
 static char rcsid[] = "$Id$";
+/**
+ * When the program started, used to measure how long the startup phases take.
+ */
+static struct timespec Startup_Start_Time;
 
 /* internal routines */
 static int Liric_Initialise_Signal(void);
@@ -44,14 +79,40 @@ static int Liric_Initialise_Logging(void);
 static int Liric_Initialise_Mechanisms(void);
 static void Liric_Shutdown_Mechanisms(void);
 static int Liric_Startup_Detector(void);
+static int Liric_Startup_Detector_Formats(void);
 static int Liric_Shutdown_Detector(void);
 static int Liric_Startup_Nudgematic(void);
 static int Liric_Shutdown_Nudgematic(void);
 static int Liric_Startup_Filter_Wheel(void);
 static int Liric_Shutdown_Filter_Wheel(void);
+static int Liric_Startup_Shared_Memory(void);
+static int Liric_Startup_Config_Watch(void);
+static void *Liric_Startup_Phase_Thread(void *user_arg);
+static double Liric_Startup_Phase_End(char *name,struct timespec start_time,int success);
 static int Parse_Arguments(int argc, char *argv[]);
 static void Help(void);
 
+/**
+ * The list of mechanism startup phases, run concurrently by Liric_Initialise_Mechanisms. Each mechanism
+ * talks to its own device(s) using its own library, so they do not depend on each other.
+ * @see #Startup_Phase_Struct
+ * @see #Liric_Initialise_Mechanisms
+ * @see #Liric_Startup_Detector
+ * @see #Liric_Startup_Nudgematic
+ * @see #Liric_Startup_Filter_Wheel
+ */
+static struct Startup_Phase_Struct Startup_Phase_List[] =
+{
+	{"detector",Liric_Startup_Detector,0,FALSE,FALSE,0.0},
+	{"nudgematic",Liric_Startup_Nudgematic,0,FALSE,FALSE,0.0},
+	{"filter_wheel",Liric_Startup_Filter_Wheel,0,FALSE,FALSE,0.0}
+};
+/**
+ * The number of mechanism startup phases in Startup_Phase_List.
+ * @see #Startup_Phase_List
+ */
+static int Startup_Phase_Count = sizeof(Startup_Phase_List)/sizeof(Startup_Phase_List[0]);
+
 
 /* ------------------------------------------------------------------
 ** External functions 
@@ -59,16 +120,29 @@ static void Help(void);
 /**
  * Main program.
  * <ul>
+ * <li>We record when the program started in Startup_Start_Time.
  * <li>We parse the command line arguments using Parse_Arguments.
  * <li>We setup signal handling (so the server doesn't crash when a client does) using Liric_Initialise_Signal.
  * <li>We load the configuration file using Liric_Config_Load, using the config file returned by 
  *     Liric_General_Get_Config_Filename.
  * <li>We initialise the logging using Liric_Initialise_Logging.
- * <li>We initialise the mechanisms (detector, nudgematic, filter wheel) using Liric_Initialise_Mechanisms.
+ * <li>We initialise the mechanisms (detector, nudgematic, filter wheel) concurrently using 
+ *     Liric_Initialise_Mechanisms.
+ * <li>We create the shared memory region local tools read the state and frames from, if enabled, 
+ *     using Liric_Startup_Shared_Memory.
  * <li>We intialise the server using Liric_Server_Initialise.
+ * <li>We start watching the config file for changes, if enabled, using Liric_Startup_Config_Watch.
+ *     Failing to do so is logged, but is not fatal.
+ * <li>The config load, logging, shared memory and server initialisation phases are each timed using 
+ *     Liric_Startup_Phase_End. We log the total startup time, and record it using Liric_State_Startup_Total_Set,
+ *     so it can be retrieved with "status startup".
  * <li>We start the server to handle incoming commands with Liric_Server_Start. This routine finishes
  *     when the server/progam is told to terminate.
+ * <li>We stop watching the config file using Liric_Config_Watch_Stop.
  * <li>We shutdown the connection to the mechanisms using Liric_Shutdown_Mechanisms.
+ * <li>We remove the shared memory region (if it was created) using Liric_Shm_Shutdown.
+ * <li>We stop the asynchronous logging core (if it was started) using Liric_General_Log_Async_Stop,
+ *     so any queued log records are written before we exit.
  * </ul>
  * @param argc The number of arguments to the program.
  * @param argv An array of argument strings.
@@ -78,16 +152,27 @@ static void Help(void);
  * @see #Liric_Config_Load
  * @see #Liric_Initialise_Logging
  * @see #Liric_Initialise_Mechanisms
+ * @see #Liric_Startup_Shared_Memory
  * @see #Liric_Server_Initialise
+ * @see #Liric_Startup_Config_Watch
+ * @see #Liric_Startup_Phase_End
+ * @see #Startup_Start_Time
  * @see #Liric_Server_Start
  * @see #Liric_Shutdown_Mechanisms
+ * @see liric_shm.html#Liric_Shm_Shutdown
+ * @see liric_state.html#Liric_State_Startup_Total_Set
+ * @see liric_config.html#Liric_Config_Watch_Stop
  * @see liric_general.html#Liric_General_Get_Config_Filename
  * @see liric_general.html#Liric_General_Error
+ * @see liric_general.html#Liric_General_Log_Async_Stop
  */
 int main(int argc, char *argv[])
 {
+	struct timespec phase_start_time;
+	double total_time_ms;
 	int retval;
 
+	clock_gettime(CLOCK_REALTIME,&Startup_Start_Time);
 /* parse arguments */
 #if LIRIC_DEBUG > 1
 	Liric_General_Log("main","liric_main.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP","Parsing Arguments.");
@@ -109,7 +194,9 @@ int main(int argc, char *argv[])
 #if LIRIC_DEBUG > 1
 	Liric_General_Log("main","liric_main.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP","Liric_Config_Load.");
 #endif
+	clock_gettime(CLOCK_REALTIME,&phase_start_time);
 	retval = Liric_Config_Load(Liric_General_Get_Config_Filename());
+	Liric_Startup_Phase_End("config",phase_start_time,retval);
 	if(retval == FALSE)
 	{
 		Liric_General_Error("main","liric_main.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP");
@@ -120,7 +207,9 @@ int main(int argc, char *argv[])
 	Liric_General_Log("main","liric_main.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP",
 			       "Liric_Initialise_Logging.");
 #endif
+	clock_gettime(CLOCK_REALTIME,&phase_start_time);
 	retval = Liric_Initialise_Logging();
+	Liric_Startup_Phase_End("logging",phase_start_time,retval);
 	if(retval == FALSE)
 	{
 		Liric_General_Error("main","liric_main.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP");
@@ -135,31 +224,70 @@ int main(int argc, char *argv[])
 	if(retval == FALSE)
 	{
 		Liric_General_Error("main","liric_main.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP");
+		Liric_General_Log_Async_Stop();
 		return 3;
 	}
+	/* shared memory publication */
+#if LIRIC_DEBUG > 1
+	Liric_General_Log("main","liric_main.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP",
+			       "Liric_Startup_Shared_Memory.");
+#endif
+	clock_gettime(CLOCK_REALTIME,&phase_start_time);
+	retval = Liric_Startup_Shared_Memory();
+	Liric_Startup_Phase_End("shared_memory",phase_start_time,retval);
+	if(retval == FALSE)
+	{
+		Liric_General_Error("main","liric_main.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP");
+		/* shutdown mechanisms */
+		Liric_Shutdown_Mechanisms();
+		Liric_Shm_Shutdown();
+		Liric_General_Log_Async_Stop();
+		return 4;
+	}
 #if LIRIC_DEBUG > 1
 	Liric_General_Log("main","liric_main.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP",
 			       "Liric_Server_Initialise.");
 #endif
+	clock_gettime(CLOCK_REALTIME,&phase_start_time);
 	retval = Liric_Server_Initialise();
+	Liric_Startup_Phase_End("server",phase_start_time,retval);
 	if(retval == FALSE)
 	{
 		Liric_General_Error("main","liric_main.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP");
 		/* shutdown mechanisms */
 		Liric_Shutdown_Mechanisms();
+		Liric_Shm_Shutdown();
+		Liric_General_Log_Async_Stop();
 		return 4;
 	}
+	/* config file watch */
+#if LIRIC_DEBUG > 1
+	Liric_General_Log("main","liric_main.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP",
+			       "Liric_Startup_Config_Watch.");
+#endif
+	if(!Liric_Startup_Config_Watch())
+		Liric_General_Error("main","liric_main.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP");
+	/* startup time */
+	clock_gettime(CLOCK_REALTIME,&phase_start_time);
+	total_time_ms = fdifftime(phase_start_time,Startup_Start_Time)*((double)LIRIC_GENERAL_ONE_SECOND_MS);
+	Liric_State_Startup_Total_Set(total_time_ms);
+	Liric_General_Log_Format("main","liric_main.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP",
+				 "Startup took %.3f ms.",total_time_ms);
 	/* start server */
 #if LIRIC_DEBUG > 1
 	Liric_General_Log("main","liric_main.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP",
 			       "Liric_Server_Start.");
 #endif
 	retval = Liric_Server_Start();
+	if(!Liric_Config_Watch_Stop())
+		Liric_General_Error("main","liric_main.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP");
 	if(retval == FALSE)
 	{
 		Liric_General_Error("main","liric_main.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP");
 		/* shutdown mechanisms */
 		Liric_Shutdown_Mechanisms();
+		Liric_Shm_Shutdown();
+		Liric_General_Log_Async_Stop();
 		return 4;
 	}
 	/* shutdown */
@@ -168,10 +296,13 @@ int main(int argc, char *argv[])
 			   "Liric_Shutdown_Mechanisms");
 #endif
 	Liric_Shutdown_Mechanisms();
+	if(!Liric_Shm_Shutdown())
+		Liric_General_Error("main","liric_main.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP");
 #if LIRIC_DEBUG > 1
 	Liric_General_Log("main","liric_main.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP",
 			   "liric completed.");
 #endif
+	Liric_General_Log_Async_Stop();
 	return 0;
 }
 
@@ -200,6 +331,13 @@ static int Liric_Initialise_Signal(void)
 /**
  * Setup logging. Get directory name from config "logging.directory_name".
  * Get UDP logging config. Setup log handlers for Liric software and subsystems.
+ * Get whether span event tracing is enabled at startup from config "logging.trace.enable", and name
+ * the main thread in the trace.
+ * Get the binary log filename root from config "logging.root.binary". If config "logging.binary.enable" is true,
+ * detector messages are packed into the binary log file (Liric_General_Call_Log_Binary_Detector) rather than
+ * formatted into the text log.
+ * If config "logging.async.enable" is true, start the asynchronous logging core with Liric_General_Log_Async_Start,
+ * after the log handlers have been set up.
  * @return The routine returns TRUE on success and FALSE on failure. Liric_General_Error_Number / 
  *         Liric_General_Error_String are set on failure.
  * @see liric_general.html#Liric_General_Error_Number
@@ -232,13 +370,20 @@ static int Liric_Initialise_Signal(void)
  * @see ../../commandserver/cdocs/command_server.html#Command_Server_Set_Log_Handler_Function
  * @see ../../commandserver/cdocs/command_server.html#Command_Server_Set_Log_Filter_Function
  * @see ../../commandserver/cdocs/command_server.html#Command_Server_Log_Filter_Level_Absolute
+ * @see ../detector/cdocs/detector_trace.html#Detector_Trace_Enable_Set
+ * @see ../detector/cdocs/detector_trace.html#Detector_Trace_Thread_Name_Set
+ * @see liric_general.html#Liric_General_Log_Async_Start
+ * @see liric_general.html#Liric_General_Call_Log_Binary_Detector
+ * @see liric_log_binary.html#Liric_Log_Binary_Set_Directory
+ * @see liric_log_binary.html#Liric_Log_Binary_Set_Root
+ * @see ../detector/cdocs/detector_general.html#Detector_General_Set_Log_Format_Handler_Function
  */
 static int Liric_Initialise_Logging(void)
 {
 	char *log_directory = NULL;
 	char *filename_root = NULL;
 	char *hostname = NULL;
-	int retval,port_number,active;
+	int retval,port_number,active,trace_enable,async_enable,binary_enable;
 
 	/* don't log yet - not fully setup yet */
 	/* log directory */
@@ -255,6 +400,12 @@ static int Liric_Initialise_Logging(void)
 			free(log_directory);
 		return FALSE;
 	}
+	if(!Liric_Log_Binary_Set_Directory(log_directory))
+	{
+		if(log_directory != NULL)
+			free(log_directory);
+		return FALSE;
+	}
 	if(log_directory != NULL)
 		free(log_directory);
 	/* log filename root */
@@ -287,6 +438,22 @@ static int Liric_Initialise_Logging(void)
 			free(filename_root);
 		return FALSE;
 	}
+	if(filename_root != NULL)
+		free(filename_root);
+	/* binary log filename root */
+	if(!Liric_Config_Get_String("logging.root.binary",&filename_root))
+	{
+		Liric_General_Error_Number = 58;
+		sprintf(Liric_General_Error_String,"Liric_Initialise_Logging:"
+			"Failed to get binary log root filename.");
+		return FALSE;
+	}
+	if(!Liric_Log_Binary_Set_Root(filename_root))
+	{
+		if(filename_root != NULL)
+			free(filename_root);
+		return FALSE;
+	}
 	if(filename_root != NULL)
 		free(filename_root);
 	/* setup log_udp */
@@ -319,6 +486,22 @@ static int Liric_Initialise_Logging(void)
 	}
 	if(hostname != NULL)
 		free(hostname);
+	/* span event tracing */
+	if(!Liric_Config_Get_Boolean("logging.trace.enable",&trace_enable))
+	{
+		Liric_General_Error_Number = 55;
+		sprintf(Liric_General_Error_String,"Liric_Initialise_Logging:"
+			"Failed to get trace enable.");
+		return FALSE;
+	}
+	if(!Detector_Trace_Enable_Set(trace_enable))
+	{
+		Liric_General_Error_Number = 56;
+		sprintf(Liric_General_Error_String,"Liric_Initialise_Logging:"
+			"Detector_Trace_Enable_Set(%d) failed.",trace_enable);
+		return FALSE;
+	}
+	Detector_Trace_Thread_Name_Set("main");
 	/* Liric */
 	Liric_General_Add_Log_Handler_Function(Liric_General_Log_Handler_Log_Hourly_File);
 	Liric_General_Add_Log_Handler_Function(Liric_General_Log_Handler_Log_UDP);
@@ -326,6 +509,15 @@ static int Liric_Initialise_Logging(void)
 	/* Detector */
 	Detector_General_Set_Log_Handler_Function(Liric_General_Call_Log_Handlers_Detector);
 	Detector_General_Set_Log_Filter_Function(Detector_General_Log_Filter_Level_Absolute);
+	if(!Liric_Config_Get_Boolean("logging.binary.enable",&binary_enable))
+	{
+		Liric_General_Error_Number = 59;
+		sprintf(Liric_General_Error_String,"Liric_Initialise_Logging:"
+			"Failed to get binary logging enable.");
+		return FALSE;
+	}
+	if(binary_enable)
+		Detector_General_Set_Log_Format_Handler_Function(Liric_General_Call_Log_Binary_Detector);
 	/* filter wheel */
 	Filter_Wheel_General_Set_Log_Handler_Function(Liric_General_Call_Log_Handlers_Filter_Wheel);
 	Filter_Wheel_General_Set_Log_Filter_Function(Filter_Wheel_General_Log_Filter_Level_Absolute);
@@ -335,57 +527,104 @@ static int Liric_Initialise_Logging(void)
 	/* setup command server logging */
 	Command_Server_Set_Log_Handler_Function(Liric_General_Call_Log_Handlers);
 	Command_Server_Set_Log_Filter_Function(Command_Server_Log_Filter_Level_Absolute);
+	/* asynchronous logging */
+	if(!Liric_Config_Get_Boolean("logging.async.enable",&async_enable))
+	{
+		Liric_General_Error_Number = 57;
+		sprintf(Liric_General_Error_String,"Liric_Initialise_Logging:"
+			"Failed to get asynchronous logging enable.");
+		return FALSE;
+	}
+	if(async_enable)
+	{
+		if(!Liric_General_Log_Async_Start())
+			return FALSE;
+	}
 	return TRUE;
 }
 
 /**
- * Initialise the liric mechanisms. Calls Liric_Startup_Detector,Liric_Startup_Mudgematic,
- * Liric_Startup_Filter_Wheel.
+ * Initialise the liric mechanisms. The startup phases in Startup_Phase_List (Liric_Startup_Detector,
+ * Liric_Startup_Nudgematic, Liric_Startup_Filter_Wheel) each open and handshake their own devices, so we run them
+ * concurrently, and the mechanisms startup takes as long as the slowest one rather than the sum of all of them.
+ * <ul>
+ * <li>For each phase in Startup_Phase_List, we create a thread running Liric_Startup_Phase_Thread.
+ *     If the thread cannot be created, we log the failure and run the phase in this thread instead.
+ * <li>We join each phase thread that was created.
+ * <li>We time the whole mechanisms phase using Liric_Startup_Phase_End.
+ * <li>If any phases failed, we set an error listing the failed phases. Each phase thread has already logged
+ *     the reason its phase failed.
+ * </ul>
  * @return The routine returns TRUE on success and FALSE on failure. Liric_General_Error_Number / 
  *         Liric_General_Error_String are set on failure.
+ * @see #Startup_Phase_List
+ * @see #Startup_Phase_Count
+ * @see #Liric_Startup_Phase_Thread
+ * @see #Liric_Startup_Phase_End
  * @see #Liric_Startup_Detector
  * @see #Liric_Startup_Nudgematic
  * @see #Liric_Startup_Filter_Wheel
- * @see liric_general.html#aptor_General_Error_Number
+ * @see liric_general.html#Liric_General_Error_Number
  * @see liric_general.html#Liric_General_Error_String
  * @see liric_general.html#Liric_General_Log
  */
 static int Liric_Initialise_Mechanisms(void)
 {
-	int retval;
+	struct timespec start_time;
+	char failed_list_string[256];
+	int i,retval,failed_count;
 
 #if LIRIC_DEBUG > 1
 	Liric_General_Log("main","liric_main.c","Liric_Initialise_Mechanisms",LOG_VERBOSITY_TERSE,"STARTUP",
 			   "Started.");
 #endif
-	/* initialise connection to the Detector */
-#if LIRIC_DEBUG > 1
-	Liric_General_Log("main","liric_main.c","Liric_Initialise_Mechanisms",LOG_VERBOSITY_TERSE,"STARTUP",
-			   "Calling Liric_Startup_Detector.");
-#endif
-	retval = Liric_Startup_Detector();
-	if(retval == FALSE)
+	clock_gettime(CLOCK_REALTIME,&start_time);
+	/* start each mechanism's startup phase in it's own thread */
+	for(i = 0; i < Startup_Phase_Count; i++)
 	{
-		return FALSE;
-	}
-	/* initialise connection to the nudgematic */
 #if LIRIC_DEBUG > 1
-	Liric_General_Log("main","liric_main.c","Liric_Initialise_Mechanisms",LOG_VERBOSITY_TERSE,"STARTUP",
-			   "Calling Liric_Startup_Nudgematic.");
+		Liric_General_Log_Format("main","liric_main.c","Liric_Initialise_Mechanisms",LOG_VERBOSITY_TERSE,
+					 "STARTUP","Starting %s startup thread.",Startup_Phase_List[i].Name);
 #endif
-	retval = Liric_Startup_Nudgematic();
-	if(retval == FALSE)
+		Startup_Phase_List[i].Thread_Started = FALSE;
+		retval = pthread_create(&(Startup_Phase_List[i].Thread),NULL,Liric_Startup_Phase_Thread,
+					&(Startup_Phase_List[i]));
+		if(retval == 0)
+			Startup_Phase_List[i].Thread_Started = TRUE;
+		else
+		{
+			Liric_General_Log_Format("main","liric_main.c","Liric_Initialise_Mechanisms",
+						 LOG_VERBOSITY_VERY_TERSE,"STARTUP",
+						 "Failed to create %s startup thread (%d), starting it serially.",
+						 Startup_Phase_List[i].Name,retval);
+			Liric_Startup_Phase_Thread(&(Startup_Phase_List[i]));
+		}
+	}
+	/* wait for them all to finish */
+	failed_count = 0;
+	strcpy(failed_list_string,"");
+	for(i = 0; i < Startup_Phase_Count; i++)
 	{
-		return FALSE;
+		if(Startup_Phase_List[i].Thread_Started)
+		{
+			pthread_join(Startup_Phase_List[i].Thread,NULL);
+			Startup_Phase_List[i].Thread_Started = FALSE;
+		}
+		if(Startup_Phase_List[i].Retval == FALSE)
+		{
+			if(failed_count > 0)
+				strcat(failed_list_string,",");
+			strcat(failed_list_string,Startup_Phase_List[i].Name);
+			failed_count++;
+		}
 	}
-	/* initialise connection to the filter wheel */
-#if LIRIC_DEBUG > 1
-	Liric_General_Log("main","liric_main.c","Liric_Initialise_Mechanisms",LOG_VERBOSITY_TERSE,"STARTUP",
-			   "Calling Liric_Startup_Filter_Wheel.");
-#endif
-	retval = Liric_Startup_Filter_Wheel();
+	retval = (failed_count == 0);
+	Liric_Startup_Phase_End("mechanisms",start_time,retval);
 	if(retval == FALSE)
 	{
+		Liric_General_Error_Number = 69;
+		sprintf(Liric_General_Error_String,"Liric_Initialise_Mechanisms:"
+			"%d of %d mechanisms failed to start:%s.",failed_count,Startup_Phase_Count,failed_list_string);
 		return FALSE;
 	}
 #if LIRIC_DEBUG > 1
@@ -459,28 +698,64 @@ static void Liric_Shutdown_Mechanisms(void)
  * <ul>
  * <li>Use Liric_Config_Get_Boolean to get "detector.enable" to see whether the Detector is enabled for initialisation.
  * <li>If it is _not_ enabled, log and return success.
+ * <li>We call Detector_Exposure_Start_Callback_Set so Liric_State_Exposure_Started publishes the exposure
+ *     state into the instrument state block whenever an exposure starts.
  * <li>We call Liric_Config_Get_String with key "detector.format_dir" to get the format directory 
  *     (directory containing '.fmt' files used by the Liric SDK / Detector_Setup_Startup).
  * <li>We call Liric_Config_Get_Integer with key "detector.coadd_exposure_length.long" to get an initial value for 
  *     the coadd exposure length.
  * <li>We generate a format filename to use as a parameter to Detector_Setup_Startup, based on the above config.
  * <li>We call Liric_Config_Get_Boolean to get "detector.fan.enable" to see whether the Detector to turn the detector fan on or off.
+ * <li>We call Liric_Config_Get_Boolean with keys "detector.buffer.huge_pages" and "detector.buffer.lock" to see
+ *     whether to allocate the image buffers using huge pages, and whether to lock them into RAM, and
+ *     call Detector_Buffer_Memory_Options_Set to configure the detector library before the buffers are allocated.
+ * <li>We call Liric_Config_Get_String with key "detector.grabber.backend" to get which frame grabber backend
+ *     ("xclib" or "simulator") the detector library talks to, and call Detector_Grabber_Backend_Set.
+ * <li>We call Liric_Config_Get_Integer with key "detector.grabber.simulator.field_period" to get the simulated
+ *     field period in milliseconds (0 to derive it from the format filename), and call
+ *     Detector_Grabber_Simulator_Field_Period_Set.
  * <li>We call Detector_Setup_Startup to initialise the Detector.
+ * <li>We call Liric_Startup_Detector_Formats to preload the '.fmt' format files of all the configured coadd
+ *     exposure lengths, so "config coadd_exp_len" can switch between them quickly. A failure is logged, but is 
+ *     not fatal.
  * <li>We call Detector_Exposure_Set_Coadd_Frame_Exposure_Length to set the coadded exposure length to use for exposures.
  * <li>We call Detector_Temperature_Set_Fan to turn the detector fan on or off.
+ * <li>We call Liric_Config_Get_String with key "detector.noise_image.type" to get which noise image 
+ *     ("none", "variance" or "standard_error") to accumulate alongside each exposure, and
+ *     call Detector_Buffer_Noise_Type_Set to configure the detector library.
+ * <li>We call Liric_Config_Get_Integer with key "detector.saturation_level" to get the mean pixel value
+ *     counted as saturated in the per-frame statistics, and call Detector_Buffer_Saturation_Level_Set.
+ * <li>We call Liric_Config_Get_Integer with key "detector.buffer.thread.count" to get the number of threads
+ *     to split the pixel kernels over, and Liric_Config_Get_String with key "detector.buffer.thread.cores" to get
+ *     a comma separated list of CPU cores to pin the worker threads to (or "none"). We then call 
+ *     Detector_Buffer_Thread_Pool_Start to start the worker thread pool.
+ * <li>We call Liric_Config_Get_Integer with key "detector.buffer.strip.rows" to get how many rows of each coadd
+ *     to read out of the frame grabber (and accumulate) at a time, and call Detector_Buffer_Strip_Row_Count_Set.
+ * <li>We call Liric_Config_Get_Boolean with key "detector.latency.fits_keywords" to get whether to write the
+ *     per-stage exposure latencies into the FITS headers, and call Detector_Latency_Fits_Keywords_Set.
  * <li>We call Liric_Config_Get_Character to get the instrument code for Liric
  *     with property keyword: "file.fits.instrument_code".
  * <li>We call Liric_Config_Get_String to get the data directory to store generated FITS images in using the
  *     property keyword: "file.fits.path".
  * <li>We call Detector_Fits_Filename_Initialise to initialise FITS filename data and find the current MULTRUN number.
  * <li>We call Liric_Fits_Header_Initialise to initialise FITS header data.
+ * <li>We call Liric_State_Exposure_Update to publish the initial coadd exposure length and MULTRUN number.
+ * <li>We call Liric_Config_Get_Boolean with key "detector.telemetry.enable" to get whether to sample the detector
+ *     telemetry in the background. If so, we call Liric_Config_Get_Integer with keys "detector.telemetry.period_ms"
+ *     and "detector.telemetry.history_hours" to get the sampling period and how much history to keep, 
+ *     call Detector_Telemetry_Sample_Callback_Set so each sample is published with Liric_State_Telemetry_Sample_Set,
+ *     and call Detector_Telemetry_Start to start the sampler thread.
  * </ul>
  * @return The routine returns TRUE on success and FALSE on failure.
  * @see liric_config.html#Liric_Config_Get_Integer
  * @see liric_config.html#Liric_Config_Get_Boolean
  * @see liric_config.html#Liric_Config_Get_Character
  * @see liric_config.html#Liric_Config_Get_String
+ * @see #Liric_Startup_Detector_Formats
  * @see liric_fits_header.html#Liric_Fits_Header_Initialise
+ * @see liric_state.html#Liric_State_Exposure_Started
+ * @see liric_state.html#Liric_State_Exposure_Update
+ * @see liric_state.html#Liric_State_Telemetry_Sample_Set
  * @see liric_general.html#Liric_General_Error_Number
  * @see liric_general.html#Liric_General_Error_String
  * @see liric_general.html#Liric_General_Log
@@ -489,14 +764,35 @@ static void Liric_Shutdown_Mechanisms(void)
  * @see ../detector/cdocs/detector_setup.html#Detector_Setup_Startup
  * @see ../detector/cdocs/detector_temperature.html#Detector_Temperature_Set_Fan
  * @see ../detector/cdocs/detector_exposure.html#Detector_Exposure_Set_Coadd_Frame_Exposure_Length
+ * @see ../detector/cdocs/detector_buffer.html#Detector_Buffer_Memory_Options_Set
+ * @see ../detector/cdocs/detector_grabber.html#DETECTOR_GRABBER_BACKEND
+ * @see ../detector/cdocs/detector_grabber.html#Detector_Grabber_Backend_Set
+ * @see ../detector/cdocs/detector_grabber_simulator.html#Detector_Grabber_Simulator_Field_Period_Set
+ * @see ../detector/cdocs/detector_buffer.html#DETECTOR_BUFFER_NOISE_TYPE
+ * @see ../detector/cdocs/detector_buffer.html#Detector_Buffer_Noise_Type_Set
+ * @see ../detector/cdocs/detector_buffer.html#Detector_Buffer_Saturation_Level_Set
+ * @see ../detector/cdocs/detector_buffer.html#Detector_Buffer_Thread_Pool_Start
+ * @see ../detector/cdocs/detector_buffer.html#DETECTOR_BUFFER_MAX_THREAD_COUNT
+ * @see ../detector/cdocs/detector_buffer.html#Detector_Buffer_Strip_Row_Count_Set
+ * @see ../detector/cdocs/detector_latency.html#Detector_Latency_Fits_Keywords_Set
+ * @see ../detector/cdocs/detector_telemetry.html#Detector_Telemetry_Start
  */
 static int Liric_Startup_Detector(void)
 {
-	int enabled,fan_enabled,coadd_exposure_length;
+	enum DETECTOR_BUFFER_NOISE_TYPE noise_type;
+	enum DETECTOR_GRABBER_BACKEND grabber_backend;
+	int enabled,fan_enabled,coadd_exposure_length,saturation_level,thread_count,core_count;
+	int use_huge_pages,lock_memory,strip_row_count,field_period,latency_fits_keywords;
+	int telemetry_enabled,telemetry_period_ms,telemetry_history_hours;
+	int core_list[DETECTOR_BUFFER_MAX_THREAD_COUNT];
 	char instrument_code;
 	char format_filename[256];
 	char* data_dir = NULL;
 	char* format_dir_string = NULL;
+	char* noise_type_string = NULL;
+	char* grabber_backend_string = NULL;
+	char* cores_string = NULL;
+	char* core_string = NULL;
 	
 #if LIRIC_DEBUG > 1
 	Liric_General_Log("main","liric_main.c","Liric_Startup_Detector",LOG_VERBOSITY_TERSE,"STARTUP","Started.");
@@ -520,6 +816,8 @@ static int Liric_Startup_Detector(void)
 #endif
 		return TRUE;
 	}
+	/* publish the exposure state from the exposing thread when each exposure starts */
+	Detector_Exposure_Start_Callback_Set(Liric_State_Exposure_Started);
 	/* diddly we can now replace this next bit with a call to Liric_Command_Initialise_Detector */	 
 	/* get the coadd exposure length. */
 	if(!Liric_Config_Get_Integer("detector.coadd_exposure_length.long",&coadd_exposure_length))
@@ -547,6 +845,79 @@ static int Liric_Startup_Detector(void)
 			"Liric_Startup_Detector:Failed to get whether the detector fan is enabled for initialisation.");
 		return FALSE;
 	}
+	/* how to allocate the image buffers. This must be done before Detector_Setup_Startup allocates them. */
+	if(!Liric_Config_Get_Boolean("detector.buffer.huge_pages",&use_huge_pages))
+	{
+		Liric_General_Error_Number = 43;
+		sprintf(Liric_General_Error_String,
+			"Liric_Startup_Detector:Failed to get whether to allocate detector buffers using huge pages.");
+		return FALSE;
+	}
+	if(!Liric_Config_Get_Boolean("detector.buffer.lock",&lock_memory))
+	{
+		Liric_General_Error_Number = 44;
+		sprintf(Liric_General_Error_String,
+			"Liric_Startup_Detector:Failed to get whether to lock detector buffers into memory.");
+		return FALSE;
+	}
+#if LIRIC_DEBUG > 1
+	Liric_General_Log_Format("main","liric_main.c","Liric_Startup_Detector",LOG_VERBOSITY_VERBOSE,"STARTUP",
+				 "Calling Detector_Buffer_Memory_Options_Set with huge pages '%s' and lock '%s'.",
+				 use_huge_pages ? "True" : "False",lock_memory ? "True" : "False");
+#endif
+	if(!Detector_Buffer_Memory_Options_Set(use_huge_pages,lock_memory))
+	{
+		Liric_General_Error_Number = 45;
+		sprintf(Liric_General_Error_String,
+			"Liric_Startup_Detector:Detector_Buffer_Memory_Options_Set(%d,%d) failed.",
+			use_huge_pages,lock_memory);
+		return FALSE;
+	}
+	/* which frame grabber backend to talk to. This must be done before Detector_Setup_Startup opens it. */
+	if(!Liric_Config_Get_String("detector.grabber.backend",&grabber_backend_string))
+	{
+		Liric_General_Error_Number = 48;
+		sprintf(Liric_General_Error_String,"Liric_Startup_Detector:Failed to get detector frame grabber backend.");
+		return FALSE;
+	}
+	if(strcmp(grabber_backend_string,"xclib") == 0)
+		grabber_backend = DETECTOR_GRABBER_BACKEND_XCLIB;
+	else if(strcmp(grabber_backend_string,"simulator") == 0)
+		grabber_backend = DETECTOR_GRABBER_BACKEND_SIMULATOR;
+	else
+	{
+		Liric_General_Error_Number = 49;
+		sprintf(Liric_General_Error_String,"Liric_Startup_Detector:Illegal detector frame grabber backend '%s'.",
+			grabber_backend_string);
+		free(grabber_backend_string);
+		return FALSE;
+	}
+	free(grabber_backend_string);
+#if LIRIC_DEBUG > 1
+	Liric_General_Log_Format("main","liric_main.c","Liric_Startup_Detector",LOG_VERBOSITY_VERBOSE,"STARTUP",
+				 "Calling Detector_Grabber_Backend_Set with backend %d.",grabber_backend);
+#endif
+	if(!Detector_Grabber_Backend_Set(grabber_backend))
+	{
+		Liric_General_Error_Number = 50;
+		sprintf(Liric_General_Error_String,
+			"Liric_Startup_Detector:Detector_Grabber_Backend_Set(%d) failed.",grabber_backend);
+		return FALSE;
+	}
+	if(!Liric_Config_Get_Integer("detector.grabber.simulator.field_period",&field_period))
+	{
+		Liric_General_Error_Number = 51;
+		sprintf(Liric_General_Error_String,
+			"Liric_Startup_Detector:Failed to get simulated frame grabber field period.");
+		return FALSE;
+	}
+	if(!Detector_Grabber_Simulator_Field_Period_Set(field_period))
+	{
+		Liric_General_Error_Number = 52;
+		sprintf(Liric_General_Error_String,
+			"Liric_Startup_Detector:Detector_Grabber_Simulator_Field_Period_Set(%d) failed.",field_period);
+		return FALSE;
+	}
 	/* actually do initialisation of the detector library */
 #if LIRIC_DEBUG > 1
 	Liric_General_Log_Format("main","liric_main.c","Liric_Startup_Detector",LOG_VERBOSITY_TERSE,"STARTUP",
@@ -558,6 +929,9 @@ static int Liric_Startup_Detector(void)
 		sprintf(Liric_General_Error_String,"Liric_Startup_Detector:Detector_Setup_Startup failed.");
 		return FALSE;
 	}
+	/* preload the other formats, so we can switch between them quickly */
+	if(!Liric_Startup_Detector_Formats())
+		Liric_General_Error("main","liric_main.c","Liric_Startup_Detector",LOG_VERBOSITY_TERSE,"STARTUP");
 	/* setup coadd exposure length */
 	if(!Detector_Exposure_Set_Coadd_Frame_Exposure_Length(coadd_exposure_length))
 	{
@@ -578,6 +952,126 @@ static int Liric_Startup_Detector(void)
 			"Liric_Startup_Detector:Detector_Temperature_Set_Fan(%d) failed.",fan_enabled);
 		return FALSE;
 	}
+	/* which noise image, if any, to accumulate alongside the mean image */
+	if(!Liric_Config_Get_String("detector.noise_image.type",&noise_type_string))
+	{
+		Liric_General_Error_Number = 33;
+		sprintf(Liric_General_Error_String,"Liric_Startup_Detector:Failed to get detector noise image type.");
+		return FALSE;
+	}
+	if(strcmp(noise_type_string,"none") == 0)
+		noise_type = DETECTOR_BUFFER_NOISE_TYPE_NONE;
+	else if(strcmp(noise_type_string,"variance") == 0)
+		noise_type = DETECTOR_BUFFER_NOISE_TYPE_VARIANCE;
+	else if(strcmp(noise_type_string,"standard_error") == 0)
+		noise_type = DETECTOR_BUFFER_NOISE_TYPE_STANDARD_ERROR;
+	else
+	{
+		Liric_General_Error_Number = 34;
+		sprintf(Liric_General_Error_String,"Liric_Startup_Detector:Illegal detector noise image type '%s'.",
+			noise_type_string);
+		free(noise_type_string);
+		return FALSE;
+	}
+	free(noise_type_string);
+#if LIRIC_DEBUG > 1
+	Liric_General_Log_Format("main","liric_main.c","Liric_Startup_Detector",LOG_VERBOSITY_VERBOSE,"STARTUP",
+				  "Calling Detector_Buffer_Noise_Type_Set with noise type %d.",noise_type);
+#endif
+	if(!Detector_Buffer_Noise_Type_Set(noise_type))
+	{
+		Liric_General_Error_Number = 35;
+		sprintf(Liric_General_Error_String,
+			"Liric_Startup_Detector:Detector_Buffer_Noise_Type_Set(%d) failed.",noise_type);
+		return FALSE;
+	}
+	/* saturation level used for per-frame statistics */
+	if(!Liric_Config_Get_Integer("detector.saturation_level",&saturation_level))
+	{
+		Liric_General_Error_Number = 36;
+		sprintf(Liric_General_Error_String,"Liric_Startup_Detector:Failed to get detector saturation level.");
+		return FALSE;
+	}
+	if(!Detector_Buffer_Saturation_Level_Set(saturation_level))
+	{
+		Liric_General_Error_Number = 37;
+		sprintf(Liric_General_Error_String,
+			"Liric_Startup_Detector:Detector_Buffer_Saturation_Level_Set(%d) failed.",saturation_level);
+		return FALSE;
+	}
+	/* worker thread pool used to split the pixel kernels */
+	if(!Liric_Config_Get_Integer("detector.buffer.thread.count",&thread_count))
+	{
+		Liric_General_Error_Number = 38;
+		sprintf(Liric_General_Error_String,"Liric_Startup_Detector:Failed to get detector buffer thread count.");
+		return FALSE;
+	}
+	if(!Liric_Config_Get_String("detector.buffer.thread.cores",&cores_string))
+	{
+		Liric_General_Error_Number = 39;
+		sprintf(Liric_General_Error_String,"Liric_Startup_Detector:Failed to get detector buffer thread cores.");
+		return FALSE;
+	}
+	core_count = 0;
+	if(strcmp(cores_string,"none") != 0)
+	{
+		core_string = strtok(cores_string,",");
+		while((core_string != NULL)&&(core_count < DETECTOR_BUFFER_MAX_THREAD_COUNT))
+		{
+			if(sscanf(core_string,"%d",&(core_list[core_count])) != 1)
+			{
+				Liric_General_Error_Number = 40;
+				sprintf(Liric_General_Error_String,
+					"Liric_Startup_Detector:Failed to parse detector buffer thread core '%s'.",core_string);
+				free(cores_string);
+				return FALSE;
+			}
+			core_count++;
+			core_string = strtok(NULL,",");
+		}
+	}
+	free(cores_string);
+#if LIRIC_DEBUG > 1
+	Liric_General_Log_Format("main","liric_main.c","Liric_Startup_Detector",LOG_VERBOSITY_VERBOSE,"STARTUP",
+				  "Calling Detector_Buffer_Thread_Pool_Start with %d threads and %d cores.",
+				  thread_count,core_count);
+#endif
+	if(!Detector_Buffer_Thread_Pool_Start(thread_count,core_list,core_count))
+	{
+		Liric_General_Error_Number = 41;
+		sprintf(Liric_General_Error_String,
+			"Liric_Startup_Detector:Detector_Buffer_Thread_Pool_Start(%d,%d) failed.",thread_count,core_count);
+		return FALSE;
+	}
+	/* how many rows of each coadd to read out of the frame grabber at a time (0 reads out the whole frame) */
+	if(!Liric_Config_Get_Integer("detector.buffer.strip.rows",&strip_row_count))
+	{
+		Liric_General_Error_Number = 46;
+		sprintf(Liric_General_Error_String,"Liric_Startup_Detector:Failed to get detector buffer strip rows.");
+		return FALSE;
+	}
+	if(!Detector_Buffer_Strip_Row_Count_Set(strip_row_count))
+	{
+		Liric_General_Error_Number = 47;
+		sprintf(Liric_General_Error_String,
+			"Liric_Startup_Detector:Detector_Buffer_Strip_Row_Count_Set(%d) failed.",strip_row_count);
+		return FALSE;
+	}
+	/* whether to write the per-stage exposure latencies into the FITS headers */
+	if(!Liric_Config_Get_Boolean("detector.latency.fits_keywords",&latency_fits_keywords))
+	{
+		Liric_General_Error_Number = 53;
+		sprintf(Liric_General_Error_String,
+			"Liric_Startup_Detector:Failed to get whether to write latency FITS keywords.");
+		return FALSE;
+	}
+	if(!Detector_Latency_Fits_Keywords_Set(latency_fits_keywords))
+	{
+		Liric_General_Error_Number = 54;
+		sprintf(Liric_General_Error_String,
+			"Liric_Startup_Detector:Detector_Latency_Fits_Keywords_Set(%d) failed.",latency_fits_keywords);
+		return FALSE;
+	}
 	/* fits filename initialisation */
 	if(!Liric_Config_Get_Character("file.fits.instrument_code",&instrument_code))
 		return FALSE;
@@ -609,22 +1103,133 @@ static int Liric_Startup_Detector(void)
 		sprintf(Liric_General_Error_String,"Liric_Startup_Detector:Detector_Fits_Header_Initialise failed.");
 		return FALSE;
 	}
+	/* background telemetry sampler */
+	if(!Liric_Config_Get_Boolean("detector.telemetry.enable",&telemetry_enabled))
+	{
+		Liric_General_Error_Number = 60;
+		sprintf(Liric_General_Error_String,
+			"Liric_Startup_Detector:Failed to get whether the detector telemetry sampler is enabled.");
+		return FALSE;
+	}
+	/* publish the initial coadd exposure length and multrun number */
+	Liric_State_Exposure_Update(FALSE);
+	if(telemetry_enabled)
+	{
+		if(!Liric_Config_Get_Integer("detector.telemetry.period_ms",&telemetry_period_ms))
+		{
+			Liric_General_Error_Number = 61;
+			sprintf(Liric_General_Error_String,
+				"Liric_Startup_Detector:Failed to get detector telemetry sampling period.");
+			return FALSE;
+		}
+		if(!Liric_Config_Get_Integer("detector.telemetry.history_hours",&telemetry_history_hours))
+		{
+			Liric_General_Error_Number = 62;
+			sprintf(Liric_General_Error_String,
+				"Liric_Startup_Detector:Failed to get detector telemetry history length.");
+			return FALSE;
+		}
+#if LIRIC_DEBUG > 1
+		Liric_General_Log_Format("main","liric_main.c","Liric_Startup_Detector",LOG_VERBOSITY_VERBOSE,
+					  "STARTUP","Calling Detector_Telemetry_Start(%d,%d).",telemetry_period_ms,
+					  telemetry_history_hours*3600);
+#endif
+		Detector_Telemetry_Sample_Callback_Set(Liric_State_Telemetry_Sample_Set);
+		if(!Detector_Telemetry_Start(telemetry_period_ms,telemetry_history_hours*3600))
+		{
+			Liric_General_Error_Number = 63;
+			sprintf(Liric_General_Error_String,"Liric_Startup_Detector:Detector_Telemetry_Start(%d,%d) failed.",
+				telemetry_period_ms,telemetry_history_hours*3600);
+			return FALSE;
+		}
+	}
 #if LIRIC_DEBUG > 1
 	Liric_General_Log("main","liric_main.c","Liric_Startup_Detector",LOG_VERBOSITY_TERSE,"STARTUP","Finished.");
 #endif
 	return TRUE;
 }
 
+/**
+ * Preload the '.fmt' format files for all the configured coadd exposure lengths, so the detector can be
+ * switched between them quickly (Detector_Setup_Format_Switch) by "config coadd_exp_len", and the multbias/multdark
+ * commands.
+ * <ul>
+ * <li>We call Liric_Config_Get_String with key "detector.format_dir" to get the format directory.
+ * <li>For each coadd exposure length name ("short", "long", "bias"), we call Liric_Config_Get_Integer with key
+ *     "detector.coadd_exposure_length.&lt;name&gt;" to get the coadd exposure length, generate the format filename,
+ *     and call Detector_Setup_Format_Preload.
+ * </ul>
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see liric_config.html#Liric_Config_Get_Integer
+ * @see liric_config.html#Liric_Config_Get_String
+ * @see liric_general.html#Liric_General_Error_Number
+ * @see liric_general.html#Liric_General_Error_String
+ * @see liric_general.html#Liric_General_Log_Format
+ * @see ../detector/cdocs/detector_setup.html#Detector_Setup_Format_Preload
+ * @see ../detector/cdocs/detector_setup.html#Detector_Setup_Format_Switch
+ */
+static int Liric_Startup_Detector_Formats(void)
+{
+	static char *coadd_exposure_length_name_list[] = {"short","long","bias"};
+	char keyword_string[64];
+	char format_filename[256];
+	char *format_dir_string = NULL;
+	int i,coadd_exposure_length;
+
+	if(!Liric_Config_Get_String("detector.format_dir",&format_dir_string))
+	{
+		Liric_General_Error_Number = 70;
+		sprintf(Liric_General_Error_String,
+			"Liric_Startup_Detector_Formats:Failed to get detector format directory.");
+		return FALSE;
+	}
+	for(i = 0; i < (sizeof(coadd_exposure_length_name_list)/sizeof(coadd_exposure_length_name_list[0])); i++)
+	{
+		sprintf(keyword_string,"detector.coadd_exposure_length.%s",coadd_exposure_length_name_list[i]);
+		if(!Liric_Config_Get_Integer(keyword_string,&coadd_exposure_length))
+		{
+			Liric_General_Error_Number = 71;
+			sprintf(Liric_General_Error_String,
+				"Liric_Startup_Detector_Formats:Failed to get coadd exposure length for keyword '%s'.",
+				keyword_string);
+			free(format_dir_string);
+			return FALSE;
+		}
+		sprintf(format_filename,"%s/rap_%dms.fmt",format_dir_string,coadd_exposure_length);
+#if LIRIC_DEBUG > 1
+		Liric_General_Log_Format("main","liric_main.c","Liric_Startup_Detector_Formats",LOG_VERBOSITY_VERBOSE,
+					 "STARTUP","Preloading '%s' format '%s'.",coadd_exposure_length_name_list[i],
+					 format_filename);
+#endif
+		if(!Detector_Setup_Format_Preload(format_filename))
+		{
+			Liric_General_Error_Number = 72;
+			sprintf(Liric_General_Error_String,
+				"Liric_Startup_Detector_Formats:Failed to preload '%s' format '%s'.",
+				coadd_exposure_length_name_list[i],format_filename);
+			free(format_dir_string);
+			return FALSE;
+		}
+	}
+	free(format_dir_string);
+	return TRUE;
+}
+
 /**
  * Shutdown the Detector.
  * <ul>
  * <li>Use Liric_Config_Get_Boolean to get "detector.enable" to see whether the Detector is enabled for initialisation/finislisation.
  * <li>If it is _not_ enabled, log and return success.
+ * <li>Call Detector_Telemetry_Stop to stop the telemetry sampler (if it is running), before the connection
+ *     it uses is closed.
  * <li>Call Detector_Setup_Shutdown to shutdown the connection to the detector.
+ * <li>Call Detector_Buffer_Thread_Pool_Stop to stop the detector buffer worker threads.
  * </ul>
  * @return The routine returns TRUE on success and FALSE on failure.
  * @see liric_config.html#Liric_Config_Get_Boolean
+ * @see ../detector/cdocs/detector_telemetry.html#Detector_Telemetry_Stop
  * @see ../detector/cdocs/detector_setup.html#Detector_Setup_Shutdown
+ * @see ../detector/cdocs/detector_buffer.html#Detector_Buffer_Thread_Pool_Stop
  */
 static int Liric_Shutdown_Detector(void)
 {
@@ -650,6 +1255,13 @@ static int Liric_Shutdown_Detector(void)
 #endif
 		return TRUE;
 	}
+	/* stop the telemetry sampler */
+	if(!Detector_Telemetry_Stop())
+	{
+		Liric_General_Error_Number = 64;
+		sprintf(Liric_General_Error_String,"Liric_Shutdown_Detector:Detector_Telemetry_Stop failed.");
+		return FALSE;
+	}
 	/* shutdown the connection */
 #if LIRIC_DEBUG > 1
 	Liric_General_Log_Format("main","liric_main.c","Liric_Shutdown_Detector",LOG_VERBOSITY_TERSE,"STARTUP",
@@ -661,6 +1273,13 @@ static int Liric_Shutdown_Detector(void)
 		sprintf(Liric_General_Error_String,"Liric_Shutdown_Detector:Detector_Setup_Shutdown failed.");
 		return FALSE;
 	}
+	/* stop the detector buffer worker threads */
+	if(!Detector_Buffer_Thread_Pool_Stop())
+	{
+		Liric_General_Error_Number = 42;
+		sprintf(Liric_General_Error_String,"Liric_Shutdown_Detector:Detector_Buffer_Thread_Pool_Stop failed.");
+		return FALSE;
+	}
 #if LIRIC_DEBUG > 1
 	Liric_General_Log("main","liric_main.c","Liric_Shutdown_Detector",LOG_VERBOSITY_TERSE,"STARTUP","Finished.");
 #endif
@@ -948,6 +1567,182 @@ static int Liric_Shutdown_Filter_Wheel(void)
 	return TRUE;
 }
 
+/**
+ * If shared memory publication is enabled, create the shared memory region local tools read the instrument state
+ * and latest frames from.
+ * <ul>
+ * <li>Use Liric_Config_Get_Boolean to get "shm.enable" to see whether shared memory publication is enabled.
+ * <li>If it is _not_ enabled, log and return success.
+ * <li>Use Liric_Config_Get_String to get the POSIX shared memory object name ("shm.name"), and
+ *     Liric_Config_Get_Integer to get the number of frame slots in the ring ("shm.frame.count").
+ * <li>We call Liric_Shm_Initialise to create the region, with frame slots large enough for the detector's
+ *     image buffers (Detector_Buffer_Get_Pixel_Count, 0 if the detector is not enabled).
+ * <li>We call Liric_State_Publish to copy the state published so far into the region.
+ * </ul>
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see liric_config.html#Liric_Config_Get_Boolean
+ * @see liric_config.html#Liric_Config_Get_Integer
+ * @see liric_config.html#Liric_Config_Get_String
+ * @see liric_shm.html#Liric_Shm_Initialise
+ * @see liric_state.html#Liric_State_Publish
+ * @see liric_general.html#Liric_General_Error_Number
+ * @see liric_general.html#Liric_General_Error_String
+ * @see liric_general.html#Liric_General_Log
+ * @see liric_general.html#Liric_General_Log_Format
+ * @see ../detector/cdocs/detector_buffer.html#Detector_Buffer_Get_Pixel_Count
+ */
+static int Liric_Startup_Shared_Memory(void)
+{
+	char *name = NULL;
+	int enabled,frame_count;
+
+#if LIRIC_DEBUG > 1
+	Liric_General_Log("main","liric_main.c","Liric_Startup_Shared_Memory",LOG_VERBOSITY_TERSE,"STARTUP",
+			   "Started.");
+#endif
+	if(!Liric_Config_Get_Boolean("shm.enable",&enabled))
+	{
+		Liric_General_Error_Number = 65;
+		sprintf(Liric_General_Error_String,"Liric_Startup_Shared_Memory:"
+			"Failed to get whether shared memory publication is enabled.");
+		return FALSE;
+	}
+	if(enabled == FALSE)
+	{
+#if LIRIC_DEBUG > 1
+		Liric_General_Log("main","liric_main.c","Liric_Startup_Shared_Memory",LOG_VERBOSITY_TERSE,"STARTUP",
+				   "Finished (shared memory publication NOT enabled).");
+#endif
+		return TRUE;
+	}
+	if(!Liric_Config_Get_String("shm.name",&name))
+	{
+		Liric_General_Error_Number = 66;
+		sprintf(Liric_General_Error_String,"Liric_Startup_Shared_Memory:Failed to get shared memory name.");
+		return FALSE;
+	}
+	if(!Liric_Config_Get_Integer("shm.frame.count",&frame_count))
+	{
+		Liric_General_Error_Number = 67;
+		sprintf(Liric_General_Error_String,"Liric_Startup_Shared_Memory:Failed to get shared memory frame count.");
+		free(name);
+		return FALSE;
+	}
+#if LIRIC_DEBUG > 1
+	Liric_General_Log_Format("main","liric_main.c","Liric_Startup_Shared_Memory",LOG_VERBOSITY_TERSE,"STARTUP",
+				 "Calling Liric_Shm_Initialise(%s,%d,%d).",name,frame_count,
+				 Detector_Buffer_Get_Pixel_Count());
+#endif
+	if(!Liric_Shm_Initialise(name,frame_count,Detector_Buffer_Get_Pixel_Count()))
+	{
+		free(name);
+		return FALSE;
+	}
+	free(name);
+	Liric_State_Publish();
+#if LIRIC_DEBUG > 1
+	Liric_General_Log("main","liric_main.c","Liric_Startup_Shared_Memory",LOG_VERBOSITY_TERSE,"STARTUP",
+			   "Finished.");
+#endif
+	return TRUE;
+}
+
+/**
+ * Start watching the config file for changes, so it is reloaded whilst liric is running.
+ * <ul>
+ * <li>Use Liric_Config_Get_Boolean to get "config.watch.enable" to see whether the config file should be watched.
+ * <li>If it is _not_ enabled, log and return success. The config can still be reloaded with "config reload".
+ * <li>We call Liric_Config_Watch_Start to start the watch thread.
+ * </ul>
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see liric_config.html#Liric_Config_Get_Boolean
+ * @see liric_config.html#Liric_Config_Watch_Start
+ * @see liric_general.html#Liric_General_Error_Number
+ * @see liric_general.html#Liric_General_Error_String
+ * @see liric_general.html#Liric_General_Log
+ */
+static int Liric_Startup_Config_Watch(void)
+{
+	int enabled;
+
+	if(!Liric_Config_Get_Boolean("config.watch.enable",&enabled))
+	{
+		Liric_General_Error_Number = 68;
+		sprintf(Liric_General_Error_String,"Liric_Startup_Config_Watch:"
+			"Failed to get whether the config file should be watched.");
+		return FALSE;
+	}
+	if(enabled == FALSE)
+	{
+#if LIRIC_DEBUG > 1
+		Liric_General_Log("main","liric_main.c","Liric_Startup_Config_Watch",LOG_VERBOSITY_TERSE,"STARTUP",
+				   "Finished (config file watch NOT enabled).");
+#endif
+		return TRUE;
+	}
+	if(!Liric_Config_Watch_Start())
+		return FALSE;
+#if LIRIC_DEBUG > 1
+	Liric_General_Log("main","liric_main.c","Liric_Startup_Config_Watch",LOG_VERBOSITY_TERSE,"STARTUP",
+			   "Finished.");
+#endif
+	return TRUE;
+}
+
+/**
+ * Thread routine running one of the mechanism startup phases.
+ * <ul>
+ * <li>We call the phase's Startup routine, and save it's return value in the phase's Retval.
+ * <li>We time the phase using Liric_Startup_Phase_End, and save the time in the phase's Time_Ms.
+ * <li>If the phase failed, we log the error using Liric_General_Error. This has to be done in this thread,
+ *     as Liric_General_Error_Number / Liric_General_Error_String are thread local.
+ * </ul>
+ * @param user_arg The address of the Startup_Phase_Struct to run.
+ * @return The routine always returns NULL, the result is saved in the phase's Retval.
+ * @see #Startup_Phase_Struct
+ * @see #Liric_Startup_Phase_End
+ * @see liric_general.html#Liric_General_Error
+ */
+static void *Liric_Startup_Phase_Thread(void *user_arg)
+{
+	struct Startup_Phase_Struct *phase = NULL;
+	struct timespec start_time;
+
+	phase = (struct Startup_Phase_Struct *)user_arg;
+	clock_gettime(CLOCK_REALTIME,&start_time);
+	phase->Retval = (*(phase->Startup))();
+	phase->Time_Ms = Liric_Startup_Phase_End(phase->Name,start_time,phase->Retval);
+	if(phase->Retval == FALSE)
+	{
+		Liric_General_Error("main","liric_main.c","Liric_Startup_Phase_Thread",LOG_VERBOSITY_VERY_TERSE,
+				     "STARTUP");
+	}
+	return NULL;
+}
+
+/**
+ * Finish timing a startup phase. We work out how long the phase took, log it, and record it using
+ * Liric_State_Startup_Phase_Add so it can be retrieved with "status startup".
+ * @param name The name of the phase.
+ * @param start_time When the phase started.
+ * @param success A boolean, TRUE if the phase succeeded.
+ * @return How long the phase took, in milliseconds.
+ * @see liric_state.html#Liric_State_Startup_Phase_Add
+ * @see liric_general.html#Liric_General_Log_Format
+ */
+static double Liric_Startup_Phase_End(char *name,struct timespec start_time,int success)
+{
+	struct timespec end_time;
+	double time_ms;
+
+	clock_gettime(CLOCK_REALTIME,&end_time);
+	time_ms = fdifftime(end_time,start_time)*((double)LIRIC_GENERAL_ONE_SECOND_MS);
+	Liric_State_Startup_Phase_Add(name,success,time_ms);
+	Liric_General_Log_Format("main","liric_main.c","Liric_Startup_Phase_End",LOG_VERBOSITY_TERSE,"STARTUP",
+				 "Startup phase %s %s in %.3f ms.",name,success ? "succeeded" : "failed",time_ms);
+	return time_ms;
+}
+
 /**
  * Help routine.
  */
@@ -29,6 +29,8 @@
 #include "detector_exposure.h"
 #include "detector_fits_filename.h"
 #include "detector_fits_header.h"
+#include "detector_latency.h"
+#include "detector_trace.h"
 #include "detector_setup.h"
 #include "detector_temperature.h"
 
@@ -40,7 +42,10 @@
 #include "liric_config.h"
 #include "liric_fits_header.h"
 #include "liric_general.h"
+#include "liric_job.h"
 #include "liric_multrun.h"
+#include "liric_shm.h"
+#include "liric_state.h"
 
 /* hash defines */
 /**
@@ -103,6 +108,7 @@ static int Moptop_Abort = FALSE;
 /* internal function declarations */
 static int Multrun_Fits_Headers_Set(int exposure_count,int do_standard);
 static int Multrun_Exposure_Fits_Headers_Set(void);
+static void Multrun_State_Set(int in_progress);
 
 /* ----------------------------------------------------------------------------
 ** 		external functions 
@@ -112,8 +118,9 @@ static int Multrun_Exposure_Fits_Headers_Set(void);
  * <ul>
  * <li>We check the input arguments are valid.
  * <li>We initialise the internal variables.
- * <li>We retrieve the multrun flipping configuration fron config ("liric.multrun.image.flip.[x|y]" and configure
- *     the detector exposure code appropriately (Detector_Exposure_Flip_Set).
+ * <li>We retrieve the multrun flipping configuration ("liric.multrun.image.flip.[x|y]") from the typed config
+ *     cache (Liric_Config_Cache_Get), and configure the detector exposure code appropriately 
+ *     (Detector_Exposure_Flip_Set).
  * <li>We call Detector_Fits_Filename_Next_Multrun to generate FITS filenames for a new Multrun.
  * <li>We figure out the DETECTOR_FITS_FILENAME_EXPOSURE_TYPE to use, based on the do_standard flag.
  * <li>We call Multrun_Fits_Headers_Set to make any per-multrun FITS header changes here.
@@ -121,17 +128,25 @@ static int Multrun_Exposure_Fits_Headers_Set(void);
  * <li>We enter a for loop, looping Multrun_Data.Image_Index over Multrun_Data.Image_Count.
  *     <ul>
  *     <li>We check Moptop_Abort to see if the multrun has been aborted by another command thread.
+ *     <li>We publish the index of the frame we are taking (Multrun_State_Set).
  *     <li>If the nudgematic is enabled (Liric_Config_Nudgematic_Is_Enabled), 
- *         we move the nudgematic by calling Nudgematic_Command_Position_Set.
+ *         we move the nudgematic by calling Nudgematic_Command_Position_Set, publishing the nudgematic position
+ *         before and after the move (Liric_State_Nudgematic_Set).
  *     <li>We call Detector_Fits_Filename_Next_Run to increment the run number in the FITS filename generation code.
  *     <li>We call Detector_Fits_Filename_Get_Filename to generate a suitable FITS image filename.
  *     <li>We check Moptop_Abort to see if the multrun has been aborted by another command thread.
  *     <li>We call Multrun_Exposure_Fits_Headers_Set to make any per-exposure FITS header changes here.
+ *     <li>The nudgematic move and FITS header setting are timed using Detector_Latency_Stage_Record.
+ *     <li>The nudgematic move and exposure are recorded as trace spans using Detector_Trace_Span_Start and
+ *         Detector_Trace_Span_End.
  *     <li>We call Detector_Exposure_Expose to take the image (a series of coadds) and save it to the FITS image filename.
+ *     <li>We call Liric_State_Exposure_Update to publish that the exposure has finished.
  *     <li>We call Detector_Fits_Filename_List_Add to add the new FITS image filename to the return list of filenames.
+ *     <li>We call Liric_Shm_Frame_Publish to publish the frame to any local shared memory readers.
+ *     <li>We call Liric_Job_Frame_Saved to record the frame, if the multrun is running as a job.
  *     <li>We increment, and potentially reset the nudgematic position to use for the next exposure in the multrun.
  *     </ul>
- * <li>We set Multrun_In_Progress to FALSE, to indicate we have finished the Multrun.
+ * <li>We set Multrun_In_Progress to FALSE (Multrun_State_Set), to indicate we have finished the Multrun.
  * </ul>
  * @param exposure_length_ms The exposure length of an individual frame in the multrun (itself consisting of a number
  *        of coadds) in milliseconds.
@@ -150,7 +165,8 @@ static int Multrun_Exposure_Fits_Headers_Set(void);
  * @see #Multrun_Data
  * @see #Multrun_Fits_Headers_Set
  * @see #Multrun_Exposure_Fits_Headers_Set
- * @see liric_config.html#Liric_Config_Get_Boolean
+ * @see #Multrun_State_Set
+ * @see liric_config.html#Liric_Config_Cache_Get
  * @see liric_config.html#Liric_Config_Nudgematic_Is_Enabled
  * @see liric_general.html#LIRIC_GENERAL_IS_BOOLEAN
  * @see liric_general.html#Liric_General_Error_Number
@@ -167,14 +183,25 @@ static int Multrun_Exposure_Fits_Headers_Set(void);
  * @see ../detector/cdocs/detector_fits_filename.html#Detector_Fits_Filename_Next_Run
  * @see ../detector/cdocs/detector_fits_filename.html#Detector_Fits_Filename_Get_Filename
  * @see ../detector/cdocs/detector_fits_filename.html#Detector_Fits_Filename_List_Add
+ * @see liric_job.html#Liric_Job_Frame_Saved
+ * @see liric_shm.html#Liric_Shm_Frame_Publish
+ * @see liric_state.html#Liric_State_Nudgematic_Set
+ * @see liric_state.html#Liric_State_Exposure_Update
+ * @see ../detector/cdocs/detector_latency.html#Detector_Latency_Timestamp
+ * @see ../detector/cdocs/detector_latency.html#Detector_Latency_Stage_Record
+ * @see ../detector/cdocs/detector_latency.html#Detector_Latency_Exposure_Reset
+ * @see ../detector/cdocs/detector_trace.html#Detector_Trace_Span_Start
+ * @see ../detector/cdocs/detector_trace.html#Detector_Trace_Span_End
  */
 int Liric_Multrun(int exposure_length_ms,int exposure_count,int do_standard,
 		   char ***filename_list,int *filename_count)
 {
 	char fits_filename[256];
 	enum DETECTOR_FITS_FILENAME_EXPOSURE_TYPE fits_filename_exposure_type;
+	struct timespec latency_time,trace_time;
 	int nudgematic_position_index = 0;
-	int flip_x,flip_y;
+	struct Liric_Config_Cache_Struct config_cache;
+	int retval;
 	
 	/* check arguments */
 	if(exposure_length_ms < 1)
@@ -216,22 +243,20 @@ int Liric_Multrun(int exposure_length_ms,int exposure_count,int do_standard,
 				  exposure_length_ms,exposure_count);
 #endif
 	/* initialise internal variables */
-	Multrun_In_Progress = TRUE;
-	Moptop_Abort = FALSE;
 	Multrun_Data.Image_Count = exposure_count;
+	Multrun_Data.Image_Index = 0;
+	Multrun_State_Set(TRUE);
+	Moptop_Abort = FALSE;
 	nudgematic_position_index = 0;
 	(*filename_list) = NULL;
 	(*filename_count) = 0;
 	/* configure flipping of output image */
-	if(!Liric_Config_Get_Boolean("liric.multrun.image.flip.x",&flip_x))
-		return FALSE;		
-	if(!Liric_Config_Get_Boolean("liric.multrun.image.flip.y",&flip_y))
-		return FALSE;		
-	Detector_Exposure_Flip_Set(flip_x,flip_y);
+	Liric_Config_Cache_Get(&config_cache);
+	Detector_Exposure_Flip_Set(config_cache.Multrun_Image_Flip_X,config_cache.Multrun_Image_Flip_Y);
 	/* intialise FITS filenames for new multrun*/
 	if(!Detector_Fits_Filename_Next_Multrun())
 	{
-		Multrun_In_Progress = FALSE;
+		Multrun_State_Set(FALSE);
 		Liric_General_Error_Number = 605;
 		sprintf(Liric_General_Error_String,"Liric_Multrun:Failed to initialise FITS filename multrun.");
 		return FALSE;
@@ -243,11 +268,13 @@ int Liric_Multrun(int exposure_length_ms,int exposure_count,int do_standard,
 	/* do any per-multrun FITS header changes here */
 	if(!Multrun_Fits_Headers_Set(exposure_count,do_standard))
 	{
-		Multrun_In_Progress = FALSE;
+		Multrun_State_Set(FALSE);
 		return FALSE;
 	}
 	/* take a multrun start timestamp */
 	clock_gettime(CLOCK_REALTIME,&(Multrun_Data.Multrun_Start_Time));
+	/* discard any per-exposure stage latencies left over from a previously failed exposure */
+	Detector_Latency_Exposure_Reset();
 	/* start multrun for loop */
 	for(Multrun_Data.Image_Index = 0; Multrun_Data.Image_Index < Multrun_Data.Image_Count;
 	    Multrun_Data.Image_Index++)
@@ -255,28 +282,37 @@ int Liric_Multrun(int exposure_length_ms,int exposure_count,int do_standard,
 		/* check for aborts */
 		if(Moptop_Abort)
 		{
-			Multrun_In_Progress = FALSE;
+			Multrun_State_Set(FALSE);
 			Liric_General_Error_Number = 606;
 			sprintf(Liric_General_Error_String,"Liric_Multrun:Aborted.");
 			return FALSE;
 		}
+		/* publish which frame we are taking */
+		Multrun_State_Set(TRUE);
 		/* move to next nudgematic position */
 		if(Liric_Config_Nudgematic_Is_Enabled())
 		{
-			if(!Nudgematic_Command_Position_Set(nudgematic_position_index))
+			Detector_Latency_Timestamp(&latency_time);
+			Detector_Trace_Span_Start(&trace_time);
+			Liric_State_Nudgematic_Set(TRUE,-1);
+			retval = Nudgematic_Command_Position_Set(nudgematic_position_index);
+			Liric_State_Nudgematic_Set(retval,retval ? nudgematic_position_index : -1);
+			Detector_Trace_Span_End("mechanism","nudgematic_move",NULL,&trace_time);
+			if(!retval)
 			{
-				Multrun_In_Progress = FALSE;
+				Multrun_State_Set(FALSE);
 				Liric_General_Error_Number = 607;
 				sprintf(Liric_General_Error_String,
 					"Liric_Multrun:Failed to move Nudgematic to position %d.",
 					nudgematic_position_index);
 				return FALSE;
 			}
+			Detector_Latency_Stage_Record(DETECTOR_LATENCY_STAGE_NUDGEMATIC_MOVE,&latency_time);
 		}
 		/* generate new FITS image filename */
 		if(!Detector_Fits_Filename_Next_Run())
 		{
-			Multrun_In_Progress = FALSE;
+			Multrun_State_Set(FALSE);
 			Liric_General_Error_Number = 608;
 			sprintf(Liric_General_Error_String,"Liric_Multrun:Failed to generate next FITS filename run number.");
 			return FALSE;
@@ -285,7 +321,7 @@ int Liric_Multrun(int exposure_length_ms,int exposure_count,int do_standard,
 							DETECTOR_FITS_FILENAME_PIPELINE_FLAG_UNREDUCED,
 							fits_filename,256))
 		{
-			Multrun_In_Progress = FALSE;
+			Multrun_State_Set(FALSE);
 			Liric_General_Error_Number = 609;
 			sprintf(Liric_General_Error_String,"Liric_Multrun:Failed to generate next FITS filename.");
 			return FALSE;
@@ -293,21 +329,27 @@ int Liric_Multrun(int exposure_length_ms,int exposure_count,int do_standard,
 		/* check for aborts */
 		if(Moptop_Abort)
 		{
-			Multrun_In_Progress = FALSE;
+			Multrun_State_Set(FALSE);
 			Liric_General_Error_Number = 610;
 			sprintf(Liric_General_Error_String,"Liric_Multrun:Aborted.");
 			return FALSE;
 		}
 		/* do any per-multrun frame FITS header changes here */
+		Detector_Latency_Timestamp(&latency_time);
 		if(!Multrun_Exposure_Fits_Headers_Set())
 		{
-			Multrun_In_Progress = FALSE;
+			Multrun_State_Set(FALSE);
 			return FALSE;
 		}
+		Detector_Latency_Stage_Record(DETECTOR_LATENCY_STAGE_HEADER_SET,&latency_time);
 		/* take an exposure */
-		if(!Detector_Exposure_Expose(exposure_length_ms,fits_filename))
+		Detector_Trace_Span_Start(&trace_time);
+		retval = Detector_Exposure_Expose(exposure_length_ms,fits_filename);
+		Liric_State_Exposure_Update(FALSE);
+		Detector_Trace_Span_End("exposure","exposure",NULL,&trace_time);
+		if(!retval)
 		{
-			Multrun_In_Progress = FALSE;
+			Multrun_State_Set(FALSE);
 			Liric_General_Error_Number = 611;
 			sprintf(Liric_General_Error_String,
 				"Liric_Multrun:Failed to take exposure %d of %d ms with filename '%s'.",
@@ -317,19 +359,24 @@ int Liric_Multrun(int exposure_length_ms,int exposure_count,int do_standard,
 		/* add fits image to list */
 		if(!Detector_Fits_Filename_List_Add(fits_filename,filename_list,filename_count))
 		{
-			Multrun_In_Progress = FALSE;
+			Multrun_State_Set(FALSE);
 			Liric_General_Error_Number = 612;
 			sprintf(Liric_General_Error_String,"Liric_Multrun:Failed to add filename '%s' to list of length %d.",
 				fits_filename,(*filename_count));
 			return FALSE;
 		}
+		/* publish the frame to local shared memory readers (if enabled), this does not stop the multrun */
+		if(!Liric_Shm_Frame_Publish(fits_filename))
+			Liric_General_Error("multrun","liric_multrun.c","Liric_Multrun",LOG_VERBOSITY_TERSE,"MULTRUN");
+		/* record the frame in the job (if any) and wake any clients waiting for it */
+		Liric_Job_Frame_Saved(fits_filename);
 		/* increment nudgematic position index */
 		nudgematic_position_index++;
 		if(nudgematic_position_index == NUDGEMATIC_POSITION_COUNT)
 			nudgematic_position_index = 0;
 	}/* end for on Multrun_Data.Image_Index */
 	/* we have finished the multrun */
-	Multrun_In_Progress = FALSE;
+	Multrun_State_Set(FALSE);
 #if LIRIC_DEBUG > 1
 	Liric_General_Log("multrun","liric_multrun.c","Liric_Multrun",LOG_VERBOSITY_TERSE,"MULTRUN",
 			   "Finished.");
@@ -382,6 +429,19 @@ int Liric_Multrun_Exposure_Index_Get(void)
 /* ----------------------------------------------------------------------------
 ** 		internal functions 
 ** ---------------------------------------------------------------------------- */
+/**
+ * Set whether a multrun is in progress, and publish the multrun's frame count and the index of the frame
+ * being taken, so status commands can read them without calling into this module.
+ * @param in_progress A boolean, TRUE if a multrun is in progress.
+ * @see #Multrun_In_Progress
+ * @see #Multrun_Data
+ * @see liric_state.html#Liric_State_Sequence_Set
+ */
+static void Multrun_State_Set(int in_progress)
+{
+	Multrun_In_Progress = in_progress;
+	Liric_State_Sequence_Set(in_progress,Multrun_Data.Image_Count,Multrun_Data.Image_Index);
+}
 
 /**
  * Routine to collect and insert FITS headers pertaining to the whole multrun.
@@ -15,6 +15,7 @@
  */
 #define _POSIX_C_SOURCE 199309L
 #include <errno.h>
+#include <pthread.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -26,11 +27,136 @@
 
 #include "command_server.h"
 
+#include "detector_trace.h"
+
 #include "liric_config.h"
 #include "liric_general.h"
+#include "liric_bias_dark.h"
 #include "liric_command.h"
+#include "liric_job.h"
+#include "liric_multrun.h"
 #include "liric_server.h"
 
+/* hash defines */
+/**
+ * The message a client sends as the first message on a connection to start a persistent session.
+ */
+#define SERVER_SESSION_COMMAND	("session")
+/**
+ * The upper limit of the first bin of each command's latency histogram, in milliseconds. Each subsequent bin's
+ * upper limit is ten times the previous one.
+ * @see liric_server.html#LIRIC_SERVER_HISTOGRAM_BIN_COUNT
+ */
+#define SERVER_HISTOGRAM_FIRST_BIN_MS	(0.1)
+/**
+ * The number of commands in the Server_Command_List dispatch table.
+ * @see #Server_Command_List
+ */
+#define SERVER_COMMAND_COUNT	((int)(sizeof(Server_Command_List)/sizeof(Server_Command_List[0])))
+/**
+ * The length of the stack buffer command replies are built in. Longer replies are moved to the heap.
+ */
+#define SERVER_REPLY_BUFFER_LENGTH	(4096)
+/**
+ * The head room reserved at the start of the reply buffer for the session reply framing 
+ * "&lt;request id&gt; &lt;length&gt; ": 2 x 20 digits, 2 spaces and a NULL terminator.
+ */
+#define SERVER_REPLY_FRAME_LENGTH	(43)
+
+/* data types */
+/**
+ * Enumeration of the thread priority classes a command is run at.
+ * <ul>
+ * <li>SERVER_PRIORITY_CLASS_NORMAL - Liric_General_Thread_Priority_Set_Normal.
+ * <li>SERVER_PRIORITY_CLASS_EXPOSURE - Liric_General_Thread_Priority_Set_Exposure.
+ * </ul>
+ */
+enum SERVER_PRIORITY_CLASS
+{
+	SERVER_PRIORITY_CLASS_NORMAL=0,SERVER_PRIORITY_CLASS_EXPOSURE=1
+};
+
+/**
+ * Structure describing one entry in the command dispatch table:
+ * <dl>
+ * <dt>Keyword</dt> <dd>The command keyword.</dd>
+ * <dt>Exact_Match</dt> <dd>A boolean, if TRUE the message must equal the keyword, otherwise the message must
+ *     start with the keyword.</dd>
+ * <dt>Handler</dt> <dd>The function called to process the command and generate the reply string.</dd>
+ * <dt>Handler_Name</dt> <dd>The name of the handler, used in the generic failure reply.</dd>
+ * <dt>Priority_Class</dt> <dd>The thread priority class the command is processed at.</dd>
+ * <dt>Allowed_While_Exposing</dt> <dd>A boolean, if FALSE the command is rejected whilst a
+ *     multrun/multbias/multdark or job is in progress.</dd>
+ * <dt>Stops_Server</dt> <dd>A boolean, if TRUE the server is stopped once the reply has been sent.</dd>
+ * </dl>
+ * @see #SERVER_PRIORITY_CLASS
+ */
+struct Server_Command_Struct
+{
+	char *Keyword;
+	int Exact_Match;
+	int (*Handler)(char *command_string,struct Liric_General_String_Builder_Struct *reply_string);
+	char *Handler_Name;
+	enum SERVER_PRIORITY_CLASS Priority_Class;
+	int Allowed_While_Exposing;
+	int Stops_Server;
+};
+
+/**
+ * Structure holding the processing statistics of one command in the dispatch table:
+ * <dl>
+ * <dt>Count</dt> <dd>The number of times the command has been received.</dd>
+ * <dt>Failure_Count</dt> <dd>The number of commands that failed.</dd>
+ * <dt>Rejected_Count</dt> <dd>The number of commands rejected whilst exposing.</dd>
+ * <dt>Min_Ms</dt> <dd>The minimum processing time, in milliseconds.</dd>
+ * <dt>Max_Ms</dt> <dd>The maximum processing time, in milliseconds.</dd>
+ * <dt>Total_Ms</dt> <dd>The total processing time, in milliseconds, used to compute the mean.</dd>
+ * <dt>Histogram</dt> <dd>A histogram of processing times.</dd>
+ * </dl>
+ * @see liric_server.html#LIRIC_SERVER_HISTOGRAM_BIN_COUNT
+ */
+struct Server_Statistics_Struct
+{
+	unsigned int Count;
+	unsigned int Failure_Count;
+	unsigned int Rejected_Count;
+	double Min_Ms;
+	double Max_Ms;
+	double Total_Ms;
+	unsigned int Histogram[LIRIC_SERVER_HISTOGRAM_BIN_COUNT];
+};
+
+/**
+ * Structure holding the server's per-command statistics:
+ * <dl>
+ * <dt>Mutex</dt> <dd>A mutex protecting the statistics, as commands are processed in separate threads.</dd>
+ * <dt>Statistics_List</dt> <dd>The statistics of each command, indexed as Server_Command_List.</dd>
+ * <dt>Unknown_Count</dt> <dd>The number of unknown commands received.</dd>
+ * </dl>
+ * @see #Server_Command_List
+ * @see #Server_Statistics_Struct
+ * @see liric_server.html#LIRIC_SERVER_MAX_COMMAND_COUNT
+ */
+struct Server_Struct
+{
+	pthread_mutex_t Mutex;
+	struct Server_Statistics_Struct Statistics_List[LIRIC_SERVER_MAX_COMMAND_COUNT];
+	unsigned int Unknown_Count;
+};
+
+/* internal functions */
+static void Server_Connection_Callback(Command_Server_Handle_T connection_handle);
+static void Server_Session(Command_Server_Handle_T connection_handle);
+static void Server_Command_Process(Command_Server_Handle_T connection_handle,unsigned int *request_id,
+				   char *client_message);
+static int Server_Command_Help(char *command_string,struct Liric_General_String_Builder_Struct *reply_string);
+static int Server_Command_Shutdown(char *command_string,struct Liric_General_String_Builder_Struct *reply_string);
+static int Server_Command_Find(char *client_message);
+static void Server_Statistics_Add(int command_index,double time_ms,int failed,int rejected);
+static int Send_Reply(Command_Server_Handle_T connection_handle,unsigned int *request_id,char *reply_message);
+static int Send_Reply_String_Builder(Command_Server_Handle_T connection_handle,unsigned int *request_id,
+				     struct Liric_General_String_Builder_Struct *reply_string);
+
 /* internal data */
 /**
  * Revision Control System identifier.
@@ -45,10 +171,43 @@ static Command_Server_Server_Context_T Command_Server_Context = NULL;
  * Command server port number.
  */
 static unsigned short Command_Server_Port_Number = 1234;
-
-/* internal functions */
-static void Server_Connection_Callback(Command_Server_Handle_T connection_handle);
-static int Send_Reply(Command_Server_Handle_T connection_handle,char *reply_message);
+/**
+ * The command dispatch table. Server_Command_Process looks up each command received in this table,
+ * and processes it according to the entry found.
+ * @see #Server_Command_Struct
+ * @see #Server_Command_Process
+ * @see #Server_Command_Help
+ * @see #Server_Command_Shutdown
+ * @see liric_command.html
+ */
+static struct Server_Command_Struct Server_Command_List[] =
+{
+	{"abort",FALSE,Liric_Command_Abort,"Liric_Command_Abort",SERVER_PRIORITY_CLASS_EXPOSURE,TRUE,FALSE},
+	{"config",FALSE,Liric_Command_Config,"Liric_Command_Config",SERVER_PRIORITY_CLASS_NORMAL,FALSE,FALSE},
+	{"fan",FALSE,Liric_Command_Fan,"Liric_Command_Fan",SERVER_PRIORITY_CLASS_NORMAL,TRUE,FALSE},
+	{"fitsheader",FALSE,Liric_Command_Fits_Header,"Liric_Command_Fits_Header",SERVER_PRIORITY_CLASS_NORMAL,
+	 TRUE,FALSE},
+	{"help",TRUE,Server_Command_Help,"Server_Command_Help",SERVER_PRIORITY_CLASS_NORMAL,TRUE,FALSE},
+	{"job",FALSE,Liric_Command_Job,"Liric_Command_Job",SERVER_PRIORITY_CLASS_NORMAL,TRUE,FALSE},
+	{"multbias",FALSE,Liric_Command_MultBias,"Liric_Command_MultBias",SERVER_PRIORITY_CLASS_EXPOSURE,
+	 FALSE,FALSE},
+	{"multdark",FALSE,Liric_Command_MultDark,"Liric_Command_MultDark",SERVER_PRIORITY_CLASS_EXPOSURE,
+	 FALSE,FALSE},
+	{"multrun",FALSE,Liric_Command_Multrun,"Liric_Command_Multrun",SERVER_PRIORITY_CLASS_EXPOSURE,FALSE,FALSE},
+	{"status",FALSE,Liric_Command_Status,"Liric_Command_Status",SERVER_PRIORITY_CLASS_NORMAL,TRUE,FALSE},
+	{"shutdown",TRUE,Server_Command_Shutdown,"Server_Command_Shutdown",SERVER_PRIORITY_CLASS_NORMAL,TRUE,TRUE},
+	{"temperature",FALSE,Liric_Command_Temperature,"Liric_Command_Temperature",SERVER_PRIORITY_CLASS_NORMAL,
+	 TRUE,FALSE},
+	{"trace",FALSE,Liric_Command_Trace,"Liric_Command_Trace",SERVER_PRIORITY_CLASS_NORMAL,TRUE,FALSE}
+};
+/**
+ * The server's per-command statistics.
+ * @see #Server_Struct
+ */
+static struct Server_Struct Server_Data =
+{
+	PTHREAD_MUTEX_INITIALIZER,{{0,0,0,0.0,0.0,0.0,{0}}},0
+};
 
 /* ----------------------------------------------------------------------------
 ** 		external functions 
@@ -162,37 +321,86 @@ int Liric_Server_Stop(void)
 	return TRUE;
 }
 
+/**
+ * Get the processing statistics of each command in the dispatch table, since the server was started.
+ * @param statistics_list A list of at least max_count statistics structures, on return filled in.
+ * @param max_count The maximum number of statistics structures to return.
+ * @param statistics_count The address of an integer, on return filled in with the number of structures
+ *        filled in.
+ * @param unknown_count The address of an unsigned integer, on return filled in with the number of unknown
+ *        commands received.
+ * @return The routine returns TRUE on success and FALSE on failure. On failure, Liric_General_Error_Number and
+ *         Liric_General_Error_String are set.
+ * @see #Server_Data
+ * @see #Server_Command_List
+ * @see #SERVER_COMMAND_COUNT
+ * @see #Server_Statistics_Add
+ * @see liric_general.html#Liric_General_Error_Number
+ * @see liric_general.html#Liric_General_Error_String
+ */
+int Liric_Server_Statistics_Get(struct Liric_Server_Command_Statistics_Struct *statistics_list,int max_count,
+				int *statistics_count,unsigned int *unknown_count)
+{
+	struct Server_Statistics_Struct *statistics = NULL;
+	int i,bin;
+
+	if((statistics_list == NULL)||(statistics_count == NULL)||(unknown_count == NULL))
+	{
+		Liric_General_Error_Number = 208;
+		sprintf(Liric_General_Error_String,"Liric_Server_Statistics_Get:NULL parameter (%p,%p,%p).",
+			(void*)statistics_list,(void*)statistics_count,(void*)unknown_count);
+		return FALSE;
+	}
+	pthread_mutex_lock(&(Server_Data.Mutex));
+	(*statistics_count) = 0;
+	for(i = 0; (i < SERVER_COMMAND_COUNT)&&(i < max_count); i++)
+	{
+		statistics = &(Server_Data.Statistics_List[i]);
+		strncpy(statistics_list[i].Keyword,Server_Command_List[i].Keyword,LIRIC_SERVER_KEYWORD_LENGTH-1);
+		statistics_list[i].Keyword[LIRIC_SERVER_KEYWORD_LENGTH-1] = '\0';
+		statistics_list[i].Count = statistics->Count;
+		statistics_list[i].Failure_Count = statistics->Failure_Count;
+		statistics_list[i].Rejected_Count = statistics->Rejected_Count;
+		statistics_list[i].Min_Ms = statistics->Min_Ms;
+		statistics_list[i].Max_Ms = statistics->Max_Ms;
+		if(statistics->Count > 0)
+			statistics_list[i].Mean_Ms = statistics->Total_Ms/((double)(statistics->Count));
+		else
+			statistics_list[i].Mean_Ms = 0.0;
+		for(bin = 0; bin < LIRIC_SERVER_HISTOGRAM_BIN_COUNT; bin++)
+			statistics_list[i].Histogram[bin] = statistics->Histogram[bin];
+		(*statistics_count)++;
+	}
+	(*unknown_count) = Server_Data.Unknown_Count;
+	pthread_mutex_unlock(&(Server_Data.Mutex));
+	return TRUE;
+}
+
 /* ----------------------------------------------------------------------------
 ** 		internal functions 
 ** ---------------------------------------------------------------------------- */
 /**
- * Server connection thread, invoked whenever a new command comes in.
+ * Server connection thread, invoked whenever a new connection comes in.
+ * <ul>
+ * <li>We read the first message from the client.
+ * <li>If the message is SERVER_SESSION_COMMAND, the client wants a persistent session, and we call Server_Session
+ *     to handle the rest of the connection.
+ * <li>Otherwise the message is a single command, and we call Server_Command_Process to process it and send
+ *     the reply. The connection is then closed when we return.
+ * </ul>
  * @param connection_handle Connection handle for this thread.
- * @see #Send_Reply
- * @see #Liric_Server_Stop
- * @see liric_command.html#Liric_Command_Abort
- * @see liric_command.html#Liric_Command_Config
- * @see liric_command.html#Liric_Command_Fits_Header
- * @see liric_command.html#Liric_Command_Multrun
- * @see liric_command.html#Liric_Command_MultBias
- * @see liric_command.html#Liric_Command_MultDark
- * @see liric_command.html#Liric_Command_Status
- * @see liric_command.html#Liric_Command_Temperature
+ * @see #SERVER_SESSION_COMMAND
+ * @see #Server_Session
+ * @see #Server_Command_Process
  * @see liric_general.html#Liric_General_Error_Number
  * @see liric_general.html#Liric_General_Error_String
  * @see liric_general.html#Liric_General_Log_Format
- * @see liric_general.html#Liric_General_Thread_Priority_Set_Normal
- * @see liric_general.html#Liric_General_Thread_Priority_Set_Exposure
  * @see ../command_server/cdocs/command_server.html#Command_Server_Read_Message
  */
 static void Server_Connection_Callback(Command_Server_Handle_T connection_handle)
 {
-	void *buffer_ptr = NULL;
-	size_t buffer_length = 0;
-	char *reply_string = NULL;
 	char *client_message = NULL;
 	int retval;
-	int seconds,i;
 
 	/* get message from client */
 	retval = Command_Server_Read_Message(connection_handle, &client_message);
@@ -209,458 +417,408 @@ static void Server_Connection_Callback(Command_Server_Handle_T connection_handle
 	Liric_General_Log_Format("server","liric_server.c","Liric_Server_Connection_Callback",
 				      LOG_VERBOSITY_VERY_TERSE,"SERVER","received '%s'",client_message);
 #endif
-	/* do something with message */
-	if(strncmp(client_message,"abort",5) == 0)
+	if(strcmp(client_message,SERVER_SESSION_COMMAND) == 0)
 	{
+		free(client_message);
+		Server_Session(connection_handle);
+		return;
+	}
+	Server_Command_Process(connection_handle,NULL,client_message);
+	/* free message */
+	free(client_message);
+}
+
+/**
+ * Handle a persistent session on a connection. This allows a client to send many commands over one connection,
+ * rather than connecting once per command. It also allows the client to pipeline commands, i.e. send
+ * several commands before reading any of the replies.
+ * <ul>
+ * <li>We send a reply to the SERVER_SESSION_COMMAND message, framed as the reply to request id 0.
+ * <li>We loop, reading messages from the client until the client closes the connection (or the read fails).
+ *     Each message is of the form "&lt;request id&gt; &lt;command&gt;", where &lt;request id&gt; is an
+ *     unsigned integer chosen by the client.
+ * <li>Each command is processed in turn by Server_Command_Process, which sends the reply framed as
+ *     "&lt;request id&gt; &lt;length&gt; &lt;reply&gt;" (see Send_Reply). The commands in one session are 
+ *     processed in the order they are received, so a long command (i.e. a multrun) delays the replies to any 
+ *     commands pipelined behind it. Clients should use another connection for commands that must not wait.
+ * <li>A "shutdown" command ends the session after it is processed.
+ * </ul>
+ * @param connection_handle Connection handle for this thread.
+ * @see #Server_Command_Process
+ * @see #Send_Reply
+ * @see liric_general.html#Liric_General_Error_Number
+ * @see liric_general.html#Liric_General_Error_String
+ * @see liric_general.html#Liric_General_Log
+ * @see liric_general.html#Liric_General_Log_Format
+ * @see ../command_server/cdocs/command_server.html#Command_Server_Read_Message
+ */
+static void Server_Session(Command_Server_Handle_T connection_handle)
+{
+	char *client_message = NULL;
+	unsigned int request_id,command_count;
+	int retval,command_index,done;
+
 #if LIRIC_DEBUG > 1
-		Liric_General_Log("server","liric_server.c","Liric_Server_Connection_Callback",
-				       LOG_VERBOSITY_VERY_TERSE,"SERVER","abort detected.");
+	Liric_General_Log("server","liric_server.c","Server_Session",LOG_VERBOSITY_VERY_TERSE,"SERVER",
+			  "session started.");
 #endif
-		/* exposure thread priority */
-		if(!Liric_General_Thread_Priority_Set_Exposure())
-		{
-			Liric_General_Error("server","liric_server.c",
-						 "Liric_Server_Connection_Callback",
-						 LOG_VERBOSITY_VERY_TERSE,"SERVER");
-		}
-		retval = Liric_Command_Abort(client_message,&reply_string);
-		if(retval == TRUE)
-		{
-			retval = Send_Reply(connection_handle,reply_string);
-			if(reply_string != NULL)
-				free(reply_string);
-			if(retval == FALSE)
-			{
-				Liric_General_Error("server","liric_server.c",
-							 "Liric_Server_Connection_Callback",
-							 LOG_VERBOSITY_VERY_TERSE,"SERVER");
-			}
-		}
-		else
+	request_id = 0;
+	if(!Send_Reply(connection_handle,&request_id,"0 session started"))
+	{
+		Liric_General_Error("server","liric_server.c","Server_Session",LOG_VERBOSITY_VERY_TERSE,"SERVER");
+		return;
+	}
+	command_count = 0;
+	done = FALSE;
+	while(done == FALSE)
+	{
+		/* a failed read is normally the client closing the session */
+		retval = Command_Server_Read_Message(connection_handle, &client_message);
+		if(retval == FALSE)
+			break;
+		command_index = 0;
+		retval = sscanf(client_message,"%u %n",&request_id,&command_index);
+		if((retval < 1)||(command_index == 0))
 		{
-			Liric_General_Error("server","liric_server.c",
-						 "Liric_Server_Connection_Callback",
-						 LOG_VERBOSITY_VERY_TERSE,"SERVER");
-			retval = Send_Reply(connection_handle, "1 Liric_Command_Abort failed.");
-			if(retval == FALSE)
+			Liric_General_Error_Number = 205;
+			sprintf(Liric_General_Error_String,"Server_Session:Failed to parse request id from '%.80s'.",
+				client_message);
+			Liric_General_Error("server","liric_server.c","Server_Session",LOG_VERBOSITY_VERY_TERSE,
+					    "SERVER");
+			request_id = 0;
+			if(!Send_Reply(connection_handle,&request_id,"1 Failed to parse session request id."))
 			{
-				Liric_General_Error("server","liric_server.c",
-						     "Liric_Server_Connection_Callback",
-						     LOG_VERBOSITY_VERY_TERSE,"SERVER");
+				Liric_General_Error("server","liric_server.c","Server_Session",LOG_VERBOSITY_VERY_TERSE,
+						    "SERVER");
+				done = TRUE;
 			}
+			free(client_message);
+			continue;
 		}
+#if LIRIC_DEBUG > 1
+		Liric_General_Log_Format("server","liric_server.c","Server_Session",LOG_VERBOSITY_VERY_TERSE,
+					 "SERVER","received request %u '%s'",request_id,client_message+command_index);
+#endif
+		Server_Command_Process(connection_handle,&request_id,client_message+command_index);
+		command_count++;
+		if(strcmp(client_message+command_index,"shutdown") == 0)
+			done = TRUE;
+		free(client_message);
 	}
-	else if(strncmp(client_message,"config",6) == 0)
+#if LIRIC_DEBUG > 1
+	Liric_General_Log_Format("server","liric_server.c","Server_Session",LOG_VERBOSITY_VERY_TERSE,"SERVER",
+				 "session finished after %u commands.",command_count);
+#endif
+}
+
+/**
+ * Process one command from a client, and send the reply.
+ * <ul>
+ * <li>We look up the command in the Server_Command_List dispatch table (Server_Command_Find).
+ *     Unknown commands get a failure reply, and are counted in Server_Data.Unknown_Count.
+ * <li>We set the thread priority according to the command's priority class.
+ * <li>If the command is not allowed whilst a multrun/multbias/multdark or job is in progress, and one is, 
+ *     we reply with a failure and count the command as rejected.
+ * <li>Otherwise we call the command's handler, which builds it's reply in a string builder using a stack buffer
+ *     (with head room for the session framing), and send the reply (or a generic failure reply if the handler
+ *     failed) with Send_Reply_String_Builder.
+ * <li>If the command stops the server ("shutdown"), we call Liric_Server_Stop after the reply has been sent.
+ * <li>We record the time taken to process the command, and whether it failed, in the command's statistics
+ *     (Server_Statistics_Add).
+ * </ul>
+ * @param connection_handle Connection handle for this thread.
+ * @param request_id If the command was received in a session, the address of the request id it was sent with, 
+ *        used to frame the reply. Otherwise NULL, and the reply is sent unframed.
+ * @param client_message The command. This is not changed or freed during this routine.
+ * @see #Server_Command_List
+ * @see #Server_Command_Find
+ * @see #Server_Statistics_Add
+ * @see #Server_Data
+ * @see #Send_Reply
+ * @see #Send_Reply_String_Builder
+ * @see #SERVER_REPLY_BUFFER_LENGTH
+ * @see #SERVER_REPLY_FRAME_LENGTH
+ * @see #Liric_Server_Stop
+ * @see liric_general.html#Liric_General_Error
+ * @see liric_general.html#Liric_General_Error_Number
+ * @see liric_general.html#Liric_General_Error_String
+ * @see liric_general.html#Liric_General_Log_Format
+ * @see liric_general.html#Liric_General_String_Builder_Initialise
+ * @see liric_general.html#Liric_General_String_Builder_Get
+ * @see liric_general.html#Liric_General_String_Builder_Length_Get
+ * @see liric_general.html#Liric_General_String_Builder_Free
+ * @see liric_general.html#Liric_General_Thread_Priority_Set_Normal
+ * @see liric_general.html#Liric_General_Thread_Priority_Set_Exposure
+ * @see liric_multrun.html#Liric_Multrun_In_Progress
+ * @see liric_bias_dark.html#Liric_Bias_Dark_In_Progress
+ * @see liric_job.html#Liric_Job_Detector_Claimed
+ * @see ../detector/cdocs/detector_trace.html#Detector_Trace_Thread_Name_Set
+ * @see ../detector/cdocs/detector_trace.html#Detector_Trace_Span_Start
+ * @see ../detector/cdocs/detector_trace.html#Detector_Trace_Span_End
+ */
+static void Server_Command_Process(Command_Server_Handle_T connection_handle,unsigned int *request_id,
+				   char *client_message)
+{
+	struct Server_Command_Struct *command = NULL;
+	struct Liric_General_String_Builder_Struct reply_string;
+	char reply_buffer[SERVER_REPLY_BUFFER_LENGTH];
+	char failure_string[64];
+	struct timespec trace_time,start_time,end_time;
+	int retval,command_index,failed;
+
+	/* each command is handled in it's own thread, name it in the trace and time the whole command */
+	Detector_Trace_Thread_Name_Set("command");
+	Detector_Trace_Span_Start(&trace_time);
+	clock_gettime(CLOCK_REALTIME,&start_time);
+	command_index = Server_Command_Find(client_message);
+	if(command_index < 0)
 	{
 #if LIRIC_DEBUG > 1
-		Liric_General_Log("server","liric_server.c","Liric_Server_Connection_Callback",
-				       LOG_VERBOSITY_VERY_TERSE,"SERVER","config detected.");
+		Liric_General_Log_Format("server","liric_server.c","Server_Command_Process",
+					      LOG_VERBOSITY_VERY_TERSE,"SERVER","message unknown: '%s'\n",
+					      client_message);
 #endif
-		/* normal thread priority */
-		if(!Liric_General_Thread_Priority_Set_Normal())
-		{
-			Liric_General_Error("server","liric_server.c",
-						 "Liric_Server_Connection_Callback",
-						 LOG_VERBOSITY_VERY_TERSE,"SERVER");
-		}
-		retval = Liric_Command_Config(client_message,&reply_string);
-		if(retval == TRUE)
-		{
-			retval = Send_Reply(connection_handle,reply_string);
-			if(reply_string != NULL)
-				free(reply_string);
-			if(retval == FALSE)
-			{
-				Liric_General_Error("server","liric_server.c",
-							 "Liric_Server_Connection_Callback",
-							 LOG_VERBOSITY_VERY_TERSE,"SERVER");
-			}
-		}
-		else
+		pthread_mutex_lock(&(Server_Data.Mutex));
+		Server_Data.Unknown_Count++;
+		pthread_mutex_unlock(&(Server_Data.Mutex));
+		retval = Send_Reply(connection_handle,request_id,"1 failed message unknown");
+		if(retval == FALSE)
 		{
-			Liric_General_Error("server","liric_server.c",
-					     "Liric_Server_Connection_Callback",
-					     LOG_VERBOSITY_VERY_TERSE,"SERVER");
-			retval = Send_Reply(connection_handle, "1 Liric_Command_Config failed.");
-			if(retval == FALSE)
-			{
-				Liric_General_Error("server","liric_server.c",
-						     "Liric_Server_Connection_Callback",
-						     LOG_VERBOSITY_VERY_TERSE,"SERVER");
-			}
+			Liric_General_Error("server","liric_server.c","Server_Command_Process",
+					    LOG_VERBOSITY_VERY_TERSE,"SERVER");
 		}
+		Detector_Trace_Span_End("command","command",client_message,&trace_time);
+		return;
 	}
-	else if(strncmp(client_message,"fan",3) == 0)
-	{
+	command = &(Server_Command_List[command_index]);
 #if LIRIC_DEBUG > 1
-		Liric_General_Log("server","liric_server.c","Liric_Server_Connection_Callback",
-				       LOG_VERBOSITY_VERY_TERSE,"SERVER","fan detected.");
+	Liric_General_Log_Format("server","liric_server.c","Server_Command_Process",LOG_VERBOSITY_VERY_TERSE,
+				 "SERVER","%s detected.",command->Keyword);
 #endif
-		/* normal thread priority */
-		if(!Liric_General_Thread_Priority_Set_Normal())
-		{
-			Liric_General_Error("server","liric_server.c",
-						 "Liric_Server_Connection_Callback",
-						 LOG_VERBOSITY_VERY_TERSE,"SERVER");
-		}
-		retval = Liric_Command_Fan(client_message,&reply_string);
-		if(retval == TRUE)
+	/* set thread priority */
+	if(command->Priority_Class == SERVER_PRIORITY_CLASS_EXPOSURE)
+		retval = Liric_General_Thread_Priority_Set_Exposure();
+	else
+		retval = Liric_General_Thread_Priority_Set_Normal();
+	if(retval == FALSE)
+	{
+		Liric_General_Error("server","liric_server.c","Server_Command_Process",LOG_VERBOSITY_VERY_TERSE,
+				    "SERVER");
+	}
+	/* some commands would interfere with a multrun or job in progress */
+	if((command->Allowed_While_Exposing == FALSE)&&
+	   (Liric_Job_Detector_Claimed()||Liric_Multrun_In_Progress()||Liric_Bias_Dark_In_Progress()))
+	{
+		Liric_General_Error_Number = 207;
+		sprintf(Liric_General_Error_String,"Server_Command_Process:"
+			"Command '%.80s' not allowed whilst a multrun/multbias/multdark/job is in progress.",
+			client_message);
+		Liric_General_Error("server","liric_server.c","Server_Command_Process",LOG_VERBOSITY_VERY_TERSE,
+				    "SERVER");
+		sprintf(failure_string,"1 %s not allowed whilst exposing.",command->Keyword);
+		retval = Send_Reply(connection_handle,request_id,failure_string);
+		if(retval == FALSE)
 		{
-			retval = Send_Reply(connection_handle,reply_string);
-			if(reply_string != NULL)
-				free(reply_string);
-			if(retval == FALSE)
-			{
-				Liric_General_Error("server","liric_server.c",
-							 "Liric_Server_Connection_Callback",
-							 LOG_VERBOSITY_VERY_TERSE,"SERVER");
-			}
+			Liric_General_Error("server","liric_server.c","Server_Command_Process",
+					    LOG_VERBOSITY_VERY_TERSE,"SERVER");
 		}
+		clock_gettime(CLOCK_REALTIME,&end_time);
+		Server_Statistics_Add(command_index,fdifftime(end_time,start_time)*LIRIC_GENERAL_ONE_SECOND_MS,TRUE,
+				      TRUE);
+		Detector_Trace_Span_End("command","command",client_message,&trace_time);
+		return;
+	}
+	/* call the command's handler and send the reply */
+	Liric_General_String_Builder_Initialise(&reply_string,reply_buffer,SERVER_REPLY_BUFFER_LENGTH,
+						SERVER_REPLY_FRAME_LENGTH);
+	retval = (*(command->Handler))(client_message,&reply_string);
+	if(retval == TRUE)
+	{
+		failed = ((Liric_General_String_Builder_Length_Get(&reply_string) == 0)||
+			  (Liric_General_String_Builder_Get(&reply_string)[0] != '0'));
+		if(Liric_General_String_Builder_Length_Get(&reply_string) > 0)
+			retval = Send_Reply_String_Builder(connection_handle,request_id,&reply_string);
 		else
-		{
-			Liric_General_Error("server","liric_server.c",
-					     "Liric_Server_Connection_Callback",
-					     LOG_VERBOSITY_VERY_TERSE,"SERVER");
-			retval = Send_Reply(connection_handle, "1 Liric_Command_Fan failed.");
-			if(retval == FALSE)
-			{
-				Liric_General_Error("server","liric_server.c",
-						     "Liric_Server_Connection_Callback",
-						     LOG_VERBOSITY_VERY_TERSE,"SERVER");
-			}
-		}
+			retval = Send_Reply(connection_handle,request_id,"1 No reply.");
 	}
-	else if(strncmp(client_message,"fitsheader",10) == 0)
+	else
+	{
+		failed = TRUE;
+		Liric_General_Error("server","liric_server.c","Server_Command_Process",LOG_VERBOSITY_VERY_TERSE,
+				    "SERVER");
+		sprintf(failure_string,"1 %s failed.",command->Handler_Name);
+		retval = Send_Reply(connection_handle,request_id,failure_string);
+	}
+	Liric_General_String_Builder_Free(&reply_string);
+	if(retval == FALSE)
+	{
+		failed = TRUE;
+		Liric_General_Error("server","liric_server.c","Server_Command_Process",LOG_VERBOSITY_VERY_TERSE,
+				    "SERVER");
+	}
+	if(command->Stops_Server)
 	{
 #if LIRIC_DEBUG > 1
-		Liric_General_Log("server","liric_server.c","Liric_Server_Connection_Callback",
-				       LOG_VERBOSITY_VERY_TERSE,"SERVER","fitsheader detected.");
+		Liric_General_Log("server","liric_server.c","Server_Command_Process",LOG_VERBOSITY_VERY_TERSE,
+				  "SERVER","about to stop.");
 #endif
-		/* normal thread priority */
-		if(!Liric_General_Thread_Priority_Set_Normal())
-		{
-			Liric_General_Error("server","liric_server.c",
-					     "Liric_Server_Connection_Callback",
-					     LOG_VERBOSITY_VERY_TERSE,"SERVER");
-		}
-		retval = Liric_Command_Fits_Header(client_message,&reply_string);
-		if(retval == TRUE)
+		if(!Liric_Server_Stop())
 		{
-			retval = Send_Reply(connection_handle,reply_string);
-			if(reply_string != NULL)
-				free(reply_string);
-			if(retval == FALSE)
-			{
-				Liric_General_Error("server","liric_server.c",
-						     "Liric_Server_Connection_Callback",
-						     LOG_VERBOSITY_VERY_TERSE,"SERVER");
-			}
-		}
-		else
-		{
-			Liric_General_Error("server","liric_server.c",
-						 "Liric_Server_Connection_Callback",
-						 LOG_VERBOSITY_VERY_TERSE,"SERVER");
-			retval = Send_Reply(connection_handle, "1 Liric_Command_Fits_Header failed.");
-			if(retval == FALSE)
-			{
-				Liric_General_Error("server","liric_server.c",
-						     "Liric_Server_Connection_Callback",
-						     LOG_VERBOSITY_VERY_TERSE,"SERVER");
-			}
+			Liric_General_Error("server","liric_server.c","Server_Command_Process",
+					    LOG_VERBOSITY_VERY_TERSE,"SERVER");
 		}
 	}
-	else if(strcmp(client_message, "help") == 0)
+	clock_gettime(CLOCK_REALTIME,&end_time);
+	Server_Statistics_Add(command_index,fdifftime(end_time,start_time)*LIRIC_GENERAL_ONE_SECOND_MS,failed,FALSE);
+	Detector_Trace_Span_End("command","command",client_message,&trace_time);
+}
+
+/**
+ * Find a command in the Server_Command_List dispatch table. Commands with Exact_Match set must match the whole
+ * message, other commands match if the message starts with the command's keyword.
+ * @param client_message The command message from the client.
+ * @return The index of the command in Server_Command_List, or -1 if the command is unknown.
+ * @see #Server_Command_List
+ * @see #SERVER_COMMAND_COUNT
+ */
+static int Server_Command_Find(char *client_message)
+{
+	int i;
+
+	for(i = 0; i < SERVER_COMMAND_COUNT; i++)
 	{
-#if LIRIC_DEBUG > 1
-		Liric_General_Log("server","liric_server.c","Liric_Server_Connection_Callback",
-				   LOG_VERBOSITY_VERY_TERSE,"SERVER","help detected.");
-#endif
-		/* normal thread priority */
-		if(!Liric_General_Thread_Priority_Set_Normal())
+		if(Server_Command_List[i].Exact_Match)
 		{
-			Liric_General_Error("server","liric_server.c",
-						 "Liric_Server_Connection_Callback",
-						 LOG_VERBOSITY_VERY_TERSE,"SERVER");
+			if(strcmp(client_message,Server_Command_List[i].Keyword) == 0)
+				return i;
 		}
-		Send_Reply(connection_handle, "help:\n"
+		else if(strncmp(client_message,Server_Command_List[i].Keyword,
+				strlen(Server_Command_List[i].Keyword)) == 0)
+			return i;
+	}
+	return -1;
+}
+
+/**
+ * Add the result of processing a command to the command's statistics.
+ * @param command_index The index of the command in Server_Command_List.
+ * @param time_ms The time taken to process the command (including sending the reply), in milliseconds.
+ * @param failed A boolean, TRUE if the command failed (the handler failed, the reply was a failure reply,
+ *        or the reply could not be sent).
+ * @param rejected A boolean, TRUE if the command was rejected because a multrun/multbias/multdark was in progress.
+ * @see #Server_Data
+ * @see #SERVER_HISTOGRAM_FIRST_BIN_MS
+ * @see liric_server.html#LIRIC_SERVER_HISTOGRAM_BIN_COUNT
+ */
+static void Server_Statistics_Add(int command_index,double time_ms,int failed,int rejected)
+{
+	struct Server_Statistics_Struct *statistics = NULL;
+	double bin_upper_ms;
+	int bin;
+
+	bin = 0;
+	bin_upper_ms = SERVER_HISTOGRAM_FIRST_BIN_MS;
+	while((bin < (LIRIC_SERVER_HISTOGRAM_BIN_COUNT-1))&&(time_ms >= bin_upper_ms))
+	{
+		bin++;
+		bin_upper_ms *= 10.0;
+	}
+	pthread_mutex_lock(&(Server_Data.Mutex));
+	statistics = &(Server_Data.Statistics_List[command_index]);
+	if((statistics->Count == 0)||(time_ms < statistics->Min_Ms))
+		statistics->Min_Ms = time_ms;
+	if((statistics->Count == 0)||(time_ms > statistics->Max_Ms))
+		statistics->Max_Ms = time_ms;
+	statistics->Count++;
+	statistics->Total_Ms += time_ms;
+	if(failed)
+		statistics->Failure_Count++;
+	if(rejected)
+		statistics->Rejected_Count++;
+	statistics->Histogram[bin]++;
+	pthread_mutex_unlock(&(Server_Data.Mutex));
+}
+
+/**
+ * The handler for the "help" command. The reply lists the commands the server understands.
+ * @param command_string The command. This is not changed during this routine.
+ * @param reply_string The string builder to build the reply string in.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see liric_general.html#Liric_General_String_Builder_Add
+ */
+static int Server_Command_Help(char *command_string,struct Liric_General_String_Builder_Struct *reply_string)
+{
+	return Liric_General_String_Builder_Add(reply_string,"help:\n"
 			   "\tabort\n"
 			   "\tconfig filter <filter_name>\n"
 			   "\tconfig coadd_exp_len <short|long>\n"
 			   "\tconfig nudgematic <none|small|large>\n"
+			   "\tconfig reload\n"
 			   "\tfan <on|off>\n"
 			   "\tfitsheader add <keyword> <boolean|float|integer|string|comment|units> <value>\n"
 			   "\tfitsheader delete <keyword>\n"
 			   "\tfitsheader clear\n"
 			   "\thelp\n"
+			   "\tjob multrun <length> <count> <standard>\n"
+			   "\tjob multbias <count>\n"
+			   "\tjob multdark <length> <count>\n"
+			   "\tjob status <job id>\n"
+			   "\tjob frames <job id> <first frame index> [<timeout ms>]\n"
+			   "\tjob abort <job id>\n"
 			   "\tmultbias <count>\n"
 			   "\tmultdark <length> <count>\n"
 			   "\tmultrun <length> <count> <standard>\n"
 			   "\tstatus [name|identification|fits_instrument_code]\n"
-			   "\tstatus temperature [get|pcb]\n"
+			   "\tstatus temperature [get|pcb|tec|fpga]\n"
+			   "\tstatus telemetry [history <hours> [<points>]]\n"
 			   "\tstatus filterwheel [filter|position|status]\n"
 			   "\tstatus nudgematic [offsetsize|position|status]\n"
 			   "\tstatus exposure [status|count|length|coadd-count|coadd-length|start_time]\n"
-			   "\tstatus exposure [index|multrun|run]\n"
+			   "\tstatus exposure [index|multrun|run|stats|accumulator]\n"
+			   "\tstatus log\n"
+			   "\tstatus serial\n"
+			   "\tstatus server\n"
+			   "\tstatus startup\n"
+			   "\tstatus all\n"
 			   "\tshutdown\n"
-			   "\ttemperature <degrees centigrade>\n");
-	}
-	else if(strncmp(client_message,"multbias",8) == 0)
-	{
-#if LIRIC_DEBUG > 1
-		Liric_General_Log("server","liric_server.c","Liric_Server_Connection_Callback",
-				       LOG_VERBOSITY_VERY_TERSE,"SERVER","multbias detected.");
-#endif
-		/* exposure thread priority */
-		if(!Liric_General_Thread_Priority_Set_Exposure())
-		{
-			Liric_General_Error("server","liric_server.c",
-						 "Liric_Server_Connection_Callback",
-						 LOG_VERBOSITY_VERY_TERSE,"SERVER");
-		}
-		retval = Liric_Command_MultBias(client_message,&reply_string);
-		if(retval == TRUE)
-		{
-			retval = Send_Reply(connection_handle,reply_string);
-			if(reply_string != NULL)
-				free(reply_string);
-			if(retval == FALSE)
-			{
-				Liric_General_Error("server","liric_server.c",
-							 "Liric_Server_Connection_Callback",
-							 LOG_VERBOSITY_VERY_TERSE,"SERVER");
-			}
-		}
-		else
-		{
-			Liric_General_Error("server","liric_server.c",
-						 "Liric_Server_Connection_Callback",
-						 LOG_VERBOSITY_VERY_TERSE,"SERVER");
-			retval = Send_Reply(connection_handle, "1 Liric_Command_MultBias failed.");
-			if(retval == FALSE)
-			{
-				Liric_General_Error("server","liric_server.c",
-							 "Liric_Server_Connection_Callback",
-							 LOG_VERBOSITY_VERY_TERSE,"SERVER");
-			}
-		}
-	}
-	else if(strncmp(client_message,"multdark",8) == 0)
-	{
-#if LIRIC_DEBUG > 1
-		Liric_General_Log("server","liric_server.c","Liric_Server_Connection_Callback",
-				       LOG_VERBOSITY_VERY_TERSE,"SERVER","multdark detected.");
-#endif
-		/* exposure thread priority */
-		if(!Liric_General_Thread_Priority_Set_Exposure())
-		{
-			Liric_General_Error("server","liric_server.c",
-						 "Liric_Server_Connection_Callback",
-						 LOG_VERBOSITY_VERY_TERSE,"SERVER");
-		}
-		retval = Liric_Command_MultDark(client_message,&reply_string);
-		if(retval == TRUE)
-		{
-			retval = Send_Reply(connection_handle,reply_string);
-			if(reply_string != NULL)
-				free(reply_string);
-			if(retval == FALSE)
-			{
-				Liric_General_Error("server","liric_server.c",
-							 "Liric_Server_Connection_Callback",
-							 LOG_VERBOSITY_VERY_TERSE,"SERVER");
-			}
-		}
-		else
-		{
-			Liric_General_Error("server","liric_server.c",
-						 "Liric_Server_Connection_Callback",
-						 LOG_VERBOSITY_VERY_TERSE,"SERVER");
-			retval = Send_Reply(connection_handle, "1 Liric_Command_MultDark failed.");
-			if(retval == FALSE)
-			{
-				Liric_General_Error("server","liric_server.c",
-							 "Liric_Server_Connection_Callback",
-							 LOG_VERBOSITY_VERY_TERSE,"SERVER");
-			}
-		}
-	}
-	else if(strncmp(client_message,"multrun",7) == 0)
-	{
-#if LIRIC_DEBUG > 1
-		Liric_General_Log("server","liric_server.c","Liric_Server_Connection_Callback",
-				       LOG_VERBOSITY_VERY_TERSE,"SERVER","multrun detected.");
-#endif
-		/* exposure thread priority */
-		if(!Liric_General_Thread_Priority_Set_Exposure())
-		{
-			Liric_General_Error("server","liric_server.c",
-						 "Liric_Server_Connection_Callback",
-						 LOG_VERBOSITY_VERY_TERSE,"SERVER");
-		}
-		retval = Liric_Command_Multrun(client_message,&reply_string);
-		if(retval == TRUE)
-		{
-			retval = Send_Reply(connection_handle,reply_string);
-			if(reply_string != NULL)
-				free(reply_string);
-			if(retval == FALSE)
-			{
-				Liric_General_Error("server","liric_server.c",
-							 "Liric_Server_Connection_Callback",
-							 LOG_VERBOSITY_VERY_TERSE,"SERVER");
-			}
-		}
-		else
-		{
-			Liric_General_Error("server","liric_server.c",
-						 "Liric_Server_Connection_Callback",
-						 LOG_VERBOSITY_VERY_TERSE,"SERVER");
-			retval = Send_Reply(connection_handle, "1 Liric_Command_Multrun failed.");
-			if(retval == FALSE)
-			{
-				Liric_General_Error("server","liric_server.c",
-							 "Liric_Server_Connection_Callback",
-							 LOG_VERBOSITY_VERY_TERSE,"SERVER");
-			}
-		}
-	}
-	else if(strncmp(client_message,"status",6) == 0)
-	{
-#if LIRIC_DEBUG > 1
-		Liric_General_Log("server","liric_server.c","Liric_Server_Connection_Callback",
-				       LOG_VERBOSITY_VERY_TERSE,"SERVER","status detected.");
-#endif
-		/* normal thread priority */
-		if(!Liric_General_Thread_Priority_Set_Normal())
-		{
-			Liric_General_Error("server","liric_server.c","Liric_Server_Connection_Callback",
-			                     LOG_VERBOSITY_VERY_TERSE,"SERVER");
-		}
-		retval = Liric_Command_Status(client_message,&reply_string);
-		if(retval == TRUE)
-		{
-			retval = Send_Reply(connection_handle,reply_string);
-			if(reply_string != NULL)
-				free(reply_string);
-			if(retval == FALSE)
-			{
-				Liric_General_Error("server","liric_server.c",
-							 "Liric_Server_Connection_Callback",
-							 LOG_VERBOSITY_VERY_TERSE,"SERVER");
-			}
-		}
-		else
-		{
-			Liric_General_Error("server","liric_server.c",
-						 "Liric_Server_Connection_Callback",
-						 LOG_VERBOSITY_VERY_TERSE,"SERVER");
-			retval = Send_Reply(connection_handle, "1 Liric_Command_Status failed.");
-			if(retval == FALSE)
-			{
-				Liric_General_Error("server","liric_server.c",
-							 "Liric_Server_Connection_Callback",
-							 LOG_VERBOSITY_VERY_TERSE,"SERVER");
-			}
-		}
-	}
-	else if(strcmp(client_message, "shutdown") == 0)
-	{
-#if LIRIC_DEBUG > 1
-		Liric_General_Log("server","liric_server.c","Liric_Server_Connection_Callback",
-				       LOG_VERBOSITY_VERY_TERSE,"SERVER","shutdown detected:about to stop.");
-#endif
-		/* normal thread priority */
-		if(!Liric_General_Thread_Priority_Set_Normal())
-		{
-			Liric_General_Error("server","liric_server.c",
-						 "Liric_Server_Connection_Callback",
-						 LOG_VERBOSITY_VERY_TERSE,"SERVER");
-		}
-		retval = Send_Reply(connection_handle, "0 ok");
-		if(retval == FALSE)
-			Liric_General_Error("server","liric_server.c",
-						 "Liric_Server_Connection_Callback",
-						 LOG_VERBOSITY_VERY_TERSE,"SERVER");
-		retval = Liric_Server_Stop();
-		if(retval == FALSE)
-		{
-			Liric_General_Error("server","liric_server.c",
-						 "Liric_Server_Connection_Callback",
-						 LOG_VERBOSITY_VERY_TERSE,"SERVER");
-		}
-	}
-	else if(strncmp(client_message,"temperature",11) == 0)
-	{
-#if LIRIC_DEBUG > 1
-		Liric_General_Log("server","liric_server.c","Liric_Server_Connection_Callback",
-				       LOG_VERBOSITY_VERY_TERSE,"SERVER","temperature detected.");
-#endif
-		/* normal thread priority */
-		if(!Liric_General_Thread_Priority_Set_Normal())
-		{
-			Liric_General_Error("server","liric_server.c",
-						 "Liric_Server_Connection_Callback",
-						 LOG_VERBOSITY_VERY_TERSE,"SERVER");
-		}
-		retval = Liric_Command_Temperature(client_message,&reply_string);
-		if(retval == TRUE)
-		{
-			retval = Send_Reply(connection_handle,reply_string);
-			if(reply_string != NULL)
-				free(reply_string);
-			if(retval == FALSE)
-			{
-				Liric_General_Error("server","liric_server.c",
-							 "Liric_Server_Connection_Callback",
-							 LOG_VERBOSITY_VERY_TERSE,"SERVER");
-			}
-		}
-		else
-		{
-			Liric_General_Error("server","liric_server.c",
-					     "Liric_Server_Connection_Callback",
-					     LOG_VERBOSITY_VERY_TERSE,"SERVER");
-			retval = Send_Reply(connection_handle, "1 Liric_Command_Temperature failed.");
-			if(retval == FALSE)
-			{
-				Liric_General_Error("server","liric_server.c",
-						     "Liric_Server_Connection_Callback",
-						     LOG_VERBOSITY_VERY_TERSE,"SERVER");
-			}
-		}
-	}
-	else
-	{
-#if LIRIC_DEBUG > 1
-		Liric_General_Log_Format("server","liric_server.c","Liric_Server_Connection_Callback",
-					      LOG_VERBOSITY_VERY_TERSE,"SERVER","message unknown: '%s'\n",
-					      client_message);
-#endif
-		retval = Send_Reply(connection_handle, "1 failed message unknown");
-		if(retval == FALSE)
-		{
-			Liric_General_Error("server","liric_server.c",
-						 "Liric_Server_Connection_Callback",
-						 LOG_VERBOSITY_VERY_TERSE,"SERVER");
-		}
-	}
-	/* free message */
-	free(client_message);
+			   "\ttemperature <degrees centigrade>\n"
+			   "\ttrace <on|off|clear>\n"
+			   "\ttrace dump <filename>\n");
+}
+
+/**
+ * The handler for the "shutdown" command. The reply is "0 ok". The server is stopped by Server_Command_Process
+ * once the reply has been sent, as the command has Stops_Server set in Server_Command_List.
+ * @param command_string The command. This is not changed during this routine.
+ * @param reply_string The string builder to build the reply string in.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Server_Command_Process
+ * @see liric_general.html#Liric_General_String_Builder_Add
+ */
+static int Server_Command_Shutdown(char *command_string,struct Liric_General_String_Builder_Struct *reply_string)
+{
+	return Liric_General_String_Builder_Add(reply_string,"0 ok");
 }
 
 /**
- * Send a message back to the client.
+ * Send a message back to the client. If the command being replied to was received in a session, the reply is
+ * framed as "&lt;request id&gt; &lt;length&gt; &lt;reply&gt;", where &lt;length&gt; is the length of 
+ * &lt;reply&gt; in bytes. This allows the client to match replies to pipelined requests, and to find the end
+ * of replies that contain newlines (i.e. "help") without the connection being closed.
  * @param connection_handle The command server connection handle for this thread.
+ * @param request_id The address of the request id of the command being replied to, if it was received in a session,
+ *        or NULL to send the reply unframed.
  * @param reply_message The message to send.
  * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #SERVER_REPLY_FRAME_LENGTH
  * @see liric_general.html#Liric_General_Error_Number
  * @see liric_general.html#Liric_General_Error_String
  * @see liric_general.html#Liric_General_Log_Format
  * @see ../command_server/cdocs/command_server.html#Command_Server_Write_Message
  */
-static int Send_Reply(Command_Server_Handle_T connection_handle,char *reply_message)
+static int Send_Reply(Command_Server_Handle_T connection_handle,unsigned int *request_id,char *reply_message)
 {
+	char *framed_message = NULL;
 	int retval;
 
 	/* send something back to the client */
@@ -668,7 +826,22 @@ static int Send_Reply(Command_Server_Handle_T connection_handle,char *reply_mess
 	Liric_General_Log_Format("server","liric_server.c","Send_Reply",LOG_VERBOSITY_TERSE,"SERVER",
 				      "about to send '%.80s'...",reply_message);
 #endif
-	retval = Command_Server_Write_Message(connection_handle, reply_message);
+	if(request_id != NULL)
+	{
+		framed_message = (char *)malloc(strlen(reply_message)+SERVER_REPLY_FRAME_LENGTH);
+		if(framed_message == NULL)
+		{
+			Liric_General_Error_Number = 206;
+			sprintf(Liric_General_Error_String,"Send_Reply:Failed to allocate framed reply of length %lu.",
+				(unsigned long)strlen(reply_message));
+			return FALSE;
+		}
+		sprintf(framed_message,"%u %lu %s",(*request_id),(unsigned long)strlen(reply_message),reply_message);
+		retval = Command_Server_Write_Message(connection_handle, framed_message);
+		free(framed_message);
+	}
+	else
+		retval = Command_Server_Write_Message(connection_handle, reply_message);
 	if(retval == FALSE)
 	{
 		Liric_General_Error_Number = 204;
@@ -683,3 +856,64 @@ static int Send_Reply(Command_Server_Handle_T connection_handle,char *reply_mess
 	return TRUE;
 }
 
+
+/**
+ * Send a reply built in a string builder back to the client. If the command being replied to was received in 
+ * a session, the reply is framed as in Send_Reply, but the framing is written into the builder's head room 
+ * in front of the reply, so the reply is not copied (or allocated) again before it is written to the connection.
+ * @param connection_handle The command server connection handle for this thread.
+ * @param request_id The address of the request id of the command being replied to, if it was received in a session,
+ *        or NULL to send the reply unframed.
+ * @param reply_string The string builder containing the reply. It must have been initialised with at least
+ *        SERVER_REPLY_FRAME_LENGTH bytes of head room.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Send_Reply
+ * @see #SERVER_REPLY_FRAME_LENGTH
+ * @see liric_general.html#Liric_General_Error_Number
+ * @see liric_general.html#Liric_General_Error_String
+ * @see liric_general.html#Liric_General_Log_Format
+ * @see liric_general.html#Liric_General_String_Builder_Get
+ * @see liric_general.html#Liric_General_String_Builder_Length_Get
+ * @see liric_general.html#Liric_General_String_Builder_Prefix
+ * @see ../command_server/cdocs/command_server.html#Command_Server_Write_Message
+ */
+static int Send_Reply_String_Builder(Command_Server_Handle_T connection_handle,unsigned int *request_id,
+				     struct Liric_General_String_Builder_Struct *reply_string)
+{
+	char frame_string[SERVER_REPLY_FRAME_LENGTH];
+	char *message = NULL;
+	int retval;
+
+#if LIRIC_DEBUG > 5
+	Liric_General_Log_Format("server","liric_server.c","Send_Reply_String_Builder",LOG_VERBOSITY_TERSE,"SERVER",
+				      "about to send '%.80s'...",Liric_General_String_Builder_Get(reply_string));
+#endif
+	if(request_id != NULL)
+	{
+		sprintf(frame_string,"%u %lu ",(*request_id),
+			(unsigned long)Liric_General_String_Builder_Length_Get(reply_string));
+		message = Liric_General_String_Builder_Prefix(reply_string,frame_string);
+		if(message == NULL)
+		{
+			Liric_General_Error_Number = 209;
+			sprintf(Liric_General_Error_String,"Send_Reply_String_Builder:"
+				"Not enough head room for reply framing '%s'.",frame_string);
+			return FALSE;
+		}
+	}
+	else
+		message = Liric_General_String_Builder_Get(reply_string);
+	retval = Command_Server_Write_Message(connection_handle,message);
+	if(retval == FALSE)
+	{
+		Liric_General_Error_Number = 210;
+		sprintf(Liric_General_Error_String,"Send_Reply_String_Builder:"
+			"Writing message to connection failed.");
+		return FALSE;
+	}
+#if LIRIC_DEBUG > 5
+	Liric_General_Log_Format("server","liric_server.c","Send_Reply_String_Builder",LOG_VERBOSITY_TERSE,"SERVER",
+				      "sent '%.80s'...",Liric_General_String_Builder_Get(reply_string));
+#endif
+	return TRUE;
+}
@@ -0,0 +1,434 @@
+/* liric_shm.c
+** Liric shared memory publication routines
+*/
+/**
+ * Shared memory publication routines for the liric program. The published instrument state (see liric_state),
+ * and the mean image and metadata of the last few frames saved, are copied into a POSIX shared memory region,
+ * so local tools (quick-look, guiding experiments, status proxies) can read them directly with the
+ * liric_shm_reader library, without sending commands to the command server or re-reading FITS images.
+ * The region starts with a Liric_Shm_Header_Struct, followed by a ring of frame slots. The state and each
+ * frame slot are protected by their own sequence lock, so readers never block the writer, and retry (or
+ * discard a frame) if the writer changed it whilst they were reading it.
+ * @author Chris Mottram
+ * @version $Revision$
+ */
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_SOURCE 1
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_C_SOURCE 199309L
+/**
+ * Define this to enable ftruncate in 'unistd.h'.
+ */
+#define _DEFAULT_SOURCE 1
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "log_udp.h"
+
+#include "detector_buffer.h"
+#include "detector_exposure.h"
+#include "detector_fits_filename.h"
+
+#include "liric_general.h"
+#include "liric_shm.h"
+#include "liric_state.h"
+
+/* hash defines */
+/**
+ * Macro to round a length (in bytes) up to the next multiple of LIRIC_SHM_ALIGNMENT.
+ * @see liric_shm.html#LIRIC_SHM_ALIGNMENT
+ */
+#define SHM_ALIGN(length)	((((length)+LIRIC_SHM_ALIGNMENT-1)/LIRIC_SHM_ALIGNMENT)*LIRIC_SHM_ALIGNMENT)
+
+/* data types */
+/**
+ * Data type holding local data to liric_shm:
+ * <dl>
+ * <dt>Mutex</dt> <dd>Mutex held whilst a frame or the state is being published, so only one thread writes a frame
+ *     slot at once, and whilst Liric_Shm_Shutdown clears Header, so the region is not unmapped whilst it is
+ *     being written.</dd>
+ * <dt>Name</dt> <dd>The POSIX shared memory object name.</dd>
+ * <dt>Region</dt> <dd>The mapped shared memory region, or NULL if it has not been created.</dd>
+ * <dt>Region_Length</dt> <dd>The length of the mapped region, in bytes.</dd>
+ * <dt>Header</dt> <dd>The header at the start of the region.</dd>
+ * </dl>
+ * @see liric_shm.html#Liric_Shm_Header_Struct
+ */
+struct Shm_Struct
+{
+	pthread_mutex_t Mutex;
+	char Name[256];
+	void *Region;
+	size_t Region_Length;
+	struct Liric_Shm_Header_Struct *Header;
+};
+
+/* internal data */
+/**
+ * Revision Control System identifier.
+ */
+static char rcsid[] = "$Id$";
+/**
+ * The instance of Shm_Struct that contains local data for this module. This is initialised as follows:
+ * <dl>
+ * <dt>Mutex</dt> <dd>PTHREAD_MUTEX_INITIALIZER</dd>
+ * <dt>Name</dt> <dd>""</dd>
+ * <dt>Region</dt> <dd>NULL</dd>
+ * <dt>Region_Length</dt> <dd>0</dd>
+ * <dt>Header</dt> <dd>NULL</dd>
+ * </dl>
+ */
+static struct Shm_Struct Shm_Data =
+{
+	PTHREAD_MUTEX_INITIALIZER,"",NULL,0,NULL
+};
+
+/* internal functions */
+static struct Liric_Shm_Frame_Struct *Shm_Frame_Slot_Get(uint64_t frame_number);
+
+/* ----------------------------------------------------------------------------
+** 		external functions
+** ---------------------------------------------------------------------------- */
+/**
+ * Create the shared memory region and start publishing into it.
+ * <ul>
+ * <li>We check the parameters, and that the region has not already been created.
+ * <li>We remove any region with the same name left over from a previous liric process, using shm_unlink.
+ * <li>We create the shared memory object with shm_open, size it with ftruncate and map it with mmap.
+ * <li>We fill in the header. The magic string is written last, after a memory barrier, so readers only
+ *     attach to a complete header.
+ * </ul>
+ * The caller should then call Liric_State_Publish, so the current state is copied into the region.
+ * @param name The POSIX shared memory object name, e.g. "/liric".
+ * @param frame_slot_count The number of frame slots in the ring, between 1 and LIRIC_SHM_MAX_FRAME_SLOT_COUNT.
+ * @param max_pixel_count The maximum number of pixels in a frame. This can be 0 (e.g. if the detector is not
+ *        enabled), in which case no frames are published.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Shm_Data
+ * @see #SHM_ALIGN
+ * @see liric_shm.html#LIRIC_SHM_MAGIC
+ * @see liric_shm.html#LIRIC_SHM_VERSION
+ * @see liric_shm.html#LIRIC_SHM_MAX_FRAME_SLOT_COUNT
+ * @see liric_state.html#Liric_State_Publish
+ * @see liric_general.html#Liric_General_Error_Number
+ * @see liric_general.html#Liric_General_Error_String
+ * @see liric_general.html#Liric_General_Log_Format
+ */
+int Liric_Shm_Initialise(char *name,int frame_slot_count,int max_pixel_count)
+{
+	struct Liric_Shm_Header_Struct *header = NULL;
+	size_t frame_slot_offset,frame_data_offset,frame_slot_length,region_length;
+	int fd;
+
+	if(name == NULL)
+	{
+		Liric_General_Error_Number = 1000;
+		sprintf(Liric_General_Error_String,"Liric_Shm_Initialise:name was NULL.");
+		return FALSE;
+	}
+	if(strlen(name) >= sizeof(Shm_Data.Name))
+	{
+		Liric_General_Error_Number = 1001;
+		sprintf(Liric_General_Error_String,"Liric_Shm_Initialise:name '%s' was too long (%lu vs %lu).",
+			name,strlen(name),sizeof(Shm_Data.Name));
+		return FALSE;
+	}
+	if((frame_slot_count < 1)||(frame_slot_count > LIRIC_SHM_MAX_FRAME_SLOT_COUNT))
+	{
+		Liric_General_Error_Number = 1002;
+		sprintf(Liric_General_Error_String,"Liric_Shm_Initialise:Illegal frame slot count %d (1..%d).",
+			frame_slot_count,LIRIC_SHM_MAX_FRAME_SLOT_COUNT);
+		return FALSE;
+	}
+	if(max_pixel_count < 0)
+	{
+		Liric_General_Error_Number = 1003;
+		sprintf(Liric_General_Error_String,"Liric_Shm_Initialise:Illegal maximum pixel count %d.",
+			max_pixel_count);
+		return FALSE;
+	}
+	if(Shm_Data.Region != NULL)
+	{
+		Liric_General_Error_Number = 1004;
+		sprintf(Liric_General_Error_String,"Liric_Shm_Initialise:Shared memory region '%s' already created.",
+			Shm_Data.Name);
+		return FALSE;
+	}
+	/* work out the layout of the region */
+	frame_slot_offset = SHM_ALIGN(sizeof(struct Liric_Shm_Header_Struct));
+	frame_data_offset = SHM_ALIGN(sizeof(struct Liric_Shm_Frame_Struct));
+	frame_slot_length = frame_data_offset+SHM_ALIGN(((size_t)max_pixel_count)*sizeof(double));
+	region_length = frame_slot_offset+(((size_t)frame_slot_count)*frame_slot_length);
+#if LIRIC_DEBUG > 1
+	Liric_General_Log_Format("shm","liric_shm.c","Liric_Shm_Initialise",LOG_VERBOSITY_TERSE,"SHM",
+				 "Creating shared memory region '%s' with %d frame slots of %d pixels (%lu bytes).",
+				 name,frame_slot_count,max_pixel_count,region_length);
+#endif
+	/* remove any region left over by a previous liric process. Readers still attached to it keep their mapping */
+	shm_unlink(name);
+	fd = shm_open(name,O_RDWR|O_CREAT|O_EXCL,S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH);
+	if(fd < 0)
+	{
+		Liric_General_Error_Number = 1005;
+		sprintf(Liric_General_Error_String,"Liric_Shm_Initialise:shm_open('%s') failed (%d:%s).",name,errno,
+			strerror(errno));
+		return FALSE;
+	}
+	if(ftruncate(fd,region_length) != 0)
+	{
+		Liric_General_Error_Number = 1006;
+		sprintf(Liric_General_Error_String,"Liric_Shm_Initialise:ftruncate('%s',%lu) failed (%d:%s).",name,
+			region_length,errno,strerror(errno));
+		close(fd);
+		shm_unlink(name);
+		return FALSE;
+	}
+	Shm_Data.Region = mmap(NULL,region_length,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+	/* the mapping stays valid after the file descriptor is closed */
+	close(fd);
+	if(Shm_Data.Region == MAP_FAILED)
+	{
+		Shm_Data.Region = NULL;
+		Liric_General_Error_Number = 1007;
+		sprintf(Liric_General_Error_String,"Liric_Shm_Initialise:mmap('%s',%lu) failed (%d:%s).",name,
+			region_length,errno,strerror(errno));
+		shm_unlink(name);
+		return FALSE;
+	}
+	strcpy(Shm_Data.Name,name);
+	Shm_Data.Region_Length = region_length;
+	/* fill in the header. ftruncate zero fills the region, so every slot starts unused (Frame_Number 0) */
+	header = (struct Liric_Shm_Header_Struct *)Shm_Data.Region;
+	header->Version = LIRIC_SHM_VERSION;
+	header->Writer_Pid = getpid();
+	header->Frame_Slot_Count = frame_slot_count;
+	header->Frame_Max_Pixel_Count = max_pixel_count;
+	header->Region_Length = region_length;
+	header->Frame_Slot_Offset = frame_slot_offset;
+	header->Frame_Slot_Length = frame_slot_length;
+	header->Frame_Data_Offset = frame_data_offset;
+	header->Frame_Number = 0;
+	header->State_Sequence = 0;
+	__sync_synchronize();
+	memcpy(header->Magic,LIRIC_SHM_MAGIC,LIRIC_SHM_MAGIC_LENGTH);
+	__sync_synchronize();
+	pthread_mutex_lock(&(Shm_Data.Mutex));
+	Shm_Data.Header = header;
+	pthread_mutex_unlock(&(Shm_Data.Mutex));
+#if LIRIC_DEBUG > 1
+	Liric_General_Log_Format("shm","liric_shm.c","Liric_Shm_Initialise",LOG_VERBOSITY_TERSE,"SHM",
+				 "Shared memory region '%s' created.",name);
+#endif
+	return TRUE;
+}
+
+/**
+ * Stop publishing, unmap the shared memory region and remove it's name. Readers still attached to it keep their
+ * mapping until they close it. Does nothing if the region was not created. Header is cleared with the mutex held
+ * before the region is unmapped, so a frame or state publication in progress finishes first, and any later one
+ * does nothing.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Shm_Data
+ * @see liric_general.html#Liric_General_Error_Number
+ * @see liric_general.html#Liric_General_Error_String
+ */
+int Liric_Shm_Shutdown(void)
+{
+	void *region = NULL;
+
+	/* stop publishing before unmapping the region */
+	pthread_mutex_lock(&(Shm_Data.Mutex));
+	if(Shm_Data.Region == NULL)
+	{
+		pthread_mutex_unlock(&(Shm_Data.Mutex));
+		return TRUE;
+	}
+	Shm_Data.Header = NULL;
+	__sync_synchronize();
+	region = Shm_Data.Region;
+	Shm_Data.Region = NULL;
+	pthread_mutex_unlock(&(Shm_Data.Mutex));
+	if(munmap(region,Shm_Data.Region_Length) != 0)
+	{
+		Liric_General_Error_Number = 1008;
+		sprintf(Liric_General_Error_String,"Liric_Shm_Shutdown:munmap('%s') failed (%d:%s).",Shm_Data.Name,
+			errno,strerror(errno));
+		return FALSE;
+	}
+	if(shm_unlink(Shm_Data.Name) != 0)
+	{
+		Liric_General_Error_Number = 1009;
+		sprintf(Liric_General_Error_String,"Liric_Shm_Shutdown:shm_unlink('%s') failed (%d:%s).",
+			Shm_Data.Name,errno,strerror(errno));
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * Return whether we are publishing into a shared memory region.
+ * @return A boolean, TRUE if Liric_Shm_Initialise has created the region, FALSE otherwise.
+ * @see #Shm_Data
+ */
+int Liric_Shm_Is_Enabled(void)
+{
+	return (Shm_Data.Header != NULL);
+}
+
+/**
+ * Copy the published instrument state into the shared memory region. This is called by liric_state each
+ * time the state is published, with it's write mutex held. We hold the mutex whilst writing into the region,
+ * so Liric_Shm_Shutdown cannot unmap it underneath us. Does nothing if the region has not been created, or has
+ * been unmapped.
+ * @param state The state to copy.
+ * @see #Shm_Data
+ * @see liric_state.html#Liric_State_Struct
+ */
+void Liric_Shm_State_Publish(struct Liric_State_Struct *state)
+{
+	struct Liric_Shm_Header_Struct *header = NULL;
+
+	pthread_mutex_lock(&(Shm_Data.Mutex));
+	header = Shm_Data.Header;
+	if(header == NULL)
+	{
+		pthread_mutex_unlock(&(Shm_Data.Mutex));
+		return;
+	}
+	header->State_Sequence++;
+	__sync_synchronize();
+	memcpy(&(header->State),state,sizeof(struct Liric_State_Struct));
+	__sync_synchronize();
+	header->State_Sequence++;
+	pthread_mutex_unlock(&(Shm_Data.Mutex));
+}
+
+/**
+ * Publish the frame just saved into the next frame slot in the ring. This should be called by the thread that
+ * took the exposure, straight after Detector_Exposure_Expose/Detector_Exposure_Bias has saved it, whilst the
+ * detector library's mean image and statistics are still those of the frame. Does nothing if the region has
+ * not been created.
+ * <ul>
+ * <li>We lock the frame mutex and get the frame size. If it is larger than the slots, we log and return success.
+ * <li>We make the slot's sequence number odd, and copy the mean image and it's metadata into the slot.
+ * <li>We make the slot's sequence number even again, and then update the header's Frame_Number.
+ * </ul>
+ * @param fits_filename The FITS image filename the frame was saved to.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Shm_Data
+ * @see #Shm_Frame_Slot_Get
+ * @see ../detector/cdocs/detector_buffer.html#Detector_Buffer_Get_Mean_Image
+ * @see ../detector/cdocs/detector_buffer.html#Detector_Buffer_Statistics_Get
+ * @see ../detector/cdocs/detector_exposure.html#Detector_Exposure_Exposure_Length_Get
+ * @see ../detector/cdocs/detector_exposure.html#Detector_Exposure_Start_Time_Get
+ * @see ../detector/cdocs/detector_fits_filename.html#Detector_Fits_Filename_Multrun_Get
+ * @see liric_general.html#Liric_General_Error_Number
+ * @see liric_general.html#Liric_General_Error_String
+ * @see liric_general.html#Liric_General_Log_Format
+ */
+int Liric_Shm_Frame_Publish(char *fits_filename)
+{
+	struct Liric_Shm_Frame_Struct *frame = NULL;
+	double *mean_image = NULL;
+	uint64_t frame_number;
+	int size_x,size_y;
+
+	if(fits_filename == NULL)
+	{
+		Liric_General_Error_Number = 1010;
+		sprintf(Liric_General_Error_String,"Liric_Shm_Frame_Publish:fits_filename was NULL.");
+		return FALSE;
+	}
+	pthread_mutex_lock(&(Shm_Data.Mutex));
+	if(Shm_Data.Header == NULL)
+	{
+		pthread_mutex_unlock(&(Shm_Data.Mutex));
+		return TRUE;
+	}
+	size_x = Detector_Buffer_Get_Size_X();
+	size_y = Detector_Buffer_Get_Size_Y();
+	mean_image = Detector_Buffer_Get_Mean_Image();
+	if(mean_image == NULL)
+	{
+		pthread_mutex_unlock(&(Shm_Data.Mutex));
+		Liric_General_Error_Number = 1011;
+		sprintf(Liric_General_Error_String,"Liric_Shm_Frame_Publish:Detector mean image was NULL.");
+		return FALSE;
+	}
+	if(((size_t)size_x*(size_t)size_y) > Shm_Data.Header->Frame_Max_Pixel_Count)
+	{
+		pthread_mutex_unlock(&(Shm_Data.Mutex));
+#if LIRIC_DEBUG > 1
+		Liric_General_Log_Format("shm","liric_shm.c","Liric_Shm_Frame_Publish",LOG_VERBOSITY_VERBOSE,"SHM",
+					 "Frame '%s' (%d x %d) too large for shared memory frame slots (%u pixels).",
+					 fits_filename,size_x,size_y,Shm_Data.Header->Frame_Max_Pixel_Count);
+#endif
+		return TRUE;
+	}
+	frame_number = Shm_Data.Header->Frame_Number+1;
+	frame = Shm_Frame_Slot_Get(frame_number);
+	frame->Sequence++;
+	__sync_synchronize();
+	frame->Frame_Number = frame_number;
+	frame->Size_X = size_x;
+	frame->Size_Y = size_y;
+	frame->Exposure_Length_Ms = Detector_Exposure_Exposure_Length_Get();
+	frame->Coadd_Count = Detector_Exposure_Coadd_Count_Get();
+	frame->Multrun_Number = Detector_Fits_Filename_Multrun_Get();
+	frame->Run_Number = Detector_Fits_Filename_Run_Get();
+	frame->Exposure_Start_Time = Detector_Exposure_Start_Time_Get();
+	clock_gettime(CLOCK_REALTIME,&(frame->Publish_Time));
+	if(!Detector_Buffer_Statistics_Get(&(frame->Minimum),&(frame->Maximum),&(frame->Mean),&(frame->Median),
+					   &(frame->Saturated_Count)))
+	{
+		frame->Minimum = 0.0;
+		frame->Maximum = 0.0;
+		frame->Mean = 0.0;
+		frame->Median = 0.0;
+		frame->Saturated_Count = 0;
+	}
+	strncpy(frame->Filename,fits_filename,LIRIC_SHM_FILENAME_LENGTH-1);
+	frame->Filename[LIRIC_SHM_FILENAME_LENGTH-1] = '\0';
+	memcpy(((char *)frame)+Shm_Data.Header->Frame_Data_Offset,mean_image,
+	       ((size_t)size_x)*((size_t)size_y)*sizeof(double));
+	__sync_synchronize();
+	frame->Sequence++;
+	__sync_synchronize();
+	Shm_Data.Header->Frame_Number = frame_number;
+	pthread_mutex_unlock(&(Shm_Data.Mutex));
+#if LIRIC_DEBUG > 5
+	Liric_General_Log_Format("shm","liric_shm.c","Liric_Shm_Frame_Publish",LOG_VERBOSITY_VERY_VERBOSE,"SHM",
+				 "Published frame %llu '%s'.",(unsigned long long)frame_number,fits_filename);
+#endif
+	return TRUE;
+}
+
+/* ----------------------------------------------------------------------------
+** 		internal functions
+** ---------------------------------------------------------------------------- */
+/**
+ * Get the address of the frame slot a frame number is published into.
+ * @param frame_number The frame number, from 1.
+ * @return The address of the frame slot header.
+ * @see #Shm_Data
+ */
+static struct Liric_Shm_Frame_Struct *Shm_Frame_Slot_Get(uint64_t frame_number)
+{
+	struct Liric_Shm_Header_Struct *header = Shm_Data.Header;
+
+	return (struct Liric_Shm_Frame_Struct *)(((char *)Shm_Data.Region)+header->Frame_Slot_Offset+
+						 (((frame_number-1)%header->Frame_Slot_Count)*
+						  header->Frame_Slot_Length));
+}
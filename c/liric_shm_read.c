@@ -0,0 +1,326 @@
+/* liric_shm_read.c */
+/**
+ * Example liric shared memory reader. This attaches to the shared memory region published by a running liric
+ * process (using the liric_shm_reader library), and prints the instrument state and each new frame published
+ * (it's metadata, and the mean of the centre of the frame, computed directly from the shared pixel data),
+ * without sending any commands to the liric command server.
+ * @author $Author$
+ */
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_C_SOURCE 199309L
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "liric_shm.h"
+#include "liric_shm_reader.h"
+#include "liric_state.h"
+
+/* hash defines */
+#ifndef TRUE
+/**
+ * Boolean TRUE.
+ */
+#define TRUE 1
+#endif
+#ifndef FALSE
+/**
+ * Boolean FALSE.
+ */
+#define FALSE 0
+#endif
+/**
+ * The size of the box, in pixels, at the centre of each frame that we compute the mean of.
+ */
+#define CENTRE_BOX_SIZE			(32)
+
+/* internal variables */
+/**
+ * Revision control system identifier.
+ */
+static char rcsid[] = "$Id$";
+/**
+ * The POSIX shared memory object name to attach to.
+ */
+static char *Shm_Name = LIRIC_SHM_DEFAULT_NAME;
+/**
+ * How often to poll the region for a new state or frame, in milliseconds.
+ */
+static int Poll_Period_Ms = 100;
+/**
+ * The number of frames to print before exiting, or 0 to only print the current state and last frame.
+ */
+static int Frame_Count = 0;
+
+/* internal routines */
+static void State_Print(struct Liric_State_Struct *state);
+static int Frame_Print(struct Liric_Shm_Reader_Struct *reader,uint64_t frame_number);
+static int Parse_Arguments(int argc, char *argv[]);
+static void Help(void);
+
+/* ------------------------------------------------------------------
+** External functions
+** ------------------------------------------------------------------ */
+/**
+ * Main program.
+ * <ul>
+ * <li>We parse the command line arguments using Parse_Arguments.
+ * <li>We attach to the shared memory region using Liric_Shm_Reader_Open.
+ * <li>We print the current state (Liric_Shm_Reader_State_Get / State_Print) and the last frame (Frame_Print).
+ * <li>If Frame_Count is non-zero, we poll the region every Poll_Period_Ms milliseconds, printing the state
+ *     whenever it's version changes, and each new frame, until Frame_Count frames have been printed.
+ * <li>We detach from the region using Liric_Shm_Reader_Close.
+ * </ul>
+ * @param argc The number of arguments to the program.
+ * @param argv An array of argument strings.
+ * @return This function returns 0 if the program succeeds, and a positive integer if it fails.
+ * @see #Parse_Arguments
+ * @see #State_Print
+ * @see #Frame_Print
+ * @see #Shm_Name
+ * @see #Poll_Period_Ms
+ * @see #Frame_Count
+ * @see liric_shm_reader.html#Liric_Shm_Reader_Open
+ * @see liric_shm_reader.html#Liric_Shm_Reader_State_Get
+ * @see liric_shm_reader.html#Liric_Shm_Reader_Frame_Number_Get
+ * @see liric_shm_reader.html#Liric_Shm_Reader_Close
+ */
+int main(int argc, char *argv[])
+{
+	struct Liric_Shm_Reader_Struct reader;
+	struct Liric_State_Struct state;
+	struct timespec sleep_time;
+	uint64_t last_frame_number,frame_number;
+	unsigned int last_version;
+	int printed_count;
+
+	if(!Parse_Arguments(argc,argv))
+		return 1;
+	if(!Liric_Shm_Reader_Open(Shm_Name,&reader))
+	{
+		Liric_Shm_Reader_Error();
+		return 2;
+	}
+	if(!Liric_Shm_Reader_State_Get(&reader,&state))
+	{
+		Liric_Shm_Reader_Error();
+		Liric_Shm_Reader_Close(&reader);
+		return 3;
+	}
+	fprintf(stdout,"Attached to '%s' (writer pid %d, %u frame slots of %u pixels).\n",Shm_Name,
+		reader.Header->Writer_Pid,reader.Header->Frame_Slot_Count,reader.Header->Frame_Max_Pixel_Count);
+	State_Print(&state);
+	last_version = state.Version;
+	last_frame_number = Liric_Shm_Reader_Frame_Number_Get(&reader);
+	if(last_frame_number > 0)
+		Frame_Print(&reader,last_frame_number);
+	printed_count = 0;
+	sleep_time.tv_sec = Poll_Period_Ms/1000;
+	sleep_time.tv_nsec = (Poll_Period_Ms%1000)*1000000;
+	while(printed_count < Frame_Count)
+	{
+		nanosleep(&sleep_time,NULL);
+		if(Liric_Shm_Reader_State_Get(&reader,&state)&&(state.Version != last_version))
+		{
+			State_Print(&state);
+			last_version = state.Version;
+		}
+		frame_number = Liric_Shm_Reader_Frame_Number_Get(&reader);
+		/* if we fell behind, skip to the oldest frame still in the ring */
+		if((frame_number > reader.Header->Frame_Slot_Count)&&
+		   (last_frame_number < frame_number-reader.Header->Frame_Slot_Count))
+		{
+			fprintf(stdout,"Missed frames %llu to %llu.\n",(unsigned long long)(last_frame_number+1),
+				(unsigned long long)(frame_number-reader.Header->Frame_Slot_Count));
+			last_frame_number = frame_number-reader.Header->Frame_Slot_Count;
+		}
+		while((last_frame_number < frame_number)&&(printed_count < Frame_Count))
+		{
+			last_frame_number++;
+			Frame_Print(&reader,last_frame_number);
+			printed_count++;
+		}
+	}
+	Liric_Shm_Reader_Close(&reader);
+	return 0;
+}
+
+/* ------------------------------------------------------------------
+** Internal functions
+** ------------------------------------------------------------------ */
+/**
+ * Print the instrument state.
+ * @param state The state to print.
+ * @see liric_state.html#Liric_State_Struct
+ */
+static void State_Print(struct Liric_State_Struct *state)
+{
+	fprintf(stdout,"State version %u:sequence %s (%d of %d):exposure %s (%d ms, %d coadds):"
+		"multrun %d run %d.\n",state->Version,state->Sequence_In_Progress ? "in progress" : "idle",
+		state->Sequence_Index+1,state->Sequence_Count,state->Exposure_In_Progress ? "in progress" : "idle",
+		state->Exposure_Length_Ms,state->Coadd_Count,state->Multrun_Number,state->Run_Number);
+	fprintf(stdout,"\tFilter wheel %d%s:nudgematic %d%s:temperature %.2f C%s.\n",state->Filter_Wheel_Position,
+		state->Filter_Wheel_Valid ? "" : " (unknown)",state->Nudgematic_Position,
+		state->Nudgematic_Valid ? "" : " (unknown)",state->Temperature_C,
+		state->Temperature_Valid ? "" : " (unknown)");
+}
+
+/**
+ * Print a frame's metadata, and the mean of the CENTRE_BOX_SIZE square box at the centre of the frame, computed
+ * directly from the pixel data in the shared memory region. If the frame's slot was re-used whilst we were
+ * reading it, we say so rather than printing what we read.
+ * @param reader The reader attached to the region.
+ * @param frame_number The frame number to print.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #CENTRE_BOX_SIZE
+ * @see liric_shm_reader.html#Liric_Shm_Reader_Frame_Get
+ * @see liric_shm_reader.html#Liric_Shm_Reader_Frame_Is_Valid
+ */
+static int Frame_Print(struct Liric_Shm_Reader_Struct *reader,uint64_t frame_number)
+{
+	struct Liric_Shm_Frame_Struct *frame = NULL;
+	char filename[LIRIC_SHM_FILENAME_LENGTH];
+	double *data = NULL;
+	double centre_total,centre_mean,mean;
+	uint32_t sequence;
+	int x,y,start_x,start_y,end_x,end_y,size_x,size_y,exposure_length;
+
+	if(!Liric_Shm_Reader_Frame_Get(reader,frame_number,&frame,&data,&sequence))
+	{
+		Liric_Shm_Reader_Error();
+		return FALSE;
+	}
+	size_x = frame->Size_X;
+	size_y = frame->Size_Y;
+	exposure_length = frame->Exposure_Length_Ms;
+	mean = frame->Mean;
+	strncpy(filename,frame->Filename,LIRIC_SHM_FILENAME_LENGTH-1);
+	filename[LIRIC_SHM_FILENAME_LENGTH-1] = '\0';
+	start_x = (size_x-CENTRE_BOX_SIZE)/2;
+	if(start_x < 0)
+		start_x = 0;
+	end_x = start_x+CENTRE_BOX_SIZE;
+	if(end_x > size_x)
+		end_x = size_x;
+	start_y = (size_y-CENTRE_BOX_SIZE)/2;
+	if(start_y < 0)
+		start_y = 0;
+	end_y = start_y+CENTRE_BOX_SIZE;
+	if(end_y > size_y)
+		end_y = size_y;
+	centre_total = 0.0;
+	for(y = start_y; y < end_y; y++)
+	{
+		for(x = start_x; x < end_x; x++)
+			centre_total += data[(y*size_x)+x];
+	}
+	if((end_x > start_x)&&(end_y > start_y))
+		centre_mean = centre_total/((double)((end_x-start_x)*(end_y-start_y)));
+	else
+		centre_mean = 0.0;
+	if(!Liric_Shm_Reader_Frame_Is_Valid(frame,sequence))
+	{
+		fprintf(stdout,"Frame %llu was overwritten whilst it was being read.\n",(unsigned long long)frame_number);
+		return FALSE;
+	}
+	fprintf(stdout,"Frame %llu:%s:%d x %d:%d ms:mean %.2f:centre mean %.2f.\n",(unsigned long long)frame_number,
+		filename,size_x,size_y,exposure_length,mean,centre_mean);
+	return TRUE;
+}
+
+/**
+ * Routine to parse command line arguments.
+ * @param argc The number of arguments sent to the program.
+ * @param argv An array of argument strings.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Help
+ * @see #Shm_Name
+ * @see #Poll_Period_Ms
+ * @see #Frame_Count
+ */
+static int Parse_Arguments(int argc, char *argv[])
+{
+	int i,retval;
+
+	for(i=1;i<argc;i++)
+	{
+		if((strcmp(argv[i],"-frame_count")==0)||(strcmp(argv[i],"-f")==0))
+		{
+			if((i+1)<argc)
+			{
+				retval = sscanf(argv[i+1],"%d",&Frame_Count);
+				if(retval != 1)
+				{
+					fprintf(stderr,"Parse_Arguments:Failed to parse frame count %s.\n",argv[i+1]);
+					return FALSE;
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:frame count requires a number.\n");
+				return FALSE;
+			}
+		}
+		else if((strcmp(argv[i],"-help")==0)||(strcmp(argv[i],"-h")==0))
+		{
+			Help();
+			exit(0);
+		}
+		else if((strcmp(argv[i],"-name")==0)||(strcmp(argv[i],"-n")==0))
+		{
+			if((i+1)<argc)
+			{
+				Shm_Name = argv[i+1];
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:name requires a shared memory object name.\n");
+				return FALSE;
+			}
+		}
+		else if((strcmp(argv[i],"-poll_period")==0)||(strcmp(argv[i],"-p")==0))
+		{
+			if((i+1)<argc)
+			{
+				retval = sscanf(argv[i+1],"%d",&Poll_Period_Ms);
+				if((retval != 1)||(Poll_Period_Ms < 1))
+				{
+					fprintf(stderr,"Parse_Arguments:Failed to parse poll period %s.\n",argv[i+1]);
+					return FALSE;
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:poll period requires a number.\n");
+				return FALSE;
+			}
+		}
+		else
+		{
+			fprintf(stderr,"Parse_Arguments:argument '%s' not recognized.\n",argv[i]);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/**
+ * Help routine.
+ */
+static void Help(void)
+{
+	fprintf(stdout,"Liric Shared Memory Reader:Help.\n");
+	fprintf(stdout,"liric_shm_read [-n[ame] <shared memory name>][-f[rame_count] <n>][-p[oll_period] <ms>]"
+		"[-h[elp]]\n");
+	fprintf(stdout,"\t-name is the POSIX shared memory object name (default %s).\n",LIRIC_SHM_DEFAULT_NAME);
+	fprintf(stdout,"\t-frame_count prints the next <n> frames published, otherwise we print the current state\n");
+	fprintf(stdout,"\t\tand last frame and exit.\n");
+	fprintf(stdout,"\t-poll_period is how often to check for a new state/frame, in milliseconds (default 100).\n");
+}
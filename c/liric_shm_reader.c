@@ -0,0 +1,413 @@
+/* liric_shm_reader.c
+** Liric shared memory reader library
+*/
+/**
+ * Reader library for the liric shared memory region (see liric_shm). Local tools link against this to attach
+ * to the region published by the liric process, read the instrument state, and read the mean image of the last
+ * few frames saved, without sending commands to the command server. The region is mapped read only, and
+ * frames are returned as pointers into it (no copy is made), so once the caller has finished with a frame it
+ * should call Liric_Shm_Reader_Frame_Is_Valid to check the writer did not re-use the frame slot whilst it was
+ * being read. This library does not use the rest of the liric C layer, and reports errors in the same way as the
+ * detector library.
+ * @author Chris Mottram
+ * @version $Revision$
+ */
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_SOURCE 1
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_C_SOURCE 199309L
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "liric_shm.h"
+#include "liric_shm_reader.h"
+#include "liric_state.h"
+
+/* hash defines */
+#ifndef TRUE
+/**
+ * Boolean TRUE.
+ */
+#define TRUE 1
+#endif
+#ifndef FALSE
+/**
+ * Boolean FALSE.
+ */
+#define FALSE 0
+#endif
+/**
+ * The number of times Liric_Shm_Reader_State_Get tries to get a consistent copy of the state, before
+ * assuming the writer has died part way through publishing it.
+ */
+#define READER_STATE_RETRY_COUNT	(10000)
+
+/* internal data */
+/**
+ * Revision Control System identifier.
+ */
+static char rcsid[] = "$Id$";
+/**
+ * Variable holding error code of last operation performed.
+ */
+static int Reader_Error_Number = 0;
+/**
+ * Local variable holding description of the last error that occured.
+ */
+static char Reader_Error_String[1024] = "";
+
+/* internal functions */
+static void Reader_Current_Time_String(char *time_string,int string_length);
+
+/* ----------------------------------------------------------------------------
+** 		external functions
+** ---------------------------------------------------------------------------- */
+/**
+ * Attach to the liric shared memory region.
+ * <ul>
+ * <li>We open the shared memory object read only with shm_open, and get it's length with fstat.
+ * <li>We map the region read only with mmap, and close the file descriptor.
+ * <li>We check the region's magic string and layout version.
+ * </ul>
+ * @param name The POSIX shared memory object name, e.g. LIRIC_SHM_DEFAULT_NAME ("/liric").
+ * @param reader The address of a reader structure, on success filled in with the connection to the region.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Reader_Error_Number
+ * @see #Reader_Error_String
+ * @see liric_shm.html#LIRIC_SHM_MAGIC
+ * @see liric_shm.html#LIRIC_SHM_VERSION
+ */
+int Liric_Shm_Reader_Open(char *name,struct Liric_Shm_Reader_Struct *reader)
+{
+	struct Liric_Shm_Header_Struct *header = NULL;
+	struct stat stat_buffer;
+	void *region = NULL;
+	int fd;
+
+	Reader_Error_Number = 0;
+	if((name == NULL)||(reader == NULL))
+	{
+		Reader_Error_Number = 1;
+		sprintf(Reader_Error_String,"Liric_Shm_Reader_Open:A parameter was NULL.");
+		return FALSE;
+	}
+	reader->Region = NULL;
+	reader->Region_Length = 0;
+	reader->Header = NULL;
+	fd = shm_open(name,O_RDONLY,0);
+	if(fd < 0)
+	{
+		Reader_Error_Number = 2;
+		sprintf(Reader_Error_String,"Liric_Shm_Reader_Open:shm_open('%s') failed (%d:%s).",name,errno,
+			strerror(errno));
+		return FALSE;
+	}
+	if(fstat(fd,&stat_buffer) != 0)
+	{
+		Reader_Error_Number = 3;
+		sprintf(Reader_Error_String,"Liric_Shm_Reader_Open:fstat('%s') failed (%d:%s).",name,errno,
+			strerror(errno));
+		close(fd);
+		return FALSE;
+	}
+	if(stat_buffer.st_size < (off_t)sizeof(struct Liric_Shm_Header_Struct))
+	{
+		Reader_Error_Number = 4;
+		sprintf(Reader_Error_String,"Liric_Shm_Reader_Open:'%s' is too short (%ld bytes).",name,
+			(long)stat_buffer.st_size);
+		close(fd);
+		return FALSE;
+	}
+	region = mmap(NULL,stat_buffer.st_size,PROT_READ,MAP_SHARED,fd,0);
+	close(fd);
+	if(region == MAP_FAILED)
+	{
+		Reader_Error_Number = 5;
+		sprintf(Reader_Error_String,"Liric_Shm_Reader_Open:mmap('%s') failed (%d:%s).",name,errno,
+			strerror(errno));
+		return FALSE;
+	}
+	header = (struct Liric_Shm_Header_Struct *)region;
+	/* the writer fills in the magic string last */
+	if(memcmp(header->Magic,LIRIC_SHM_MAGIC,LIRIC_SHM_MAGIC_LENGTH) != 0)
+	{
+		munmap(region,stat_buffer.st_size);
+		Reader_Error_Number = 6;
+		sprintf(Reader_Error_String,"Liric_Shm_Reader_Open:'%s' is not a (complete) liric shared memory region.",
+			name);
+		return FALSE;
+	}
+	__sync_synchronize();
+	if((header->Version != LIRIC_SHM_VERSION)||(header->Region_Length != (uint64_t)stat_buffer.st_size))
+	{
+		Reader_Error_Number = 7;
+		sprintf(Reader_Error_String,"Liric_Shm_Reader_Open:'%s' has version %u and length %llu, "
+			"expected version %d and length %ld.",name,header->Version,
+			(unsigned long long)header->Region_Length,LIRIC_SHM_VERSION,(long)stat_buffer.st_size);
+		munmap(region,stat_buffer.st_size);
+		return FALSE;
+	}
+	reader->Region = region;
+	reader->Region_Length = stat_buffer.st_size;
+	reader->Header = header;
+	return TRUE;
+}
+
+/**
+ * Detach from the liric shared memory region. Any frame pointers returned by Liric_Shm_Reader_Frame_Get
+ * are no longer valid.
+ * @param reader The address of a reader structure opened with Liric_Shm_Reader_Open.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Reader_Error_Number
+ * @see #Reader_Error_String
+ */
+int Liric_Shm_Reader_Close(struct Liric_Shm_Reader_Struct *reader)
+{
+	Reader_Error_Number = 0;
+	if(reader == NULL)
+	{
+		Reader_Error_Number = 8;
+		sprintf(Reader_Error_String,"Liric_Shm_Reader_Close:reader was NULL.");
+		return FALSE;
+	}
+	if(reader->Region == NULL)
+		return TRUE;
+	if(munmap(reader->Region,reader->Region_Length) != 0)
+	{
+		Reader_Error_Number = 9;
+		sprintf(Reader_Error_String,"Liric_Shm_Reader_Close:munmap failed (%d:%s).",errno,strerror(errno));
+		return FALSE;
+	}
+	reader->Region = NULL;
+	reader->Region_Length = 0;
+	reader->Header = NULL;
+	return TRUE;
+}
+
+/**
+ * Get a consistent copy of the instrument state published in the region. If the writer is publishing whilst
+ * we are copying the state, we retry (up to READER_STATE_RETRY_COUNT times).
+ * @param reader The address of a reader structure opened with Liric_Shm_Reader_Open.
+ * @param state The address of a state structure, on success filled in with the copy.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #READER_STATE_RETRY_COUNT
+ * @see #Reader_Error_Number
+ * @see #Reader_Error_String
+ */
+int Liric_Shm_Reader_State_Get(struct Liric_Shm_Reader_Struct *reader,struct Liric_State_Struct *state)
+{
+	uint32_t start_sequence,end_sequence;
+	int retry_count;
+
+	Reader_Error_Number = 0;
+	if((reader == NULL)||(reader->Header == NULL)||(state == NULL))
+	{
+		Reader_Error_Number = 10;
+		sprintf(Reader_Error_String,"Liric_Shm_Reader_State_Get:A parameter was NULL (or the reader is not open).");
+		return FALSE;
+	}
+	for(retry_count = 0; retry_count < READER_STATE_RETRY_COUNT; retry_count++)
+	{
+		start_sequence = reader->Header->State_Sequence;
+		if(start_sequence & 1)
+		{
+			/* the writer is publishing, let it finish */
+			sched_yield();
+			continue;
+		}
+		__sync_synchronize();
+		memcpy(state,&(reader->Header->State),sizeof(struct Liric_State_Struct));
+		__sync_synchronize();
+		end_sequence = reader->Header->State_Sequence;
+		if(start_sequence == end_sequence)
+			return TRUE;
+	}
+	Reader_Error_Number = 11;
+	sprintf(Reader_Error_String,"Liric_Shm_Reader_State_Get:Failed to get a consistent state after %d attempts.",
+		READER_STATE_RETRY_COUNT);
+	return FALSE;
+}
+
+/**
+ * Get the number of the last frame published in the region. The last Frame_Slot_Count frames (in the header)
+ * up to this number can be retrieved with Liric_Shm_Reader_Frame_Get.
+ * @param reader The address of a reader structure opened with Liric_Shm_Reader_Open.
+ * @return The frame number, or 0 if no frames have been published (or the reader is not open).
+ */
+uint64_t Liric_Shm_Reader_Frame_Number_Get(struct Liric_Shm_Reader_Struct *reader)
+{
+	if((reader == NULL)||(reader->Header == NULL))
+		return 0;
+	return reader->Header->Frame_Number;
+}
+
+/**
+ * Get a frame from the ring, without copying it. The returned pointers point into the shared memory region.
+ * Once the caller has finished reading the frame, it should call Liric_Shm_Reader_Frame_Is_Valid with the
+ * returned sequence number: if that returns FALSE the writer re-used the slot whilst the frame was being read,
+ * and whatever was read should be discarded.
+ * @param reader The address of a reader structure opened with Liric_Shm_Reader_Open.
+ * @param frame_number The number of the frame to get, or 0 to get the last frame published.
+ * @param frame The address of a frame pointer, on success set to the frame slot's header.
+ * @param data The address of a double pointer, on success set to the frame's pixel data (frame->Size_X by
+ *        frame->Size_Y, row by row).
+ * @param sequence The address of an integer, on success set to the frame slot's sequence number, to pass to
+ *        Liric_Shm_Reader_Frame_Is_Valid.
+ * @return The routine returns TRUE on success and FALSE on failure (including if no frames have been published,
+ *         the frame has not been published yet, or it's slot has been re-used by a later frame).
+ * @see #Reader_Error_Number
+ * @see #Reader_Error_String
+ * @see #Liric_Shm_Reader_Frame_Is_Valid
+ */
+int Liric_Shm_Reader_Frame_Get(struct Liric_Shm_Reader_Struct *reader,uint64_t frame_number,
+			       struct Liric_Shm_Frame_Struct **frame,double **data,uint32_t *sequence)
+{
+	struct Liric_Shm_Header_Struct *header = NULL;
+	struct Liric_Shm_Frame_Struct *slot = NULL;
+	uint32_t slot_sequence;
+
+	Reader_Error_Number = 0;
+	if((reader == NULL)||(reader->Header == NULL)||(frame == NULL)||(data == NULL)||(sequence == NULL))
+	{
+		Reader_Error_Number = 12;
+		sprintf(Reader_Error_String,"Liric_Shm_Reader_Frame_Get:A parameter was NULL (or the reader is not open).");
+		return FALSE;
+	}
+	header = reader->Header;
+	if(frame_number == 0)
+		frame_number = header->Frame_Number;
+	if(frame_number == 0)
+	{
+		Reader_Error_Number = 13;
+		sprintf(Reader_Error_String,"Liric_Shm_Reader_Frame_Get:No frames have been published.");
+		return FALSE;
+	}
+	if(header->Frame_Slot_Count == 0)
+	{
+		Reader_Error_Number = 14;
+		sprintf(Reader_Error_String,"Liric_Shm_Reader_Frame_Get:Region has no frame slots.");
+		return FALSE;
+	}
+	slot = (struct Liric_Shm_Frame_Struct *)(((char *)reader->Region)+header->Frame_Slot_Offset+
+						 (((frame_number-1)%header->Frame_Slot_Count)*header->Frame_Slot_Length));
+	slot_sequence = slot->Sequence;
+	if(slot_sequence & 1)
+	{
+		Reader_Error_Number = 15;
+		sprintf(Reader_Error_String,"Liric_Shm_Reader_Frame_Get:Frame %llu's slot is being written.",
+			(unsigned long long)frame_number);
+		return FALSE;
+	}
+	__sync_synchronize();
+	if(slot->Frame_Number != frame_number)
+	{
+		Reader_Error_Number = 16;
+		sprintf(Reader_Error_String,"Liric_Shm_Reader_Frame_Get:Frame %llu is not in the ring "
+			"(it's slot holds frame %llu).",(unsigned long long)frame_number,
+			(unsigned long long)slot->Frame_Number);
+		return FALSE;
+	}
+	(*frame) = slot;
+	(*data) = (double *)(((char *)slot)+header->Frame_Data_Offset);
+	(*sequence) = slot_sequence;
+	return TRUE;
+}
+
+/**
+ * Check whether a frame returned by Liric_Shm_Reader_Frame_Get is still valid, i.e. the writer has not started
+ * re-using it's slot since it was returned.
+ * @param frame The frame slot header returned by Liric_Shm_Reader_Frame_Get.
+ * @param sequence The sequence number returned by Liric_Shm_Reader_Frame_Get.
+ * @return A boolean, TRUE if the frame (and everything read from it) is still valid, FALSE if it is not.
+ */
+int Liric_Shm_Reader_Frame_Is_Valid(struct Liric_Shm_Frame_Struct *frame,uint32_t sequence)
+{
+	if(frame == NULL)
+		return FALSE;
+	__sync_synchronize();
+	return (frame->Sequence == sequence);
+}
+
+/**
+ * Get the current value of the error number.
+ * @return The current value of the error number.
+ * @see #Reader_Error_Number
+ */
+int Liric_Shm_Reader_Get_Error_Number(void)
+{
+	return Reader_Error_Number;
+}
+
+/**
+ * The error routine that reports any errors occuring in a standard way.
+ * @see #Reader_Error_Number
+ * @see #Reader_Error_String
+ * @see #Reader_Current_Time_String
+ */
+void Liric_Shm_Reader_Error(void)
+{
+	char time_string[32];
+
+	Reader_Current_Time_String(time_string,32);
+	/* if the error number is zero an error message has not been set up
+	** This is in itself an error as we should not be calling this routine
+	** without there being an error to display */
+	if(Reader_Error_Number == 0)
+		sprintf(Reader_Error_String,"Logic Error:No Error defined");
+	fprintf(stderr,"%s Liric_Shm_Reader:Error(%d) : %s\n",time_string,Reader_Error_Number,Reader_Error_String);
+}
+
+/**
+ * The error routine that reports any errors occuring in a standard way. This routine places the
+ * generated error string at the end of a passed in string argument.
+ * @param error_string A string to put the generated error in. This string should be initialised before
+ * being passed to this routine. The routine will try to concatenate it's error string onto the end
+ * of any string already in existance.
+ * @see #Reader_Error_Number
+ * @see #Reader_Error_String
+ * @see #Reader_Current_Time_String
+ */
+void Liric_Shm_Reader_Error_String(char *error_string)
+{
+	char time_string[32];
+
+	Reader_Current_Time_String(time_string,32);
+	/* if the error number is zero an error message has not been set up
+	** This is in itself an error as we should not be calling this routine
+	** without there being an error to display */
+	if(Reader_Error_Number == 0)
+		sprintf(Reader_Error_String,"Logic Error:No Error defined");
+	sprintf(error_string+strlen(error_string),"%s Liric_Shm_Reader:Error(%d) : %s\n",time_string,
+		Reader_Error_Number,Reader_Error_String);
+}
+
+/* ----------------------------------------------------------------------------
+** 		internal functions
+** ---------------------------------------------------------------------------- */
+/**
+ * Routine to get the current time in a string. The string is returned in the format
+ * '2000-01-01T13:59:59 UTC'.
+ * @param time_string The string to fill with the current time.
+ * @param string_length The length of the buffer passed in. It is recommended the length is at least 24 characters.
+ */
+static void Reader_Current_Time_String(char *time_string,int string_length)
+{
+	time_t current_time;
+	struct tm *utc_time = NULL;
+
+	current_time = time(NULL);
+	utc_time = gmtime(&current_time);
+	strftime(time_string,string_length,"%Y-%m-%dT%H:%M:%S %Z",utc_time);
+}
@@ -0,0 +1,346 @@
+/* liric_state.c
+** Liric published instrument state routines
+*/
+/**
+ * Published instrument state routines for the liric program. The acquisition, mechanism and telemetry threads
+ * publish what they are doing into a single state structure, which the status commands read without taking any
+ * locks and without querying the modules (or hardware) involved. 
+ * The state is protected by a sequence lock: a writer increments State_Data.Sequence (making it odd) before
+ * changing the state, and increments it again (making it even) afterwards. A reader copies the state, and retries
+ * if the sequence number was odd or changed whilst it was copying, so it always gets a consistent snapshot.
+ * Writers are serialised with a mutex, readers never block writers.
+ * The time each startup phase took is also kept here. This is written once whilst liric starts, and is 
+ * not part of the published (shared memory) state, so it is just protected by the write mutex.
+ * @author Chris Mottram
+ * @version $Revision$
+ */
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_SOURCE 1
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_C_SOURCE 199309L
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "log_udp.h"
+
+#include "detector_exposure.h"
+#include "detector_fits_filename.h"
+#include "detector_telemetry.h"
+
+#include "liric_general.h"
+#include "liric_shm.h"
+#include "liric_state.h"
+
+/* data types */
+/**
+ * Data type holding local data to liric_state:
+ * <dl>
+ * <dt>Write_Mutex</dt> <dd>Mutex held by a writer whilst it is publishing, so only one thread writes at once.
+ *     Readers do not use it.</dd>
+ * <dt>Sequence</dt> <dd>The sequence lock counter. Odd whilst a writer is changing State.</dd>
+ * <dt>State</dt> <dd>The published state.</dd>
+ * <dt>Startup</dt> <dd>How long each startup phase took. Protected by Write_Mutex.</dd>
+ * </dl>
+ * @see liric_state.html#Liric_State_Struct
+ * @see liric_state.html#Liric_State_Startup_Struct
+ */
+struct State_Struct
+{
+	pthread_mutex_t Write_Mutex;
+	volatile unsigned int Sequence;
+	struct Liric_State_Struct State;
+	struct Liric_State_Startup_Struct Startup;
+};
+
+/* internal data */
+/**
+ * Revision Control System identifier.
+ */
+static char rcsid[] = "$Id$";
+/**
+ * The instance of State_Struct that contains local data for this module. This is initialised as follows:
+ * <dl>
+ * <dt>Write_Mutex</dt> <dd>PTHREAD_MUTEX_INITIALIZER</dd>
+ * <dt>Sequence</dt> <dd>0</dd>
+ * <dt>State</dt> <dd>All zero/FALSE: nothing in progress, and the mechanism positions and temperature not 
+ *     yet known.</dd>
+ * <dt>Startup</dt> <dd>No phases recorded, and a total time of 0.</dd>
+ * </dl>
+ */
+static struct State_Struct State_Data =
+{
+	PTHREAD_MUTEX_INITIALIZER,0,
+	{0,{0,0},FALSE,0,0,FALSE,0,{0,0},0,0,0,0,FALSE,0,FALSE,-1,FALSE,0.0,{0,0}},
+	{0,{{"",FALSE,0.0}},0.0}
+};
+
+/* internal functions */
+static struct Liric_State_Struct *State_Write_Start(void);
+static void State_Write_End(void);
+
+/* ----------------------------------------------------------------------------
+** 		external functions 
+** ---------------------------------------------------------------------------- */
+/**
+ * Get a consistent snapshot of the published instrument state. This never blocks: if a writer is publishing
+ * whilst we are copying the state, we retry.
+ * @param state The address of a state structure, on return filled in with the snapshot.
+ * @see #State_Data
+ */
+void Liric_State_Get(struct Liric_State_Struct *state)
+{
+	unsigned int start_sequence,end_sequence;
+
+	do
+	{
+		start_sequence = State_Data.Sequence;
+		if(start_sequence & 1)
+		{
+			/* a writer is publishing, let it finish */
+			sched_yield();
+			end_sequence = start_sequence+1;
+			continue;
+		}
+		__sync_synchronize();
+		memcpy(state,&(State_Data.State),sizeof(struct Liric_State_Struct));
+		__sync_synchronize();
+		end_sequence = State_Data.Sequence;
+	}
+	while(start_sequence != end_sequence);
+}
+
+/**
+ * Re-publish the state without changing it. This is called once the shared memory region has been created, so
+ * the state published before then is copied into it.
+ * @see #State_Write_Start
+ * @see #State_Write_End
+ */
+void Liric_State_Publish(void)
+{
+	State_Write_Start();
+	State_Write_End();
+}
+
+/**
+ * Publish the state of a multrun/multbias/multdark. Called by the acquisition thread when the sequence starts,
+ * as it starts each frame, and when it stops.
+ * @param in_progress A boolean, TRUE if a multrun/multbias/multdark is in progress.
+ * @param count The number of frames in the sequence.
+ * @param index The index of the frame being taken.
+ * @see #State_Write_Start
+ * @see #State_Write_End
+ */
+void Liric_State_Sequence_Set(int in_progress,int count,int index)
+{
+	struct Liric_State_Struct *state = NULL;
+
+	state = State_Write_Start();
+	state->Sequence_In_Progress = in_progress;
+	state->Sequence_Count = count;
+	state->Sequence_Index = index;
+	State_Write_End();
+}
+
+/**
+ * Publish the state of the detector exposure. The exposure length, start time, coadds and FITS filename numbers
+ * are read from the detector library, so this must be called from the thread doing the exposure (or when no
+ * exposure is in progress), where reading them does not race with them being changed.
+ * @param in_progress A boolean, TRUE if an exposure has just started, FALSE if it has just finished 
+ *        (or the coadd exposure length has been changed).
+ * @see #State_Write_Start
+ * @see #State_Write_End
+ * @see ../detector/cdocs/detector_exposure.html#Detector_Exposure_Exposure_Length_Get
+ * @see ../detector/cdocs/detector_exposure.html#Detector_Exposure_Start_Time_Get
+ * @see ../detector/cdocs/detector_exposure.html#Detector_Exposure_Coadd_Count_Get
+ * @see ../detector/cdocs/detector_exposure.html#Detector_Exposure_Coadd_Frame_Exposure_Length_Get
+ * @see ../detector/cdocs/detector_fits_filename.html#Detector_Fits_Filename_Multrun_Get
+ * @see ../detector/cdocs/detector_fits_filename.html#Detector_Fits_Filename_Run_Get
+ */
+void Liric_State_Exposure_Update(int in_progress)
+{
+	struct Liric_State_Struct *state = NULL;
+	struct timespec start_time;
+	int exposure_length,coadd_count,coadd_length,multrun_number,run_number;
+
+	/* read the detector library outside the write lock */
+	exposure_length = Detector_Exposure_Exposure_Length_Get();
+	start_time = Detector_Exposure_Start_Time_Get();
+	coadd_count = Detector_Exposure_Coadd_Count_Get();
+	coadd_length = Detector_Exposure_Coadd_Frame_Exposure_Length_Get();
+	multrun_number = Detector_Fits_Filename_Multrun_Get();
+	run_number = Detector_Fits_Filename_Run_Get();
+	state = State_Write_Start();
+	state->Exposure_In_Progress = in_progress;
+	state->Exposure_Length_Ms = exposure_length;
+	state->Exposure_Start_Time = start_time;
+	state->Coadd_Count = coadd_count;
+	state->Coadd_Frame_Exposure_Length_Ms = coadd_length;
+	state->Multrun_Number = multrun_number;
+	state->Run_Number = run_number;
+	State_Write_End();
+}
+
+/**
+ * Exposure start callback, set with Detector_Exposure_Start_Callback_Set. The detector library calls this
+ * in the exposing thread once an exposure or bias has started, and we publish the exposure state.
+ * @see #Liric_State_Exposure_Update
+ * @see ../detector/cdocs/detector_exposure.html#Detector_Exposure_Start_Callback_Set
+ */
+void Liric_State_Exposure_Started(void)
+{
+	Liric_State_Exposure_Update(TRUE);
+}
+
+/**
+ * Publish the filter wheel position. Called before (position 0, moving) and after a filter wheel move,
+ * or when the position has been read from the filter wheel.
+ * @param valid A boolean, TRUE if the position is known, FALSE if it is not (e.g. a move failed).
+ * @param position The filter wheel position, 0 if it is moving.
+ * @see #State_Write_Start
+ * @see #State_Write_End
+ */
+void Liric_State_Filter_Wheel_Set(int valid,int position)
+{
+	struct Liric_State_Struct *state = NULL;
+
+	state = State_Write_Start();
+	state->Filter_Wheel_Valid = valid;
+	state->Filter_Wheel_Position = position;
+	State_Write_End();
+}
+
+/**
+ * Publish the nudgematic position. Called before (position -1, moving) and after a nudgematic move,
+ * or when the position has been read from the nudgematic.
+ * @param valid A boolean, TRUE if the position is known, FALSE if it is not (e.g. a move failed).
+ * @param position The nudgematic position, -1 if it is moving.
+ * @see #State_Write_Start
+ * @see #State_Write_End
+ */
+void Liric_State_Nudgematic_Set(int valid,int position)
+{
+	struct Liric_State_Struct *state = NULL;
+
+	state = State_Write_Start();
+	state->Nudgematic_Valid = valid;
+	state->Nudgematic_Position = position;
+	State_Write_End();
+}
+
+/**
+ * Telemetry sample callback, set with Detector_Telemetry_Sample_Callback_Set. The detector library calls this
+ * in the telemetry sampler thread with each new sample, and we publish the sensor temperature if it was read
+ * successfully.
+ * @param sample The new sample.
+ * @see #State_Write_Start
+ * @see #State_Write_End
+ * @see ../detector/cdocs/detector_telemetry.html#Detector_Telemetry_Sample_Callback_Set
+ * @see ../detector/cdocs/detector_telemetry.html#DETECTOR_TELEMETRY_VALID_SENSOR_TEMPERATURE
+ */
+void Liric_State_Telemetry_Sample_Set(struct Detector_Telemetry_Sample_Struct *sample)
+{
+	struct Liric_State_Struct *state = NULL;
+
+	if((sample->Valid_Mask & DETECTOR_TELEMETRY_VALID_SENSOR_TEMPERATURE) == 0)
+		return;
+	state = State_Write_Start();
+	state->Temperature_Valid = TRUE;
+	state->Temperature_C = sample->Sensor_Temperature_C;
+	state->Temperature_Time = sample->Timestamp;
+	State_Write_End();
+}
+
+/**
+ * Record how long a startup phase took. This can be called by several startup threads at once.
+ * If LIRIC_STATE_STARTUP_PHASE_MAX_COUNT phases have already been recorded, the phase is ignored.
+ * @param name The name of the phase. Names longer than LIRIC_STATE_STARTUP_PHASE_NAME_LENGTH are truncated.
+ * @param success A boolean, TRUE if the phase succeeded.
+ * @param time_ms How long the phase took, in milliseconds.
+ * @see #State_Data
+ * @see liric_state.html#LIRIC_STATE_STARTUP_PHASE_MAX_COUNT
+ * @see liric_state.html#LIRIC_STATE_STARTUP_PHASE_NAME_LENGTH
+ */
+void Liric_State_Startup_Phase_Add(char *name,int success,double time_ms)
+{
+	struct Liric_State_Startup_Phase_Struct *phase = NULL;
+
+	pthread_mutex_lock(&(State_Data.Write_Mutex));
+	if(State_Data.Startup.Phase_Count < LIRIC_STATE_STARTUP_PHASE_MAX_COUNT)
+	{
+		phase = &(State_Data.Startup.Phase_List[State_Data.Startup.Phase_Count]);
+		strncpy(phase->Name,name,LIRIC_STATE_STARTUP_PHASE_NAME_LENGTH-1);
+		phase->Name[LIRIC_STATE_STARTUP_PHASE_NAME_LENGTH-1] = '\0';
+		phase->Success = success;
+		phase->Time_Ms = time_ms;
+		State_Data.Startup.Phase_Count++;
+	}
+	pthread_mutex_unlock(&(State_Data.Write_Mutex));
+}
+
+/**
+ * Record how long the whole startup took, from the program starting to the server being ready to accept
+ * commands.
+ * @param time_ms How long the startup took, in milliseconds.
+ * @see #State_Data
+ */
+void Liric_State_Startup_Total_Set(double time_ms)
+{
+	pthread_mutex_lock(&(State_Data.Write_Mutex));
+	State_Data.Startup.Total_Time_Ms = time_ms;
+	pthread_mutex_unlock(&(State_Data.Write_Mutex));
+}
+
+/**
+ * Get a copy of the startup phase times.
+ * @param startup The address of a startup structure, on return filled in with the phase times.
+ * @see #State_Data
+ */
+void Liric_State_Startup_Get(struct Liric_State_Startup_Struct *startup)
+{
+	pthread_mutex_lock(&(State_Data.Write_Mutex));
+	memcpy(startup,&(State_Data.Startup),sizeof(struct Liric_State_Startup_Struct));
+	pthread_mutex_unlock(&(State_Data.Write_Mutex));
+}
+
+/* ----------------------------------------------------------------------------
+** 		internal functions 
+** ---------------------------------------------------------------------------- */
+/**
+ * Start publishing a change to the state. We lock the write mutex, and make the sequence number odd so
+ * readers know the state is being changed. State_Write_End must be called once the change has been made.
+ * @return The address of the state to change.
+ * @see #State_Data
+ * @see #State_Write_End
+ */
+static struct Liric_State_Struct *State_Write_Start(void)
+{
+	pthread_mutex_lock(&(State_Data.Write_Mutex));
+	State_Data.Sequence++;
+	__sync_synchronize();
+	return &(State_Data.State);
+}
+
+/**
+ * Finish publishing a change to the state. We update the state's version and update time, make the sequence
+ * number even again, copy the state into the shared memory region (if it has been created) using
+ * Liric_Shm_State_Publish, and unlock the write mutex.
+ * @see #State_Data
+ * @see #State_Write_Start
+ * @see liric_shm.html#Liric_Shm_State_Publish
+ */
+static void State_Write_End(void)
+{
+	State_Data.State.Version++;
+	clock_gettime(CLOCK_REALTIME,&(State_Data.State.Update_Time));
+	__sync_synchronize();
+	State_Data.Sequence++;
+	Liric_Shm_State_Publish(&(State_Data.State));
+	pthread_mutex_unlock(&(State_Data.Write_Mutex));
+}
@@ -6,10 +6,20 @@
  * @author Chris Mottram
  * @version $Revision$
  */
+/**
+ * This hash define is needed before including source files give us the pthread_setaffinity_np / CPU_SET prototypes.
+ */
+#define _GNU_SOURCE
 #include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include "log_udp.h"
 #include "detector_buffer.h"
 #include "detector_general.h"
@@ -29,7 +39,34 @@
  * <dt>Mean_Image</dt> <dd>A pointer to an allocated block of double floating point memory,
  *                     of size Size_X * Size_Y * sizeof(double) bytes.
  *                     Used for storing the arithmetic mean of the coadds.</dd>
+ * <dt>Noise_Type</dt> <dd>Which sort of noise image (if any) we are accumulating data for, of type 
+ *                     DETECTOR_BUFFER_NOISE_TYPE.</dd>
+ * <dt>Coadd_Squared_Image</dt> <dd>A pointer to an allocated block of long long (64 bit) integer memory,
+ *                      of size Size_X * Size_Y * sizeof(long long) bytes. Used for storing the sum of the squares
+ *                      of a number of individual readouts. Only allocated when Noise_Type is not 
+ *                      DETECTOR_BUFFER_NOISE_TYPE_NONE.</dd>
+ * <dt>Noise_Image</dt> <dd>A pointer to an allocated block of double floating point memory,
+ *                     of size Size_X * Size_Y * sizeof(double) bytes.
+ *                     Used for storing the per-pixel variance / standard error of the coadds. 
+ *                     Only allocated when Noise_Type is not DETECTOR_BUFFER_NOISE_TYPE_NONE.</dd>
+ * <dt>Accumulator</dt> <dd>Which width of accumulator the current coadds are being summed into, 
+ *                     of type DETECTOR_BUFFER_ACCUMULATOR. Selected by Detector_Buffer_Initialise_Coadd_Image.</dd>
+ * <dt>Coadd_Image_64</dt> <dd>A pointer to an allocated block of long long (64 bit) integer memory,
+ *                      of size Size_X * Size_Y * sizeof(long long) bytes. Used instead of Coadd_Image to store
+ *                      the sum of the readouts when Accumulator is DETECTOR_BUFFER_ACCUMULATOR_64. 
+ *                      Only allocated the first time a 64 bit accumulator is needed.</dd>
+ * <dt>Use_Huge_Pages</dt> <dd>A boolean, if TRUE the image buffers are allocated using 2 MB huge pages.</dd>
+ * <dt>Lock_Memory</dt> <dd>A boolean, if TRUE the image buffers are locked into RAM using mlock.</dd>
+ * <dt>Strip_Row_Count</dt> <dd>The number of rows in each readout strip, when each coadd is read out of the 
+ *                     frame grabber a strip at a time and accumulated straight away. 0 means each coadd is read
+ *                     out whole into Mono_Image, and then added to the coadd image in a second pass.</dd>
+ * <dt>Strip_Image</dt> <dd>A pointer to an allocated block of unsigned short memory,
+ *                      of size Size_X * Strip_Row_Count * sizeof(unsigned short) bytes. Used for storing
+ *                      one readout strip, small enough to still be in cache when it is added to the coadd image.
+ *                      Only allocated when Strip_Row_Count is greater than 0.</dd>
  * </dl>
+ * @see detector_buffer.html#DETECTOR_BUFFER_NOISE_TYPE
+ * @see detector_buffer.html#DETECTOR_BUFFER_ACCUMULATOR
  */
 struct Buffer_Struct
 {
@@ -38,6 +75,134 @@ struct Buffer_Struct
 	unsigned short *Mono_Image;
 	int *Coadd_Image;
 	double *Mean_Image;
+	enum DETECTOR_BUFFER_NOISE_TYPE Noise_Type;
+	long long *Coadd_Squared_Image;
+	double *Noise_Image;
+	enum DETECTOR_BUFFER_ACCUMULATOR Accumulator;
+	long long *Coadd_Image_64;
+	int Use_Huge_Pages;
+	int Lock_Memory;
+	int Strip_Row_Count;
+	unsigned short *Strip_Image;
+};
+
+/**
+ * Data type holding per-frame statistics of the mean image, computed by Detector_Buffer_Create_Mean_Image.
+ * This consists of the following:
+ * <dl>
+ * <dt>Mutex</dt> <dd>A mutex held whilst the statistics below are computed, and whilst they are copied by 
+ *                Detector_Buffer_Statistics_Get / Detector_Buffer_Histogram_Get, as these are called from the
+ *                status command threads whilst an exposure is in progress.</dd>
+ * <dt>Is_Valid</dt> <dd>An integer as a boolean, TRUE if the statistics have been computed for the last 
+ *                   mean image.</dd>
+ * <dt>Saturation_Level</dt> <dd>The mean pixel value at or above which a pixel is counted as saturated.</dd>
+ * <dt>Minimum</dt> <dd>The minimum pixel value in the mean image.</dd>
+ * <dt>Maximum</dt> <dd>The maximum pixel value in the mean image.</dd>
+ * <dt>Mean</dt> <dd>The mean pixel value in the mean image.</dd>
+ * <dt>Median</dt> <dd>An estimate of the median pixel value in the mean image, derived from the histogram.</dd>
+ * <dt>Saturated_Count</dt> <dd>The number of pixels in the mean image at or above Saturation_Level.</dd>
+ * <dt>Histogram</dt> <dd>A histogram of the mean image, with one bin per 16 bit pixel value.</dd>
+ * </dl>
+ * @see detector_buffer.html#DETECTOR_BUFFER_HISTOGRAM_BIN_COUNT
+ */
+struct Buffer_Statistics_Struct
+{
+	pthread_mutex_t Mutex;
+	int Is_Valid;
+	int Saturation_Level;
+	double Minimum;
+	double Maximum;
+	double Mean;
+	double Median;
+	int Saturated_Count;
+	unsigned int Histogram[DETECTOR_BUFFER_HISTOGRAM_BIN_COUNT];
+};
+
+/**
+ * Data type holding the details of an image buffer allocation made by Buffer_Image_Allocate. This is stored
+ * in the first DETECTOR_BUFFER_ALIGNMENT bytes of the allocation, before the image data, 
+ * so Buffer_Image_Free knows how to release it. This consists of the following:
+ * <dl>
+ * <dt>Length</dt> <dd>The length of the whole allocation in bytes, including this header.</dd>
+ * <dt>Is_Mapped</dt> <dd>A boolean, TRUE if the allocation was made with mmap (huge pages), 
+ *                    FALSE if it was made with posix_memalign.</dd>
+ * <dt>Is_Locked</dt> <dd>A boolean, TRUE if the allocation was locked into RAM with mlock.</dd>
+ * </dl>
+ * @see #Buffer_Image_Allocate
+ * @see #Buffer_Image_Free
+ * @see detector_buffer.html#DETECTOR_BUFFER_ALIGNMENT
+ */
+struct Buffer_Allocation_Struct
+{
+	size_t Length;
+	int Is_Mapped;
+	int Is_Locked;
+};
+
+/**
+ * Data type holding the partial statistics of one row band of the mean image, computed by 
+ * Buffer_Mean_Kernel and merged into Buffer_Statistics by Detector_Buffer_Create_Mean_Image.
+ * This consists of the following:
+ * <dl>
+ * <dt>Minimum</dt> <dd>The minimum pixel value in this band of the mean image.</dd>
+ * <dt>Maximum</dt> <dd>The maximum pixel value in this band of the mean image.</dd>
+ * <dt>Sum</dt> <dd>The sum of the pixel values in this band of the mean image.</dd>
+ * <dt>Saturated_Count</dt> <dd>The number of pixels in this band at or above the saturation level.</dd>
+ * <dt>Histogram</dt> <dd>A pointer to a histogram of this band, with DETECTOR_BUFFER_HISTOGRAM_BIN_COUNT bins.
+ *                   For band 0 this is Buffer_Statistics.Histogram, for the other bands it is allocated by
+ *                   Detector_Buffer_Thread_Pool_Start.</dd>
+ * </dl>
+ * @see #Buffer_Mean_Kernel
+ */
+struct Buffer_Band_Statistics_Struct
+{
+	double Minimum;
+	double Maximum;
+	double Sum;
+	int Saturated_Count;
+	unsigned int *Histogram;
+};
+
+/**
+ * Data type holding the state of the worker thread pool used to split the pixel kernels into row bands.
+ * This consists of the following:
+ * <dl>
+ * <dt>Thread_Count</dt> <dd>The number of threads a kernel is split over, including the calling thread.
+ *                     1 means the kernels run on the calling thread only, and no worker threads exist.</dd>
+ * <dt>Thread_List</dt> <dd>The worker thread ids. Worker N (1..Thread_Count-1) processes row band N,
+ *                     the calling thread processes band 0.</dd>
+ * <dt>Core_List</dt> <dd>The CPU core each worker thread is pinned to, or -1 if it is not pinned.</dd>
+ * <dt>Mutex</dt> <dd>A mutex protecting the rest of the pool state.</dd>
+ * <dt>Start_Condition</dt> <dd>A condition variable signalled when a new kernel is ready for the workers.</dd>
+ * <dt>Done_Condition</dt> <dd>A condition variable signalled when the last worker has finished its band.</dd>
+ * <dt>Generation</dt> <dd>Incremented each time a new kernel is started, so the workers can tell a new 
+ *                     kernel from a spurious wakeup.</dd>
+ * <dt>Start_Generation</dt> <dd>The value of Generation when the pool was started. A new worker uses this
+ *                     as the last generation it has seen, so it cannot miss a kernel started before it first
+ *                     takes the mutex.</dd>
+ * <dt>Pending_Count</dt> <dd>The number of workers that have not yet finished the current kernel.</dd>
+ * <dt>Quit</dt> <dd>A boolean, set to TRUE to tell the workers to exit.</dd>
+ * <dt>Kernel</dt> <dd>The kernel function the workers should run, called with a band number and a range of rows.</dd>
+ * <dt>Row_Count</dt> <dd>The number of rows the current kernel is split over.</dd>
+ * <dt>Coadds</dt> <dd>The number of coadds, used by the mean and noise image kernels.</dd>
+ * </dl>
+ * @see detector_buffer.html#DETECTOR_BUFFER_MAX_THREAD_COUNT
+ */
+struct Buffer_Thread_Struct
+{
+	int Thread_Count;
+	pthread_t Thread_List[DETECTOR_BUFFER_MAX_THREAD_COUNT];
+	int Core_List[DETECTOR_BUFFER_MAX_THREAD_COUNT];
+	pthread_mutex_t Mutex;
+	pthread_cond_t Start_Condition;
+	pthread_cond_t Done_Condition;
+	unsigned int Generation;
+	unsigned int Start_Generation;
+	int Pending_Count;
+	int Quit;
+	void (*Kernel)(int band,int start_row,int end_row);
+	int Row_Count;
+	int Coadds;
 };
 
 /* internal variables */
@@ -53,11 +218,72 @@ static char rcsid[] = "$Id$";
  * <dt>Mono_Image</dt> <dd>NULL</dd>
  * <dt>Coadd_Image</dt> <dd>NULL</dd>
  * <dt>Mean_Image</dt> <dd>NULL</dd>
+ * <dt>Noise_Type</dt> <dd>DETECTOR_BUFFER_NOISE_TYPE_NONE</dd>
+ * <dt>Coadd_Squared_Image</dt> <dd>NULL</dd>
+ * <dt>Noise_Image</dt> <dd>NULL</dd>
+ * <dt>Accumulator</dt> <dd>DETECTOR_BUFFER_ACCUMULATOR_32</dd>
+ * <dt>Coadd_Image_64</dt> <dd>NULL</dd>
+ * <dt>Use_Huge_Pages</dt> <dd>FALSE</dd>
+ * <dt>Lock_Memory</dt> <dd>FALSE</dd>
+ * <dt>Strip_Row_Count</dt> <dd>0</dd>
+ * <dt>Strip_Image</dt> <dd>NULL</dd>
  * </dl>
  */
 static struct Buffer_Struct Buffer_Data = 
 {
-	0,0,NULL,NULL,NULL
+	0,0,NULL,NULL,NULL,DETECTOR_BUFFER_NOISE_TYPE_NONE,NULL,NULL,DETECTOR_BUFFER_ACCUMULATOR_32,NULL,FALSE,FALSE,
+	0,NULL
+};
+
+/**
+ * The instance of Buffer_Statistics_Struct that contains the statistics of the last mean image. 
+ * This is initialised as follows:
+ * <dl>
+ * <dt>Mutex</dt> <dd>PTHREAD_MUTEX_INITIALIZER</dd>
+ * <dt>Is_Valid</dt> <dd>FALSE</dd>
+ * <dt>Saturation_Level</dt> <dd>DETECTOR_BUFFER_DEFAULT_SATURATION_LEVEL</dd>
+ * <dt>Minimum</dt> <dd>0.0</dd>
+ * <dt>Maximum</dt> <dd>0.0</dd>
+ * <dt>Mean</dt> <dd>0.0</dd>
+ * <dt>Median</dt> <dd>0.0</dd>
+ * <dt>Saturated_Count</dt> <dd>0</dd>
+ * <dt>Histogram</dt> <dd>{0}</dd>
+ * </dl>
+ * @see detector_buffer.html#DETECTOR_BUFFER_DEFAULT_SATURATION_LEVEL
+ */
+static struct Buffer_Statistics_Struct Buffer_Statistics = 
+{
+	PTHREAD_MUTEX_INITIALIZER,FALSE,DETECTOR_BUFFER_DEFAULT_SATURATION_LEVEL,0.0,0.0,0.0,0.0,0,{0}
+};
+
+/**
+ * The partial statistics of each row band of the mean image.
+ * @see #Buffer_Band_Statistics_Struct
+ * @see detector_buffer.html#DETECTOR_BUFFER_MAX_THREAD_COUNT
+ */
+static struct Buffer_Band_Statistics_Struct Buffer_Band_Statistics[DETECTOR_BUFFER_MAX_THREAD_COUNT];
+
+/**
+ * The instance of Buffer_Thread_Struct that contains the worker thread pool state. This is initialised as follows:
+ * <dl>
+ * <dt>Thread_Count</dt> <dd>1</dd>
+ * <dt>Thread_List</dt> <dd>{0}</dd>
+ * <dt>Core_List</dt> <dd>{0}</dd>
+ * <dt>Mutex</dt> <dd>PTHREAD_MUTEX_INITIALIZER</dd>
+ * <dt>Start_Condition</dt> <dd>PTHREAD_COND_INITIALIZER</dd>
+ * <dt>Done_Condition</dt> <dd>PTHREAD_COND_INITIALIZER</dd>
+ * <dt>Generation</dt> <dd>0</dd>
+ * <dt>Start_Generation</dt> <dd>0</dd>
+ * <dt>Pending_Count</dt> <dd>0</dd>
+ * <dt>Quit</dt> <dd>FALSE</dd>
+ * <dt>Kernel</dt> <dd>NULL</dd>
+ * <dt>Row_Count</dt> <dd>0</dd>
+ * <dt>Coadds</dt> <dd>1</dd>
+ * </dl>
+ */
+static struct Buffer_Thread_Struct Buffer_Thread_Data = 
+{
+	1,{0},{0},PTHREAD_MUTEX_INITIALIZER,PTHREAD_COND_INITIALIZER,PTHREAD_COND_INITIALIZER,0,0,0,FALSE,NULL,0,1
 };
 
 /**
@@ -69,6 +295,25 @@ static int Buffer_Error_Number = 0;
  * @see detector_general.html#DETECTOR_GENERAL_ERROR_STRING_LENGTH
  */
 static char Buffer_Error_String[DETECTOR_GENERAL_ERROR_STRING_LENGTH] = "";
+
+/* internal functions */
+static int Buffer_Noise_Allocate(void);
+static void Buffer_Noise_Free(void);
+static int Buffer_Strip_Allocate(void);
+static void Buffer_Strip_Free(void);
+static void *Buffer_Image_Allocate(size_t length);
+static void Buffer_Image_Free(void *image);
+static int Buffer_Thread_Run(void (*kernel)(int band,int start_row,int end_row),int row_count);
+static void *Buffer_Thread_Worker(void *user_arg);
+static void Buffer_Add_Kernel(int band,int start_row,int end_row);
+static void Buffer_Add_Pixels(unsigned short *image,int start_pixel,int pixel_count);
+static void Buffer_Flip_X_Kernel(int band,int start_row,int end_row);
+static void Buffer_Flip_Y_Kernel(int band,int start_row,int end_row);
+static void Buffer_Mean_Kernel(int band,int start_row,int end_row);
+static void Buffer_Noise_Kernel(int band,int start_row,int end_row);
+static void Buffer_Flip_X_Long_Long(long long *image,int start_row,int end_row);
+static void Buffer_Flip_Y_Long_Long(long long *image,int start_row,int end_row);
+
 /* --------------------------------------------------------
 ** External Functions
 ** -------------------------------------------------------- */
@@ -79,6 +324,12 @@ static char Buffer_Error_String[DETECTOR_GENERAL_ERROR_STRING_LENGTH] = "";
  *     and if so make no changes and return success.
  * <li>We call Detector_Buffer_Free to ensure any previous memory allocations are freed correctly.
  * <li>We allocate new buffers, using size_x and size_y to determine the buffer size (in pixels).
+ *     The buffers are allocated by Buffer_Image_Allocate, so are cache line aligned, and are huge page backed
+ *     and/or locked into RAM as configured by Detector_Buffer_Memory_Options_Set.
+ * <li>If we are accumulating a noise image, we call Buffer_Noise_Allocate to allocate the noise buffers.
+ * <li>If coadds are read out in strips, we call Buffer_Strip_Allocate to allocate the strip buffer.
+ * <li>If allocating the noise or strip buffers fails, we call Detector_Buffer_Free so we don't leave a partially
+ *     allocated set of buffers behind.
  * </ul>
  * @param size_x The X size of the image, in pixels (should be greater than 0).
  * @param size_y The Y size of the image, in pixels (should be greater than 0).
@@ -88,12 +339,16 @@ static char Buffer_Error_String[DETECTOR_GENERAL_ERROR_STRING_LENGTH] = "";
  * @see #Buffer_Error_Number
  * @see #Buffer_Error_String
  * @see #Detector_Buffer_Free
+ * @see #Buffer_Noise_Allocate
+ * @see #Buffer_Strip_Allocate
+ * @see #Buffer_Image_Allocate
+ * @see #Detector_Buffer_Memory_Options_Set
  * @see detector_general.html#Detector_General_Log
  * @see detector_general.html#Detector_General_Log_Format
  */
 int Detector_Buffer_Allocate(int size_x,int size_y)
 {
-	int retval;
+	int retval,error_number;
 	
 	Buffer_Error_Number = 0;
 #if LOGGING > 1
@@ -115,7 +370,10 @@ int Detector_Buffer_Allocate(int size_x,int size_y)
 	/* check - if the new size is the same as the old size, and all buffers are already allocated, 
 	** we don't need to do anything */
 	if((Buffer_Data.Size_X == size_x)&&(Buffer_Data.Size_Y == size_y)&&(Buffer_Data.Mono_Image != NULL)&&
-	   (Buffer_Data.Coadd_Image != NULL)&&(Buffer_Data.Mean_Image != NULL))
+	   (Buffer_Data.Coadd_Image != NULL)&&(Buffer_Data.Mean_Image != NULL)&&
+	   ((Buffer_Data.Noise_Type == DETECTOR_BUFFER_NOISE_TYPE_NONE)||
+	    ((Buffer_Data.Coadd_Squared_Image != NULL)&&(Buffer_Data.Noise_Image != NULL)))&&
+	   ((Buffer_Data.Strip_Row_Count == 0)||(Buffer_Data.Strip_Image != NULL)))
 	{
 #if LOGGING > 1
 		Detector_General_Log_Format(LOG_VERBOSITY_INTERMEDIATE,
@@ -131,7 +389,7 @@ int Detector_Buffer_Allocate(int size_x,int size_y)
 	Buffer_Data.Size_X = size_x;
 	Buffer_Data.Size_Y = size_y;
 	/* allocate mono image */
-	Buffer_Data.Mono_Image = (unsigned short *)malloc(Buffer_Data.Size_X*Buffer_Data.Size_Y*sizeof(unsigned short));
+	Buffer_Data.Mono_Image = (unsigned short *)Buffer_Image_Allocate(Buffer_Data.Size_X*Buffer_Data.Size_Y*sizeof(unsigned short));
 	if(Buffer_Data.Mono_Image == NULL)
 	{
 		Buffer_Error_Number = 3;
@@ -140,10 +398,10 @@ int Detector_Buffer_Allocate(int size_x,int size_y)
 		return FALSE;
 	}
 	/* allocate coadd image */
-	Buffer_Data.Coadd_Image = (int *)malloc(Buffer_Data.Size_X*Buffer_Data.Size_Y*sizeof(int));
+	Buffer_Data.Coadd_Image = (int *)Buffer_Image_Allocate(Buffer_Data.Size_X*Buffer_Data.Size_Y*sizeof(int));
 	if(Buffer_Data.Coadd_Image == NULL)
 	{
-		free(Buffer_Data.Mono_Image);
+		Buffer_Image_Free(Buffer_Data.Mono_Image);
 		Buffer_Data.Mono_Image = NULL;
 		Buffer_Error_Number = 4;
 		sprintf(Buffer_Error_String,"Detector_Buffer_Allocate:Failed to allocate Coadd_Image (%d,%d).",
@@ -151,18 +409,41 @@ int Detector_Buffer_Allocate(int size_x,int size_y)
 		return FALSE;
 	}
 	/* allocate mean image */
-	Buffer_Data.Mean_Image = (double *)malloc(Buffer_Data.Size_X*Buffer_Data.Size_Y*sizeof(double));
+	Buffer_Data.Mean_Image = (double *)Buffer_Image_Allocate(Buffer_Data.Size_X*Buffer_Data.Size_Y*sizeof(double));
 	if(Buffer_Data.Mean_Image == NULL)
 	{
-		free(Buffer_Data.Mono_Image);
+		Buffer_Image_Free(Buffer_Data.Mono_Image);
 		Buffer_Data.Mono_Image = NULL;
-		free(Buffer_Data.Coadd_Image);
+		Buffer_Image_Free(Buffer_Data.Coadd_Image);
 		Buffer_Data.Coadd_Image = NULL;
 		Buffer_Error_Number = 5;
 		sprintf(Buffer_Error_String,"Detector_Buffer_Allocate:Failed to allocate Mean_Image (%d,%d).",
 			Buffer_Data.Size_X,Buffer_Data.Size_Y);
 		return FALSE;
 	}
+	/* allocate noise buffers, if we are accumulating a noise image */
+	if(Buffer_Data.Noise_Type != DETECTOR_BUFFER_NOISE_TYPE_NONE)
+	{
+		if(!Buffer_Noise_Allocate())
+		{
+			/* Detector_Buffer_Free resets Buffer_Error_Number, but leaves Buffer_Error_String alone */
+			error_number = Buffer_Error_Number;
+			Detector_Buffer_Free();
+			Buffer_Error_Number = error_number;
+			return FALSE;
+		}
+	}
+	/* allocate strip buffer, if we are reading out coadds in strips */
+	if(Buffer_Data.Strip_Row_Count > 0)
+	{
+		if(!Buffer_Strip_Allocate())
+		{
+			error_number = Buffer_Error_Number;
+			Detector_Buffer_Free();
+			Buffer_Error_Number = error_number;
+			return FALSE;
+		}
+	}
 #if LOGGING > 1
 	Detector_General_Log(LOG_VERBOSITY_INTERMEDIATE,"Detector_Buffer_Allocate:Finished.");
 #endif
@@ -176,6 +457,8 @@ int Detector_Buffer_Allocate(int size_x,int size_y)
  * @see #Buffer_Data
  * @see #Buffer_Error_Number
  * @see #Buffer_Error_String
+ * @see #Buffer_Noise_Free
+ * @see #Buffer_Strip_Free
  * @see detector_general.html#Detector_General_Log
  */
 int Detector_Buffer_Free(void)
@@ -186,16 +469,24 @@ int Detector_Buffer_Free(void)
 #endif
 	/* mono image */
 	if(Buffer_Data.Mono_Image != NULL)
-		free(Buffer_Data.Mono_Image);
+		Buffer_Image_Free(Buffer_Data.Mono_Image);
 	Buffer_Data.Mono_Image = NULL;
 	/* coadd image */
 	if(Buffer_Data.Coadd_Image != NULL)
-		free(Buffer_Data.Coadd_Image);
+		Buffer_Image_Free(Buffer_Data.Coadd_Image);
 	Buffer_Data.Coadd_Image = NULL;
+	/* 64 bit coadd image */
+	if(Buffer_Data.Coadd_Image_64 != NULL)
+		Buffer_Image_Free(Buffer_Data.Coadd_Image_64);
+	Buffer_Data.Coadd_Image_64 = NULL;
 	/* mean image */
 	if(Buffer_Data.Mean_Image != NULL)
-		free(Buffer_Data.Mean_Image);
+		Buffer_Image_Free(Buffer_Data.Mean_Image);
 	Buffer_Data.Mean_Image = NULL;
+	/* noise buffers */
+	Buffer_Noise_Free();
+	/* strip buffer */
+	Buffer_Strip_Free();
 #if LOGGING > 1
 	Detector_General_Log(LOG_VERBOSITY_INTERMEDIATE,"Detector_Buffer_Free:Finished.");
 #endif
@@ -203,219 +494,806 @@ int Detector_Buffer_Free(void)
 }
 
 /**
- * Initialise the coadd image buffer pixels to 0.
+ * Set how the image buffers are allocated. This must be called before the buffers are allocated 
+ * (Detector_Buffer_Allocate, called from Detector_Setup_Startup), or after they have been freed.
+ * All image buffers are aligned to DETECTOR_BUFFER_ALIGNMENT bytes whatever the options.
+ * @param use_huge_pages A boolean, if TRUE the buffers are backed by 2 MB huge pages (MAP_HUGETLB), falling back
+ *        to transparent huge pages (MADV_HUGEPAGE) if no huge pages are reserved.
+ * @param lock_memory A boolean, if TRUE each image buffer is locked into RAM using mlock, so the coadd loop
+ *        never takes a page fault on them. Only the image buffers are locked, not the whole process.
  * @return The routine returns TRUE on success and FALSE on failure. 
  *         On failure, Buffer_Error_Number/Buffer_Error_String are set.
  * @see #Buffer_Data
  * @see #Buffer_Error_Number
  * @see #Buffer_Error_String
- * @see detector_general.html#Detector_General_Log
+ * @see #Buffer_Image_Allocate
+ * @see detector_general.html#DETECTOR_IS_BOOLEAN
+ * @see detector_general.html#Detector_General_Log_Format
  */
-int Detector_Buffer_Initialise_Coadd_Image(void)
+int Detector_Buffer_Memory_Options_Set(int use_huge_pages,int lock_memory)
 {
-	int i,pixel_count;
-	
+	Buffer_Error_Number = 0;
 #if LOGGING > 1
-	Detector_General_Log(LOG_VERBOSITY_INTERMEDIATE,"Detector_Buffer_Initialise_Coadd_Image:Started.");
+	Detector_General_Log_Format(LOG_VERBOSITY_INTERMEDIATE,
+				    "Detector_Buffer_Memory_Options_Set(use_huge_pages = %d,lock_memory = %d):Started.",
+				    use_huge_pages,lock_memory);
 #endif
-	if(Buffer_Data.Coadd_Image == NULL)
+	if(!DETECTOR_IS_BOOLEAN(use_huge_pages))
 	{
-		Buffer_Error_Number = 6;
-		sprintf(Buffer_Error_String,"Detector_Buffer_Initialise_Coadd_Image:Coadd Image was NULL.");
+		Buffer_Error_Number = 39;
+		sprintf(Buffer_Error_String,"Detector_Buffer_Memory_Options_Set:Illegal use_huge_pages value (%d).",
+			use_huge_pages);
 		return FALSE;
 	}
-	pixel_count = Buffer_Data.Size_X*Buffer_Data.Size_Y;
-	for(i=0; i < pixel_count; i++)
+	if(!DETECTOR_IS_BOOLEAN(lock_memory))
+	{
+		Buffer_Error_Number = 40;
+		sprintf(Buffer_Error_String,"Detector_Buffer_Memory_Options_Set:Illegal lock_memory value (%d).",
+			lock_memory);
+		return FALSE;
+	}
+	if(Buffer_Data.Mono_Image != NULL)
 	{
-		Buffer_Data.Coadd_Image[i] = 0;
+		Buffer_Error_Number = 41;
+		sprintf(Buffer_Error_String,"Detector_Buffer_Memory_Options_Set:Image buffers are already allocated.");
+		return FALSE;
 	}
+	Buffer_Data.Use_Huge_Pages = use_huge_pages;
+	Buffer_Data.Lock_Memory = lock_memory;
 #if LOGGING > 1
-	Detector_General_Log(LOG_VERBOSITY_INTERMEDIATE,"Detector_Buffer_Initialise_Coadd_Image:Finished.");
+	Detector_General_Log(LOG_VERBOSITY_INTERMEDIATE,"Detector_Buffer_Memory_Options_Set:Finished.");
 #endif
 	return TRUE;
 }
 
 /**
- * Routine to add the current pixel values in the mono image to the current pixel values in the coadd image, 
- * increasing the pixels values in the coadd image appropriately.
+ * Set what sort of noise image (if any) to accumulate data for during an exposure.
+ * <ul>
+ * <li>We check the type parameter is a valid noise type.
+ * <li>We store the type in Buffer_Data.Noise_Type.
+ * <li>If type is DETECTOR_BUFFER_NOISE_TYPE_NONE, we call Buffer_Noise_Free to release the noise buffers.
+ * <li>Otherwise, if the image buffers are currently allocated (Mono_Image is not NULL), we call Buffer_Noise_Allocate
+ *     to allocate the noise buffers (if they are not already allocated).
+ * </ul>
+ * Enabling a noise image adds a 64 bit sum of squares accumulator to Detector_Buffer_Add_Mono_To_Coadd_Image.
+ * @param type The type of noise image to accumulate, of type DETECTOR_BUFFER_NOISE_TYPE.
  * @return The routine returns TRUE on success and FALSE on failure. 
  *         On failure, Buffer_Error_Number/Buffer_Error_String are set.
  * @see #Buffer_Data
  * @see #Buffer_Error_Number
  * @see #Buffer_Error_String
- * @see detector_general.html#Detector_General_Log
+ * @see #Buffer_Noise_Allocate
+ * @see #Buffer_Noise_Free
+ * @see #DETECTOR_BUFFER_NOISE_TYPE
+ * @see #DETECTOR_BUFFER_IS_NOISE_TYPE
+ * @see detector_general.html#Detector_General_Log_Format
  */
-int Detector_Buffer_Add_Mono_To_Coadd_Image(void)
+int Detector_Buffer_Noise_Type_Set(enum DETECTOR_BUFFER_NOISE_TYPE type)
 {
-	int i,pixel_count;
-	
+	Buffer_Error_Number = 0;
 #if LOGGING > 1
-	Detector_General_Log(LOG_VERBOSITY_INTERMEDIATE,"Detector_Buffer_Add_Mono_To_Coadd_Image:Started.");
+	Detector_General_Log_Format(LOG_VERBOSITY_INTERMEDIATE,"Detector_Buffer_Noise_Type_Set(type = %d):Started.",type);
 #endif
-	if(Buffer_Data.Mono_Image == NULL)
+	if(!DETECTOR_BUFFER_IS_NOISE_TYPE(type))
 	{
-		Buffer_Error_Number = 7;
-		sprintf(Buffer_Error_String,"Detector_Buffer_Add_Mono_To_Coadd_Image:Mono Image was NULL.");
+		Buffer_Error_Number = 14;
+		sprintf(Buffer_Error_String,"Detector_Buffer_Noise_Type_Set:Illegal noise type (%d).",type);
 		return FALSE;
 	}
-	if(Buffer_Data.Coadd_Image == NULL)
+	Buffer_Data.Noise_Type = type;
+	if(Buffer_Data.Noise_Type == DETECTOR_BUFFER_NOISE_TYPE_NONE)
+		Buffer_Noise_Free();
+	else if(Buffer_Data.Mono_Image != NULL)
 	{
-		Buffer_Error_Number = 8;
-		sprintf(Buffer_Error_String,"Detector_Buffer_Add_Mono_To_Coadd_Image:Coadd Image was NULL.");
+		if(!Buffer_Noise_Allocate())
+			return FALSE;
+	}
+#if LOGGING > 1
+	Detector_General_Log(LOG_VERBOSITY_INTERMEDIATE,"Detector_Buffer_Noise_Type_Set:Finished.");
+#endif
+	return TRUE;
+}
+
+/**
+ * Return what sort of noise image (if any) we are accumulating data for.
+ * @return The current noise type, of type DETECTOR_BUFFER_NOISE_TYPE.
+ * @see #Buffer_Data
+ * @see #DETECTOR_BUFFER_NOISE_TYPE
+ */
+enum DETECTOR_BUFFER_NOISE_TYPE Detector_Buffer_Noise_Type_Get(void)
+{
+	return Buffer_Data.Noise_Type;
+}
+
+/**
+ * Return which width of accumulator was selected for the current / last set of coadds, 
+ * by Detector_Buffer_Initialise_Coadd_Image.
+ * @return The accumulator width, of type DETECTOR_BUFFER_ACCUMULATOR.
+ * @see #Buffer_Data
+ * @see #Detector_Buffer_Initialise_Coadd_Image
+ * @see #DETECTOR_BUFFER_ACCUMULATOR
+ */
+enum DETECTOR_BUFFER_ACCUMULATOR Detector_Buffer_Accumulator_Get(void)
+{
+	return Buffer_Data.Accumulator;
+}
+
+/**
+ * Set how many rows of each coadd are read out of the frame grabber at a time.
+ * <ul>
+ * <li>We check the row_count parameter is not negative.
+ * <li>We free any existing strip buffer by calling Buffer_Strip_Free, and store the row_count in 
+ *     Buffer_Data.Strip_Row_Count.
+ * <li>If row_count is greater than 0, and the image buffers have already been allocated, 
+ *     we call Buffer_Strip_Allocate to allocate a strip buffer of the new size.
+ * </ul>
+ * Reading out in strips lets each strip be added to the coadd image (Detector_Buffer_Add_Strip_To_Coadd_Image)
+ * while it is still in cache, rather than writing the whole frame to Mono_Image and reading it back again.
+ * @param row_count The number of rows in each strip. 0 means each coadd is read out whole into the mono image.
+ * @return The routine returns TRUE on success and FALSE on failure. 
+ *         On failure, Buffer_Error_Number/Buffer_Error_String are set.
+ * @see #Buffer_Data
+ * @see #Buffer_Error_Number
+ * @see #Buffer_Error_String
+ * @see #Buffer_Strip_Allocate
+ * @see #Buffer_Strip_Free
+ * @see #Detector_Buffer_Add_Strip_To_Coadd_Image
+ * @see detector_general.html#Detector_General_Log_Format
+ */
+int Detector_Buffer_Strip_Row_Count_Set(int row_count)
+{
+	Buffer_Error_Number = 0;
+#if LOGGING > 1
+	Detector_General_Log_Format(LOG_VERBOSITY_INTERMEDIATE,
+				    "Detector_Buffer_Strip_Row_Count_Set(row_count = %d):Started.",row_count);
+#endif
+	if(row_count < 0)
+	{
+		Buffer_Error_Number = 42;
+		sprintf(Buffer_Error_String,"Detector_Buffer_Strip_Row_Count_Set:Illegal row count (%d).",row_count);
 		return FALSE;
 	}
-	pixel_count = Buffer_Data.Size_X*Buffer_Data.Size_Y;
-	for(i=0; i < pixel_count; i++)
+	Buffer_Strip_Free();
+	Buffer_Data.Strip_Row_Count = row_count;
+	if((Buffer_Data.Strip_Row_Count > 0)&&(Buffer_Data.Mono_Image != NULL))
 	{
-		Buffer_Data.Coadd_Image[i] += Buffer_Data.Mono_Image[i];
+		if(!Buffer_Strip_Allocate())
+			return FALSE;
 	}
 #if LOGGING > 1
-	Detector_General_Log(LOG_VERBOSITY_INTERMEDIATE,"Detector_Buffer_Add_Mono_To_Coadd_Image:Finished.");
+	Detector_General_Log(LOG_VERBOSITY_INTERMEDIATE,"Detector_Buffer_Strip_Row_Count_Set:Finished.");
 #endif
 	return TRUE;
 }
 
 /**
- * Flip the coadd image data in the X direction.
+ * Return how many rows of each coadd are read out of the frame grabber at a time.
+ * @return The number of rows in each strip, or 0 if each coadd is read out whole into the mono image.
  * @see #Buffer_Data
+ */
+int Detector_Buffer_Strip_Row_Count_Get(void)
+{
+	return Buffer_Data.Strip_Row_Count;
+}
+
+/**
+ * Start a pool of persistent worker threads, used to split the pixel kernels (coadd add, flip, mean and noise image)
+ * into row bands. The threads are created once here, and woken for each kernel, rather than being created per call.
+ * <ul>
+ * <li>We check the thread_count is in the range 1..DETECTOR_BUFFER_MAX_THREAD_COUNT, and the core list is sensible.
+ * <li>If a pool is already running, we stop it by calling Detector_Buffer_Thread_Pool_Stop.
+ * <li>For each worker thread (thread_count-1 of them, the calling thread processes band 0), we:
+ *     <ul>
+ *     <li>Allocate a histogram for the worker's band of the mean image statistics.
+ *     <li>Create the thread, running Buffer_Thread_Worker.
+ *     <li>If a core list was specified, pin the thread to core_list[(worker-1) % core_count] 
+ *         using pthread_setaffinity_np.
+ *     </ul>
+ * </ul>
+ * The pool should only be started / stopped when no exposure is in progress.
+ * @param thread_count The total number of threads to split each kernel over, including the calling thread. 
+ *        1 means the kernels run on the calling thread only.
+ * @param core_list An array of CPU core numbers to pin the worker threads to, or NULL if the workers 
+ *        should not be pinned.
+ * @param core_count The number of cores in core_list. If this is 0, the workers are not pinned.
+ * @return The routine returns TRUE on success and FALSE on failure. 
+ *         On failure, Buffer_Error_Number/Buffer_Error_String are set.
+ * @see #Buffer_Thread_Data
+ * @see #Buffer_Band_Statistics
+ * @see #Buffer_Thread_Worker
  * @see #Buffer_Error_Number
  * @see #Buffer_Error_String
- * @see detector_general.html#Detector_General_Log
+ * @see #Detector_Buffer_Thread_Pool_Stop
+ * @see #DETECTOR_BUFFER_MAX_THREAD_COUNT
+ * @see detector_general.html#Detector_General_Log_Format
  */
-void Detector_Buffer_Coadd_Flip_X(void)
+int Detector_Buffer_Thread_Pool_Start(int thread_count,int *core_list,int core_count)
 {
-	int x,y;
-        int tempval;
+	cpu_set_t cpu_set;
+	int i,retval;
 
-#if LOGGING > 5
-	Detector_General_Log(LOG_VERBOSITY_INTERMEDIATE,
-			     "Detector_Buffer_Coadd_Flip_X:Started flipping coadd image in X.");
+	Buffer_Error_Number = 0;
+#if LOGGING > 1
+	Detector_General_Log_Format(LOG_VERBOSITY_INTERMEDIATE,
+				    "Detector_Buffer_Thread_Pool_Start(thread_count = %d,core_count = %d):Started.",
+				    thread_count,core_count);
 #endif
-	if(Buffer_Data.Coadd_Image == NULL)
+	if((thread_count < 1)||(thread_count > DETECTOR_BUFFER_MAX_THREAD_COUNT))
 	{
-		Buffer_Error_Number = 12;
-		sprintf(Buffer_Error_String,"Detector_Buffer_Coadd_Flip_X:Coadd Image was NULL.");
-		Detector_General_Error();
-		return;
+		Buffer_Error_Number = 32;
+		sprintf(Buffer_Error_String,"Detector_Buffer_Thread_Pool_Start:Thread count %d out of range (1..%d).",
+			thread_count,DETECTOR_BUFFER_MAX_THREAD_COUNT);
+		return FALSE;
 	}
-	/* for each row */
-	for(y=0;y<Buffer_Data.Size_Y;y++)
+	if((core_count < 0)||((core_count > 0)&&(core_list == NULL)))
 	{
-		/* for the first half of the columns.
-		** Note the middle column will be missed, this is OK as it
-		** does not need to be flipped if it is in the middle */
-		for(x=0;x<(Buffer_Data.Size_X/2);x++)
+		Buffer_Error_Number = 33;
+		sprintf(Buffer_Error_String,"Detector_Buffer_Thread_Pool_Start:Illegal core list (%p,%d).",
+			(void*)core_list,core_count);
+		return FALSE;
+	}
+	/* stop any previous pool */
+	if(!Detector_Buffer_Thread_Pool_Stop())
+		return FALSE;
+	Buffer_Thread_Data.Start_Generation = Buffer_Thread_Data.Generation;
+	for(i = 1; i < thread_count; i++)
+	{
+		Buffer_Band_Statistics[i].Histogram = (unsigned int *)malloc(DETECTOR_BUFFER_HISTOGRAM_BIN_COUNT*
+									      sizeof(unsigned int));
+		if(Buffer_Band_Statistics[i].Histogram == NULL)
+		{
+			Detector_Buffer_Thread_Pool_Stop();
+			Buffer_Error_Number = 34;
+			sprintf(Buffer_Error_String,"Detector_Buffer_Thread_Pool_Start:Failed to allocate histogram %d.",i);
+			return FALSE;
+		}
+		if(core_count > 0)
+			Buffer_Thread_Data.Core_List[i] = core_list[(i-1)%core_count];
+		else
+			Buffer_Thread_Data.Core_List[i] = -1;
+		retval = pthread_create(&(Buffer_Thread_Data.Thread_List[i]),NULL,Buffer_Thread_Worker,(void*)(intptr_t)i);
+		if(retval != 0)
+		{
+			free(Buffer_Band_Statistics[i].Histogram);
+			Buffer_Band_Statistics[i].Histogram = NULL;
+			Detector_Buffer_Thread_Pool_Stop();
+			Buffer_Error_Number = 35;
+			sprintf(Buffer_Error_String,"Detector_Buffer_Thread_Pool_Start:Failed to create thread %d (%d).",
+				i,retval);
+			return FALSE;
+		}
+		/* the thread is running, so the pool now has one more thread to stop */
+		Buffer_Thread_Data.Thread_Count = i+1;
+		if(Buffer_Thread_Data.Core_List[i] >= 0)
 		{
-			/* Copy Buffer_Data.Coadd_Image[x,y] to tempval */
-			tempval = *(Buffer_Data.Coadd_Image+(y*Buffer_Data.Size_X)+x);
-			/* Copy Buffer_Data.Coadd_Image[Buffer_Data.Size_X-(x+1),y] to Buffer_Data.Coadd_Image[x,y] */
-			*(Buffer_Data.Coadd_Image+(y*Buffer_Data.Size_X)+x) = *(Buffer_Data.Coadd_Image+
-			       (y*Buffer_Data.Size_X)+(Buffer_Data.Size_X-(x+1)));
-			/* Copy tempval to Buffer_Data.Coadd_Image[Buffer_Data.Size_X-(x+1),y] */
-			*(Buffer_Data.Coadd_Image+(y*Buffer_Data.Size_X)+(Buffer_Data.Size_X-(x+1))) = tempval;
+			CPU_ZERO(&cpu_set);
+			CPU_SET(Buffer_Thread_Data.Core_List[i],&cpu_set);
+			retval = pthread_setaffinity_np(Buffer_Thread_Data.Thread_List[i],sizeof(cpu_set_t),&cpu_set);
+			if(retval != 0)
+			{
+				Detector_Buffer_Thread_Pool_Stop();
+				Buffer_Error_Number = 36;
+				sprintf(Buffer_Error_String,"Detector_Buffer_Thread_Pool_Start:"
+					"Failed to pin thread %d to core %d (%d).",i,core_list[(i-1)%core_count],retval);
+				return FALSE;
+			}
 		}
 	}
-#if LOGGING > 5
-	Detector_General_Log(LOG_VERBOSITY_INTERMEDIATE,"Detector_Buffer_Coadd_Flip_X:Finished.");
+#if LOGGING > 1
+	Detector_General_Log_Format(LOG_VERBOSITY_TERSE,
+				    "Detector_Buffer_Thread_Pool_Start:Pixel kernels will be split over %d threads.",
+				    Buffer_Thread_Data.Thread_Count);
+#endif
+	return TRUE;
+}
+
+/**
+ * Stop the pool of worker threads started by Detector_Buffer_Thread_Pool_Start, if one is running.
+ * We set Buffer_Thread_Data.Quit and broadcast the start condition to wake the workers, join each worker thread,
+ * and free the band histograms. Afterwards the pixel kernels run on the calling thread only.
+ * @return The routine returns TRUE on success and FALSE on failure. 
+ *         On failure, Buffer_Error_Number/Buffer_Error_String are set.
+ * @see #Buffer_Thread_Data
+ * @see #Buffer_Band_Statistics
+ * @see #Buffer_Error_Number
+ * @see #Buffer_Error_String
+ * @see #Detector_Buffer_Thread_Pool_Start
+ */
+int Detector_Buffer_Thread_Pool_Stop(void)
+{
+	int i,retval;
+
+	if(Buffer_Thread_Data.Thread_Count <= 1)
+		return TRUE;
+	retval = pthread_mutex_lock(&(Buffer_Thread_Data.Mutex));
+	if(retval != 0)
+	{
+		Buffer_Error_Number = 37;
+		sprintf(Buffer_Error_String,"Detector_Buffer_Thread_Pool_Stop:Failed to lock pool mutex (%d).",retval);
+		return FALSE;
+	}
+	Buffer_Thread_Data.Quit = TRUE;
+	pthread_cond_broadcast(&(Buffer_Thread_Data.Start_Condition));
+	pthread_mutex_unlock(&(Buffer_Thread_Data.Mutex));
+	for(i = 1; i < Buffer_Thread_Data.Thread_Count; i++)
+	{
+		pthread_join(Buffer_Thread_Data.Thread_List[i],NULL);
+		if(Buffer_Band_Statistics[i].Histogram != NULL)
+			free(Buffer_Band_Statistics[i].Histogram);
+		Buffer_Band_Statistics[i].Histogram = NULL;
+	}
+	Buffer_Thread_Data.Thread_Count = 1;
+	Buffer_Thread_Data.Quit = FALSE;
+#if LOGGING > 1
+	Detector_General_Log(LOG_VERBOSITY_INTERMEDIATE,"Detector_Buffer_Thread_Pool_Stop:Finished.");
 #endif
+	return TRUE;
+}
+
+/**
+ * Return the number of threads the pixel kernels are split over, including the calling thread.
+ * @return The number of threads.
+ * @see #Buffer_Thread_Data
+ */
+int Detector_Buffer_Thread_Count_Get(void)
+{
+	return Buffer_Thread_Data.Thread_Count;
 }
 
 /**
- * Flip the coadd image data in the Y direction.
+ * Select the coadd accumulator width for the specified number of coadds, and initialise the selected
+ * coadd image buffer pixels to 0.
+ * <ul>
+ * <li>We check the coadd_count is at least 1.
+ * <li>If coadd_count multiplied by DETECTOR_BUFFER_ADC_MAXIMUM could overflow a 32 bit integer, we select
+ *     a 64 bit accumulator (DETECTOR_BUFFER_ACCUMULATOR_64), and allocate Buffer_Data.Coadd_Image_64 
+ *     if it has not already been allocated. Otherwise we select a 32 bit accumulator 
+ *     (DETECTOR_BUFFER_ACCUMULATOR_32), which uses Buffer_Data.Coadd_Image.
+ * <li>We set the selected coadd image buffer pixels to 0.
+ * <li>If we are accumulating a noise image, the coadd squared image buffer pixels are also initialised to 0.
+ * </ul>
+ * @param coadd_count The number of coadds that will be added into the coadd image.
+ * @return The routine returns TRUE on success and FALSE on failure. 
+ *         On failure, Buffer_Error_Number/Buffer_Error_String are set.
  * @see #Buffer_Data
  * @see #Buffer_Error_Number
  * @see #Buffer_Error_String
+ * @see #DETECTOR_BUFFER_ADC_MAXIMUM
+ * @see #DETECTOR_BUFFER_ACCUMULATOR
  * @see detector_general.html#Detector_General_Log
+ * @see detector_general.html#Detector_General_Log_Format
  */
-void Detector_Buffer_Coadd_Flip_Y(void)
+int Detector_Buffer_Initialise_Coadd_Image(int coadd_count)
 {
-	int x,y;
-        int tempval;
-
-#if LOGGING > 5
+	int pixel_count;
+	
+#if LOGGING > 1
 	Detector_General_Log_Format(LOG_VERBOSITY_INTERMEDIATE,
-				    "Detector_Buffer_Coadd_Flip_Y:Started flipping coadd image in Y.");
+				    "Detector_Buffer_Initialise_Coadd_Image(coadd_count = %d):Started.",coadd_count);
 #endif
+	if(coadd_count < 1)
+	{
+		Buffer_Error_Number = 27;
+		sprintf(Buffer_Error_String,"Detector_Buffer_Initialise_Coadd_Image:number of coadds too small (%d).",
+			coadd_count);
+		return FALSE;
+	}
 	if(Buffer_Data.Coadd_Image == NULL)
 	{
-		Buffer_Error_Number = 13;
-		sprintf(Buffer_Error_String,"Detector_Buffer_Coadd_Flip_Y:Coadd Image was NULL.");
-		Detector_General_Error();
-		return;
+		Buffer_Error_Number = 6;
+		sprintf(Buffer_Error_String,"Detector_Buffer_Initialise_Coadd_Image:Coadd Image was NULL.");
+		return FALSE;
 	}
-	/* for the first half of the rows.
-	** Note the middle row will be missed, this is OK as it
-	** does not need to be flipped if it is in the middle */
-	for(y=0;y<(Buffer_Data.Size_Y/2);y++)
+	pixel_count = Buffer_Data.Size_X*Buffer_Data.Size_Y;
+	/* select the accumulator width */
+	if((((long long)coadd_count)*((long long)DETECTOR_BUFFER_ADC_MAXIMUM)) > ((long long)INT_MAX))
 	{
-		/* for each column */
-		for(x=0;x<Buffer_Data.Size_X;x++)
+		if(Buffer_Data.Coadd_Image_64 == NULL)
 		{
-			/* Copy Buffer_Data.Coadd_Image[x,y] to tempval */
-			tempval = *(Buffer_Data.Coadd_Image+(y*Buffer_Data.Size_X)+x);
-			/* Copy Buffer_Data.Coadd_Image[x,Buffer_Data.Size_Y-(y+1)] to Buffer_Data.Coadd_Image[x,y] */
-			*(Buffer_Data.Coadd_Image+(y*Buffer_Data.Size_X)+x) = *(Buffer_Data.Coadd_Image+
-				     (((Buffer_Data.Size_Y-(y+1))*Buffer_Data.Size_X)+x));
-			/* Copy tempval to Buffer_Data.Coadd_Image[x,Buffer_Data.Size_Y-(y+1)] */
-			*(Buffer_Data.Coadd_Image+(((Buffer_Data.Size_Y-(y+1))*Buffer_Data.Size_X)+x)) = tempval;
+			Buffer_Data.Coadd_Image_64 = (long long *)Buffer_Image_Allocate(pixel_count*sizeof(long long));
+			if(Buffer_Data.Coadd_Image_64 == NULL)
+			{
+				Buffer_Error_Number = 28;
+				sprintf(Buffer_Error_String,"Detector_Buffer_Initialise_Coadd_Image:"
+					"Failed to allocate Coadd_Image_64 (%d,%d).",Buffer_Data.Size_X,Buffer_Data.Size_Y);
+				return FALSE;
+			}
 		}
+		Buffer_Data.Accumulator = DETECTOR_BUFFER_ACCUMULATOR_64;
+		memset(Buffer_Data.Coadd_Image_64,0,pixel_count*sizeof(long long));
 	}
-#if LOGGING > 5
-	Detector_General_Log(LOG_VERBOSITY_INTERMEDIATE,"Detector_Buffer_Coadd_Flip_Y:Finished.");
+	else
+	{
+		Buffer_Data.Accumulator = DETECTOR_BUFFER_ACCUMULATOR_32;
+		memset(Buffer_Data.Coadd_Image,0,pixel_count*sizeof(int));
+	}
+#if LOGGING > 1
+	Detector_General_Log_Format(LOG_VERBOSITY_INTERMEDIATE,"Detector_Buffer_Initialise_Coadd_Image:"
+				    "Using a %d bit accumulator for %d coadds.",Buffer_Data.Accumulator,coadd_count);
+#endif
+	if(Buffer_Data.Noise_Type != DETECTOR_BUFFER_NOISE_TYPE_NONE)
+	{
+		if(Buffer_Data.Coadd_Squared_Image == NULL)
+		{
+			Buffer_Error_Number = 15;
+			sprintf(Buffer_Error_String,"Detector_Buffer_Initialise_Coadd_Image:Coadd Squared Image was NULL.");
+			return FALSE;
+		}
+		memset(Buffer_Data.Coadd_Squared_Image,0,pixel_count*sizeof(long long));
+	}
+#if LOGGING > 1
+	Detector_General_Log(LOG_VERBOSITY_INTERMEDIATE,"Detector_Buffer_Initialise_Coadd_Image:Finished.");
 #endif
+	return TRUE;
 }
 
 /**
- * This routine creates a mean image of the coadd image, by taking each coadd pixel value and dividing
- * it by the number of coadds used to create the Coadd_Image.
- * @param coadds The number of coadds in the Coadd_Image.
+ * Routine to add the current pixel values in the mono image to the current pixel values in the coadd image, 
+ * increasing the pixels values in the coadd image appropriately. The coadd image used is the 32 bit
+ * Coadd_Image or the 64 bit Coadd_Image_64, depending on the accumulator selected by 
+ * Detector_Buffer_Initialise_Coadd_Image. If we are accumulating a noise image,
+ * the square of each mono image pixel value is also added to the coadd squared image. 
+ * The work is split into row bands over the worker thread pool by Buffer_Thread_Run, and done by Buffer_Add_Kernel.
  * @return The routine returns TRUE on success and FALSE on failure. 
  *         On failure, Buffer_Error_Number/Buffer_Error_String are set.
  * @see #Buffer_Data
  * @see #Buffer_Error_Number
  * @see #Buffer_Error_String
+ * @see #Buffer_Thread_Run
+ * @see #Buffer_Add_Kernel
  * @see detector_general.html#Detector_General_Log
  */
-int Detector_Buffer_Create_Mean_Image(int coadds)
+int Detector_Buffer_Add_Mono_To_Coadd_Image(void)
 {
-	int i,pixel_count;
-	
+
 #if LOGGING > 1
-	Detector_General_Log(LOG_VERBOSITY_INTERMEDIATE,"Detector_Buffer_Create_Mean_Image:Started.");
+	Detector_General_Log(LOG_VERBOSITY_INTERMEDIATE,"Detector_Buffer_Add_Mono_To_Coadd_Image:Started.");
 #endif
-	if(coadds < 1)
+	if(Buffer_Data.Mono_Image == NULL)
 	{
-		Buffer_Error_Number = 9;
-		sprintf(Buffer_Error_String,"Detector_Buffer_Create_Mean_Image:number of coadds too small (%d).",
-			coadds);
+		Buffer_Error_Number = 7;
+		sprintf(Buffer_Error_String,"Detector_Buffer_Add_Mono_To_Coadd_Image:Mono Image was NULL.");
 		return FALSE;
 	}
 	if(Buffer_Data.Coadd_Image == NULL)
 	{
-		Buffer_Error_Number = 10;
-		sprintf(Buffer_Error_String,"Detector_Buffer_Create_Mean_Image:Coadd Image was NULL.");
+		Buffer_Error_Number = 8;
+		sprintf(Buffer_Error_String,"Detector_Buffer_Add_Mono_To_Coadd_Image:Coadd Image was NULL.");
 		return FALSE;
 	}
-	if(Buffer_Data.Mean_Image == NULL)
+	if((Buffer_Data.Accumulator == DETECTOR_BUFFER_ACCUMULATOR_64)&&(Buffer_Data.Coadd_Image_64 == NULL))
 	{
-		Buffer_Error_Number = 11;
-		sprintf(Buffer_Error_String,"Detector_Buffer_Create_Mean_Image:Mean Image was NULL.");
+		Buffer_Error_Number = 29;
+		sprintf(Buffer_Error_String,"Detector_Buffer_Add_Mono_To_Coadd_Image:Coadd Image 64 was NULL.");
 		return FALSE;
 	}
-	pixel_count = Buffer_Data.Size_X*Buffer_Data.Size_Y;
-	for(i=0; i < pixel_count; i++)
+	if((Buffer_Data.Noise_Type != DETECTOR_BUFFER_NOISE_TYPE_NONE)&&(Buffer_Data.Coadd_Squared_Image == NULL))
 	{
-		Buffer_Data.Mean_Image[i] = ((double)Buffer_Data.Coadd_Image[i])/coadds;
+		Buffer_Error_Number = 16;
+		sprintf(Buffer_Error_String,"Detector_Buffer_Add_Mono_To_Coadd_Image:Coadd Squared Image was NULL.");
+		return FALSE;
 	}
+	if(!Buffer_Thread_Run(Buffer_Add_Kernel,Buffer_Data.Size_Y))
+		return FALSE;
 #if LOGGING > 1
-	Detector_General_Log(LOG_VERBOSITY_INTERMEDIATE,"Detector_Buffer_Create_Mean_Image:Finished.");
+	Detector_General_Log(LOG_VERBOSITY_INTERMEDIATE,"Detector_Buffer_Add_Mono_To_Coadd_Image:Finished.");
 #endif
 	return TRUE;
 }
 
 /**
- * Return a pointer to the previously allocated unsigned short image buffer. Detector_Buffer_Allocate should have
- * been called previously to allocate memory for this buffer.
+ * Routine to add the pixel values in the strip image to the specified rows of the coadd image, 
+ * (and their squares to the coadd squared image, if we are accumulating a noise image). This is used
+ * instead of Detector_Buffer_Add_Mono_To_Coadd_Image when each coadd is read out in strips 
+ * (Detector_Buffer_Strip_Row_Count_Set), so each strip is accumulated while it is still in cache.
+ * The strip is added on the calling thread by Buffer_Add_Pixels, a strip is too small to be worth 
+ * splitting over the worker thread pool.
+ * @param start_row The row in the coadd image the first row of the strip image corresponds to.
+ * @param row_count The number of rows in the strip image to add, between 1 and Strip_Row_Count 
+ *        (the last strip of a frame can be shorter).
+ * @return The routine returns TRUE on success and FALSE on failure. 
+ *         On failure, Buffer_Error_Number/Buffer_Error_String are set.
+ * @see #Buffer_Data
+ * @see #Buffer_Error_Number
+ * @see #Buffer_Error_String
+ * @see #Buffer_Add_Pixels
+ * @see #Detector_Buffer_Strip_Row_Count_Set
+ * @see #Detector_Buffer_Get_Strip_Image
+ */
+int Detector_Buffer_Add_Strip_To_Coadd_Image(int start_row,int row_count)
+{
+	if(Buffer_Data.Strip_Image == NULL)
+	{
+		Buffer_Error_Number = 43;
+		sprintf(Buffer_Error_String,"Detector_Buffer_Add_Strip_To_Coadd_Image:Strip Image was NULL.");
+		return FALSE;
+	}
+	if((start_row < 0)||(row_count < 1)||(row_count > Buffer_Data.Strip_Row_Count)||
+	   ((start_row+row_count) > Buffer_Data.Size_Y))
+	{
+		Buffer_Error_Number = 44;
+		sprintf(Buffer_Error_String,
+			"Detector_Buffer_Add_Strip_To_Coadd_Image:Illegal strip (start row %d, row count %d).",
+			start_row,row_count);
+		return FALSE;
+	}
+	if(Buffer_Data.Coadd_Image == NULL)
+	{
+		Buffer_Error_Number = 45;
+		sprintf(Buffer_Error_String,"Detector_Buffer_Add_Strip_To_Coadd_Image:Coadd Image was NULL.");
+		return FALSE;
+	}
+	if((Buffer_Data.Accumulator == DETECTOR_BUFFER_ACCUMULATOR_64)&&(Buffer_Data.Coadd_Image_64 == NULL))
+	{
+		Buffer_Error_Number = 46;
+		sprintf(Buffer_Error_String,"Detector_Buffer_Add_Strip_To_Coadd_Image:Coadd Image 64 was NULL.");
+		return FALSE;
+	}
+	if((Buffer_Data.Noise_Type != DETECTOR_BUFFER_NOISE_TYPE_NONE)&&(Buffer_Data.Coadd_Squared_Image == NULL))
+	{
+		Buffer_Error_Number = 47;
+		sprintf(Buffer_Error_String,"Detector_Buffer_Add_Strip_To_Coadd_Image:Coadd Squared Image was NULL.");
+		return FALSE;
+	}
+	Buffer_Add_Pixels(Buffer_Data.Strip_Image,start_row*Buffer_Data.Size_X,row_count*Buffer_Data.Size_X);
+	return TRUE;
+}
+
+/**
+ * Flip the coadd image data in the X direction. If a 64 bit accumulator was selected, Coadd_Image_64 is
+ * flipped instead of Coadd_Image. If we are accumulating a noise image, the coadd squared
+ * image is flipped as well. The work is split into row bands over the worker thread pool by Buffer_Thread_Run,
+ * and done by Buffer_Flip_X_Kernel.
+ * @see #Buffer_Data
+ * @see #Buffer_Error_Number
+ * @see #Buffer_Error_String
+ * @see #Buffer_Thread_Run
+ * @see #Buffer_Flip_X_Kernel
+ * @see detector_general.html#Detector_General_Log
+ */
+void Detector_Buffer_Coadd_Flip_X(void)
+{
+#if LOGGING > 5
+	Detector_General_Log(LOG_VERBOSITY_INTERMEDIATE,
+			     "Detector_Buffer_Coadd_Flip_X:Started flipping coadd image in X.");
+#endif
+	if(Buffer_Data.Coadd_Image == NULL)
+	{
+		Buffer_Error_Number = 12;
+		sprintf(Buffer_Error_String,"Detector_Buffer_Coadd_Flip_X:Coadd Image was NULL.");
+		Detector_General_Error();
+		return;
+	}
+	if(!Buffer_Thread_Run(Buffer_Flip_X_Kernel,Buffer_Data.Size_Y))
+	{
+		Detector_General_Error();
+		return;
+	}
+#if LOGGING > 5
+	Detector_General_Log(LOG_VERBOSITY_INTERMEDIATE,"Detector_Buffer_Coadd_Flip_X:Finished.");
+#endif
+}
+
+/**
+ * Flip the coadd image data in the Y direction. If a 64 bit accumulator was selected, Coadd_Image_64 is
+ * flipped instead of Coadd_Image. If we are accumulating a noise image, the coadd squared
+ * image is flipped as well. The work is split into row bands over the worker thread pool by Buffer_Thread_Run,
+ * and done by Buffer_Flip_Y_Kernel.
+ * @see #Buffer_Data
+ * @see #Buffer_Error_Number
+ * @see #Buffer_Error_String
+ * @see #Buffer_Thread_Run
+ * @see #Buffer_Flip_Y_Kernel
+ * @see detector_general.html#Detector_General_Log
+ */
+void Detector_Buffer_Coadd_Flip_Y(void)
+{
+#if LOGGING > 5
+	Detector_General_Log_Format(LOG_VERBOSITY_INTERMEDIATE,
+				    "Detector_Buffer_Coadd_Flip_Y:Started flipping coadd image in Y.");
+#endif
+	if(Buffer_Data.Coadd_Image == NULL)
+	{
+		Buffer_Error_Number = 13;
+		sprintf(Buffer_Error_String,"Detector_Buffer_Coadd_Flip_Y:Coadd Image was NULL.");
+		Detector_General_Error();
+		return;
+	}
+	/* only the first half of the rows are passed to the kernel, each is swapped with it's mirror row */
+	if(!Buffer_Thread_Run(Buffer_Flip_Y_Kernel,Buffer_Data.Size_Y/2))
+	{
+		Detector_General_Error();
+		return;
+	}
+#if LOGGING > 5
+	Detector_General_Log(LOG_VERBOSITY_INTERMEDIATE,"Detector_Buffer_Coadd_Flip_Y:Finished.");
+#endif
+}
+
+/**
+ * This routine creates a mean image of the coadd image, by taking each coadd pixel value and dividing
+ * it by the number of coadds used to create the Coadd_Image. In the same pass over the image we compute
+ * the minimum, maximum, mean and saturated pixel count of the mean image, and fill in a 16 bit histogram
+ * of it. The median is then estimated from the histogram. The results are stored in Buffer_Statistics,
+ * and can be retrieved using Detector_Buffer_Statistics_Get and Detector_Buffer_Histogram_Get. 
+ * Buffer_Statistics.Mutex is held whilst the statistics are computed, so these never return a partially computed set.
+ * The coadd image is read from Coadd_Image or Coadd_Image_64, depending on the selected accumulator.
+ * The work is split into row bands over the worker thread pool by Buffer_Thread_Run, and done by 
+ * Buffer_Mean_Kernel, which also computes the statistics of each band. The band statistics are then merged.
+ * @param coadds The number of coadds in the Coadd_Image.
+ * @return The routine returns TRUE on success and FALSE on failure. 
+ *         On failure, Buffer_Error_Number/Buffer_Error_String are set.
+ * @see #Buffer_Data
+ * @see #Buffer_Error_Number
+ * @see #Buffer_Error_String
+ * @see #Buffer_Statistics
+ * @see #Buffer_Band_Statistics
+ * @see #Buffer_Thread_Data
+ * @see #Buffer_Thread_Run
+ * @see #Buffer_Mean_Kernel
+ * @see #DETECTOR_BUFFER_HISTOGRAM_BIN_COUNT
+ * @see detector_general.html#Detector_General_Log
+ */
+int Detector_Buffer_Create_Mean_Image(int coadds)
+{
+	double minimum,maximum,sum;
+	int i,band,pixel_count,bin,saturated_count,cumulative_count;
+	
+#if LOGGING > 1
+	Detector_General_Log(LOG_VERBOSITY_INTERMEDIATE,"Detector_Buffer_Create_Mean_Image:Started.");
+#endif
+	if(coadds < 1)
+	{
+		Buffer_Error_Number = 9;
+		sprintf(Buffer_Error_String,"Detector_Buffer_Create_Mean_Image:number of coadds too small (%d).",
+			coadds);
+		return FALSE;
+	}
+	if(Buffer_Data.Coadd_Image == NULL)
+	{
+		Buffer_Error_Number = 10;
+		sprintf(Buffer_Error_String,"Detector_Buffer_Create_Mean_Image:Coadd Image was NULL.");
+		return FALSE;
+	}
+	if((Buffer_Data.Accumulator == DETECTOR_BUFFER_ACCUMULATOR_64)&&(Buffer_Data.Coadd_Image_64 == NULL))
+	{
+		Buffer_Error_Number = 30;
+		sprintf(Buffer_Error_String,"Detector_Buffer_Create_Mean_Image:Coadd Image 64 was NULL.");
+		return FALSE;
+	}
+	if(Buffer_Data.Mean_Image == NULL)
+	{
+		Buffer_Error_Number = 11;
+		sprintf(Buffer_Error_String,"Detector_Buffer_Create_Mean_Image:Mean Image was NULL.");
+		return FALSE;
+	}
+	pixel_count = Buffer_Data.Size_X*Buffer_Data.Size_Y;
+	pthread_mutex_lock(&(Buffer_Statistics.Mutex));
+	Buffer_Statistics.Is_Valid = FALSE;
+	/* create the mean image, and the partial statistics of each row band */
+	Buffer_Thread_Data.Coadds = coadds;
+	if(!Buffer_Thread_Run(Buffer_Mean_Kernel,Buffer_Data.Size_Y))
+	{
+		pthread_mutex_unlock(&(Buffer_Statistics.Mutex));
+		return FALSE;
+	}
+	/* merge the band statistics. Band 0's histogram is Buffer_Statistics.Histogram */
+	minimum = Buffer_Band_Statistics[0].Minimum;
+	maximum = Buffer_Band_Statistics[0].Maximum;
+	sum = Buffer_Band_Statistics[0].Sum;
+	saturated_count = Buffer_Band_Statistics[0].Saturated_Count;
+	for(band = 1; band < Buffer_Thread_Data.Thread_Count; band++)
+	{
+		if(Buffer_Band_Statistics[band].Minimum < minimum)
+			minimum = Buffer_Band_Statistics[band].Minimum;
+		if(Buffer_Band_Statistics[band].Maximum > maximum)
+			maximum = Buffer_Band_Statistics[band].Maximum;
+		sum += Buffer_Band_Statistics[band].Sum;
+		saturated_count += Buffer_Band_Statistics[band].Saturated_Count;
+		for(i = 0; i < DETECTOR_BUFFER_HISTOGRAM_BIN_COUNT; i++)
+		{
+			Buffer_Statistics.Histogram[i] += Buffer_Band_Statistics[band].Histogram[i];
+		}
+	}
+	/* estimate the median from the histogram */
+	cumulative_count = 0;
+	for(bin = 0; bin < DETECTOR_BUFFER_HISTOGRAM_BIN_COUNT; bin++)
+	{
+		cumulative_count += Buffer_Statistics.Histogram[bin];
+		if(cumulative_count >= ((pixel_count+1)/2))
+			break;
+	}
+	Buffer_Statistics.Minimum = minimum;
+	Buffer_Statistics.Maximum = maximum;
+	Buffer_Statistics.Mean = sum/((double)pixel_count);
+	Buffer_Statistics.Median = (double)bin;
+	Buffer_Statistics.Saturated_Count = saturated_count;
+	Buffer_Statistics.Is_Valid = TRUE;
+	pthread_mutex_unlock(&(Buffer_Statistics.Mutex));
+#if LOGGING > 1
+	Detector_General_Log_Format(LOG_VERBOSITY_INTERMEDIATE,"Detector_Buffer_Create_Mean_Image:"
+				    "Minimum = %.2f, Maximum = %.2f, Mean = %.2f, Median = %.2f, Saturated Count = %d.",
+				    minimum,maximum,sum/((double)pixel_count),(double)bin,saturated_count);
+	Detector_General_Log(LOG_VERBOSITY_INTERMEDIATE,"Detector_Buffer_Create_Mean_Image:Finished.");
+#endif
+	return TRUE;
+}
+
+/**
+ * This routine creates a noise image from the coadd image and coadd squared image. For each pixel
+ * the sample variance of the individual coadd readouts is computed as:
+ * (sum(x^2) - (sum(x)*mean))/(coadds-1). If Buffer_Data.Noise_Type is DETECTOR_BUFFER_NOISE_TYPE_STANDARD_ERROR,
+ * the standard error of the mean is returned instead: sqrt(variance/coadds).
+ * At least two coadds are needed to estimate the variance. The sum of the coadds is read from Coadd_Image 
+ * or Coadd_Image_64, depending on the selected accumulator. The work is split into row bands over the 
+ * worker thread pool by Buffer_Thread_Run, and done by Buffer_Noise_Kernel.
+ * @param coadds The number of coadds in the Coadd_Image / Coadd_Squared_Image.
+ * @return The routine returns TRUE on success and FALSE on failure. 
+ *         On failure, Buffer_Error_Number/Buffer_Error_String are set.
+ * @see #Buffer_Data
+ * @see #Buffer_Error_Number
+ * @see #Buffer_Error_String
+ * @see #Buffer_Thread_Data
+ * @see #Buffer_Thread_Run
+ * @see #Buffer_Noise_Kernel
+ * @see #DETECTOR_BUFFER_NOISE_TYPE
+ * @see detector_general.html#Detector_General_Log
+ */
+int Detector_Buffer_Create_Noise_Image(int coadds)
+{
+
+#if LOGGING > 1
+	Detector_General_Log(LOG_VERBOSITY_INTERMEDIATE,"Detector_Buffer_Create_Noise_Image:Started.");
+#endif
+	if(Buffer_Data.Noise_Type == DETECTOR_BUFFER_NOISE_TYPE_NONE)
+	{
+		Buffer_Error_Number = 17;
+		sprintf(Buffer_Error_String,"Detector_Buffer_Create_Noise_Image:No noise image is being accumulated.");
+		return FALSE;
+	}
+	if(coadds < 2)
+	{
+		Buffer_Error_Number = 18;
+		sprintf(Buffer_Error_String,"Detector_Buffer_Create_Noise_Image:number of coadds too small (%d).",
+			coadds);
+		return FALSE;
+	}
+	if(Buffer_Data.Coadd_Image == NULL)
+	{
+		Buffer_Error_Number = 19;
+		sprintf(Buffer_Error_String,"Detector_Buffer_Create_Noise_Image:Coadd Image was NULL.");
+		return FALSE;
+	}
+	if((Buffer_Data.Accumulator == DETECTOR_BUFFER_ACCUMULATOR_64)&&(Buffer_Data.Coadd_Image_64 == NULL))
+	{
+		Buffer_Error_Number = 31;
+		sprintf(Buffer_Error_String,"Detector_Buffer_Create_Noise_Image:Coadd Image 64 was NULL.");
+		return FALSE;
+	}
+	if(Buffer_Data.Coadd_Squared_Image == NULL)
+	{
+		Buffer_Error_Number = 20;
+		sprintf(Buffer_Error_String,"Detector_Buffer_Create_Noise_Image:Coadd Squared Image was NULL.");
+		return FALSE;
+	}
+	if(Buffer_Data.Noise_Image == NULL)
+	{
+		Buffer_Error_Number = 21;
+		sprintf(Buffer_Error_String,"Detector_Buffer_Create_Noise_Image:Noise Image was NULL.");
+		return FALSE;
+	}
+	Buffer_Thread_Data.Coadds = coadds;
+	if(!Buffer_Thread_Run(Buffer_Noise_Kernel,Buffer_Data.Size_Y))
+		return FALSE;
+#if LOGGING > 1
+	Detector_General_Log(LOG_VERBOSITY_INTERMEDIATE,"Detector_Buffer_Create_Noise_Image:Finished.");
+#endif
+	return TRUE;
+}
+
+/**
+ * Return a pointer to the previously allocated unsigned short image buffer. Detector_Buffer_Allocate should have
+ * been called previously to allocate memory for this buffer.
  * @return An unsigned short pointer to the previously allocated unsigned short image buffer.
  * @see #Buffer_Data
  */
@@ -424,6 +1302,18 @@ unsigned short* Detector_Buffer_Get_Mono_Image(void)
 	return Buffer_Data.Mono_Image;
 }
 
+/**
+ * Return a pointer to the strip image, that each readout strip is read into when coadds are read out in strips.
+ * @return A pointer to the strip image, of Detector_Buffer_Get_Size_X * Detector_Buffer_Strip_Row_Count_Get
+ *         pixels, or NULL if coadds are not being read out in strips.
+ * @see #Buffer_Data
+ * @see #Detector_Buffer_Strip_Row_Count_Set
+ */
+unsigned short* Detector_Buffer_Get_Strip_Image(void)
+{
+	return Buffer_Data.Strip_Image;
+}
+
 /**
  * Return a pointer to the previously allocated double floating point image buffer. Detector_Buffer_Allocate should have
  * been called previously to allocate memory for this buffer.
@@ -435,6 +1325,134 @@ double* Detector_Buffer_Get_Mean_Image(void)
 	return Buffer_Data.Mean_Image;
 }
 
+/**
+ * Return a pointer to the previously allocated double floating point noise image buffer. 
+ * This is only allocated when a noise type other than DETECTOR_BUFFER_NOISE_TYPE_NONE has been set
+ * (Detector_Buffer_Noise_Type_Set).
+ * @return A double pointer to the previously allocated noise image buffer, or NULL.
+ * @see #Buffer_Data
+ * @see #Detector_Buffer_Noise_Type_Set
+ */
+double* Detector_Buffer_Get_Noise_Image(void)
+{
+	return Buffer_Data.Noise_Image;
+}
+
+/**
+ * Set the mean pixel value at or above which a pixel is counted as saturated, when computing the 
+ * per-frame statistics in Detector_Buffer_Create_Mean_Image.
+ * @param saturation_level The saturation level, in the range 1..DETECTOR_BUFFER_HISTOGRAM_BIN_COUNT-1.
+ * @return The routine returns TRUE on success and FALSE on failure. 
+ *         On failure, Buffer_Error_Number/Buffer_Error_String are set.
+ * @see #Buffer_Statistics
+ * @see #Buffer_Error_Number
+ * @see #Buffer_Error_String
+ * @see #DETECTOR_BUFFER_HISTOGRAM_BIN_COUNT
+ * @see detector_general.html#Detector_General_Log_Format
+ */
+int Detector_Buffer_Saturation_Level_Set(int saturation_level)
+{
+	if((saturation_level < 1)||(saturation_level >= DETECTOR_BUFFER_HISTOGRAM_BIN_COUNT))
+	{
+		Buffer_Error_Number = 24;
+		sprintf(Buffer_Error_String,"Detector_Buffer_Saturation_Level_Set:Saturation level out of range (%d).",
+			saturation_level);
+		return FALSE;
+	}
+	Buffer_Statistics.Saturation_Level = saturation_level;
+#if LOGGING > 1
+	Detector_General_Log_Format(LOG_VERBOSITY_INTERMEDIATE,
+				    "Detector_Buffer_Saturation_Level_Set:Saturation level set to %d.",saturation_level);
+#endif
+	return TRUE;
+}
+
+/**
+ * Return the mean pixel value at or above which a pixel is counted as saturated.
+ * @return An integer, the saturation level.
+ * @see #Buffer_Statistics
+ */
+int Detector_Buffer_Saturation_Level_Get(void)
+{
+	return Buffer_Statistics.Saturation_Level;
+}
+
+/**
+ * Return the statistics of the last mean image created by Detector_Buffer_Create_Mean_Image. The statistics
+ * are copied with Buffer_Statistics.Mutex held, so they are all from the same mean image.
+ * @param minimum The address of a double, on return set to the minimum pixel value in the mean image.
+ * @param maximum The address of a double, on return set to the maximum pixel value in the mean image.
+ * @param mean The address of a double, on return set to the mean pixel value in the mean image.
+ * @param median The address of a double, on return set to an estimate of the median pixel value in the 
+ *        mean image (to the nearest whole count below).
+ * @param saturated_count The address of an integer, on return set to the number of pixels in the mean image 
+ *        that are at or above the saturation level.
+ * @return The routine returns TRUE on success and FALSE on failure. 
+ *         On failure, Buffer_Error_Number/Buffer_Error_String are set.
+ * @see #Buffer_Statistics
+ * @see #Buffer_Error_Number
+ * @see #Buffer_Error_String
+ * @see #Detector_Buffer_Create_Mean_Image
+ */
+int Detector_Buffer_Statistics_Get(double *minimum,double *maximum,double *mean,double *median,int *saturated_count)
+{
+	if((minimum == NULL)||(maximum == NULL)||(mean == NULL)||(median == NULL)||(saturated_count == NULL))
+	{
+		Buffer_Error_Number = 25;
+		sprintf(Buffer_Error_String,"Detector_Buffer_Statistics_Get:A parameter was NULL.");
+		return FALSE;
+	}
+	pthread_mutex_lock(&(Buffer_Statistics.Mutex));
+	if(Buffer_Statistics.Is_Valid == FALSE)
+	{
+		pthread_mutex_unlock(&(Buffer_Statistics.Mutex));
+		Buffer_Error_Number = 26;
+		sprintf(Buffer_Error_String,"Detector_Buffer_Statistics_Get:No mean image statistics have been computed.");
+		return FALSE;
+	}
+	(*minimum) = Buffer_Statistics.Minimum;
+	(*maximum) = Buffer_Statistics.Maximum;
+	(*mean) = Buffer_Statistics.Mean;
+	(*median) = Buffer_Statistics.Median;
+	(*saturated_count) = Buffer_Statistics.Saturated_Count;
+	pthread_mutex_unlock(&(Buffer_Statistics.Mutex));
+	return TRUE;
+}
+
+/**
+ * Copy the 16 bit histogram of the last mean image created by Detector_Buffer_Create_Mean_Image. 
+ * The histogram is copied with Buffer_Statistics.Mutex held, so it is not changed by the next mean image whilst
+ * it is being copied.
+ * @param histogram An array of DETECTOR_BUFFER_HISTOGRAM_BIN_COUNT unsigned integers, on return filled in with 
+ *        the number of pixels with each pixel value.
+ * @return The routine returns TRUE on success and FALSE on failure. 
+ *         On failure, Buffer_Error_Number/Buffer_Error_String are set.
+ * @see #Buffer_Statistics
+ * @see #Buffer_Error_Number
+ * @see #Buffer_Error_String
+ * @see #DETECTOR_BUFFER_HISTOGRAM_BIN_COUNT
+ */
+int Detector_Buffer_Histogram_Get(unsigned int *histogram)
+{
+	if(histogram == NULL)
+	{
+		Buffer_Error_Number = 49;
+		sprintf(Buffer_Error_String,"Detector_Buffer_Histogram_Get:histogram was NULL.");
+		return FALSE;
+	}
+	pthread_mutex_lock(&(Buffer_Statistics.Mutex));
+	if(Buffer_Statistics.Is_Valid == FALSE)
+	{
+		pthread_mutex_unlock(&(Buffer_Statistics.Mutex));
+		Buffer_Error_Number = 50;
+		sprintf(Buffer_Error_String,"Detector_Buffer_Histogram_Get:No mean image statistics have been computed.");
+		return FALSE;
+	}
+	memcpy(histogram,Buffer_Statistics.Histogram,DETECTOR_BUFFER_HISTOGRAM_BIN_COUNT*sizeof(unsigned int));
+	pthread_mutex_unlock(&(Buffer_Statistics.Mutex));
+	return TRUE;
+}
+
 /**
  * Return the x size in pixels of the image buffers.
  * @return An integer, the number of pixels in x. 
@@ -521,3 +1539,607 @@ void Detector_Buffer_Error_String(char *error_string)
 /* =======================================
 **  internal functions 
 ** ======================================= */
+/**
+ * Allocate the buffers used to accumulate a noise image (Coadd_Squared_Image and Noise_Image), 
+ * if they are not already allocated. Buffer_Data.Size_X and Buffer_Data.Size_Y must already be set.
+ * @return The routine returns TRUE on success and FALSE on failure. 
+ *         On failure, Buffer_Error_Number/Buffer_Error_String are set.
+ * @see #Buffer_Data
+ * @see #Buffer_Error_Number
+ * @see #Buffer_Error_String
+ * @see #Buffer_Noise_Free
+ */
+static int Buffer_Noise_Allocate(void)
+{
+	if(Buffer_Data.Coadd_Squared_Image == NULL)
+	{
+		Buffer_Data.Coadd_Squared_Image = (long long *)Buffer_Image_Allocate(Buffer_Data.Size_X*
+									       Buffer_Data.Size_Y*sizeof(long long));
+		if(Buffer_Data.Coadd_Squared_Image == NULL)
+		{
+			Buffer_Error_Number = 22;
+			sprintf(Buffer_Error_String,
+				"Buffer_Noise_Allocate:Failed to allocate Coadd_Squared_Image (%d,%d).",
+				Buffer_Data.Size_X,Buffer_Data.Size_Y);
+			return FALSE;
+		}
+	}
+	if(Buffer_Data.Noise_Image == NULL)
+	{
+		Buffer_Data.Noise_Image = (double *)Buffer_Image_Allocate(Buffer_Data.Size_X*Buffer_Data.Size_Y*sizeof(double));
+		if(Buffer_Data.Noise_Image == NULL)
+		{
+			Buffer_Noise_Free();
+			Buffer_Error_Number = 23;
+			sprintf(Buffer_Error_String,"Buffer_Noise_Allocate:Failed to allocate Noise_Image (%d,%d).",
+				Buffer_Data.Size_X,Buffer_Data.Size_Y);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/**
+ * Free the buffers used to accumulate a noise image (Coadd_Squared_Image and Noise_Image), if they are allocated.
+ * @see #Buffer_Data
+ */
+static void Buffer_Noise_Free(void)
+{
+	if(Buffer_Data.Coadd_Squared_Image != NULL)
+		Buffer_Image_Free(Buffer_Data.Coadd_Squared_Image);
+	Buffer_Data.Coadd_Squared_Image = NULL;
+	if(Buffer_Data.Noise_Image != NULL)
+		Buffer_Image_Free(Buffer_Data.Noise_Image);
+	Buffer_Data.Noise_Image = NULL;
+}
+
+/**
+ * Allocate the strip image used when coadds are read out in strips, if it is not already allocated. 
+ * Buffer_Data.Size_X and Buffer_Data.Strip_Row_Count must already be set.
+ * @return The routine returns TRUE on success and FALSE on failure. 
+ *         On failure, Buffer_Error_Number/Buffer_Error_String are set.
+ * @see #Buffer_Data
+ * @see #Buffer_Error_Number
+ * @see #Buffer_Error_String
+ * @see #Buffer_Strip_Free
+ */
+static int Buffer_Strip_Allocate(void)
+{
+	if(Buffer_Data.Strip_Image == NULL)
+	{
+		Buffer_Data.Strip_Image = (unsigned short *)Buffer_Image_Allocate(Buffer_Data.Size_X*
+								  Buffer_Data.Strip_Row_Count*sizeof(unsigned short));
+		if(Buffer_Data.Strip_Image == NULL)
+		{
+			Buffer_Error_Number = 48;
+			sprintf(Buffer_Error_String,"Buffer_Strip_Allocate:Failed to allocate Strip_Image (%d,%d).",
+				Buffer_Data.Size_X,Buffer_Data.Strip_Row_Count);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/**
+ * Free the strip image used when coadds are read out in strips, if it is allocated.
+ * @see #Buffer_Data
+ */
+static void Buffer_Strip_Free(void)
+{
+	if(Buffer_Data.Strip_Image != NULL)
+		Buffer_Image_Free(Buffer_Data.Strip_Image);
+	Buffer_Data.Strip_Image = NULL;
+}
+
+/**
+ * Run a pixel kernel over the image, split into row bands over the worker thread pool.
+ * <ul>
+ * <li>If the pool has no worker threads (Buffer_Thread_Data.Thread_Count is 1), we just call the kernel 
+ *     over all the rows on the calling thread.
+ * <li>Otherwise we lock the pool mutex, set the kernel and row count, set the pending count to the number
+ *     of worker threads, increment the generation and broadcast the start condition to wake the workers.
+ * <li>The calling thread processes band 0 itself.
+ * <li>We then wait on the done condition until all the workers have finished their bands.
+ * </ul>
+ * Band N covers rows (row_count*N)/Thread_Count up to (but not including) (row_count*(N+1))/Thread_Count.
+ * @param kernel The kernel function to run, called with a band number and a range of rows.
+ * @param row_count The number of rows to split between the threads.
+ * @return The routine returns TRUE on success and FALSE on failure. 
+ *         On failure, Buffer_Error_Number/Buffer_Error_String are set.
+ * @see #Buffer_Thread_Data
+ * @see #Buffer_Thread_Worker
+ * @see #Buffer_Error_Number
+ * @see #Buffer_Error_String
+ */
+static int Buffer_Thread_Run(void (*kernel)(int band,int start_row,int end_row),int row_count)
+{
+	int retval;
+
+	if(Buffer_Thread_Data.Thread_Count <= 1)
+	{
+		kernel(0,0,row_count);
+		return TRUE;
+	}
+	retval = pthread_mutex_lock(&(Buffer_Thread_Data.Mutex));
+	if(retval != 0)
+	{
+		Buffer_Error_Number = 38;
+		sprintf(Buffer_Error_String,"Buffer_Thread_Run:Failed to lock pool mutex (%d).",retval);
+		return FALSE;
+	}
+	Buffer_Thread_Data.Kernel = kernel;
+	Buffer_Thread_Data.Row_Count = row_count;
+	Buffer_Thread_Data.Pending_Count = Buffer_Thread_Data.Thread_Count-1;
+	Buffer_Thread_Data.Generation++;
+	pthread_cond_broadcast(&(Buffer_Thread_Data.Start_Condition));
+	pthread_mutex_unlock(&(Buffer_Thread_Data.Mutex));
+	/* the calling thread processes band 0 */
+	kernel(0,0,row_count/Buffer_Thread_Data.Thread_Count);
+	/* wait for the workers to finish */
+	pthread_mutex_lock(&(Buffer_Thread_Data.Mutex));
+	while(Buffer_Thread_Data.Pending_Count > 0)
+		pthread_cond_wait(&(Buffer_Thread_Data.Done_Condition),&(Buffer_Thread_Data.Mutex));
+	pthread_mutex_unlock(&(Buffer_Thread_Data.Mutex));
+	return TRUE;
+}
+
+/**
+ * The worker thread function. Each worker waits on the start condition for a new kernel generation,
+ * runs the kernel over it's own row band, decrements the pending count, and signals the done condition
+ * when it is the last worker to finish. The worker exits when Buffer_Thread_Data.Quit is set.
+ * @param user_arg The worker's band number (1..Thread_Count-1), cast to a pointer.
+ * @return The routine always returns NULL.
+ * @see #Buffer_Thread_Data
+ * @see #Buffer_Thread_Run
+ */
+static void *Buffer_Thread_Worker(void *user_arg)
+{
+	void (*kernel)(int band,int start_row,int end_row);
+	unsigned int generation;
+	int band,row_count,thread_count;
+
+	band = (int)(intptr_t)user_arg;
+	pthread_mutex_lock(&(Buffer_Thread_Data.Mutex));
+	generation = Buffer_Thread_Data.Start_Generation;
+	while(TRUE)
+	{
+		while((Buffer_Thread_Data.Quit == FALSE)&&(Buffer_Thread_Data.Generation == generation))
+			pthread_cond_wait(&(Buffer_Thread_Data.Start_Condition),&(Buffer_Thread_Data.Mutex));
+		if(Buffer_Thread_Data.Quit)
+			break;
+		generation = Buffer_Thread_Data.Generation;
+		kernel = Buffer_Thread_Data.Kernel;
+		row_count = Buffer_Thread_Data.Row_Count;
+		thread_count = Buffer_Thread_Data.Thread_Count;
+		pthread_mutex_unlock(&(Buffer_Thread_Data.Mutex));
+		kernel(band,(row_count*band)/thread_count,(row_count*(band+1))/thread_count);
+		pthread_mutex_lock(&(Buffer_Thread_Data.Mutex));
+		Buffer_Thread_Data.Pending_Count--;
+		if(Buffer_Thread_Data.Pending_Count == 0)
+			pthread_cond_signal(&(Buffer_Thread_Data.Done_Condition));
+	}
+	pthread_mutex_unlock(&(Buffer_Thread_Data.Mutex));
+	return NULL;
+}
+
+/**
+ * Kernel to add the mono image to the coadd image over the specified rows, using Buffer_Add_Pixels.
+ * @param band The band number (unused).
+ * @param start_row The first row to process.
+ * @param end_row The row after the last row to process.
+ * @see #Buffer_Data
+ * @see #Buffer_Add_Pixels
+ * @see #Detector_Buffer_Add_Mono_To_Coadd_Image
+ */
+static void Buffer_Add_Kernel(int band,int start_row,int end_row)
+{
+	int start_pixel;
+
+	start_pixel = start_row*Buffer_Data.Size_X;
+	Buffer_Add_Pixels(Buffer_Data.Mono_Image+start_pixel,start_pixel,(end_row-start_row)*Buffer_Data.Size_X);
+}
+
+/**
+ * Add a run of pixels to the coadd image (32 or 64 bit, depending on the selected accumulator),
+ * and if we are accumulating a noise image, their squares to the coadd squared image. 
+ * The loops are written over local pointers with no per-pixel branches, so the compiler can vectorise them.
+ * @param image A pointer to the first pixel to add (in the mono image or the strip image).
+ * @param start_pixel The index of the coadd image pixel the first pixel is added to.
+ * @param pixel_count The number of pixels to add.
+ * @see #Buffer_Data
+ * @see #Buffer_Add_Kernel
+ * @see #Detector_Buffer_Add_Strip_To_Coadd_Image
+ */
+static void Buffer_Add_Pixels(unsigned short *image,int start_pixel,int pixel_count)
+{
+	int *coadd_image = NULL;
+	long long *coadd_image_64 = NULL;
+	long long *coadd_squared_image = NULL;
+	int i;
+
+	if(Buffer_Data.Accumulator == DETECTOR_BUFFER_ACCUMULATOR_64)
+	{
+		coadd_image_64 = Buffer_Data.Coadd_Image_64+start_pixel;
+		for(i=0; i < pixel_count; i++)
+		{
+			coadd_image_64[i] += image[i];
+		}
+	}
+	else
+	{
+		coadd_image = Buffer_Data.Coadd_Image+start_pixel;
+		for(i=0; i < pixel_count; i++)
+		{
+			coadd_image[i] += image[i];
+		}
+	}
+	if(Buffer_Data.Noise_Type != DETECTOR_BUFFER_NOISE_TYPE_NONE)
+	{
+		coadd_squared_image = Buffer_Data.Coadd_Squared_Image+start_pixel;
+		for(i=0; i < pixel_count; i++)
+		{
+			coadd_squared_image[i] += ((long long)image[i])*((long long)image[i]);
+		}
+	}
+}
+
+/**
+ * Kernel to flip the coadd image (and the coadd squared image, if allocated) in X, over the specified rows.
+ * @param band The band number (unused).
+ * @param start_row The first row to flip.
+ * @param end_row The row after the last row to flip.
+ * @see #Buffer_Data
+ * @see #Buffer_Flip_X_Long_Long
+ * @see #Detector_Buffer_Coadd_Flip_X
+ */
+static void Buffer_Flip_X_Kernel(int band,int start_row,int end_row)
+{
+	int x,y;
+        int tempval;
+
+	if(Buffer_Data.Accumulator == DETECTOR_BUFFER_ACCUMULATOR_64)
+		Buffer_Flip_X_Long_Long(Buffer_Data.Coadd_Image_64,start_row,end_row);
+	else
+	{
+		/* for each row */
+		for(y=start_row;y<end_row;y++)
+		{
+			/* for the first half of the columns.
+			** Note the middle column will be missed, this is OK as it
+			** does not need to be flipped if it is in the middle */
+			for(x=0;x<(Buffer_Data.Size_X/2);x++)
+			{
+				/* Copy Buffer_Data.Coadd_Image[x,y] to tempval */
+				tempval = *(Buffer_Data.Coadd_Image+(y*Buffer_Data.Size_X)+x);
+				/* Copy Buffer_Data.Coadd_Image[Buffer_Data.Size_X-(x+1),y] to Buffer_Data.Coadd_Image[x,y] */
+				*(Buffer_Data.Coadd_Image+(y*Buffer_Data.Size_X)+x) = *(Buffer_Data.Coadd_Image+
+				       (y*Buffer_Data.Size_X)+(Buffer_Data.Size_X-(x+1)));
+				/* Copy tempval to Buffer_Data.Coadd_Image[Buffer_Data.Size_X-(x+1),y] */
+				*(Buffer_Data.Coadd_Image+(y*Buffer_Data.Size_X)+(Buffer_Data.Size_X-(x+1))) = tempval;
+			}
+		}
+	}
+	/* flip the coadd squared image in the same way, if we are accumulating a noise image */
+	if(Buffer_Data.Coadd_Squared_Image != NULL)
+		Buffer_Flip_X_Long_Long(Buffer_Data.Coadd_Squared_Image,start_row,end_row);
+}
+
+/**
+ * Kernel to flip the coadd image (and the coadd squared image, if allocated) in Y. Each row in the specified
+ * range (which lies within the first half of the rows) is swapped with it's mirror row.
+ * @param band The band number (unused).
+ * @param start_row The first row to swap.
+ * @param end_row The row after the last row to swap.
+ * @see #Buffer_Data
+ * @see #Buffer_Flip_Y_Long_Long
+ * @see #Detector_Buffer_Coadd_Flip_Y
+ */
+static void Buffer_Flip_Y_Kernel(int band,int start_row,int end_row)
+{
+	int x,y;
+        int tempval;
+
+	if(Buffer_Data.Accumulator == DETECTOR_BUFFER_ACCUMULATOR_64)
+		Buffer_Flip_Y_Long_Long(Buffer_Data.Coadd_Image_64,start_row,end_row);
+	else
+	{
+		/* for the rows in this band (all within the first half of the rows) */
+		for(y=start_row;y<end_row;y++)
+		{
+			/* for each column */
+			for(x=0;x<Buffer_Data.Size_X;x++)
+			{
+				/* Copy Buffer_Data.Coadd_Image[x,y] to tempval */
+				tempval = *(Buffer_Data.Coadd_Image+(y*Buffer_Data.Size_X)+x);
+				/* Copy Buffer_Data.Coadd_Image[x,Buffer_Data.Size_Y-(y+1)] to Buffer_Data.Coadd_Image[x,y] */
+				*(Buffer_Data.Coadd_Image+(y*Buffer_Data.Size_X)+x) = *(Buffer_Data.Coadd_Image+
+					     (((Buffer_Data.Size_Y-(y+1))*Buffer_Data.Size_X)+x));
+				/* Copy tempval to Buffer_Data.Coadd_Image[x,Buffer_Data.Size_Y-(y+1)] */
+				*(Buffer_Data.Coadd_Image+(((Buffer_Data.Size_Y-(y+1))*Buffer_Data.Size_X)+x)) = tempval;
+			}
+		}
+	}
+	/* flip the coadd squared image in the same way, if we are accumulating a noise image */
+	if(Buffer_Data.Coadd_Squared_Image != NULL)
+		Buffer_Flip_Y_Long_Long(Buffer_Data.Coadd_Squared_Image,start_row,end_row);
+}
+
+/**
+ * Kernel to create the mean image from the coadd image over the specified rows, by dividing each coadd pixel
+ * by Buffer_Thread_Data.Coadds. In the same pass we compute the minimum, maximum, sum and saturated count
+ * of the band, and fill in the band's histogram, storing the results in Buffer_Band_Statistics[band].
+ * The accumulator width is tested once, and there is a separate pixel loop for each width.
+ * @param band The band number, used to select the band statistics and histogram to fill in.
+ * @param start_row The first row to process.
+ * @param end_row The row after the last row to process.
+ * @see #Buffer_Data
+ * @see #Buffer_Statistics
+ * @see #Buffer_Band_Statistics
+ * @see #Buffer_Thread_Data
+ * @see #Detector_Buffer_Create_Mean_Image
+ */
+static void Buffer_Mean_Kernel(int band,int start_row,int end_row)
+{
+	unsigned int *histogram = NULL;
+	double value,minimum,maximum,sum;
+	int i,bin,coadds,saturated_count,start_pixel,end_pixel;
+
+	start_pixel = start_row*Buffer_Data.Size_X;
+	end_pixel = end_row*Buffer_Data.Size_X;
+	coadds = Buffer_Thread_Data.Coadds;
+	if(band == 0)
+		histogram = Buffer_Statistics.Histogram;
+	else
+		histogram = Buffer_Band_Statistics[band].Histogram;
+	memset(histogram,0,DETECTOR_BUFFER_HISTOGRAM_BIN_COUNT*sizeof(unsigned int));
+	minimum = (double)(DETECTOR_BUFFER_HISTOGRAM_BIN_COUNT-1);
+	maximum = 0.0;
+	sum = 0.0;
+	saturated_count = 0;
+	if(Buffer_Data.Accumulator == DETECTOR_BUFFER_ACCUMULATOR_64)
+	{
+		for(i=start_pixel; i < end_pixel; i++)
+		{
+			value = ((double)Buffer_Data.Coadd_Image_64[i])/coadds;
+			Buffer_Data.Mean_Image[i] = value;
+			if(value < minimum)
+				minimum = value;
+			if(value > maximum)
+				maximum = value;
+			sum += value;
+			if(value >= Buffer_Statistics.Saturation_Level)
+				saturated_count++;
+			/* the mean of unsigned short coadds is always in the range 0..65535 */
+			bin = (int)value;
+			histogram[bin]++;
+		}
+	}
+	else
+	{
+		for(i=start_pixel; i < end_pixel; i++)
+		{
+			value = ((double)Buffer_Data.Coadd_Image[i])/coadds;
+			Buffer_Data.Mean_Image[i] = value;
+			if(value < minimum)
+				minimum = value;
+			if(value > maximum)
+				maximum = value;
+			sum += value;
+			if(value >= Buffer_Statistics.Saturation_Level)
+				saturated_count++;
+			/* the mean of unsigned short coadds is always in the range 0..65535 */
+			bin = (int)value;
+			histogram[bin]++;
+		}
+	}
+	Buffer_Band_Statistics[band].Minimum = minimum;
+	Buffer_Band_Statistics[band].Maximum = maximum;
+	Buffer_Band_Statistics[band].Sum = sum;
+	Buffer_Band_Statistics[band].Saturated_Count = saturated_count;
+}
+
+/**
+ * Kernel to create the noise image from the coadd image and coadd squared image over the specified rows.
+ * See Detector_Buffer_Create_Noise_Image for the formulae used. The accumulator width is tested once, 
+ * and there is a separate pixel loop for each width.
+ * @param band The band number (unused).
+ * @param start_row The first row to process.
+ * @param end_row The row after the last row to process.
+ * @see #Buffer_Data
+ * @see #Buffer_Thread_Data
+ * @see #Detector_Buffer_Create_Noise_Image
+ */
+static void Buffer_Noise_Kernel(int band,int start_row,int end_row)
+{
+	double sum,mean,variance;
+	int i,coadds,start_pixel,end_pixel;
+
+	start_pixel = start_row*Buffer_Data.Size_X;
+	end_pixel = end_row*Buffer_Data.Size_X;
+	coadds = Buffer_Thread_Data.Coadds;
+	if(Buffer_Data.Accumulator == DETECTOR_BUFFER_ACCUMULATOR_64)
+	{
+		for(i=start_pixel; i < end_pixel; i++)
+		{
+			sum = (double)Buffer_Data.Coadd_Image_64[i];
+			mean = sum/coadds;
+			variance = (((double)Buffer_Data.Coadd_Squared_Image[i])-(sum*mean))/(coadds-1);
+			/* rounding can make a zero variance very slightly negative */
+			if(variance < 0.0)
+				variance = 0.0;
+			if(Buffer_Data.Noise_Type == DETECTOR_BUFFER_NOISE_TYPE_STANDARD_ERROR)
+				Buffer_Data.Noise_Image[i] = sqrt(variance/coadds);
+			else
+				Buffer_Data.Noise_Image[i] = variance;
+		}
+	}
+	else
+	{
+		for(i=start_pixel; i < end_pixel; i++)
+		{
+			sum = (double)Buffer_Data.Coadd_Image[i];
+			mean = sum/coadds;
+			variance = (((double)Buffer_Data.Coadd_Squared_Image[i])-(sum*mean))/(coadds-1);
+			/* rounding can make a zero variance very slightly negative */
+			if(variance < 0.0)
+				variance = 0.0;
+			if(Buffer_Data.Noise_Type == DETECTOR_BUFFER_NOISE_TYPE_STANDARD_ERROR)
+				Buffer_Data.Noise_Image[i] = sqrt(variance/coadds);
+			else
+				Buffer_Data.Noise_Image[i] = variance;
+		}
+	}
+}
+
+/**
+ * Flip the specified rows of a long long (64 bit) image buffer of size Buffer_Data.Size_X * Buffer_Data.Size_Y 
+ * in the X direction. Used to flip Coadd_Image_64 and Coadd_Squared_Image.
+ * @param image The image buffer to flip. If this is NULL, nothing is done.
+ * @param start_row The first row to flip.
+ * @param end_row The row after the last row to flip.
+ * @see #Buffer_Data
+ */
+static void Buffer_Flip_X_Long_Long(long long *image,int start_row,int end_row)
+{
+	long long tempval;
+	int x,y;
+
+	if(image == NULL)
+		return;
+	for(y=start_row;y<end_row;y++)
+	{
+		for(x=0;x<(Buffer_Data.Size_X/2);x++)
+		{
+			tempval = *(image+(y*Buffer_Data.Size_X)+x);
+			*(image+(y*Buffer_Data.Size_X)+x) = *(image+(y*Buffer_Data.Size_X)+(Buffer_Data.Size_X-(x+1)));
+			*(image+(y*Buffer_Data.Size_X)+(Buffer_Data.Size_X-(x+1))) = tempval;
+		}
+	}
+}
+
+/**
+ * Flip a long long (64 bit) image buffer of size Buffer_Data.Size_X * Buffer_Data.Size_Y in the Y direction.
+ * Each row in the specified range is swapped with it's mirror row, so the range should lie within the first 
+ * half of the rows. Used to flip Coadd_Image_64 and Coadd_Squared_Image.
+ * @param image The image buffer to flip. If this is NULL, nothing is done.
+ * @param start_row The first row to swap with it's mirror row.
+ * @param end_row The row after the last row to swap with it's mirror row.
+ * @see #Buffer_Data
+ */
+static void Buffer_Flip_Y_Long_Long(long long *image,int start_row,int end_row)
+{
+	long long tempval;
+	int x,y;
+
+	if(image == NULL)
+		return;
+	for(y=start_row;y<end_row;y++)
+	{
+		for(x=0;x<Buffer_Data.Size_X;x++)
+		{
+			tempval = *(image+(y*Buffer_Data.Size_X)+x);
+			*(image+(y*Buffer_Data.Size_X)+x) = *(image+(((Buffer_Data.Size_Y-(y+1))*Buffer_Data.Size_X)+x));
+			*(image+(((Buffer_Data.Size_Y-(y+1))*Buffer_Data.Size_X)+x)) = tempval;
+		}
+	}
+}
+
+/**
+ * Allocate memory for an image buffer. The returned buffer is aligned to DETECTOR_BUFFER_ALIGNMENT bytes.
+ * <ul>
+ * <li>We add DETECTOR_BUFFER_ALIGNMENT bytes to the length, to hold a Buffer_Allocation_Struct header.
+ * <li>If Buffer_Data.Use_Huge_Pages is TRUE, we round the length up to a whole number of 
+ *     DETECTOR_BUFFER_HUGE_PAGE_SIZE pages and try to mmap it with MAP_HUGETLB. 
+ *     If this fails (usually because no huge pages are reserved), we fall back to posix_memalign aligned 
+ *     to a huge page boundary, and ask for transparent huge pages with madvise(MADV_HUGEPAGE).
+ * <li>Otherwise we allocate the memory with posix_memalign, aligned to DETECTOR_BUFFER_ALIGNMENT bytes.
+ * <li>If Buffer_Data.Lock_Memory is TRUE, we lock the allocation into RAM with mlock. This also pre-faults the pages.
+ * <li>We fill in the header, and return the address after it.
+ * </ul>
+ * @param length The length of the image buffer required, in bytes.
+ * @return A pointer to the image buffer, or NULL if the allocation failed.
+ * @see #Buffer_Data
+ * @see #Buffer_Allocation_Struct
+ * @see #Buffer_Image_Free
+ * @see detector_buffer.html#DETECTOR_BUFFER_ALIGNMENT
+ * @see detector_buffer.html#DETECTOR_BUFFER_HUGE_PAGE_SIZE
+ * @see detector_general.html#Detector_General_Log_Format
+ */
+static void *Buffer_Image_Allocate(size_t length)
+{
+	struct Buffer_Allocation_Struct *allocation = NULL;
+	void *base = NULL;
+	size_t total_length;
+	int is_mapped,retval;
+
+	total_length = length+DETECTOR_BUFFER_ALIGNMENT;
+	is_mapped = FALSE;
+	if(Buffer_Data.Use_Huge_Pages)
+	{
+		total_length = ((total_length+DETECTOR_BUFFER_HUGE_PAGE_SIZE-1)/DETECTOR_BUFFER_HUGE_PAGE_SIZE)*
+			DETECTOR_BUFFER_HUGE_PAGE_SIZE;
+		base = mmap(NULL,total_length,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB,-1,0);
+		if(base == MAP_FAILED)
+		{
+#if LOGGING > 1
+			Detector_General_Log_Format(LOG_VERBOSITY_TERSE,"Buffer_Image_Allocate:"
+						    "mmap of %lu bytes of huge pages failed (%d), using transparent huge pages.",
+						    (unsigned long)total_length,errno);
+#endif
+			base = NULL;
+			retval = posix_memalign(&base,DETECTOR_BUFFER_HUGE_PAGE_SIZE,total_length);
+			if(retval != 0)
+				return NULL;
+			madvise(base,total_length,MADV_HUGEPAGE);
+		}
+		else
+			is_mapped = TRUE;
+	}
+	else
+	{
+		retval = posix_memalign(&base,DETECTOR_BUFFER_ALIGNMENT,total_length);
+		if(retval != 0)
+			return NULL;
+	}
+	allocation = (struct Buffer_Allocation_Struct *)base;
+	allocation->Length = total_length;
+	allocation->Is_Mapped = is_mapped;
+	allocation->Is_Locked = FALSE;
+	if(Buffer_Data.Lock_Memory)
+	{
+		if(mlock(base,total_length) != 0)
+		{
+#if LOGGING > 1
+			Detector_General_Log_Format(LOG_VERBOSITY_TERSE,"Buffer_Image_Allocate:mlock of %lu bytes failed (%d).",
+						    (unsigned long)total_length,errno);
+#endif
+			Buffer_Image_Free(((char *)base)+DETECTOR_BUFFER_ALIGNMENT);
+			return NULL;
+		}
+		allocation->Is_Locked = TRUE;
+	}
+	return ((char *)base)+DETECTOR_BUFFER_ALIGNMENT;
+}
+
+/**
+ * Free an image buffer allocated by Buffer_Image_Allocate. The Buffer_Allocation_Struct header before the buffer
+ * is used to determine whether to munlock it, and whether to release it with munmap or free.
+ * @param image The image buffer to free. If this is NULL, nothing is done.
+ * @see #Buffer_Allocation_Struct
+ * @see #Buffer_Image_Allocate
+ * @see detector_buffer.html#DETECTOR_BUFFER_ALIGNMENT
+ */
+static void Buffer_Image_Free(void *image)
+{
+	struct Buffer_Allocation_Struct *allocation = NULL;
+
+	if(image == NULL)
+		return;
+	allocation = (struct Buffer_Allocation_Struct *)(((char *)image)-DETECTOR_BUFFER_ALIGNMENT);
+	if(allocation->Is_Locked)
+		munlock(allocation,allocation->Length);
+	if(allocation->Is_Mapped)
+		munmap(allocation,allocation->Length);
+	else
+		free(allocation);
+}
@@ -23,7 +23,9 @@
 #include "detector_setup.h"
 #include "detector_general.h"
 #include "fitsio.h"
-#include "xcliball.h"
+#include "detector_grabber.h"
+#include "detector_latency.h"
+#include "detector_trace.h"
 
 /* data types */
 /**
@@ -46,6 +48,8 @@
  * <dt>In_Progress</dt> <dd>An integer as a boolean, TRUE if an exposure/bias is in progress, false otherwise.</dd>
  * <dt>Abort</dt> <dd>An integer, used as a boolean. Set to FALSE at the start of an exposure, if another
  *                thread calls  Detector_Exposure_Abort to set this to TRUE, the exposure will abort.
+ * <dt>Start_Callback</dt> <dd>A function to call, in the exposing thread, when an exposure/bias has started
+ *                (In_Progress has been set and Exposure_Start_Timestamp taken), or NULL.</dd>
  * </dl>
  */
 struct Exposure_Struct
@@ -58,6 +62,7 @@ struct Exposure_Struct
 	struct timespec Exposure_Start_Timestamp;
 	int In_Progress;
 	int Abort;
+	void (*Start_Callback)(void);
 };
 
 /* internal variables */
@@ -76,11 +81,12 @@ static char rcsid[] = "$Id$";
  * <dt>Exposure_Start_Timestamp</dt> <dd>{0,0}</dd>
  * <dt>In_Progress</dt> <dd>FALSE</dd>
  * <dt>Abort</dt> <dd>FALSE</dd>
+ * <dt>Start_Callback</dt> <dd>NULL</dd>
  * </dl>
  */
 static struct Exposure_Struct Exposure_Data = 
 {
-	0,FALSE,FALSE,0,0,{0,0},FALSE,FALSE
+	0,FALSE,FALSE,0,0,{0,0},FALSE,FALSE,NULL
 };
 
 /**
@@ -94,7 +100,10 @@ static int Exposure_Error_Number = 0;
 static char Exposure_Error_String[DETECTOR_GENERAL_ERROR_STRING_LENGTH] = "";
 
 /* internal functions */
+static int Exposure_Read_Out_Strips(long captured_buffer);
 static int Exposure_Save(char *fits_filename);
+static int Exposure_Save_Statistics(fitsfile *fits_fp,char *fits_filename);
+static int Exposure_Save_Latency(fitsfile *fits_fp,char *fits_filename);
 static void Exposure_TimeSpec_To_Date_String(struct timespec time,char *time_string);
 static void Exposure_TimeSpec_To_Date_Obs_String(struct timespec time,char *time_string);
 static void Exposure_TimeSpec_To_UtStart_String(struct timespec time,char *time_string);
@@ -185,16 +194,18 @@ int Detector_Exposure_Flip_Set(int flip_x,int flip_y)
  * <ul>
  * <li>We check the fits_filename is not NULL.
  * <li>We compute the number of coadds, and check it is within range.
- * <li>We initialise the coadd image buffer to 0 by calling Detector_Buffer_Initialise_Coadd_Image.
+ * <li>We initialise the coadd image buffer to 0 by calling Detector_Buffer_Initialise_Coadd_Image. 
+ *     This also selects a 32 or 64 bit coadd accumulator, depending on the number of coadds.
  * <li>We reset the Abort flag in Exposure_Data.
  * <li>We take a timestamp for the start of this 'exposure' and store it in Exposure_Data.Exposure_Start_Timestamp.
  * <li>We set Exposure_Data.In_Progress flag to be TRUE.
- * <li>We initialise captured_field_count to the last field count captured (pxd_capturedFieldCount(1)).
- * <li>We call pxd_goLivePair to start camera 1 saving frames to frame grabber buffers 1 and 2.
+ * <li>We call Exposure_Data.Start_Callback (if set) to tell the caller the exposure has started.
+ * <li>We initialise captured_field_count to the last field count captured (Detector_Grabber_Captured_Field_Count(1)).
+ * <li>We call Detector_Grabber_Go_Live_Pair to start camera 1 saving frames to frame grabber buffers 1 and 2.
  * <li>We enter a for loop over Exposure_Data.Coadd_Count:
  *     <ul>
  *     <li>We get a timestamp for the start of this coadd.
- *     <li>We enter a loop until the last capture buffer field count changes: while (pxd_capturedFieldCount(1) == captured_field_count).
+ *     <li>We enter a loop until the last capture buffer field count changes: while (Detector_Grabber_Captured_Field_Count(1) == captured_field_count).
  *         <ul>
  *         <li>We sleep for a bit (500 us).
  *         <li>We take a current timestamp.
@@ -203,23 +214,30 @@ int Detector_Exposure_Flip_Set(int flip_x,int flip_y)
  *         <li>We check whether the Abort flag has been set in Exposure_Data (by another thread calling 
  *             Detector_Exposure_Abort) and abort this exposure if this is the case.
  *         </ul>
- *     <li>We update captured_field_count to the last captured buffer field count pxd_capturedFieldCount(1).
- *     <li>We update captured_buffer to the last captured buffer pxd_capturedBuffer(1).
- *     <li>We call pxd_readushort to read out captured_buffer from the frame grabber and put the image contents 
+ *     <li>We update captured_field_count to the last captured buffer field count Detector_Grabber_Captured_Field_Count(1).
+ *     <li>We update captured_buffer to the last captured buffer Detector_Grabber_Captured_Buffer(1).
+ *     <li>If coadds are being read out in strips (Detector_Buffer_Strip_Row_Count_Get is greater than 0),
+ *         we call Exposure_Read_Out_Strips to read out captured_buffer and add it to the coadd image buffer
+ *         a strip at a time. Otherwise:
+ *     <li>We call Detector_Grabber_Read_UShort to read out captured_buffer from the frame grabber and put the image contents 
  *         into the allocated mono image buffer (Detector_Buffer_Get_Mono_Image), which has allocated 
  *         Detector_Buffer_Get_Pixel_Count pixels, reading out the whole image from (0,0) to 
  *         (Detector_Setup_Get_Sensor_Size_X,Detector_Setup_Get_Sensor_Size_Y).
- *     <li>We check pxd_readushort read out the whole image.
+ *     <li>We check Detector_Grabber_Read_UShort read out the whole image.
  *     <li>We add the mono image buffer to the coadd image buffer by calling Detector_Buffer_Add_Mono_To_Coadd_Image.
  *     <li>We check whether the Abort flag has been set in Exposure_Data (by another thread calling 
  *         Detector_Exposure_Abort) and abort this exposure if this is the case.
  *     </ul>
- * <li>We stop the frame grabber acquiring data, by calling pxd_goAbortLive.
+ * <li>We stop the frame grabber acquiring data, by calling Detector_Grabber_Go_Abort_Live.
  * <li>If Exposure_Data.Flip_X is TRUE, we flip the Coadd image in X by calling Detector_Buffer_Coadd_Flip_X.
  * <li>If Exposure_Data.Flip_Y is TRUE, we flip the Coadd image in Y by calling Detector_Buffer_Coadd_Flip_Y.
  * <li>We create a mean image from the acquired coadds, by calling Detector_Buffer_Create_Mean_Image.
+ * <li>If a noise image is being accumulated (Detector_Buffer_Noise_Type_Get), and there is more than one coadd,
+ *     we create the noise image from the acquired coadds, by calling Detector_Buffer_Create_Noise_Image.
  * <li>We write the image to a FITS image by calling Exposure_Save.
  * <li>We set Exposure_Data.In_Progress flag to be FALSE.
+ * <li>The go live, first field, coadd readout and flip/mean stages are timed using Detector_Latency_Stage_Record.
+ * <li>Each coadd, and the save, are recorded as trace spans using Detector_Trace_Span_Start/Detector_Trace_Span_End.
  * </ul>
  * Before this routine is called, the following must have been done:
  * <ul>
@@ -239,29 +257,37 @@ int Detector_Exposure_Flip_Set(int flip_x,int flip_y)
  * @see #Exposure_Error_Number
  * @see #Exposure_Error_String
  * @see #Exposure_Save
+ * @see #Exposure_Read_Out_Strips
  * @see #Detector_Exposure_Set_Coadd_Frame_Exposure_Length
  * @see #Detector_Exposure_Abort
  * @see detector_buffer.html#Detector_Buffer_Initialise_Coadd_Image
  * @see detector_buffer.html#Detector_Buffer_Get_Mono_Image
  * @see detector_buffer.html#Detector_Buffer_Get_Pixel_Count
  * @see detector_buffer.html#Detector_Buffer_Add_Mono_To_Coadd_Image
+ * @see detector_buffer.html#Detector_Buffer_Strip_Row_Count_Get
  * @see detector_buffer.html#Detector_Buffer_Coadd_Flip_X
  * @see detector_buffer.html#Detector_Buffer_Coadd_Flip_Y
  * @see detector_buffer.html#Detector_Buffer_Create_Mean_Image
+ * @see detector_buffer.html#Detector_Buffer_Noise_Type_Get
+ * @see detector_buffer.html#Detector_Buffer_Create_Noise_Image
  * @see detector_fits_header.html#Detector_Fits_Header_Initialise
  * @see detector_general.html#DETECTOR_GENERAL_ONE_MICROSECOND_NS
  * @see detector_general.html#DETECTOR_GENERAL_ONE_SECOND_MS
  * @see detector_general.html#Detector_General_Log_Format
+ * @see detector_latency.html#Detector_Latency_Timestamp
+ * @see detector_latency.html#Detector_Latency_Stage_Record
+ * @see detector_trace.html#Detector_Trace_Span_Start
+ * @see detector_trace.html#Detector_Trace_Span_End
  * @see detector_setup.html#Detector_Setup_Startup
  * @see detector_setup.html#Detector_Setup_Get_Sensor_Size_X
  * @see detector_setup.html#Detector_Setup_Get_Sensor_Size_Y
  */
 int Detector_Exposure_Expose(int exposure_length_ms,char* fits_filename)
 {
-	struct timespec current_time,coadd_start_time,sleep_time;
-	pxbuffer_t captured_buffer;
-	pxvbtime_t captured_field_count;
-	uint32 systicks,systicksh;
+	struct timespec current_time,coadd_start_time,sleep_time,latency_time,trace_time;
+	long captured_buffer;
+	unsigned long captured_field_count;
+	unsigned int systicks,systicksh;
 	int i,retval;
 	
 	Exposure_Error_Number = 0;
@@ -303,41 +329,49 @@ int Detector_Exposure_Expose(int exposure_length_ms,char* fits_filename)
 				    Exposure_Data.Coadd_Frame_Exposure_Length_Ms);
 #endif
 	/* reset coadd image to 0 */
-	if(!Detector_Buffer_Initialise_Coadd_Image())
+	if(!Detector_Buffer_Initialise_Coadd_Image(Exposure_Data.Coadd_Count))
 	{
 		Exposure_Error_Number = 5;
 		sprintf(Exposure_Error_String,"Detector_Exposure_Expose:Failed to initialise coadd image.");
 		return FALSE;	
 	}
+#if LOGGING > 1
+	Detector_General_Log_Format(LOG_VERBOSITY_VERBOSE,"Detector_Exposure_Expose:Using a %d bit coadd accumulator.",
+				    Detector_Buffer_Accumulator_Get());
+#endif
 	/* reset abort flag */
 	Exposure_Data.Abort = FALSE;
 	/* take start of exposure timestamp */
 	clock_gettime(CLOCK_REALTIME,&(Exposure_Data.Exposure_Start_Timestamp));
 	Exposure_Data.In_Progress = TRUE;
+	if(Exposure_Data.Start_Callback != NULL)
+		(*(Exposure_Data.Start_Callback))();
 	/* initialise captured_field_count */
-	/* we initialise the captured_field_count to the current last captured field count. This will then increment after the pxd_goLivePair
+	/* we initialise the captured_field_count to the current last captured field count. This will then increment after the Detector_Grabber_Go_Live_Pair
 	** starts capturing new fields */
-	/* We previously used last_buffer/pxd_capturedBuffer, but this this doesn't work properly, 
-	** over the end of a pxd_goLivePair loop and start of another, as captured_buffer was reset here, 
+	/* We previously used last_buffer/Detector_Grabber_Captured_Buffer, but this this doesn't work properly, 
+	** over the end of a Detector_Grabber_Go_Live_Pair loop and start of another, as captured_buffer was reset here, 
 	** and we ended up with the same coadd in the end of one exposure and the start of the next.
 	** This especially effected exposures consisting of a single coadd, as several exposures contained the same data
 	** if the cycle time between each exposure is small enough  - testing showed this happening.
 	*/
-	captured_field_count = pxd_capturedFieldCount(1);
+	captured_field_count = Detector_Grabber_Captured_Field_Count(1);
 #if LOGGING > 1
 	Detector_General_Log_Format(LOG_VERBOSITY_INTERMEDIATE,"Detector_Exposure_Expose:Captured buffer field count initialised to %lu.",
 				    captured_field_count);
 #endif
 	/* turn on image capture into frame buffers 1 and 2 */
-	retval = pxd_goLivePair(1,1,2);
+	Detector_Latency_Timestamp(&latency_time);
+	retval = Detector_Grabber_Go_Live_Pair(1,1,2);
 	if(retval < 0)
 	{
 		Exposure_Data.In_Progress = FALSE;
 		Exposure_Error_Number = 11;
-		sprintf(Exposure_Error_String,"Detector_Exposure_Expose:pxd_goLivePair failed: '%s' (%d).",
-			pxd_mesgErrorCode(retval),retval);
+		sprintf(Exposure_Error_String,"Detector_Exposure_Expose:Detector_Grabber_Go_Live_Pair failed: '%s' (%d).",
+			Detector_Grabber_Error_Code_String(retval),retval);
 		return FALSE;	
 	}
+	Detector_Latency_Stage_Record(DETECTOR_LATENCY_STAGE_GO_LIVE,&latency_time);
 	/* loop over coadds */
 	for(i=0; i < Exposure_Data.Coadd_Count; i ++)
 	{
@@ -347,8 +381,9 @@ int Detector_Exposure_Expose(int exposure_length_ms,char* fits_filename)
 #endif
 		/* get a timestamp for the start of this coadd */
 		clock_gettime(CLOCK_REALTIME,&coadd_start_time);
+		Detector_Trace_Span_Start(&trace_time);
 		/* enter a loop until the last captured field count changes */ 
-		while (pxd_capturedFieldCount(1) == captured_field_count)
+		while (Detector_Grabber_Captured_Field_Count(1) == captured_field_count)
 		{
 			/* sleep a bit (500 us) */
 			sleep_time.tv_sec = 0;
@@ -367,7 +402,7 @@ int Detector_Exposure_Expose(int exposure_length_ms,char* fits_filename)
 					"(%d of %d coadds), coadd frame exposure length %d ms, timeout length %.3f s.",
 					i, Exposure_Data.Coadd_Count, Exposure_Data.Coadd_Frame_Exposure_Length_Ms,
 			     (((double)(Exposure_Data.Coadd_Frame_Exposure_Length_Ms*10))/DETECTOR_GENERAL_ONE_SECOND_MS));
-				pxd_goAbortLive(1);
+				Detector_Grabber_Go_Abort_Live(1);
 				return FALSE;
 			}
 			/* check for abort */
@@ -376,88 +411,110 @@ int Detector_Exposure_Expose(int exposure_length_ms,char* fits_filename)
 				Exposure_Data.In_Progress = FALSE;
 				Exposure_Error_Number = 29;
 				sprintf(Exposure_Error_String,"Detector_Exposure_Expose:Aborted.");
-				pxd_goAbortLive(1);
+				Detector_Grabber_Go_Abort_Live(1);
 				return FALSE;
 			}
 		}/* end while the frame grabber captured field count is captured_field_count */
+		/* the first coadd records the time from going live to the first field, subsequent coadds
+		** just restart the readout latency timer now the field has been captured */
+		if(i == 0)
+			Detector_Latency_Stage_Record(DETECTOR_LATENCY_STAGE_FIRST_FIELD,&latency_time);
+		else
+			Detector_Latency_Timestamp(&latency_time);
 		/* update captured field count */
-		captured_field_count = pxd_capturedFieldCount(1);
+		captured_field_count = Detector_Grabber_Captured_Field_Count(1);
 #if LOGGING > 1
 		Detector_General_Log_Format(LOG_VERBOSITY_INTERMEDIATE,
 					    "Detector_Exposure_Expose:Captured buffer field count %lu.",
 					    captured_field_count);
 #endif
 		/* update captured_buffer */
-		captured_buffer = pxd_capturedBuffer(1);
+		captured_buffer = Detector_Grabber_Captured_Buffer(1);
 #if LOGGING > 1
 		Detector_General_Log_Format(LOG_VERBOSITY_INTERMEDIATE,
-					    "Detector_Exposure_Expose:Captured buffer %d.",captured_buffer);
+					    "Detector_Exposure_Expose:Captured buffer %ld.",captured_buffer);
 #endif
 		/* print some debugging about this buffer capture */
-		systicks = pxd_capturedSysTicks(1);
-		systicksh = pxd_capturedSysTicksHi(1);
+		systicks = Detector_Grabber_Captured_Sys_Ticks(1);
+		systicksh = Detector_Grabber_Captured_Sys_Ticks_Hi(1);
 #if LOGGING > 1
 		Detector_General_Log_Format(LOG_VERBOSITY_INTERMEDIATE,
 					    "Detector_Exposure_Expose:Captured buffer sys ticks %u : %u.",
 					    systicksh,systicks);
 #endif
-		/* copy frame grabber buffer into mono image buffer 
-		** Assuming UNITS = 1 here, e.g. 1 detector */
-		retval = pxd_readushort(1,captured_buffer,0,0,
-					Detector_Setup_Get_Sensor_Size_X(),Detector_Setup_Get_Sensor_Size_Y(),
-					Detector_Buffer_Get_Mono_Image(),Detector_Buffer_Get_Pixel_Count(),"Grey");
-		if(retval < 0)
-		{
-			Exposure_Data.In_Progress = FALSE;
-			Exposure_Error_Number = 7;
-			sprintf(Exposure_Error_String,
-				"Detector_Exposure_Expose:pxd_readushort failed: '%s' (%d).",
-				pxd_mesgErrorCode(retval),retval);
-			pxd_goAbortLive(1);
-			return FALSE;	
-		}
-		/* check pxd_readushort read out the whole image */
-		if(retval != Detector_Buffer_Get_Pixel_Count())
+		if(Detector_Buffer_Strip_Row_Count_Get() > 0)
 		{
-			Exposure_Data.In_Progress = FALSE;
-			Exposure_Error_Number = 8;
-			sprintf(Exposure_Error_String,
-				"Detector_Exposure_Expose:pxd_readushort read %d of %d pixels.",
-				retval,Detector_Buffer_Get_Pixel_Count());
-			pxd_goAbortLive(1);
-			return FALSE;				
+			/* read out the frame grabber buffer a strip at a time, adding each strip to the coadd image */
+			if(!Exposure_Read_Out_Strips(captured_buffer))
+			{
+				Exposure_Data.In_Progress = FALSE;
+				Detector_Grabber_Go_Abort_Live(1);
+				return FALSE;
+			}
 		}
-		/* Add mono image buffer to coadd image buffer */
-		if(!Detector_Buffer_Add_Mono_To_Coadd_Image())
+		else
 		{
-			Exposure_Data.In_Progress = FALSE;
-			pxd_goAbortLive(1);
-			Exposure_Error_Number = 9;
-			sprintf(Exposure_Error_String,
-				"Detector_Exposure_Expose:Failed to copy mono image buffer to coadd image.");
-			return FALSE;	
+			/* copy frame grabber buffer into mono image buffer 
+			** Assuming UNITS = 1 here, e.g. 1 detector */
+			retval = Detector_Grabber_Read_UShort(1,captured_buffer,0,0,
+						Detector_Setup_Get_Sensor_Size_X(),Detector_Setup_Get_Sensor_Size_Y(),
+						Detector_Buffer_Get_Mono_Image(),Detector_Buffer_Get_Pixel_Count(),"Grey");
+			if(retval < 0)
+			{
+				Exposure_Data.In_Progress = FALSE;
+				Exposure_Error_Number = 7;
+				sprintf(Exposure_Error_String,
+					"Detector_Exposure_Expose:Detector_Grabber_Read_UShort failed: '%s' (%d).",
+					Detector_Grabber_Error_Code_String(retval),retval);
+				Detector_Grabber_Go_Abort_Live(1);
+				return FALSE;	
+			}
+			/* check Detector_Grabber_Read_UShort read out the whole image */
+			if(retval != Detector_Buffer_Get_Pixel_Count())
+			{
+				Exposure_Data.In_Progress = FALSE;
+				Exposure_Error_Number = 8;
+				sprintf(Exposure_Error_String,
+					"Detector_Exposure_Expose:Detector_Grabber_Read_UShort read %d of %d pixels.",
+					retval,Detector_Buffer_Get_Pixel_Count());
+				Detector_Grabber_Go_Abort_Live(1);
+				return FALSE;				
+			}
+			/* Add mono image buffer to coadd image buffer */
+			if(!Detector_Buffer_Add_Mono_To_Coadd_Image())
+			{
+				Exposure_Data.In_Progress = FALSE;
+				Detector_Grabber_Go_Abort_Live(1);
+				Exposure_Error_Number = 9;
+				sprintf(Exposure_Error_String,
+					"Detector_Exposure_Expose:Failed to copy mono image buffer to coadd image.");
+				return FALSE;	
+			}
 		}
+		Detector_Latency_Stage_Record(DETECTOR_LATENCY_STAGE_COADD_READOUT,&latency_time);
+		Detector_Trace_Span_End("exposure","coadd",NULL,&trace_time);
 		/* check for abort */
 		if(Exposure_Data.Abort)
 		{
 			Exposure_Data.In_Progress = FALSE;
-			pxd_goAbortLive(1);
+			Detector_Grabber_Go_Abort_Live(1);
 			Exposure_Error_Number = 30;
 			sprintf(Exposure_Error_String,"Detector_Exposure_Expose:Aborted.");
 			return FALSE;
 		}
 	}/* end for (i) on Coadd_Count */
 	/* stop the frame grabber acquiring data */
-	retval = pxd_goAbortLive(1);
+	retval = Detector_Grabber_Go_Abort_Live(1);
 	if(retval < 0)
 	{
 		Exposure_Data.In_Progress = FALSE;
 		Exposure_Error_Number = 12;
-		sprintf(Exposure_Error_String,"Detector_Exposure_Expose:pxd_goAbortLive failed: '%s' (%d).",
-			pxd_mesgErrorCode(retval),retval);
+		sprintf(Exposure_Error_String,"Detector_Exposure_Expose:Detector_Grabber_Go_Abort_Live failed: '%s' (%d).",
+			Detector_Grabber_Error_Code_String(retval),retval);
 		return FALSE;	
 	}
 	/* flip coadd image if required, before creating mean image */
+	Detector_Latency_Timestamp(&latency_time);
 	if(Exposure_Data.Flip_X)
 		Detector_Buffer_Coadd_Flip_X();
 	if(Exposure_Data.Flip_Y)
@@ -472,8 +529,25 @@ int Detector_Exposure_Expose(int exposure_length_ms,char* fits_filename)
 			Exposure_Data.Coadd_Count);
 		return FALSE;	
 	}
+	/* create noise image from coadds, if we are accumulating one */
+	if((Detector_Buffer_Noise_Type_Get() != DETECTOR_BUFFER_NOISE_TYPE_NONE)&&(Exposure_Data.Coadd_Count > 1))
+	{
+		if(!Detector_Buffer_Create_Noise_Image(Exposure_Data.Coadd_Count))
+		{
+			Exposure_Data.In_Progress = FALSE;
+			Exposure_Error_Number = 45;
+			sprintf(Exposure_Error_String,
+				"Detector_Exposure_Expose:Failed to create noise image from coadd image with %d coadds.",
+				Exposure_Data.Coadd_Count);
+			return FALSE;	
+		}
+	}
+	Detector_Latency_Stage_Record(DETECTOR_LATENCY_STAGE_MEAN_FLIP,&latency_time);
 	/* write FITS image */
-	if(!Exposure_Save(fits_filename))
+	Detector_Trace_Span_Start(&trace_time);
+	retval = Exposure_Save(fits_filename);
+	Detector_Trace_Span_End("exposure","save",NULL,&trace_time);
+	if(!retval)
 	{
 		Exposure_Data.In_Progress = FALSE;
 		/* Exposure_Error_Number set internally to Exposure_Save */
@@ -500,10 +574,11 @@ int Detector_Exposure_Expose(int exposure_length_ms,char* fits_filename)
  * <li>We reset the Abort flag in Exposure_Data.
  * <li>We take a timestamp for the start of this 'exposure' and store it in Exposure_Data.Exposure_Start_Timestamp.
  * <li>We set Exposure_Data.In_Progress flag to be TRUE.
- * <li>We initialise captured_field_count to the last field count captured (pxd_capturedFieldCount(1)).
- * <li>We call pxd_goLivePair to start camera 1 saving frames to frame grabber buffers 1 and 2.
+ * <li>We call Exposure_Data.Start_Callback (if set) to tell the caller the exposure has started.
+ * <li>We initialise captured_field_count to the last field count captured (Detector_Grabber_Captured_Field_Count(1)).
+ * <li>We call Detector_Grabber_Go_Live_Pair to start camera 1 saving frames to frame grabber buffers 1 and 2.
  * <li>We get a timestamp for the start of this coadd.
- * <li>We enter a loop until the last capture buffer field count changes: while (pxd_capturedFieldCount(1) == captured_field_count).
+ * <li>We enter a loop until the last capture buffer field count changes: while (Detector_Grabber_Captured_Field_Count(1) == captured_field_count).
  *     <ul>
  *     <li>We sleep for a bit (500 us).
  *     <li>We take a current timestamp.
@@ -512,22 +587,27 @@ int Detector_Exposure_Expose(int exposure_length_ms,char* fits_filename)
  *      <li>We check whether the Abort flag has been set in Exposure_Data (by another thread calling 
  *          Detector_Exposure_Abort) and abort this exposure if this is the case.
  *     </ul>
- * <li>We update captured_field_count to the last captured buffer field count pxd_capturedFieldCount(1).
- * <li>We update captured_buffer to the last captured buffer pxd_capturedBuffer(1).
- * <li>We call pxd_readushort to read out captured_buffer from the frame grabber and put the image contents 
+ * <li>We update captured_field_count to the last captured buffer field count Detector_Grabber_Captured_Field_Count(1).
+ * <li>We update captured_buffer to the last captured buffer Detector_Grabber_Captured_Buffer(1).
+ * <li>If coadds are being read out in strips (Detector_Buffer_Strip_Row_Count_Get is greater than 0),
+ *     we call Exposure_Read_Out_Strips to read out captured_buffer and add it to the coadd image buffer
+ *     a strip at a time. Otherwise:
+ * <li>We call Detector_Grabber_Read_UShort to read out captured_buffer from the frame grabber and put the image contents 
  *     into the allocated mono image buffer (Detector_Buffer_Get_Mono_Image), which has allocated 
  *     Detector_Buffer_Get_Pixel_Count pixels, reading out the whole image from (0,0) to 
  *     (Detector_Setup_Get_Sensor_Size_X,Detector_Setup_Get_Sensor_Size_Y).
- * <li>We check pxd_readushort read out the whole image.
+ * <li>We check Detector_Grabber_Read_UShort read out the whole image.
  * <li>We add the mono image buffer to the coadd image buffer by calling Detector_Buffer_Add_Mono_To_Coadd_Image.
  * <li>We check whether the Abort flag has been set in Exposure_Data (by another thread calling 
  *     Detector_Exposure_Abort) and abort this exposure if this is the case.
- * <li>We stop the frame grabber acquiring data, by calling pxd_goAbortLive.
+ * <li>We stop the frame grabber acquiring data, by calling Detector_Grabber_Go_Abort_Live.
  * <li>If Exposure_Data.Flip_X is TRUE, we flip the Coadd image in X by calling Detector_Buffer_Coadd_Flip_X.
  * <li>If Exposure_Data.Flip_Y is TRUE, we flip the Coadd image in Y by calling Detector_Buffer_Coadd_Flip_Y.
  * <li>We create a mean image from the acquired coadds, by calling Detector_Buffer_Create_Mean_Image.
  * <li>We write the image to a FITS image by calling Exposure_Save.
  * <li>We set Exposure_Data.In_Progress flag to be FALSE.
+ * <li>The go live, first field, coadd readout and flip/mean stages are timed using Detector_Latency_Stage_Record.
+ * <li>Each coadd, and the save, are recorded as trace spans using Detector_Trace_Span_Start/Detector_Trace_Span_End.
  * </ul>
  * Before this routine is called, the following must have been done:
  * <ul>
@@ -545,12 +625,14 @@ int Detector_Exposure_Expose(int exposure_length_ms,char* fits_filename)
  * @see #Exposure_Error_Number
  * @see #Exposure_Error_String
  * @see #Exposure_Save
+ * @see #Exposure_Read_Out_Strips
  * @see #Detector_Exposure_Set_Coadd_Frame_Exposure_Length
  * @see #Detector_Exposure_Abort
  * @see detector_buffer.html#Detector_Buffer_Initialise_Coadd_Image
  * @see detector_buffer.html#Detector_Buffer_Get_Mono_Image
  * @see detector_buffer.html#Detector_Buffer_Get_Pixel_Count
  * @see detector_buffer.html#Detector_Buffer_Add_Mono_To_Coadd_Image
+ * @see detector_buffer.html#Detector_Buffer_Strip_Row_Count_Get
  * @see detector_buffer.html#Detector_Buffer_Coadd_Flip_X
  * @see detector_buffer.html#Detector_Buffer_Coadd_Flip_Y
  * @see detector_buffer.html#Detector_Buffer_Create_Mean_Image
@@ -558,15 +640,19 @@ int Detector_Exposure_Expose(int exposure_length_ms,char* fits_filename)
  * @see detector_general.html#DETECTOR_GENERAL_ONE_MICROSECOND_NS
  * @see detector_general.html#DETECTOR_GENERAL_ONE_SECOND_MS
  * @see detector_general.html#Detector_General_Log_Format
+ * @see detector_latency.html#Detector_Latency_Timestamp
+ * @see detector_latency.html#Detector_Latency_Stage_Record
+ * @see detector_trace.html#Detector_Trace_Span_Start
+ * @see detector_trace.html#Detector_Trace_Span_End
  * @see detector_setup.html#Detector_Setup_Startup
  * @see detector_setup.html#Detector_Setup_Get_Sensor_Size_X
  * @see detector_setup.html#Detector_Setup_Get_Sensor_Size_Y
  */
 int Detector_Exposure_Bias(char* fits_filename)
 {
-	struct timespec current_time,coadd_start_time,sleep_time;
-	pxvbtime_t captured_field_count;
-	pxbuffer_t captured_buffer;
+	struct timespec current_time,coadd_start_time,sleep_time,latency_time,trace_time;
+	unsigned long captured_field_count;
+	long captured_buffer;
 	int i,retval;
 
 	Exposure_Error_Number = 0;
@@ -592,7 +678,7 @@ int Detector_Exposure_Bias(char* fits_filename)
 	/* just one coadd for the bias frame */
 	Exposure_Data.Coadd_Count = 1;
 	/* reset coadd image to 0 */
-	if(!Detector_Buffer_Initialise_Coadd_Image())
+	if(!Detector_Buffer_Initialise_Coadd_Image(Exposure_Data.Coadd_Count))
 	{
 		Exposure_Error_Number = 35;
 		sprintf(Exposure_Error_String,"Detector_Exposure_Bias:Failed to initialise coadd image.");
@@ -603,25 +689,30 @@ int Detector_Exposure_Bias(char* fits_filename)
 	/* take start of exposure timestamp */
 	clock_gettime(CLOCK_REALTIME,&(Exposure_Data.Exposure_Start_Timestamp));
 	Exposure_Data.In_Progress = TRUE;
+	if(Exposure_Data.Start_Callback != NULL)
+		(*(Exposure_Data.Start_Callback))();
 	/* initialise captured field count */
-	captured_field_count = pxd_capturedFieldCount(1);
+	captured_field_count = Detector_Grabber_Captured_Field_Count(1);
 	/* turn on image capture into frame buffers 1 and 2 */
-	retval = pxd_goLivePair(1,1,2);
+	Detector_Latency_Timestamp(&latency_time);
+	retval = Detector_Grabber_Go_Live_Pair(1,1,2);
 	if(retval < 0)
 	{
 		Exposure_Data.In_Progress = FALSE;
 		Exposure_Error_Number = 36;
-		sprintf(Exposure_Error_String,"Detector_Exposure_Bias:pxd_goLivePair failed: '%s' (%d).",
-			pxd_mesgErrorCode(retval),retval);
+		sprintf(Exposure_Error_String,"Detector_Exposure_Bias:Detector_Grabber_Go_Live_Pair failed: '%s' (%d).",
+			Detector_Grabber_Error_Code_String(retval),retval);
 		return FALSE;	
 	}
+	Detector_Latency_Stage_Record(DETECTOR_LATENCY_STAGE_GO_LIVE,&latency_time);
 #if LOGGING > 1
 	Detector_General_Log(LOG_VERBOSITY_INTERMEDIATE,"Detector_Exposure_Bias:Starting coadd.");
 #endif
 	/* get a timestamp for the start of this coadd */
 	clock_gettime(CLOCK_REALTIME,&coadd_start_time);
+	Detector_Trace_Span_Start(&trace_time);
 	/* enter a loop until the last captured buffer field count changes */ 
-	while (pxd_capturedFieldCount(1) == captured_field_count)
+	while (Detector_Grabber_Captured_Field_Count(1) == captured_field_count)
 	{
 		/* sleep a bit (500 us) */
 		sleep_time.tv_sec = 0;
@@ -635,7 +726,7 @@ int Detector_Exposure_Bias(char* fits_filename)
 			Exposure_Error_Number = 37;
 			sprintf(Exposure_Error_String,
 				"Detector_Exposure_Bias:Timed out whilst waiting for a new capture buffer, timeout length 1 s.");
-			pxd_goAbortLive(1);
+			Detector_Grabber_Go_Abort_Live(1);
 			return FALSE;
 		}
 		/* check for abort */
@@ -644,70 +735,87 @@ int Detector_Exposure_Bias(char* fits_filename)
 			Exposure_Data.In_Progress = FALSE;
 			Exposure_Error_Number = 38;
 			sprintf(Exposure_Error_String,"Detector_Exposure_Bias:Aborted.");
-			pxd_goAbortLive(1);
+			Detector_Grabber_Go_Abort_Live(1);
 			return FALSE;
 		}
 	}/* end while the frame grabber captured buffer field count is the last captured_field_count */
+	Detector_Latency_Stage_Record(DETECTOR_LATENCY_STAGE_FIRST_FIELD,&latency_time);
 	/* update captured buffer field count */
-	captured_field_count = pxd_capturedFieldCount(1);	
+	captured_field_count = Detector_Grabber_Captured_Field_Count(1);	
 	/* update captured_buffer */
-	captured_buffer = pxd_capturedBuffer(1);
-	/* copy frame grabber buffer into mono image buffer 
-	** Assuming UNITS = 1  here, e.g. 1 detector */
-	retval = pxd_readushort(1,captured_buffer,0,0,
-				Detector_Setup_Get_Sensor_Size_X(),Detector_Setup_Get_Sensor_Size_Y(),
-				Detector_Buffer_Get_Mono_Image(),Detector_Buffer_Get_Pixel_Count(),"Grey");
-	if(retval < 0)
+	captured_buffer = Detector_Grabber_Captured_Buffer(1);
+	if(Detector_Buffer_Strip_Row_Count_Get() > 0)
 	{
-		Exposure_Data.In_Progress = FALSE;
-		Exposure_Error_Number = 39;
-		sprintf(Exposure_Error_String,
-			"Detector_Exposure_Bias:pxd_readushort failed: '%s' (%d).",
-			pxd_mesgErrorCode(retval),retval);
-		pxd_goAbortLive(1);
-		return FALSE;	
-	}
-	/* check pxd_readushort read out the whole image */
-	if(retval != Detector_Buffer_Get_Pixel_Count())
-	{
-		Exposure_Data.In_Progress = FALSE;
-		Exposure_Error_Number = 40;
-		sprintf(Exposure_Error_String,
-			"Detector_Exposure_Bias:pxd_readushort read %d of %d pixels.",
-			retval,Detector_Buffer_Get_Pixel_Count());
-		pxd_goAbortLive(1);
-		return FALSE;				
+		/* read out the frame grabber buffer a strip at a time, adding each strip to the coadd image */
+		if(!Exposure_Read_Out_Strips(captured_buffer))
+		{
+			Exposure_Data.In_Progress = FALSE;
+			Detector_Grabber_Go_Abort_Live(1);
+			return FALSE;
+		}
 	}
-	/* Add mono image buffer to coadd image buffer */
-	if(!Detector_Buffer_Add_Mono_To_Coadd_Image())
+	else
 	{
-		Exposure_Data.In_Progress = FALSE;
-		pxd_goAbortLive(1);
-		Exposure_Error_Number = 41;
-		sprintf(Exposure_Error_String,
-			"Detector_Exposure_Bias:Failed to copy mono image buffer to coadd image.");
-		return FALSE;	
+		/* copy frame grabber buffer into mono image buffer 
+		** Assuming UNITS = 1  here, e.g. 1 detector */
+		retval = Detector_Grabber_Read_UShort(1,captured_buffer,0,0,
+					Detector_Setup_Get_Sensor_Size_X(),Detector_Setup_Get_Sensor_Size_Y(),
+					Detector_Buffer_Get_Mono_Image(),Detector_Buffer_Get_Pixel_Count(),"Grey");
+		if(retval < 0)
+		{
+			Exposure_Data.In_Progress = FALSE;
+			Exposure_Error_Number = 39;
+			sprintf(Exposure_Error_String,
+				"Detector_Exposure_Bias:Detector_Grabber_Read_UShort failed: '%s' (%d).",
+				Detector_Grabber_Error_Code_String(retval),retval);
+			Detector_Grabber_Go_Abort_Live(1);
+			return FALSE;	
+		}
+		/* check Detector_Grabber_Read_UShort read out the whole image */
+		if(retval != Detector_Buffer_Get_Pixel_Count())
+		{
+			Exposure_Data.In_Progress = FALSE;
+			Exposure_Error_Number = 40;
+			sprintf(Exposure_Error_String,
+				"Detector_Exposure_Bias:Detector_Grabber_Read_UShort read %d of %d pixels.",
+				retval,Detector_Buffer_Get_Pixel_Count());
+			Detector_Grabber_Go_Abort_Live(1);
+			return FALSE;				
+		}
+		/* Add mono image buffer to coadd image buffer */
+		if(!Detector_Buffer_Add_Mono_To_Coadd_Image())
+		{
+			Exposure_Data.In_Progress = FALSE;
+			Detector_Grabber_Go_Abort_Live(1);
+			Exposure_Error_Number = 41;
+			sprintf(Exposure_Error_String,
+				"Detector_Exposure_Bias:Failed to copy mono image buffer to coadd image.");
+			return FALSE;	
+		}
 	}
+	Detector_Latency_Stage_Record(DETECTOR_LATENCY_STAGE_COADD_READOUT,&latency_time);
+	Detector_Trace_Span_End("exposure","coadd",NULL,&trace_time);
 	/* check for abort */
 	if(Exposure_Data.Abort)
 	{
 		Exposure_Data.In_Progress = FALSE;
-		pxd_goAbortLive(1);
+		Detector_Grabber_Go_Abort_Live(1);
 		Exposure_Error_Number = 42;
 		sprintf(Exposure_Error_String,"Detector_Exposure_Bias:Aborted.");
 		return FALSE;
 	}
 	/* stop the frame grabber acquiring data */
-	retval = pxd_goAbortLive(1);
+	retval = Detector_Grabber_Go_Abort_Live(1);
 	if(retval < 0)
 	{
 		Exposure_Data.In_Progress = FALSE;
 		Exposure_Error_Number = 43;
-		sprintf(Exposure_Error_String,"Detector_Exposure_Bias:pxd_goAbortLive failed: '%s' (%d).",
-			pxd_mesgErrorCode(retval),retval);
+		sprintf(Exposure_Error_String,"Detector_Exposure_Bias:Detector_Grabber_Go_Abort_Live failed: '%s' (%d).",
+			Detector_Grabber_Error_Code_String(retval),retval);
 		return FALSE;	
 	}
 	/* flip coadd image if required, before creating mean image */
+	Detector_Latency_Timestamp(&latency_time);
 	if(Exposure_Data.Flip_X)
 		Detector_Buffer_Coadd_Flip_X();
 	if(Exposure_Data.Flip_Y)
@@ -722,8 +830,12 @@ int Detector_Exposure_Bias(char* fits_filename)
 			Exposure_Data.Coadd_Count);
 		return FALSE;	
 	}
+	Detector_Latency_Stage_Record(DETECTOR_LATENCY_STAGE_MEAN_FLIP,&latency_time);
 	/* write FITS image */
-	if(!Exposure_Save(fits_filename))
+	Detector_Trace_Span_Start(&trace_time);
+	retval = Exposure_Save(fits_filename);
+	Detector_Trace_Span_End("exposure","save",NULL,&trace_time);
+	if(!retval)
 	{
 		Exposure_Data.In_Progress = FALSE;
 		/* Exposure_Error_Number set internally to Exposure_Save */
@@ -736,6 +848,21 @@ int Detector_Exposure_Bias(char* fits_filename)
 	return TRUE;
 }
 
+/**
+ * Routine to set a function to be called when an exposure or bias has started. The function is called
+ * in the thread calling Detector_Exposure_Expose/Detector_Exposure_Bias, after the exposure start timestamp
+ * has been taken and the in progress flag set, so it can safely use the Detector_Exposure getters 
+ * (Detector_Exposure_Start_Time_Get etc) to publish the exposure's state. It should return quickly.
+ * @param callback_fn The function to call, or NULL to stop calling a function.
+ * @see #Exposure_Data
+ * @see #Detector_Exposure_Expose
+ * @see #Detector_Exposure_Bias
+ */
+void Detector_Exposure_Start_Callback_Set(void (*callback_fn)(void))
+{
+	Exposure_Data.Start_Callback = callback_fn;
+}
+
 /**
  * Routine to abort a running exposure (Detector_Exposure_Expose) in another thread. This just sets Exposure_Data.Abort
  * to TRUE, which is regularly checked by Detector_Exposure_Expose.
@@ -856,6 +983,71 @@ void Detector_Exposure_Error_String(char *error_string)
 /* =======================================
 **  internal functions 
 ** ======================================= */
+/**
+ * Routine to read out a captured frame grabber buffer a strip of rows at a time, adding each strip to the coadd
+ * image as soon as it is read out. Each strip is small enough to still be in cache when it is accumulated,
+ * so this avoids writing the whole frame into the mono image buffer and reading it all back again. 
+ * For each strip of Detector_Buffer_Strip_Row_Count_Get rows (the last strip may be shorter):
+ * <ul>
+ * <li>We call Detector_Grabber_Read_UShort to read the strip's rows out of captured_buffer into the strip image buffer
+ *     (Detector_Buffer_Get_Strip_Image).
+ * <li>We check Detector_Grabber_Read_UShort read out the whole strip.
+ * <li>We add the strip to the coadd image buffer by calling Detector_Buffer_Add_Strip_To_Coadd_Image.
+ * </ul>
+ * @param captured_buffer The frame grabber buffer to read out.
+ * @return The routine returns TRUE on success and FALSE on failure. 
+ *         On failure, Exposure_Error_Number/Exposure_Error_String are set.
+ * @see #Exposure_Error_Number
+ * @see #Exposure_Error_String
+ * @see detector_buffer.html#Detector_Buffer_Strip_Row_Count_Get
+ * @see detector_buffer.html#Detector_Buffer_Get_Strip_Image
+ * @see detector_buffer.html#Detector_Buffer_Add_Strip_To_Coadd_Image
+ * @see detector_setup.html#Detector_Setup_Get_Sensor_Size_X
+ * @see detector_setup.html#Detector_Setup_Get_Sensor_Size_Y
+ */
+static int Exposure_Read_Out_Strips(long captured_buffer)
+{
+	int start_row,row_count,strip_row_count,size_x,size_y,retval;
+
+	strip_row_count = Detector_Buffer_Strip_Row_Count_Get();
+	size_x = Detector_Setup_Get_Sensor_Size_X();
+	size_y = Detector_Setup_Get_Sensor_Size_Y();
+	for(start_row = 0; start_row < size_y; start_row += strip_row_count)
+	{
+		row_count = strip_row_count;
+		if((start_row+row_count) > size_y)
+			row_count = size_y-start_row;
+		/* Assuming UNITS = 1 here, e.g. 1 detector */
+		retval = Detector_Grabber_Read_UShort(1,captured_buffer,0,start_row,size_x,start_row+row_count,
+					Detector_Buffer_Get_Strip_Image(),size_x*row_count,"Grey");
+		if(retval < 0)
+		{
+			Exposure_Error_Number = 51;
+			sprintf(Exposure_Error_String,
+				"Exposure_Read_Out_Strips:Detector_Grabber_Read_UShort failed for rows %d to %d: '%s' (%d).",
+				start_row,start_row+row_count,Detector_Grabber_Error_Code_String(retval),retval);
+			return FALSE;
+		}
+		if(retval != (size_x*row_count))
+		{
+			Exposure_Error_Number = 52;
+			sprintf(Exposure_Error_String,
+				"Exposure_Read_Out_Strips:Detector_Grabber_Read_UShort read %d of %d pixels for rows %d to %d.",
+				retval,size_x*row_count,start_row,start_row+row_count);
+			return FALSE;
+		}
+		if(!Detector_Buffer_Add_Strip_To_Coadd_Image(start_row,row_count))
+		{
+			Exposure_Error_Number = 53;
+			sprintf(Exposure_Error_String,
+				"Exposure_Read_Out_Strips:Failed to add strip (rows %d to %d) to coadd image.",
+				start_row,start_row+row_count);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
 /**
  * Routine to save the acquired mean image data to a FITS image, with appropriate headers.
  * <ul>
@@ -881,8 +1073,17 @@ void Detector_Exposure_Error_String(char *error_string)
  * <li>We compute an individual coadd exposure length in seconds using Exposure_Data.Coadd_Frame_Exposure_Length_Ms, 
  *     and write the computed value as a double to the COADDSEC FITS keyword.
  * <li>We write the number of coadds (Exposure_Data.Coadd_Count) to the COADDNUM keyword as an integer.
+ * <li>We call Exposure_Save_Statistics to write the mean image statistics into the FITS header.
+ * <li>If Detector_Latency_Fits_Keywords_Get returns TRUE, we call Exposure_Save_Latency to write the
+ *     latencies of the stages leading up to the save into the FITS header.
+ * <li>If a noise image is being accumulated (Detector_Buffer_Noise_Type_Get), and there is more than one coadd,
+ *     we create a second image HDU by calling fits_create_img, write the noise image data 
+ *     (Detector_Buffer_Get_Noise_Image) into it, and set the EXTNAME keyword to "VARIANCE" or "STDERR"
+ *     as appropriate.
  * <li>We call fits_close_file to close the FITS file and flush any data to disk.
  * <li>We call Detector_Fits_Filename_UnLock to delete the FITS lock file.
+ * <li>Each of the above save stages is timed using Detector_Latency_Stage_Record. When the save is complete
+ *     we call Detector_Latency_Exposure_Reset, ready for the next exposure.
  * </ul>
  * @param fits_filename A string, the FITS image filename to save the data into.
  * @return The routine returns TRUE on success and FALSE on failure. 
@@ -894,13 +1095,21 @@ void Detector_Exposure_Error_String(char *error_string)
  * @see #Exposure_TimeSpec_To_Date_Obs_String
  * @see #Exposure_TimeSpec_To_UtStart_String
  * @see #Exposure_TimeSpec_To_Mjd
+ * @see #Exposure_Save_Statistics
+ * @see #Exposure_Save_Latency
  * @see detector_buffer.html#Detector_Buffer_Get_Pixel_Count
  * @see detector_buffer.html#Detector_Buffer_Get_Mean_Image
+ * @see detector_buffer.html#Detector_Buffer_Noise_Type_Get
+ * @see detector_buffer.html#Detector_Buffer_Get_Noise_Image
  * @see detector_fits_filename.html#Detector_Fits_Filename_Lock
  * @see detector_fits_filename.html#Detector_Fits_Filename_UnLock
  * @see detector_fits_header.html#Detector_Fits_Header_Write_To_Fits
  * @see detector_general.html#DETECTOR_GENERAL_ONE_SECOND_MS
  * @see detector_general.html#Detector_General_Log_Format
+ * @see detector_latency.html#Detector_Latency_Timestamp
+ * @see detector_latency.html#Detector_Latency_Stage_Record
+ * @see detector_latency.html#Detector_Latency_Exposure_Reset
+ * @see detector_latency.html#Detector_Latency_Fits_Keywords_Get
  * @see detector_setup.html#Detector_Setup_Get_Sensor_Size_X
  * @see detector_setup.html#Detector_Setup_Get_Sensor_Size_Y
  */
@@ -909,6 +1118,8 @@ static int Exposure_Save(char *fits_filename)
 	fitsfile *fits_fp = NULL;
 	char exposure_start_time_string[64];
 	char buff[32]; /* fits_get_errstatus returns 30 chars max */
+	enum DETECTOR_BUFFER_NOISE_TYPE noise_type;
+	struct timespec latency_time;
 	long axes[2];
 	int status = 0,retval,ivalue,ncols,nrows;
 	double exposure_length,mjd;
@@ -926,6 +1137,7 @@ static int Exposure_Save(char *fits_filename)
 	/* get dimensions */
 	ncols = Detector_Setup_Get_Sensor_Size_X();
 	nrows = Detector_Setup_Get_Sensor_Size_Y();
+	Detector_Latency_Timestamp(&latency_time);
 	/* create lock file for image to be saved */
 	if(!Detector_Fits_Filename_Lock(fits_filename))
 	{
@@ -957,6 +1169,7 @@ static int Exposure_Save(char *fits_filename)
 		sprintf(Exposure_Error_String,"Exposure_Save: Create image failed(%s,%d,%s).",fits_filename,status,buff);
 		return FALSE;
 	}
+	Detector_Latency_Stage_Record(DETECTOR_LATENCY_STAGE_FITS_CREATE,&latency_time);
 	/* write the data */
 	retval = fits_write_img(fits_fp,TDOUBLE,1,Detector_Buffer_Get_Pixel_Count(),Detector_Buffer_Get_Mean_Image(),
 				&status);
@@ -970,6 +1183,7 @@ static int Exposure_Save(char *fits_filename)
 		sprintf(Exposure_Error_String,"Exposure_Save: File write image failed(%s,%d,%s).",fits_filename,status,buff);
 		return FALSE;
 	}
+	Detector_Latency_Stage_Record(DETECTOR_LATENCY_STAGE_FITS_WRITE,&latency_time);
 	/* save FITS headers to filename */
 	if(!Detector_Fits_Header_Write_To_Fits(fits_fp))
 	{
@@ -1085,6 +1299,76 @@ static int Exposure_Save(char *fits_filename)
 		       Exposure_Data.Coadd_Count,fits_filename,status,buff);
 		return FALSE;
 	}
+	/* write mean image statistics */
+	if(!Exposure_Save_Statistics(fits_fp,fits_filename))
+	{
+		/* Exposure_Save_Statistics closes the FITS file and sets Exposure_Error_Number on failure */
+		Detector_Fits_Filename_UnLock(fits_filename);
+		return FALSE;
+	}
+	/* write the pre-save exposure stage latencies, if configured to */
+	if(Detector_Latency_Fits_Keywords_Get())
+	{
+		if(!Exposure_Save_Latency(fits_fp,fits_filename))
+		{
+			/* Exposure_Save_Latency closes the FITS file and sets Exposure_Error_Number on failure */
+			Detector_Fits_Filename_UnLock(fits_filename);
+			return FALSE;
+		}
+	}
+	Detector_Latency_Stage_Record(DETECTOR_LATENCY_STAGE_FITS_HEADER,&latency_time);
+	/* write the noise image extension, if we have accumulated one */
+	noise_type = Detector_Buffer_Noise_Type_Get();
+	if((noise_type != DETECTOR_BUFFER_NOISE_TYPE_NONE)&&(Exposure_Data.Coadd_Count > 1))
+	{
+		retval = fits_create_img(fits_fp,DOUBLE_IMG,2,axes,&status);
+		if(retval)
+		{
+			fits_get_errstatus(status,buff);
+			fits_report_error(stderr,status);
+			fits_close_file(fits_fp,&status);
+			Detector_Fits_Filename_UnLock(fits_filename);
+			Exposure_Error_Number = 46;
+			sprintf(Exposure_Error_String,"Exposure_Save: Create noise image extension failed(%s,%d,%s).",
+				fits_filename,status,buff);
+			return FALSE;
+		}
+		retval = fits_write_img(fits_fp,TDOUBLE,1,Detector_Buffer_Get_Pixel_Count(),
+					Detector_Buffer_Get_Noise_Image(),&status);
+		if(retval)
+		{
+			fits_get_errstatus(status,buff);
+			fits_report_error(stderr,status);
+			fits_close_file(fits_fp,&status);
+			Detector_Fits_Filename_UnLock(fits_filename);
+			Exposure_Error_Number = 47;
+			sprintf(Exposure_Error_String,"Exposure_Save: File write noise image failed(%s,%d,%s).",
+				fits_filename,status,buff);
+			return FALSE;
+		}
+		if(noise_type == DETECTOR_BUFFER_NOISE_TYPE_STANDARD_ERROR)
+		{
+			retval = fits_update_key(fits_fp,TSTRING,"EXTNAME","STDERR",
+						 "Per-pixel standard error of the mean of the coadds",&status);
+		}
+		else
+		{
+			retval = fits_update_key(fits_fp,TSTRING,"EXTNAME","VARIANCE",
+						 "Per-pixel sample variance of the coadds",&status);
+		}
+		if(retval)
+		{
+			fits_get_errstatus(status,buff);
+			fits_report_error(stderr,status);
+			fits_close_file(fits_fp,&status);
+			Detector_Fits_Filename_UnLock(fits_filename);
+			Exposure_Error_Number = 48;
+			sprintf(Exposure_Error_String,"Exposure_Save: Updating noise EXTNAME failed(%s,%d,%s).",
+				fits_filename,status,buff);
+			return FALSE;
+		}
+		Detector_Latency_Stage_Record(DETECTOR_LATENCY_STAGE_FITS_NOISE_WRITE,&latency_time);
+	}
 	/* ensure data we have written is in the actual data buffer, not CFITSIO's internal buffers */
 	/* closing the file ensures this. */ 
 	retval = fits_close_file(fits_fp,&status);
@@ -1098,6 +1382,7 @@ static int Exposure_Save(char *fits_filename)
 		sprintf(Exposure_Error_String,"Exposure_Save: File close file failed(%s,%d,%s).",fits_filename,status,buff);
 		return FALSE;
 	}
+	Detector_Latency_Stage_Record(DETECTOR_LATENCY_STAGE_FITS_CLOSE,&latency_time);
 	/* remove lock file */
 	if(!Detector_Fits_Filename_UnLock(fits_filename))
 	{
@@ -1105,12 +1390,134 @@ static int Exposure_Save(char *fits_filename)
 		sprintf(Exposure_Error_String,"Exposure_Save:Failed to unlock '%s'.",fits_filename);
 		return FALSE;				
 	}
+	Detector_Latency_Stage_Record(DETECTOR_LATENCY_STAGE_UNLOCK,&latency_time);
+	/* this exposure is complete, start accumulating the next exposure's stage latencies */
+	Detector_Latency_Exposure_Reset();
 #if LOGGING > 1
 	Detector_General_Log_Format(LOG_VERBOSITY_INTERMEDIATE,"Exposure_Save:Finished saving '%s'.",fits_filename);
 #endif
 	return TRUE;
 }
 
+/**
+ * Routine to write the statistics of the mean image (computed by Detector_Buffer_Create_Mean_Image) into the
+ * FITS header of the currently open FITS file.
+ * <ul>
+ * <li>We retrieve the statistics by calling Detector_Buffer_Statistics_Get.
+ * <li>We write the minimum and maximum pixel values to the DATAMIN and DATAMAX keywords.
+ * <li>We write the mean and estimated median pixel values to the DATAMEAN and DATAMED keywords.
+ * <li>We write the number of saturated pixels to the SATCOUNT keyword, and the level used to the SATLEVEL keyword.
+ * </ul>
+ * On failure the FITS file is closed.
+ * @param fits_fp The CFITSIO file pointer of the open FITS file.
+ * @param fits_filename A string, the FITS image filename, used for error messages.
+ * @return The routine returns TRUE on success and FALSE on failure. 
+ *         On failure, Exposure_Error_Number/Exposure_Error_String are set.
+ * @see #Exposure_Error_Number
+ * @see #Exposure_Error_String
+ * @see detector_buffer.html#Detector_Buffer_Statistics_Get
+ * @see detector_buffer.html#Detector_Buffer_Saturation_Level_Get
+ */
+static int Exposure_Save_Statistics(fitsfile *fits_fp,char *fits_filename)
+{
+	char buff[32]; /* fits_get_errstatus returns 30 chars max */
+	double minimum,maximum,mean,median;
+	int status = 0,retval,saturated_count,saturation_level;
+
+	if(!Detector_Buffer_Statistics_Get(&minimum,&maximum,&mean,&median,&saturated_count))
+	{
+		fits_close_file(fits_fp,&status);
+		Exposure_Error_Number = 49;
+		sprintf(Exposure_Error_String,"Exposure_Save_Statistics:Failed to get mean image statistics.");
+		return FALSE;
+	}
+	retval = fits_update_key_fixdbl(fits_fp,"DATAMIN",minimum,3,"Minimum pixel value",&status);
+	if(retval == 0)
+		retval = fits_update_key_fixdbl(fits_fp,"DATAMAX",maximum,3,"Maximum pixel value",&status);
+	if(retval == 0)
+		retval = fits_update_key_fixdbl(fits_fp,"DATAMEAN",mean,3,"Mean pixel value",&status);
+	if(retval == 0)
+		retval = fits_update_key_fixdbl(fits_fp,"DATAMED",median,3,"Median pixel value (histogram estimate)",
+						&status);
+	if(retval == 0)
+		retval = fits_update_key(fits_fp,TINT,"SATCOUNT",&saturated_count,"Number of saturated pixels",&status);
+	if(retval == 0)
+	{
+		saturation_level = Detector_Buffer_Saturation_Level_Get();
+		retval = fits_update_key(fits_fp,TINT,"SATLEVEL",&saturation_level,"Pixel value counted as saturated",
+					 &status);
+	}
+	if(retval)
+	{
+		fits_get_errstatus(status,buff);
+		fits_report_error(stderr,status);
+		fits_close_file(fits_fp,&status);
+		Exposure_Error_Number = 50;
+		sprintf(Exposure_Error_String,"Exposure_Save_Statistics: Updating statistics keywords failed(%s,%d,%s).",
+			fits_filename,status,buff);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * Routine to write the latencies of the exposure stages completed before the FITS file was saved into the
+ * FITS header of the currently open FITS file. The stages timed during the save itself are not complete at this
+ * point, and can be retrieved using Detector_Latency_Stage_Statistics_Get instead.
+ * <ul>
+ * <li>We loop over the stages from DETECTOR_LATENCY_STAGE_NUDGEMATIC_MOVE to DETECTOR_LATENCY_STAGE_MEAN_FLIP.
+ * <li>We retrieve the number of times the stage was recorded during this exposure, and the mean latency,
+ *     by calling Detector_Latency_Stage_Exposure_Get.
+ * <li>Stages that were not recorded during this exposure (e.g. the nudgematic move for a bias frame) are skipped.
+ * <li>Otherwise we write the mean latency in milliseconds to the stage's keyword (LATNUDGE, LATHDRS, LATLIVE,
+ *     LATFIELD, LATREAD, LATMEAN). LATREAD is the mean time to read out one coadd.
+ * </ul>
+ * On failure the FITS file is closed.
+ * @param fits_fp The CFITSIO file pointer of the open FITS file.
+ * @param fits_filename A string, the FITS image filename, used for error messages.
+ * @return The routine returns TRUE on success and FALSE on failure. 
+ *         On failure, Exposure_Error_Number/Exposure_Error_String are set.
+ * @see #Exposure_Error_Number
+ * @see #Exposure_Error_String
+ * @see detector_latency.html#DETECTOR_LATENCY_STAGE
+ * @see detector_latency.html#Detector_Latency_Stage_Exposure_Get
+ */
+static int Exposure_Save_Latency(fitsfile *fits_fp,char *fits_filename)
+{
+	static char *keyword_list[] = {"LATNUDGE","LATHDRS","LATLIVE","LATFIELD","LATREAD","LATMEAN"};
+	static char *comment_list[] = {"[ms] Nudgematic move latency","[ms] FITS header set latency",
+				       "[ms] Frame grabber go live latency","[ms] Go live to first field latency",
+				       "[ms] Mean coadd readout latency","[ms] Flip and mean image latency"};
+	char buff[32]; /* fits_get_errstatus returns 30 chars max */
+	double mean_ms;
+	int status = 0,retval,stage,count;
+
+	for(stage = DETECTOR_LATENCY_STAGE_NUDGEMATIC_MOVE; stage <= DETECTOR_LATENCY_STAGE_MEAN_FLIP; stage++)
+	{
+		if(!Detector_Latency_Stage_Exposure_Get(stage,&count,&mean_ms))
+		{
+			fits_close_file(fits_fp,&status);
+			Exposure_Error_Number = 54;
+			sprintf(Exposure_Error_String,"Exposure_Save_Latency:Failed to get latency of stage %d.",stage);
+			return FALSE;
+		}
+		if(count < 1)
+			continue;
+		retval = fits_update_key_fixdbl(fits_fp,keyword_list[stage],mean_ms,3,comment_list[stage],&status);
+		if(retval)
+		{
+			fits_get_errstatus(status,buff);
+			fits_report_error(stderr,status);
+			fits_close_file(fits_fp,&status);
+			Exposure_Error_Number = 55;
+			sprintf(Exposure_Error_String,"Exposure_Save_Latency: Updating %s keyword failed(%s,%d,%s).",
+				keyword_list[stage],fits_filename,status,buff);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
 /**
  * Routine to convert a timespec structure to a DATE sytle string to put into a FITS header.
  * This uses gmtime and strftime to format the string. The resultant string is of the form:
@@ -398,7 +398,10 @@ int Detector_Fits_Filename_Get_Filename(enum DETECTOR_FITS_FILENAME_EXPOSURE_TYP
 }
 
 /**
- * Add filename to a list of filenames.
+ * Add filename to a list of filenames. The list grows geometrically: it is only reallocated when the count is 0 
+ * or a power of two, at which point it's capacity doubles. Hence adding N filenames (i.e. during a long multrun)
+ * causes O(log N) reallocations rather than N. The capacity is implied by the count, so callers do not need to 
+ * track it.
  * @param filename A FITS filename.
  * @param filename_list The address of a pointer to a list of filenames.
  * @param filename_count The number of filenames in the list.
@@ -408,6 +411,9 @@ int Detector_Fits_Filename_Get_Filename(enum DETECTOR_FITS_FILENAME_EXPOSURE_TYP
  */
 int Detector_Fits_Filename_List_Add(char *filename,char ***filename_list,int *filename_count)
 {
+	char **new_filename_list = NULL;
+	int capacity;
+
 	if(filename == NULL)
 	{
 		Fits_Filename_Error_Number = 9;
@@ -426,20 +432,26 @@ int Detector_Fits_Filename_List_Add(char *filename,char ***filename_list,int *fi
 		sprintf(Fits_Filename_Error_String,"Detector_Fits_Filename_List_Add:filename_count is NULL.");
 		return FALSE;
 	}
-	if((*filename_list) == NULL)
-	{
-		(*filename_list) = (char **)malloc(sizeof(char *));
-	}
-	else
+	/* the list is full when the count is 0 or a power of two */
+	if(((*filename_list) == NULL)||(((*filename_count)&((*filename_count)-1)) == 0))
 	{
-		(*filename_list) = (char **)realloc((*filename_list),((*filename_count)+1)*sizeof(char *));
-	}
-	if((*filename_list) == NULL)
-	{
-		Fits_Filename_Error_Number = 12;
-		sprintf(Fits_Filename_Error_String,
-			"Detector_Fits_Filename_List_Add:failed to reallocate filename_list(%d).",(*filename_count));
-		return FALSE;
+		if((*filename_count) == 0)
+			capacity = 1;
+		else
+			capacity = (*filename_count)*2;
+		if((*filename_list) == NULL)
+			new_filename_list = (char **)malloc(capacity*sizeof(char *));
+		else
+			new_filename_list = (char **)realloc((*filename_list),capacity*sizeof(char *));
+		if(new_filename_list == NULL)
+		{
+			Fits_Filename_Error_Number = 12;
+			sprintf(Fits_Filename_Error_String,
+				"Detector_Fits_Filename_List_Add:failed to reallocate filename_list(%d).",
+				(*filename_count));
+			return FALSE;
+		}
+		(*filename_list) = new_filename_list;
 	}
 	(*filename_list)[(*filename_count)] = strdup(filename);
 	if((*filename_list)[(*filename_count)] == NULL)
@@ -30,9 +30,14 @@
 #include "detector_fits_filename.h"
 #include "detector_fits_header.h"
 #include "detector_general.h"
+#include "detector_grabber.h"
+#include "detector_grabber_simulator.h"
+#include "detector_latency.h"
 #include "detector_serial.h"
 #include "detector_setup.h"
+#include "detector_telemetry.h"
 #include "detector_temperature.h"
+#include "detector_trace.h"
 
 /* defines */
 /**
@@ -46,6 +51,8 @@
  * <dl>
  * <dt>Mutex</dt> <dd>Optionally compiled mutex locking over sending commands and receiving a reply.</dd>
  * <dt>Log_Handler</dt> <dd>Function pointer to the routine that will log messages passed to it.</dd>
+ * <dt>Log_Format_Handler</dt> <dd>Function pointer to a routine that will log unformatted messages 
+ * 		(a format string and its arguments) passed to it by Detector_General_Log_Format, or NULL.</dd>
  * <dt>Log_Filter</dt> <dd>Function pointer to the routine that will filter log messages passed to it.
  * 		The funtion will return TRUE if the message should be logged, and FALSE if it shouldn't.</dd>
  * <dt>Log_Filter_Level</dt> <dd>A globally maintained log filter level. 
@@ -64,6 +71,7 @@ struct General_Struct
 	pthread_mutex_t Mutex;
 #endif
 	void (*Log_Handler)(int level,char *string);
+	void (*Log_Format_Handler)(int level,char *format,va_list ap);
 	int (*Log_Filter)(int level,char *string);
 	int Log_Filter_Level;
 };
@@ -79,6 +87,7 @@ static char rcsid[] = "$Id$";
  * <dl>
  * <dt>Mutex</dt> <dd>If compiled in, PTHREAD_MUTEX_INITIALIZER</dd>
  * <dt>Log_Handler</dt> <dd>NULL</dd>
+ * <dt>Log_Format_Handler</dt> <dd>NULL</dd>
  * <dt>Log_Filter</dt> <dd>NULL</dd>
  * <dt>Log_Filter_Level</dt> <dd>0</dd>
  * </dl>
@@ -89,7 +98,7 @@ static struct General_Struct General_Data =
 #ifdef MUTEXED
 	PTHREAD_MUTEX_INITIALIZER,
 #endif
-	NULL,NULL,0,
+	NULL,NULL,NULL,0,
 };
 
 /**
@@ -113,9 +122,14 @@ static char General_Error_String[DETECTOR_GENERAL_ERROR_STRING_LENGTH] = "";
  * @see  detector_exposure.html#Detector_Exposure_Get_Error_Number
  * @see  detector_fits_filename.html#Detector_Fits_Filename_Get_Error_Number
  * @see  detector_fits_header.html#Detector_Fits_Header_Get_Error_Number
+ * @see  detector_grabber.html#Detector_Grabber_Get_Error_Number
+ * @see  detector_grabber_simulator.html#Detector_Grabber_Simulator_Get_Error_Number
+ * @see  detector_latency.html#Detector_Latency_Get_Error_Number
  * @see  detector_serial.html#Detector_Serial_Get_Error_Number
  * @see  detector_setup.html#Detector_Setup_Get_Error_Number
+ * @see  detector_telemetry.html#Detector_Telemetry_Get_Error_Number
  * @see  detector_temperature.html#Detector_Temperature_Get_Error_Number
+ * @see  detector_trace.html#Detector_Trace_Get_Error_Number
  */
 int Detector_General_Is_Error(void)
 {
@@ -129,12 +143,22 @@ int Detector_General_Is_Error(void)
 		found = TRUE;
 	if(Detector_Fits_Header_Get_Error_Number() != 0)
 		found = TRUE;
+	if(Detector_Grabber_Get_Error_Number() != 0)
+		found = TRUE;
+	if(Detector_Grabber_Simulator_Get_Error_Number() != 0)
+		found = TRUE;
+	if(Detector_Latency_Get_Error_Number() != 0)
+		found = TRUE;
 	if(Detector_Serial_Get_Error_Number() != 0)
 		found = TRUE;
 	if(Detector_Setup_Get_Error_Number() != 0)
 		found = TRUE;
+	if(Detector_Telemetry_Get_Error_Number() != 0)
+		found = TRUE;
 	if(Detector_Temperature_Get_Error_Number() != 0)
 		found = TRUE;
+	if(Detector_Trace_Get_Error_Number() != 0)
+		found = TRUE;
 	if(General_Error_Number != 0)
 		found = TRUE;
 	return found;
@@ -153,12 +177,22 @@ int Detector_General_Is_Error(void)
  * @see detector_fits_filename.html#Detector_Fits_Filename_Error
  * @see detector_fits_header.html#Detector_Fits_Header_Get_Error_Number
  * @see detector_fits_header.html#Detector_Fits_Header_Error
+ * @see detector_grabber.html#Detector_Grabber_Get_Error_Number
+ * @see detector_grabber.html#Detector_Grabber_Error
+ * @see detector_grabber_simulator.html#Detector_Grabber_Simulator_Get_Error_Number
+ * @see detector_grabber_simulator.html#Detector_Grabber_Simulator_Error
+ * @see detector_latency.html#Detector_Latency_Get_Error_Number
+ * @see detector_latency.html#Detector_Latency_Error
  * @see detector_serial.html#Detector_Serial_Get_Error_Number
  * @see detector_serial.html#Detector_Serial_Error
  * @see detector_setup.html#Detector_Setup_Get_Error_Number
  * @see detector_setup.html#Detector_Setup_Error
+ * @see detector_telemetry.html#Detector_Telemetry_Get_Error_Number
+ * @see detector_telemetry.html#Detector_Telemetry_Error
  * @see detector_temperature.html#Detector_Temperature_Get_Error_Number
  * @see detector_temperature.html#Detector_Temperature_Error
+ * @see detector_trace.html#Detector_Trace_Get_Error_Number
+ * @see detector_trace.html#Detector_Trace_Error
  */
 void Detector_General_Error(void)
 {
@@ -185,6 +219,21 @@ void Detector_General_Error(void)
 		found = TRUE;
 		Detector_Fits_Header_Error();
 	}
+	if(Detector_Grabber_Get_Error_Number() != 0)
+	{
+		found = TRUE;
+		Detector_Grabber_Error();
+	}
+	if(Detector_Grabber_Simulator_Get_Error_Number() != 0)
+	{
+		found = TRUE;
+		Detector_Grabber_Simulator_Error();
+	}
+	if(Detector_Latency_Get_Error_Number() != 0)
+	{
+		found = TRUE;
+		Detector_Latency_Error();
+	}
 	if(Detector_Setup_Get_Error_Number() != 0)
 	{
 		found = TRUE;
@@ -195,11 +244,21 @@ void Detector_General_Error(void)
 		found = TRUE;
 		Detector_Serial_Error();
 	}
+	if(Detector_Telemetry_Get_Error_Number() != 0)
+	{
+		found = TRUE;
+		Detector_Telemetry_Error();
+	}
 	if(Detector_Temperature_Get_Error_Number() != 0)
 	{
 		found = TRUE;
 		Detector_Temperature_Error();
 	}
+	if(Detector_Trace_Get_Error_Number() != 0)
+	{
+		found = TRUE;
+		Detector_Trace_Error();
+	}
 	if(General_Error_Number != 0)
 	{
 		found = TRUE;
@@ -229,12 +288,22 @@ void Detector_General_Error(void)
  * @see detector_fits_filename.html#Detector_Fits_Filename_Error_String
  * @see detector_fits_header.html#Detector_Fits_Header_Get_Error_Number
  * @see detector_fits_header.html#Detector_Fits_Header_Error_String
+ * @see detector_grabber.html#Detector_Grabber_Get_Error_Number
+ * @see detector_grabber.html#Detector_Grabber_Error_String
+ * @see detector_grabber_simulator.html#Detector_Grabber_Simulator_Get_Error_Number
+ * @see detector_grabber_simulator.html#Detector_Grabber_Simulator_Error_String
+ * @see detector_latency.html#Detector_Latency_Get_Error_Number
+ * @see detector_latency.html#Detector_Latency_Error_String
  * @see detector_serial.html#Detector_Serial_Get_Error_Number
  * @see detector_serial.html#Detector_Serial_Error_String
  * @see detector_setup.html#Detector_Setup_Get_Error_Number
  * @see detector_setup.html#Detector_Setup_Error_String
+ * @see detector_telemetry.html#Detector_Telemetry_Get_Error_Number
+ * @see detector_telemetry.html#Detector_Telemetry_Error_String
  * @see detector_temperature.html#Detector_Temperature_Get_Error_Number
  * @see detector_temperature.html#Detector_Temperature_Error_String
+ * @see detector_trace.html#Detector_Trace_Get_Error_Number
+ * @see detector_trace.html#Detector_Trace_Error_String
  */
 void Detector_General_Error_To_String(char *error_string)
 {
@@ -257,6 +326,18 @@ void Detector_General_Error_To_String(char *error_string)
 	{
 		Detector_Fits_Header_Error_String(error_string);
 	}
+	if(Detector_Grabber_Get_Error_Number() != 0)
+	{
+		Detector_Grabber_Error_String(error_string);
+	}
+	if(Detector_Grabber_Simulator_Get_Error_Number() != 0)
+	{
+		Detector_Grabber_Simulator_Error_String(error_string);
+	}
+	if(Detector_Latency_Get_Error_Number() != 0)
+	{
+		Detector_Latency_Error_String(error_string);
+	}
 	if(Detector_Serial_Get_Error_Number() != 0)
 	{
 		Detector_Serial_Error_String(error_string);
@@ -265,10 +346,18 @@ void Detector_General_Error_To_String(char *error_string)
 	{
 		Detector_Setup_Error_String(error_string);
 	}
+	if(Detector_Telemetry_Get_Error_Number() != 0)
+	{
+		Detector_Telemetry_Error_String(error_string);
+	}
 	if(Detector_Temperature_Get_Error_Number() != 0)
 	{
 		Detector_Temperature_Error_String(error_string);
 	}
+	if(Detector_Trace_Get_Error_Number() != 0)
+	{
+		Detector_Trace_Error_String(error_string);
+	}
 	if(General_Error_Number != 0)
 	{
 		Detector_General_Get_Current_Time_String(time_string,32);
@@ -322,13 +411,19 @@ void Detector_General_Get_Current_Time_String(char *time_string,int string_lengt
 
 /**
  * Routine to log a message to a defined logging mechanism. This routine has an arbitary number of arguments,
- * and uses vsprintf to format them i.e. like fprintf. 
+ * and uses vsnprintf to format them i.e. like fprintf. 
  * Detector_General_Log is then called to handle the log message.
+ * We first call Detector_General_Log_Level_Enabled, and return without formatting the message if it
+ * would be filtered out anyway, so suppressed messages cost a function call and a comparison.
+ * If a General_Data.Log_Format_Handler has been set, the format string and arguments are passed to it
+ * unformatted (e.g. to be packed into a binary log record), and General_Data.Log_Handler is not called.
  * @param level An integer, used to decide whether this particular message has been selected for
  * 	logging or not.
  * @param format A string, with formatting statements the same as fprintf would use to determine the type
  * 	of the following arguments.
  * @see #Detector_General_Log
+ * @see #Detector_General_Log_Level_Enabled
+ * @see #General_Data
  * @see #LOG_BUFF_LENGTH
  */
 void Detector_General_Log_Format(int level,char *format,...)
@@ -336,9 +431,20 @@ void Detector_General_Log_Format(int level,char *format,...)
 	char buff[LOG_BUFF_LENGTH];
 	va_list ap;
 
+/* don't format messages that will be filtered out */
+	if(!Detector_General_Log_Level_Enabled(level))
+		return;
+/* pass the unformatted message to the format handler, if there is one */
+	if(General_Data.Log_Format_Handler != NULL)
+	{
+		va_start(ap,format);
+		(*General_Data.Log_Format_Handler)(level,format,ap);
+		va_end(ap);
+		return;
+	}
 /* format the arguments */
 	va_start(ap,format);
-	vsprintf(buff,format,ap);
+	vsnprintf(buff,LOG_BUFF_LENGTH,format,ap);
 	va_end(ap);
 /* call the log routine to log the results */
 	Detector_General_Log(level,buff);
@@ -371,6 +477,31 @@ void Detector_General_Log(int level,char *string)
 	(*General_Data.Log_Handler)(level,string);
 }
 
+/**
+ * Routine to decide whether a message at the specified level would be logged, without needing the message itself.
+ * A message is not logged if there is no General_Data.Log_Handler or General_Data.Log_Format_Handler. If General_Data.Log_Filter is one of the
+ * level only filters (Detector_General_Log_Filter_Level_Absolute or Detector_General_Log_Filter_Level_Bitwise), 
+ * we call it with a NULL string, as they don't look at the message. Any other filter may look at the message
+ * text, so we assume the message may be logged.
+ * @param level An integer, the log level of the message.
+ * @return The routine returns TRUE if a message at this level may be logged, and FALSE if it will be
+ *         filtered out.
+ * @see #General_Data
+ * @see #Detector_General_Log_Filter_Level_Absolute
+ * @see #Detector_General_Log_Filter_Level_Bitwise
+ */
+int Detector_General_Log_Level_Enabled(int level)
+{
+	if((General_Data.Log_Handler == NULL)&&(General_Data.Log_Format_Handler == NULL))
+		return FALSE;
+	if((General_Data.Log_Filter == Detector_General_Log_Filter_Level_Absolute)||
+	   (General_Data.Log_Filter == Detector_General_Log_Filter_Level_Bitwise))
+	{
+		return General_Data.Log_Filter(level,NULL);
+	}
+	return TRUE;
+}
+
 /**
  * Routine to set the General_Data.Log_Handler used by Detector_General_Log.
  * @param log_fn A function pointer to a suitable handler.
@@ -382,6 +513,20 @@ void Detector_General_Set_Log_Handler_Function(void (*log_fn)(int level,char *st
 	General_Data.Log_Handler = log_fn;
 }
 
+/**
+ * Routine to set the General_Data.Log_Format_Handler used by Detector_General_Log_Format. When set, messages
+ * logged using Detector_General_Log_Format are passed to it unformatted, rather than to General_Data.Log_Handler.
+ * Only level filtering (Detector_General_Log_Level_Enabled) is applied to them.
+ * @param log_fn A function pointer to a suitable handler, or NULL to format messages and
+ *        pass them to General_Data.Log_Handler again.
+ * @see #General_Data
+ * @see #Detector_General_Log_Format
+ */
+void Detector_General_Set_Log_Format_Handler_Function(void (*log_fn)(int level,char *format,va_list ap))
+{
+	General_Data.Log_Format_Handler = log_fn;
+}
+
 /**
  * Routine to set the General_Data.Log_Filter used by Detector_General_Log.
  * @param log_fn A function pointer to a suitable filter function.
@@ -411,6 +556,20 @@ void Detector_General_Log_Handler_Stdout(int level,char *string)
 	fprintf(stdout,"%s %s\n",time_string,string);
 }
 
+/**
+ * Routine to return the LOGGING level this library was compiled with. The amount of logging code compiled
+ * into the library (and hence its overhead even when the messages are filtered out) depends on it.
+ * @return The LOGGING level, or 0 if the library was compiled without LOGGING defined.
+ */
+int Detector_General_Log_Compile_Level_Get(void)
+{
+#ifdef LOGGING
+	return LOGGING;
+#else
+	return 0;
+#endif
+}
+
 /**
  * Routine to set the General_Data.Log_Filter_Level.
  * @see #General_Data
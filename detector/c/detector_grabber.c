@@ -0,0 +1,658 @@
+/* detector_grabber.c
+** Raptor Ninox-640 Infrared detector library : frame grabber backend routines.
+*/
+/**
+ * Routines that the rest of the detector library uses to talk to the frame grabber and camera head.
+ * Each routine calls through to the currently selected backend: either the EPIX XCLIB library (talking to
+ * the real frame grabber and Raptor camera head), or a simulator (detector_grabber_simulator) that
+ * needs no hardware, so the acquisition path can be tested and benchmarked on any machine.
+ * @author Chris Mottram
+ * @version $Revision$
+ */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "log_udp.h"
+#include "detector_general.h"
+#include "detector_grabber.h"
+#include "detector_grabber_simulator.h"
+#include "xcliball.h"
+
+/* data types */
+/**
+ * Data type holding local data to detector_grabber. This consists of the following:
+ * <dl>
+ * <dt>Backend</dt> <dd>Which backend is currently selected, of type DETECTOR_GRABBER_BACKEND.</dd>
+ * <dt>Functions</dt> <dd>A pointer to the set of functions implementing the selected backend.</dd>
+ * </dl>
+ * @see detector_grabber.html#DETECTOR_GRABBER_BACKEND
+ * @see detector_grabber.html#Detector_Grabber_Backend_Struct
+ */
+struct Grabber_Struct
+{
+	enum DETECTOR_GRABBER_BACKEND Backend;
+	struct Detector_Grabber_Backend_Struct *Functions;
+};
+
+/* internal functions */
+static int Grabber_XCLIB_Open(char *driverparms,char *formatname,char *formatfile);
+static int Grabber_XCLIB_Close(void);
+static int Grabber_XCLIB_Info_Units(void);
+static unsigned long Grabber_XCLIB_Info_Memsize(int unitmap);
+static int Grabber_XCLIB_Image_X_Dim(void);
+static int Grabber_XCLIB_Image_Y_Dim(void);
+static int Grabber_XCLIB_Image_Z_Dim(void);
+static int Grabber_XCLIB_Image_C_Dim(void);
+static int Grabber_XCLIB_Image_B_Dim(void);
+static int Grabber_XCLIB_Go_Live_Pair(int unitmap,long buffer1,long buffer2);
+static int Grabber_XCLIB_Go_Abort_Live(int unitmap);
+static unsigned long Grabber_XCLIB_Captured_Field_Count(int unitmap);
+static long Grabber_XCLIB_Captured_Buffer(int unitmap);
+static unsigned int Grabber_XCLIB_Captured_Sys_Ticks(int unitmap);
+static unsigned int Grabber_XCLIB_Captured_Sys_Ticks_Hi(int unitmap);
+static int Grabber_XCLIB_Read_UShort(int unitmap,long buffer,int ulx,int uly,int lrx,int lry,
+				     unsigned short *membase,size_t count,char *colorspace);
+static char *Grabber_XCLIB_Error_Code_String(int error_code);
+static int Grabber_XCLIB_Serial_Configure(int unitmap,int rsvd0,double baud,int bits,int parity,int stopbits,
+					  int rsvd1,int rsvd2,int rsvd3);
+static int Grabber_XCLIB_Serial_Read(int unitmap,int rsvd0,unsigned char *buffer,int count);
+static int Grabber_XCLIB_Serial_Write(int unitmap,int rsvd0,unsigned char *buffer,int count);
+static int Grabber_XCLIB_Serial_Flush(int unitmap,int rsvd0,int rsvd1,int rsvd2);
+
+/* internal variables */
+/**
+ * Revision Control System identifier.
+ */
+static char rcsid[] = "$Id$";
+/**
+ * The set of functions implementing the XCLIB backend, which call the pxd_ routines.
+ * @see detector_grabber.html#Detector_Grabber_Backend_Struct
+ */
+static struct Detector_Grabber_Backend_Struct Grabber_XCLIB_Backend =
+{
+	Grabber_XCLIB_Open,Grabber_XCLIB_Close,Grabber_XCLIB_Info_Units,Grabber_XCLIB_Info_Memsize,
+	Grabber_XCLIB_Image_X_Dim,Grabber_XCLIB_Image_Y_Dim,Grabber_XCLIB_Image_Z_Dim,Grabber_XCLIB_Image_C_Dim,
+	Grabber_XCLIB_Image_B_Dim,Grabber_XCLIB_Go_Live_Pair,Grabber_XCLIB_Go_Abort_Live,
+	Grabber_XCLIB_Captured_Field_Count,Grabber_XCLIB_Captured_Buffer,Grabber_XCLIB_Captured_Sys_Ticks,
+	Grabber_XCLIB_Captured_Sys_Ticks_Hi,Grabber_XCLIB_Read_UShort,Grabber_XCLIB_Error_Code_String,
+	Grabber_XCLIB_Serial_Configure,Grabber_XCLIB_Serial_Read,Grabber_XCLIB_Serial_Write,Grabber_XCLIB_Serial_Flush
+};
+/**
+ * The instance of Grabber_Struct that contains local data for this module. This is initialised as follows:
+ * <dl>
+ * <dt>Backend</dt> <dd>DETECTOR_GRABBER_BACKEND_XCLIB</dd>
+ * <dt>Functions</dt> <dd>&Grabber_XCLIB_Backend</dd>
+ * </dl>
+ * @see #Grabber_XCLIB_Backend
+ */
+static struct Grabber_Struct Grabber_Data =
+{
+	DETECTOR_GRABBER_BACKEND_XCLIB,&Grabber_XCLIB_Backend
+};
+
+/**
+ * Variable holding error code of last operation performed.
+ */
+static int Grabber_Error_Number = 0;
+/**
+ * Local variable holding description of the last error that occured.
+ * @see detector_general.html#DETECTOR_GENERAL_ERROR_STRING_LENGTH
+ */
+static char Grabber_Error_String[DETECTOR_GENERAL_ERROR_STRING_LENGTH] = "";
+
+/* --------------------------------------------------------
+** External Functions
+** -------------------------------------------------------- */
+/**
+ * Select which frame grabber backend the detector library talks to. This should be called before
+ * Detector_Setup_Startup opens a connection to the frame grabber, and not changed while a connection is open.
+ * @param backend Which backend to use, of type DETECTOR_GRABBER_BACKEND.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ *         On failure, Grabber_Error_Number/Grabber_Error_String are set.
+ * @see #Grabber_Data
+ * @see #Grabber_XCLIB_Backend
+ * @see #Grabber_Error_Number
+ * @see #Grabber_Error_String
+ * @see detector_grabber.html#DETECTOR_GRABBER_BACKEND
+ * @see detector_grabber.html#DETECTOR_GRABBER_IS_BACKEND
+ * @see detector_grabber_simulator.html#Detector_Grabber_Simulator_Backend_Get
+ * @see detector_general.html#Detector_General_Log_Format
+ */
+int Detector_Grabber_Backend_Set(enum DETECTOR_GRABBER_BACKEND backend)
+{
+	Grabber_Error_Number = 0;
+#if LOGGING > 1
+	Detector_General_Log_Format(LOG_VERBOSITY_INTERMEDIATE,"Detector_Grabber_Backend_Set(backend = %d):Started.",
+				    backend);
+#endif
+	if(!DETECTOR_GRABBER_IS_BACKEND(backend))
+	{
+		Grabber_Error_Number = 1;
+		sprintf(Grabber_Error_String,"Detector_Grabber_Backend_Set:Illegal backend (%d).",backend);
+		return FALSE;
+	}
+	Grabber_Data.Backend = backend;
+	if(backend == DETECTOR_GRABBER_BACKEND_SIMULATOR)
+		Grabber_Data.Functions = Detector_Grabber_Simulator_Backend_Get();
+	else
+		Grabber_Data.Functions = &Grabber_XCLIB_Backend;
+#if LOGGING > 1
+	Detector_General_Log(LOG_VERBOSITY_INTERMEDIATE,"Detector_Grabber_Backend_Set:Finished.");
+#endif
+	return TRUE;
+}
+
+/**
+ * Return which frame grabber backend the detector library is talking to.
+ * @return The current backend, of type DETECTOR_GRABBER_BACKEND.
+ * @see #Grabber_Data
+ * @see detector_grabber.html#DETECTOR_GRABBER_BACKEND
+ */
+enum DETECTOR_GRABBER_BACKEND Detector_Grabber_Backend_Get(void)
+{
+	return Grabber_Data.Backend;
+}
+
+/**
+ * Open a connection to the frame grabber, and configure the video mode (pxd_PIXCIopen).
+ * @param driverparms A driver configuration parameter string.
+ * @param formatname The video format as a string, We usually set this to a blank string and use the formatfile instead.
+ * @param formatfile The filename of a '.fmt' format file, used to configure the video mode of the detector.
+ * @return A negative error code on failure, 0 or positive on success.
+ * @see #Grabber_Data
+ */
+int Detector_Grabber_Open(char *driverparms,char *formatname,char *formatfile)
+{
+	return Grabber_Data.Functions->Open(driverparms,formatname,formatfile);
+}
+
+/**
+ * Close the connection to the frame grabber (pxd_PIXCIclose).
+ * @return A negative error code on failure, 0 or positive on success.
+ * @see #Grabber_Data
+ */
+int Detector_Grabber_Close(void)
+{
+	return Grabber_Data.Functions->Close();
+}
+
+/**
+ * Return the number of frame grabber boards (units) opened (pxd_infoUnits).
+ * @return The number of units.
+ * @see #Grabber_Data
+ */
+int Detector_Grabber_Info_Units(void)
+{
+	return Grabber_Data.Functions->Info_Units();
+}
+
+/**
+ * Return the size of the frame buffer memory, in bytes (pxd_infoMemsize).
+ * @param unitmap A bitmap of which units to query.
+ * @return The frame buffer memory size in bytes.
+ * @see #Grabber_Data
+ */
+unsigned long Detector_Grabber_Info_Memsize(int unitmap)
+{
+	return Grabber_Data.Functions->Info_Memsize(unitmap);
+}
+
+/**
+ * Return the width of the frame grabber image, in pixels (pxd_imageXdim).
+ * @return The image width in pixels.
+ * @see #Grabber_Data
+ */
+int Detector_Grabber_Image_X_Dim(void)
+{
+	return Grabber_Data.Functions->Image_X_Dim();
+}
+
+/**
+ * Return the height of the frame grabber image, in pixels (pxd_imageYdim).
+ * @return The image height in pixels.
+ * @see #Grabber_Data
+ */
+int Detector_Grabber_Image_Y_Dim(void)
+{
+	return Grabber_Data.Functions->Image_Y_Dim();
+}
+
+/**
+ * Return the number of image frame buffers (pxd_imageZdim).
+ * @return The number of image frame buffers.
+ * @see #Grabber_Data
+ */
+int Detector_Grabber_Image_Z_Dim(void)
+{
+	return Grabber_Data.Functions->Image_Z_Dim();
+}
+
+/**
+ * Return the number of colour components per pixel (pxd_imageCdim).
+ * @return The number of colour components per pixel.
+ * @see #Grabber_Data
+ */
+int Detector_Grabber_Image_C_Dim(void)
+{
+	return Grabber_Data.Functions->Image_C_Dim();
+}
+
+/**
+ * Return the number of bits per pixel colour component (pxd_imageBdim).
+ * @return The number of bits per pixel colour component.
+ * @see #Grabber_Data
+ */
+int Detector_Grabber_Image_B_Dim(void)
+{
+	return Grabber_Data.Functions->Image_B_Dim();
+}
+
+/**
+ * Start capturing frames alternately into two frame buffers (pxd_goLivePair).
+ * @param unitmap A bitmap of which units to start.
+ * @param buffer1 The first frame buffer to capture into.
+ * @param buffer2 The second frame buffer to capture into.
+ * @return A negative error code on failure, 0 or positive on success.
+ * @see #Grabber_Data
+ */
+int Detector_Grabber_Go_Live_Pair(int unitmap,long buffer1,long buffer2)
+{
+	return Grabber_Data.Functions->Go_Live_Pair(unitmap,buffer1,buffer2);
+}
+
+/**
+ * Stop capturing frames (pxd_goAbortLive).
+ * @param unitmap A bitmap of which units to stop.
+ * @return A negative error code on failure, 0 or positive on success.
+ * @see #Grabber_Data
+ */
+int Detector_Grabber_Go_Abort_Live(int unitmap)
+{
+	return Grabber_Data.Functions->Go_Abort_Live(unitmap);
+}
+
+/**
+ * Return the field count of the last captured field (pxd_capturedFieldCount).
+ * @param unitmap A bitmap of which unit to query.
+ * @return The field count of the last captured field.
+ * @see #Grabber_Data
+ */
+unsigned long Detector_Grabber_Captured_Field_Count(int unitmap)
+{
+	return Grabber_Data.Functions->Captured_Field_Count(unitmap);
+}
+
+/**
+ * Return the frame buffer the last field was captured into (pxd_capturedBuffer).
+ * @param unitmap A bitmap of which unit to query.
+ * @return The frame buffer number of the last captured field.
+ * @see #Grabber_Data
+ */
+long Detector_Grabber_Captured_Buffer(int unitmap)
+{
+	return Grabber_Data.Functions->Captured_Buffer(unitmap);
+}
+
+/**
+ * Return the low 32 bits of the system ticks when the last field was captured (pxd_capturedSysTicks).
+ * @param unitmap A bitmap of which unit to query.
+ * @return The low 32 bits of the capture system ticks.
+ * @see #Grabber_Data
+ */
+unsigned int Detector_Grabber_Captured_Sys_Ticks(int unitmap)
+{
+	return Grabber_Data.Functions->Captured_Sys_Ticks(unitmap);
+}
+
+/**
+ * Return the high 32 bits of the system ticks when the last field was captured (pxd_capturedSysTicksHi).
+ * @param unitmap A bitmap of which unit to query.
+ * @return The high 32 bits of the capture system ticks.
+ * @see #Grabber_Data
+ */
+unsigned int Detector_Grabber_Captured_Sys_Ticks_Hi(int unitmap)
+{
+	return Grabber_Data.Functions->Captured_Sys_Ticks_Hi(unitmap);
+}
+
+/**
+ * Read a rectangle of pixels out of a frame buffer into memory (pxd_readushort).
+ * @param unitmap A bitmap of which unit to read from.
+ * @param buffer The frame buffer to read from.
+ * @param ulx The upper left X pixel of the rectangle.
+ * @param uly The upper left Y pixel of the rectangle.
+ * @param lrx The lower right X pixel of the rectangle (exclusive).
+ * @param lry The lower right Y pixel of the rectangle (exclusive).
+ * @param membase The memory to read the pixels into.
+ * @param count The number of pixels membase has room for.
+ * @param colorspace The colour space to read the pixels in, we use "Grey".
+ * @return A negative error code on failure, otherwise the number of pixels read.
+ * @see #Grabber_Data
+ */
+int Detector_Grabber_Read_UShort(int unitmap,long buffer,int ulx,int uly,int lrx,int lry,
+				 unsigned short *membase,size_t count,char *colorspace)
+{
+	return Grabber_Data.Functions->Read_UShort(unitmap,buffer,ulx,uly,lrx,lry,membase,count,colorspace);
+}
+
+/**
+ * Return a description of a negative error code returned by one of the other grabber routines (pxd_mesgErrorCode).
+ * @param error_code The error code.
+ * @return A string describing the error.
+ * @see #Grabber_Data
+ */
+char *Detector_Grabber_Error_Code_String(int error_code)
+{
+	return Grabber_Data.Functions->Error_Code_String(error_code);
+}
+
+/**
+ * Configure the camera link's internal serial connection to the camera head (pxd_serialConfigure).
+ * @param unitmap A bitmap of which unit to configure.
+ * @param rsvd0 Reserved, should be 0.
+ * @param baud The baud rate.
+ * @param bits The number of data bits.
+ * @param parity The parity.
+ * @param stopbits The number of stop bits.
+ * @param rsvd1 Reserved, should be 0.
+ * @param rsvd2 Reserved, should be 0.
+ * @param rsvd3 Reserved, should be 0.
+ * @return A negative error code on failure, 0 or positive on success.
+ * @see #Grabber_Data
+ */
+int Detector_Grabber_Serial_Configure(int unitmap,int rsvd0,double baud,int bits,int parity,int stopbits,
+				      int rsvd1,int rsvd2,int rsvd3)
+{
+	return Grabber_Data.Functions->Serial_Configure(unitmap,rsvd0,baud,bits,parity,stopbits,rsvd1,rsvd2,rsvd3);
+}
+
+/**
+ * Read any bytes waiting on the camera link's internal serial connection (pxd_serialRead).
+ * @param unitmap A bitmap of which unit to read from.
+ * @param rsvd0 Reserved, should be 0.
+ * @param buffer The buffer to read the bytes into.
+ * @param count The maximum number of bytes to read.
+ * @return A negative error code on failure, otherwise the number of bytes read (which may be 0).
+ * @see #Grabber_Data
+ */
+int Detector_Grabber_Serial_Read(int unitmap,int rsvd0,unsigned char *buffer,int count)
+{
+	return Grabber_Data.Functions->Serial_Read(unitmap,rsvd0,buffer,count);
+}
+
+/**
+ * Write bytes to the camera link's internal serial connection (pxd_serialWrite).
+ * @param unitmap A bitmap of which unit to write to.
+ * @param rsvd0 Reserved, should be 0.
+ * @param buffer The bytes to write.
+ * @param count The number of bytes to write.
+ * @return A negative error code on failure, 0 or positive on success.
+ * @see #Grabber_Data
+ */
+int Detector_Grabber_Serial_Write(int unitmap,int rsvd0,unsigned char *buffer,int count)
+{
+	return Grabber_Data.Functions->Serial_Write(unitmap,rsvd0,buffer,count);
+}
+
+/**
+ * Flush the camera link's internal serial connection (pxd_serialFlush).
+ * @param unitmap A bitmap of which unit to flush.
+ * @param rsvd0 Reserved, should be 0.
+ * @param rsvd1 If non-zero, flush the input stream.
+ * @param rsvd2 If non-zero, flush the output stream.
+ * @return A negative error code on failure, 0 or positive on success.
+ * @see #Grabber_Data
+ */
+int Detector_Grabber_Serial_Flush(int unitmap,int rsvd0,int rsvd1,int rsvd2)
+{
+	return Grabber_Data.Functions->Serial_Flush(unitmap,rsvd0,rsvd1,rsvd2);
+}
+
+/**
+ * Get the current value of the error number.
+ * @return The current value of the error number.
+ * @see #Grabber_Error_Number
+ */
+int Detector_Grabber_Get_Error_Number(void)
+{
+	return Grabber_Error_Number;
+}
+
+/**
+ * The error routine that reports any errors occuring in a standard way.
+ * @see #Grabber_Error_Number
+ * @see #Grabber_Error_String
+ * @see detector_general.html#Detector_General_Get_Current_Time_String
+ */
+void Detector_Grabber_Error(void)
+{
+	char time_string[32];
+
+	Detector_General_Get_Current_Time_String(time_string,32);
+	/* if the error number is zero an error message has not been set up
+	** This is in itself an error as we should not be calling this routine
+	** without there being an error to display */
+	if(Grabber_Error_Number == 0)
+		sprintf(Grabber_Error_String,"Logic Error:No Error defined");
+	fprintf(stderr,"%s Detector_Grabber:Error(%d) : %s\n",time_string,Grabber_Error_Number,Grabber_Error_String);
+}
+
+/**
+ * The error routine that reports any errors occuring in a standard way. This routine places the
+ * generated error string at the end of a passed in string argument.
+ * @param error_string A string to put the generated error in. This string should be initialised before
+ * being passed to this routine. The routine will try to concatenate it's error string onto the end
+ * of any string already in existance.
+ * @see #Grabber_Error_Number
+ * @see #Grabber_Error_String
+ * @see detector_general.html#Detector_General_Get_Current_Time_String
+ */
+void Detector_Grabber_Error_String(char *error_string)
+{
+	char time_string[32];
+
+	Detector_General_Get_Current_Time_String(time_string,32);
+	/* if the error number is zero an error message has not been set up
+	** This is in itself an error as we should not be calling this routine
+	** without there being an error to display */
+	if(Grabber_Error_Number == 0)
+		sprintf(Grabber_Error_String,"Logic Error:No Error defined");
+	sprintf(error_string+strlen(error_string),"%s Detector_Grabber:Error(%d) : %s\n",time_string,
+		Grabber_Error_Number,Grabber_Error_String);
+}
+
+/* =======================================
+**  internal functions
+** ======================================= */
+/**
+ * XCLIB backend open routine, calls pxd_PIXCIopen.
+ * @see #Detector_Grabber_Open
+ */
+static int Grabber_XCLIB_Open(char *driverparms,char *formatname,char *formatfile)
+{
+	return pxd_PIXCIopen(driverparms,formatname,formatfile);
+}
+
+/**
+ * XCLIB backend close routine, calls pxd_PIXCIclose.
+ * @see #Detector_Grabber_Close
+ */
+static int Grabber_XCLIB_Close(void)
+{
+	return pxd_PIXCIclose();
+}
+
+/**
+ * XCLIB backend routine, calls pxd_infoUnits.
+ * @see #Detector_Grabber_Info_Units
+ */
+static int Grabber_XCLIB_Info_Units(void)
+{
+	return pxd_infoUnits();
+}
+
+/**
+ * XCLIB backend routine, calls pxd_infoMemsize.
+ * @see #Detector_Grabber_Info_Memsize
+ */
+static unsigned long Grabber_XCLIB_Info_Memsize(int unitmap)
+{
+	return (unsigned long)pxd_infoMemsize(unitmap);
+}
+
+/**
+ * XCLIB backend routine, calls pxd_imageXdim.
+ * @see #Detector_Grabber_Image_X_Dim
+ */
+static int Grabber_XCLIB_Image_X_Dim(void)
+{
+	return pxd_imageXdim();
+}
+
+/**
+ * XCLIB backend routine, calls pxd_imageYdim.
+ * @see #Detector_Grabber_Image_Y_Dim
+ */
+static int Grabber_XCLIB_Image_Y_Dim(void)
+{
+	return pxd_imageYdim();
+}
+
+/**
+ * XCLIB backend routine, calls pxd_imageZdim.
+ * @see #Detector_Grabber_Image_Z_Dim
+ */
+static int Grabber_XCLIB_Image_Z_Dim(void)
+{
+	return pxd_imageZdim();
+}
+
+/**
+ * XCLIB backend routine, calls pxd_imageCdim.
+ * @see #Detector_Grabber_Image_C_Dim
+ */
+static int Grabber_XCLIB_Image_C_Dim(void)
+{
+	return pxd_imageCdim();
+}
+
+/**
+ * XCLIB backend routine, calls pxd_imageBdim.
+ * @see #Detector_Grabber_Image_B_Dim
+ */
+static int Grabber_XCLIB_Image_B_Dim(void)
+{
+	return pxd_imageBdim();
+}
+
+/**
+ * XCLIB backend routine, calls pxd_goLivePair.
+ * @see #Detector_Grabber_Go_Live_Pair
+ */
+static int Grabber_XCLIB_Go_Live_Pair(int unitmap,long buffer1,long buffer2)
+{
+	return pxd_goLivePair(unitmap,(pxbuffer_t)buffer1,(pxbuffer_t)buffer2);
+}
+
+/**
+ * XCLIB backend routine, calls pxd_goAbortLive.
+ * @see #Detector_Grabber_Go_Abort_Live
+ */
+static int Grabber_XCLIB_Go_Abort_Live(int unitmap)
+{
+	return pxd_goAbortLive(unitmap);
+}
+
+/**
+ * XCLIB backend routine, calls pxd_capturedFieldCount.
+ * @see #Detector_Grabber_Captured_Field_Count
+ */
+static unsigned long Grabber_XCLIB_Captured_Field_Count(int unitmap)
+{
+	return (unsigned long)pxd_capturedFieldCount(unitmap);
+}
+
+/**
+ * XCLIB backend routine, calls pxd_capturedBuffer.
+ * @see #Detector_Grabber_Captured_Buffer
+ */
+static long Grabber_XCLIB_Captured_Buffer(int unitmap)
+{
+	return (long)pxd_capturedBuffer(unitmap);
+}
+
+/**
+ * XCLIB backend routine, calls pxd_capturedSysTicks.
+ * @see #Detector_Grabber_Captured_Sys_Ticks
+ */
+static unsigned int Grabber_XCLIB_Captured_Sys_Ticks(int unitmap)
+{
+	return (unsigned int)pxd_capturedSysTicks(unitmap);
+}
+
+/**
+ * XCLIB backend routine, calls pxd_capturedSysTicksHi.
+ * @see #Detector_Grabber_Captured_Sys_Ticks_Hi
+ */
+static unsigned int Grabber_XCLIB_Captured_Sys_Ticks_Hi(int unitmap)
+{
+	return (unsigned int)pxd_capturedSysTicksHi(unitmap);
+}
+
+/**
+ * XCLIB backend routine, calls pxd_readushort.
+ * @see #Detector_Grabber_Read_UShort
+ */
+static int Grabber_XCLIB_Read_UShort(int unitmap,long buffer,int ulx,int uly,int lrx,int lry,
+				     unsigned short *membase,size_t count,char *colorspace)
+{
+	return pxd_readushort(unitmap,(pxbuffer_t)buffer,ulx,uly,lrx,lry,membase,count,colorspace);
+}
+
+/**
+ * XCLIB backend routine, calls pxd_mesgErrorCode.
+ * @see #Detector_Grabber_Error_Code_String
+ */
+static char *Grabber_XCLIB_Error_Code_String(int error_code)
+{
+	return pxd_mesgErrorCode(error_code);
+}
+
+/**
+ * XCLIB backend routine, calls pxd_serialConfigure.
+ * @see #Detector_Grabber_Serial_Configure
+ */
+static int Grabber_XCLIB_Serial_Configure(int unitmap,int rsvd0,double baud,int bits,int parity,int stopbits,
+					  int rsvd1,int rsvd2,int rsvd3)
+{
+	return pxd_serialConfigure(unitmap,rsvd0,baud,bits,parity,stopbits,rsvd1,rsvd2,rsvd3);
+}
+
+/**
+ * XCLIB backend routine, calls pxd_serialRead.
+ * @see #Detector_Grabber_Serial_Read
+ */
+static int Grabber_XCLIB_Serial_Read(int unitmap,int rsvd0,unsigned char *buffer,int count)
+{
+	return pxd_serialRead(unitmap,rsvd0,(char *)buffer,count);
+}
+
+/**
+ * XCLIB backend routine, calls pxd_serialWrite.
+ * @see #Detector_Grabber_Serial_Write
+ */
+static int Grabber_XCLIB_Serial_Write(int unitmap,int rsvd0,unsigned char *buffer,int count)
+{
+	return pxd_serialWrite(unitmap,rsvd0,(char *)buffer,count);
+}
+
+/**
+ * XCLIB backend routine, calls pxd_serialFlush.
+ * @see #Detector_Grabber_Serial_Flush
+ */
+static int Grabber_XCLIB_Serial_Flush(int unitmap,int rsvd0,int rsvd1,int rsvd2)
+{
+	return pxd_serialFlush(unitmap,rsvd0,rsvd1,rsvd2);
+}
@@ -0,0 +1,1150 @@
+/* detector_grabber_simulator.c
+** Raptor Ninox-640 Infrared detector library : simulated frame grabber backend routines.
+*/
+/**
+ * A simulated frame grabber and Raptor Ninox-640 camera head, that can be selected as the frame grabber backend
+ * (see detector_grabber) instead of the EPIX XCLIB library. This allows the acquisition path (exposure loop,
+ * readout, coaddition, FITS saving) and the serial command set (system status, manufacturers data, temperature,
+ * TEC and FPGA control) to be tested and benchmarked without any hardware.
+ * <ul>
+ * <li>Frames are generated at the simulated field period, the captured field count and system ticks advance in
+ *     real time whilst the grabber is live.
+ * <li>Reading out a frame buffer generates a synthetic 14 bit image (bias, gradient and noise) that depends only
+ *     on the pixel position and the field captured into that buffer, so repeated (or strip by strip)
+ *     readouts of the same field return identical pixels.
+ * <li>Serial commands are parsed and replied to as the camera head does, including command acknowledgements and
+ *     checksums. The sensor temperature relaxes towards the TEC setpoint (or ambient if the TEC is disabled).
+ * </ul>
+ * @author Chris Mottram
+ * @version $Revision$
+ */
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "log_udp.h"
+#include "detector_general.h"
+#include "detector_grabber.h"
+#include "detector_grabber_simulator.h"
+#include "detector_serial.h"
+
+/* hash defines */
+/**
+ * The width of the simulated image, in pixels.
+ */
+#define SIMULATOR_IMAGE_X_DIM          (640)
+/**
+ * The height of the simulated image, in pixels.
+ */
+#define SIMULATOR_IMAGE_Y_DIM          (512)
+/**
+ * The number of simulated frame buffers.
+ */
+#define SIMULATOR_IMAGE_Z_DIM          (4)
+/**
+ * The number of bits per pixel of the simulated image (the Raptor Ninox-640 has a 14 bit ADC).
+ */
+#define SIMULATOR_IMAGE_B_DIM          (14)
+/**
+ * The bias level of the simulated image, in ADU.
+ */
+#define SIMULATOR_BIAS_LEVEL           (1000)
+/**
+ * A mask applied to the pseudo-random numbers to generate the simulated pixel noise, in ADU.
+ */
+#define SIMULATOR_NOISE_MASK           (0x3F)
+/**
+ * The length of the simulated serial reply queue, in bytes.
+ */
+#define SIMULATOR_REPLY_LENGTH         (256)
+/**
+ * The ambient temperature the simulated sensor relaxes to when the TEC is disabled, in degrees centigrade.
+ */
+#define SIMULATOR_AMBIENT_TEMPERATURE  (20.0)
+/**
+ * The simulated PCB temperature, in degrees centigrade.
+ */
+#define SIMULATOR_PCB_TEMPERATURE      (25.0)
+/**
+ * The time constant of the simulated sensor temperature, in seconds.
+ */
+#define SIMULATOR_TEMPERATURE_TAU      (60.0)
+/**
+ * The simulated manufacturers data ADC value at 0 degrees C.
+ */
+#define SIMULATOR_ADC_ZERO_C           (4000)
+/**
+ * The simulated manufacturers data ADC value at 40 degrees C.
+ */
+#define SIMULATOR_ADC_FORTY_C          (2000)
+/**
+ * The simulated manufacturers data DAC value at 0 degrees C.
+ */
+#define SIMULATOR_DAC_ZERO_C           (4000)
+/**
+ * The simulated manufacturers data DAC value at 40 degrees C.
+ */
+#define SIMULATOR_DAC_FORTY_C          (2000)
+/**
+ * The simulated camera head serial number.
+ */
+#define SIMULATOR_SERIAL_NUMBER        (1234)
+/**
+ * The register address of the FPGA control register.
+ */
+#define SIMULATOR_REGISTER_FPGA_CTRL   (0x00)
+/**
+ * The register address of the most significant byte of the sensor temperature ADC value.
+ */
+#define SIMULATOR_REGISTER_SENSOR_MSB  (0x6E)
+/**
+ * The register address of the least significant byte of the sensor temperature ADC value.
+ */
+#define SIMULATOR_REGISTER_SENSOR_LSB  (0x6F)
+/**
+ * The register address of the most significant byte of the PCB temperature.
+ */
+#define SIMULATOR_REGISTER_PCB_MSB     (0x70)
+/**
+ * The register address of the least significant byte of the PCB temperature.
+ */
+#define SIMULATOR_REGISTER_PCB_LSB     (0x71)
+/**
+ * The register address of the least significant byte of the TEC setpoint DAC value.
+ */
+#define SIMULATOR_REGISTER_TEC_LSB     (0xFA)
+/**
+ * The register address of the most significant byte of the TEC setpoint DAC value.
+ */
+#define SIMULATOR_REGISTER_TEC_MSB     (0xFB)
+/**
+ * Serial command to read the system status register.
+ */
+#define SIMULATOR_STATUS_REGISTER_READ  (0x49)
+/**
+ * Serial command to write the system status register.
+ */
+#define SIMULATOR_STATUS_REGISTER_WRITE (0x4F)
+/**
+ * Serial end of transmission byte, terminating commands and acknowledging successful commands.
+ */
+#define SIMULATOR_ETX                   (0x50)
+/**
+ * Serial reply byte sent when a command's checksum is wrong.
+ */
+#define SIMULATOR_ETX_CK_SUM_ERR        (0x52)
+/**
+ * Serial reply byte sent when a command is not recognised.
+ */
+#define SIMULATOR_ETX_UNKNOWN_CMD       (0x54)
+/**
+ * System status bit set when checksums are enabled.
+ */
+#define SIMULATOR_STATUS_CHECKSUM      (1<<6)
+/**
+ * System status bit set when command acknowledgements are enabled.
+ */
+#define SIMULATOR_STATUS_CMD_ACK       (1<<4)
+/**
+ * System status bit set when the FPGA has booted.
+ */
+#define SIMULATOR_STATUS_FPGA_BOOTED   (1<<2)
+/**
+ * System status bit set when the FPGA is NOT held in reset.
+ */
+#define SIMULATOR_STATUS_FPGA_RUNNING  (1<<1)
+/**
+ * System status bit set when comms to the FPGA EPROM are enabled.
+ */
+#define SIMULATOR_STATUS_EPROM_COMMS   (1<<0)
+/**
+ * Simulator error code: the simulated frame grabber has not been opened.
+ */
+#define SIMULATOR_ERROR_NOT_OPEN       (-1)
+/**
+ * Simulator error code: an illegal frame buffer number was specified.
+ */
+#define SIMULATOR_ERROR_BUFFER         (-2)
+/**
+ * Simulator error code: an illegal readout rectangle was specified.
+ */
+#define SIMULATOR_ERROR_RECTANGLE      (-3)
+/**
+ * Simulator error code: the readout memory is too small for the readout rectangle.
+ */
+#define SIMULATOR_ERROR_COUNT          (-4)
+/**
+ * Simulator error code: an illegal serial write.
+ */
+#define SIMULATOR_ERROR_SERIAL         (-5)
+/**
+ * Simulator error code: an illegal colour space was specified.
+ */
+#define SIMULATOR_ERROR_COLORSPACE     (-6)
+
+/* data types */
+/**
+ * Data type holding local data to detector_grabber_simulator. This consists of the following:
+ * <dl>
+ * <dt>Field_Period_Ms</dt> <dd>The configured simulated field period in milliseconds, or 0 to derive it from the
+ *     format filename passed to Open.</dd>
+ * <dt>Current_Field_Period_Ms</dt> <dd>The simulated field period currently in use, in milliseconds.</dd>
+ * <dt>Is_Open</dt> <dd>A boolean, whether the simulated frame grabber is open.</dd>
+ * <dt>Is_Live</dt> <dd>A boolean, whether the simulated frame grabber is capturing fields.</dd>
+ * <dt>Buffer_List</dt> <dd>The pair of frame buffers being captured into (alternately) whilst live.</dd>
+ * <dt>Live_Start_Us</dt> <dd>The monotonic time the simulated frame grabber went live, in microseconds.</dd>
+ * <dt>Live_Start_Field_Count</dt> <dd>The captured field count when the simulated frame grabber went live.</dd>
+ * <dt>Field_Count</dt> <dd>The captured field count when the simulated frame grabber was last stopped.</dd>
+ * <dt>Field_Sys_Ticks</dt> <dd>The system ticks (microseconds) of the last captured field when the simulated
+ *     frame grabber was last stopped.</dd>
+ * <dt>Field_Buffer</dt> <dd>The frame buffer of the last captured field when the simulated
+ *     frame grabber was last stopped.</dd>
+ * <dt>Buffer_Field_Count</dt> <dd>The field count of the field last captured into each frame buffer
+ *     (updated when the simulated frame grabber is stopped).</dd>
+ * <dt>System_Status</dt> <dd>The camera head's system status byte.</dd>
+ * <dt>Register_Address</dt> <dd>The camera head register address set by the last 'set address' command.</dd>
+ * <dt>Register_List</dt> <dd>The camera head's registers.</dd>
+ * <dt>Reply_Buffer</dt> <dd>The queue of serial reply bytes not yet read.</dd>
+ * <dt>Reply_Length</dt> <dd>The number of bytes in Reply_Buffer.</dd>
+ * <dt>Reply_Index</dt> <dd>The index in Reply_Buffer of the next byte to read.</dd>
+ * <dt>Sensor_Temperature</dt> <dd>The simulated sensor temperature, in degrees centigrade.</dd>
+ * <dt>Sensor_Temperature_Us</dt> <dd>The monotonic time the simulated sensor temperature was last updated,
+ *     in microseconds.</dd>
+ * </dl>
+ */
+struct Simulator_Struct
+{
+	int Field_Period_Ms;
+	int Current_Field_Period_Ms;
+	int Is_Open;
+	int Is_Live;
+	long Buffer_List[2];
+	unsigned long long Live_Start_Us;
+	unsigned long Live_Start_Field_Count;
+	unsigned long Field_Count;
+	unsigned long long Field_Sys_Ticks;
+	long Field_Buffer;
+	unsigned long Buffer_Field_Count[SIMULATOR_IMAGE_Z_DIM+1];
+	unsigned char System_Status;
+	unsigned char Register_Address;
+	unsigned char Register_List[256];
+	unsigned char Reply_Buffer[SIMULATOR_REPLY_LENGTH];
+	int Reply_Length;
+	int Reply_Index;
+	double Sensor_Temperature;
+	unsigned long long Sensor_Temperature_Us;
+};
+
+/* internal functions */
+static int Simulator_Open(char *driverparms,char *formatname,char *formatfile);
+static int Simulator_Close(void);
+static int Simulator_Info_Units(void);
+static unsigned long Simulator_Info_Memsize(int unitmap);
+static int Simulator_Image_X_Dim(void);
+static int Simulator_Image_Y_Dim(void);
+static int Simulator_Image_Z_Dim(void);
+static int Simulator_Image_C_Dim(void);
+static int Simulator_Image_B_Dim(void);
+static int Simulator_Go_Live_Pair(int unitmap,long buffer1,long buffer2);
+static int Simulator_Go_Abort_Live(int unitmap);
+static unsigned long Simulator_Captured_Field_Count(int unitmap);
+static long Simulator_Captured_Buffer(int unitmap);
+static unsigned int Simulator_Captured_Sys_Ticks(int unitmap);
+static unsigned int Simulator_Captured_Sys_Ticks_Hi(int unitmap);
+static int Simulator_Read_UShort(int unitmap,long buffer,int ulx,int uly,int lrx,int lry,
+				 unsigned short *membase,size_t count,char *colorspace);
+static char *Simulator_Error_Code_String(int error_code);
+static int Simulator_Serial_Configure(int unitmap,int rsvd0,double baud,int bits,int parity,int stopbits,
+				      int rsvd1,int rsvd2,int rsvd3);
+static int Simulator_Serial_Read(int unitmap,int rsvd0,unsigned char *buffer,int count);
+static int Simulator_Serial_Write(int unitmap,int rsvd0,unsigned char *buffer,int count);
+static int Simulator_Serial_Flush(int unitmap,int rsvd0,int rsvd1,int rsvd2);
+static unsigned long long Simulator_Get_Time_Us(void);
+static void Simulator_Get_Last_Field(unsigned long *field_count,unsigned long long *sys_ticks,long *buffer);
+static void Simulator_Reply_Add(unsigned char *data,int data_length,unsigned char checksum,int ack);
+static void Simulator_Temperature_Update(void);
+static double Simulator_DAC_To_Temperature(int dac_value);
+
+/* internal variables */
+/**
+ * Revision Control System identifier.
+ */
+static char rcsid[] = "$Id$";
+/**
+ * The set of functions implementing the simulator backend.
+ * @see detector_grabber.html#Detector_Grabber_Backend_Struct
+ */
+static struct Detector_Grabber_Backend_Struct Simulator_Backend =
+{
+	Simulator_Open,Simulator_Close,Simulator_Info_Units,Simulator_Info_Memsize,
+	Simulator_Image_X_Dim,Simulator_Image_Y_Dim,Simulator_Image_Z_Dim,Simulator_Image_C_Dim,
+	Simulator_Image_B_Dim,Simulator_Go_Live_Pair,Simulator_Go_Abort_Live,
+	Simulator_Captured_Field_Count,Simulator_Captured_Buffer,Simulator_Captured_Sys_Ticks,
+	Simulator_Captured_Sys_Ticks_Hi,Simulator_Read_UShort,Simulator_Error_Code_String,
+	Simulator_Serial_Configure,Simulator_Serial_Read,Simulator_Serial_Write,Simulator_Serial_Flush
+};
+/**
+ * The instance of Simulator_Struct that contains local data for this module. This is initialised as follows:
+ * <dl>
+ * <dt>Field_Period_Ms</dt> <dd>0</dd>
+ * <dt>Current_Field_Period_Ms</dt> <dd>DETECTOR_GRABBER_SIMULATOR_DEFAULT_FIELD_PERIOD_MS</dd>
+ * <dt>Is_Open</dt> <dd>FALSE</dd>
+ * <dt>Is_Live</dt> <dd>FALSE</dd>
+ * <dt>Buffer_List</dt> <dd>{1,2}</dd>
+ * <dt>Live_Start_Us</dt> <dd>0</dd>
+ * <dt>Live_Start_Field_Count</dt> <dd>0</dd>
+ * <dt>Field_Count</dt> <dd>0</dd>
+ * <dt>Field_Sys_Ticks</dt> <dd>0</dd>
+ * <dt>Field_Buffer</dt> <dd>1</dd>
+ * <dt>Buffer_Field_Count</dt> <dd>{0,...}</dd>
+ * <dt>System_Status</dt> <dd>SIMULATOR_STATUS_FPGA_BOOTED|SIMULATOR_STATUS_FPGA_RUNNING</dd>
+ * <dt>Register_Address</dt> <dd>0</dd>
+ * <dt>Register_List</dt> <dd>{0,...} (setup in Simulator_Open)</dd>
+ * <dt>Reply_Buffer</dt> <dd>{0,...}</dd>
+ * <dt>Reply_Length</dt> <dd>0</dd>
+ * <dt>Reply_Index</dt> <dd>0</dd>
+ * <dt>Sensor_Temperature</dt> <dd>SIMULATOR_AMBIENT_TEMPERATURE</dd>
+ * <dt>Sensor_Temperature_Us</dt> <dd>0</dd>
+ * </dl>
+ * @see #DETECTOR_GRABBER_SIMULATOR_DEFAULT_FIELD_PERIOD_MS
+ * @see #SIMULATOR_STATUS_FPGA_BOOTED
+ * @see #SIMULATOR_STATUS_FPGA_RUNNING
+ * @see #SIMULATOR_AMBIENT_TEMPERATURE
+ */
+static struct Simulator_Struct Simulator_Data =
+{
+	0,DETECTOR_GRABBER_SIMULATOR_DEFAULT_FIELD_PERIOD_MS,FALSE,FALSE,{1,2},0,0,0,0,1,{0},
+	SIMULATOR_STATUS_FPGA_BOOTED|SIMULATOR_STATUS_FPGA_RUNNING,0,{0},{0},0,0,
+	SIMULATOR_AMBIENT_TEMPERATURE,0
+};
+
+/**
+ * Variable holding error code of last operation performed.
+ */
+static int Simulator_Error_Number = 0;
+/**
+ * Local variable holding description of the last error that occured.
+ * @see detector_general.html#DETECTOR_GENERAL_ERROR_STRING_LENGTH
+ */
+static char Simulator_Error_String[DETECTOR_GENERAL_ERROR_STRING_LENGTH] = "";
+
+/* --------------------------------------------------------
+** External Functions
+** -------------------------------------------------------- */
+/**
+ * Return the set of functions implementing the simulator backend, for use by detector_grabber.
+ * @return A pointer to the simulator backend functions.
+ * @see #Simulator_Backend
+ * @see detector_grabber.html#Detector_Grabber_Backend_Set
+ */
+struct Detector_Grabber_Backend_Struct *Detector_Grabber_Simulator_Backend_Get(void)
+{
+	return &Simulator_Backend;
+}
+
+/**
+ * Set the simulated field (frame) period. This takes effect the next time the simulated frame grabber is opened.
+ * @param field_period_ms The simulated field period in milliseconds. This should be 0, in which case the field
+ *        period is derived from the format filename ('rap_&lt;N&gt;ms.fmt') passed to the open routine, or
+ *        at least DETECTOR_GRABBER_SIMULATOR_MIN_FIELD_PERIOD_MS.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ *         On failure, Simulator_Error_Number/Simulator_Error_String are set.
+ * @see #DETECTOR_GRABBER_SIMULATOR_MIN_FIELD_PERIOD_MS
+ * @see #Simulator_Data
+ * @see #Simulator_Error_Number
+ * @see #Simulator_Error_String
+ */
+int Detector_Grabber_Simulator_Field_Period_Set(int field_period_ms)
+{
+	Simulator_Error_Number = 0;
+	if((field_period_ms != 0)&&(field_period_ms < DETECTOR_GRABBER_SIMULATOR_MIN_FIELD_PERIOD_MS))
+	{
+		Simulator_Error_Number = 1;
+		sprintf(Simulator_Error_String,"Detector_Grabber_Simulator_Field_Period_Set:"
+			"Illegal field period %d ms (should be 0 or at least %d ms).",field_period_ms,
+			DETECTOR_GRABBER_SIMULATOR_MIN_FIELD_PERIOD_MS);
+		return FALSE;
+	}
+	Simulator_Data.Field_Period_Ms = field_period_ms;
+	return TRUE;
+}
+
+/**
+ * Get the simulated field (frame) period currently in use.
+ * @return The simulated field period in milliseconds.
+ * @see #Simulator_Data
+ */
+int Detector_Grabber_Simulator_Field_Period_Get(void)
+{
+	return Simulator_Data.Current_Field_Period_Ms;
+}
+
+/**
+ * Get the current value of the error number.
+ * @return The current value of the error number.
+ * @see #Simulator_Error_Number
+ */
+int Detector_Grabber_Simulator_Get_Error_Number(void)
+{
+	return Simulator_Error_Number;
+}
+
+/**
+ * The error routine that reports any errors occuring in a standard way.
+ * @see #Simulator_Error_Number
+ * @see #Simulator_Error_String
+ * @see detector_general.html#Detector_General_Get_Current_Time_String
+ */
+void Detector_Grabber_Simulator_Error(void)
+{
+	char time_string[32];
+
+	Detector_General_Get_Current_Time_String(time_string,32);
+	/* if the error number is zero an error message has not been set up
+	** This is in itself an error as we should not be calling this routine
+	** without there being an error to display */
+	if(Simulator_Error_Number == 0)
+		sprintf(Simulator_Error_String,"Logic Error:No Error defined");
+	fprintf(stderr,"%s Detector_Grabber_Simulator:Error(%d) : %s\n",time_string,Simulator_Error_Number,
+		Simulator_Error_String);
+}
+
+/**
+ * The error routine that reports any errors occuring in a standard way. This routine places the
+ * generated error string at the end of a passed in string argument.
+ * @param error_string A string to put the generated error in. This string should be initialised before
+ * being passed to this routine. The routine will try to concatenate it's error string onto the end
+ * of any string already in existance.
+ * @see #Simulator_Error_Number
+ * @see #Simulator_Error_String
+ * @see detector_general.html#Detector_General_Get_Current_Time_String
+ */
+void Detector_Grabber_Simulator_Error_String(char *error_string)
+{
+	char time_string[32];
+
+	Detector_General_Get_Current_Time_String(time_string,32);
+	/* if the error number is zero an error message has not been set up
+	** This is in itself an error as we should not be calling this routine
+	** without there being an error to display */
+	if(Simulator_Error_Number == 0)
+		sprintf(Simulator_Error_String,"Logic Error:No Error defined");
+	sprintf(error_string+strlen(error_string),"%s Detector_Grabber_Simulator:Error(%d) : %s\n",time_string,
+		Simulator_Error_Number,Simulator_Error_String);
+}
+
+/* =======================================
+**  internal functions
+** ======================================= */
+/**
+ * Open the simulated frame grabber.
+ * <ul>
+ * <li>If Field_Period_Ms is non-zero, we use it as the simulated field period. Otherwise we try to parse
+ *     the field period out of the format filename ('rap_&lt;N&gt;ms.fmt'), falling back to
+ *     DETECTOR_GRABBER_SIMULATOR_DEFAULT_FIELD_PERIOD_MS.
+ * <li>We reset the camera head's system status, registers, serial reply queue and sensor temperature.
+ * </ul>
+ * @param driverparms A driver configuration parameter string (ignored).
+ * @param formatname The video format as a string (ignored).
+ * @param formatfile The filename of a '.fmt' format file, used to derive the field period.
+ * @return 0 on success.
+ * @see #Simulator_Data
+ * @see #Simulator_Get_Time_Us
+ * @see #DETECTOR_GRABBER_SIMULATOR_DEFAULT_FIELD_PERIOD_MS
+ * @see #DETECTOR_GRABBER_SIMULATOR_MIN_FIELD_PERIOD_MS
+ */
+static int Simulator_Open(char *driverparms,char *formatname,char *formatfile)
+{
+	char *basename_string = NULL;
+	int field_period_ms,dac_value;
+
+	if(Simulator_Data.Field_Period_Ms > 0)
+		Simulator_Data.Current_Field_Period_Ms = Simulator_Data.Field_Period_Ms;
+	else
+	{
+		Simulator_Data.Current_Field_Period_Ms = DETECTOR_GRABBER_SIMULATOR_DEFAULT_FIELD_PERIOD_MS;
+		if(formatfile != NULL)
+		{
+			basename_string = strrchr(formatfile,'/');
+			if(basename_string != NULL)
+				basename_string++;
+			else
+				basename_string = formatfile;
+			if((sscanf(basename_string,"rap_%dms.fmt",&field_period_ms) == 1)&&
+			   (field_period_ms >= DETECTOR_GRABBER_SIMULATOR_MIN_FIELD_PERIOD_MS))
+				Simulator_Data.Current_Field_Period_Ms = field_period_ms;
+		}
+	}
+#if LOGGING > 1
+	Detector_General_Log_Format(LOG_VERBOSITY_INTERMEDIATE,
+				    "Simulator_Open:Opened simulated frame grabber with field period %d ms.",
+				    Simulator_Data.Current_Field_Period_Ms);
+#endif
+	Simulator_Data.Is_Open = TRUE;
+	Simulator_Data.Is_Live = FALSE;
+	Simulator_Data.System_Status = SIMULATOR_STATUS_FPGA_BOOTED|SIMULATOR_STATUS_FPGA_RUNNING;
+	Simulator_Data.Register_Address = 0;
+	memset(Simulator_Data.Register_List,0,sizeof(Simulator_Data.Register_List));
+	Simulator_Data.Register_List[SIMULATOR_REGISTER_FPGA_CTRL] = DETECTOR_SERIAL_FPGA_CTRL_TEC_ENABLED|
+		DETECTOR_SERIAL_FPGA_CTRL_FAN_ENABLED;
+	/* TEC setpoint defaults to the ambient temperature */
+	dac_value = SIMULATOR_DAC_ZERO_C+(int)(((double)(SIMULATOR_DAC_FORTY_C-SIMULATOR_DAC_ZERO_C))*
+					       SIMULATOR_AMBIENT_TEMPERATURE/40.0);
+	Simulator_Data.Register_List[SIMULATOR_REGISTER_TEC_MSB] = (dac_value>>8)&0xFF;
+	Simulator_Data.Register_List[SIMULATOR_REGISTER_TEC_LSB] = dac_value&0xFF;
+	Simulator_Data.Reply_Length = 0;
+	Simulator_Data.Reply_Index = 0;
+	Simulator_Data.Sensor_Temperature = SIMULATOR_AMBIENT_TEMPERATURE;
+	Simulator_Data.Sensor_Temperature_Us = Simulator_Get_Time_Us();
+	return 0;
+}
+
+/**
+ * Close the simulated frame grabber.
+ * @return 0 on success.
+ * @see #Simulator_Data
+ */
+static int Simulator_Close(void)
+{
+	Simulator_Data.Is_Open = FALSE;
+	Simulator_Data.Is_Live = FALSE;
+	return 0;
+}
+
+/**
+ * Return the number of simulated frame grabber units.
+ * @return 1 if the simulated frame grabber is open, otherwise 0.
+ * @see #Simulator_Data
+ */
+static int Simulator_Info_Units(void)
+{
+	if(Simulator_Data.Is_Open)
+		return 1;
+	return 0;
+}
+
+/**
+ * Return the size of the simulated frame buffer memory.
+ * @param unitmap A bitmap of which units to query.
+ * @return The simulated frame buffer memory size in bytes.
+ * @see #SIMULATOR_IMAGE_X_DIM
+ * @see #SIMULATOR_IMAGE_Y_DIM
+ * @see #SIMULATOR_IMAGE_Z_DIM
+ */
+static unsigned long Simulator_Info_Memsize(int unitmap)
+{
+	return ((unsigned long)SIMULATOR_IMAGE_X_DIM)*SIMULATOR_IMAGE_Y_DIM*SIMULATOR_IMAGE_Z_DIM*
+		sizeof(unsigned short);
+}
+
+/**
+ * Return the width of the simulated image.
+ * @return The image width in pixels.
+ * @see #SIMULATOR_IMAGE_X_DIM
+ */
+static int Simulator_Image_X_Dim(void)
+{
+	return SIMULATOR_IMAGE_X_DIM;
+}
+
+/**
+ * Return the height of the simulated image.
+ * @return The image height in pixels.
+ * @see #SIMULATOR_IMAGE_Y_DIM
+ */
+static int Simulator_Image_Y_Dim(void)
+{
+	return SIMULATOR_IMAGE_Y_DIM;
+}
+
+/**
+ * Return the number of simulated frame buffers.
+ * @return The number of frame buffers.
+ * @see #SIMULATOR_IMAGE_Z_DIM
+ */
+static int Simulator_Image_Z_Dim(void)
+{
+	return SIMULATOR_IMAGE_Z_DIM;
+}
+
+/**
+ * Return the number of colour components per simulated pixel.
+ * @return 1 (monochrome).
+ */
+static int Simulator_Image_C_Dim(void)
+{
+	return 1;
+}
+
+/**
+ * Return the number of bits per simulated pixel.
+ * @return The number of bits per pixel.
+ * @see #SIMULATOR_IMAGE_B_DIM
+ */
+static int Simulator_Image_B_Dim(void)
+{
+	return SIMULATOR_IMAGE_B_DIM;
+}
+
+/**
+ * Start the simulated frame grabber capturing fields alternately into two frame buffers. Fields are then
+ * captured every Current_Field_Period_Ms milliseconds.
+ * @param unitmap A bitmap of which units to start.
+ * @param buffer1 The first frame buffer to capture into.
+ * @param buffer2 The second frame buffer to capture into.
+ * @return 0 on success, or a negative simulator error code on failure.
+ * @see #Simulator_Data
+ * @see #Simulator_Get_Time_Us
+ * @see #Simulator_Go_Abort_Live
+ * @see #SIMULATOR_ERROR_NOT_OPEN
+ * @see #SIMULATOR_ERROR_BUFFER
+ */
+static int Simulator_Go_Live_Pair(int unitmap,long buffer1,long buffer2)
+{
+	if(Simulator_Data.Is_Open == FALSE)
+		return SIMULATOR_ERROR_NOT_OPEN;
+	if((buffer1 < 1)||(buffer1 > SIMULATOR_IMAGE_Z_DIM)||(buffer2 < 1)||(buffer2 > SIMULATOR_IMAGE_Z_DIM))
+		return SIMULATOR_ERROR_BUFFER;
+	/* stop any previous capture, so Field_Count etc are up to date */
+	Simulator_Go_Abort_Live(unitmap);
+	Simulator_Data.Buffer_List[0] = buffer1;
+	Simulator_Data.Buffer_List[1] = buffer2;
+	Simulator_Data.Live_Start_Field_Count = Simulator_Data.Field_Count;
+	Simulator_Data.Live_Start_Us = Simulator_Get_Time_Us();
+	Simulator_Data.Is_Live = TRUE;
+	return 0;
+}
+
+/**
+ * Stop the simulated frame grabber capturing fields. We freeze the captured field count, system ticks
+ * and buffer of the last captured field, and record which field was last captured into each frame buffer.
+ * @param unitmap A bitmap of which units to stop.
+ * @return 0 on success, or a negative simulator error code on failure.
+ * @see #Simulator_Data
+ * @see #Simulator_Get_Last_Field
+ * @see #SIMULATOR_ERROR_NOT_OPEN
+ */
+static int Simulator_Go_Abort_Live(int unitmap)
+{
+	unsigned long field_count;
+	unsigned long long sys_ticks;
+	long buffer;
+
+	if(Simulator_Data.Is_Open == FALSE)
+		return SIMULATOR_ERROR_NOT_OPEN;
+	if(Simulator_Data.Is_Live == FALSE)
+		return 0;
+	Simulator_Get_Last_Field(&field_count,&sys_ticks,&buffer);
+	if(field_count > Simulator_Data.Live_Start_Field_Count)
+	{
+		Simulator_Data.Buffer_Field_Count[buffer] = field_count;
+		if(field_count > Simulator_Data.Live_Start_Field_Count+1)
+		{
+			if(buffer == Simulator_Data.Buffer_List[0])
+				Simulator_Data.Buffer_Field_Count[Simulator_Data.Buffer_List[1]] = field_count-1;
+			else
+				Simulator_Data.Buffer_Field_Count[Simulator_Data.Buffer_List[0]] = field_count-1;
+		}
+	}
+	Simulator_Data.Field_Count = field_count;
+	Simulator_Data.Field_Sys_Ticks = sys_ticks;
+	Simulator_Data.Field_Buffer = buffer;
+	Simulator_Data.Is_Live = FALSE;
+	return 0;
+}
+
+/**
+ * Return the field count of the last captured simulated field.
+ * @param unitmap A bitmap of which unit to query.
+ * @return The field count of the last captured field.
+ * @see #Simulator_Get_Last_Field
+ */
+static unsigned long Simulator_Captured_Field_Count(int unitmap)
+{
+	unsigned long field_count;
+
+	Simulator_Get_Last_Field(&field_count,NULL,NULL);
+	return field_count;
+}
+
+/**
+ * Return the frame buffer the last simulated field was captured into.
+ * @param unitmap A bitmap of which unit to query.
+ * @return The frame buffer number of the last captured field.
+ * @see #Simulator_Get_Last_Field
+ */
+static long Simulator_Captured_Buffer(int unitmap)
+{
+	long buffer;
+
+	Simulator_Get_Last_Field(NULL,NULL,&buffer);
+	return buffer;
+}
+
+/**
+ * Return the low 32 bits of the system ticks (monotonic microseconds) when the last simulated field was captured.
+ * @param unitmap A bitmap of which unit to query.
+ * @return The low 32 bits of the capture system ticks.
+ * @see #Simulator_Get_Last_Field
+ */
+static unsigned int Simulator_Captured_Sys_Ticks(int unitmap)
+{
+	unsigned long long sys_ticks;
+
+	Simulator_Get_Last_Field(NULL,&sys_ticks,NULL);
+	return (unsigned int)(sys_ticks&0xFFFFFFFFULL);
+}
+
+/**
+ * Return the high 32 bits of the system ticks (monotonic microseconds) when the last simulated field was captured.
+ * @param unitmap A bitmap of which unit to query.
+ * @return The high 32 bits of the capture system ticks.
+ * @see #Simulator_Get_Last_Field
+ */
+static unsigned int Simulator_Captured_Sys_Ticks_Hi(int unitmap)
+{
+	unsigned long long sys_ticks;
+
+	Simulator_Get_Last_Field(NULL,&sys_ticks,NULL);
+	return (unsigned int)(sys_ticks>>32);
+}
+
+/**
+ * Read a rectangle of pixels out of a simulated frame buffer. The synthetic image is a bias level, plus a
+ * gradient, plus pseudo-random noise seeded from the field count of the field captured into the buffer and the
+ * row number, so the same field always reads out the same pixels, whatever rectangle is read.
+ * @param unitmap A bitmap of which unit to read from.
+ * @param buffer The frame buffer to read from.
+ * @param ulx The upper left X pixel of the rectangle.
+ * @param uly The upper left Y pixel of the rectangle.
+ * @param lrx The lower right X pixel of the rectangle (exclusive).
+ * @param lry The lower right Y pixel of the rectangle (exclusive).
+ * @param membase The memory to read the pixels into.
+ * @param count The number of pixels membase has room for.
+ * @param colorspace The colour space to read the pixels in, only "Grey" is supported.
+ * @return A negative simulator error code on failure, otherwise the number of pixels read.
+ * @see #Simulator_Data
+ * @see #Simulator_Get_Last_Field
+ * @see #SIMULATOR_BIAS_LEVEL
+ * @see #SIMULATOR_NOISE_MASK
+ * @see #SIMULATOR_IMAGE_B_DIM
+ */
+static int Simulator_Read_UShort(int unitmap,long buffer,int ulx,int uly,int lrx,int lry,
+				 unsigned short *membase,size_t count,char *colorspace)
+{
+	unsigned long field_count;
+	unsigned int seed,value;
+	long last_buffer;
+	int x,y,pixel_count,pixel_index;
+
+	if(Simulator_Data.Is_Open == FALSE)
+		return SIMULATOR_ERROR_NOT_OPEN;
+	if((buffer < 1)||(buffer > SIMULATOR_IMAGE_Z_DIM))
+		return SIMULATOR_ERROR_BUFFER;
+	if((ulx < 0)||(uly < 0)||(lrx > SIMULATOR_IMAGE_X_DIM)||(lry > SIMULATOR_IMAGE_Y_DIM)||
+	   (lrx <= ulx)||(lry <= uly))
+		return SIMULATOR_ERROR_RECTANGLE;
+	if((colorspace == NULL)||(strcmp(colorspace,"Grey") != 0))
+		return SIMULATOR_ERROR_COLORSPACE;
+	pixel_count = (lrx-ulx)*(lry-uly);
+	if((membase == NULL)||(count < (size_t)pixel_count))
+		return SIMULATOR_ERROR_COUNT;
+	/* which field is in the buffer being read out? */
+	field_count = Simulator_Data.Buffer_Field_Count[buffer];
+	if(Simulator_Data.Is_Live)
+	{
+		Simulator_Get_Last_Field(&field_count,NULL,&last_buffer);
+		if((buffer != last_buffer)&&(field_count > 0))
+			field_count--;
+	}
+	pixel_index = 0;
+	for(y = uly; y < lry; y++)
+	{
+		/* xorshift32 seeded from the field count and row, seed must be non-zero */
+		seed = (((unsigned int)field_count)*2654435761U)^(((unsigned int)y+1)*40503U);
+		if(seed == 0)
+			seed = 1;
+		for(x = 0; x < lrx; x++)
+		{
+			seed ^= seed << 13;
+			seed ^= seed >> 17;
+			seed ^= seed << 5;
+			if(x >= ulx)
+			{
+				value = SIMULATOR_BIAS_LEVEL+((x+y)/4)+(seed&SIMULATOR_NOISE_MASK);
+				if(value >= (1<<SIMULATOR_IMAGE_B_DIM))
+					value = (1<<SIMULATOR_IMAGE_B_DIM)-1;
+				membase[pixel_index++] = (unsigned short)value;
+			}
+		}
+	}
+	return pixel_count;
+}
+
+/**
+ * Return a description of a negative simulator error code.
+ * @param error_code The error code.
+ * @return A string describing the error.
+ * @see #SIMULATOR_ERROR_NOT_OPEN
+ * @see #SIMULATOR_ERROR_BUFFER
+ * @see #SIMULATOR_ERROR_RECTANGLE
+ * @see #SIMULATOR_ERROR_COUNT
+ * @see #SIMULATOR_ERROR_SERIAL
+ * @see #SIMULATOR_ERROR_COLORSPACE
+ */
+static char *Simulator_Error_Code_String(int error_code)
+{
+	switch(error_code)
+	{
+		case SIMULATOR_ERROR_NOT_OPEN:
+			return "Simulator:frame grabber not open";
+		case SIMULATOR_ERROR_BUFFER:
+			return "Simulator:illegal frame buffer";
+		case SIMULATOR_ERROR_RECTANGLE:
+			return "Simulator:illegal readout rectangle";
+		case SIMULATOR_ERROR_COUNT:
+			return "Simulator:readout memory too small";
+		case SIMULATOR_ERROR_SERIAL:
+			return "Simulator:illegal serial write";
+		case SIMULATOR_ERROR_COLORSPACE:
+			return "Simulator:illegal colour space";
+		default:
+			if(error_code >= 0)
+				return "Simulator:no error";
+			return "Simulator:unknown error";
+	}
+}
+
+/**
+ * Configure the simulated serial connection to the camera head. The serial parameters are ignored.
+ * @return 0 on success, or a negative simulator error code on failure.
+ * @see #Simulator_Data
+ * @see #SIMULATOR_ERROR_NOT_OPEN
+ */
+static int Simulator_Serial_Configure(int unitmap,int rsvd0,double baud,int bits,int parity,int stopbits,
+				      int rsvd1,int rsvd2,int rsvd3)
+{
+	if(Simulator_Data.Is_Open == FALSE)
+		return SIMULATOR_ERROR_NOT_OPEN;
+	Simulator_Data.Reply_Length = 0;
+	Simulator_Data.Reply_Index = 0;
+	return 0;
+}
+
+/**
+ * Read any bytes waiting in the simulated serial reply queue.
+ * @param unitmap A bitmap of which unit to read from.
+ * @param rsvd0 Reserved, should be 0.
+ * @param buffer The buffer to read the bytes into.
+ * @param count The maximum number of bytes to read.
+ * @return A negative simulator error code on failure, otherwise the number of bytes read (which may be 0).
+ * @see #Simulator_Data
+ * @see #SIMULATOR_ERROR_NOT_OPEN
+ */
+static int Simulator_Serial_Read(int unitmap,int rsvd0,unsigned char *buffer,int count)
+{
+	int read_count;
+
+	if(Simulator_Data.Is_Open == FALSE)
+		return SIMULATOR_ERROR_NOT_OPEN;
+	read_count = Simulator_Data.Reply_Length-Simulator_Data.Reply_Index;
+	if(read_count > count)
+		read_count = count;
+	if(read_count > 0)
+	{
+		memcpy(buffer,Simulator_Data.Reply_Buffer+Simulator_Data.Reply_Index,read_count);
+		Simulator_Data.Reply_Index += read_count;
+	}
+	return read_count;
+}
+
+/**
+ * Write a command to the simulated camera head. The command is parsed and the reply queued to be read by
+ * Simulator_Serial_Read. The following commands are supported (see detector_serial):
+ * <ul>
+ * <li>0x49 : Get system status.
+ * <li>0x4F &lt;status&gt; : Set system state.
+ * <li>0x53 0xAE 0x05 ... : Set EPROM address.
+ * <li>0x53 0xAF &lt;n&gt; : Read manufacturers data.
+ * <li>0x53 0xE0 0x01 &lt;address&gt; : Set register address.
+ * <li>0x53 0xE0 0x02 &lt;address&gt; &lt;value&gt; : Write register.
+ * <li>0x53 0xE1 &lt;n&gt; : Read registers from the set register address.
+ * </ul>
+ * Each command is terminated by an ETX byte, followed by an XOR checksum. If checksums are enabled and the
+ * checksum is wrong, an ETX_CK_SUM_ERR is returned, unknown commands return ETX_UNKNOWN_CMD.
+ * @param unitmap A bitmap of which unit to write to.
+ * @param rsvd0 Reserved, should be 0.
+ * @param buffer The bytes to write.
+ * @param count The number of bytes to write.
+ * @return A negative simulator error code on failure, otherwise the number of bytes written.
+ * @see #Simulator_Data
+ * @see #Simulator_Reply_Add
+ * @see #Simulator_Temperature_Update
+ * @see #SIMULATOR_ERROR_NOT_OPEN
+ * @see #SIMULATOR_ERROR_SERIAL
+ */
+static int Simulator_Serial_Write(int unitmap,int rsvd0,unsigned char *buffer,int count)
+{
+	unsigned char manufacturers_data[18];
+	unsigned char data[SIMULATOR_REPLY_LENGTH];
+	unsigned char checksum;
+	int i,etx_index,data_length,adc_value,pcb_value;
+
+	if(Simulator_Data.Is_Open == FALSE)
+		return SIMULATOR_ERROR_NOT_OPEN;
+	if((buffer == NULL)||(count < 1))
+		return SIMULATOR_ERROR_SERIAL;
+	/* find the ETX terminating the command */
+	etx_index = -1;
+	for(i = count-1; i > 0; i--)
+	{
+		if(buffer[i] == SIMULATOR_ETX)
+		{
+			etx_index = i;
+			break;
+		}
+	}
+	if(etx_index < 0)
+		return SIMULATOR_ERROR_SERIAL;
+	/* the checksum byte sent, echoed in acknowledgements */
+	if(etx_index+1 < count)
+		checksum = buffer[etx_index+1];
+	else
+		checksum = 0;
+	/* check checksum, if enabled. The XOR of the command and it's checksum byte is zero. */
+	if(Simulator_Data.System_Status & SIMULATOR_STATUS_CHECKSUM)
+	{
+		data[0] = 0;
+		for(i = 0; i < count; i++)
+			data[0] ^= buffer[i];
+		if((etx_index+1 >= count)||(data[0] != 0))
+		{
+			data[0] = SIMULATOR_ETX_CK_SUM_ERR;
+			data[1] = checksum;
+			Simulator_Reply_Add(data,2,checksum,FALSE);
+			return count;
+		}
+	}
+	data_length = 0;
+	if((buffer[0] == SIMULATOR_STATUS_REGISTER_READ)&&(etx_index == 1))
+	{
+		/* status byte only, no acknowledgement */
+		data[0] = Simulator_Data.System_Status;
+		Simulator_Reply_Add(data,1,checksum,FALSE);
+		return count;
+	}
+	else if((buffer[0] == SIMULATOR_STATUS_REGISTER_WRITE)&&(etx_index == 2))
+	{
+		Simulator_Data.System_Status = (buffer[1]&(SIMULATOR_STATUS_CHECKSUM|SIMULATOR_STATUS_CMD_ACK|
+							  SIMULATOR_STATUS_FPGA_RUNNING|SIMULATOR_STATUS_EPROM_COMMS))|
+			SIMULATOR_STATUS_FPGA_BOOTED;
+	}
+	else if((buffer[0] == 0x53)&&(etx_index >= 2)&&(buffer[1] == 0xAE))
+	{
+		/* set EPROM address, the only EPROM data we simulate is the manufacturers data */
+	}
+	else if((buffer[0] == 0x53)&&(etx_index == 3)&&(buffer[1] == 0xAF))
+	{
+		manufacturers_data[0] = SIMULATOR_SERIAL_NUMBER&0xFF;
+		manufacturers_data[1] = (SIMULATOR_SERIAL_NUMBER>>8)&0xFF;
+		manufacturers_data[2] = 1;  /* build day */
+		manufacturers_data[3] = 1;  /* build month */
+		manufacturers_data[4] = 20; /* build year since 2000 */
+		memcpy(manufacturers_data+5,"SIMUL",5);
+		manufacturers_data[10] = SIMULATOR_ADC_ZERO_C&0xFF;
+		manufacturers_data[11] = (SIMULATOR_ADC_ZERO_C>>8)&0xFF;
+		manufacturers_data[12] = SIMULATOR_ADC_FORTY_C&0xFF;
+		manufacturers_data[13] = (SIMULATOR_ADC_FORTY_C>>8)&0xFF;
+		manufacturers_data[14] = SIMULATOR_DAC_ZERO_C&0xFF;
+		manufacturers_data[15] = (SIMULATOR_DAC_ZERO_C>>8)&0xFF;
+		manufacturers_data[16] = SIMULATOR_DAC_FORTY_C&0xFF;
+		manufacturers_data[17] = (SIMULATOR_DAC_FORTY_C>>8)&0xFF;
+		data_length = buffer[2];
+		if(data_length > 18)
+			data_length = 18;
+		memcpy(data,manufacturers_data,data_length);
+	}
+	else if((buffer[0] == 0x53)&&(etx_index == 4)&&(buffer[1] == 0xE0)&&(buffer[2] == 0x01))
+	{
+		Simulator_Data.Register_Address = buffer[3];
+	}
+	else if((buffer[0] == 0x53)&&(etx_index == 5)&&(buffer[1] == 0xE0)&&(buffer[2] == 0x02))
+	{
+		Simulator_Temperature_Update();
+		Simulator_Data.Register_List[buffer[3]] = buffer[4];
+	}
+	else if((buffer[0] == 0x53)&&(etx_index == 3)&&(buffer[1] == 0xE1))
+	{
+		/* update the read only temperature registers */
+		Simulator_Temperature_Update();
+		adc_value = SIMULATOR_ADC_ZERO_C+(int)(((double)(SIMULATOR_ADC_FORTY_C-SIMULATOR_ADC_ZERO_C))*
+						       Simulator_Data.Sensor_Temperature/40.0);
+		Simulator_Data.Register_List[SIMULATOR_REGISTER_SENSOR_MSB] = (adc_value>>8)&0xFF;
+		Simulator_Data.Register_List[SIMULATOR_REGISTER_SENSOR_LSB] = adc_value&0xFF;
+		pcb_value = (int)(SIMULATOR_PCB_TEMPERATURE*16.0);
+		Simulator_Data.Register_List[SIMULATOR_REGISTER_PCB_MSB] = (pcb_value>>8)&0xFF;
+		Simulator_Data.Register_List[SIMULATOR_REGISTER_PCB_LSB] = pcb_value&0xFF;
+		data_length = buffer[2];
+		for(i = 0; i < data_length; i++)
+			data[i] = Simulator_Data.Register_List[(Simulator_Data.Register_Address+i)&0xFF];
+	}
+	else
+	{
+		data[0] = SIMULATOR_ETX_UNKNOWN_CMD;
+		data_length = 1;
+		if(Simulator_Data.System_Status & SIMULATOR_STATUS_CHECKSUM)
+			data[data_length++] = checksum;
+		Simulator_Reply_Add(data,data_length,checksum,FALSE);
+		return count;
+	}
+	Simulator_Reply_Add(data,data_length,checksum,TRUE);
+	return count;
+}
+
+/**
+ * Flush the simulated serial connection, discarding any unread reply bytes.
+ * @return 0 on success, or a negative simulator error code on failure.
+ * @see #Simulator_Data
+ * @see #SIMULATOR_ERROR_NOT_OPEN
+ */
+static int Simulator_Serial_Flush(int unitmap,int rsvd0,int rsvd1,int rsvd2)
+{
+	if(Simulator_Data.Is_Open == FALSE)
+		return SIMULATOR_ERROR_NOT_OPEN;
+	if(rsvd1)
+	{
+		Simulator_Data.Reply_Length = 0;
+		Simulator_Data.Reply_Index = 0;
+	}
+	return 0;
+}
+
+/**
+ * Get the current monotonic time in microseconds.
+ * @return The current monotonic time in microseconds.
+ */
+static unsigned long long Simulator_Get_Time_Us(void)
+{
+	struct timespec current_time;
+
+	clock_gettime(CLOCK_MONOTONIC,&current_time);
+	return (((unsigned long long)current_time.tv_sec)*DETECTOR_GENERAL_ONE_SECOND_MS*1000ULL)+
+		(current_time.tv_nsec/DETECTOR_GENERAL_ONE_MICROSECOND_NS);
+}
+
+/**
+ * Work out the field count, system ticks and frame buffer of the last captured simulated field.
+ * Whilst live, a new field is captured every Current_Field_Period_Ms since the grabber went live,
+ * alternately into the two buffers in Buffer_List. Otherwise, the values frozen when the grabber was stopped
+ * are returned.
+ * @param field_count If non-NULL, on return the field count of the last captured field.
+ * @param sys_ticks If non-NULL, on return the system ticks (monotonic microseconds) of the last captured field.
+ * @param buffer If non-NULL, on return the frame buffer of the last captured field.
+ * @see #Simulator_Data
+ * @see #Simulator_Get_Time_Us
+ */
+static void Simulator_Get_Last_Field(unsigned long *field_count,unsigned long long *sys_ticks,long *buffer)
+{
+	unsigned long long field_period_us,live_field_count;
+
+	if(Simulator_Data.Is_Live == FALSE)
+	{
+		if(field_count != NULL)
+			(*field_count) = Simulator_Data.Field_Count;
+		if(sys_ticks != NULL)
+			(*sys_ticks) = Simulator_Data.Field_Sys_Ticks;
+		if(buffer != NULL)
+			(*buffer) = Simulator_Data.Field_Buffer;
+		return;
+	}
+	field_period_us = ((unsigned long long)Simulator_Data.Current_Field_Period_Ms)*1000ULL;
+	live_field_count = (Simulator_Get_Time_Us()-Simulator_Data.Live_Start_Us)/field_period_us;
+	if(field_count != NULL)
+		(*field_count) = Simulator_Data.Live_Start_Field_Count+(unsigned long)live_field_count;
+	if(live_field_count == 0)
+	{
+		if(sys_ticks != NULL)
+			(*sys_ticks) = Simulator_Data.Field_Sys_Ticks;
+		if(buffer != NULL)
+			(*buffer) = Simulator_Data.Field_Buffer;
+		return;
+	}
+	if(sys_ticks != NULL)
+		(*sys_ticks) = Simulator_Data.Live_Start_Us+(live_field_count*field_period_us);
+	if(buffer != NULL)
+		(*buffer) = Simulator_Data.Buffer_List[(live_field_count-1)%2];
+}
+
+/**
+ * Add a reply to the simulated serial reply queue. The reply consists of the data bytes, followed
+ * (if ack is TRUE and command acknowledgements are enabled) by an ETX byte and (if checksums are enabled)
+ * the checksum byte of the command being replied to.
+ * @param data The reply data bytes.
+ * @param data_length The number of reply data bytes.
+ * @param checksum The checksum byte of the command being replied to.
+ * @param ack Whether to add the acknowledgement (ETX and checksum) to the reply.
+ * @see #Simulator_Data
+ * @see #SIMULATOR_REPLY_LENGTH
+ */
+static void Simulator_Reply_Add(unsigned char *data,int data_length,unsigned char checksum,int ack)
+{
+	int i;
+
+	/* a new reply replaces any unread reply */
+	Simulator_Data.Reply_Length = 0;
+	Simulator_Data.Reply_Index = 0;
+	for(i = 0; (i < data_length)&&(Simulator_Data.Reply_Length < SIMULATOR_REPLY_LENGTH-2); i++)
+		Simulator_Data.Reply_Buffer[Simulator_Data.Reply_Length++] = data[i];
+	if(ack && (Simulator_Data.System_Status & SIMULATOR_STATUS_CMD_ACK))
+	{
+		Simulator_Data.Reply_Buffer[Simulator_Data.Reply_Length++] = SIMULATOR_ETX;
+		if(Simulator_Data.System_Status & SIMULATOR_STATUS_CHECKSUM)
+			Simulator_Data.Reply_Buffer[Simulator_Data.Reply_Length++] = checksum;
+	}
+}
+
+/**
+ * Update the simulated sensor temperature. The sensor temperature relaxes exponentially (with time constant
+ * SIMULATOR_TEMPERATURE_TAU) towards the TEC setpoint if the TEC is enabled in the FPGA control register,
+ * or towards SIMULATOR_AMBIENT_TEMPERATURE otherwise.
+ * @see #Simulator_Data
+ * @see #Simulator_Get_Time_Us
+ * @see #Simulator_DAC_To_Temperature
+ * @see #SIMULATOR_TEMPERATURE_TAU
+ * @see #SIMULATOR_AMBIENT_TEMPERATURE
+ */
+static void Simulator_Temperature_Update(void)
+{
+	unsigned long long current_time_us;
+	double target_temperature,elapsed_s;
+	int dac_value;
+
+	current_time_us = Simulator_Get_Time_Us();
+	elapsed_s = ((double)(current_time_us-Simulator_Data.Sensor_Temperature_Us))/1000000.0;
+	Simulator_Data.Sensor_Temperature_Us = current_time_us;
+	if(Simulator_Data.Register_List[SIMULATOR_REGISTER_FPGA_CTRL] & DETECTOR_SERIAL_FPGA_CTRL_TEC_ENABLED)
+	{
+		dac_value = (Simulator_Data.Register_List[SIMULATOR_REGISTER_TEC_MSB]<<8)|
+			Simulator_Data.Register_List[SIMULATOR_REGISTER_TEC_LSB];
+		target_temperature = Simulator_DAC_To_Temperature(dac_value);
+	}
+	else
+		target_temperature = SIMULATOR_AMBIENT_TEMPERATURE;
+	Simulator_Data.Sensor_Temperature += (target_temperature-Simulator_Data.Sensor_Temperature)*
+		(1.0-exp(-elapsed_s/SIMULATOR_TEMPERATURE_TAU));
+}
+
+/**
+ * Convert a TEC setpoint DAC value into a temperature, using the simulated manufacturers data.
+ * @param dac_value The DAC value.
+ * @return The temperature in degrees centigrade.
+ * @see #SIMULATOR_DAC_ZERO_C
+ * @see #SIMULATOR_DAC_FORTY_C
+ */
+static double Simulator_DAC_To_Temperature(int dac_value)
+{
+	return 40.0*((double)(dac_value-SIMULATOR_DAC_ZERO_C))/((double)(SIMULATOR_DAC_FORTY_C-SIMULATOR_DAC_ZERO_C));
+}
@@ -0,0 +1,442 @@
+/* detector_latency.c
+** Raptor Ninox-640 Infrared detector library : exposure stage latency routines.
+*/
+/**
+ * Routines to record how long each stage of an exposure takes (nudgematic move, header set, frame grabber go live,
+ * first field, coadd readout, mean/flip, FITS create/write/header/close, unlock). Each stage has a fixed size ring
+ * of the most recent latencies, timed with CLOCK_MONOTONIC, which is cheap enough to leave enabled in production
+ * (unlike the log messages). The rings can be summarised as min/mean/p95/max per stage, and the latencies of the
+ * current exposure can be written into the FITS headers. Switching the detector's video format between exposures
+ * is timed in the same way.
+ * @author Chris Mottram
+ * @version $Revision$
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "log_udp.h"
+#include "detector_general.h"
+#include "detector_latency.h"
+
+/* data types */
+/**
+ * Data type holding the latencies recorded for one stage.
+ * <dl>
+ * <dt>Ring</dt> <dd>A ring of the most recent DETECTOR_LATENCY_RING_LENGTH latencies, in milliseconds.</dd>
+ * <dt>Count</dt> <dd>The total number of latencies recorded. The next latency is written to
+ *     Ring[Count % DETECTOR_LATENCY_RING_LENGTH].</dd>
+ * <dt>Exposure_Count</dt> <dd>The number of latencies recorded since the last Detector_Latency_Exposure_Reset.</dd>
+ * <dt>Exposure_Sum_Ms</dt> <dd>The sum of the latencies recorded since the last Detector_Latency_Exposure_Reset,
+ *     in milliseconds.</dd>
+ * </dl>
+ * @see #DETECTOR_LATENCY_RING_LENGTH
+ */
+struct Latency_Stage_Struct
+{
+	double Ring[DETECTOR_LATENCY_RING_LENGTH];
+	unsigned int Count;
+	int Exposure_Count;
+	double Exposure_Sum_Ms;
+};
+
+/**
+ * Data type holding local data to detector_latency. This consists of the following:
+ * <dl>
+ * <dt>Mutex</dt> <dd>A mutex protecting the stage data, as the latencies are recorded by the exposure thread
+ *     and read by the status thread.</dd>
+ * <dt>Stage_List</dt> <dd>The latencies recorded for each stage, indexed by DETECTOR_LATENCY_STAGE.</dd>
+ * <dt>Fits_Keywords</dt> <dd>A boolean, whether to write the current exposure's latencies into the FITS headers.</dd>
+ * </dl>
+ * @see #Latency_Stage_Struct
+ * @see #DETECTOR_LATENCY_STAGE
+ */
+struct Latency_Struct
+{
+	pthread_mutex_t Mutex;
+	struct Latency_Stage_Struct Stage_List[DETECTOR_LATENCY_STAGE_COUNT];
+	int Fits_Keywords;
+};
+
+/* internal data */
+/**
+ * Revision Control System identifier.
+ */
+static char rcsid[] = "$Id$";
+/**
+ * The names of the stages, indexed by DETECTOR_LATENCY_STAGE. These are used by the status command.
+ * @see #DETECTOR_LATENCY_STAGE
+ */
+static char *Stage_Name_List[DETECTOR_LATENCY_STAGE_COUNT] =
+{
+	"nudgematic_move","header_set","go_live","first_field","coadd_readout","mean_flip",
+	"fits_create","fits_write","fits_header","fits_noise_write","fits_close","unlock","format_switch"
+};
+/**
+ * The instance of Latency_Struct that contains local data for this module. This is initialised as follows:
+ * <dl>
+ * <dt>Mutex</dt> <dd>PTHREAD_MUTEX_INITIALIZER</dd>
+ * <dt>Stage_List</dt> <dd>{{{0},0,0,0.0},...}</dd>
+ * <dt>Fits_Keywords</dt> <dd>FALSE</dd>
+ * </dl>
+ */
+static struct Latency_Struct Latency_Data =
+{
+	PTHREAD_MUTEX_INITIALIZER,{{{0},0,0,0.0}},FALSE
+};
+/**
+ * Variable holding error code of last operation performed.
+ */
+static int Latency_Error_Number = 0;
+/**
+ * Local variable holding description of the last error that occured.
+ * @see detector_general.html#DETECTOR_GENERAL_ERROR_STRING_LENGTH
+ */
+static char Latency_Error_String[DETECTOR_GENERAL_ERROR_STRING_LENGTH] = "";
+
+/* internal functions */
+static int Latency_Double_Compare(const void *p1,const void *p2);
+
+/* --------------------------------------------------------
+** External Functions
+** -------------------------------------------------------- */
+/**
+ * Take a timestamp to start timing a stage from.
+ * @param timestamp The address of a timespec to fill in with the current CLOCK_MONOTONIC time.
+ */
+void Detector_Latency_Timestamp(struct timespec *timestamp)
+{
+	clock_gettime(CLOCK_MONOTONIC,timestamp);
+}
+
+/**
+ * Record the latency of a stage, from start_time to now. start_time is then set to now, so consecutive stages
+ * can be timed with a single timestamp each.
+ * <ul>
+ * <li>We take a CLOCK_MONOTONIC timestamp and compute the latency since start_time in milliseconds.
+ * <li>We lock the mutex, add the latency to the stage's ring and per-exposure sum, and unlock the mutex.
+ * <li>We set start_time to the new timestamp.
+ * </ul>
+ * Illegal stages are ignored, so this routine can be called from the exposure path without error checking.
+ * @param stage Which stage to record the latency for.
+ * @param start_time The address of a timespec containing the time the stage started,
+ *        on return set to the time the stage ended.
+ * @see #Latency_Data
+ * @see #DETECTOR_LATENCY_IS_STAGE
+ * @see #DETECTOR_LATENCY_RING_LENGTH
+ * @see detector_general.html#fdifftime
+ * @see detector_general.html#DETECTOR_GENERAL_ONE_SECOND_MS
+ */
+void Detector_Latency_Stage_Record(enum DETECTOR_LATENCY_STAGE stage,struct timespec *start_time)
+{
+	struct Latency_Stage_Struct *stage_data = NULL;
+	struct timespec end_time;
+	double latency_ms;
+
+	if((!DETECTOR_LATENCY_IS_STAGE(stage))||(start_time == NULL))
+		return;
+	clock_gettime(CLOCK_MONOTONIC,&end_time);
+	latency_ms = fdifftime(end_time,(*start_time))*((double)DETECTOR_GENERAL_ONE_SECOND_MS);
+	stage_data = &(Latency_Data.Stage_List[stage]);
+	pthread_mutex_lock(&(Latency_Data.Mutex));
+	stage_data->Ring[stage_data->Count % DETECTOR_LATENCY_RING_LENGTH] = latency_ms;
+	stage_data->Count++;
+	stage_data->Exposure_Count++;
+	stage_data->Exposure_Sum_Ms += latency_ms;
+	pthread_mutex_unlock(&(Latency_Data.Mutex));
+	(*start_time) = end_time;
+}
+
+/**
+ * Get summary statistics of the latencies in a stage's ring.
+ * <ul>
+ * <li>We check the stage and pointer arguments.
+ * <li>We lock the mutex, copy the ring and get the count, and unlock the mutex.
+ * <li>We sort the copy, and compute the minimum, mean, 95th percentile (nearest rank) and maximum.
+ * </ul>
+ * If no latencies have been recorded, count is 0 and the statistics are all 0.0.
+ * @param stage Which stage to get the statistics for.
+ * @param count The address of an integer, on return the number of latencies the statistics were computed from
+ *        (at most DETECTOR_LATENCY_RING_LENGTH).
+ * @param min_ms The address of a double, on return the minimum latency in milliseconds.
+ * @param mean_ms The address of a double, on return the mean latency in milliseconds.
+ * @param p95_ms The address of a double, on return the 95th percentile latency in milliseconds.
+ * @param max_ms The address of a double, on return the maximum latency in milliseconds.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ *         On failure, Latency_Error_Number/Latency_Error_String are set.
+ * @see #Latency_Data
+ * @see #Latency_Double_Compare
+ * @see #DETECTOR_LATENCY_IS_STAGE
+ * @see #DETECTOR_LATENCY_RING_LENGTH
+ */
+int Detector_Latency_Stage_Statistics_Get(enum DETECTOR_LATENCY_STAGE stage,int *count,double *min_ms,
+					  double *mean_ms,double *p95_ms,double *max_ms)
+{
+	double sorted_list[DETECTOR_LATENCY_RING_LENGTH];
+	double sum;
+	int i,n;
+
+	Latency_Error_Number = 0;
+	if(!DETECTOR_LATENCY_IS_STAGE(stage))
+	{
+		Latency_Error_Number = 1;
+		sprintf(Latency_Error_String,"Detector_Latency_Stage_Statistics_Get:Illegal stage %d.",stage);
+		return FALSE;
+	}
+	if((count == NULL)||(min_ms == NULL)||(mean_ms == NULL)||(p95_ms == NULL)||(max_ms == NULL))
+	{
+		Latency_Error_Number = 2;
+		sprintf(Latency_Error_String,"Detector_Latency_Stage_Statistics_Get:NULL statistic pointer.");
+		return FALSE;
+	}
+	pthread_mutex_lock(&(Latency_Data.Mutex));
+	n = Latency_Data.Stage_List[stage].Count;
+	if(Latency_Data.Stage_List[stage].Count > DETECTOR_LATENCY_RING_LENGTH)
+		n = DETECTOR_LATENCY_RING_LENGTH;
+	memcpy(sorted_list,Latency_Data.Stage_List[stage].Ring,n*sizeof(double));
+	pthread_mutex_unlock(&(Latency_Data.Mutex));
+	(*count) = n;
+	(*min_ms) = 0.0;
+	(*mean_ms) = 0.0;
+	(*p95_ms) = 0.0;
+	(*max_ms) = 0.0;
+	if(n < 1)
+		return TRUE;
+	qsort(sorted_list,n,sizeof(double),Latency_Double_Compare);
+	sum = 0.0;
+	for(i = 0; i < n; i++)
+		sum += sorted_list[i];
+	(*min_ms) = sorted_list[0];
+	(*mean_ms) = sum/((double)n);
+	(*p95_ms) = sorted_list[((n*95)+99)/100-1];
+	(*max_ms) = sorted_list[n-1];
+	return TRUE;
+}
+
+/**
+ * Get the latencies recorded for a stage since the last call to Detector_Latency_Exposure_Reset,
+ * i.e. during the current exposure.
+ * @param stage Which stage to get the latencies for.
+ * @param count The address of an integer, on return the number of latencies recorded for the stage during
+ *        this exposure (0 if the stage has not happened, more than 1 for the coadd readout).
+ * @param mean_ms The address of a double, on return the mean of the latencies recorded for the stage during
+ *        this exposure, in milliseconds (0.0 if count is 0).
+ * @return The routine returns TRUE on success and FALSE on failure.
+ *         On failure, Latency_Error_Number/Latency_Error_String are set.
+ * @see #Latency_Data
+ * @see #Detector_Latency_Exposure_Reset
+ * @see #DETECTOR_LATENCY_IS_STAGE
+ */
+int Detector_Latency_Stage_Exposure_Get(enum DETECTOR_LATENCY_STAGE stage,int *count,double *mean_ms)
+{
+	Latency_Error_Number = 0;
+	if(!DETECTOR_LATENCY_IS_STAGE(stage))
+	{
+		Latency_Error_Number = 3;
+		sprintf(Latency_Error_String,"Detector_Latency_Stage_Exposure_Get:Illegal stage %d.",stage);
+		return FALSE;
+	}
+	if((count == NULL)||(mean_ms == NULL))
+	{
+		Latency_Error_Number = 4;
+		sprintf(Latency_Error_String,"Detector_Latency_Stage_Exposure_Get:NULL pointer.");
+		return FALSE;
+	}
+	pthread_mutex_lock(&(Latency_Data.Mutex));
+	(*count) = Latency_Data.Stage_List[stage].Exposure_Count;
+	if((*count) > 0)
+		(*mean_ms) = Latency_Data.Stage_List[stage].Exposure_Sum_Ms/((double)(*count));
+	else
+		(*mean_ms) = 0.0;
+	pthread_mutex_unlock(&(Latency_Data.Mutex));
+	return TRUE;
+}
+
+/**
+ * Get the name of a stage, as used by the status command.
+ * @param stage The stage.
+ * @return A pointer to a static string containing the name of the stage, or NULL if the stage is illegal.
+ * @see #Stage_Name_List
+ * @see #DETECTOR_LATENCY_IS_STAGE
+ */
+char *Detector_Latency_Stage_Name_Get(enum DETECTOR_LATENCY_STAGE stage)
+{
+	if(!DETECTOR_LATENCY_IS_STAGE(stage))
+		return NULL;
+	return Stage_Name_List[stage];
+}
+
+/**
+ * Get a stage from it's name.
+ * @param name The name of the stage, one of the strings in Stage_Name_List.
+ * @param stage The address of an enum, on a successful return filled in with the stage.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ *         On failure, Latency_Error_Number/Latency_Error_String are set.
+ * @see #Stage_Name_List
+ */
+int Detector_Latency_Stage_From_Name(char *name,enum DETECTOR_LATENCY_STAGE *stage)
+{
+	int i;
+
+	Latency_Error_Number = 0;
+	if((name == NULL)||(stage == NULL))
+	{
+		Latency_Error_Number = 5;
+		sprintf(Latency_Error_String,"Detector_Latency_Stage_From_Name:NULL argument.");
+		return FALSE;
+	}
+	for(i = 0; i < DETECTOR_LATENCY_STAGE_COUNT; i++)
+	{
+		if(strcmp(name,Stage_Name_List[i]) == 0)
+		{
+			(*stage) = i;
+			return TRUE;
+		}
+	}
+	Latency_Error_Number = 6;
+	sprintf(Latency_Error_String,"Detector_Latency_Stage_From_Name:Unknown stage '%s'.",name);
+	return FALSE;
+}
+
+/**
+ * Reset the per-exposure latencies of all the stages. This is called once an exposure has been saved,
+ * so the next exposure's FITS headers only contain it's own latencies.
+ * @see #Latency_Data
+ */
+void Detector_Latency_Exposure_Reset(void)
+{
+	int i;
+
+	pthread_mutex_lock(&(Latency_Data.Mutex));
+	for(i = 0; i < DETECTOR_LATENCY_STAGE_COUNT; i++)
+	{
+		Latency_Data.Stage_List[i].Exposure_Count = 0;
+		Latency_Data.Stage_List[i].Exposure_Sum_Ms = 0.0;
+	}
+	pthread_mutex_unlock(&(Latency_Data.Mutex));
+}
+
+/**
+ * Reset all the recorded latencies of all the stages.
+ * @see #Latency_Data
+ */
+void Detector_Latency_Reset(void)
+{
+	int i;
+
+	pthread_mutex_lock(&(Latency_Data.Mutex));
+	for(i = 0; i < DETECTOR_LATENCY_STAGE_COUNT; i++)
+	{
+		Latency_Data.Stage_List[i].Count = 0;
+		Latency_Data.Stage_List[i].Exposure_Count = 0;
+		Latency_Data.Stage_List[i].Exposure_Sum_Ms = 0.0;
+	}
+	pthread_mutex_unlock(&(Latency_Data.Mutex));
+}
+
+/**
+ * Set whether to write the current exposure's stage latencies into the FITS headers of each saved image.
+ * @param enable A boolean, TRUE to write the latency FITS keywords, FALSE not to.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ *         On failure, Latency_Error_Number/Latency_Error_String are set.
+ * @see #Latency_Data
+ * @see detector_general.html#DETECTOR_IS_BOOLEAN
+ */
+int Detector_Latency_Fits_Keywords_Set(int enable)
+{
+	Latency_Error_Number = 0;
+	if(!DETECTOR_IS_BOOLEAN(enable))
+	{
+		Latency_Error_Number = 7;
+		sprintf(Latency_Error_String,"Detector_Latency_Fits_Keywords_Set:Illegal enable %d.",enable);
+		return FALSE;
+	}
+	Latency_Data.Fits_Keywords = enable;
+	return TRUE;
+}
+
+/**
+ * Get whether to write the current exposure's stage latencies into the FITS headers of each saved image.
+ * @return A boolean, TRUE to write the latency FITS keywords, FALSE not to.
+ * @see #Latency_Data
+ */
+int Detector_Latency_Fits_Keywords_Get(void)
+{
+	return Latency_Data.Fits_Keywords;
+}
+
+/**
+ * Get the current value of the error number.
+ * @return The current value of the error number.
+ * @see #Latency_Error_Number
+ */
+int Detector_Latency_Get_Error_Number(void)
+{
+	return Latency_Error_Number;
+}
+
+/**
+ * The error routine that reports any errors occuring in a standard way.
+ * @see #Latency_Error_Number
+ * @see #Latency_Error_String
+ * @see detector_general.html#Detector_General_Get_Current_Time_String
+ */
+void Detector_Latency_Error(void)
+{
+	char time_string[32];
+
+	Detector_General_Get_Current_Time_String(time_string,32);
+	/* if the error number is zero an error message has not been set up
+	** This is in itself an error as we should not be calling this routine
+	** without there being an error to display */
+	if(Latency_Error_Number == 0)
+		sprintf(Latency_Error_String,"Logic Error:No Error defined");
+	fprintf(stderr,"%s Detector_Latency:Error(%d) : %s\n",time_string,Latency_Error_Number,Latency_Error_String);
+}
+
+/**
+ * The error routine that reports any errors occuring in a standard way. This routine places the
+ * generated error string at the end of a passed in string argument.
+ * @param error_string A string to put the generated error in. This string should be initialised before
+ * being passed to this routine. The routine will try to concatenate it's error string onto the end
+ * of any string already in existance.
+ * @see #Latency_Error_Number
+ * @see #Latency_Error_String
+ * @see detector_general.html#Detector_General_Get_Current_Time_String
+ */
+void Detector_Latency_Error_String(char *error_string)
+{
+	char time_string[32];
+
+	Detector_General_Get_Current_Time_String(time_string,32);
+	/* if the error number is zero an error message has not been set up
+	** This is in itself an error as we should not be calling this routine
+	** without there being an error to display */
+	if(Latency_Error_Number == 0)
+		sprintf(Latency_Error_String,"Logic Error:No Error defined");
+	sprintf(error_string+strlen(error_string),"%s Detector_Latency:Error(%d) : %s\n",time_string,
+		Latency_Error_Number,Latency_Error_String);
+}
+
+/* =======================================
+**  internal functions
+** ======================================= */
+/**
+ * qsort comparison routine for doubles.
+ * @param p1 A pointer to the first double.
+ * @param p2 A pointer to the second double.
+ * @return -1, 0 or 1 depending on whether the first double is less than, equal to or greater than the second.
+ */
+static int Latency_Double_Compare(const void *p1,const void *p2)
+{
+	double d1 = *((const double *)p1);
+	double d2 = *((const double *)p2);
+
+	if(d1 < d2)
+		return -1;
+	if(d1 > d2)
+		return 1;
+	return 0;
+}
@@ -4,10 +4,14 @@
 /**
  * Routines to communicate with the Raptor Ninox-640 Infrared detector over the inbuilt camera link serial interface.
  * Commands to control the detector TEC (thermo-electric cooler) and read the temperature are sent of this interface.
+ * All commands are sent by a single serial thread, which owns the serial link: callers queue a request and
+ * block until the serial thread has sent it and framed the reply. Commands that take several round trips
+ * (e.g. set address then read memory) are sent as a sequence, during which other threads' requests stay queued.
  * @author Chris Mottram
  * @version $Revision$
  */
 #include <errno.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -18,7 +22,8 @@
 #include "detector_general.h"
 #include "detector_serial.h"
 #include "detector_temperature.h"
-#include "xcliball.h"
+#include "detector_trace.h"
+#include "detector_grabber.h"
 
 /* hash defines */
 /**
@@ -76,19 +81,135 @@
  * See OWL_640_Cooled_IM_v1_0.pdf, Sec 4.2 "ETX/EROOR codes", P20."
  */
 #define SERIAL_ETX_DONE_LOW                   (0x55)
+/**
+ * The command byte of the register/EPROM access commands. The second byte of these commands is the sub-command.
+ */
+#define SERIAL_REGISTER_COMMAND               (0x53)
+/**
+ * The time to send one byte over the serial link at 115200 baud (1 start bit, 8 data bits, 1 stop bit),
+ * in nanoseconds.
+ */
+#define SERIAL_BYTE_TIME_NS                   (86806)
+/**
+ * The shortest time to sleep between polls for more reply bytes, in nanoseconds.
+ */
+#define SERIAL_POLL_MIN_NS                    (20000)
+/**
+ * The longest time to sleep between polls for more reply bytes, in nanoseconds. The poll interval doubles
+ * from SERIAL_POLL_MIN_NS to this whilst no bytes arrive.
+ */
+#define SERIAL_POLL_MAX_NS                    (1000000)
 
 /* data types */
 /**
- * Data type holding local data to detector_setup. This consists of the following:
+ * Data type holding one queued serial command request. Requests live on the calling thread's stack,
+ * and are linked into the queue until the serial thread has sent them:
+ * <dl>
+ * <dt>Command_Buffer</dt> <dd>The command bytes to send.</dd>
+ * <dt>Command_Buffer_Length</dt> <dd>The number of bytes in Command_Buffer.</dd>
+ * <dt>Reply_Buffer</dt> <dd>Where to put the reply, or NULL if no reply is expected.</dd>
+ * <dt>Expected_Reply_Length</dt> <dd>The length of a successful reply, in bytes.</dd>
+ * <dt>Framed</dt> <dd>A boolean, TRUE if command acknowledgements are enabled, so a short error reply
+ *     (an ETX error code, followed by the command checksum if checksums are enabled) can end the reply early.</dd>
+ * <dt>Checksum_Enabled</dt> <dd>A boolean, TRUE if checksums are enabled.</dd>
+ * <dt>Thread</dt> <dd>The thread that queued the request.</dd>
+ * <dt>Queue_Time</dt> <dd>When the request was queued.</dd>
+ * <dt>Done</dt> <dd>A boolean, set to TRUE by the serial thread when the request has been processed.</dd>
+ * <dt>Timed_Out</dt> <dd>A boolean, TRUE if the request failed because the reply timed out.</dd>
+ * <dt>Retval</dt> <dd>TRUE if the request succeeded, FALSE if it failed.</dd>
+ * <dt>Error_Number</dt> <dd>The Serial_Error_Number to set in the calling thread on failure.</dd>
+ * <dt>Error_String</dt> <dd>The Serial_Error_String to set in the calling thread on failure.</dd>
+ * <dt>Next</dt> <dd>The next request in the queue.</dd>
+ * </dl>
+ * @see detector_general.html#DETECTOR_GENERAL_ERROR_STRING_LENGTH
+ */
+struct Serial_Request_Struct
+{
+	unsigned char *Command_Buffer;
+	int Command_Buffer_Length;
+	unsigned char *Reply_Buffer;
+	int Expected_Reply_Length;
+	int Framed;
+	int Checksum_Enabled;
+	pthread_t Thread;
+	struct timespec Queue_Time;
+	int Done;
+	int Timed_Out;
+	int Retval;
+	int Error_Number;
+	char Error_String[DETECTOR_GENERAL_ERROR_STRING_LENGTH];
+	struct Serial_Request_Struct *Next;
+};
+
+/**
+ * Data type holding the round trip statistics of one kind of serial command, as accumulated by the serial thread:
+ * <dl>
+ * <dt>Command_Byte</dt> <dd>The first byte of the command.</dd>
+ * <dt>Sub_Command_Byte</dt> <dd>The second byte of register/EPROM access commands, otherwise 0.</dd>
+ * <dt>Count</dt> <dd>The number of commands sent.</dd>
+ * <dt>Failure_Count</dt> <dd>The number of commands that failed.</dd>
+ * <dt>Timeout_Count</dt> <dd>The number of commands that timed out.</dd>
+ * <dt>Min_Ms</dt> <dd>The minimum round trip time, in milliseconds.</dd>
+ * <dt>Max_Ms</dt> <dd>The maximum round trip time, in milliseconds.</dd>
+ * <dt>Total_Ms</dt> <dd>The sum of the round trip times, in milliseconds.</dd>
+ * <dt>Queue_Total_Ms</dt> <dd>The sum of the times spent queued, in milliseconds.</dd>
+ * </dl>
+ */
+struct Serial_Statistics_Struct
+{
+	unsigned char Command_Byte;
+	unsigned char Sub_Command_Byte;
+	unsigned int Count;
+	unsigned int Failure_Count;
+	unsigned int Timeout_Count;
+	double Min_Ms;
+	double Max_Ms;
+	double Total_Ms;
+	double Queue_Total_Ms;
+};
+
+/**
+ * Data type holding local data to detector_serial. This consists of the following:
  * <dl>
  * <dt>Reply_Timeout_Ms</dt> <dd>The number of milliseconds to wait for a reply to a command.</dd>
  * <dt>FPGA_Boot_Timeout_Ms</dt> <dd>The number of milliseconds to wait for the FPGA to boot during serial initialisation.</dd>
+ * <dt>Mutex</dt> <dd>A mutex protecting the queue, sequence and statistics data below.</dd>
+ * <dt>Request_Condition</dt> <dd>Signalled to wake the serial thread when a request is queued, a sequence ends,
+ *     or the thread should stop.</dd>
+ * <dt>Reply_Condition</dt> <dd>Broadcast to wake the calling threads when a request is done, or a sequence ends.</dd>
+ * <dt>Thread</dt> <dd>The serial thread.</dd>
+ * <dt>Run</dt> <dd>A boolean, TRUE whilst the serial thread is running.</dd>
+ * <dt>Queue_Head</dt> <dd>The first request in the queue, or NULL.</dd>
+ * <dt>Queue_Tail</dt> <dd>The last request in the queue, or NULL.</dd>
+ * <dt>Sequence_Depth</dt> <dd>How many (nested) sequences Sequence_Thread has started. Whilst this is non-zero,
+ *     only Sequence_Thread's requests are sent.</dd>
+ * <dt>Sequence_Thread</dt> <dd>The thread currently sending a sequence of commands.</dd>
+ * <dt>Checksum_Enabled</dt> <dd>A boolean, TRUE if the camera head has checksums enabled.</dd>
+ * <dt>Ack_Enabled</dt> <dd>A boolean, TRUE if the camera head has command acknowledgements enabled.</dd>
+ * <dt>Statistics_List</dt> <dd>The round trip statistics for each kind of command sent.</dd>
+ * <dt>Statistics_Count</dt> <dd>The number of entries used in Statistics_List.</dd>
  * </dl>
+ * @see #Serial_Request_Struct
+ * @see #Serial_Statistics_Struct
+ * @see #DETECTOR_SERIAL_MAX_STATISTICS_COUNT
  */
 struct Serial_Struct
 {
 	int Reply_Timeout_Ms;
 	int FPGA_Boot_Timeout_Ms;
+	pthread_mutex_t Mutex;
+	pthread_cond_t Request_Condition;
+	pthread_cond_t Reply_Condition;
+	pthread_t Thread;
+	int Run;
+	struct Serial_Request_Struct *Queue_Head;
+	struct Serial_Request_Struct *Queue_Tail;
+	int Sequence_Depth;
+	pthread_t Sequence_Thread;
+	int Checksum_Enabled;
+	int Ack_Enabled;
+	struct Serial_Statistics_Struct Statistics_List[DETECTOR_SERIAL_MAX_STATISTICS_COUNT];
+	int Statistics_Count;
 };
 
 /* internal variables */
@@ -101,12 +222,27 @@ static char rcsid[] = "$Id$";
  * <dl>
  * <dt>Reply_Timeout_Ms</dt> <dd>DEFAULT_REPLY_TIMEOUT_MS</dd>
  * <dt>FPGA_Boot_Timeout_Ms</dt> <dd>DEFAULT_FPGA_BOOT_TIMEOUT_MS</dd>
+ * <dt>Mutex</dt> <dd>PTHREAD_MUTEX_INITIALIZER</dd>
+ * <dt>Request_Condition</dt> <dd>PTHREAD_COND_INITIALIZER</dd>
+ * <dt>Reply_Condition</dt> <dd>PTHREAD_COND_INITIALIZER</dd>
+ * <dt>Thread</dt> <dd>0</dd>
+ * <dt>Run</dt> <dd>FALSE</dd>
+ * <dt>Queue_Head</dt> <dd>NULL</dd>
+ * <dt>Queue_Tail</dt> <dd>NULL</dd>
+ * <dt>Sequence_Depth</dt> <dd>0</dd>
+ * <dt>Sequence_Thread</dt> <dd>0</dd>
+ * <dt>Checksum_Enabled</dt> <dd>FALSE</dd>
+ * <dt>Ack_Enabled</dt> <dd>FALSE</dd>
+ * <dt>Statistics_List</dt> <dd>All zero.</dd>
+ * <dt>Statistics_Count</dt> <dd>0</dd>
  * </dl>
  * @see #DEFAULT_REPLY_TIMEOUT_MS
  */
 static struct Serial_Struct Serial_Data = 
 {
-	DEFAULT_REPLY_TIMEOUT_MS,DEFAULT_FPGA_BOOT_TIMEOUT_MS
+	DEFAULT_REPLY_TIMEOUT_MS,DEFAULT_FPGA_BOOT_TIMEOUT_MS,
+	PTHREAD_MUTEX_INITIALIZER,PTHREAD_COND_INITIALIZER,PTHREAD_COND_INITIALIZER,0,FALSE,NULL,NULL,
+	0,0,FALSE,FALSE,{{0}},0
 };
 
 /**
@@ -120,6 +256,22 @@ static int Serial_Error_Number = 0;
 static char Serial_Error_String[DETECTOR_GENERAL_ERROR_STRING_LENGTH] = "";
 
 /* internal functions */
+static int Serial_Thread_Start(void);
+static void *Serial_Thread(void *user_arg);
+static struct Serial_Request_Struct *Serial_Request_Next(void);
+static int Serial_Request_Execute(struct Serial_Request_Struct *request);
+static int Serial_Reply_Frame_Complete(struct Serial_Request_Struct *request,int reply_bytes_read,
+				       int *error_frame);
+static void Serial_Statistics_Add(struct Serial_Request_Struct *request,struct timespec start_time,
+				  struct timespec end_time);
+static int Serial_Command_Get_Manufacturers_Data(int *serial_number,struct timespec *build_date,
+						 char *build_code,int *adc_zeroC,int *adc_fortyC,
+						 int *dac_zeroC,int *dac_fortyC);
+static int Serial_Command_Get_Sensor_Temp(int *adc_value);
+static int Serial_Command_Get_Sensor_PCB_Temp(double *pcb_temp);
+static int Serial_Command_Get_TEC_Setpoint(int *dac_value);
+static int Serial_Command_Get_FPGA_Status(unsigned char *status_byte);
+static int Serial_Command_Set_TEC_Setpoint(int dac_value);
 
 /* --------------------------------------------------------
 ** External Functions
@@ -275,13 +427,65 @@ int Detector_Serial_Initialise(void)
 	return TRUE;
 }
 
+/**
+ * Routine to re-open the camera-link's internal serial connection to the Raptor Ninox-640 camera head, after the
+ * frame grabber has been re-opened with a different video format (Detector_Setup_Format_Switch). 
+ * The camera head has not been power cycled, so the FPGA is already booted, and the manufacturers data and 
+ * temperature calibration read by Detector_Serial_Initialise are still valid. We therefore only do the parts of 
+ * Detector_Serial_Initialise that the format file can change:
+ * <ul>
+ * <li>We open the camera-link internal serial connection to the camera head by calling Detector_Serial_Open.
+ * <li>We call Detector_Serial_Command_Get_System_Status to check the FPGA is still booted.
+ * <li>We call Detector_Serial_Command_Set_System_State to set checksum_enable and cmd_ack_enable 
+ *     (with eprom_comms_enable off).
+ * </ul>
+ * @return The routine returns TRUE on success and FALSE on failure. 
+ *         On failure, Serial_Error_Number/Serial_Error_String are set.
+ * @see #Serial_Error_Number
+ * @see #Serial_Error_String
+ * @see #Detector_Serial_Initialise
+ * @see #Detector_Serial_Open
+ * @see #Detector_Serial_Command_Get_System_Status
+ * @see #Detector_Serial_Command_Set_System_State
+ * @see detector_setup.html#Detector_Setup_Format_Switch
+ */
+int Detector_Serial_Reinitialise(void)
+{
+	int fpga_booted;
+
+	Serial_Error_Number = 0;
+#if LOGGING > 1
+	Detector_General_Log(LOG_VERBOSITY_INTERMEDIATE,"Detector_Serial_Reinitialise:Started.");
+#endif
+	/* open serial connection */
+	if(!Detector_Serial_Open())
+		return FALSE;
+	/* the FPGA should still be booted */
+	if(!Detector_Serial_Command_Get_System_Status(NULL,NULL,NULL,&fpga_booted,NULL,NULL))
+		return FALSE;
+	if(fpga_booted == FALSE)
+	{
+		Serial_Error_Number = 70;
+		sprintf(Serial_Error_String,"Detector_Serial_Reinitialise:FPGA is not booted.");
+		return FALSE;
+	}
+	/* set system state to checksum_enable, cmd_ack_enabled. */
+	if(!Detector_Serial_Command_Set_System_State(TRUE,TRUE,FALSE,FALSE))
+		return FALSE;
+#if LOGGING > 1
+	Detector_General_Log(LOG_VERBOSITY_INTERMEDIATE,"Detector_Serial_Reinitialise:Finished.");
+#endif
+	return TRUE;
+}
+
 /**
  * Routine to open the camera-link's internal serial connection to the 
  * Raptor Ninox-640 camera head. This call only works if a connection has been opened to the library/driver
  * by calling Detector_Setup_Open / Detector_Setup_Startup.
  * <ul>
- * <li>We call pxd_serialConfigure to configure the camera-link's internal serial link to 115200 baud, 
+ * <li>We call Detector_Grabber_Serial_Configure to configure the camera-link's internal serial link to 115200 baud, 
  *     8 data bits, 1 stop bit.
+ * <li>We call Serial_Thread_Start to start the serial thread that sends the commands, if it is not already running.
  * </ul>
  * @return The routine returns TRUE on success and FALSE on failure. 
  *         On failure, Serial_Error_Number/Serial_Error_String are set.
@@ -289,6 +493,7 @@ int Detector_Serial_Initialise(void)
  * @see #Serial_Error_Number
  * @see #Serial_Error_String
  * @see #Serial_Data
+ * @see #Serial_Thread_Start
  * @see detector_setup.html#Detector_Setup_Open
  */
 int Detector_Serial_Open(void)
@@ -305,20 +510,59 @@ int Detector_Serial_Open(void)
 	** - 8 data bits
 	** - 1 stop bit
 	*/
-	retval = pxd_serialConfigure(UNITSMAP,0,115200.0,8,0,1,0,0,0);
+	retval = Detector_Grabber_Serial_Configure(UNITSMAP,0,115200.0,8,0,1,0,0,0);
 	if(retval < 0)
 	{
 		Serial_Error_Number = 1;
-		sprintf(Serial_Error_String,"Detector_Serial_Open:pxd_serialConfigure failed: %s (%d).",
-			pxd_mesgErrorCode(retval),retval);
+		sprintf(Serial_Error_String,"Detector_Serial_Open:Detector_Grabber_Serial_Configure failed: %s (%d).",
+			Detector_Grabber_Error_Code_String(retval),retval);
 		return FALSE;
 	}
+	/* start the thread that sends the commands */
+	if(!Serial_Thread_Start())
+		return FALSE;
 #if LOGGING > 1
 	Detector_General_Log(LOG_VERBOSITY_INTERMEDIATE,"Detector_Serial_Open:Finished.");
 #endif
 	return TRUE;
 }
 
+/**
+ * Routine to stop the serial thread, before the connection to the library/driver is closed. Any requests still
+ * queued fail. This routine does nothing if the serial thread is not running.
+ * @return The routine returns TRUE on success and FALSE on failure. 
+ *         On failure, Serial_Error_Number/Serial_Error_String are set.
+ * @see #Serial_Data
+ * @see #Serial_Thread
+ * @see detector_setup.html#Detector_Setup_Close
+ */
+int Detector_Serial_Close(void)
+{
+	int retval;
+
+	Serial_Error_Number = 0;
+	pthread_mutex_lock(&(Serial_Data.Mutex));
+	if(!Serial_Data.Run)
+	{
+		pthread_mutex_unlock(&(Serial_Data.Mutex));
+		return TRUE;
+	}
+	Serial_Data.Run = FALSE;
+	pthread_cond_signal(&(Serial_Data.Request_Condition));
+	pthread_mutex_unlock(&(Serial_Data.Mutex));
+	retval = pthread_join(Serial_Data.Thread,NULL);
+	if(retval != 0)
+	{
+		Serial_Error_Number = 65;
+		sprintf(Serial_Error_String,"Detector_Serial_Close:Failed to join serial thread (%d).",retval);
+		return FALSE;
+	}
+#if LOGGING > 1
+	Detector_General_Log(LOG_VERBOSITY_INTERMEDIATE,"Detector_Serial_Close:Finished.");
+#endif
+	return TRUE;
+}
+
 /**
  * Get the system status from the Raptor's serial interface, and parse the results.
  * The detector's serial interface must have previously been opened before calling this command 
@@ -381,6 +625,9 @@ int Detector_Serial_Command_Get_System_Status(unsigned char *status,int *checksu
 		(*fpga_in_reset) = (reply_buffer[0]&(1<<1)) == 0;
 	if(eprom_comms_enabled != NULL)
 		(*eprom_comms_enabled) = reply_buffer[0]&(1<<0);
+	/* remember the checksum/ack state, for framing later replies */
+	Serial_Data.Checksum_Enabled = ((reply_buffer[0]&(1<<6)) != 0);
+	Serial_Data.Ack_Enabled = ((reply_buffer[0]&(1<<4)) != 0);
 #if LOGGING > 9
 	Detector_General_Log(LOG_VERBOSITY_VERBOSE,"Detector_Serial_Command_Get_System_Status:Finished.");
 #endif
@@ -498,12 +745,44 @@ int Detector_Serial_Command_Set_System_State(int checksum_enable,int cmd_ack_ena
 			}
 		}
 	}
+	/* remember the checksum/ack state, for framing later replies */
+	Serial_Data.Checksum_Enabled = checksum_enable;
+	Serial_Data.Ack_Enabled = cmd_ack_enabled;
 #if LOGGING > 9
 	Detector_General_Log(LOG_VERBOSITY_VERBOSE,"Detector_Serial_Command_Set_System_Status:Finished.");
 #endif
 	return TRUE;
 }
 
+/**
+ * Get the detector's manufacturer data. The set EPROM address and read EPROM commands are sent as one sequence,
+ * so another thread's commands can't be sent in between them. See Serial_Command_Get_Manufacturers_Data.
+ * @param serial_number The address of an integer, on return the camera head serial number.
+ * @param build_date The address of a timespec, on return the camera head build date.
+ * @param build_code A string of at least 6 characters, on return the build code.
+ * @param adc_zeroC The address of an integer, on return the ADC value at 0 degrees C.
+ * @param adc_fortyC The address of an integer, on return the ADC value at 40 degrees C.
+ * @param dac_zeroC The address of an integer, on return the DAC value at 0 degrees C.
+ * @param dac_fortyC The address of an integer, on return the DAC value at 40 degrees C.
+ * @return The routine returns TRUE on success and FALSE on failure. 
+ *         On failure, Serial_Error_Number/Serial_Error_String are set.
+ * @see #Detector_Serial_Sequence_Start
+ * @see #Serial_Command_Get_Manufacturers_Data
+ * @see #Detector_Serial_Sequence_End
+ */
+int Detector_Serial_Command_Get_Manufacturers_Data(int *serial_number,struct timespec *build_date,
+						   char *build_code,int *adc_zeroC,int *adc_fortyC,
+						   int *dac_zeroC,int *dac_fortyC)
+{
+	int retval;
+
+	Detector_Serial_Sequence_Start();
+	retval = Serial_Command_Get_Manufacturers_Data(serial_number,build_date,build_code,adc_zeroC,adc_fortyC,
+						       dac_zeroC,dac_fortyC);
+	Detector_Serial_Sequence_End();
+	return retval;
+}
+
 /**
  * Get the detector's manufacturer data from the Raptor's serial interface, and parse the results.
  * The detector's serial interface must have previously been opened before calling this command 
@@ -532,8 +811,8 @@ int Detector_Serial_Command_Set_System_State(int checksum_enable,int cmd_ack_ena
  * @see #Detector_Serial_Open
  * @see #Detector_Serial_Command_Set_System_State
  */
-int Detector_Serial_Command_Get_Manufacturers_Data(int *serial_number,struct timespec *build_date,
-						   char *build_code,int *adc_zeroC,int *adc_fortyC,int *dac_zeroC,int *dac_fortyC)
+static int Serial_Command_Get_Manufacturers_Data(int *serial_number,struct timespec *build_date,
+						 char *build_code,int *adc_zeroC,int *adc_fortyC,int *dac_zeroC,int *dac_fortyC)
 {
 	struct tm build_date_tm;
 	time_t build_date_s;
@@ -708,6 +987,26 @@ int Detector_Serial_Command_Get_Manufacturers_Data(int *serial_number,struct tim
 	return TRUE;
 }
 
+/**
+ * Get the sensor temperature ADC value. The set address and read memory commands for both bytes are sent as one sequence,
+ * so another thread's commands can't be sent in between them. See Serial_Command_Get_Sensor_Temp.
+ * @param adc_value The address of an integer, on return the 12 bit sensor temperature ADC value.
+ * @return The routine returns TRUE on success and FALSE on failure. 
+ *         On failure, Serial_Error_Number/Serial_Error_String are set.
+ * @see #Detector_Serial_Sequence_Start
+ * @see #Serial_Command_Get_Sensor_Temp
+ * @see #Detector_Serial_Sequence_End
+ */
+int Detector_Serial_Command_Get_Sensor_Temp(int *adc_value)
+{
+	int retval;
+
+	Detector_Serial_Sequence_Start();
+	retval = Serial_Command_Get_Sensor_Temp(adc_value);
+	Detector_Serial_Sequence_End();
+	return retval;
+}
+
 /**
  * Get the Sensor's temperature ADU value.
  * The detector's serial interface must have previously been opened before calling this command (Detector_Serial_Open).
@@ -732,7 +1031,7 @@ int Detector_Serial_Command_Get_Manufacturers_Data(int *serial_number,struct tim
  * @see #Detector_Serial_Command
  * @see #Detector_Serial_Open
  */
-int Detector_Serial_Command_Get_Sensor_Temp(int *adc_value)
+static int Serial_Command_Get_Sensor_Temp(int *adc_value)
 {
 	unsigned char command_buffer[16];
 	unsigned char reply_buffer[16];
@@ -907,6 +1206,26 @@ int Detector_Serial_Command_Get_Sensor_Temp(int *adc_value)
 	return TRUE;
 }
 
+/**
+ * Get the sensor PCB temperature. The set address and read memory commands for both bytes are sent as one sequence,
+ * so another thread's commands can't be sent in between them. See Serial_Command_Get_Sensor_PCB_Temp.
+ * @param pcb_temp The address of a double, on return the sensor PCB temperature in degrees centigrade.
+ * @return The routine returns TRUE on success and FALSE on failure. 
+ *         On failure, Serial_Error_Number/Serial_Error_String are set.
+ * @see #Detector_Serial_Sequence_Start
+ * @see #Serial_Command_Get_Sensor_PCB_Temp
+ * @see #Detector_Serial_Sequence_End
+ */
+int Detector_Serial_Command_Get_Sensor_PCB_Temp(double *pcb_temp)
+{
+	int retval;
+
+	Detector_Serial_Sequence_Start();
+	retval = Serial_Command_Get_Sensor_PCB_Temp(pcb_temp);
+	Detector_Serial_Sequence_End();
+	return retval;
+}
+
 /**
  * Get the Sensor's PCB temperature.
  * The detector's serial interface must have previously been opened before calling this command (Detector_Serial_Open).
@@ -929,7 +1248,7 @@ int Detector_Serial_Command_Get_Sensor_Temp(int *adc_value)
  * @see #Detector_Serial_Command
  * @see #Detector_Serial_Open
  */
-int Detector_Serial_Command_Get_Sensor_PCB_Temp(double *pcb_temp)
+static int Serial_Command_Get_Sensor_PCB_Temp(double *pcb_temp)
 {
 	unsigned char command_buffer[16];
 	unsigned char reply_buffer[16];
@@ -1115,6 +1434,26 @@ int Detector_Serial_Command_Get_Sensor_PCB_Temp(double *pcb_temp)
 	return TRUE;
 }
 
+/**
+ * Get the TEC set-point DAC value. The set address and read memory commands for both bytes are sent as one sequence,
+ * so another thread's commands can't be sent in between them. See Serial_Command_Get_TEC_Setpoint.
+ * @param dac_value The address of an integer, on return the 12 bit TEC set-point DAC value.
+ * @return The routine returns TRUE on success and FALSE on failure. 
+ *         On failure, Serial_Error_Number/Serial_Error_String are set.
+ * @see #Detector_Serial_Sequence_Start
+ * @see #Serial_Command_Get_TEC_Setpoint
+ * @see #Detector_Serial_Sequence_End
+ */
+int Detector_Serial_Command_Get_TEC_Setpoint(int *dac_value)
+{
+	int retval;
+
+	Detector_Serial_Sequence_Start();
+	retval = Serial_Command_Get_TEC_Setpoint(dac_value);
+	Detector_Serial_Sequence_End();
+	return retval;
+}
+
 /**
  * Get the Raptor Ninox-640 camera head's TEC (thermo electric cooler) setpoint.
  * The detector's serial interface must have previously been opened before calling this command (Detector_Serial_Open).
@@ -1139,7 +1478,7 @@ int Detector_Serial_Command_Get_Sensor_PCB_Temp(double *pcb_temp)
  * @see #Detector_Serial_Command
  * @see #Detector_Serial_Open
  */
-int Detector_Serial_Command_Get_TEC_Setpoint(int *dac_value)
+static int Serial_Command_Get_TEC_Setpoint(int *dac_value)
 {
 	unsigned char command_buffer[16];
 	unsigned char reply_buffer[16];
@@ -1314,6 +1653,26 @@ int Detector_Serial_Command_Get_TEC_Setpoint(int *dac_value)
 	return TRUE;
 }
 
+/**
+ * Get the FPGA status byte. The set address and read memory commands are sent as one sequence,
+ * so another thread's commands can't be sent in between them. See Serial_Command_Get_FPGA_Status.
+ * @param status_byte The address of an unsigned char, on return the FPGA status byte.
+ * @return The routine returns TRUE on success and FALSE on failure. 
+ *         On failure, Serial_Error_Number/Serial_Error_String are set.
+ * @see #Detector_Serial_Sequence_Start
+ * @see #Serial_Command_Get_FPGA_Status
+ * @see #Detector_Serial_Sequence_End
+ */
+int Detector_Serial_Command_Get_FPGA_Status(unsigned char *status_byte)
+{
+	int retval;
+
+	Detector_Serial_Sequence_Start();
+	retval = Serial_Command_Get_FPGA_Status(status_byte);
+	Detector_Serial_Sequence_End();
+	return retval;
+}
+
 /**
  * Get the FPGA status byte.
  * The detector's serial interface must have previously been opened before calling this command (Detector_Serial_Open).
@@ -1339,7 +1698,7 @@ int Detector_Serial_Command_Get_TEC_Setpoint(int *dac_value)
  * @see #Detector_Serial_Command
  * @see #Detector_Serial_Open
  */
-int Detector_Serial_Command_Get_FPGA_Status(unsigned char *status_byte)
+static int Serial_Command_Get_FPGA_Status(unsigned char *status_byte)
 {
 	unsigned char command_buffer[16];
 	unsigned char reply_buffer[16];
@@ -1498,6 +1857,26 @@ int Detector_Serial_Command_Set_FPGA_Control(unsigned char ctrl_byte)
 	return TRUE;
 }
 
+/**
+ * Set the TEC set-point DAC value. The MSB and LSB write commands are sent as one sequence,
+ * so another thread's commands can't be sent in between them. See Serial_Command_Set_TEC_Setpoint.
+ * @param dac_value The 12 bit DAC value to use as the TEC set-point.
+ * @return The routine returns TRUE on success and FALSE on failure. 
+ *         On failure, Serial_Error_Number/Serial_Error_String are set.
+ * @see #Detector_Serial_Sequence_Start
+ * @see #Serial_Command_Set_TEC_Setpoint
+ * @see #Detector_Serial_Sequence_End
+ */
+int Detector_Serial_Command_Set_TEC_Setpoint(int dac_value)
+{
+	int retval;
+
+	Detector_Serial_Sequence_Start();
+	retval = Serial_Command_Set_TEC_Setpoint(dac_value);
+	Detector_Serial_Sequence_End();
+	return retval;
+}
+
 /**
  * Set the Raptor Ninox-640 camera head's TEC (thermo electric cooler) setpoint.
  * The detector's serial interface must have previously been opened before calling this command (Detector_Serial_Open).
@@ -1520,7 +1899,7 @@ int Detector_Serial_Command_Set_FPGA_Control(unsigned char ctrl_byte)
  * @see #Detector_Serial_Command
  * @see #Detector_Serial_Open
  */
-int Detector_Serial_Command_Set_TEC_Setpoint(int dac_value)
+static int Serial_Command_Set_TEC_Setpoint(int dac_value)
 {
 	unsigned char command_buffer[16];
 	unsigned char reply_buffer[16];
@@ -1618,20 +1997,16 @@ int Detector_Serial_Command_Set_TEC_Setpoint(int dac_value)
  * The camera link's internal serial connection should have been previously opened/configured 
  * by calling Detector_Serial_Open.
  * <ul>
- * <li>We flush the serial port input and output stream, by calling pxd_serialFlush.
- * <li>We write command_buffer_length bytes of command_buffer to the serial stream by calling pxd_serialWrite.
- * <li>If reply_buffer is NOT NULL, we are expecting a reply, therefore we:
- *     <ul>
- *     <li>Initialise reply_bytes_read to zero and take a timestamp reply_start_time.
- *     <li>Enter a loop while reply_bytes_read is less than the expected_reply_length:
- *         <ul>
- *         <li>Read some serial data into reply_buffer by callling pxd_serialRead.
- *         <li>If we received no bytes, sleep a while (500uS) before trying again.
- *         <li>Take a timestamp, and if the elapsed time between reply_start_time and now is greater than 
- *             Serial_Data.Reply_Timeout_Ms timeout as an error.
- *         </ul>
- *     </ul>
- * <li>
+ * <li>We fill in a request structure with the command and reply buffers, and whether the reply can be framed
+ *     early on an error code (command acknowledgements enabled, and this isn't a status register read, 
+ *     whose reply is a raw status byte).
+ * <li>With the mutex held, we check the serial thread is running (Serial_Data.Run). If it is not (the serial link
+ *     has not been opened with Detector_Serial_Open, or has been closed with Detector_Serial_Close), we fail 
+ *     rather than queue a request that will never be sent.
+ * <li>We add the request to the end of the queue, and signal the serial thread.
+ * <li>We wait on the reply condition variable until the serial thread has processed the request
+ *     (see Serial_Request_Execute).
+ * <li>If the request failed, we copy it's error number/string into Serial_Error_Number/Serial_Error_String.
  * </ul>
  * @param command_buffer A previously allocated array of unsigned characters of at least length command_buffer_length,
  *      each character containing a byte to send to the Raptor Ninox-640 camera head. The command can be binary in
@@ -1646,22 +2021,20 @@ int Detector_Serial_Command_Set_TEC_Setpoint(int dac_value)
  *                     The reply_buffer must be at least this many bytes long 
  * @return The routine returns TRUE on success and FALSE on failure. 
  *         On failure, Serial_Error_Number/Serial_Error_String are set.
- * @see #UNITSMAP
- * @see #Detector_Serial_Open
- * @see #Detector_Serial_Print_Command
+ * @see #SERIAL_SYSTEM_STATUS_REGISTER_READ
+ * @see #Serial_Request_Struct
  * @see #Serial_Error_Number
  * @see #Serial_Error_String
  * @see #Serial_Data
- * @see detector_general.html#DETECTOR_GENERAL_ONE_SECOND_MS
+ * @see #Serial_Request_Execute
+ * @see #Detector_Serial_Open
+ * @see #Detector_Serial_Close
  * @see detector_general.html#Detector_General_Log
- * @see detector_general.html#Detector_General_Log_Format
  */
 int Detector_Serial_Command(unsigned char *command_buffer,int command_buffer_length,
 			    unsigned char *reply_buffer,int expected_reply_length)
 {
-	char print_buffer[DETECTOR_GENERAL_ERROR_STRING_LENGTH];
-	struct timespec reply_start_time,sleep_time,current_time;
-	int reply_bytes_read,retval;
+	struct Serial_Request_Struct request;
 	
 	Serial_Error_Number = 0;
 	if(command_buffer == NULL)
@@ -1673,73 +2046,156 @@ int Detector_Serial_Command(unsigned char *command_buffer,int command_buffer_len
 #if LOGGING > 1
 	Detector_General_Log(LOG_VERBOSITY_VERBOSE,"Detector_Serial_Command:Started.");
 #endif
-	/* flush the serial port */
-	retval = pxd_serialFlush(UNITSMAP,0,1,1);
-	/* write command message */
-#if LOGGING > 9
-	Detector_General_Log_Format(LOG_VERBOSITY_VERY_VERBOSE,"Detector_Serial_Command:Writing '%s'.",
-				    Detector_Serial_Print_Command(command_buffer,command_buffer_length,
-								  print_buffer,DETECTOR_GENERAL_ERROR_STRING_LENGTH));
-#endif
-	retval = pxd_serialWrite(UNITSMAP,0,command_buffer,command_buffer_length);
-	if(retval < 0)
+	request.Command_Buffer = command_buffer;
+	request.Command_Buffer_Length = command_buffer_length;
+	request.Reply_Buffer = reply_buffer;
+	request.Expected_Reply_Length = expected_reply_length;
+	request.Framed = Serial_Data.Ack_Enabled && (command_buffer_length > 0) &&
+		(command_buffer[0] != SERIAL_SYSTEM_STATUS_REGISTER_READ);
+	request.Checksum_Enabled = Serial_Data.Checksum_Enabled;
+	request.Thread = pthread_self();
+	clock_gettime(CLOCK_REALTIME,&(request.Queue_Time));
+	request.Done = FALSE;
+	request.Timed_Out = FALSE;
+	request.Retval = FALSE;
+	request.Error_Number = 0;
+	request.Error_String[0] = '\0';
+	request.Next = NULL;
+	/* queue the request, and wait for the serial thread to process it */
+	pthread_mutex_lock(&(Serial_Data.Mutex));
+	if(!Serial_Data.Run)
+	{
+		pthread_mutex_unlock(&(Serial_Data.Mutex));
+		Serial_Error_Number = 71;
+		sprintf(Serial_Error_String,"Detector_Serial_Command:Serial link is not open.");
+		return FALSE;
+	}
+	if(Serial_Data.Queue_Tail != NULL)
+		Serial_Data.Queue_Tail->Next = &request;
+	else
+		Serial_Data.Queue_Head = &request;
+	Serial_Data.Queue_Tail = &request;
+	pthread_cond_signal(&(Serial_Data.Request_Condition));
+	while(!request.Done)
+		pthread_cond_wait(&(Serial_Data.Reply_Condition),&(Serial_Data.Mutex));
+	pthread_mutex_unlock(&(Serial_Data.Mutex));
+	if(!request.Retval)
 	{
-		Serial_Error_Number = 3;
-		sprintf(Serial_Error_String,"Detector_Serial_Command:pxd_serialWrite failed: %s (%d).",
-			pxd_mesgErrorCode(retval),retval);
+		Serial_Error_Number = request.Error_Number;
+		strcpy(Serial_Error_String,request.Error_String);
 		return FALSE;
 	}
-	/* should we  read a reply ? */
-	if(reply_buffer != NULL)
-	{
-		reply_bytes_read = 0;
-		/* get a timestamp for the start of waiting foor a reply */
-		clock_gettime(CLOCK_REALTIME,&reply_start_time);
-		while(reply_bytes_read < expected_reply_length)
-		{
-			/* try to read some serial data */
-			retval = pxd_serialRead(UNITSMAP,0,reply_buffer+reply_bytes_read,
-						expected_reply_length-reply_bytes_read);
-			if(retval < 0)
-			{
-				Serial_Error_Number = 4;
-				sprintf(Serial_Error_String,"Detector_Serial_Command:pxd_serialRead failed: %s (%d).",
-					pxd_mesgErrorCode(retval),retval);
-				return FALSE;
-			}
-			/* if no bytes received since the last check, sleep a bit */
-			if(retval == 0) 
-			{
-				/* sleep a bit (500 us) */
-				sleep_time.tv_sec = 0;
-				sleep_time.tv_nsec = 500*DETECTOR_GENERAL_ONE_MICROSECOND_NS;
-				nanosleep(&sleep_time,&sleep_time);
-			}
-			reply_bytes_read += retval;
-			/* check for timeout. Note fdifftime works in decimal seconds */
-			clock_gettime(CLOCK_REALTIME,&current_time);
-			if(fdifftime(current_time,reply_start_time) >
-			   (((double)(Serial_Data.Reply_Timeout_Ms))/DETECTOR_GENERAL_ONE_SECOND_MS))
-			{
-				Serial_Error_Number = 5;
-				sprintf(Serial_Error_String,
-				  "Detector_Serial_Command:Timed out waiting for reply after %.3f s (%d of %d bytes read).",
-					fdifftime(current_time,reply_start_time),reply_bytes_read,expected_reply_length);
-				return FALSE;
-			}
-		}/* end while not all reply read */
-#if LOGGING > 9
-		Detector_General_Log_Format(LOG_VERBOSITY_VERY_VERBOSE,"Detector_Serial_Command:Reply was '%s'.",
-					    Detector_Serial_Print_Command(reply_buffer,reply_bytes_read,
-					      print_buffer,DETECTOR_GENERAL_ERROR_STRING_LENGTH));
-#endif
-	}/* end if reply_buffer != NULL */
 #if LOGGING > 1
 	Detector_General_Log(LOG_VERBOSITY_VERBOSE,"Detector_Serial_Command:Finished.");
 #endif
 	return TRUE;
 }
 
+/**
+ * Start sending a sequence of commands from this thread. Until the matching Detector_Serial_Sequence_End, the serial
+ * thread only sends this thread's requests, so commands that need several round trips (e.g. set address then
+ * read memory) are not interleaved with another thread's. If another thread is sending a sequence, we wait
+ * for it to finish. Sequences can be nested by the same thread. This is also used outside this module for
+ * sequences of commands that must not be interleaved, e.g. the FPGA control byte read-modify-write in 
+ * Detector_Temperature_Set_Fan.
+ * @see #Serial_Data
+ * @see #Detector_Serial_Sequence_End
+ * @see detector_temperature.html#Detector_Temperature_Set_Fan
+ */
+void Detector_Serial_Sequence_Start(void)
+{
+	pthread_mutex_lock(&(Serial_Data.Mutex));
+	while((Serial_Data.Sequence_Depth > 0)&&(!pthread_equal(Serial_Data.Sequence_Thread,pthread_self())))
+		pthread_cond_wait(&(Serial_Data.Reply_Condition),&(Serial_Data.Mutex));
+	Serial_Data.Sequence_Thread = pthread_self();
+	Serial_Data.Sequence_Depth++;
+	pthread_mutex_unlock(&(Serial_Data.Mutex));
+}
+
+/**
+ * End a sequence of commands started with Detector_Serial_Sequence_Start. When the outermost sequence ends, we wake
+ * the serial thread (to send any other threads' queued requests) and any threads waiting to start a sequence.
+ * @see #Serial_Data
+ * @see #Detector_Serial_Sequence_Start
+ */
+void Detector_Serial_Sequence_End(void)
+{
+	pthread_mutex_lock(&(Serial_Data.Mutex));
+	Serial_Data.Sequence_Depth--;
+	if(Serial_Data.Sequence_Depth <= 0)
+	{
+		Serial_Data.Sequence_Depth = 0;
+		pthread_cond_signal(&(Serial_Data.Request_Condition));
+		pthread_cond_broadcast(&(Serial_Data.Reply_Condition));
+	}
+	pthread_mutex_unlock(&(Serial_Data.Mutex));
+}
+
+/**
+ * Get the round trip statistics for each kind of command sent to the camera head since the library was started
+ * (or the statistics were reset). Register/EPROM access commands are distinguished by their sub-command byte.
+ * @param statistics_list A list of at least max_count statistics structures, on return filled in.
+ * @param max_count The maximum number of statistics structures to return.
+ * @param statistics_count The address of an integer, on return filled in with the number of structures
+ *        filled in.
+ * @return The routine returns TRUE on success and FALSE on failure. 
+ *         On failure, Serial_Error_Number/Serial_Error_String are set.
+ * @see #Serial_Data
+ * @see #Serial_Statistics_Add
+ */
+int Detector_Serial_Statistics_Get(struct Detector_Serial_Statistics_Struct *statistics_list,int max_count,
+				   int *statistics_count)
+{
+	struct Serial_Statistics_Struct *statistics = NULL;
+	int i;
+
+	Serial_Error_Number = 0;
+	if((statistics_list == NULL)||(statistics_count == NULL))
+	{
+		Serial_Error_Number = 66;
+		sprintf(Serial_Error_String,"Detector_Serial_Statistics_Get:NULL parameter (%p,%p).",
+			(void*)statistics_list,(void*)statistics_count);
+		return FALSE;
+	}
+	pthread_mutex_lock(&(Serial_Data.Mutex));
+	(*statistics_count) = 0;
+	for(i = 0; (i < Serial_Data.Statistics_Count)&&(i < max_count); i++)
+	{
+		statistics = &(Serial_Data.Statistics_List[i]);
+		statistics_list[i].Command_Byte = statistics->Command_Byte;
+		statistics_list[i].Sub_Command_Byte = statistics->Sub_Command_Byte;
+		statistics_list[i].Count = statistics->Count;
+		statistics_list[i].Failure_Count = statistics->Failure_Count;
+		statistics_list[i].Timeout_Count = statistics->Timeout_Count;
+		statistics_list[i].Min_Ms = statistics->Min_Ms;
+		statistics_list[i].Max_Ms = statistics->Max_Ms;
+		if(statistics->Count > 0)
+		{
+			statistics_list[i].Mean_Ms = statistics->Total_Ms/((double)(statistics->Count));
+			statistics_list[i].Queue_Mean_Ms = statistics->Queue_Total_Ms/((double)(statistics->Count));
+		}
+		else
+		{
+			statistics_list[i].Mean_Ms = 0.0;
+			statistics_list[i].Queue_Mean_Ms = 0.0;
+		}
+		(*statistics_count)++;
+	}
+	pthread_mutex_unlock(&(Serial_Data.Mutex));
+	return TRUE;
+}
+
+/**
+ * Reset the per-command round trip statistics.
+ * @see #Serial_Data
+ */
+void Detector_Serial_Statistics_Reset(void)
+{
+	pthread_mutex_lock(&(Serial_Data.Mutex));
+	Serial_Data.Statistics_Count = 0;
+	pthread_mutex_unlock(&(Serial_Data.Mutex));
+}
+
 /**
  * This routine computes a checksum for the specified command buffer, and adds it to the end of the buffer.
  * The command buffer should already have the ETX terminator byte included.
@@ -2014,3 +2470,377 @@ void Detector_Serial_Error_String(char *error_string)
 /* =======================================
 **  internal functions 
 ** ======================================= */
+
+/* =======================================
+**  internal functions
+** ======================================= */
+/**
+ * Start the serial thread, if it is not already running.
+ * @return The routine returns TRUE on success and FALSE on failure. 
+ *         On failure, Serial_Error_Number/Serial_Error_String are set.
+ * @see #Serial_Data
+ * @see #Serial_Thread
+ */
+static int Serial_Thread_Start(void)
+{
+	int retval;
+
+	pthread_mutex_lock(&(Serial_Data.Mutex));
+	if(Serial_Data.Run)
+	{
+		pthread_mutex_unlock(&(Serial_Data.Mutex));
+		return TRUE;
+	}
+	Serial_Data.Run = TRUE;
+	retval = pthread_create(&(Serial_Data.Thread),NULL,Serial_Thread,NULL);
+	if(retval != 0)
+	{
+		Serial_Data.Run = FALSE;
+		pthread_mutex_unlock(&(Serial_Data.Mutex));
+		Serial_Error_Number = 67;
+		sprintf(Serial_Error_String,"Serial_Thread_Start:Failed to create serial thread (%d).",retval);
+		return FALSE;
+	}
+	pthread_mutex_unlock(&(Serial_Data.Mutex));
+#if LOGGING > 1
+	Detector_General_Log(LOG_VERBOSITY_INTERMEDIATE,"Serial_Thread_Start:Serial thread started.");
+#endif
+	return TRUE;
+}
+
+/**
+ * The serial thread, the only thread that talks to the serial link. Whilst Serial_Data.Run is TRUE:
+ * <ul>
+ * <li>We take the next request that can be sent off the queue (Serial_Request_Next), or wait on the request
+ *     condition variable if there isn't one.
+ * <li>We send the request and read it's reply with Serial_Request_Execute, without the mutex held.
+ * <li>We add the round trip time to the statistics, mark the request as done, and wake the waiting callers.
+ * </ul>
+ * When we are stopped, any requests left in the queue fail.
+ * @param user_arg Unused.
+ * @return NULL.
+ * @see #Serial_Data
+ * @see #Serial_Request_Next
+ * @see #Serial_Request_Execute
+ * @see #Serial_Statistics_Add
+ * @see detector_trace.html#Detector_Trace_Thread_Name_Set
+ */
+static void *Serial_Thread(void *user_arg)
+{
+	struct Serial_Request_Struct *request = NULL;
+	struct timespec start_time,end_time;
+
+	Detector_Trace_Thread_Name_Set("serial");
+	pthread_mutex_lock(&(Serial_Data.Mutex));
+	while(Serial_Data.Run)
+	{
+		request = Serial_Request_Next();
+		if(request == NULL)
+		{
+			pthread_cond_wait(&(Serial_Data.Request_Condition),&(Serial_Data.Mutex));
+			continue;
+		}
+		pthread_mutex_unlock(&(Serial_Data.Mutex));
+		clock_gettime(CLOCK_REALTIME,&start_time);
+		request->Retval = Serial_Request_Execute(request);
+		clock_gettime(CLOCK_REALTIME,&end_time);
+		pthread_mutex_lock(&(Serial_Data.Mutex));
+		Serial_Statistics_Add(request,start_time,end_time);
+		request->Done = TRUE;
+		pthread_cond_broadcast(&(Serial_Data.Reply_Condition));
+	}
+	/* fail any requests still queued */
+	while(Serial_Data.Queue_Head != NULL)
+	{
+		request = Serial_Data.Queue_Head;
+		Serial_Data.Queue_Head = request->Next;
+		request->Retval = FALSE;
+		request->Error_Number = 68;
+		sprintf(request->Error_String,"Serial_Thread:Serial thread stopped before command was sent.");
+		request->Done = TRUE;
+	}
+	Serial_Data.Queue_Tail = NULL;
+	pthread_cond_broadcast(&(Serial_Data.Reply_Condition));
+	pthread_mutex_unlock(&(Serial_Data.Mutex));
+	return NULL;
+}
+
+/**
+ * Take the next request that can be sent off the queue. This is the first request in the queue, unless a thread
+ * is sending a sequence of commands, in which case it is the first request from that thread.
+ * Serial_Data.Mutex must be held when calling this routine.
+ * @return The request, removed from the queue, or NULL if there is no request that can be sent.
+ * @see #Serial_Data
+ */
+static struct Serial_Request_Struct *Serial_Request_Next(void)
+{
+	struct Serial_Request_Struct *request = NULL;
+	struct Serial_Request_Struct *previous_request = NULL;
+
+	for(request = Serial_Data.Queue_Head; request != NULL; request = request->Next)
+	{
+		if((Serial_Data.Sequence_Depth == 0)||pthread_equal(request->Thread,Serial_Data.Sequence_Thread))
+		{
+			if(previous_request != NULL)
+				previous_request->Next = request->Next;
+			else
+				Serial_Data.Queue_Head = request->Next;
+			if(Serial_Data.Queue_Tail == request)
+				Serial_Data.Queue_Tail = previous_request;
+			request->Next = NULL;
+			return request;
+		}
+		previous_request = request;
+	}
+	return NULL;
+}
+
+/**
+ * Send a request's command to the camera head, and read it's reply. This is called by the serial thread.
+ * <ul>
+ * <li>We flush the serial port input and output stream, by calling Detector_Grabber_Serial_Flush.
+ * <li>We write the command to the serial stream by calling Detector_Grabber_Serial_Write.
+ * <li>If a reply is expected:
+ *     <ul>
+ *     <li>We sleep for the time the command and reply take to cross the serial link, as no complete reply
+ *         can arrive before then.
+ *     <li>We read the reply with Detector_Grabber_Serial_Read until Serial_Reply_Frame_Complete says it is
+ *         complete. Whilst no bytes arrive we sleep between reads, doubling the sleep from SERIAL_POLL_MIN_NS
+ *         to SERIAL_POLL_MAX_NS.
+ *     <li>If the reply looks like an error frame, we wait a couple of byte times and try one more read: if
+ *         more bytes arrive it was data after all, otherwise the command failed with that error code.
+ *     <li>We time out after Serial_Data.Reply_Timeout_Ms.
+ *     </ul>
+ * <li>The command (from the flush to the end of the reply) is recorded as a "serial_command" trace span,
+ *     with the command byte as the span detail.
+ * </ul>
+ * Errors are put in the request's Error_Number/Error_String, as this thread's Serial_Error_Number is not the
+ * caller's.
+ * @param request The request to send.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #UNITSMAP
+ * @see #SERIAL_BYTE_TIME_NS
+ * @see #SERIAL_POLL_MIN_NS
+ * @see #SERIAL_POLL_MAX_NS
+ * @see #Serial_Data
+ * @see #Serial_Reply_Frame_Complete
+ * @see #Detector_Serial_Print_Command
+ * @see detector_general.html#DETECTOR_GENERAL_ONE_SECOND_MS
+ * @see detector_general.html#Detector_General_Log_Format
+ * @see detector_trace.html#Detector_Trace_Span_Start
+ * @see detector_trace.html#Detector_Trace_Span_End
+ */
+static int Serial_Request_Execute(struct Serial_Request_Struct *request)
+{
+	char print_buffer[DETECTOR_GENERAL_ERROR_STRING_LENGTH];
+	char trace_detail[8];
+	struct timespec reply_start_time,sleep_time,current_time,trace_time;
+	long poll_ns;
+	int reply_bytes_read,retval,error_frame;
+	
+	/* the trace span detail is the command byte */
+	Detector_Trace_Span_Start(&trace_time);
+	if(request->Command_Buffer_Length > 0)
+		sprintf(trace_detail,"0x%02x",request->Command_Buffer[0]);
+	else
+		strcpy(trace_detail,"none");
+	/* flush the serial port */
+	retval = Detector_Grabber_Serial_Flush(UNITSMAP,0,1,1);
+	/* write command message */
+#if LOGGING > 9
+	Detector_General_Log_Format(LOG_VERBOSITY_VERY_VERBOSE,"Serial_Request_Execute:Writing '%s'.",
+				    Detector_Serial_Print_Command(request->Command_Buffer,request->Command_Buffer_Length,
+								  print_buffer,DETECTOR_GENERAL_ERROR_STRING_LENGTH));
+#endif
+	retval = Detector_Grabber_Serial_Write(UNITSMAP,0,request->Command_Buffer,request->Command_Buffer_Length);
+	if(retval < 0)
+	{
+		request->Error_Number = 3;
+		sprintf(request->Error_String,"Detector_Serial_Command:Detector_Grabber_Serial_Write failed: %s (%d).",
+			Detector_Grabber_Error_Code_String(retval),retval);
+		Detector_Trace_Span_End("serial","serial_command",trace_detail,&trace_time);
+		return FALSE;
+	}
+	/* should we  read a reply ? */
+	if(request->Reply_Buffer != NULL)
+	{
+		reply_bytes_read = 0;
+		/* get a timestamp for the start of waiting foor a reply */
+		clock_gettime(CLOCK_REALTIME,&reply_start_time);
+		/* the whole reply can't arrive before the command and reply have crossed the serial link */
+		sleep_time.tv_sec = 0;
+		sleep_time.tv_nsec = ((long)(request->Command_Buffer_Length+request->Expected_Reply_Length))*
+			SERIAL_BYTE_TIME_NS;
+		nanosleep(&sleep_time,NULL);
+		poll_ns = SERIAL_POLL_MIN_NS;
+		while(!Serial_Reply_Frame_Complete(request,reply_bytes_read,&error_frame))
+		{
+			/* try to read some serial data */
+			retval = Detector_Grabber_Serial_Read(UNITSMAP,0,request->Reply_Buffer+reply_bytes_read,
+							      request->Expected_Reply_Length-reply_bytes_read);
+			if(retval < 0)
+			{
+				request->Error_Number = 4;
+				sprintf(request->Error_String,
+					"Detector_Serial_Command:Detector_Grabber_Serial_Read failed: %s (%d).",
+					Detector_Grabber_Error_Code_String(retval),retval);
+				Detector_Trace_Span_End("serial","serial_command",trace_detail,&trace_time);
+				return FALSE;
+			}
+			/* if no bytes received since the last check, back off before polling again */
+			if(retval == 0) 
+			{
+				sleep_time.tv_sec = 0;
+				sleep_time.tv_nsec = poll_ns;
+				nanosleep(&sleep_time,NULL);
+				poll_ns *= 2;
+				if(poll_ns > SERIAL_POLL_MAX_NS)
+					poll_ns = SERIAL_POLL_MAX_NS;
+			}
+			else
+				poll_ns = SERIAL_POLL_MIN_NS;
+			reply_bytes_read += retval;
+			/* check for timeout. Note fdifftime works in decimal seconds */
+			clock_gettime(CLOCK_REALTIME,&current_time);
+			if(fdifftime(current_time,reply_start_time) >
+			   (((double)(Serial_Data.Reply_Timeout_Ms))/DETECTOR_GENERAL_ONE_SECOND_MS))
+			{
+				request->Error_Number = 5;
+				sprintf(request->Error_String,
+				  "Detector_Serial_Command:Timed out waiting for reply after %.3f s (%d of %d bytes read).",
+					fdifftime(current_time,reply_start_time),reply_bytes_read,
+					request->Expected_Reply_Length);
+				request->Timed_Out = TRUE;
+				Detector_Trace_Span_End("serial","serial_command",trace_detail,&trace_time);
+				return FALSE;
+			}
+			/* an error frame could be the start of a data reply, make sure nothing else is coming */
+			if((retval > 0)&&Serial_Reply_Frame_Complete(request,reply_bytes_read,&error_frame)&&error_frame)
+			{
+				sleep_time.tv_sec = 0;
+				sleep_time.tv_nsec = 2*SERIAL_BYTE_TIME_NS;
+				nanosleep(&sleep_time,NULL);
+				retval = Detector_Grabber_Serial_Read(UNITSMAP,0,request->Reply_Buffer+reply_bytes_read,
+								      request->Expected_Reply_Length-reply_bytes_read);
+				if(retval > 0)
+				{
+					/* it was the start of a data reply, only a complete reply will do now */
+					reply_bytes_read += retval;
+					request->Framed = FALSE;
+				}
+			}
+		}/* end while reply not complete */
+#if LOGGING > 9
+		Detector_General_Log_Format(LOG_VERBOSITY_VERY_VERBOSE,"Serial_Request_Execute:Reply was '%s'.",
+					    Detector_Serial_Print_Command(request->Reply_Buffer,reply_bytes_read,
+					      print_buffer,DETECTOR_GENERAL_ERROR_STRING_LENGTH));
+#endif
+		if(error_frame)
+		{
+			request->Error_Number = 69;
+			sprintf(request->Error_String,
+				"Detector_Serial_Command:Command %s failed with error reply %#02x (%d of %d bytes read).",
+				trace_detail,request->Reply_Buffer[0],reply_bytes_read,request->Expected_Reply_Length);
+			Detector_Trace_Span_End("serial","serial_command",trace_detail,&trace_time);
+			return FALSE;
+		}
+	}/* end if reply_buffer != NULL */
+	Detector_Trace_Span_End("serial","serial_command",trace_detail,&trace_time);
+	return TRUE;
+}
+
+/**
+ * Reply framing parser. Decide whether the reply read so far is complete. A reply is complete when all
+ * Expected_Reply_Length bytes have been read. If the request is framed (command acknowledgements are enabled),
+ * a failed command is replied to with just an ETX error code (SERIAL_ETX_SER_TIMEOUT..SERIAL_ETX_UNKNOWN_CMD)
+ * followed by the command's checksum (if checksums are enabled), so that is also a complete (error) reply.
+ * @param request The request being read.
+ * @param reply_bytes_read The number of reply bytes read so far.
+ * @param error_frame The address of an integer, on return TRUE if the reply is complete and was an error frame
+ *        shorter than the expected reply, FALSE otherwise.
+ * @return TRUE if the reply is complete, FALSE if more bytes are needed.
+ * @see #SERIAL_ETX_SER_TIMEOUT
+ * @see #SERIAL_ETX_UNKNOWN_CMD
+ */
+static int Serial_Reply_Frame_Complete(struct Serial_Request_Struct *request,int reply_bytes_read,
+				       int *error_frame)
+{
+	unsigned char *reply_buffer = request->Reply_Buffer;
+
+	(*error_frame) = FALSE;
+	if(reply_bytes_read >= request->Expected_Reply_Length)
+		return TRUE;
+	if((!request->Framed)||(reply_bytes_read < 1))
+		return FALSE;
+	if((reply_buffer[0] < SERIAL_ETX_SER_TIMEOUT)||(reply_buffer[0] > SERIAL_ETX_UNKNOWN_CMD))
+		return FALSE;
+	if(request->Checksum_Enabled)
+	{
+		/* the error code is followed by the checksum of the command being replied to */
+		if(reply_bytes_read < 2)
+			return FALSE;
+		if(reply_buffer[1] != request->Command_Buffer[request->Command_Buffer_Length-1])
+			return FALSE;
+	}
+	(*error_frame) = TRUE;
+	return TRUE;
+}
+
+/**
+ * Add a processed request to the round trip statistics of it's kind of command. The kind of command is the first
+ * command byte, plus the second for register/EPROM access commands. If the statistics list is full, commands of
+ * a new kind are not recorded. Serial_Data.Mutex must be held when calling this routine.
+ * @param request The processed request.
+ * @param start_time When the serial thread started sending the request.
+ * @param end_time When the serial thread finished reading the reply.
+ * @see #Serial_Data
+ * @see #SERIAL_REGISTER_COMMAND
+ * @see #DETECTOR_SERIAL_MAX_STATISTICS_COUNT
+ * @see detector_general.html#fdifftime
+ */
+static void Serial_Statistics_Add(struct Serial_Request_Struct *request,struct timespec start_time,
+				  struct timespec end_time)
+{
+	struct Serial_Statistics_Struct *statistics = NULL;
+	unsigned char command_byte,sub_command_byte;
+	double round_trip_ms;
+	int i;
+
+	if(request->Command_Buffer_Length < 1)
+		return;
+	command_byte = request->Command_Buffer[0];
+	if((command_byte == SERIAL_REGISTER_COMMAND)&&(request->Command_Buffer_Length > 1))
+		sub_command_byte = request->Command_Buffer[1];
+	else
+		sub_command_byte = 0;
+	for(i = 0; i < Serial_Data.Statistics_Count; i++)
+	{
+		if((Serial_Data.Statistics_List[i].Command_Byte == command_byte)&&
+		   (Serial_Data.Statistics_List[i].Sub_Command_Byte == sub_command_byte))
+		{
+			statistics = &(Serial_Data.Statistics_List[i]);
+			break;
+		}
+	}
+	if(statistics == NULL)
+	{
+		if(Serial_Data.Statistics_Count >= DETECTOR_SERIAL_MAX_STATISTICS_COUNT)
+			return;
+		statistics = &(Serial_Data.Statistics_List[Serial_Data.Statistics_Count++]);
+		memset(statistics,0,sizeof(struct Serial_Statistics_Struct));
+		statistics->Command_Byte = command_byte;
+		statistics->Sub_Command_Byte = sub_command_byte;
+	}
+	round_trip_ms = fdifftime(end_time,start_time)*DETECTOR_GENERAL_ONE_SECOND_MS;
+	if((statistics->Count == 0)||(round_trip_ms < statistics->Min_Ms))
+		statistics->Min_Ms = round_trip_ms;
+	if((statistics->Count == 0)||(round_trip_ms > statistics->Max_Ms))
+		statistics->Max_Ms = round_trip_ms;
+	statistics->Total_Ms += round_trip_ms;
+	statistics->Queue_Total_Ms += fdifftime(start_time,request->Queue_Time)*DETECTOR_GENERAL_ONE_SECOND_MS;
+	statistics->Count++;
+	if(!request->Retval)
+		statistics->Failure_Count++;
+	if(request->Timed_Out)
+		statistics->Timeout_Count++;
+}
@@ -20,7 +20,9 @@
 #include "detector_setup.h"
 #include "detector_temperature.h"
 #include "detector_general.h"
-#include "xcliball.h"
+#include "detector_grabber.h"
+#include "detector_latency.h"
+#include "detector_telemetry.h"
 
 /* hash defines */
 /**
@@ -31,21 +33,53 @@
  * Define a bitwise definition of which cameras we are talking to, to pass into XCLIB functions.
  */
 #define UNITSMAP                  ((1<<UNITS)-1) 
+/**
+ * The maximum number of '.fmt' format files that can be preloaded.
+ */
+#define SETUP_MAX_FORMAT_COUNT    (8)
+/**
+ * The maximum length of a '.fmt' format filename.
+ */
+#define SETUP_FORMAT_FILENAME_LENGTH (256)
 
 /* data types */
+/**
+ * Data type holding a preloaded '.fmt' format file:
+ * <dl>
+ * <dt>Filename</dt> <dd>The format filename.</dd>
+ * <dt>Contents</dt> <dd>An allocated copy of the contents of the format file.</dd>
+ * <dt>Length</dt> <dd>The length of Contents, in bytes.</dd>
+ * </dl>
+ * @see #SETUP_FORMAT_FILENAME_LENGTH
+ */
+struct Setup_Format_Struct
+{
+	char Filename[SETUP_FORMAT_FILENAME_LENGTH];
+	char *Contents;
+	size_t Length;
+};
+
 /**
  * Data type holding local data to detector_setup. This consists of the following:
  * <dl>
  * <li>Is_Open</dt> <dd>Boolean, determines whether a connection to the detector has been previously successfully been opened.
  * <dt>Size_X</dt> <dd>The size of the frame grabber image in the X direction, in pixels.</dd>
  * <dt>Size_Y</dt> <dd>The size of the frame grabber image in the Y direction, in pixels.</dd>
+ * <dt>Format_Filename</dt> <dd>The '.fmt' format file the frame grabber was last opened with.</dd>
+ * <dt>Format_List</dt> <dd>The list of preloaded format files.</dd>
+ * <dt>Format_Count</dt> <dd>The number of preloaded format files in Format_List.</dd>
  * </dl>
+ * @see #Setup_Format_Struct
+ * @see #SETUP_MAX_FORMAT_COUNT
  */
 struct Setup_Struct
 {
 	int Is_Open;
 	int Size_X;
 	int Size_Y;
+	char Format_Filename[SETUP_FORMAT_FILENAME_LENGTH];
+	struct Setup_Format_Struct Format_List[SETUP_MAX_FORMAT_COUNT];
+	int Format_Count;
 };
 
 /* internal variables */
@@ -59,11 +93,14 @@ static char rcsid[] = "$Id$";
  * <li>Is_Open</dt> <dd>FALSE</dd>
  * <dt>Size_X</dt> <dd>0</dd>
  * <dt>Size_Y</dt> <dd>0</dd>
+ * <dt>Format_Filename</dt> <dd>""</dd>
+ * <dt>Format_List</dt> <dd>All empty</dd>
+ * <dt>Format_Count</dt> <dd>0</dd>
  * </dl>
  */
 static struct Setup_Struct Setup_Data = 
 {
-	FALSE,0,0
+	FALSE,0,0,"",{{"",NULL,0}},0
 };
 
 /**
@@ -78,6 +115,7 @@ static char Setup_Error_String[DETECTOR_GENERAL_ERROR_STRING_LENGTH] = "";
 
 /* internal functions */
 static int Setup_Get_Dimensions(int *x_size,int *y_size);
+static struct Setup_Format_Struct *Setup_Format_Find(char *format_filename);
 
 /* --------------------------------------------------------
 ** External Functions
@@ -91,21 +129,26 @@ static int Setup_Get_Dimensions(int *x_size,int *y_size);
  *     <li>We retrieve the current fpga status byte using Detector_Serial_Command_Get_FPGA_Status.
  *     <li>We extract whether the fan is currently turned on or off 
  *         (is the DETECTOR_SERIAL_FPGA_CTRL_FAN_ENABLED bit set?), and set turn_fan_on accordingly.
+ *     <li>We pause the telemetry sampler (if it is running) using Detector_Telemetry_Pause, so it does not send
+ *         serial commands whilst the serial link is being re-initialised.
  *     <li>We close the connection to the library by calling Detector_Setup_Shutdown.
  *     </ul>
  * <li>Detector_Setup_Open is called with the specified format_file.
- * <li>We log some information from the frame grabber by calling pxd_infoMemsize, pxd_imageZdim, pxd_infoUnits.
+ * <li>We log some information from the frame grabber by calling Detector_Grabber_Info_Memsize, Detector_Grabber_Image_Z_Dim, Detector_Grabber_Info_Units.
  * <li>We call Setup_Get_Dimensions to get the frame grabbers image dimensions from the frame grabber. We
  *     store the returned image dimensions in the setup data (Size_X/Size_Y).
- * <li>We log some more information from the frame grabber by calling pxd_imageCdim / pxd_imageBdim.
+ * <li>We log some more information from the frame grabber by calling Detector_Grabber_Image_C_Dim / Detector_Grabber_Image_B_Dim.
  * <li>We initialise the detector library's buffers by calling Detector_Buffer_Allocate. Detector_Buffer_Allocate is written such that
  *     the buffers will only be freed/reallocated, if the size dimensions have changed (or Detector_Buffer_Allocate has not been called before).
  * <li>We initialise the internal serial link to the detector by calling Detector_Serial_Initialise.
- * <li>Setup_Data.Is_Open is set to TRUE as the connection to the detector is now open.
+ * <li>Setup_Data.Is_Open is set to TRUE as the connection to the detector is now open, and the format filename
+ *     is saved in Setup_Data.Format_Filename.
  * <li>We use the previously initialsed / extracted fan status to turn the fan off if necessary by calling 
  *     Detector_Temperature_Set_Fan with turn_fan_on. Detector_Setup_Open reinitialises the fan to on 
  *     (with the format files we are currently using), and this call allows us to retain the fan status (on or off) 
  *     over a call to Detector_Setup_Startup.
+ * <li>We resume the telemetry sampler using Detector_Telemetry_Resume, if we paused it. This is also done if 
+ *     re-opening the frame grabber or serial link fails.
  * </ul>
  * @param formatfile The filename of a '.fmt' format file, used to configure the video mode of the detector.
  * @return The routine returns TRUE on success and FALSE on failure. 
@@ -122,17 +165,20 @@ static int Setup_Get_Dimensions(int *x_size,int *y_size);
  * @see detector_serial.html#Detector_Serial_Initialise
  * @see detector_serial.html#Detector_Serial_Command_Get_FPGA_Status
  * @see detector_temperature.html#Detector_Temperature_Set_Fan
+ * @see detector_telemetry.html#Detector_Telemetry_Pause
+ * @see detector_telemetry.html#Detector_Telemetry_Resume
  * @see detector_general.html#Detector_General_Log
  * @see detector_general.html#Detector_General_Log_Format
  */
 int Detector_Setup_Startup(char *format_filename)
 {
 	unsigned char fpga_status;
-	int retval,turn_fan_on;
+	int retval,turn_fan_on,telemetry_paused;
 	
 	Setup_Error_Number = 0;
 	/* default to turning the fan on (by default an open on out format files will do this) */
 	turn_fan_on = TRUE;
+	telemetry_paused = FALSE;
 	if(format_filename == NULL)
 	{
 		Setup_Error_Number = 3;
@@ -163,6 +209,9 @@ int Detector_Setup_Startup(char *format_filename)
 			Detector_General_Error();
 			turn_fan_on = TRUE;
 		}
+		/* stop the telemetry sampler sending serial commands whilst the serial link is re-initialised */
+		Detector_Telemetry_Pause();
+		telemetry_paused = TRUE;
 		/* shutdown connection */
 #if LOGGING > 1
 		Detector_General_Log(LOG_VERBOSITY_VERBOSE,
@@ -178,21 +227,25 @@ int Detector_Setup_Startup(char *format_filename)
 	if(!Detector_Setup_Open("","",format_filename))
 	{
 		/* Setup_Error_Number / Setup_Error_String set in Detector_Setup_Open */
+		if(telemetry_paused)
+			Detector_Telemetry_Resume();
 		return FALSE;
 	}
 	/* get some information from the frame grabber */
 #if LOGGING > 1
 	Detector_General_Log_Format(LOG_VERBOSITY_VERBOSE,"Detector_Setup_Startup:Frame buffer memory size %ld bytes.",
-				    pxd_infoMemsize(UNITSMAP));
+				    Detector_Grabber_Info_Memsize(UNITSMAP));
 	Detector_General_Log_Format(LOG_VERBOSITY_VERBOSE,"Detector_Setup_Startup:Image frame buffers: %d.",
-				    pxd_imageZdim());
+				    Detector_Grabber_Image_Z_Dim());
 	Detector_General_Log_Format(LOG_VERBOSITY_VERBOSE,"Detector_Setup_Startup:Number of boards: %d.",
-				    pxd_infoUnits());
+				    Detector_Grabber_Info_Units());
 #endif
 	/* get image dimensions */
 	if(!Setup_Get_Dimensions(&(Setup_Data.Size_X),&(Setup_Data.Size_Y)))
 	{
 		/* Setup_Error_Number / Setup_Error_String set in Setup_Get_Dimensions */
+		if(telemetry_paused)
+			Detector_Telemetry_Resume();
 		return FALSE;
 	}
 	/* more information from the frame grabber logged */
@@ -200,14 +253,16 @@ int Detector_Setup_Startup(char *format_filename)
 	Detector_General_Log_Format(LOG_VERBOSITY_VERBOSE,"Detector_Setup_Startup:Image dimensions (x=%d,y=%d).",
 				    Setup_Data.Size_X,Setup_Data.Size_Y);
 	Detector_General_Log_Format(LOG_VERBOSITY_VERBOSE,"Detector_Setup_Startup:Colours = %d.",
-				    pxd_imageCdim());
+				    Detector_Grabber_Image_C_Dim());
 	Detector_General_Log_Format(LOG_VERBOSITY_VERBOSE,"Detector_Setup_Startup:Bits per pixel = %d.",
-				    pxd_imageCdim()*pxd_imageBdim());
+				    Detector_Grabber_Image_C_Dim()*Detector_Grabber_Image_B_Dim());
 #endif
 	/* allocate image buffers. Note this now automatically frees and re-allocates buffers, only if the sizes have changed,
 	** if the sizes are the same and the buffers are non-null nothing is changed. */
 	if(!Detector_Buffer_Allocate(Setup_Data.Size_X,Setup_Data.Size_Y))
 	{
+		if(telemetry_paused)
+			Detector_Telemetry_Resume();
 		Setup_Error_Number = 8;
 		sprintf(Setup_Error_String,
 			"Detector_Setup_Startup:Detector_Buffer_Allocate(size_x = %d,size_y = %d) failed.",
@@ -217,12 +272,16 @@ int Detector_Setup_Startup(char *format_filename)
 	/* open connection to and initialise the internal serial link */
 	if(!Detector_Serial_Initialise())
 	{
+		if(telemetry_paused)
+			Detector_Telemetry_Resume();
 		Setup_Error_Number = 9;
 		sprintf(Setup_Error_String,"Detector_Setup_Startup:Detector_Serial_Initialise failed.");
 		return FALSE;
 	}
 	/* we have now finished initialing the detector */
 	Setup_Data.Is_Open = TRUE;
+	strncpy(Setup_Data.Format_Filename,format_filename,SETUP_FORMAT_FILENAME_LENGTH-1);
+	Setup_Data.Format_Filename[SETUP_FORMAT_FILENAME_LENGTH-1] = '\0';
 	/* Detector_Setup_Open will have turned the fan back on (for our format files).
 	** If it was previously turned off, turn it off again */
 	if(!Detector_Temperature_Set_Fan(turn_fan_on))
@@ -230,6 +289,8 @@ int Detector_Setup_Startup(char *format_filename)
 		/* if reseting the fan failed, log it and try and continue anyway. */
 		Detector_General_Error();
 	}
+	if(telemetry_paused)
+		Detector_Telemetry_Resume();
 #if LOGGING > 1
 	Detector_General_Log(LOG_VERBOSITY_INTERMEDIATE,"Detector_Setup_Startup:Finished.");
 #endif
@@ -270,7 +331,289 @@ int Detector_Setup_Shutdown(void)
 }
 
 /**
- * Routine to open a connection to the library/driver, using the xclib pxd_PIXCIopen routine.
+ * Routine to preload a '.fmt' format file, so it can be switched to quickly later using 
+ * Detector_Setup_Format_Switch. This is normally called at startup for each format (coadd exposure length)
+ * that may be used, so a missing or unreadable format file is found then rather than during an observing sequence.
+ * <ul>
+ * <li>If the format has already been preloaded, we do nothing.
+ * <li>We check there is room in Setup_Data.Format_List.
+ * <li>We read the whole format file into an allocated buffer, and add it to Setup_Data.Format_List.
+ * </ul>
+ * @param format_filename The filename of a '.fmt' format file.
+ * @return The routine returns TRUE on success and FALSE on failure. 
+ *         On failure, Setup_Error_Number/Setup_Error_String are set.
+ * @see #Setup_Data
+ * @see #Setup_Format_Find
+ * @see #SETUP_MAX_FORMAT_COUNT
+ * @see #SETUP_FORMAT_FILENAME_LENGTH
+ * @see #Detector_Setup_Format_Switch
+ * @see detector_general.html#Detector_General_Log_Format
+ */
+int Detector_Setup_Format_Preload(char *format_filename)
+{
+	struct Setup_Format_Struct *format = NULL;
+	FILE *fp = NULL;
+	long file_length;
+
+	Setup_Error_Number = 0;
+	if(format_filename == NULL)
+	{
+		Setup_Error_Number = 11;
+		sprintf(Setup_Error_String,"Detector_Setup_Format_Preload:format_filename was NULL.");
+		return FALSE;
+	}
+	if(strlen(format_filename) >= SETUP_FORMAT_FILENAME_LENGTH)
+	{
+		Setup_Error_Number = 12;
+		sprintf(Setup_Error_String,"Detector_Setup_Format_Preload:format_filename too long (%lu).",
+			strlen(format_filename));
+		return FALSE;
+	}
+	/* already preloaded? */
+	if(Setup_Format_Find(format_filename) != NULL)
+		return TRUE;
+	if(Setup_Data.Format_Count >= SETUP_MAX_FORMAT_COUNT)
+	{
+		Setup_Error_Number = 13;
+		sprintf(Setup_Error_String,"Detector_Setup_Format_Preload:Too many formats preloaded (%d) to add '%s'.",
+			Setup_Data.Format_Count,format_filename);
+		return FALSE;
+	}
+	format = &(Setup_Data.Format_List[Setup_Data.Format_Count]);
+	fp = fopen(format_filename,"r");
+	if(fp == NULL)
+	{
+		Setup_Error_Number = 14;
+		sprintf(Setup_Error_String,"Detector_Setup_Format_Preload:Failed to open '%s' (%d).",
+			format_filename,errno);
+		return FALSE;
+	}
+	if((fseek(fp,0L,SEEK_END) != 0)||((file_length = ftell(fp)) < 0)||(fseek(fp,0L,SEEK_SET) != 0))
+	{
+		fclose(fp);
+		Setup_Error_Number = 15;
+		sprintf(Setup_Error_String,"Detector_Setup_Format_Preload:Failed to get the length of '%s' (%d).",
+			format_filename,errno);
+		return FALSE;
+	}
+	format->Contents = (char *)malloc(file_length+1);
+	if(format->Contents == NULL)
+	{
+		fclose(fp);
+		Setup_Error_Number = 16;
+		sprintf(Setup_Error_String,"Detector_Setup_Format_Preload:Failed to allocate contents of '%s' (%ld).",
+			format_filename,file_length);
+		return FALSE;
+	}
+	format->Length = fread(format->Contents,1,file_length,fp);
+	if(format->Length != (size_t)file_length)
+	{
+		fclose(fp);
+		free(format->Contents);
+		format->Contents = NULL;
+		Setup_Error_Number = 17;
+		sprintf(Setup_Error_String,"Detector_Setup_Format_Preload:Failed to read '%s' (%lu of %ld bytes).",
+			format_filename,format->Length,file_length);
+		return FALSE;
+	}
+	fclose(fp);
+	format->Contents[format->Length] = '\0';
+	strcpy(format->Filename,format_filename);
+	Setup_Data.Format_Count++;
+#if LOGGING > 1
+	Detector_General_Log_Format(LOG_VERBOSITY_INTERMEDIATE,
+				    "Detector_Setup_Format_Preload:Preloaded '%s' (%lu bytes).",
+				    format_filename,format->Length);
+#endif
+	return TRUE;
+}
+
+/**
+ * Routine to switch the detector to a different '.fmt' format file (e.g. a different coadd exposure length),
+ * reprogramming only what differs from the format currently in use. Detector_Setup_Startup re-initialises
+ * everything, this routine is much quicker when the detector is already open:
+ * <ul>
+ * <li>If the detector has not been opened yet, we just call Detector_Setup_Startup.
+ * <li>If the requested format is the one currently in use, there is nothing to do.
+ * <li>If the frame grabber backend is XCLIB, and both the requested and current formats were preloaded
+ *     (Detector_Setup_Format_Preload) with identical contents, the video mode is the same and there is
+ *     nothing to reprogram. (The simulator derives it's field period from the format filename, so this check is only
+ *     done for XCLIB).
+ * <li>Otherwise the frame grabber has to be re-opened with the new format:
+ *     <ul>
+ *     <li>We retrieve whether the fan is on using Detector_Serial_Command_Get_FPGA_Status, as the format file
+ *         turns it back on.
+ *     <li>We pause the telemetry sampler (if it is running) using Detector_Telemetry_Pause, so it does not send
+ *         serial commands whilst the serial link is closed.
+ *     <li>We close the serial link and frame grabber using Detector_Setup_Close.
+ *     <li>We re-open the frame grabber with the new format using Detector_Setup_Open.
+ *     <li>We get the new image dimensions using Setup_Get_Dimensions, and call Detector_Buffer_Allocate 
+ *         (which only re-allocates the buffers if the dimensions have changed).
+ *     <li>We re-open the serial link using Detector_Serial_Reinitialise. Unlike Detector_Serial_Initialise this 
+ *         does not wait for the FPGA to boot, or re-read the manufacturers data and temperature calibration from the 
+ *         EPROM, as the camera head has not been power cycled. If this fails we log the error and fall back to 
+ *         Detector_Serial_Initialise.
+ *     <li>We turn the fan back off using Detector_Temperature_Set_Fan, if it was off before.
+ *     <li>We resume the telemetry sampler using Detector_Telemetry_Resume. This is also done if re-opening the
+ *         frame grabber or serial link fails.
+ *     </ul>
+ * <li>We record how long the switch took in the DETECTOR_LATENCY_STAGE_FORMAT_SWITCH latency stage.
+ * </ul>
+ * @param format_filename The filename of a '.fmt' format file, used to configure the video mode of the detector.
+ *        This does not have to have been preloaded.
+ * @return The routine returns TRUE on success and FALSE on failure. 
+ *         On failure, Setup_Error_Number/Setup_Error_String are set.
+ * @see #Setup_Data
+ * @see #Setup_Format_Find
+ * @see #Setup_Get_Dimensions
+ * @see #Detector_Setup_Startup
+ * @see #Detector_Setup_Format_Preload
+ * @see #Detector_Setup_Open
+ * @see #Detector_Setup_Close
+ * @see detector_buffer.html#Detector_Buffer_Allocate
+ * @see detector_grabber.html#Detector_Grabber_Backend_Get
+ * @see detector_latency.html#Detector_Latency_Timestamp
+ * @see detector_latency.html#Detector_Latency_Stage_Record
+ * @see detector_serial.html#DETECTOR_SERIAL_FPGA_CTRL_FAN_ENABLED
+ * @see detector_serial.html#Detector_Serial_Command_Get_FPGA_Status
+ * @see detector_serial.html#Detector_Serial_Reinitialise
+ * @see detector_serial.html#Detector_Serial_Initialise
+ * @see detector_temperature.html#Detector_Temperature_Set_Fan
+ * @see detector_telemetry.html#Detector_Telemetry_Pause
+ * @see detector_telemetry.html#Detector_Telemetry_Resume
+ * @see detector_general.html#Detector_General_Log_Format
+ */
+int Detector_Setup_Format_Switch(char *format_filename)
+{
+	struct Setup_Format_Struct *new_format = NULL;
+	struct Setup_Format_Struct *current_format = NULL;
+	struct timespec start_time;
+	unsigned char fpga_status;
+	int turn_fan_on;
+
+	Setup_Error_Number = 0;
+	if(format_filename == NULL)
+	{
+		Setup_Error_Number = 18;
+		sprintf(Setup_Error_String,"Detector_Setup_Format_Switch:format_filename was NULL.");
+		return FALSE;
+	}
+#if LOGGING > 1
+	Detector_General_Log_Format(LOG_VERBOSITY_INTERMEDIATE,"Detector_Setup_Format_Switch(format_file=%s):Started.",
+				    format_filename);
+#endif
+	Detector_Latency_Timestamp(&start_time);
+	/* if the detector is not open, do a full startup */
+	if(!Setup_Data.Is_Open)
+	{
+		if(!Detector_Setup_Startup(format_filename))
+			return FALSE;
+		Detector_Latency_Stage_Record(DETECTOR_LATENCY_STAGE_FORMAT_SWITCH,&start_time);
+		return TRUE;
+	}
+	/* is the video mode already the right one? */
+	if(strcmp(format_filename,Setup_Data.Format_Filename) == 0)
+	{
+#if LOGGING > 1
+		Detector_General_Log(LOG_VERBOSITY_INTERMEDIATE,
+				     "Detector_Setup_Format_Switch:Finished (format already in use).");
+#endif
+		Detector_Latency_Stage_Record(DETECTOR_LATENCY_STAGE_FORMAT_SWITCH,&start_time);
+		return TRUE;
+	}
+	new_format = Setup_Format_Find(format_filename);
+	current_format = Setup_Format_Find(Setup_Data.Format_Filename);
+	if((Detector_Grabber_Backend_Get() == DETECTOR_GRABBER_BACKEND_XCLIB)&&
+	   (new_format != NULL)&&(current_format != NULL)&&(new_format->Length == current_format->Length)&&
+	   (memcmp(new_format->Contents,current_format->Contents,new_format->Length) == 0))
+	{
+		strcpy(Setup_Data.Format_Filename,new_format->Filename);
+#if LOGGING > 1
+		Detector_General_Log(LOG_VERBOSITY_INTERMEDIATE,
+				     "Detector_Setup_Format_Switch:Finished (format contents identical to the one in use).");
+#endif
+		Detector_Latency_Stage_Record(DETECTOR_LATENCY_STAGE_FORMAT_SWITCH,&start_time);
+		return TRUE;
+	}
+	if(strlen(format_filename) >= SETUP_FORMAT_FILENAME_LENGTH)
+	{
+		Setup_Error_Number = 19;
+		sprintf(Setup_Error_String,"Detector_Setup_Format_Switch:format_filename too long (%lu).",
+			strlen(format_filename));
+		return FALSE;
+	}
+	/* the format file turns the fan on, so get whether it is on now */
+	if(Detector_Serial_Command_Get_FPGA_Status(&fpga_status))
+		turn_fan_on = ((fpga_status & DETECTOR_SERIAL_FPGA_CTRL_FAN_ENABLED) > 0);
+	else
+	{
+		/* if getting the fpga status failed, log it and try and continue anyway. */
+		Detector_General_Error();
+		turn_fan_on = TRUE;
+	}
+	/* stop the telemetry sampler sending serial commands whilst the serial link is closed */
+	Detector_Telemetry_Pause();
+	/* re-open the frame grabber with the new video format */
+	if(!Detector_Setup_Close())
+	{
+		/* if the close failed, log it and try and continue anyway. */
+		Detector_General_Error();
+	}
+	Setup_Data.Is_Open = FALSE;
+	if(!Detector_Setup_Open("","",format_filename))
+	{
+		/* Setup_Error_Number / Setup_Error_String set in Detector_Setup_Open */
+		Detector_Telemetry_Resume();
+		return FALSE;
+	}
+	if(!Setup_Get_Dimensions(&(Setup_Data.Size_X),&(Setup_Data.Size_Y)))
+	{
+		/* Setup_Error_Number / Setup_Error_String set in Setup_Get_Dimensions */
+		Detector_Telemetry_Resume();
+		return FALSE;
+	}
+	/* only re-allocates the buffers if the dimensions have changed */
+	if(!Detector_Buffer_Allocate(Setup_Data.Size_X,Setup_Data.Size_Y))
+	{
+		Detector_Telemetry_Resume();
+		Setup_Error_Number = 20;
+		sprintf(Setup_Error_String,
+			"Detector_Setup_Format_Switch:Detector_Buffer_Allocate(size_x = %d,size_y = %d) failed.",
+			Setup_Data.Size_X,Setup_Data.Size_Y);
+		return FALSE;
+	}
+	/* re-open the serial link, without re-reading the camera head's EPROM */
+	if(!Detector_Serial_Reinitialise())
+	{
+		Detector_General_Error();
+		if(!Detector_Serial_Initialise())
+		{
+			Detector_Telemetry_Resume();
+			Setup_Error_Number = 21;
+			sprintf(Setup_Error_String,"Detector_Setup_Format_Switch:Detector_Serial_Initialise failed.");
+			return FALSE;
+		}
+	}
+	Setup_Data.Is_Open = TRUE;
+	strcpy(Setup_Data.Format_Filename,format_filename);
+	if(turn_fan_on == FALSE)
+	{
+		if(!Detector_Temperature_Set_Fan(turn_fan_on))
+		{
+			/* if reseting the fan failed, log it and try and continue anyway. */
+			Detector_General_Error();
+		}
+	}
+	Detector_Telemetry_Resume();
+	Detector_Latency_Stage_Record(DETECTOR_LATENCY_STAGE_FORMAT_SWITCH,&start_time);
+#if LOGGING > 1
+	Detector_General_Log(LOG_VERBOSITY_INTERMEDIATE,"Detector_Setup_Format_Switch:Finished.");
+#endif
+	return TRUE;
+}
+
+/**
+ * Routine to open a connection to the library/driver, using the xclib Detector_Grabber_Open routine.
  * @param driverparms A driver configuration parameter string.
  * @param formatname The video format as a string, We usually set this to a blank string and use the formatfile instead.
  * @param formatfile The filename of a '.fmt' format file, used to configure the video mode of the detector.
@@ -291,12 +634,12 @@ int Detector_Setup_Open(char *driverparms,char *formatname, char *formatfile)
 				    "Detector_Setup_Open(driverparms=%s,formatname=%s,formatfile=%s):Started.",
 				    driverparms,formatname,formatfile);
 #endif
-	retval = pxd_PIXCIopen(driverparms,formatname,formatfile);
+	retval = Detector_Grabber_Open(driverparms,formatname,formatfile);
 	if(retval < 0)
 	{
 		Setup_Error_Number = 1;
-		sprintf(Setup_Error_String,"Detector_Setup_Open:pxd_PIXCIopen(formatfile='%s') failed: %s (%d).",formatfile,
-			pxd_mesgErrorCode(retval),retval);
+		sprintf(Setup_Error_String,"Detector_Setup_Open:Detector_Grabber_Open(formatfile='%s') failed: %s (%d).",formatfile,
+			Detector_Grabber_Error_Code_String(retval),retval);
 		return FALSE;
 	}
 #if LOGGING > 1
@@ -306,11 +649,13 @@ int Detector_Setup_Open(char *driverparms,char *formatname, char *formatfile)
 }
 
 /**
- * Routine to close the previously opened connection to the library/driver, using the xclib pxd_PIXCIclose routine.
+ * Routine to close the previously opened connection to the library/driver, using the xclib Detector_Grabber_Close routine.
+ * The serial thread is stopped first, using Detector_Serial_Close.
  * @return The routine returns TRUE on success and FALSE on failure. 
  *         On failure, Setup_Error_Number/Setup_Error_String are set.
  * @see #Setup_Error_Number
  * @see #Setup_Error_String
+ * @see detector_serial.html#Detector_Serial_Close
  * @see detector_general.html#Detector_General_Log
  */
 int Detector_Setup_Close(void)
@@ -321,12 +666,19 @@ int Detector_Setup_Close(void)
 #if LOGGING > 1
 	Detector_General_Log(LOG_VERBOSITY_VERBOSE,"Detector_Setup_Close:Started.");
 #endif
-	retval = pxd_PIXCIclose();
+	/* stop the serial thread before the serial link goes away */
+	if(!Detector_Serial_Close())
+	{
+		Setup_Error_Number = 10;
+		sprintf(Setup_Error_String,"Detector_Setup_Close:Detector_Serial_Close failed.");
+		return FALSE;
+	}
+	retval = Detector_Grabber_Close();
 	if(retval < 0)
 	{
 		Setup_Error_Number = 2;
-		sprintf(Setup_Error_String,"Detector_Setup_Close:pxd_PIXCIclose failed: %s (%d).",
-			pxd_mesgErrorCode(retval),retval);
+		sprintf(Setup_Error_String,"Detector_Setup_Close:Detector_Grabber_Close failed: %s (%d).",
+			Detector_Grabber_Error_Code_String(retval),retval);
 		return FALSE;
 	}
 #if LOGGING > 1
@@ -430,7 +782,7 @@ void Detector_Setup_Error_String(char *error_string)
 ** ======================================= */
 /**
  * Get the frame grabber image dimensions from the frame grabber. A connection to the frame grabber must have 
- * previously been opened. pxd_imageXdim and pxd_imageYdim are used to retrieve the size of the image.
+ * previously been opened. Detector_Grabber_Image_X_Dim and Detector_Grabber_Image_Y_Dim are used to retrieve the size of the image.
  * @param x_size The address of an integer to store the returned x size of the image.
  * @param y_size The address of an integer to store the returned y size of the image.
  * @return The routine returns TRUE on success and FALSE on failure. 
@@ -456,14 +808,14 @@ static int Setup_Get_Dimensions(int *x_size,int *y_size)
 		sprintf(Setup_Error_String,"Setup_Get_Dimensions:y_size was NULL.");
 		return FALSE;
 	}
-	(*x_size) = pxd_imageXdim();
+	(*x_size) = Detector_Grabber_Image_X_Dim();
 	if((*x_size) == 0) /* library has not been opened */
 	{
 		Setup_Error_Number = 6;
 		sprintf(Setup_Error_String,"Setup_Get_Dimensions:x_size was 0:library not open.");
 		return FALSE;
 	}
-	(*y_size) = pxd_imageYdim();
+	(*y_size) = Detector_Grabber_Image_Y_Dim();
 	if((*y_size) == 0) /* library has not been opened */
 	{
 		Setup_Error_Number = 7;
@@ -477,3 +829,22 @@ static int Setup_Get_Dimensions(int *x_size,int *y_size)
 #endif
 	return TRUE;
 }
+
+/**
+ * Find a preloaded format file in Setup_Data.Format_List.
+ * @param format_filename The filename of the '.fmt' format file to find.
+ * @return The address of the preloaded format, or NULL if the format file has not been preloaded.
+ * @see #Setup_Data
+ * @see #Detector_Setup_Format_Preload
+ */
+static struct Setup_Format_Struct *Setup_Format_Find(char *format_filename)
+{
+	int i;
+
+	for(i = 0; i < Setup_Data.Format_Count; i++)
+	{
+		if(strcmp(Setup_Data.Format_List[i].Filename,format_filename) == 0)
+			return &(Setup_Data.Format_List[i]);
+	}
+	return NULL;
+}
@@ -0,0 +1,697 @@
+/* detector_telemetry.c
+** Raptor Ninox-640 Infrared detector library : background telemetry sampler routines.
+*/
+/**
+ * Routines to sample the camera head telemetry (sensor temperature, PCB temperature, TEC set-point and FPGA status)
+ * at a fixed rate from a background thread, into a time-stamped ring of samples. Each sample is several serial
+ * command round trips, so status queries read the latest sample (or a downsampled history) from the ring instead
+ * of talking to the camera head themselves, and so don't contend with an exposure in progress.
+ * @author Chris Mottram
+ * @version $Revision$
+ */
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "log_udp.h"
+#include "detector_general.h"
+#include "detector_serial.h"
+#include "detector_telemetry.h"
+#include "detector_temperature.h"
+#include "detector_trace.h"
+
+/* hash defines */
+/**
+ * A mask of all the DETECTOR_TELEMETRY_VALID_* bits, i.e. a sample where every read succeeded.
+ */
+#define TELEMETRY_VALID_ALL	(DETECTOR_TELEMETRY_VALID_SENSOR_TEMPERATURE|DETECTOR_TELEMETRY_VALID_PCB_TEMPERATURE| \
+				 DETECTOR_TELEMETRY_VALID_TEC_SETPOINT|DETECTOR_TELEMETRY_VALID_FPGA_STATUS)
+
+/* data types */
+/**
+ * Data type holding local data to detector_telemetry. This consists of the following:
+ * <dl>
+ * <dt>Mutex</dt> <dd>A mutex protecting the data below, as the ring is written by the sampler thread and read by
+ *     the status (command) threads.</dd>
+ * <dt>Condition</dt> <dd>A condition variable the sampler thread waits on between samples, signalled to stop it
+ *     or to request an immediate sample.</dd>
+ * <dt>Thread</dt> <dd>The sampler thread.</dd>
+ * <dt>Run</dt> <dd>A boolean, TRUE whilst the sampler thread should keep running.</dd>
+ * <dt>Sample_Requested</dt> <dd>A boolean, TRUE if a sample should be taken now rather than at the end of
+ *     the current period.</dd>
+ * <dt>Paused</dt> <dd>A boolean, TRUE whilst the sampler thread should not take samples 
+ *     (see Detector_Telemetry_Pause).</dd>
+ * <dt>Sampling</dt> <dd>A boolean, TRUE whilst the sampler thread is taking a sample (without the mutex held).</dd>
+ * <dt>Period_Ms</dt> <dd>The sampling period, in milliseconds.</dd>
+ * <dt>Ring</dt> <dd>An allocated ring of the most recent Ring_Length samples.</dd>
+ * <dt>Ring_Length</dt> <dd>The number of samples in Ring.</dd>
+ * <dt>Sample_Count</dt> <dd>The total number of samples taken. The next sample is written to
+ *     Ring[Sample_Count % Ring_Length].</dd>
+ * <dt>Failure_Count</dt> <dd>The number of samples where at least one of the serial reads failed.</dd>
+ * <dt>Sample_Callback</dt> <dd>A function the sampler thread calls with each new sample, or NULL.</dd>
+ * </dl>
+ * @see detector_telemetry.html#Detector_Telemetry_Sample_Struct
+ */
+struct Telemetry_Struct
+{
+	pthread_mutex_t Mutex;
+	pthread_cond_t Condition;
+	pthread_t Thread;
+	int Run;
+	int Sample_Requested;
+	int Paused;
+	int Sampling;
+	int Period_Ms;
+	struct Detector_Telemetry_Sample_Struct *Ring;
+	int Ring_Length;
+	unsigned int Sample_Count;
+	unsigned int Failure_Count;
+	void (*Sample_Callback)(struct Detector_Telemetry_Sample_Struct *sample);
+};
+
+/* internal data */
+/**
+ * Revision Control System identifier.
+ */
+static char rcsid[] = "$Id$";
+/**
+ * The instance of Telemetry_Struct that contains local data for this module. This is initialised as follows:
+ * <dl>
+ * <dt>Mutex</dt> <dd>PTHREAD_MUTEX_INITIALIZER</dd>
+ * <dt>Condition</dt> <dd>PTHREAD_COND_INITIALIZER</dd>
+ * <dt>Thread</dt> <dd>0</dd>
+ * <dt>Run</dt> <dd>FALSE</dd>
+ * <dt>Sample_Requested</dt> <dd>FALSE</dd>
+ * <dt>Paused</dt> <dd>FALSE</dd>
+ * <dt>Sampling</dt> <dd>FALSE</dd>
+ * <dt>Period_Ms</dt> <dd>0</dd>
+ * <dt>Ring</dt> <dd>NULL</dd>
+ * <dt>Ring_Length</dt> <dd>0</dd>
+ * <dt>Sample_Count</dt> <dd>0</dd>
+ * <dt>Failure_Count</dt> <dd>0</dd>
+ * <dt>Sample_Callback</dt> <dd>NULL</dd>
+ * </dl>
+ */
+static struct Telemetry_Struct Telemetry_Data =
+{
+	PTHREAD_MUTEX_INITIALIZER,PTHREAD_COND_INITIALIZER,0,FALSE,FALSE,FALSE,FALSE,0,NULL,0,0,0,NULL
+};
+/**
+ * Variable holding error code of last operation performed.
+ */
+static int Telemetry_Error_Number = 0;
+/**
+ * Local variable holding description of the last error that occured.
+ * @see detector_general.html#DETECTOR_GENERAL_ERROR_STRING_LENGTH
+ */
+static char Telemetry_Error_String[DETECTOR_GENERAL_ERROR_STRING_LENGTH] = "";
+
+/* internal functions */
+static void *Telemetry_Thread(void *user_arg);
+static void Telemetry_Sample_Take(struct Detector_Telemetry_Sample_Struct *sample);
+static void Telemetry_Point_Add(struct Detector_Telemetry_Sample_Struct *point,
+				struct Detector_Telemetry_Sample_Struct *sample);
+
+/* --------------------------------------------------------
+** External Functions
+** -------------------------------------------------------- */
+/**
+ * Start the telemetry sampler thread. The detector's serial interface must have been initialised first
+ * (Detector_Serial_Initialise), as the sampler reads the temperatures using the ADC/DAC calibration values.
+ * <ul>
+ * <li>We check the sampler isn't already running, and the parameters are sensible.
+ * <li>We allocate a ring long enough to hold history_length_s worth of samples at period_ms
+ *     (capped at DETECTOR_TELEMETRY_MAX_RING_LENGTH).
+ * <li>We set Run to TRUE and start the sampler thread, Telemetry_Thread.
+ * </ul>
+ * @param period_ms The sampling period, in milliseconds. This must be at least DETECTOR_TELEMETRY_MIN_PERIOD_MS.
+ * @param history_length_s How many seconds of samples to keep in the ring.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Telemetry_Data
+ * @see #Telemetry_Thread
+ * @see #DETECTOR_TELEMETRY_MIN_PERIOD_MS
+ * @see #DETECTOR_TELEMETRY_MAX_RING_LENGTH
+ */
+int Detector_Telemetry_Start(int period_ms,int history_length_s)
+{
+	long ring_length;
+	int retval;
+
+	Telemetry_Error_Number = 0;
+	if(period_ms < DETECTOR_TELEMETRY_MIN_PERIOD_MS)
+	{
+		Telemetry_Error_Number = 1;
+		sprintf(Telemetry_Error_String,"Detector_Telemetry_Start:Period %d ms too short (minimum %d ms).",
+			period_ms,DETECTOR_TELEMETRY_MIN_PERIOD_MS);
+		return FALSE;
+	}
+	if(history_length_s < 1)
+	{
+		Telemetry_Error_Number = 2;
+		sprintf(Telemetry_Error_String,"Detector_Telemetry_Start:Illegal history length %d s.",history_length_s);
+		return FALSE;
+	}
+	if(Telemetry_Data.Run)
+	{
+		Telemetry_Error_Number = 3;
+		sprintf(Telemetry_Error_String,"Detector_Telemetry_Start:Sampler already running.");
+		return FALSE;
+	}
+	ring_length = ((((long)history_length_s)*DETECTOR_GENERAL_ONE_SECOND_MS)/period_ms)+1;
+	if(ring_length > DETECTOR_TELEMETRY_MAX_RING_LENGTH)
+		ring_length = DETECTOR_TELEMETRY_MAX_RING_LENGTH;
+#if LOGGING > 1
+	Detector_General_Log_Format(LOG_VERBOSITY_TERSE,"Detector_Telemetry_Start:Sampling every %d ms, "
+				    "keeping %ld samples.",period_ms,ring_length);
+#endif
+	pthread_mutex_lock(&(Telemetry_Data.Mutex));
+	Telemetry_Data.Ring = (struct Detector_Telemetry_Sample_Struct *)malloc(ring_length*
+									sizeof(struct Detector_Telemetry_Sample_Struct));
+	if(Telemetry_Data.Ring == NULL)
+	{
+		pthread_mutex_unlock(&(Telemetry_Data.Mutex));
+		Telemetry_Error_Number = 4;
+		sprintf(Telemetry_Error_String,"Detector_Telemetry_Start:Failed to allocate ring of %ld samples.",
+			ring_length);
+		return FALSE;
+	}
+	Telemetry_Data.Ring_Length = ring_length;
+	Telemetry_Data.Period_Ms = period_ms;
+	Telemetry_Data.Sample_Count = 0;
+	Telemetry_Data.Failure_Count = 0;
+	Telemetry_Data.Sample_Requested = FALSE;
+	Telemetry_Data.Paused = FALSE;
+	Telemetry_Data.Run = TRUE;
+	retval = pthread_create(&(Telemetry_Data.Thread),NULL,Telemetry_Thread,NULL);
+	if(retval != 0)
+	{
+		Telemetry_Data.Run = FALSE;
+		free(Telemetry_Data.Ring);
+		Telemetry_Data.Ring = NULL;
+		Telemetry_Data.Ring_Length = 0;
+		pthread_mutex_unlock(&(Telemetry_Data.Mutex));
+		Telemetry_Error_Number = 5;
+		sprintf(Telemetry_Error_String,"Detector_Telemetry_Start:Failed to create sampler thread (%d).",retval);
+		return FALSE;
+	}
+	pthread_mutex_unlock(&(Telemetry_Data.Mutex));
+	return TRUE;
+}
+
+/**
+ * Stop the telemetry sampler thread. We set Run to FALSE, wake the thread, wait for it to exit, and free the ring.
+ * This routine does nothing if the sampler is not running.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Telemetry_Data
+ */
+int Detector_Telemetry_Stop(void)
+{
+	int retval;
+
+	Telemetry_Error_Number = 0;
+	pthread_mutex_lock(&(Telemetry_Data.Mutex));
+	if(!Telemetry_Data.Run)
+	{
+		pthread_mutex_unlock(&(Telemetry_Data.Mutex));
+		return TRUE;
+	}
+	Telemetry_Data.Run = FALSE;
+	pthread_cond_signal(&(Telemetry_Data.Condition));
+	pthread_mutex_unlock(&(Telemetry_Data.Mutex));
+	retval = pthread_join(Telemetry_Data.Thread,NULL);
+	if(retval != 0)
+	{
+		Telemetry_Error_Number = 6;
+		sprintf(Telemetry_Error_String,"Detector_Telemetry_Stop:Failed to join sampler thread (%d).",retval);
+		return FALSE;
+	}
+	pthread_mutex_lock(&(Telemetry_Data.Mutex));
+	if(Telemetry_Data.Ring != NULL)
+		free(Telemetry_Data.Ring);
+	Telemetry_Data.Ring = NULL;
+	Telemetry_Data.Ring_Length = 0;
+	Telemetry_Data.Sample_Count = 0;
+	pthread_mutex_unlock(&(Telemetry_Data.Mutex));
+#if LOGGING > 1
+	Detector_General_Log(LOG_VERBOSITY_TERSE,"Detector_Telemetry_Stop:Sampler stopped.");
+#endif
+	return TRUE;
+}
+
+/**
+ * Set a function for the sampler thread to call with each new sample (whether or not all the reads succeeded,
+ * see the sample's Valid_Mask). This lets the caller publish the sample without polling 
+ * Detector_Telemetry_Latest_Get. The function is called without the telemetry mutex held, and should return
+ * quickly. This should be called before Detector_Telemetry_Start.
+ * @param callback_fn The function to call, or NULL to stop calling a function.
+ * @see #Telemetry_Data
+ * @see #Telemetry_Thread
+ */
+void Detector_Telemetry_Sample_Callback_Set(void (*callback_fn)(struct Detector_Telemetry_Sample_Struct *sample))
+{
+	Telemetry_Data.Sample_Callback = callback_fn;
+}
+
+/**
+ * Return whether the telemetry sampler thread is running.
+ * @return TRUE if the sampler is running, FALSE if it is not.
+ * @see #Telemetry_Data
+ */
+int Detector_Telemetry_Is_Running(void)
+{
+	return Telemetry_Data.Run;
+}
+
+/**
+ * Pause the telemetry sampler, whilst the serial link to the camera head is unavailable (e.g. whilst the frame 
+ * grabber is re-opened with a different video format, see Detector_Setup_Format_Switch). The ring (history) is kept.
+ * <ul>
+ * <li>We set Paused to TRUE, and wake the sampler thread so it stops waiting for the next sample.
+ * <li>If the sampler thread is in the middle of taking a sample, we wait for it to finish.
+ * </ul>
+ * When this routine returns, the sampler will send no more serial commands until Detector_Telemetry_Resume is 
+ * called. This routine does nothing if the sampler is not running.
+ * @see #Telemetry_Data
+ * @see #Telemetry_Thread
+ * @see #Detector_Telemetry_Resume
+ */
+void Detector_Telemetry_Pause(void)
+{
+	pthread_mutex_lock(&(Telemetry_Data.Mutex));
+	if(!Telemetry_Data.Run)
+	{
+		pthread_mutex_unlock(&(Telemetry_Data.Mutex));
+		return;
+	}
+	Telemetry_Data.Paused = TRUE;
+	pthread_cond_broadcast(&(Telemetry_Data.Condition));
+	while(Telemetry_Data.Sampling)
+		pthread_cond_wait(&(Telemetry_Data.Condition),&(Telemetry_Data.Mutex));
+	pthread_mutex_unlock(&(Telemetry_Data.Mutex));
+#if LOGGING > 1
+	Detector_General_Log(LOG_VERBOSITY_INTERMEDIATE,"Detector_Telemetry_Pause:Sampler paused.");
+#endif
+}
+
+/**
+ * Resume the telemetry sampler after Detector_Telemetry_Pause. We set Paused to FALSE, and ask for a sample to 
+ * be taken straight away, as the camera head state may have changed whilst the sampler was paused.
+ * @see #Telemetry_Data
+ * @see #Detector_Telemetry_Pause
+ */
+void Detector_Telemetry_Resume(void)
+{
+	pthread_mutex_lock(&(Telemetry_Data.Mutex));
+	Telemetry_Data.Paused = FALSE;
+	Telemetry_Data.Sample_Requested = TRUE;
+	pthread_cond_broadcast(&(Telemetry_Data.Condition));
+	pthread_mutex_unlock(&(Telemetry_Data.Mutex));
+#if LOGGING > 1
+	Detector_General_Log(LOG_VERBOSITY_INTERMEDIATE,"Detector_Telemetry_Resume:Sampler resumed.");
+#endif
+}
+
+/**
+ * Ask the sampler thread to take a sample now, rather than at the end of the current period
+ * (e.g. after the TEC set-point has been changed). This routine does not wait for the sample to be taken.
+ * @see #Telemetry_Data
+ */
+void Detector_Telemetry_Sample_Request(void)
+{
+	pthread_mutex_lock(&(Telemetry_Data.Mutex));
+	Telemetry_Data.Sample_Requested = TRUE;
+	pthread_cond_signal(&(Telemetry_Data.Condition));
+	pthread_mutex_unlock(&(Telemetry_Data.Mutex));
+}
+
+/**
+ * Get the latest telemetry sample, without any serial I/O.
+ * @param sample The address of a sample structure, on return filled in with the latest sample. Check the
+ *        sample's Valid_Mask to see which fields were read successfully.
+ * @param age_s The address of a double, on return filled in with how long ago the sample was taken, in seconds.
+ *        Can be NULL.
+ * @return The routine returns TRUE on success, and FALSE if the sampler is not running or has not yet taken
+ *         a sample.
+ * @see #Telemetry_Data
+ * @see detector_general.html#fdifftime
+ */
+int Detector_Telemetry_Latest_Get(struct Detector_Telemetry_Sample_Struct *sample,double *age_s)
+{
+	struct timespec current_time;
+
+	Telemetry_Error_Number = 0;
+	if(sample == NULL)
+	{
+		Telemetry_Error_Number = 7;
+		sprintf(Telemetry_Error_String,"Detector_Telemetry_Latest_Get:sample was NULL.");
+		return FALSE;
+	}
+	pthread_mutex_lock(&(Telemetry_Data.Mutex));
+	if((!Telemetry_Data.Run)||(Telemetry_Data.Sample_Count == 0))
+	{
+		pthread_mutex_unlock(&(Telemetry_Data.Mutex));
+		Telemetry_Error_Number = 8;
+		sprintf(Telemetry_Error_String,"Detector_Telemetry_Latest_Get:No telemetry samples available.");
+		return FALSE;
+	}
+	(*sample) = Telemetry_Data.Ring[(Telemetry_Data.Sample_Count-1)%Telemetry_Data.Ring_Length];
+	pthread_mutex_unlock(&(Telemetry_Data.Mutex));
+	if(age_s != NULL)
+	{
+		clock_gettime(CLOCK_REALTIME,&current_time);
+		(*age_s) = fdifftime(current_time,sample->Timestamp);
+	}
+	return TRUE;
+}
+
+/**
+ * Get a downsampled time series of the telemetry over the last history_length_s seconds, without any serial I/O.
+ * The period is split into point_count equal time bins, and the samples in each bin combined into one point
+ * (see Detector_Telemetry_Sample_Struct). Bins without any samples (e.g. before the sampler was started, or older
+ * than the ring) are left out, so fewer than point_count points may be returned.
+ * @param history_length_s How many seconds of history to return.
+ * @param point_count How many time bins to split the history into, at most
+ *        DETECTOR_TELEMETRY_MAX_HISTORY_POINT_COUNT.
+ * @param point_list A list of at least point_count sample structures, on return filled in with the points,
+ *        oldest first.
+ * @param returned_point_count The address of an integer, on return filled in with the number of points
+ *        returned in point_list.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Telemetry_Data
+ * @see #Telemetry_Point_Add
+ * @see #DETECTOR_TELEMETRY_MAX_HISTORY_POINT_COUNT
+ * @see detector_general.html#fdifftime
+ */
+int Detector_Telemetry_History_Get(int history_length_s,int point_count,
+				   struct Detector_Telemetry_Sample_Struct *point_list,int *returned_point_count)
+{
+	struct Detector_Telemetry_Sample_Struct *sample = NULL;
+	struct Detector_Telemetry_Sample_Struct *point = NULL;
+	struct timespec current_time,start_time;
+	unsigned int sample_index,first_sample_index;
+	double bin_length_s,sample_offset_s,bin_middle_s;
+	int bin_index,last_bin_index,i;
+
+	Telemetry_Error_Number = 0;
+	if((point_list == NULL)||(returned_point_count == NULL))
+	{
+		Telemetry_Error_Number = 9;
+		sprintf(Telemetry_Error_String,"Detector_Telemetry_History_Get:NULL parameter (%p,%p).",
+			(void*)point_list,(void*)returned_point_count);
+		return FALSE;
+	}
+	if(history_length_s < 1)
+	{
+		Telemetry_Error_Number = 10;
+		sprintf(Telemetry_Error_String,"Detector_Telemetry_History_Get:Illegal history length %d s.",
+			history_length_s);
+		return FALSE;
+	}
+	if((point_count < 1)||(point_count > DETECTOR_TELEMETRY_MAX_HISTORY_POINT_COUNT))
+	{
+		Telemetry_Error_Number = 11;
+		sprintf(Telemetry_Error_String,"Detector_Telemetry_History_Get:Illegal point count %d (1..%d).",
+			point_count,DETECTOR_TELEMETRY_MAX_HISTORY_POINT_COUNT);
+		return FALSE;
+	}
+	(*returned_point_count) = 0;
+	bin_length_s = ((double)history_length_s)/((double)point_count);
+	clock_gettime(CLOCK_REALTIME,&current_time);
+	start_time = current_time;
+	start_time.tv_sec -= history_length_s;
+	pthread_mutex_lock(&(Telemetry_Data.Mutex));
+	if((!Telemetry_Data.Run)||(Telemetry_Data.Sample_Count == 0))
+	{
+		pthread_mutex_unlock(&(Telemetry_Data.Mutex));
+		Telemetry_Error_Number = 12;
+		sprintf(Telemetry_Error_String,"Detector_Telemetry_History_Get:No telemetry samples available.");
+		return FALSE;
+	}
+	if(Telemetry_Data.Sample_Count > Telemetry_Data.Ring_Length)
+		first_sample_index = Telemetry_Data.Sample_Count-Telemetry_Data.Ring_Length;
+	else
+		first_sample_index = 0;
+	last_bin_index = -1;
+	point = NULL;
+	for(sample_index = first_sample_index; sample_index < Telemetry_Data.Sample_Count; sample_index++)
+	{
+		sample = &(Telemetry_Data.Ring[sample_index%Telemetry_Data.Ring_Length]);
+		sample_offset_s = fdifftime(sample->Timestamp,start_time);
+		if(sample_offset_s < 0.0)
+			continue;
+		bin_index = (int)(sample_offset_s/bin_length_s);
+		if(bin_index >= point_count)
+			bin_index = point_count-1;
+		if(bin_index != last_bin_index)
+		{
+			/* start a new point */
+			point = &(point_list[(*returned_point_count)++]);
+			memset(point,0,sizeof(struct Detector_Telemetry_Sample_Struct));
+			bin_middle_s = (((double)bin_index)+0.5)*bin_length_s;
+			point->Timestamp.tv_sec = start_time.tv_sec+(time_t)bin_middle_s;
+			point->Timestamp.tv_nsec = start_time.tv_nsec+(long)((bin_middle_s-((double)((time_t)bin_middle_s)))*
+									   DETECTOR_GENERAL_ONE_SECOND_NS);
+			if(point->Timestamp.tv_nsec >= DETECTOR_GENERAL_ONE_SECOND_NS)
+			{
+				point->Timestamp.tv_sec++;
+				point->Timestamp.tv_nsec -= DETECTOR_GENERAL_ONE_SECOND_NS;
+			}
+			last_bin_index = bin_index;
+		}
+		Telemetry_Point_Add(point,sample);
+	}
+	pthread_mutex_unlock(&(Telemetry_Data.Mutex));
+	/* turn the sums into means */
+	for(i = 0; i < (*returned_point_count); i++)
+	{
+		point = &(point_list[i]);
+		if(point->Sample_Count > 0)
+		{
+			point->Sensor_Temperature_C /= (double)(point->Sample_Count);
+			point->PCB_Temperature_C /= (double)(point->Sample_Count);
+			point->TEC_Setpoint_C /= (double)(point->Sample_Count);
+		}
+	}
+	return TRUE;
+}
+
+/**
+ * Get the telemetry sampler's counters.
+ * @param period_ms The address of an integer, on return filled in with the sampling period in milliseconds.
+ *        Can be NULL.
+ * @param sample_count The address of an unsigned integer, on return filled in with the number of samples taken
+ *        since the sampler was started. Can be NULL.
+ * @param failure_count The address of an unsigned integer, on return filled in with the number of samples where
+ *        at least one serial read failed. Can be NULL.
+ * @see #Telemetry_Data
+ */
+void Detector_Telemetry_Statistics_Get(int *period_ms,unsigned int *sample_count,unsigned int *failure_count)
+{
+	pthread_mutex_lock(&(Telemetry_Data.Mutex));
+	if(period_ms != NULL)
+		(*period_ms) = Telemetry_Data.Period_Ms;
+	if(sample_count != NULL)
+		(*sample_count) = Telemetry_Data.Sample_Count;
+	if(failure_count != NULL)
+		(*failure_count) = Telemetry_Data.Failure_Count;
+	pthread_mutex_unlock(&(Telemetry_Data.Mutex));
+}
+
+/**
+ * Get the current error number.
+ * @return The current error number.
+ * @see #Telemetry_Error_Number
+ */
+int Detector_Telemetry_Get_Error_Number(void)
+{
+	return Telemetry_Error_Number;
+}
+
+/**
+ * The error routine that reports any errors occuring in a standard way.
+ * @see #Telemetry_Error_Number
+ * @see #Telemetry_Error_String
+ * @see detector_general.html#Detector_General_Get_Current_Time_String
+ */
+void Detector_Telemetry_Error(void)
+{
+	char time_string[32];
+
+	Detector_General_Get_Current_Time_String(time_string,32);
+	/* if the error number is zero an error message has not been set up
+	** This is in itself an error as we should not be calling this routine
+	** without there being an error to display */
+	if(Telemetry_Error_Number == 0)
+		sprintf(Telemetry_Error_String,"Logic Error:No Error defined");
+	fprintf(stderr,"%s Detector_Telemetry:Error(%d) : %s\n",time_string,Telemetry_Error_Number,
+		Telemetry_Error_String);
+}
+
+/**
+ * The error routine that reports any errors occuring in a standard way. This routine places the
+ * generated error string at the end of a passed in string argument.
+ * @param error_string A string to put the generated error in. This string should be initialised before
+ * being passed to this routine. The routine will try to concatenate it's error string onto the end
+ * of any string already in existance.
+ * @see #Telemetry_Error_Number
+ * @see #Telemetry_Error_String
+ * @see detector_general.html#Detector_General_Get_Current_Time_String
+ */
+void Detector_Telemetry_Error_String(char *error_string)
+{
+	char time_string[32];
+
+	Detector_General_Get_Current_Time_String(time_string,32);
+	/* if the error number is zero an error message has not been set up
+	** This is in itself an error as we should not be calling this routine
+	** without there being an error to display */
+	if(Telemetry_Error_Number == 0)
+		sprintf(Telemetry_Error_String,"Logic Error:No Error defined");
+	sprintf(error_string+strlen(error_string),"%s Detector_Telemetry:Error(%d) : %s\n",time_string,
+		Telemetry_Error_Number,Telemetry_Error_String);
+}
+
+/* =======================================
+**  internal functions
+** ======================================= */
+/**
+ * The telemetry sampler thread. Whilst Telemetry_Data.Run is TRUE:
+ * <ul>
+ * <li>If the sampler is paused, we wait on the condition variable until it is resumed or stopped.
+ * <li>We set Sampling, and take a sample using Telemetry_Sample_Take (without the mutex held, as it does serial I/O).
+ *     We then clear Sampling and wake any thread waiting in Detector_Telemetry_Pause.
+ * <li>We pass the sample to the Sample_Callback, if one has been set.
+ * <li>We add the sample to the ring, and count it as a failure if any of the reads failed.
+ * <li>We wait on the condition variable until the next sample is due, a sample is requested, or we are stopped
+ *     or paused.
+ * </ul>
+ * @param user_arg Unused.
+ * @return NULL.
+ * @see #Telemetry_Data
+ * @see #Telemetry_Sample_Take
+ * @see detector_trace.html#Detector_Trace_Thread_Name_Set
+ */
+static void *Telemetry_Thread(void *user_arg)
+{
+	struct Detector_Telemetry_Sample_Struct sample;
+	struct timespec wake_time;
+	int retval;
+
+	Detector_Trace_Thread_Name_Set("telemetry");
+	pthread_mutex_lock(&(Telemetry_Data.Mutex));
+	while(Telemetry_Data.Run)
+	{
+		if(Telemetry_Data.Paused)
+		{
+			pthread_cond_wait(&(Telemetry_Data.Condition),&(Telemetry_Data.Mutex));
+			continue;
+		}
+		Telemetry_Data.Sample_Requested = FALSE;
+		Telemetry_Data.Sampling = TRUE;
+		pthread_mutex_unlock(&(Telemetry_Data.Mutex));
+		Telemetry_Sample_Take(&sample);
+		if(Telemetry_Data.Sample_Callback != NULL)
+			(*(Telemetry_Data.Sample_Callback))(&sample);
+		pthread_mutex_lock(&(Telemetry_Data.Mutex));
+		Telemetry_Data.Sampling = FALSE;
+		pthread_cond_broadcast(&(Telemetry_Data.Condition));
+		Telemetry_Data.Ring[Telemetry_Data.Sample_Count%Telemetry_Data.Ring_Length] = sample;
+		Telemetry_Data.Sample_Count++;
+		if(sample.Valid_Mask != TELEMETRY_VALID_ALL)
+			Telemetry_Data.Failure_Count++;
+		/* wait until the next sample is due */
+		wake_time = sample.Timestamp;
+		wake_time.tv_sec += Telemetry_Data.Period_Ms/DETECTOR_GENERAL_ONE_SECOND_MS;
+		wake_time.tv_nsec += (Telemetry_Data.Period_Ms%DETECTOR_GENERAL_ONE_SECOND_MS)*
+			DETECTOR_GENERAL_ONE_MILLISECOND_NS;
+		if(wake_time.tv_nsec >= DETECTOR_GENERAL_ONE_SECOND_NS)
+		{
+			wake_time.tv_sec++;
+			wake_time.tv_nsec -= DETECTOR_GENERAL_ONE_SECOND_NS;
+		}
+		while(Telemetry_Data.Run && (!Telemetry_Data.Sample_Requested) && (!Telemetry_Data.Paused))
+		{
+			retval = pthread_cond_timedwait(&(Telemetry_Data.Condition),&(Telemetry_Data.Mutex),&wake_time);
+			if(retval == ETIMEDOUT)
+				break;
+		}
+	}
+	pthread_mutex_unlock(&(Telemetry_Data.Mutex));
+	return NULL;
+}
+
+/**
+ * Take one telemetry sample from the camera head. Each field is read independently, and its bit set in the
+ * sample's Valid_Mask if the read succeeded. The reads are sent as one serial sequence 
+ * (Detector_Serial_Sequence_Start), so the sample is not interleaved with another thread's sequence, such as the
+ * FPGA control byte read-modify-write in Detector_Temperature_Set_Fan.
+ * @param sample The address of a sample structure to fill in.
+ * @see detector_temperature.html#Detector_Temperature_Get
+ * @see detector_temperature.html#Detector_Temperature_PCB_Get
+ * @see detector_temperature.html#Detector_Temperature_Get_TEC_Setpoint
+ * @see detector_serial.html#Detector_Serial_Command_Get_FPGA_Status
+ * @see detector_serial.html#Detector_Serial_Sequence_Start
+ * @see detector_serial.html#Detector_Serial_Sequence_End
+ * @see detector_trace.html#Detector_Trace_Span_Start
+ * @see detector_trace.html#Detector_Trace_Span_End
+ */
+static void Telemetry_Sample_Take(struct Detector_Telemetry_Sample_Struct *sample)
+{
+	struct timespec trace_time;
+	unsigned char fpga_status;
+
+	Detector_Trace_Span_Start(&trace_time);
+	memset(sample,0,sizeof(struct Detector_Telemetry_Sample_Struct));
+	clock_gettime(CLOCK_REALTIME,&(sample->Timestamp));
+	sample->Sample_Count = 1;
+	Detector_Serial_Sequence_Start();
+	if(Detector_Temperature_Get(&(sample->Sensor_Temperature_C)))
+		sample->Valid_Mask |= DETECTOR_TELEMETRY_VALID_SENSOR_TEMPERATURE;
+	if(Detector_Temperature_PCB_Get(&(sample->PCB_Temperature_C)))
+		sample->Valid_Mask |= DETECTOR_TELEMETRY_VALID_PCB_TEMPERATURE;
+	if(Detector_Temperature_Get_TEC_Setpoint(&(sample->TEC_Setpoint_C)))
+		sample->Valid_Mask |= DETECTOR_TELEMETRY_VALID_TEC_SETPOINT;
+	if(Detector_Serial_Command_Get_FPGA_Status(&fpga_status))
+	{
+		sample->FPGA_Status = fpga_status;
+		sample->Valid_Mask |= DETECTOR_TELEMETRY_VALID_FPGA_STATUS;
+	}
+	Detector_Serial_Sequence_End();
+#if LOGGING > 5
+	Detector_General_Log_Format(LOG_VERBOSITY_VERY_VERBOSE,"Telemetry_Sample_Take:sensor %.2f C, pcb %.2f C, "
+				    "tec setpoint %.2f C, fpga status %#02x, valid mask %#x.",
+				    sample->Sensor_Temperature_C,sample->PCB_Temperature_C,sample->TEC_Setpoint_C,
+				    sample->FPGA_Status,sample->Valid_Mask);
+#endif
+	Detector_Trace_Span_End("telemetry","sample",NULL,&trace_time);
+}
+
+/**
+ * Add a sample to a downsampled history point. The valid temperatures are summed (and turned into means
+ * by the caller), and the point's FPGA status is that of the latest sample it contains with a valid FPGA status.
+ * The point's Valid_Mask is the union of its samples' masks. The temperature sums only include valid samples,
+ * so Sample_Count is only incremented for samples with every temperature valid; other samples contribute
+ * their FPGA status only.
+ * @param point The point to add the sample to.
+ * @param sample The sample.
+ * @see #TELEMETRY_VALID_ALL
+ */
+static void Telemetry_Point_Add(struct Detector_Telemetry_Sample_Struct *point,
+				struct Detector_Telemetry_Sample_Struct *sample)
+{
+	if(sample->Valid_Mask & DETECTOR_TELEMETRY_VALID_FPGA_STATUS)
+		point->FPGA_Status = sample->FPGA_Status;
+	if((sample->Valid_Mask|DETECTOR_TELEMETRY_VALID_FPGA_STATUS) != TELEMETRY_VALID_ALL)
+	{
+		point->Valid_Mask |= (sample->Valid_Mask & DETECTOR_TELEMETRY_VALID_FPGA_STATUS);
+		return;
+	}
+	point->Valid_Mask |= sample->Valid_Mask;
+	point->Sensor_Temperature_C += sample->Sensor_Temperature_C;
+	point->PCB_Temperature_C += sample->PCB_Temperature_C;
+	point->TEC_Setpoint_C += sample->TEC_Setpoint_C;
+	point->Sample_Count++;
+}
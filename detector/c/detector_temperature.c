@@ -17,7 +17,6 @@
 #include "detector_general.h"
 #include "detector_serial.h"
 #include "detector_temperature.h"
-#include "xcliball.h"
 
 /* hash defines */
 /* data types */
@@ -149,7 +148,9 @@ int Detector_Temperature_Initialise(int adc_zeroC,int adc_fortyC,int dac_zeroC,i
 }
 
 /**
- * Routine to turn the Raptor Ninox 640 fan on or off. 
+ * Routine to turn the Raptor Ninox 640 fan on or off. This reads, modifies and writes the FPGA control byte
+ * as one serial sequence (Detector_Serial_Sequence_Start), so another thread's serial commands (e.g. the telemetry
+ * sampler's, or Detector_Temperature_Set_TEC's) are not sent in between the read and the write.
  * @param onoff A boolean, TRUE to turn the fan on, and FALSE to turn it off.
  * @return The routine returns TRUE on success and FALSE on failure. 
  *         On failure, Temperature_Error_Number/Temperature_Error_String are set.
@@ -158,6 +159,8 @@ int Detector_Temperature_Initialise(int adc_zeroC,int adc_fortyC,int dac_zeroC,i
  * @see detector_serial.html##DETECTOR_SERIAL_FPGA_CTRL_FAN_ENABLED
  * @see detector_serial.html#Detector_Serial_Command_Get_FPGA_Status
  * @see detector_serial.html#Detector_Serial_Command_Set_FPGA_Control
+ * @see detector_serial.html#Detector_Serial_Sequence_Start
+ * @see detector_serial.html#Detector_Serial_Sequence_End
  */
 int Detector_Temperature_Set_Fan(int onoff)
 {
@@ -173,9 +176,11 @@ int Detector_Temperature_Set_Fan(int onoff)
 		sprintf(Temperature_Error_String,"Detector_Temperature_Set_Fan:onoff was not a boolean (%d).",onoff);
 		return FALSE;
 	}
+	Detector_Serial_Sequence_Start();
 	/* get current FPGA crtl (status) byte */
 	if(!Detector_Serial_Command_Get_FPGA_Status(&ctrl_byte))
 	{
+		Detector_Serial_Sequence_End();
 		Temperature_Error_Number = 5;
 		sprintf(Temperature_Error_String,
 			"Detector_Temperature_Set_Fan:Detector_Serial_Command_Get_FPGA_Status failed.");
@@ -193,11 +198,13 @@ int Detector_Temperature_Set_Fan(int onoff)
 	/* write new FPGA crtl byte */
 	if(!Detector_Serial_Command_Set_FPGA_Control(ctrl_byte))
 	{
+		Detector_Serial_Sequence_End();
 		Temperature_Error_Number = 6;
 		sprintf(Temperature_Error_String,
 			"Detector_Temperature_Set_Fan:Detector_Serial_Command_Set_FPGA_Control failed.");
 		return FALSE;
 	}
+	Detector_Serial_Sequence_End();
 #if LOGGING > 1
 	Detector_General_Log(LOG_VERBOSITY_INTERMEDIATE,"Detector_Temperature_Set_Fan:Finished.");
 #endif
@@ -205,7 +212,8 @@ int Detector_Temperature_Set_Fan(int onoff)
 }
 
 /**
- * Routine to turn the Raptor Ninox 640 TEC (thermo electric cooler) on or off. 
+ * Routine to turn the Raptor Ninox 640 TEC (thermo electric cooler) on or off. This reads, modifies and writes
+ * the FPGA control byte as one serial sequence, as Detector_Temperature_Set_Fan does.
  * @param onoff A boolean, TRUE to turn the TEC on, and FALSE to turn it off.
  * @return The routine returns TRUE on success and FALSE on failure. 
  *         On failure, Temperature_Error_Number/Temperature_Error_String are set.
@@ -214,6 +222,8 @@ int Detector_Temperature_Set_Fan(int onoff)
  * @see detector_serial.html##DETECTOR_SERIAL_FPGA_CTRL_TEC_ENABLED
  * @see detector_serial.html#Detector_Serial_Command_Get_FPGA_Status
  * @see detector_serial.html#Detector_Serial_Command_Set_FPGA_Control
+ * @see detector_serial.html#Detector_Serial_Sequence_Start
+ * @see detector_serial.html#Detector_Serial_Sequence_End
  */
 int Detector_Temperature_Set_TEC(int onoff)
 {
@@ -229,9 +239,11 @@ int Detector_Temperature_Set_TEC(int onoff)
 		sprintf(Temperature_Error_String,"Detector_Temperature_Set_TEC:onoff was not a boolean (%d).",onoff);
 		return FALSE;
 	}
+	Detector_Serial_Sequence_Start();
 	/* get current FPGA crtl (status) byte */
 	if(!Detector_Serial_Command_Get_FPGA_Status(&ctrl_byte))
 	{
+		Detector_Serial_Sequence_End();
 		Temperature_Error_Number = 8;
 		sprintf(Temperature_Error_String,
 			"Detector_Temperature_Set_FTEC:Detector_Serial_Command_Get_FPGA_Status failed.");
@@ -249,11 +261,13 @@ int Detector_Temperature_Set_TEC(int onoff)
 	/* write new FPGA crtl byte */
 	if(!Detector_Serial_Command_Set_FPGA_Control(ctrl_byte))
 	{
+		Detector_Serial_Sequence_End();
 		Temperature_Error_Number = 9;
 		sprintf(Temperature_Error_String,
 			"Detector_Temperature_Set_Tec:Detector_Serial_Command_Set_FPGA_Control failed.");
 		return FALSE;
 	}
+	Detector_Serial_Sequence_End();
 #if LOGGING > 1
 	Detector_General_Log(LOG_VERBOSITY_INTERMEDIATE,"Detector_Temperature_Set_TEC:Finished.");
 #endif
@@ -0,0 +1,644 @@
+/* detector_trace.c
+** Raptor Ninox-640 Infrared detector library : span event tracing routines.
+*/
+/**
+ * Routines to record span events (command, multrun, exposure, coadd, save, mechanism move, serial command)
+ * into per-thread trace buffers, and dump them as Chrome trace event JSON (loadable by chrome://tracing or
+ * Perfetto), so the time spent by each thread of the instrument can be viewed on a timeline.
+ * Each thread writes to its own ring of events, so recording an event takes no locks. When tracing is disabled
+ * starting and ending a span is a single flag test.
+ * @author Chris Mottram
+ * @version $Revision$
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "log_udp.h"
+#include "detector_general.h"
+#include "detector_trace.h"
+
+/* data types */
+/**
+ * Data type holding one span event.
+ * <dl>
+ * <dt>Category</dt> <dd>The category of the span (e.g. "command", "exposure", "mechanism"). This must be a
+ *     string constant, as only the pointer is kept.</dd>
+ * <dt>Name</dt> <dd>The name of the span (e.g. "multrun", "coadd", "save"). This must be a string constant,
+ *     as only the pointer is kept.</dd>
+ * <dt>Detail</dt> <dd>An optional short detail string, copied into the event.</dd>
+ * <dt>Start_Time</dt> <dd>The CLOCK_MONOTONIC time the span started.</dd>
+ * <dt>End_Time</dt> <dd>The CLOCK_MONOTONIC time the span ended.</dd>
+ * <dt>Thread_Id</dt> <dd>The trace thread id of the thread that recorded the span.</dd>
+ * </dl>
+ * @see #DETECTOR_TRACE_DETAIL_LENGTH
+ */
+struct Trace_Event_Struct
+{
+	char *Category;
+	char *Name;
+	char Detail[DETECTOR_TRACE_DETAIL_LENGTH];
+	struct timespec Start_Time;
+	struct timespec End_Time;
+	int Thread_Id;
+};
+
+/**
+ * Data type holding one thread's ring of span events. Only the owning thread writes into the ring.
+ * <dl>
+ * <dt>Write_Index</dt> <dd>The total number of events written into the buffer. The next event is written to
+ *     Event_List[Write_Index % DETECTOR_TRACE_RING_LENGTH].</dd>
+ * <dt>Event_List</dt> <dd>The ring of events.</dd>
+ * </dl>
+ * @see #Trace_Event_Struct
+ * @see #DETECTOR_TRACE_RING_LENGTH
+ */
+struct Trace_Buffer_Struct
+{
+	volatile unsigned int Write_Index;
+	struct Trace_Event_Struct Event_List[DETECTOR_TRACE_RING_LENGTH];
+};
+
+/**
+ * Data type holding a thread name to put into the trace dump.
+ * <dl>
+ * <dt>Thread_Id</dt> <dd>The trace thread id of the named thread, or 0 if this entry is not used.</dd>
+ * <dt>Name</dt> <dd>The name of the thread.</dd>
+ * </dl>
+ * @see #DETECTOR_TRACE_THREAD_NAME_LENGTH
+ */
+struct Trace_Thread_Name_Struct
+{
+	int Thread_Id;
+	char Name[DETECTOR_TRACE_THREAD_NAME_LENGTH];
+};
+
+/**
+ * Data type holding local data to detector_trace. This consists of the following:
+ * <dl>
+ * <dt>Enabled</dt> <dd>A boolean, whether span events are being recorded.</dd>
+ * <dt>Next_Thread_Id</dt> <dd>The last trace thread id handed out to a thread.</dd>
+ * <dt>Dropped_Count</dt> <dd>The number of span events dropped as all the trace buffers were in use.</dd>
+ * <dt>Clear_Time</dt> <dd>The CLOCK_MONOTONIC time of the last Detector_Trace_Clear. Events starting before this
+ *     time are not dumped.</dd>
+ * <dt>Buffer_In_Use</dt> <dd>For each trace buffer, whether it is owned by a running thread.</dd>
+ * <dt>Buffer_List</dt> <dd>The trace buffers, allocated when first claimed by a thread.</dd>
+ * <dt>Key_Once</dt> <dd>pthread_once control, used to create Buffer_Key.</dd>
+ * <dt>Buffer_Key</dt> <dd>A thread specific data key, whose destructor releases a thread's trace buffer when the
+ *     thread exits.</dd>
+ * <dt>Name_Mutex</dt> <dd>A mutex protecting the thread name list.</dd>
+ * <dt>Name_Count</dt> <dd>The total number of thread names set. The next name is written to
+ *     Name_List[Name_Count % DETECTOR_TRACE_MAX_THREAD_NAME_COUNT].</dd>
+ * <dt>Name_List</dt> <dd>The list of thread names.</dd>
+ * </dl>
+ * @see #Trace_Buffer_Struct
+ * @see #Trace_Thread_Name_Struct
+ * @see #DETECTOR_TRACE_MAX_BUFFER_COUNT
+ * @see #DETECTOR_TRACE_MAX_THREAD_NAME_COUNT
+ */
+struct Trace_Struct
+{
+	volatile int Enabled;
+	int Next_Thread_Id;
+	unsigned int Dropped_Count;
+	struct timespec Clear_Time;
+	int Buffer_In_Use[DETECTOR_TRACE_MAX_BUFFER_COUNT];
+	struct Trace_Buffer_Struct *Buffer_List[DETECTOR_TRACE_MAX_BUFFER_COUNT];
+	pthread_once_t Key_Once;
+	pthread_key_t Buffer_Key;
+	pthread_mutex_t Name_Mutex;
+	unsigned int Name_Count;
+	struct Trace_Thread_Name_Struct Name_List[DETECTOR_TRACE_MAX_THREAD_NAME_COUNT];
+};
+
+/* internal data */
+/**
+ * Revision Control System identifier.
+ */
+static char rcsid[] = "$Id$";
+/**
+ * The instance of Trace_Struct that contains local data for this module. This is initialised as follows:
+ * <dl>
+ * <dt>Enabled</dt> <dd>FALSE</dd>
+ * <dt>Next_Thread_Id</dt> <dd>0</dd>
+ * <dt>Dropped_Count</dt> <dd>0</dd>
+ * <dt>Clear_Time</dt> <dd>{0,0}</dd>
+ * <dt>Buffer_In_Use</dt> <dd>{FALSE,...}</dd>
+ * <dt>Buffer_List</dt> <dd>{NULL,...}</dd>
+ * <dt>Key_Once</dt> <dd>PTHREAD_ONCE_INIT</dd>
+ * <dt>Buffer_Key</dt> <dd>0</dd>
+ * <dt>Name_Mutex</dt> <dd>PTHREAD_MUTEX_INITIALIZER</dd>
+ * <dt>Name_Count</dt> <dd>0</dd>
+ * <dt>Name_List</dt> <dd>{{0,""},...}</dd>
+ * </dl>
+ */
+static struct Trace_Struct Trace_Data =
+{
+	FALSE,0,0,{0,0},{FALSE},{NULL},PTHREAD_ONCE_INIT,0,PTHREAD_MUTEX_INITIALIZER,0,{{0,""}}
+};
+/**
+ * The index (plus one) in Trace_Data.Buffer_List of the trace buffer owned by this thread, or 0 if this
+ * thread does not own a trace buffer.
+ */
+static __thread int Trace_Thread_Buffer_Index = 0;
+/**
+ * The trace thread id of this thread, or 0 if one has not been assigned yet.
+ */
+static __thread int Trace_Thread_Id = 0;
+/**
+ * Variable holding error code of last operation performed.
+ */
+static int Trace_Error_Number = 0;
+/**
+ * Local variable holding description of the last error that occured.
+ * @see detector_general.html#DETECTOR_GENERAL_ERROR_STRING_LENGTH
+ */
+static char Trace_Error_String[DETECTOR_GENERAL_ERROR_STRING_LENGTH] = "";
+
+/* internal functions */
+static int Trace_Thread_Id_Get(void);
+static struct Trace_Buffer_Struct *Trace_Thread_Buffer_Get(void);
+static void Trace_Key_Create(void);
+static void Trace_Thread_Exit(void *key_value);
+static double Trace_Timespec_To_Us(struct timespec time);
+static void Trace_Json_String_Write(FILE *fp,char *string);
+
+/* --------------------------------------------------------
+** External Functions
+** -------------------------------------------------------- */
+/**
+ * Set whether span events are recorded.
+ * @param enable A boolean, TRUE to record span events, FALSE not to.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ *         On failure, Trace_Error_Number/Trace_Error_String are set.
+ * @see #Trace_Data
+ * @see detector_general.html#DETECTOR_IS_BOOLEAN
+ */
+int Detector_Trace_Enable_Set(int enable)
+{
+	Trace_Error_Number = 0;
+	if(!DETECTOR_IS_BOOLEAN(enable))
+	{
+		Trace_Error_Number = 1;
+		sprintf(Trace_Error_String,"Detector_Trace_Enable_Set:Illegal enable %d.",enable);
+		return FALSE;
+	}
+	Trace_Data.Enabled = enable;
+#if LOGGING > 1
+	Detector_General_Log_Format(LOG_VERBOSITY_INTERMEDIATE,"Detector_Trace_Enable_Set:Tracing %s.",
+				    enable ? "enabled" : "disabled");
+#endif
+	return TRUE;
+}
+
+/**
+ * Get whether span events are being recorded.
+ * @return A boolean, TRUE if span events are being recorded, FALSE if they are not.
+ * @see #Trace_Data
+ */
+int Detector_Trace_Enable_Get(void)
+{
+	return Trace_Data.Enabled;
+}
+
+/**
+ * Start timing a span. If tracing is disabled, start_time is marked as invalid (tv_nsec is set to -1) and
+ * no timestamp is taken, so the matching Detector_Trace_Span_End does nothing.
+ * @param start_time The address of a timespec to fill in with the current CLOCK_MONOTONIC time.
+ * @see #Trace_Data
+ * @see #Detector_Trace_Span_End
+ */
+void Detector_Trace_Span_Start(struct timespec *start_time)
+{
+	if(!Trace_Data.Enabled)
+	{
+		start_time->tv_sec = 0;
+		start_time->tv_nsec = -1;
+		return;
+	}
+	clock_gettime(CLOCK_MONOTONIC,start_time);
+}
+
+/**
+ * End a span started by Detector_Trace_Span_Start, and record it in this thread's trace buffer.
+ * <ul>
+ * <li>If tracing is disabled, or start_time was taken whilst tracing was disabled, we return.
+ * <li>We get this thread's trace buffer using Trace_Thread_Buffer_Get. If all the buffers are in use,
+ *     we increment Trace_Data.Dropped_Count and return.
+ * <li>We fill in the next event in the buffer's ring with the category, name, detail, thread id, start time
+ *     and a CLOCK_MONOTONIC end time.
+ * <li>We issue a memory barrier, and then increment the buffer's Write_Index, so that a thread dumping the
+ *     buffer never sees a partially written event.
+ * </ul>
+ * @param category The category of the span, e.g. "exposure". This must be a string constant.
+ * @param name The name of the span, e.g. "coadd". This must be a string constant.
+ * @param detail An optional detail string (truncated to DETECTOR_TRACE_DETAIL_LENGTH-1 characters), or NULL.
+ * @param start_time The address of the timespec filled in by Detector_Trace_Span_Start.
+ * @see #Trace_Data
+ * @see #Trace_Thread_Buffer_Get
+ * @see #Trace_Thread_Id_Get
+ * @see #Detector_Trace_Span_Start
+ * @see #DETECTOR_TRACE_RING_LENGTH
+ * @see #DETECTOR_TRACE_DETAIL_LENGTH
+ */
+void Detector_Trace_Span_End(char *category,char *name,char *detail,struct timespec *start_time)
+{
+	struct Trace_Buffer_Struct *buffer = NULL;
+	struct Trace_Event_Struct *event = NULL;
+	unsigned int write_index;
+
+	if(!Trace_Data.Enabled)
+		return;
+	if(start_time->tv_nsec < 0)
+		return;
+	buffer = Trace_Thread_Buffer_Get();
+	if(buffer == NULL)
+	{
+		__sync_fetch_and_add(&(Trace_Data.Dropped_Count),1);
+		return;
+	}
+	write_index = buffer->Write_Index;
+	event = &(buffer->Event_List[write_index % DETECTOR_TRACE_RING_LENGTH]);
+	event->Category = category;
+	event->Name = name;
+	if(detail != NULL)
+	{
+		strncpy(event->Detail,detail,DETECTOR_TRACE_DETAIL_LENGTH-1);
+		event->Detail[DETECTOR_TRACE_DETAIL_LENGTH-1] = '\0';
+	}
+	else
+		event->Detail[0] = '\0';
+	event->Thread_Id = Trace_Thread_Id_Get();
+	event->Start_Time = (*start_time);
+	clock_gettime(CLOCK_MONOTONIC,&(event->End_Time));
+	/* make sure the event is written before the index is published */
+	__sync_synchronize();
+	buffer->Write_Index = write_index+1;
+}
+
+/**
+ * Name the calling thread in the trace dump (e.g. "main", "command", "buffer_worker").
+ * Names are only remembered whilst tracing is enabled.
+ * @param name The name of the thread.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ *         On failure, Trace_Error_Number/Trace_Error_String are set.
+ * @see #Trace_Data
+ * @see #Trace_Thread_Id_Get
+ * @see #DETECTOR_TRACE_MAX_THREAD_NAME_COUNT
+ * @see #DETECTOR_TRACE_THREAD_NAME_LENGTH
+ */
+int Detector_Trace_Thread_Name_Set(char *name)
+{
+	struct Trace_Thread_Name_Struct *thread_name = NULL;
+
+	Trace_Error_Number = 0;
+	if(name == NULL)
+	{
+		Trace_Error_Number = 2;
+		sprintf(Trace_Error_String,"Detector_Trace_Thread_Name_Set:name was NULL.");
+		return FALSE;
+	}
+	if(!Trace_Data.Enabled)
+		return TRUE;
+	pthread_mutex_lock(&(Trace_Data.Name_Mutex));
+	thread_name = &(Trace_Data.Name_List[Trace_Data.Name_Count % DETECTOR_TRACE_MAX_THREAD_NAME_COUNT]);
+	thread_name->Thread_Id = Trace_Thread_Id_Get();
+	strncpy(thread_name->Name,name,DETECTOR_TRACE_THREAD_NAME_LENGTH-1);
+	thread_name->Name[DETECTOR_TRACE_THREAD_NAME_LENGTH-1] = '\0';
+	Trace_Data.Name_Count++;
+	pthread_mutex_unlock(&(Trace_Data.Name_Mutex));
+	return TRUE;
+}
+
+/**
+ * Discard the span events recorded so far. Rather than resetting the buffers (which are written without locks
+ * by their owning threads), we record the time of the clear, and Detector_Trace_Dump ignores events that started
+ * before it. The dropped event count is also reset.
+ * @see #Trace_Data
+ * @see #Detector_Trace_Dump
+ */
+void Detector_Trace_Clear(void)
+{
+	clock_gettime(CLOCK_MONOTONIC,&(Trace_Data.Clear_Time));
+	Trace_Data.Dropped_Count = 0;
+}
+
+/**
+ * Dump the recorded span events to a file, in Chrome trace event JSON format.
+ * <ul>
+ * <li>We open the file for writing.
+ * <li>We write a "thread_name" metadata event for each remembered thread name.
+ * <li>For each allocated trace buffer, we read the buffer's Write_Index, and write a complete ("X") event
+ *     for each event still in the ring that started after the last Detector_Trace_Clear.
+ *     Each event is copied out of the ring before being written, and discarded if the Write_Index shows
+ *     the owning thread may have overwritten it whilst it was being copied.
+ * <li>We write the number of dropped events into the "otherData" section, and close the file.
+ * </ul>
+ * Timestamps are in microseconds of CLOCK_MONOTONIC time.
+ * @param filename The filename to write the trace into.
+ * @param event_count The address of an integer, on return filled in with the number of span events dumped.
+ *        This can be NULL.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ *         On failure, Trace_Error_Number/Trace_Error_String are set.
+ * @see #Trace_Data
+ * @see #Trace_Timespec_To_Us
+ * @see #Trace_Json_String_Write
+ * @see #Detector_Trace_Clear
+ */
+int Detector_Trace_Dump(char *filename,int *event_count)
+{
+	struct Trace_Thread_Name_Struct thread_name;
+	struct Trace_Event_Struct event;
+	struct Trace_Buffer_Struct *buffer = NULL;
+	FILE *fp = NULL;
+	unsigned int write_index,first_index,index,name_index,name_count;
+	int i,count,pid,first_event;
+
+	Trace_Error_Number = 0;
+	if(filename == NULL)
+	{
+		Trace_Error_Number = 3;
+		sprintf(Trace_Error_String,"Detector_Trace_Dump:filename was NULL.");
+		return FALSE;
+	}
+#if LOGGING > 1
+	Detector_General_Log_Format(LOG_VERBOSITY_INTERMEDIATE,"Detector_Trace_Dump:Dumping trace to '%s'.",filename);
+#endif
+	fp = fopen(filename,"w");
+	if(fp == NULL)
+	{
+		Trace_Error_Number = 4;
+		sprintf(Trace_Error_String,"Detector_Trace_Dump:Failed to open '%s' for writing.",filename);
+		return FALSE;
+	}
+	pid = (int)getpid();
+	count = 0;
+	first_event = TRUE;
+	fprintf(fp,"{\"traceEvents\":[\n");
+	/* thread name metadata */
+	pthread_mutex_lock(&(Trace_Data.Name_Mutex));
+	name_count = Trace_Data.Name_Count;
+	if(name_count > DETECTOR_TRACE_MAX_THREAD_NAME_COUNT)
+		name_index = name_count-DETECTOR_TRACE_MAX_THREAD_NAME_COUNT;
+	else
+		name_index = 0;
+	for(; name_index < name_count; name_index++)
+	{
+		thread_name = Trace_Data.Name_List[name_index % DETECTOR_TRACE_MAX_THREAD_NAME_COUNT];
+		if(!first_event)
+			fprintf(fp,",\n");
+		first_event = FALSE;
+		fprintf(fp,"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":",pid,
+			thread_name.Thread_Id);
+		Trace_Json_String_Write(fp,thread_name.Name);
+		fprintf(fp,"}}");
+	}
+	pthread_mutex_unlock(&(Trace_Data.Name_Mutex));
+	/* span events */
+	for(i = 0; i < DETECTOR_TRACE_MAX_BUFFER_COUNT; i++)
+	{
+		buffer = Trace_Data.Buffer_List[i];
+		if(buffer == NULL)
+			continue;
+		write_index = buffer->Write_Index;
+		__sync_synchronize();
+		if(write_index > DETECTOR_TRACE_RING_LENGTH)
+			first_index = write_index-DETECTOR_TRACE_RING_LENGTH;
+		else
+			first_index = 0;
+		for(index = first_index; index < write_index; index++)
+		{
+			event = buffer->Event_List[index % DETECTOR_TRACE_RING_LENGTH];
+			__sync_synchronize();
+			/* discard the event if the owning thread may have started overwriting it whilst we copied it */
+			if((buffer->Write_Index-index) >= DETECTOR_TRACE_RING_LENGTH)
+				continue;
+			if(fdifftime(event.Start_Time,Trace_Data.Clear_Time) < 0.0)
+				continue;
+			if(!first_event)
+				fprintf(fp,",\n");
+			first_event = FALSE;
+			fprintf(fp,"{\"name\":");
+			Trace_Json_String_Write(fp,event.Name);
+			fprintf(fp,",\"cat\":");
+			Trace_Json_String_Write(fp,event.Category);
+			fprintf(fp,",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d",
+				Trace_Timespec_To_Us(event.Start_Time),
+				Trace_Timespec_To_Us(event.End_Time)-Trace_Timespec_To_Us(event.Start_Time),
+				pid,event.Thread_Id);
+			if(strlen(event.Detail) > 0)
+			{
+				fprintf(fp,",\"args\":{\"detail\":");
+				Trace_Json_String_Write(fp,event.Detail);
+				fprintf(fp,"}");
+			}
+			fprintf(fp,"}");
+			count++;
+		}
+	}
+	fprintf(fp,"\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped_events\":%u}}\n",Trace_Data.Dropped_Count);
+	if(fclose(fp) != 0)
+	{
+		Trace_Error_Number = 5;
+		sprintf(Trace_Error_String,"Detector_Trace_Dump:Failed to close '%s'.",filename);
+		return FALSE;
+	}
+	if(event_count != NULL)
+		(*event_count) = count;
+#if LOGGING > 1
+	Detector_General_Log_Format(LOG_VERBOSITY_INTERMEDIATE,"Detector_Trace_Dump:Dumped %d events to '%s'.",
+				    count,filename);
+#endif
+	return TRUE;
+}
+
+/**
+ * Get the current value of the error number.
+ * @return The current value of the error number.
+ * @see #Trace_Error_Number
+ */
+int Detector_Trace_Get_Error_Number(void)
+{
+	return Trace_Error_Number;
+}
+
+/**
+ * The error routine that reports any errors occuring in a standard way.
+ * @see #Trace_Error_Number
+ * @see #Trace_Error_String
+ * @see detector_general.html#Detector_General_Get_Current_Time_String
+ */
+void Detector_Trace_Error(void)
+{
+	char time_string[32];
+
+	Detector_General_Get_Current_Time_String(time_string,32);
+	/* if the error number is zero an error message has not been set up
+	** This is in itself an error as we should not be calling this routine
+	** without there being an error to display */
+	if(Trace_Error_Number == 0)
+		sprintf(Trace_Error_String,"Logic Error:No Error defined");
+	fprintf(stderr,"%s Detector_Trace:Error(%d) : %s\n",time_string,Trace_Error_Number,Trace_Error_String);
+}
+
+/**
+ * The error routine that reports any errors occuring in a standard way. This routine places the
+ * generated error string at the end of a passed in string argument.
+ * @param error_string A string to put the generated error in. This string should be initialised before
+ * being passed to this routine. The routine will try to concatenate it's error string onto the end
+ * of any string already in existance.
+ * @see #Trace_Error_Number
+ * @see #Trace_Error_String
+ * @see detector_general.html#Detector_General_Get_Current_Time_String
+ */
+void Detector_Trace_Error_String(char *error_string)
+{
+	char time_string[32];
+
+	Detector_General_Get_Current_Time_String(time_string,32);
+	/* if the error number is zero an error message has not been set up
+	** This is in itself an error as we should not be calling this routine
+	** without there being an error to display */
+	if(Trace_Error_Number == 0)
+		sprintf(Trace_Error_String,"Logic Error:No Error defined");
+	sprintf(error_string+strlen(error_string),"%s Detector_Trace:Error(%d) : %s\n",time_string,
+		Trace_Error_Number,Trace_Error_String);
+}
+
+/* =======================================
+**  internal functions
+** ======================================= */
+/**
+ * Get the trace thread id of the calling thread, assigning a new one if this thread does not have one yet.
+ * Trace thread ids are small integers starting from 1, unique for the life of the process.
+ * @return The trace thread id.
+ * @see #Trace_Thread_Id
+ * @see #Trace_Data
+ */
+static int Trace_Thread_Id_Get(void)
+{
+	if(Trace_Thread_Id == 0)
+		Trace_Thread_Id = __sync_add_and_fetch(&(Trace_Data.Next_Thread_Id),1);
+	return Trace_Thread_Id;
+}
+
+/**
+ * Get the trace buffer owned by the calling thread, claiming a free one if this thread does not own one yet.
+ * <ul>
+ * <li>If Trace_Thread_Buffer_Index is set, we return that buffer.
+ * <li>We create the thread specific data key (once) using pthread_once and Trace_Key_Create.
+ * <li>We search Trace_Data.Buffer_In_Use for a free buffer, claiming it with an atomic compare and swap.
+ * <li>If the claimed buffer has not been allocated yet, we allocate it.
+ * <li>We set the thread specific data value to the buffer index, so Trace_Thread_Exit releases the buffer
+ *     when this thread exits.
+ * </ul>
+ * @return The calling thread's trace buffer, or NULL if all the buffers are in use (or allocation failed).
+ * @see #Trace_Data
+ * @see #Trace_Thread_Buffer_Index
+ * @see #Trace_Key_Create
+ * @see #Trace_Thread_Exit
+ * @see #DETECTOR_TRACE_MAX_BUFFER_COUNT
+ */
+static struct Trace_Buffer_Struct *Trace_Thread_Buffer_Get(void)
+{
+	struct Trace_Buffer_Struct *buffer = NULL;
+	int i;
+
+	if(Trace_Thread_Buffer_Index > 0)
+		return Trace_Data.Buffer_List[Trace_Thread_Buffer_Index-1];
+	pthread_once(&(Trace_Data.Key_Once),Trace_Key_Create);
+	for(i = 0; i < DETECTOR_TRACE_MAX_BUFFER_COUNT; i++)
+	{
+		if(__sync_bool_compare_and_swap(&(Trace_Data.Buffer_In_Use[i]),FALSE,TRUE))
+		{
+			/* only the thread that claimed buffer i can allocate it */
+			if(Trace_Data.Buffer_List[i] == NULL)
+			{
+				buffer = (struct Trace_Buffer_Struct *)calloc(1,sizeof(struct Trace_Buffer_Struct));
+				if(buffer == NULL)
+				{
+					Trace_Data.Buffer_In_Use[i] = FALSE;
+					return NULL;
+				}
+				__sync_synchronize();
+				Trace_Data.Buffer_List[i] = buffer;
+			}
+			Trace_Thread_Buffer_Index = i+1;
+			pthread_setspecific(Trace_Data.Buffer_Key,(void*)(long)(i+1));
+			return Trace_Data.Buffer_List[i];
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Create the thread specific data key used to release trace buffers when their owning thread exits.
+ * Called once, using pthread_once.
+ * @see #Trace_Data
+ * @see #Trace_Thread_Exit
+ */
+static void Trace_Key_Create(void)
+{
+	pthread_key_create(&(Trace_Data.Buffer_Key),Trace_Thread_Exit);
+}
+
+/**
+ * Thread specific data destructor, called when a thread that owns a trace buffer exits. The buffer is marked
+ * as free, so it can be claimed by another thread. The events already in the buffer are kept (they are tagged
+ * with the thread id that recorded them) until they are overwritten.
+ * @param key_value The thread specific data value, the index (plus one) of the buffer owned by the thread.
+ * @see #Trace_Data
+ * @see #Trace_Thread_Buffer_Get
+ */
+static void Trace_Thread_Exit(void *key_value)
+{
+	int buffer_index;
+
+	buffer_index = (int)(long)key_value;
+	if((buffer_index > 0)&&(buffer_index <= DETECTOR_TRACE_MAX_BUFFER_COUNT))
+	{
+		__sync_synchronize();
+		Trace_Data.Buffer_In_Use[buffer_index-1] = FALSE;
+	}
+}
+
+/**
+ * Convert a timespec into microseconds.
+ * @param time The time to convert.
+ * @return The time in microseconds.
+ * @see detector_general.html#DETECTOR_GENERAL_ONE_SECOND_NS
+ * @see detector_general.html#DETECTOR_GENERAL_ONE_MICROSECOND_NS
+ */
+static double Trace_Timespec_To_Us(struct timespec time)
+{
+	return (((double)time.tv_sec)*((double)(DETECTOR_GENERAL_ONE_SECOND_NS/DETECTOR_GENERAL_ONE_MICROSECOND_NS)))+
+		(((double)time.tv_nsec)/((double)DETECTOR_GENERAL_ONE_MICROSECOND_NS));
+}
+
+/**
+ * Write a string to a file as a quoted JSON string, escaping quotes, backslashes and control characters.
+ * @param fp The file pointer to write to.
+ * @param string The string to write. If NULL, an empty string is written.
+ */
+static void Trace_Json_String_Write(FILE *fp,char *string)
+{
+	int i;
+
+	fputc('"',fp);
+	if(string != NULL)
+	{
+		for(i = 0; string[i] != '\0'; i++)
+		{
+			if((string[i] == '"')||(string[i] == '\\'))
+				fprintf(fp,"\\%c",string[i]);
+			else if(((unsigned char)string[i]) < 0x20)
+				fprintf(fp,"\\u%04x",(unsigned char)string[i]);
+			else
+				fputc(string[i],fp);
+		}
+	}
+	fputc('"',fp);
+}
@@ -2,17 +2,97 @@
 #ifndef DETECTOR_BUFFER_H
 #define DETECTOR_BUFFER_H
 
+/**
+ * Enum defining what sort of noise image (if any) to accumulate alongside the coadd image.
+ * <ul>
+ * <li>DETECTOR_BUFFER_NOISE_TYPE_NONE No noise image is accumulated.
+ * <li>DETECTOR_BUFFER_NOISE_TYPE_VARIANCE The per-pixel sample variance of the individual coadds.
+ * <li>DETECTOR_BUFFER_NOISE_TYPE_STANDARD_ERROR The per-pixel standard error of the mean of the coadds.
+ * </ul>
+ */
+enum DETECTOR_BUFFER_NOISE_TYPE
+{
+	DETECTOR_BUFFER_NOISE_TYPE_NONE=0,DETECTOR_BUFFER_NOISE_TYPE_VARIANCE=1,
+	DETECTOR_BUFFER_NOISE_TYPE_STANDARD_ERROR=2
+};
+
+/**
+ * Macro to check whether the parameter is a valid noise type.
+ * @see #DETECTOR_BUFFER_NOISE_TYPE
+ */
+#define DETECTOR_BUFFER_IS_NOISE_TYPE(value)	(((value) == DETECTOR_BUFFER_NOISE_TYPE_NONE)|| \
+						 ((value) == DETECTOR_BUFFER_NOISE_TYPE_VARIANCE)|| \
+						 ((value) == DETECTOR_BUFFER_NOISE_TYPE_STANDARD_ERROR))
+
+/**
+ * The number of bins in the per-frame histogram, one per possible 16 bit pixel value.
+ */
+#define DETECTOR_BUFFER_HISTOGRAM_BIN_COUNT      (65536)
+/**
+ * The default pixel value at or above which a mean image pixel is counted as saturated. 
+ * The Raptor Ninox-640 has a 14 bit ADC.
+ */
+#define DETECTOR_BUFFER_DEFAULT_SATURATION_LEVEL (16383)
+/**
+ * The maximum value a single readout pixel can take (pixels are read out as unsigned shorts). 
+ * Used to decide whether the coadd image needs a 64 bit accumulator.
+ */
+#define DETECTOR_BUFFER_ADC_MAXIMUM              (65535)
+/**
+ * The maximum number of threads the pixel kernels can be split over (including the calling thread).
+ */
+#define DETECTOR_BUFFER_MAX_THREAD_COUNT         (16)
+/**
+ * The alignment of the image buffers in bytes (one cache line), so the pixel loops can use aligned vector loads.
+ */
+#define DETECTOR_BUFFER_ALIGNMENT                (64)
+/**
+ * The size of a huge page in bytes (2 MB), used when the image buffers are allocated using huge pages.
+ */
+#define DETECTOR_BUFFER_HUGE_PAGE_SIZE           (2*1024*1024)
+
+/**
+ * Enum defining the width of the accumulator used to sum coadds into the coadd image.
+ * <ul>
+ * <li>DETECTOR_BUFFER_ACCUMULATOR_32 The coadds are summed into 32 bit integers.
+ * <li>DETECTOR_BUFFER_ACCUMULATOR_64 The coadds are summed into 64 bit integers.
+ * </ul>
+ * The enum values are the accumulator widths in bits.
+ */
+enum DETECTOR_BUFFER_ACCUMULATOR
+{
+	DETECTOR_BUFFER_ACCUMULATOR_32=32,DETECTOR_BUFFER_ACCUMULATOR_64=64
+};
+
 extern int Detector_Buffer_Allocate(int size_x,int size_y);
 extern int Detector_Buffer_Free(void);
+extern int Detector_Buffer_Memory_Options_Set(int use_huge_pages,int lock_memory);
+extern int Detector_Buffer_Noise_Type_Set(enum DETECTOR_BUFFER_NOISE_TYPE type);
+extern enum DETECTOR_BUFFER_NOISE_TYPE Detector_Buffer_Noise_Type_Get(void);
+extern enum DETECTOR_BUFFER_ACCUMULATOR Detector_Buffer_Accumulator_Get(void);
+extern int Detector_Buffer_Thread_Pool_Start(int thread_count,int *core_list,int core_count);
+extern int Detector_Buffer_Thread_Pool_Stop(void);
+extern int Detector_Buffer_Thread_Count_Get(void);
+extern int Detector_Buffer_Strip_Row_Count_Set(int row_count);
+extern int Detector_Buffer_Strip_Row_Count_Get(void);
 
-extern int Detector_Buffer_Initialise_Coadd_Image(void);
+extern int Detector_Buffer_Initialise_Coadd_Image(int coadd_count);
 extern int Detector_Buffer_Add_Mono_To_Coadd_Image(void);
+extern int Detector_Buffer_Add_Strip_To_Coadd_Image(int start_row,int row_count);
 extern void Detector_Buffer_Coadd_Flip_X(void);
 extern void Detector_Buffer_Coadd_Flip_Y(void);
 extern int Detector_Buffer_Create_Mean_Image(int coadds);
+extern int Detector_Buffer_Create_Noise_Image(int coadds);
 
 extern unsigned short* Detector_Buffer_Get_Mono_Image(void);
+extern unsigned short* Detector_Buffer_Get_Strip_Image(void);
 extern double* Detector_Buffer_Get_Mean_Image(void);
+extern double* Detector_Buffer_Get_Noise_Image(void);
+extern int Detector_Buffer_Saturation_Level_Set(int saturation_level);
+extern int Detector_Buffer_Saturation_Level_Get(void);
+extern int Detector_Buffer_Statistics_Get(double *minimum,double *maximum,double *mean,double *median,
+					  int *saturated_count);
+extern int Detector_Buffer_Histogram_Get(unsigned int *histogram);
 extern int Detector_Buffer_Get_Size_X(void);
 extern int Detector_Buffer_Get_Size_Y(void);
 extern int Detector_Buffer_Get_Pixel_Count(void);
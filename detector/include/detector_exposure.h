@@ -8,6 +8,7 @@ extern int Detector_Exposure_Set_Coadd_Frame_Exposure_Length(int coadd_frame_exp
 extern int Detector_Exposure_Flip_Set(int flip_x,int flip_y);
 extern int Detector_Exposure_Expose(int exposure_length_ms,char* fits_filename);
 extern int Detector_Exposure_Bias(char* fits_filename);
+extern void Detector_Exposure_Start_Callback_Set(void (*callback_fn)(void));
 
 extern int Detector_Exposure_Abort(void);
 
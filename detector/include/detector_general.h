@@ -1,7 +1,7 @@
 /* detector_general.h */
 #ifndef DETECTOR_GENERAL_H
 #define DETECTOR_GENERAL_H
-
+#include <stdarg.h>
 
 /* hash defines */
 /**
@@ -65,7 +65,10 @@ extern void Detector_General_Get_Current_Time_String(char *time_string,int strin
 
 extern void Detector_General_Log_Format(int level,char *format,...);
 extern void Detector_General_Log(int level,char *string);
+extern int Detector_General_Log_Level_Enabled(int level);
+extern int Detector_General_Log_Compile_Level_Get(void);
 extern void Detector_General_Set_Log_Handler_Function(void (*log_fn)(int level,char *string));
+extern void Detector_General_Set_Log_Format_Handler_Function(void (*log_fn)(int level,char *format,va_list ap));
 extern void Detector_General_Set_Log_Filter_Function(int (*filter_fn)(int level,char *string));
 extern void Detector_General_Log_Handler_Stdout(int level,char *string);
 extern void Detector_General_Set_Log_Filter_Level(int level);
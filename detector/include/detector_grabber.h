@@ -0,0 +1,110 @@
+/* detector_grabber.h */
+#ifndef DETECTOR_GRABBER_H
+#define DETECTOR_GRABBER_H
+
+/**
+ * Enum defining which frame grabber backend the detector library talks to.
+ * <ul>
+ * <li>DETECTOR_GRABBER_BACKEND_XCLIB The EPIX frame grabber and Raptor camera head, via the XCLIB pxd_ library.
+ * <li>DETECTOR_GRABBER_BACKEND_SIMULATOR A simulated frame grabber and camera head (detector_grabber_simulator),
+ *     producing synthetic frames, that needs no hardware.
+ * </ul>
+ */
+enum DETECTOR_GRABBER_BACKEND
+{
+	DETECTOR_GRABBER_BACKEND_XCLIB=0,DETECTOR_GRABBER_BACKEND_SIMULATOR=1
+};
+
+/**
+ * Macro to check whether the parameter is a valid frame grabber backend.
+ * @see #DETECTOR_GRABBER_BACKEND
+ */
+#define DETECTOR_GRABBER_IS_BACKEND(value)	(((value) == DETECTOR_GRABBER_BACKEND_XCLIB)|| \
+						 ((value) == DETECTOR_GRABBER_BACKEND_SIMULATOR))
+
+/**
+ * Data type holding the set of functions a frame grabber backend implements. Each function has the same
+ * semantics (and return values) as the XCLIB pxd_ routine of the same name:
+ * <dl>
+ * <dt>Open</dt> <dd>pxd_PIXCIopen</dd>
+ * <dt>Close</dt> <dd>pxd_PIXCIclose</dd>
+ * <dt>Info_Units</dt> <dd>pxd_infoUnits</dd>
+ * <dt>Info_Memsize</dt> <dd>pxd_infoMemsize</dd>
+ * <dt>Image_X_Dim</dt> <dd>pxd_imageXdim</dd>
+ * <dt>Image_Y_Dim</dt> <dd>pxd_imageYdim</dd>
+ * <dt>Image_Z_Dim</dt> <dd>pxd_imageZdim</dd>
+ * <dt>Image_C_Dim</dt> <dd>pxd_imageCdim</dd>
+ * <dt>Image_B_Dim</dt> <dd>pxd_imageBdim</dd>
+ * <dt>Go_Live_Pair</dt> <dd>pxd_goLivePair</dd>
+ * <dt>Go_Abort_Live</dt> <dd>pxd_goAbortLive</dd>
+ * <dt>Captured_Field_Count</dt> <dd>pxd_capturedFieldCount</dd>
+ * <dt>Captured_Buffer</dt> <dd>pxd_capturedBuffer</dd>
+ * <dt>Captured_Sys_Ticks</dt> <dd>pxd_capturedSysTicks</dd>
+ * <dt>Captured_Sys_Ticks_Hi</dt> <dd>pxd_capturedSysTicksHi</dd>
+ * <dt>Read_UShort</dt> <dd>pxd_readushort</dd>
+ * <dt>Error_Code_String</dt> <dd>pxd_mesgErrorCode</dd>
+ * <dt>Serial_Configure</dt> <dd>pxd_serialConfigure</dd>
+ * <dt>Serial_Read</dt> <dd>pxd_serialRead</dd>
+ * <dt>Serial_Write</dt> <dd>pxd_serialWrite</dd>
+ * <dt>Serial_Flush</dt> <dd>pxd_serialFlush</dd>
+ * </dl>
+ */
+struct Detector_Grabber_Backend_Struct
+{
+	int (*Open)(char *driverparms,char *formatname,char *formatfile);
+	int (*Close)(void);
+	int (*Info_Units)(void);
+	unsigned long (*Info_Memsize)(int unitmap);
+	int (*Image_X_Dim)(void);
+	int (*Image_Y_Dim)(void);
+	int (*Image_Z_Dim)(void);
+	int (*Image_C_Dim)(void);
+	int (*Image_B_Dim)(void);
+	int (*Go_Live_Pair)(int unitmap,long buffer1,long buffer2);
+	int (*Go_Abort_Live)(int unitmap);
+	unsigned long (*Captured_Field_Count)(int unitmap);
+	long (*Captured_Buffer)(int unitmap);
+	unsigned int (*Captured_Sys_Ticks)(int unitmap);
+	unsigned int (*Captured_Sys_Ticks_Hi)(int unitmap);
+	int (*Read_UShort)(int unitmap,long buffer,int ulx,int uly,int lrx,int lry,unsigned short *membase,
+			   size_t count,char *colorspace);
+	char *(*Error_Code_String)(int error_code);
+	int (*Serial_Configure)(int unitmap,int rsvd0,double baud,int bits,int parity,int stopbits,
+				int rsvd1,int rsvd2,int rsvd3);
+	int (*Serial_Read)(int unitmap,int rsvd0,unsigned char *buffer,int count);
+	int (*Serial_Write)(int unitmap,int rsvd0,unsigned char *buffer,int count);
+	int (*Serial_Flush)(int unitmap,int rsvd0,int rsvd1,int rsvd2);
+};
+
+extern int Detector_Grabber_Backend_Set(enum DETECTOR_GRABBER_BACKEND backend);
+extern enum DETECTOR_GRABBER_BACKEND Detector_Grabber_Backend_Get(void);
+
+extern int Detector_Grabber_Open(char *driverparms,char *formatname,char *formatfile);
+extern int Detector_Grabber_Close(void);
+extern int Detector_Grabber_Info_Units(void);
+extern unsigned long Detector_Grabber_Info_Memsize(int unitmap);
+extern int Detector_Grabber_Image_X_Dim(void);
+extern int Detector_Grabber_Image_Y_Dim(void);
+extern int Detector_Grabber_Image_Z_Dim(void);
+extern int Detector_Grabber_Image_C_Dim(void);
+extern int Detector_Grabber_Image_B_Dim(void);
+extern int Detector_Grabber_Go_Live_Pair(int unitmap,long buffer1,long buffer2);
+extern int Detector_Grabber_Go_Abort_Live(int unitmap);
+extern unsigned long Detector_Grabber_Captured_Field_Count(int unitmap);
+extern long Detector_Grabber_Captured_Buffer(int unitmap);
+extern unsigned int Detector_Grabber_Captured_Sys_Ticks(int unitmap);
+extern unsigned int Detector_Grabber_Captured_Sys_Ticks_Hi(int unitmap);
+extern int Detector_Grabber_Read_UShort(int unitmap,long buffer,int ulx,int uly,int lrx,int lry,
+					unsigned short *membase,size_t count,char *colorspace);
+extern char *Detector_Grabber_Error_Code_String(int error_code);
+extern int Detector_Grabber_Serial_Configure(int unitmap,int rsvd0,double baud,int bits,int parity,int stopbits,
+					     int rsvd1,int rsvd2,int rsvd3);
+extern int Detector_Grabber_Serial_Read(int unitmap,int rsvd0,unsigned char *buffer,int count);
+extern int Detector_Grabber_Serial_Write(int unitmap,int rsvd0,unsigned char *buffer,int count);
+extern int Detector_Grabber_Serial_Flush(int unitmap,int rsvd0,int rsvd1,int rsvd2);
+
+extern int Detector_Grabber_Get_Error_Number(void);
+extern void Detector_Grabber_Error(void);
+extern void Detector_Grabber_Error_String(char *error_string);
+
+#endif
@@ -0,0 +1,24 @@
+/* detector_grabber_simulator.h */
+#ifndef DETECTOR_GRABBER_SIMULATOR_H
+#define DETECTOR_GRABBER_SIMULATOR_H
+#include "detector_grabber.h"
+
+/**
+ * The default simulated field (frame) period in milliseconds, used when the field period is not set explicitly
+ * and cannot be derived from the format filename.
+ */
+#define DETECTOR_GRABBER_SIMULATOR_DEFAULT_FIELD_PERIOD_MS (100)
+/**
+ * The minimum simulated field (frame) period in milliseconds.
+ */
+#define DETECTOR_GRABBER_SIMULATOR_MIN_FIELD_PERIOD_MS     (10)
+
+extern struct Detector_Grabber_Backend_Struct *Detector_Grabber_Simulator_Backend_Get(void);
+extern int Detector_Grabber_Simulator_Field_Period_Set(int field_period_ms);
+extern int Detector_Grabber_Simulator_Field_Period_Get(void);
+
+extern int Detector_Grabber_Simulator_Get_Error_Number(void);
+extern void Detector_Grabber_Simulator_Error(void);
+extern void Detector_Grabber_Simulator_Error_String(char *error_string);
+
+#endif
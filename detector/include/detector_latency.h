@@ -0,0 +1,66 @@
+/* detector_latency.h */
+#ifndef DETECTOR_LATENCY_H
+#define DETECTOR_LATENCY_H
+#include <time.h>
+
+/**
+ * Enum defining the stages of an exposure we record latencies for.
+ * <ul>
+ * <li>DETECTOR_LATENCY_STAGE_NUDGEMATIC_MOVE Moving the nudgematic to the next offset position.
+ * <li>DETECTOR_LATENCY_STAGE_HEADER_SET Setting the per-exposure FITS headers.
+ * <li>DETECTOR_LATENCY_STAGE_GO_LIVE Starting the frame grabber capturing frames.
+ * <li>DETECTOR_LATENCY_STAGE_FIRST_FIELD From the frame grabber going live to the first field being captured.
+ * <li>DETECTOR_LATENCY_STAGE_COADD_READOUT Reading out one coadd and adding it to the coadd image
+ *     (recorded once per coadd).
+ * <li>DETECTOR_LATENCY_STAGE_MEAN_FLIP Flipping the coadd image and creating the mean (and noise) images.
+ * <li>DETECTOR_LATENCY_STAGE_FITS_CREATE Creating the lock file, FITS file and image block.
+ * <li>DETECTOR_LATENCY_STAGE_FITS_WRITE Writing the mean image data into the FITS file.
+ * <li>DETECTOR_LATENCY_STAGE_FITS_HEADER Writing the FITS headers and statistics into the FITS file.
+ * <li>DETECTOR_LATENCY_STAGE_FITS_NOISE_WRITE Writing the noise image extension (only when one is accumulated).
+ * <li>DETECTOR_LATENCY_STAGE_FITS_CLOSE Closing (flushing) the FITS file.
+ * <li>DETECTOR_LATENCY_STAGE_UNLOCK Removing the FITS lock file.
+ * <li>DETECTOR_LATENCY_STAGE_FORMAT_SWITCH Switching the detector to a different video format 
+ *     (coadd exposure length), using Detector_Setup_Format_Switch. This is not part of an exposure.
+ * </ul>
+ * DETECTOR_LATENCY_STAGE_COUNT is the number of stages.
+ */
+enum DETECTOR_LATENCY_STAGE
+{
+	DETECTOR_LATENCY_STAGE_NUDGEMATIC_MOVE=0,DETECTOR_LATENCY_STAGE_HEADER_SET=1,
+	DETECTOR_LATENCY_STAGE_GO_LIVE=2,DETECTOR_LATENCY_STAGE_FIRST_FIELD=3,
+	DETECTOR_LATENCY_STAGE_COADD_READOUT=4,DETECTOR_LATENCY_STAGE_MEAN_FLIP=5,
+	DETECTOR_LATENCY_STAGE_FITS_CREATE=6,DETECTOR_LATENCY_STAGE_FITS_WRITE=7,
+	DETECTOR_LATENCY_STAGE_FITS_HEADER=8,DETECTOR_LATENCY_STAGE_FITS_NOISE_WRITE=9,
+	DETECTOR_LATENCY_STAGE_FITS_CLOSE=10,DETECTOR_LATENCY_STAGE_UNLOCK=11,
+	DETECTOR_LATENCY_STAGE_FORMAT_SWITCH=12,DETECTOR_LATENCY_STAGE_COUNT=13
+};
+
+/**
+ * Macro to check whether the parameter is a valid latency stage.
+ * @see #DETECTOR_LATENCY_STAGE
+ */
+#define DETECTOR_LATENCY_IS_STAGE(value)	(((value) >= DETECTOR_LATENCY_STAGE_NUDGEMATIC_MOVE)&& \
+						 ((value) < DETECTOR_LATENCY_STAGE_COUNT))
+
+/**
+ * The number of latency samples kept for each stage. Older samples are overwritten.
+ */
+#define DETECTOR_LATENCY_RING_LENGTH		(256)
+
+extern void Detector_Latency_Timestamp(struct timespec *timestamp);
+extern void Detector_Latency_Stage_Record(enum DETECTOR_LATENCY_STAGE stage,struct timespec *start_time);
+extern int Detector_Latency_Stage_Statistics_Get(enum DETECTOR_LATENCY_STAGE stage,int *count,double *min_ms,
+						 double *mean_ms,double *p95_ms,double *max_ms);
+extern int Detector_Latency_Stage_Exposure_Get(enum DETECTOR_LATENCY_STAGE stage,int *count,double *mean_ms);
+extern char *Detector_Latency_Stage_Name_Get(enum DETECTOR_LATENCY_STAGE stage);
+extern int Detector_Latency_Stage_From_Name(char *name,enum DETECTOR_LATENCY_STAGE *stage);
+extern void Detector_Latency_Exposure_Reset(void);
+extern void Detector_Latency_Reset(void);
+extern int Detector_Latency_Fits_Keywords_Set(int enable);
+extern int Detector_Latency_Fits_Keywords_Get(void);
+
+extern int Detector_Latency_Get_Error_Number(void);
+extern void Detector_Latency_Error(void);
+extern void Detector_Latency_Error_String(char *error_string);
+
+#endif
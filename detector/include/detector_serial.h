@@ -28,10 +28,44 @@
  * Also returned by Getting FPGA status.
  */
 #define DETECTOR_SERIAL_FPGA_CTRL_HORIZONTAL_FLIP_ENABLED  (1<<7)
+/**
+ * The maximum number of distinct commands Detector_Serial_Statistics_Get keeps latency statistics for.
+ */
+#define DETECTOR_SERIAL_MAX_STATISTICS_COUNT               (32)
+
+/**
+ * Structure holding the round trip statistics of one kind of serial command:
+ * <dl>
+ * <dt>Command_Byte</dt> <dd>The first byte of the command.</dd>
+ * <dt>Sub_Command_Byte</dt> <dd>For register/EPROM access commands (0x53), the second byte of the command
+ *     (e.g. 0xE0 set address/write register, 0xE1 read register). Otherwise 0.</dd>
+ * <dt>Count</dt> <dd>The number of commands sent.</dd>
+ * <dt>Failure_Count</dt> <dd>The number of commands that failed (including timeouts and error replies).</dd>
+ * <dt>Timeout_Count</dt> <dd>The number of commands that timed out waiting for a reply.</dd>
+ * <dt>Min_Ms</dt> <dd>The minimum round trip time (write to complete reply), in milliseconds.</dd>
+ * <dt>Mean_Ms</dt> <dd>The mean round trip time, in milliseconds.</dd>
+ * <dt>Max_Ms</dt> <dd>The maximum round trip time, in milliseconds.</dd>
+ * <dt>Queue_Mean_Ms</dt> <dd>The mean time commands waited in the queue before being sent, in milliseconds.</dd>
+ * </dl>
+ */
+struct Detector_Serial_Statistics_Struct
+{
+	unsigned char Command_Byte;
+	unsigned char Sub_Command_Byte;
+	unsigned int Count;
+	unsigned int Failure_Count;
+	unsigned int Timeout_Count;
+	double Min_Ms;
+	double Mean_Ms;
+	double Max_Ms;
+	double Queue_Mean_Ms;
+};
 
 extern int Detector_Serial_Initialise(void);
+extern int Detector_Serial_Reinitialise(void);
 
 extern int Detector_Serial_Open(void);
+extern int Detector_Serial_Close(void);
 
 extern int Detector_Serial_Command_Get_System_Status(unsigned char *status,int *checksum_enabled,
 						     int *cmd_ack_enabled,int *fpga_booted,int *fpga_in_reset,
@@ -52,6 +86,12 @@ extern int Detector_Serial_Command_Set_TEC_Setpoint(int dac_value);
 
 extern int Detector_Serial_Command(unsigned char *command_buffer,int command_buffer_length,
 				   unsigned char *reply_buffer,int reply_buffer_length);
+extern void Detector_Serial_Sequence_Start(void);
+extern void Detector_Serial_Sequence_End(void);
+
+extern int Detector_Serial_Statistics_Get(struct Detector_Serial_Statistics_Struct *statistics_list,int max_count,
+					  int *statistics_count);
+extern void Detector_Serial_Statistics_Reset(void);
 
 extern int Detector_Serial_Compute_Checksum(unsigned char *buffer,int *buffer_length);
 extern char* Detector_Serial_Print_Command(unsigned char *buffer,int buffer_length,char *string_buffer,int string_buffer_length);
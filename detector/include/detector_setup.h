@@ -4,6 +4,8 @@
 
 extern int Detector_Setup_Startup(char *format_filename);
 extern int Detector_Setup_Shutdown(void);
+extern int Detector_Setup_Format_Preload(char *format_filename);
+extern int Detector_Setup_Format_Switch(char *format_filename);
 
 extern int Detector_Setup_Open(char *driverparms,char *formatname, char *formatfile);
 extern int Detector_Setup_Close(void);
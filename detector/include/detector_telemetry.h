@@ -0,0 +1,77 @@
+/* detector_telemetry.h */
+#ifndef DETECTOR_TELEMETRY_H
+#define DETECTOR_TELEMETRY_H
+#include <time.h>
+
+/**
+ * Telemetry sample valid mask bit: the Sensor_Temperature_C field was read successfully.
+ */
+#define DETECTOR_TELEMETRY_VALID_SENSOR_TEMPERATURE	(1<<0)
+/**
+ * Telemetry sample valid mask bit: the PCB_Temperature_C field was read successfully.
+ */
+#define DETECTOR_TELEMETRY_VALID_PCB_TEMPERATURE	(1<<1)
+/**
+ * Telemetry sample valid mask bit: the TEC_Setpoint_C field was read successfully.
+ */
+#define DETECTOR_TELEMETRY_VALID_TEC_SETPOINT		(1<<2)
+/**
+ * Telemetry sample valid mask bit: the FPGA_Status field was read successfully.
+ */
+#define DETECTOR_TELEMETRY_VALID_FPGA_STATUS		(1<<3)
+/**
+ * The minimum sampling period, in milliseconds. Each sample is several serial command round trips.
+ */
+#define DETECTOR_TELEMETRY_MIN_PERIOD_MS		(100)
+/**
+ * The maximum number of samples kept in the telemetry ring.
+ */
+#define DETECTOR_TELEMETRY_MAX_RING_LENGTH		(1000000)
+/**
+ * The maximum number of points a downsampled history query can return.
+ */
+#define DETECTOR_TELEMETRY_MAX_HISTORY_POINT_COUNT	(1440)
+
+/**
+ * Structure holding one telemetry sample (or one downsampled history point):
+ * <dl>
+ * <dt>Timestamp</dt> <dd>The time (CLOCK_REALTIME) the sample was taken. For history points, the middle of the
+ *     time bin the point summarises.</dd>
+ * <dt>Valid_Mask</dt> <dd>A bit mask of which of the fields below were read successfully
+ *     (DETECTOR_TELEMETRY_VALID_*).</dd>
+ * <dt>Sensor_Temperature_C</dt> <dd>The sensor temperature, in degrees centigrade.</dd>
+ * <dt>PCB_Temperature_C</dt> <dd>The sensor PCB temperature, in degrees centigrade.</dd>
+ * <dt>TEC_Setpoint_C</dt> <dd>The TEC set-point temperature, in degrees centigrade.</dd>
+ * <dt>FPGA_Status</dt> <dd>The FPGA status byte (TEC/fan enabled etc).</dd>
+ * <dt>Sample_Count</dt> <dd>The number of samples combined into this one (1 for a raw sample). History points
+ *     average the temperatures of their samples, and keep the FPGA status of the latest.</dd>
+ * </dl>
+ */
+struct Detector_Telemetry_Sample_Struct
+{
+	struct timespec Timestamp;
+	int Valid_Mask;
+	double Sensor_Temperature_C;
+	double PCB_Temperature_C;
+	double TEC_Setpoint_C;
+	int FPGA_Status;
+	int Sample_Count;
+};
+
+extern int Detector_Telemetry_Start(int period_ms,int history_length_s);
+extern int Detector_Telemetry_Stop(void);
+extern int Detector_Telemetry_Is_Running(void);
+extern void Detector_Telemetry_Sample_Callback_Set(void (*callback_fn)(struct Detector_Telemetry_Sample_Struct *sample));
+extern void Detector_Telemetry_Pause(void);
+extern void Detector_Telemetry_Resume(void);
+extern void Detector_Telemetry_Sample_Request(void);
+extern int Detector_Telemetry_Latest_Get(struct Detector_Telemetry_Sample_Struct *sample,double *age_s);
+extern int Detector_Telemetry_History_Get(int history_length_s,int point_count,
+					  struct Detector_Telemetry_Sample_Struct *point_list,int *returned_point_count);
+extern void Detector_Telemetry_Statistics_Get(int *period_ms,unsigned int *sample_count,unsigned int *failure_count);
+
+extern int Detector_Telemetry_Get_Error_Number(void);
+extern void Detector_Telemetry_Error(void);
+extern void Detector_Telemetry_Error_String(char *error_string);
+
+#endif
@@ -0,0 +1,40 @@
+/* detector_trace.h */
+#ifndef DETECTOR_TRACE_H
+#define DETECTOR_TRACE_H
+#include <time.h>
+
+/**
+ * The number of span events kept in each thread's trace buffer. Older events are overwritten.
+ */
+#define DETECTOR_TRACE_RING_LENGTH		(4096)
+/**
+ * The maximum number of threads that can be recording span events at the same time. A thread's trace buffer
+ * is released for re-use when the thread exits.
+ */
+#define DETECTOR_TRACE_MAX_BUFFER_COUNT		(32)
+/**
+ * The number of thread names remembered for the trace dump. Older names are overwritten.
+ */
+#define DETECTOR_TRACE_MAX_THREAD_NAME_COUNT	(256)
+/**
+ * The length of the detail string attached to each span event, including the NULL terminator.
+ */
+#define DETECTOR_TRACE_DETAIL_LENGTH		(32)
+/**
+ * The length of a thread name, including the NULL terminator.
+ */
+#define DETECTOR_TRACE_THREAD_NAME_LENGTH	(32)
+
+extern int Detector_Trace_Enable_Set(int enable);
+extern int Detector_Trace_Enable_Get(void);
+extern void Detector_Trace_Span_Start(struct timespec *start_time);
+extern void Detector_Trace_Span_End(char *category,char *name,char *detail,struct timespec *start_time);
+extern int Detector_Trace_Thread_Name_Set(char *name);
+extern void Detector_Trace_Clear(void);
+extern int Detector_Trace_Dump(char *filename,int *event_count);
+
+extern int Detector_Trace_Get_Error_Number(void);
+extern void Detector_Trace_Error(void);
+extern void Detector_Trace_Error_String(char *error_string);
+
+#endif
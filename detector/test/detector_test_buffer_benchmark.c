@@ -0,0 +1,648 @@
+/* detector_test_buffer_benchmark.c */
+/**
+ * Test program to benchmark the detector_buffer pixel kernels (coadd add, flip, mean and noise image)
+ * against the number of threads they are split over. This does not need a detector or frame grabber,
+ * the mono image is filled with synthetic data. The page faults and data TLB misses taken during the 
+ * coadd add loop are also reported, so the effect of huge page / locked buffers can be measured.
+ * The two-pass readout (whole frame copied into the mono image, then added to the coadd image) is also compared
+ * against the fused strip readout (each strip added to the coadd image as soon as it is copied), 
+ * with a synthetic frame grabber buffer standing in for pxd_readushort.
+ * @author Chris Mottram
+ * @version $Id$
+ */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include "log_udp.h"
+
+#include "detector_buffer.h"
+#include "detector_general.h"
+
+/* hash defines */
+/**
+ * Length of some of the strings used in this program.
+ */
+#define STRING_LENGTH           (256)
+/**
+ * The default image size in X, in pixels (the Raptor Ninox-640 sensor size).
+ */
+#define DEFAULT_SIZE_X          (640)
+/**
+ * The default image size in Y, in pixels (the Raptor Ninox-640 sensor size).
+ */
+#define DEFAULT_SIZE_Y          (512)
+/**
+ * The default number of frames (coadds) to add for each thread count.
+ */
+#define DEFAULT_FRAME_COUNT     (1000)
+/**
+ * The default maximum number of threads to benchmark.
+ */
+#define DEFAULT_MAX_THREAD_COUNT (4)
+/**
+ * The default number of rows in each readout strip, for the strip readout benchmark.
+ */
+#define DEFAULT_STRIP_ROW_COUNT  (32)
+
+/* internal variables */
+/**
+ * Revision Control System identifier.
+ */
+static char rcsid[] = "$Id$";
+/**
+ * Verbosity log level : initialised to LOG_VERBOSITY_VERY_TERSE.
+ */
+static int Log_Level = LOG_VERBOSITY_VERY_TERSE;
+/**
+ * The image size in X, in pixels.
+ * @see #DEFAULT_SIZE_X
+ */
+static int Size_X = DEFAULT_SIZE_X;
+/**
+ * The image size in Y, in pixels.
+ * @see #DEFAULT_SIZE_Y
+ */
+static int Size_Y = DEFAULT_SIZE_Y;
+/**
+ * The number of frames (coadds) to add for each thread count.
+ * @see #DEFAULT_FRAME_COUNT
+ */
+static int Frame_Count = DEFAULT_FRAME_COUNT;
+/**
+ * The maximum number of threads to benchmark. Each thread count from 1 to this is benchmarked.
+ * @see #DEFAULT_MAX_THREAD_COUNT
+ */
+static int Max_Thread_Count = DEFAULT_MAX_THREAD_COUNT;
+/**
+ * A list of CPU cores to pin the worker threads to.
+ * @see ../cdocs/detector_buffer.html#DETECTOR_BUFFER_MAX_THREAD_COUNT
+ */
+static int Core_List[DETECTOR_BUFFER_MAX_THREAD_COUNT];
+/**
+ * The number of cores in Core_List. If 0, the worker threads are not pinned.
+ */
+static int Core_Count = 0;
+/**
+ * Which sort of noise image (if any) to accumulate alongside the mean image.
+ * @see ../cdocs/detector_buffer.html#DETECTOR_BUFFER_NOISE_TYPE
+ */
+static enum DETECTOR_BUFFER_NOISE_TYPE Noise_Type = DETECTOR_BUFFER_NOISE_TYPE_NONE;
+/**
+ * Whether to allocate the image buffers using huge pages.
+ */
+static int Use_Huge_Pages = FALSE;
+/**
+ * Whether to lock the image buffers into RAM.
+ */
+static int Lock_Memory = FALSE;
+/**
+ * The number of rows in each readout strip, for the strip readout benchmark.
+ * @see #DEFAULT_STRIP_ROW_COUNT
+ */
+static int Strip_Row_Count = DEFAULT_STRIP_ROW_COUNT;
+/**
+ * A synthetic frame grabber buffer, that the readout benchmarks copy each frame out of.
+ */
+static unsigned short *Frame_Grabber_Image = NULL;
+
+/* internal functions */
+static int Parse_Arguments(int argc, char *argv[]);
+static void Help(void);
+static int TLB_Miss_Counter_Open(void);
+static long long TLB_Miss_Counter_Read(int fd);
+static int Readout_Benchmark(int use_strips,double *readout_time);
+
+/* ------------------------------------------------------------------
+**          External functions
+** ------------------------------------------------------------------ */
+/**
+ * Main program.
+ * <ul>
+ * <li>We set the memory options, allocate the image buffers, and set the noise type and strip row count.
+ * <li>We allocate and fill a synthetic frame grabber buffer (Frame_Grabber_Image).
+ * <li>We open a data TLB read miss counter using TLB_Miss_Counter_Open.
+ * <li>For each thread count from 1 to Max_Thread_Count:
+ *     <ul>
+ *     <li>We start the worker thread pool with Detector_Buffer_Thread_Pool_Start.
+ *     <li>We initialise the coadd image, then add Frame_Count synthetic mono images to it, timing each add
+ *         to get the mean and maximum per-frame add latency. We record the minor/major page faults (getrusage)
+ *         and data TLB misses over the add loop.
+ *     <li>We time a flip in X, a flip in Y, the mean image creation and (if enabled) the noise image creation.
+ *     <li>We call Readout_Benchmark to time the two-pass and strip readouts.
+ *     <li>We print the results.
+ *     </ul>
+ * <li>We stop the worker thread pool and free the image buffers.
+ * </ul>
+ * @param argc The number of arguments to the program.
+ * @param argv An array of argument strings.
+ * @see #Parse_Arguments
+ * @see #Log_Level
+ * @see #Size_X
+ * @see #Size_Y
+ * @see #Frame_Count
+ * @see #Max_Thread_Count
+ * @see #Core_List
+ * @see #Core_Count
+ * @see #Noise_Type
+ * @see #Use_Huge_Pages
+ * @see #Lock_Memory
+ * @see #TLB_Miss_Counter_Open
+ * @see #TLB_Miss_Counter_Read
+ * @see #Strip_Row_Count
+ * @see #Frame_Grabber_Image
+ * @see #Readout_Benchmark
+ * @see ../cdocs/detector_buffer.html#Detector_Buffer_Memory_Options_Set
+ * @see ../cdocs/detector_buffer.html#Detector_Buffer_Allocate
+ * @see ../cdocs/detector_buffer.html#Detector_Buffer_Noise_Type_Set
+ * @see ../cdocs/detector_buffer.html#Detector_Buffer_Strip_Row_Count_Set
+ * @see ../cdocs/detector_buffer.html#Detector_Buffer_Thread_Pool_Start
+ * @see ../cdocs/detector_buffer.html#Detector_Buffer_Thread_Pool_Stop
+ * @see ../cdocs/detector_buffer.html#Detector_Buffer_Initialise_Coadd_Image
+ * @see ../cdocs/detector_buffer.html#Detector_Buffer_Get_Mono_Image
+ * @see ../cdocs/detector_buffer.html#Detector_Buffer_Add_Mono_To_Coadd_Image
+ * @see ../cdocs/detector_buffer.html#Detector_Buffer_Coadd_Flip_X
+ * @see ../cdocs/detector_buffer.html#Detector_Buffer_Coadd_Flip_Y
+ * @see ../cdocs/detector_buffer.html#Detector_Buffer_Create_Mean_Image
+ * @see ../cdocs/detector_buffer.html#Detector_Buffer_Create_Noise_Image
+ * @see ../cdocs/detector_buffer.html#Detector_Buffer_Free
+ * @see ../cdocs/detector_general.html#Detector_General_Set_Log_Filter_Level
+ * @see ../cdocs/detector_general.html#Detector_General_Set_Log_Filter_Function
+ * @see ../cdocs/detector_general.html#Detector_General_Log_Filter_Level_Absolute
+ * @see ../cdocs/detector_general.html#Detector_General_Set_Log_Handler_Function
+ * @see ../cdocs/detector_general.html#Detector_General_Log_Handler_Stdout
+ * @see ../cdocs/detector_general.html#Detector_General_Error
+ * @see ../cdocs/detector_general.html#fdifftime
+ */
+int main(int argc, char *argv[])
+{
+	struct timespec start_time,end_time;
+	struct rusage start_usage,end_usage;
+	unsigned short *mono_image = NULL;
+	double add_time,add_total_time,add_max_time,flip_x_time,flip_y_time,mean_time,noise_time;
+	double two_pass_time,strip_time;
+	long long tlb_misses,start_tlb_misses;
+	long page_faults;
+	int thread_count,i,pixel_count,tlb_fd;
+
+	/* parse arguments */
+	fprintf(stdout,"detector_test_buffer_benchmark : Parsing Arguments.\n");
+	if(!Parse_Arguments(argc,argv))
+		return 1;
+	Detector_General_Set_Log_Filter_Level(Log_Level);
+	Detector_General_Set_Log_Filter_Function(Detector_General_Log_Filter_Level_Absolute);
+	Detector_General_Set_Log_Handler_Function(Detector_General_Log_Handler_Stdout);
+	/* allocate buffers */
+	if(!Detector_Buffer_Memory_Options_Set(Use_Huge_Pages,Lock_Memory))
+	{
+		Detector_General_Error();
+		return 11;
+	}
+	if(!Detector_Buffer_Allocate(Size_X,Size_Y))
+	{
+		Detector_General_Error();
+		return 2;
+	}
+	if(!Detector_Buffer_Noise_Type_Set(Noise_Type))
+	{
+		Detector_General_Error();
+		return 3;
+	}
+	if(!Detector_Buffer_Strip_Row_Count_Set(Strip_Row_Count))
+	{
+		Detector_General_Error();
+		return 12;
+	}
+	pixel_count = Detector_Buffer_Get_Pixel_Count();
+	Frame_Grabber_Image = (unsigned short *)malloc(pixel_count*sizeof(unsigned short));
+	if(Frame_Grabber_Image == NULL)
+	{
+		fprintf(stderr,"detector_test_buffer_benchmark : Failed to allocate frame grabber image.\n");
+		return 13;
+	}
+	for(i = 0; i < pixel_count; i++)
+		Frame_Grabber_Image[i] = (unsigned short)(i%16384);
+	fprintf(stdout,"detector_test_buffer_benchmark : Image %d x %d, %d frames, noise type %d, "
+		"huge pages %d, locked %d, strip rows %d.\n",Size_X,Size_Y,Frame_Count,Noise_Type,
+		Use_Huge_Pages,Lock_Memory,Strip_Row_Count);
+	tlb_fd = TLB_Miss_Counter_Open();
+	if(tlb_fd < 0)
+		fprintf(stdout,"detector_test_buffer_benchmark : Data TLB miss counter not available (%d).\n",errno);
+	fprintf(stdout,"threads add_mean_ms add_max_ms flip_x_ms flip_y_ms mean_ms noise_ms add_faults add_dtlb_misses "
+		"two_pass_ms strip_ms\n");
+	for(thread_count = 1; thread_count <= Max_Thread_Count; thread_count++)
+	{
+		if(!Detector_Buffer_Thread_Pool_Start(thread_count,Core_List,Core_Count))
+		{
+			Detector_General_Error();
+			return 4;
+		}
+		if(!Detector_Buffer_Initialise_Coadd_Image(Frame_Count))
+		{
+			Detector_General_Error();
+			return 5;
+		}
+		add_total_time = 0.0;
+		add_max_time = 0.0;
+		getrusage(RUSAGE_SELF,&start_usage);
+		start_tlb_misses = TLB_Miss_Counter_Read(tlb_fd);
+		for(i = 0; i < Frame_Count; i++)
+		{
+			/* the mono image buffer is the frame grabber readout target, reset its contents each frame */
+			mono_image = Detector_Buffer_Get_Mono_Image();
+			memset(mono_image,(i%64),pixel_count*sizeof(unsigned short));
+			clock_gettime(CLOCK_MONOTONIC,&start_time);
+			if(!Detector_Buffer_Add_Mono_To_Coadd_Image())
+			{
+				Detector_General_Error();
+				return 6;
+			}
+			clock_gettime(CLOCK_MONOTONIC,&end_time);
+			add_time = fdifftime(end_time,start_time);
+			add_total_time += add_time;
+			if(add_time > add_max_time)
+				add_max_time = add_time;
+		}
+		getrusage(RUSAGE_SELF,&end_usage);
+		page_faults = (end_usage.ru_minflt-start_usage.ru_minflt)+(end_usage.ru_majflt-start_usage.ru_majflt);
+		if(tlb_fd >= 0)
+			tlb_misses = TLB_Miss_Counter_Read(tlb_fd)-start_tlb_misses;
+		else
+			tlb_misses = -1;
+		clock_gettime(CLOCK_MONOTONIC,&start_time);
+		Detector_Buffer_Coadd_Flip_X();
+		clock_gettime(CLOCK_MONOTONIC,&end_time);
+		flip_x_time = fdifftime(end_time,start_time);
+		clock_gettime(CLOCK_MONOTONIC,&start_time);
+		Detector_Buffer_Coadd_Flip_Y();
+		clock_gettime(CLOCK_MONOTONIC,&end_time);
+		flip_y_time = fdifftime(end_time,start_time);
+		clock_gettime(CLOCK_MONOTONIC,&start_time);
+		if(!Detector_Buffer_Create_Mean_Image(Frame_Count))
+		{
+			Detector_General_Error();
+			return 7;
+		}
+		clock_gettime(CLOCK_MONOTONIC,&end_time);
+		mean_time = fdifftime(end_time,start_time);
+		noise_time = 0.0;
+		if((Noise_Type != DETECTOR_BUFFER_NOISE_TYPE_NONE)&&(Frame_Count > 1))
+		{
+			clock_gettime(CLOCK_MONOTONIC,&start_time);
+			if(!Detector_Buffer_Create_Noise_Image(Frame_Count))
+			{
+				Detector_General_Error();
+				return 8;
+			}
+			clock_gettime(CLOCK_MONOTONIC,&end_time);
+			noise_time = fdifftime(end_time,start_time);
+		}
+		if(!Readout_Benchmark(FALSE,&two_pass_time))
+			return 14;
+		if(!Readout_Benchmark(TRUE,&strip_time))
+			return 15;
+		fprintf(stdout,"%7d %11.4f %10.4f %9.4f %9.4f %7.4f %8.4f %10ld %15lld %11.4f %8.4f\n",thread_count,
+			(add_total_time*1000.0)/Frame_Count,add_max_time*1000.0,flip_x_time*1000.0,
+			flip_y_time*1000.0,mean_time*1000.0,noise_time*1000.0,page_faults,tlb_misses,
+			(two_pass_time*1000.0)/Frame_Count,(strip_time*1000.0)/Frame_Count);
+	}
+	if(!Detector_Buffer_Thread_Pool_Stop())
+	{
+		Detector_General_Error();
+		return 9;
+	}
+	if(!Detector_Buffer_Free())
+	{
+		Detector_General_Error();
+		return 10;
+	}
+	if(tlb_fd >= 0)
+		close(tlb_fd);
+	free(Frame_Grabber_Image);
+	return 0;
+}
+
+/* ------------------------------------------------------------------
+**          Internal functions
+** ------------------------------------------------------------------ */
+/**
+ * Routine to parse command line arguments.
+ * @param argc The number of arguments sent to the program.
+ * @param argv An array of argument strings.
+ * @see #Help
+ * @see #Log_Level
+ * @see #Size_X
+ * @see #Size_Y
+ * @see #Frame_Count
+ * @see #Max_Thread_Count
+ * @see #Core_List
+ * @see #Core_Count
+ * @see #Noise_Type
+ * @see #Use_Huge_Pages
+ * @see #Lock_Memory
+ * @see #Strip_Row_Count
+ */
+static int Parse_Arguments(int argc, char *argv[])
+{
+	char *token = NULL;
+	int i,retval;
+
+	for(i=1;i<argc;i++)
+	{
+		if((strcmp(argv[i],"-cores")==0))
+		{
+			if((i+1)<argc)
+			{
+				Core_Count = 0;
+				token = strtok(argv[i+1],",");
+				while((token != NULL)&&(Core_Count < DETECTOR_BUFFER_MAX_THREAD_COUNT))
+				{
+					retval = sscanf(token,"%d",&(Core_List[Core_Count]));
+					if(retval != 1)
+					{
+						fprintf(stderr,"Parse_Arguments:Failed to parse core '%s'.\n",token);
+						return FALSE;
+					}
+					Core_Count++;
+					token = strtok(NULL,",");
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:-cores requires a comma separated list of CPU cores.\n");
+				return FALSE;
+			}
+		}
+		else if((strcmp(argv[i],"-f")==0)||(strcmp(argv[i],"-frames")==0))
+		{
+			if((i+1)<argc)
+			{
+				retval = sscanf(argv[i+1],"%d",&Frame_Count);
+				if(retval != 1)
+				{
+					fprintf(stderr,"Parse_Arguments:Failed to parse frame count %s.\n",argv[i+1]);
+					return FALSE;
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:-frames requires a number of frames.\n");
+				return FALSE;
+			}
+		}
+		else if((strcmp(argv[i],"-huge_pages")==0))
+		{
+			Use_Huge_Pages = TRUE;
+		}
+		else if((strcmp(argv[i],"-help")==0))
+		{
+			Help();
+			return FALSE;
+		}
+		else if((strcmp(argv[i],"-l")==0)||(strcmp(argv[i],"-log_level")==0))
+		{
+			if((i+1)<argc)
+			{
+				retval = sscanf(argv[i+1],"%d",&Log_Level);
+				if(retval != 1)
+				{
+					fprintf(stderr,"Parse_Arguments:Failed to parse log level %s.\n",argv[i+1]);
+					return FALSE;
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:-log_level requires a number 0..5.\n");
+				return FALSE;
+			}
+		}
+		else if((strcmp(argv[i],"-lock")==0))
+		{
+			Lock_Memory = TRUE;
+		}
+		else if((strcmp(argv[i],"-noise")==0))
+		{
+			if((i+1)<argc)
+			{
+				if(strcmp(argv[i+1],"none")==0)
+					Noise_Type = DETECTOR_BUFFER_NOISE_TYPE_NONE;
+				else if(strcmp(argv[i+1],"variance")==0)
+					Noise_Type = DETECTOR_BUFFER_NOISE_TYPE_VARIANCE;
+				else if(strcmp(argv[i+1],"standard_error")==0)
+					Noise_Type = DETECTOR_BUFFER_NOISE_TYPE_STANDARD_ERROR;
+				else
+				{
+					fprintf(stderr,"Parse_Arguments:-noise requires one of 'none', 'variance' or "
+						"'standard_error' as an argument.\n");
+					return FALSE;
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:-noise requires one of 'none', 'variance' or "
+					"'standard_error' as an argument.\n");
+				return FALSE;
+			}
+		}
+		else if((strcmp(argv[i],"-size")==0))
+		{
+			if((i+2)<argc)
+			{
+				retval = sscanf(argv[i+1],"%d",&Size_X);
+				if(retval != 1)
+				{
+					fprintf(stderr,"Parse_Arguments:Failed to parse size X %s.\n",argv[i+1]);
+					return FALSE;
+				}
+				retval = sscanf(argv[i+2],"%d",&Size_Y);
+				if(retval != 1)
+				{
+					fprintf(stderr,"Parse_Arguments:Failed to parse size Y %s.\n",argv[i+2]);
+					return FALSE;
+				}
+				i+= 2;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:-size requires an X and Y size in pixels.\n");
+				return FALSE;
+			}
+		}
+		else if((strcmp(argv[i],"-strip_rows")==0))
+		{
+			if((i+1)<argc)
+			{
+				retval = sscanf(argv[i+1],"%d",&Strip_Row_Count);
+				if(retval != 1)
+				{
+					fprintf(stderr,"Parse_Arguments:Failed to parse strip row count %s.\n",argv[i+1]);
+					return FALSE;
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:-strip_rows requires a number of rows.\n");
+				return FALSE;
+			}
+		}
+		else if((strcmp(argv[i],"-t")==0)||(strcmp(argv[i],"-threads")==0))
+		{
+			if((i+1)<argc)
+			{
+				retval = sscanf(argv[i+1],"%d",&Max_Thread_Count);
+				if(retval != 1)
+				{
+					fprintf(stderr,"Parse_Arguments:Failed to parse maximum thread count %s.\n",argv[i+1]);
+					return FALSE;
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:-threads requires a maximum thread count.\n");
+				return FALSE;
+			}
+		}
+		else
+		{
+			fprintf(stderr,"Parse_Arguments:argument '%s' not recognized.\n",argv[i]);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/**
+ * Help routine.
+ */
+static void Help(void)
+{
+	fprintf(stdout,"Test Buffer Benchmark:Help.\n");
+	fprintf(stdout,"This program benchmarks the detector_buffer pixel kernels against the number of threads.\n");
+	fprintf(stdout,"detector_test_buffer_benchmark [-help][-l|-log_level <0..5>][-size <x> <y>]\n");
+	fprintf(stdout,"\t[-f|-frames <n>][-t|-threads <max thread count>][-cores <n,n,...>]\n");
+	fprintf(stdout,"\t[-noise <none|variance|standard_error>][-huge_pages][-lock][-strip_rows <n>]\n");
+	fprintf(stdout,"\n");
+	fprintf(stdout,"\t-frames is the number of frames (coadds) to add for each thread count.\n");
+	fprintf(stdout,"\t-threads is the maximum number of threads to benchmark, each count from 1 up to this is run.\n");
+	fprintf(stdout,"\t-cores is a comma separated list of CPU cores to pin the worker threads to.\n");
+	fprintf(stdout,"\t-huge_pages allocates the image buffers using 2 MB huge pages.\n");
+	fprintf(stdout,"\t-lock locks the image buffers into RAM.\n");
+	fprintf(stdout,"\t-strip_rows is the number of rows in each strip for the strip readout benchmark.\n");
+}
+
+/**
+ * Time reading out Frame_Count frames from the synthetic frame grabber buffer and accumulating them into
+ * the coadd image. The readout itself is simulated with memcpy, which is what pxd_readushort does 
+ * from the frame grabber's memory.
+ * <ul>
+ * <li>We initialise the coadd image.
+ * <li>If use_strips is FALSE, for each frame we copy the whole of Frame_Grabber_Image into the mono image,
+ *     and then call Detector_Buffer_Add_Mono_To_Coadd_Image (the two-pass readout).
+ * <li>If use_strips is TRUE, for each frame we copy Frame_Grabber_Image into the strip image 
+ *     Strip_Row_Count rows at a time, calling Detector_Buffer_Add_Strip_To_Coadd_Image after each strip.
+ * </ul>
+ * @param use_strips A boolean, whether to benchmark the strip readout (TRUE) or the two-pass readout (FALSE).
+ * @param readout_time The address of a double, on return filled in with the total time taken 
+ *        to read out and accumulate all the frames, in seconds.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Frame_Grabber_Image
+ * @see #Frame_Count
+ * @see #Strip_Row_Count
+ * @see ../cdocs/detector_buffer.html#Detector_Buffer_Initialise_Coadd_Image
+ * @see ../cdocs/detector_buffer.html#Detector_Buffer_Get_Mono_Image
+ * @see ../cdocs/detector_buffer.html#Detector_Buffer_Add_Mono_To_Coadd_Image
+ * @see ../cdocs/detector_buffer.html#Detector_Buffer_Get_Strip_Image
+ * @see ../cdocs/detector_buffer.html#Detector_Buffer_Add_Strip_To_Coadd_Image
+ * @see ../cdocs/detector_general.html#fdifftime
+ */
+static int Readout_Benchmark(int use_strips,double *readout_time)
+{
+	struct timespec start_time,end_time;
+	int i,start_row,row_count;
+
+	if(!Detector_Buffer_Initialise_Coadd_Image(Frame_Count))
+	{
+		Detector_General_Error();
+		return FALSE;
+	}
+	clock_gettime(CLOCK_MONOTONIC,&start_time);
+	for(i = 0; i < Frame_Count; i++)
+	{
+		if(use_strips)
+		{
+			for(start_row = 0; start_row < Size_Y; start_row += Strip_Row_Count)
+			{
+				row_count = Strip_Row_Count;
+				if((start_row+row_count) > Size_Y)
+					row_count = Size_Y-start_row;
+				memcpy(Detector_Buffer_Get_Strip_Image(),Frame_Grabber_Image+(start_row*Size_X),
+				       row_count*Size_X*sizeof(unsigned short));
+				if(!Detector_Buffer_Add_Strip_To_Coadd_Image(start_row,row_count))
+				{
+					Detector_General_Error();
+					return FALSE;
+				}
+			}
+		}
+		else
+		{
+			memcpy(Detector_Buffer_Get_Mono_Image(),Frame_Grabber_Image,Size_X*Size_Y*sizeof(unsigned short));
+			if(!Detector_Buffer_Add_Mono_To_Coadd_Image())
+			{
+				Detector_General_Error();
+				return FALSE;
+			}
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC,&end_time);
+	(*readout_time) = fdifftime(end_time,start_time);
+	return TRUE;
+}
+
+/**
+ * Open a performance counter counting data TLB read misses for this process, using perf_event_open.
+ * @return The counter's file descriptor, or -1 if the counter could not be opened 
+ *         (for instance, if perf events are not supported or permitted).
+ */
+static int TLB_Miss_Counter_Open(void)
+{
+	struct perf_event_attr attr;
+
+	memset(&attr,0,sizeof(struct perf_event_attr));
+	attr.size = sizeof(struct perf_event_attr);
+	attr.type = PERF_TYPE_HW_CACHE;
+	attr.config = PERF_COUNT_HW_CACHE_DTLB|(PERF_COUNT_HW_CACHE_OP_READ << 8)|
+		(PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.inherit = 1;
+	return (int)syscall(__NR_perf_event_open,&attr,0,-1,-1,0);
+}
+
+/**
+ * Read the current value of the data TLB miss counter.
+ * @param fd The counter's file descriptor, returned by TLB_Miss_Counter_Open.
+ * @return The number of data TLB misses counted so far, or -1 if the counter could not be read.
+ */
+static long long TLB_Miss_Counter_Read(int fd)
+{
+	long long count;
+
+	if(fd < 0)
+		return -1;
+	if(read(fd,&count,sizeof(long long)) != sizeof(long long))
+		return -1;
+	return count;
+}
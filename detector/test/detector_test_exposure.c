@@ -15,6 +15,7 @@
 #include "detector_exposure.h"
 #include "detector_fits_filename.h"
 #include "detector_fits_header.h"
+#include "detector_grabber.h"
 #include "detector_setup.h"
 #include "detector_temperature.h"
 #include "detector_general.h"
@@ -81,6 +82,16 @@ static char FITS_Directory[STRING_LENGTH] = DEFAULT_FITS_DIRECTORY;
  * Whether to turn the Raptor Nonox-640 fan on.
  */
 static int Fan_Enable = TRUE;
+/**
+ * Which sort of noise image (if any) to write as an extension alongside the mean image.
+ * @see ../cdocs/detector_buffer.html#DETECTOR_BUFFER_NOISE_TYPE
+ */
+static enum DETECTOR_BUFFER_NOISE_TYPE Noise_Type = DETECTOR_BUFFER_NOISE_TYPE_NONE;
+/**
+ * Which frame grabber backend to use, the real frame grabber (XCLIB) or the simulator.
+ * @see ../cdocs/detector_grabber.html#DETECTOR_GRABBER_BACKEND
+ */
+static enum DETECTOR_GRABBER_BACKEND Grabber_Backend = DETECTOR_GRABBER_BACKEND_XCLIB;
 
 /* internal functions */
 static int Parse_Arguments(int argc, char *argv[]);
@@ -102,6 +113,9 @@ static void Help(void);
  * @see #FITS_Directory
  * @see #FITS_Filename
  * @see #Fan_Enable
+ * @see #Noise_Type
+ * @see #Grabber_Backend
+ * @see ../cdocs/detector_buffer.html#Detector_Buffer_Noise_Type_Set
  * @see ../cdocs/detector_exposure.html#Detector_Exposure_Set_Coadd_Frame_Exposure_Length
  * @see ../cdocs/detector_exposure.html#Detector_Exposure_Expose
  * @see ../cdocs/detector_fits_filename.html#Detector_Fits_Filename_Initialise
@@ -118,6 +132,7 @@ static void Help(void);
  * @see ../cdocs/detector_general.html#Detector_General_Set_Log_Handler_Function
  * @see ../cdocs/detector_general.html#Detector_General_Log_Handler_Stdout
  * @see ../cdocs/detector_general.html#Detector_General_Error
+ * @see ../cdocs/detector_grabber.html#Detector_Grabber_Backend_Set
  * @see ../cdocs/detector_setup.html#Detector_Setup_Startup
  * @see ../cdocs/detector_setup.html#Detector_Setup_Shutdown
  * @see ../cdocs/detector_temperature.html#Detector_Temperature_Set_Fan
@@ -133,6 +148,12 @@ int main(int argc, char *argv[])
 	Detector_General_Set_Log_Filter_Level(Log_Level);
 	Detector_General_Set_Log_Filter_Function(Detector_General_Log_Filter_Level_Absolute);
 	Detector_General_Set_Log_Handler_Function(Detector_General_Log_Handler_Stdout);
+	/* select the frame grabber backend */
+	if(!Detector_Grabber_Backend_Set(Grabber_Backend))
+	{
+		Detector_General_Error();
+		return 13;
+	}
 	/* create format filename and setup detector */
 	fprintf(stdout,"detector_test_exposure : Initialising Detector.\n");
 	sprintf(format_filename,"%s/rap_%dms.fmt",FMT_Directory,Coadd_Frame_Exposure_Length_Ms);
@@ -189,6 +210,13 @@ int main(int argc, char *argv[])
 		Detector_General_Error();
 		return 11;
 	}
+	/* setup noise image */
+	fprintf(stdout,"detector_test_exposure : Setting noise image type to %d.\n",Noise_Type);
+	if(!Detector_Buffer_Noise_Type_Set(Noise_Type))
+	{
+		Detector_General_Error();
+		return 12;
+	}
 	/* do exposure */
 	fprintf(stdout,"detector_test_exposure : Taking exposure of length %d ms and saving to '%s'.\n",Exposure_Length_Ms,FITS_Filename);
 	if(!Detector_Exposure_Expose(Exposure_Length_Ms,FITS_Filename))
@@ -222,6 +250,8 @@ int main(int argc, char *argv[])
  * @see #FITS_Filename
  * @see #FMT_Directory
  * @see #Log_Level
+ * @see #Noise_Type
+ * @see #Grabber_Backend
  */
 static int Parse_Arguments(int argc, char *argv[])
 {
@@ -351,6 +381,35 @@ static int Parse_Arguments(int argc, char *argv[])
 				return FALSE;
 			}
 		}
+		else if((strcmp(argv[i],"-noise")==0))
+		{
+			if((i+1)<argc)
+			{
+				if(strcmp(argv[i+1],"none")==0)
+					Noise_Type = DETECTOR_BUFFER_NOISE_TYPE_NONE;
+				else if(strcmp(argv[i+1],"variance")==0)
+					Noise_Type = DETECTOR_BUFFER_NOISE_TYPE_VARIANCE;
+				else if(strcmp(argv[i+1],"standard_error")==0)
+					Noise_Type = DETECTOR_BUFFER_NOISE_TYPE_STANDARD_ERROR;
+				else
+				{
+					fprintf(stderr,"Parse_Arguments:-noise requires one of 'none', 'variance' or "
+						"'standard_error' as an argument.\n");
+					return FALSE;
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:-noise requires one of 'none', 'variance' or "
+					"'standard_error' as an argument.\n");
+				return FALSE;
+			}
+		}
+		else if((strcmp(argv[i],"-sim")==0)||(strcmp(argv[i],"-simulator")==0))
+		{
+			Grabber_Backend = DETECTOR_GRABBER_BACKEND_SIMULATOR;
+		}
 		else
 		{
 			fprintf(stderr,"Parse_Arguments:argument '%s' not recognized.\n",argv[i]);
@@ -369,7 +428,8 @@ static void Help(void)
 	fprintf(stdout,"This program takes a series of coadd frames to create an individual exposure using the Raptor Ninox-640 IR detector.\n");
 	fprintf(stdout,"detector_test_exposure -e[posure_length] <ms> [-coadd[_exposure_length] <ms>]\n");
 	fprintf(stdout,"\t[-fan <on|off>][-fmt[_directory] <dir>][-fits_dir[ectory] <dir>][-fits_file[name] <filename>]\n");
-	fprintf(stdout,"\t[-help][-l[og_level <0..5>].\n");
+	fprintf(stdout,"\t[-help][-l[og_level <0..5>][-noise <none|variance|standard_error>]\n");
+	fprintf(stdout,"\t[-sim[ulator]].\n");
 	fprintf(stdout,"\n");
 	fprintf(stdout,"The FITS image to save the data into can specified as a filename (-fits_filename),\n");
 	fprintf(stdout,"or automatically created in LT format by specifying a directory(-fits_directory).\n");
@@ -378,4 +438,6 @@ static void Help(void)
 		DEFAULT_COADD_FRAME_EXPOSURE_LENGTH);
 	fprintf(stdout,"in the directory specified by -fmt_directory (default '%s')\n",DEFAULT_FMT_DIRECTORY);
 	fprintf(stdout,"-fan turns the Ninox-640 fan on or off.\n");
+	fprintf(stdout,"-noise adds a per-pixel variance or standard error image extension (needs more than one coadd).\n");
+	fprintf(stdout,"-simulator uses a simulated frame grabber and camera head instead of the real hardware.\n");
 }
@@ -0,0 +1,423 @@
+/* detector_test_log_benchmark.c */
+/**
+ * Test program to benchmark the overhead the detector library logging adds to Detector_Exposure_Expose.
+ * The simulated frame grabber is used, so no detector or frame grabber is needed.
+ * For each run time log filter level from 0 to the maximum, we take a series of exposures and report the number of
+ * log messages generated per exposure, and how much longer each exposure took than its nominal exposure length.
+ * We also time calls to Detector_General_Log_Format that are filtered out, to measure the cost of a
+ * suppressed message. The compiled in logging is fixed by the LOGGING level the library was compiled with;
+ * the 'log_benchmark' target in the Makefile builds this program against the library compiled at several LOGGING
+ * levels, so the programs can be run in turn to compare them.
+ * @author Chris Mottram
+ * @version $Id$
+ */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "log_udp.h"
+
+#include "detector_exposure.h"
+#include "detector_fits_header.h"
+#include "detector_general.h"
+#include "detector_grabber.h"
+#include "detector_setup.h"
+
+/* hash defines */
+/**
+ * Length of some of the strings used in this program.
+ */
+#define STRING_LENGTH                       (256)
+/**
+ * The default exposure length to use for each individual coadd, in milliseconds.
+ * This determines the '.fmt' filename, which the simulated frame grabber uses to derive its field period.
+ */
+#define DEFAULT_COADD_FRAME_EXPOSURE_LENGTH (10)
+/**
+ * The default exposure length, in milliseconds.
+ */
+#define DEFAULT_EXPOSURE_LENGTH             (100)
+/**
+ * The default number of exposures to take at each log filter level.
+ */
+#define DEFAULT_EXPOSURE_COUNT              (20)
+/**
+ * The default maximum log filter level to benchmark.
+ */
+#define DEFAULT_MAX_LOG_LEVEL               (LOG_VERBOSITY_VERY_VERBOSE)
+/**
+ * The number of filtered out Detector_General_Log_Format calls to time.
+ */
+#define SUPPRESSED_CALL_COUNT               (1000000)
+/**
+ * The default FITS filename to save each exposure into (it is deleted before each exposure).
+ */
+#define DEFAULT_FITS_FILENAME               ("/tmp/detector_test_log_benchmark.fits")
+
+/* internal variables */
+/**
+ * Revision Control System identifier.
+ */
+static char rcsid[] = "$Id$";
+/**
+ * The exposure length to use for each individual coadd, in milliseconds.
+ * @see #DEFAULT_COADD_FRAME_EXPOSURE_LENGTH
+ */
+static int Coadd_Frame_Exposure_Length_Ms = DEFAULT_COADD_FRAME_EXPOSURE_LENGTH;
+/**
+ * The exposure length to use for each exposure, in milliseconds.
+ * @see #DEFAULT_EXPOSURE_LENGTH
+ */
+static int Exposure_Length_Ms = DEFAULT_EXPOSURE_LENGTH;
+/**
+ * The number of exposures to take at each log filter level.
+ * @see #DEFAULT_EXPOSURE_COUNT
+ */
+static int Exposure_Count = DEFAULT_EXPOSURE_COUNT;
+/**
+ * The maximum log filter level to benchmark. Each level from 0 to this is benchmarked.
+ * @see #DEFAULT_MAX_LOG_LEVEL
+ */
+static int Max_Log_Level = DEFAULT_MAX_LOG_LEVEL;
+/**
+ * The filename to save each exposure into.
+ * @see #STRING_LENGTH
+ * @see #DEFAULT_FITS_FILENAME
+ */
+static char FITS_Filename[STRING_LENGTH] = DEFAULT_FITS_FILENAME;
+/**
+ * The number of messages passed to Log_Handler_Count.
+ */
+static int Log_Message_Count = 0;
+/**
+ * The total length of the messages passed to Log_Handler_Count.
+ */
+static long Log_Message_Length = 0;
+
+/* internal functions */
+static int Parse_Arguments(int argc, char *argv[]);
+static void Help(void);
+static void Log_Handler_Count(int level,char *string);
+static int Exposure_Benchmark(int log_level);
+static void Suppressed_Benchmark(void);
+
+/* ------------------------------------------------------------------
+**          External functions
+** ------------------------------------------------------------------ */
+/**
+ * Main program.
+ * <ul>
+ * <li>We parse the arguments.
+ * <li>We install Log_Handler_Count as the log handler, so messages are counted but not written anywhere,
+ *     and Detector_General_Log_Filter_Level_Absolute as the log filter.
+ * <li>We select the simulated frame grabber, and start up the detector using a format filename derived from
+ *     Coadd_Frame_Exposure_Length_Ms.
+ * <li>We initialise the FITS headers and set the coadd frame exposure length.
+ * <li>We call Suppressed_Benchmark.
+ * <li>We call Exposure_Benchmark for each log filter level from 0 to Max_Log_Level.
+ * <li>We shutdown the detector.
+ * </ul>
+ * @param argc The number of arguments to the program.
+ * @param argv An array of argument strings.
+ * @see #STRING_LENGTH
+ * @see #Parse_Arguments
+ * @see #Log_Handler_Count
+ * @see #Suppressed_Benchmark
+ * @see #Exposure_Benchmark
+ * @see #Coadd_Frame_Exposure_Length_Ms
+ * @see #Max_Log_Level
+ * @see ../cdocs/detector_exposure.html#Detector_Exposure_Set_Coadd_Frame_Exposure_Length
+ * @see ../cdocs/detector_fits_header.html#Detector_Fits_Header_Initialise
+ * @see ../cdocs/detector_general.html#Detector_General_Log_Compile_Level_Get
+ * @see ../cdocs/detector_general.html#Detector_General_Set_Log_Filter_Function
+ * @see ../cdocs/detector_general.html#Detector_General_Log_Filter_Level_Absolute
+ * @see ../cdocs/detector_general.html#Detector_General_Set_Log_Handler_Function
+ * @see ../cdocs/detector_general.html#Detector_General_Error
+ * @see ../cdocs/detector_grabber.html#Detector_Grabber_Backend_Set
+ * @see ../cdocs/detector_setup.html#Detector_Setup_Startup
+ * @see ../cdocs/detector_setup.html#Detector_Setup_Shutdown
+ */
+int main(int argc, char *argv[])
+{
+	char format_filename[STRING_LENGTH];
+	int log_level;
+
+	/* parse arguments */
+	if(!Parse_Arguments(argc,argv))
+		return 1;
+	Detector_General_Set_Log_Filter_Level(LOG_VERBOSITY_VERY_TERSE);
+	Detector_General_Set_Log_Filter_Function(Detector_General_Log_Filter_Level_Absolute);
+	Detector_General_Set_Log_Handler_Function(Log_Handler_Count);
+	/* setup the simulated detector */
+	if(!Detector_Grabber_Backend_Set(DETECTOR_GRABBER_BACKEND_SIMULATOR))
+	{
+		Detector_General_Error();
+		return 2;
+	}
+	sprintf(format_filename,"rap_%dms.fmt",Coadd_Frame_Exposure_Length_Ms);
+	if(!Detector_Setup_Startup(format_filename))
+	{
+		Detector_General_Error();
+		return 3;
+	}
+	if(!Detector_Fits_Header_Initialise())
+	{
+		Detector_General_Error();
+		return 4;
+	}
+	if(!Detector_Exposure_Set_Coadd_Frame_Exposure_Length(Coadd_Frame_Exposure_Length_Ms))
+	{
+		Detector_General_Error();
+		return 5;
+	}
+	fprintf(stdout,"detector_test_log_benchmark : Library compiled with LOGGING=%d, %d exposures of %d ms "
+		"(%d ms coadds) per log level.\n",Detector_General_Log_Compile_Level_Get(),Exposure_Count,
+		Exposure_Length_Ms,Coadd_Frame_Exposure_Length_Ms);
+	Suppressed_Benchmark();
+	for(log_level = 0; log_level <= Max_Log_Level; log_level++)
+	{
+		if(!Exposure_Benchmark(log_level))
+		{
+			Detector_General_Error();
+			return 6;
+		}
+	}
+	if(!Detector_Setup_Shutdown())
+	{
+		Detector_General_Error();
+		return 7;
+	}
+	unlink(FITS_Filename);
+	return 0;
+}
+
+/* ------------------------------------------------------------------
+**          Internal functions
+** ------------------------------------------------------------------ */
+/**
+ * Log handler that counts the messages passed to it (and their total length), without writing them anywhere,
+ * so we measure the cost of generating the log messages rather than the cost of the I/O.
+ * @param level The log level for this message.
+ * @param string The log message.
+ * @see #Log_Message_Count
+ * @see #Log_Message_Length
+ */
+static void Log_Handler_Count(int level,char *string)
+{
+	Log_Message_Count++;
+	Log_Message_Length += strlen(string);
+}
+
+/**
+ * Take Exposure_Count exposures with the log filter level set to log_level, and report the number of log
+ * messages per exposure, and the mean, minimum and maximum time each exposure took over its nominal length.
+ * The FITS file is deleted before each exposure (outside the timed section).
+ * @param log_level The log filter level to use.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Exposure_Count
+ * @see #Exposure_Length_Ms
+ * @see #FITS_Filename
+ * @see #Log_Message_Count
+ * @see #Log_Message_Length
+ * @see ../cdocs/detector_exposure.html#Detector_Exposure_Expose
+ * @see ../cdocs/detector_general.html#Detector_General_Set_Log_Filter_Level
+ */
+static int Exposure_Benchmark(int log_level)
+{
+	struct timespec start_time,end_time;
+	double overhead_ms,total_ms,min_ms,max_ms;
+	int i;
+
+	Detector_General_Set_Log_Filter_Level(log_level);
+	Log_Message_Count = 0;
+	Log_Message_Length = 0;
+	total_ms = 0.0;
+	min_ms = 0.0;
+	max_ms = 0.0;
+	for(i = 0; i < Exposure_Count; i++)
+	{
+		unlink(FITS_Filename);
+		clock_gettime(CLOCK_MONOTONIC,&start_time);
+		if(!Detector_Exposure_Expose(Exposure_Length_Ms,FITS_Filename))
+			return FALSE;
+		clock_gettime(CLOCK_MONOTONIC,&end_time);
+		overhead_ms = (fdifftime(end_time,start_time)*DETECTOR_GENERAL_ONE_SECOND_MS)-Exposure_Length_Ms;
+		total_ms += overhead_ms;
+		if((i == 0)||(overhead_ms < min_ms))
+			min_ms = overhead_ms;
+		if((i == 0)||(overhead_ms > max_ms))
+			max_ms = overhead_ms;
+	}
+	Detector_General_Set_Log_Filter_Level(LOG_VERBOSITY_VERY_TERSE);
+	fprintf(stdout,"LOGGING=%d log_level=%d messages/exposure=%.1f bytes/exposure=%.0f "
+		"overhead mean=%.3f min=%.3f max=%.3f ms\n",Detector_General_Log_Compile_Level_Get(),log_level,
+		((double)Log_Message_Count)/((double)Exposure_Count),((double)Log_Message_Length)/((double)Exposure_Count),
+		total_ms/((double)Exposure_Count),min_ms,max_ms);
+	return TRUE;
+}
+
+/**
+ * Time SUPPRESSED_CALL_COUNT calls to Detector_General_Log_Format, at a level above the log filter level,
+ * with a format string typical of the coadd loop messages. Reports the mean time per call in nanoseconds.
+ * @see #SUPPRESSED_CALL_COUNT
+ * @see ../cdocs/detector_general.html#Detector_General_Log_Format
+ * @see ../cdocs/detector_general.html#Detector_General_Set_Log_Filter_Level
+ */
+static void Suppressed_Benchmark(void)
+{
+	struct timespec start_time,end_time;
+	int i;
+
+	Detector_General_Set_Log_Filter_Level(LOG_VERBOSITY_VERY_TERSE);
+	Log_Message_Count = 0;
+	clock_gettime(CLOCK_MONOTONIC,&start_time);
+	for(i = 0; i < SUPPRESSED_CALL_COUNT; i++)
+	{
+		Detector_General_Log_Format(LOG_VERBOSITY_VERY_VERBOSE,
+					    "Detector_Exposure_Expose:Coadd %d of %d:Field count %lu, buffer %ld, %.3f ms.",
+					    i,SUPPRESSED_CALL_COUNT,(unsigned long)i,(long)(i%2),((double)i)/1000.0);
+	}
+	clock_gettime(CLOCK_MONOTONIC,&end_time);
+	fprintf(stdout,"LOGGING=%d suppressed Detector_General_Log_Format %.1f ns/call (%d messages logged)\n",
+		Detector_General_Log_Compile_Level_Get(),
+		(fdifftime(end_time,start_time)*DETECTOR_GENERAL_ONE_SECOND_NS)/((double)SUPPRESSED_CALL_COUNT),
+		Log_Message_Count);
+}
+
+/**
+ * Routine to parse command line arguments.
+ * @param argc The number of arguments sent to the program.
+ * @param argv An array of argument strings.
+ * @see #STRING_LENGTH
+ * @see #Coadd_Frame_Exposure_Length_Ms
+ * @see #Exposure_Length_Ms
+ * @see #Exposure_Count
+ * @see #Max_Log_Level
+ * @see #FITS_Filename
+ */
+static int Parse_Arguments(int argc, char *argv[])
+{
+	int i,retval;
+
+	for(i=1;i<argc;i++)
+	{
+		if((strcmp(argv[i],"-coadd")==0)||(strcmp(argv[i],"-coadd_exposure_length")==0))
+		{
+			if((i+1)<argc)
+			{
+				retval = sscanf(argv[i+1],"%d",&Coadd_Frame_Exposure_Length_Ms);
+				if(retval != 1)
+				{
+					fprintf(stderr,"Parse_Arguments:Failed to parse coadd exposure length %s.\n",argv[i+1]);
+					return FALSE;
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:-coadd_exposure_length requires an exposure length in milliseconds.\n");
+				return FALSE;
+			}
+		}
+		else if((strcmp(argv[i],"-c")==0)||(strcmp(argv[i],"-count")==0))
+		{
+			if((i+1)<argc)
+			{
+				retval = sscanf(argv[i+1],"%d",&Exposure_Count);
+				if((retval != 1)||(Exposure_Count < 1))
+				{
+					fprintf(stderr,"Parse_Arguments:Failed to parse exposure count %s.\n",argv[i+1]);
+					return FALSE;
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:-count requires a number of exposures.\n");
+				return FALSE;
+			}
+		}
+		else if((strcmp(argv[i],"-e")==0)||(strcmp(argv[i],"-exposure_length")==0))
+		{
+			if((i+1)<argc)
+			{
+				retval = sscanf(argv[i+1],"%d",&Exposure_Length_Ms);
+				if(retval != 1)
+				{
+					fprintf(stderr,"Parse_Arguments:Failed to parse exposure length %s.\n",argv[i+1]);
+					return FALSE;
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:-exposure_length requires an exposure length in milliseconds.\n");
+				return FALSE;
+			}
+		}
+		else if((strcmp(argv[i],"-fits_file")==0)||(strcmp(argv[i],"-fits_filename")==0))
+		{
+			if((i+1)<argc)
+			{
+				strncpy(FITS_Filename,argv[i+1],STRING_LENGTH-1);
+				FITS_Filename[STRING_LENGTH-1] = '\0';
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:fits_filename requires a file name.\n");
+				return FALSE;
+			}
+		}
+		else if((strcmp(argv[i],"-help")==0))
+		{
+			Help();
+			return FALSE;
+		}
+		else if((strcmp(argv[i],"-l")==0)||(strcmp(argv[i],"-max_log_level")==0))
+		{
+			if((i+1)<argc)
+			{
+				retval = sscanf(argv[i+1],"%d",&Max_Log_Level);
+				if(retval != 1)
+				{
+					fprintf(stderr,"Parse_Arguments:Failed to parse maximum log level %s.\n",argv[i+1]);
+					return FALSE;
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:-max_log_level requires a number 0..5.\n");
+				return FALSE;
+			}
+		}
+		else
+		{
+			fprintf(stderr,"Parse_Arguments:argument '%s' not recognized.\n",argv[i]);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/**
+ * Help routine.
+ */
+static void Help(void)
+{
+	fprintf(stdout,"Detector Test Log Benchmark:Help.\n");
+	fprintf(stdout,"This program measures the overhead the detector library logging adds to each exposure, "
+		"using the simulated frame grabber.\n");
+	fprintf(stdout,"detector_test_log_benchmark [-coadd[_exposure_length] <ms>][-c[ount] <n>]\n");
+	fprintf(stdout,"\t[-e[xposure_length] <ms>][-fits_file[name] <filename>][-help][-l|-max_log_level <0..5>].\n");
+	fprintf(stdout,"\n");
+	fprintf(stdout,"Each log filter level from 0 to -max_log_level (default %d) is benchmarked in turn,\n",
+		DEFAULT_MAX_LOG_LEVEL);
+	fprintf(stdout,"taking -count (default %d) exposures of -exposure_length (default %d) ms.\n",
+		DEFAULT_EXPOSURE_COUNT,DEFAULT_EXPOSURE_LENGTH);
+	fprintf(stdout,"Log messages are counted but not written anywhere.\n");
+	fprintf(stdout,"Build with 'make log_benchmark' to get a copy of this program for each LOGGING compile level.\n");
+}
@@ -0,0 +1,453 @@
+/* detector_test_telemetry.c */
+/**
+ * Test program to test the background telemetry sampler, which samples the Raptor Ninox-640 camera head
+ * temperatures and FPGA status from a separate thread.
+ * @author Chris Mottram
+ * @version $Id$
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "log_udp.h"
+
+#include "detector_setup.h"
+#include "detector_general.h"
+#include "detector_serial.h"
+#include "detector_telemetry.h"
+#include "detector_temperature.h"
+
+/* hash defines */
+/**
+ * Length of some of the strings used in this program.
+ */
+#define STRING_LENGTH                       (256)
+/**
+ * The default exposure length to use for each individual coadd, in milliseconds.
+ * This also determines the '.fmt' to configure the detector with.
+ */
+#define DEFAULT_COADD_FRAME_EXPOSURE_LENGTH (1000)
+/**
+ * The default directory containing the '.fmt' format files to use to configure the detector.
+ */
+#define DEFAULT_FMT_DIRECTORY               ("/icc/bin/liric/fmt")
+/**
+ * The default telemetry sampling period, in milliseconds.
+ */
+#define DEFAULT_PERIOD_MS                   (1000)
+/**
+ * The default length of time to run the telemetry sampler for, in seconds.
+ */
+#define DEFAULT_RUN_LENGTH_S                (10)
+/**
+ * The default number of history points to retrieve at the end of the test.
+ */
+#define DEFAULT_POINT_COUNT                 (5)
+
+/* internal variables */
+/**
+ * Revision Control System identifier.
+ */
+static char rcsid[] = "$Id$";
+/**
+ * Verbosity log level : initialised to LOG_VERBOSITY_VERY_VERBOSE.
+ */
+static int Log_Level = LOG_VERBOSITY_VERY_VERBOSE;
+/**
+ * The exposure length to use for each individual coadd, in milliseconds.
+ * This also determines the '.fmt' to configure the detector with.
+ * @see #DEFAULT_COADD_FRAME_EXPOSURE_LENGTH
+ */
+static int Coadd_Frame_Exposure_Length_Ms = DEFAULT_COADD_FRAME_EXPOSURE_LENGTH;
+
+/**
+ * The directory containing the '.fmt' format files to use to configure the detector.
+ * @see #STRING_LENGTH
+ * @see #DEFAULT_FMT_DIRECTORY
+ */
+static char FMT_Directory[STRING_LENGTH] = DEFAULT_FMT_DIRECTORY;
+/**
+ * Whether to turn the Raptor Nonox-640 fan on.
+ */
+static int Fan_Enable = TRUE;
+/**
+ * The telemetry sampling period, in milliseconds.
+ * @see #DEFAULT_PERIOD_MS
+ */
+static int Period_Ms = DEFAULT_PERIOD_MS;
+/**
+ * The length of time to run the telemetry sampler for, in seconds.
+ * @see #DEFAULT_RUN_LENGTH_S
+ */
+static int Run_Length_S = DEFAULT_RUN_LENGTH_S;
+/**
+ * The number of history points to retrieve at the end of the test.
+ * @see #DEFAULT_POINT_COUNT
+ */
+static int Point_Count = DEFAULT_POINT_COUNT;
+
+/* internal functions */
+static int Parse_Arguments(int argc, char *argv[]);
+static void Help(void);
+static void Sample_Print(char *prefix,struct Detector_Telemetry_Sample_Struct *sample);
+
+/* ------------------------------------------------------------------
+**          External functions 
+** ------------------------------------------------------------------ */
+/**
+ * Main program.
+ * <ul>
+ * <li>We parse the arguments using Parse_Arguments, and setup the detector library logging.
+ * <li>We open a connection to the detector using Detector_Setup_Open, with a format filename constructed from
+ *     FMT_Directory and Coadd_Frame_Exposure_Length_Ms.
+ * <li>We initialise the serial connection (and temperature calibration) using Detector_Serial_Initialise.
+ * <li>We turn the fan on or off using Detector_Temperature_Set_Fan.
+ * <li>We start the telemetry sampler using Detector_Telemetry_Start, sampling every Period_Ms, and keeping
+ *     Run_Length_S seconds of history.
+ * <li>Once a second for Run_Length_S seconds, we print the latest sample (Detector_Telemetry_Latest_Get).
+ * <li>We print the sampler statistics (Detector_Telemetry_Statistics_Get), and the history downsampled to
+ *     Point_Count points (Detector_Telemetry_History_Get).
+ * <li>We stop the sampler using Detector_Telemetry_Stop, and close the connection using Detector_Setup_Close.
+ * </ul>
+ * @param argc The number of arguments to the program.
+ * @param argv An array of argument strings.
+ * @return This function returns 0 if the program succeeds, and a positive integer if it fails.
+ * @see #Parse_Arguments
+ * @see #Sample_Print
+ * @see #Log_Level
+ * @see #FMT_Directory
+ * @see #Coadd_Frame_Exposure_Length_Ms
+ * @see #Fan_Enable
+ * @see #Period_Ms
+ * @see #Run_Length_S
+ * @see #Point_Count
+ * @see ../cdocs/detector_general.html#Detector_General_Set_Log_Filter_Level
+ * @see ../cdocs/detector_general.html#Detector_General_Set_Log_Filter_Function
+ * @see ../cdocs/detector_general.html#Detector_General_Log_Filter_Level_Absolute
+ * @see ../cdocs/detector_general.html#Detector_General_Set_Log_Handler_Function
+ * @see ../cdocs/detector_general.html#Detector_General_Log_Handler_Stdout
+ * @see ../cdocs/detector_general.html#Detector_General_Error
+ * @see ../cdocs/detector_setup.html#Detector_Setup_Open
+ * @see ../cdocs/detector_setup.html#Detector_Setup_Close
+ * @see ../cdocs/detector_serial.html#Detector_Serial_Initialise
+ * @see ../cdocs/detector_temperature.html#Detector_Temperature_Set_Fan
+ * @see ../cdocs/detector_telemetry.html#Detector_Telemetry_Start
+ * @see ../cdocs/detector_telemetry.html#Detector_Telemetry_Stop
+ * @see ../cdocs/detector_telemetry.html#Detector_Telemetry_Latest_Get
+ * @see ../cdocs/detector_telemetry.html#Detector_Telemetry_History_Get
+ * @see ../cdocs/detector_telemetry.html#Detector_Telemetry_Statistics_Get
+ */
+int main(int argc, char *argv[])
+{
+	struct Detector_Telemetry_Sample_Struct sample;
+	struct Detector_Telemetry_Sample_Struct *point_list = NULL;
+	char format_filename[STRING_LENGTH];
+	unsigned int sample_count,failure_count;
+	double age_s;
+	int i,period_ms,returned_point_count;
+
+	/* parse arguments */
+	fprintf(stdout,"detector_test_telemetry : Parsing Arguments.\n");
+	if(!Parse_Arguments(argc,argv))
+		return 1;
+	Detector_General_Set_Log_Filter_Level(Log_Level);
+	Detector_General_Set_Log_Filter_Function(Detector_General_Log_Filter_Level_Absolute);
+	Detector_General_Set_Log_Handler_Function(Detector_General_Log_Handler_Stdout);
+	/* create format filename and setup connection to the detector/ XCLIB library */
+	fprintf(stdout,"detector_test_telemetry : Initialising Detector library.\n");
+	sprintf(format_filename,"%s/rap_%dms.fmt",FMT_Directory,Coadd_Frame_Exposure_Length_Ms);
+	if(!Detector_Setup_Open("","",format_filename))
+	{
+		Detector_General_Error();
+		return 3;
+	}
+	/* initialise the serial connection. The library connection has to be already open to do this */
+	if(!Detector_Serial_Initialise())
+	{
+		Detector_General_Error();
+		Detector_Setup_Close();
+		return 3;
+	}
+	fprintf(stdout,"detector_test_telemetry : Setting fan to '%s'.\n",Fan_Enable ? "On" : "Off");
+	if(!Detector_Temperature_Set_Fan(Fan_Enable))
+	{
+		Detector_General_Error();
+		Detector_Setup_Close();
+		return 3;
+	}
+	/* start the telemetry sampler */
+	fprintf(stdout,"detector_test_telemetry : Starting telemetry sampler every %d ms for %d s.\n",
+		Period_Ms,Run_Length_S);
+	if(!Detector_Telemetry_Start(Period_Ms,Run_Length_S))
+	{
+		Detector_General_Error();
+		Detector_Setup_Close();
+		return 4;
+	}
+	/* print the latest sample once a second */
+	for(i = 0; i < Run_Length_S; i++)
+	{
+		sleep(1);
+		if(Detector_Telemetry_Latest_Get(&sample,&age_s))
+		{
+			fprintf(stdout,"detector_test_telemetry : Latest sample (%.3f s old) : ",age_s);
+			Sample_Print("",&sample);
+		}
+		else
+			Detector_General_Error();
+	}
+	/* statistics and history */
+	Detector_Telemetry_Statistics_Get(&period_ms,&sample_count,&failure_count);
+	fprintf(stdout,"detector_test_telemetry : Period %d ms, %u samples, %u failures.\n",period_ms,
+		sample_count,failure_count);
+	point_list = (struct Detector_Telemetry_Sample_Struct *)malloc(Point_Count*
+								       sizeof(struct Detector_Telemetry_Sample_Struct));
+	if(point_list == NULL)
+	{
+		fprintf(stderr,"detector_test_telemetry : Failed to allocate %d history points.\n",Point_Count);
+		Detector_Telemetry_Stop();
+		Detector_Setup_Close();
+		return 5;
+	}
+	if(Detector_Telemetry_History_Get(Run_Length_S,Point_Count,point_list,&returned_point_count))
+	{
+		fprintf(stdout,"detector_test_telemetry : History has %d points.\n",returned_point_count);
+		for(i = 0; i < returned_point_count; i++)
+		{
+			fprintf(stdout,"detector_test_telemetry : Point %d (%d samples) : ",i,point_list[i].Sample_Count);
+			Sample_Print("",&(point_list[i]));
+		}
+	}
+	else
+		Detector_General_Error();
+	free(point_list);
+	/* stop the sampler */
+	fprintf(stdout,"detector_test_telemetry : Stopping telemetry sampler.\n");
+	if(!Detector_Telemetry_Stop())
+	{
+		Detector_General_Error();
+		Detector_Setup_Close();
+		return 4;
+	}
+	/* close the connection to the serial port/ XCLIB library */
+	if(!Detector_Setup_Close())
+	{
+		Detector_General_Error();
+		return 3;
+	}
+	fprintf(stdout,"detector_test_telemetry : Finished.\n");
+	return 0;
+}
+
+/* ------------------------------------------------------------------
+**          Internal functions 
+** ------------------------------------------------------------------ */
+/**
+ * Print a telemetry sample (or history point) to stdout. Fields that were not read successfully are printed as
+ * "unknown".
+ * @param prefix A string to print before the sample.
+ * @param sample The sample to print.
+ * @see ../cdocs/detector_telemetry.html#DETECTOR_TELEMETRY_VALID_SENSOR_TEMPERATURE
+ * @see ../cdocs/detector_telemetry.html#DETECTOR_TELEMETRY_VALID_PCB_TEMPERATURE
+ * @see ../cdocs/detector_telemetry.html#DETECTOR_TELEMETRY_VALID_TEC_SETPOINT
+ * @see ../cdocs/detector_telemetry.html#DETECTOR_TELEMETRY_VALID_FPGA_STATUS
+ */
+static void Sample_Print(char *prefix,struct Detector_Telemetry_Sample_Struct *sample)
+{
+	fprintf(stdout,"%s",prefix);
+	if(sample->Valid_Mask & DETECTOR_TELEMETRY_VALID_SENSOR_TEMPERATURE)
+		fprintf(stdout,"sensor=%.2f C ",sample->Sensor_Temperature_C);
+	else
+		fprintf(stdout,"sensor=unknown ");
+	if(sample->Valid_Mask & DETECTOR_TELEMETRY_VALID_PCB_TEMPERATURE)
+		fprintf(stdout,"pcb=%.2f C ",sample->PCB_Temperature_C);
+	else
+		fprintf(stdout,"pcb=unknown ");
+	if(sample->Valid_Mask & DETECTOR_TELEMETRY_VALID_TEC_SETPOINT)
+		fprintf(stdout,"tec_setpoint=%.2f C ",sample->TEC_Setpoint_C);
+	else
+		fprintf(stdout,"tec_setpoint=unknown ");
+	if(sample->Valid_Mask & DETECTOR_TELEMETRY_VALID_FPGA_STATUS)
+		fprintf(stdout,"fpga_status=0x%02x\n",sample->FPGA_Status);
+	else
+		fprintf(stdout,"fpga_status=unknown\n");
+}
+
+/**
+ * Routine to parse command line arguments.
+ * @param argc The number of arguments sent to the program.
+ * @param argv An array of argument strings.
+ * @see #STRING_LENGTH
+ * @see #Coadd_Frame_Exposure_Length_Ms
+ * @see #FMT_Directory
+ * @see #Fan_Enable
+ * @see #Period_Ms
+ * @see #Run_Length_S
+ * @see #Point_Count
+ * @see #Log_Level
+ */
+static int Parse_Arguments(int argc, char *argv[])
+{
+	int i,retval;
+
+	for(i=1;i<argc;i++)
+	{
+		if((strcmp(argv[i],"-coadd")==0)||(strcmp(argv[i],"-coadd_exposure_length")==0))
+		{
+			if((i+1)<argc)
+			{
+				retval = sscanf(argv[i+1],"%d",&Coadd_Frame_Exposure_Length_Ms);
+				if(retval != 1)
+				{
+					fprintf(stderr,"Parse_Arguments:Failed to parse coadd exposure length %s.\n",argv[i+1]);
+					return FALSE;
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:-coadd_exposure_length requires an exposure length in milliseconds (for which a valid .fmt file exists).\n");
+				return FALSE;
+			}
+		}
+		else if(strcmp(argv[i],"-fan")==0)
+		{
+			if((i+1)<argc)
+			{
+				if(strcmp(argv[i+1],"on") == 0)
+					Fan_Enable = TRUE;
+				else if(strcmp(argv[i+1],"off") == 0)
+					Fan_Enable = FALSE;
+				else
+				{
+					fprintf(stderr,"Parse_Arguments:Illegal fan value %s (on|off).\n",argv[i+1]);
+					return FALSE;
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:-fan requires on or off.\n");
+				return FALSE;
+			}
+		}
+		else if((strcmp(argv[i],"-fmt")==0)||(strcmp(argv[i],"-fmt_directory")==0))
+		{
+			if((i+1)<argc)
+			{
+				strncpy(FMT_Directory,argv[i+1],STRING_LENGTH-1);
+				FMT_Directory[STRING_LENGTH-1] = '\0';
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:fmt_directory requires a directory path name.\n");
+				return FALSE;
+			}
+		}
+		else if((strcmp(argv[i],"-help")==0))
+		{
+			Help();
+			return FALSE;
+		}
+		else if((strcmp(argv[i],"-l")==0)||(strcmp(argv[i],"-log_level")==0))
+		{
+			if((i+1)<argc)
+			{
+				retval = sscanf(argv[i+1],"%d",&Log_Level);
+				if(retval != 1)
+				{
+					fprintf(stderr,"Parse_Arguments:Failed to parse log level %s.\n",argv[i+1]);
+					return FALSE;
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:-log_level requires a number 0..5.\n");
+				return FALSE;
+			}
+		}
+		else if(strcmp(argv[i],"-period")==0)
+		{
+			if((i+1)<argc)
+			{
+				retval = sscanf(argv[i+1],"%d",&Period_Ms);
+				if(retval != 1)
+				{
+					fprintf(stderr,"Parse_Arguments:Failed to parse period %s.\n",argv[i+1]);
+					return FALSE;
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:-period requires a sampling period in milliseconds.\n");
+				return FALSE;
+			}
+		}
+		else if(strcmp(argv[i],"-points")==0)
+		{
+			if((i+1)<argc)
+			{
+				retval = sscanf(argv[i+1],"%d",&Point_Count);
+				if((retval != 1)||(Point_Count < 1))
+				{
+					fprintf(stderr,"Parse_Arguments:Failed to parse point count %s.\n",argv[i+1]);
+					return FALSE;
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:-points requires a number of history points.\n");
+				return FALSE;
+			}
+		}
+		else if(strcmp(argv[i],"-run_length")==0)
+		{
+			if((i+1)<argc)
+			{
+				retval = sscanf(argv[i+1],"%d",&Run_Length_S);
+				if((retval != 1)||(Run_Length_S < 1))
+				{
+					fprintf(stderr,"Parse_Arguments:Failed to parse run length %s.\n",argv[i+1]);
+					return FALSE;
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:-run_length requires a length of time in seconds.\n");
+				return FALSE;
+			}
+		}
+		else
+		{
+			fprintf(stderr,"Parse_Arguments:argument '%s' not recognized.\n",argv[i]);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/**
+ * Help routine.
+ */
+static void Help(void)
+{
+	fprintf(stdout,"Detector Test Telemetry:Help.\n");
+	fprintf(stdout,"This program tests the background telemetry sampler, which samples the Raptor Ninox-640 camera head temperatures and FPGA status.\n");
+	fprintf(stdout,"detector_test_telemetry [-coadd[_exposure_length] <ms>][-fmt[_directory] <dir>]\n");
+	fprintf(stdout,"\t[-fan <on|off>][-period <ms>][-run_length <s>][-points <n>][-help][-l[og_level <0..5>].\n");
+	fprintf(stdout,"The exposure length of an individual coadd is specified in milliseconds (-coadd_exposure_length),\n");
+	fprintf(stdout,"this defaults to %d, a valid '.fmt' file for that exposure length must exist \n",
+		DEFAULT_COADD_FRAME_EXPOSURE_LENGTH);
+	fprintf(stdout,"The -coadd_exposure_length / -fmt_directory arguments are needed to construct a valid '.fmt. filename, which is needed to open a connection to the XCLIB library.\n");
+	fprintf(stdout,"The sampler runs every -period milliseconds (default %d) for -run_length seconds (default %d), printing the latest sample once a second.\n",
+		DEFAULT_PERIOD_MS,DEFAULT_RUN_LENGTH_S);
+	fprintf(stdout,"The history is then printed, downsampled to -points points (default %d).\n",DEFAULT_POINT_COUNT);
+}
@@ -221,13 +221,16 @@ void Filter_Wheel_General_Get_Current_Time_String(char *time_string,int string_l
 
 /**
  * Routine to log a message to a defined logging mechanism. This routine has an arbitary number of arguments,
- * and uses vsprintf to format them i.e. like fprintf. 
+ * and uses vsnprintf to format them i.e. like fprintf. 
  * Filter_Wheel_General_Log is then called to handle the log message.
+ * We first call Filter_Wheel_General_Log_Level_Enabled, and return without formatting the message if it
+ * would be filtered out anyway, so suppressed messages cost a function call and a comparison.
  * @param level An integer, used to decide whether this particular message has been selected for
  * 	logging or not.
  * @param format A string, with formatting statements the same as fprintf would use to determine the type
  * 	of the following arguments.
  * @see #Filter_Wheel_General_Log
+ * @see #Filter_Wheel_General_Log_Level_Enabled
  * @see #LOG_BUFF_LENGTH
  */
 void Filter_Wheel_General_Log_Format(int level,char *format,...)
@@ -235,9 +238,12 @@ void Filter_Wheel_General_Log_Format(int level,char *format,...)
 	char buff[LOG_BUFF_LENGTH];
 	va_list ap;
 
+/* don't format messages that will be filtered out */
+	if(!Filter_Wheel_General_Log_Level_Enabled(level))
+		return;
 /* format the arguments */
 	va_start(ap,format);
-	vsprintf(buff,format,ap);
+	vsnprintf(buff,LOG_BUFF_LENGTH,format,ap);
 	va_end(ap);
 /* call the log routine to log the results */
 	Filter_Wheel_General_Log(level,buff);
@@ -270,6 +276,31 @@ void Filter_Wheel_General_Log(int level,char *string)
 	(*General_Data.Log_Handler)(level,string);
 }
 
+/**
+ * Routine to decide whether a message at the specified level would be logged, without needing the message itself.
+ * A message is not logged if there is no General_Data.Log_Handler. If General_Data.Log_Filter is one of the
+ * level only filters (Filter_Wheel_General_Log_Filter_Level_Absolute or Filter_Wheel_General_Log_Filter_Level_Bitwise), 
+ * we call it with a NULL string, as they don't look at the message. Any other filter may look at the message
+ * text, so we assume the message may be logged.
+ * @param level An integer, the log level of the message.
+ * @return The routine returns TRUE if a message at this level may be logged, and FALSE if it will be
+ *         filtered out.
+ * @see #General_Data
+ * @see #Filter_Wheel_General_Log_Filter_Level_Absolute
+ * @see #Filter_Wheel_General_Log_Filter_Level_Bitwise
+ */
+int Filter_Wheel_General_Log_Level_Enabled(int level)
+{
+	if(General_Data.Log_Handler == NULL)
+		return FALSE;
+	if((General_Data.Log_Filter == Filter_Wheel_General_Log_Filter_Level_Absolute)||
+	   (General_Data.Log_Filter == Filter_Wheel_General_Log_Filter_Level_Bitwise))
+	{
+		return General_Data.Log_Filter(level,NULL);
+	}
+	return TRUE;
+}
+
 /**
  * Routine to set the General_Data.Log_Handler used by Filter_Wheel_General_Log.
  * @param log_fn A function pointer to a suitable handler.
@@ -66,6 +66,7 @@ extern void Filter_Wheel_General_Get_Current_Time_String(char *time_string,int s
 
 extern void Filter_Wheel_General_Log_Format(int level,char *format,...);
 extern void Filter_Wheel_General_Log(int level,char *string);
+extern int Filter_Wheel_General_Log_Level_Enabled(int level);
 extern void Filter_Wheel_General_Set_Log_Handler_Function(void (*log_fn)(int level,char *string));
 extern void Filter_Wheel_General_Set_Log_Filter_Function(int (*filter_fn)(int level,char *string));
 extern void Filter_Wheel_General_Log_Handler_Stdout(int level,char *string);
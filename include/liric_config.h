@@ -2,8 +2,82 @@
 #ifndef LIRIC_CONFIG_H
 #define LIRIC_CONFIG_H
 
+/* hash defines */
+/**
+ * The maximum length of the detector format directory held in the config cache.
+ */
+#define LIRIC_CONFIG_FORMAT_DIR_LENGTH			(256)
+/**
+ * The maximum length of a coadd exposure length name (the &lt;name&gt; in
+ * "detector.coadd_exposure_length.&lt;name&gt;").
+ */
+#define LIRIC_CONFIG_COADD_EXPOSURE_LENGTH_NAME_LENGTH	(16)
+/**
+ * The maximum number of coadd exposure lengths held in the config cache.
+ */
+#define LIRIC_CONFIG_COADD_EXPOSURE_LENGTH_COUNT	(4)
+
+/* data types */
+/**
+ * Structure holding a named coadd exposure length, "detector.coadd_exposure_length.&lt;name&gt;".
+ * <dl>
+ * <dt>Name</dt> <dd>The name, i.e. "short", "long" or "bias".</dd>
+ * <dt>Length</dt> <dd>The coadd exposure length, in milliseconds.</dd>
+ * </dl>
+ * @see #LIRIC_CONFIG_COADD_EXPOSURE_LENGTH_NAME_LENGTH
+ */
+struct Liric_Config_Coadd_Exposure_Length_Struct
+{
+	char Name[LIRIC_CONFIG_COADD_EXPOSURE_LENGTH_NAME_LENGTH];
+	int Length;
+};
+
+/**
+ * Structure holding the typed configuration values read on hot paths (per command, per multrun or per frame).
+ * These are parsed and range checked once when the config file is loaded or reloaded, rather than being looked
+ * up by keyword each time they are used.
+ * <dl>
+ * <dt>Generation</dt> <dd>The number of times the config has been successfully loaded / reloaded.</dd>
+ * <dt>Detector_Enable</dt> <dd>A boolean, "detector.enable".</dd>
+ * <dt>Nudgematic_Enable</dt> <dd>A boolean, "nudgematic.enable".</dd>
+ * <dt>Filter_Wheel_Enable</dt> <dd>A boolean, "filter_wheel.enable".</dd>
+ * <dt>Multrun_Image_Flip_X</dt> <dd>A boolean, "liric.multrun.image.flip.x".</dd>
+ * <dt>Multrun_Image_Flip_Y</dt> <dd>A boolean, "liric.multrun.image.flip.y".</dd>
+ * <dt>Thread_Priority_Normal</dt> <dd>The SCHED_FIFO priority of normal command threads, 
+ *     "thread.priority.normal".</dd>
+ * <dt>Thread_Priority_Exposure</dt> <dd>The SCHED_FIFO priority of exposure command threads, 
+ *     "thread.priority.exposure".</dd>
+ * <dt>Detector_Format_Dir</dt> <dd>The directory containing the detector '.fmt' format files, 
+ *     "detector.format_dir". Only set if the detector is enabled.</dd>
+ * <dt>Coadd_Exposure_Length_Count</dt> <dd>The number of coadd exposure lengths in Coadd_Exposure_Length_List.</dd>
+ * <dt>Coadd_Exposure_Length_List</dt> <dd>The configured coadd exposure lengths, 
+ *     "detector.coadd_exposure_length.&lt;name&gt;". Only set if the detector is enabled.</dd>
+ * </dl>
+ * @see #LIRIC_CONFIG_FORMAT_DIR_LENGTH
+ * @see #LIRIC_CONFIG_COADD_EXPOSURE_LENGTH_COUNT
+ * @see #Liric_Config_Coadd_Exposure_Length_Struct
+ */
+struct Liric_Config_Cache_Struct
+{
+	int Generation;
+	int Detector_Enable;
+	int Nudgematic_Enable;
+	int Filter_Wheel_Enable;
+	int Multrun_Image_Flip_X;
+	int Multrun_Image_Flip_Y;
+	int Thread_Priority_Normal;
+	int Thread_Priority_Exposure;
+	char Detector_Format_Dir[LIRIC_CONFIG_FORMAT_DIR_LENGTH];
+	int Coadd_Exposure_Length_Count;
+	struct Liric_Config_Coadd_Exposure_Length_Struct Coadd_Exposure_Length_List[LIRIC_CONFIG_COADD_EXPOSURE_LENGTH_COUNT];
+};
+
 extern int Liric_Config_Load(char *filename);
+extern int Liric_Config_Reload(void);
 extern int Liric_Config_Shutdown(void);
+extern void Liric_Config_Cache_Get(struct Liric_Config_Cache_Struct *cache);
+extern int Liric_Config_Watch_Start(void);
+extern int Liric_Config_Watch_Stop(void);
 extern int Liric_Config_Get_String(char *key, char **value);
 extern int Liric_Config_Get_Character(char *key, char *value);
 extern int Liric_Config_Get_Integer(char *key, int *i);
@@ -4,6 +4,8 @@
 #define LIRIC_GENERAL_H
 
 #include <pthread.h>
+#include <stdarg.h>
+#include <stddef.h> /* size_t */
 
 /* hash defines */
 /**
@@ -70,9 +72,35 @@
 #define fdifftime(t1, t0) (((double)(((t1).tv_sec)-((t0).tv_sec))+(double)(((t1).tv_nsec)-((t0).tv_nsec))/LIRIC_GENERAL_ONE_SECOND_NS))
 #endif
 
+/* data types */
+/**
+ * Structure used to build a string (i.e. a command reply) by appending to it. The string is built in a buffer
+ * supplied by the caller (normally on the stack), and only moved to a heap allocated buffer if it grows too long
+ * for it. The heap buffer doubles in size each time it fills, so building a long string does not reallocate and
+ * copy it on every append.
+ * <dl>
+ * <dt>Buffer</dt> <dd>The buffer the string is being built in, either Initial_Buffer or a heap allocated buffer.</dd>
+ * <dt>Buffer_Length</dt> <dd>The length of Buffer, in bytes.</dd>
+ * <dt>Head_Room</dt> <dd>The number of bytes reserved at the start of Buffer, before the string, so a prefix
+ *     (i.e. reply framing) can be added later without copying the string.</dd>
+ * <dt>Length</dt> <dd>The length of the string (excluding the NULL terminator), starting at Buffer+Head_Room.</dd>
+ * <dt>Initial_Buffer</dt> <dd>The buffer supplied by the caller.</dd>
+ * <dt>Is_Allocated</dt> <dd>A boolean, TRUE if Buffer has been allocated on the heap (and must be freed).</dd>
+ * </dl>
+ */
+struct Liric_General_String_Builder_Struct
+{
+	char *Buffer;
+	size_t Buffer_Length;
+	size_t Head_Room;
+	size_t Length;
+	char *Initial_Buffer;
+	int Is_Allocated;
+};
+
 /* external variabless */
-extern int Liric_General_Error_Number;
-extern char Liric_General_Error_String[];
+extern __thread int Liric_General_Error_Number;
+extern __thread char Liric_General_Error_String[];
 
 /* external functions */
 extern void Liric_General_Error(char *sub_system,char *source_filename,char *function,int level,char *category);
@@ -93,6 +121,8 @@ extern void Liric_General_Call_Log_Handlers(char *sub_system,char *source_filena
 extern void Liric_General_Call_Log_Handlers_Detector(int level,char *message);
 extern void Liric_General_Call_Log_Handlers_Filter_Wheel(int level,char *message);
 extern void Liric_General_Call_Log_Handlers_Nudgematic(int level,char *message);
+extern void Liric_General_Log_Binary(char *sub_system,int level,char *format,va_list ap);
+extern void Liric_General_Call_Log_Binary_Detector(int level,char *format,va_list ap);
 extern int Liric_General_Add_Log_Handler_Function(void (*log_fn)(char *sub_system,char *source_filename,
 							char *function,int level,char *category,char *message));
 extern void Liric_General_Set_Log_Filter_Function(int (*filter_fn)(char *sub_system,char *source_filename,
@@ -109,6 +139,9 @@ extern void Liric_General_Log_Handler_Log_Hourly_File(char *sub_system,char *sou
 							   int level,char *category,char *message);
 extern void Liric_General_Log_Handler_Log_UDP(char *sub_system,char *source_filename,char *function,
 						   int level,char *category,char *message);
+extern int Liric_General_Log_Async_Start(void);
+extern int Liric_General_Log_Async_Stop(void);
+extern int Liric_General_Log_Async_Statistics_Get(unsigned int *written_count,unsigned int *dropped_count);
 extern void Liric_General_Set_Log_Filter_Level(int level);
 extern int Liric_General_Log_Filter_Level_Absolute(char *sub_system,char *source_filename,char *function,
 							int level,char *category,char *message);
@@ -118,6 +151,17 @@ extern int Liric_General_Log_Filter_Level_Bitwise(char *sub_system,char *source_
 /* utility routines */
 extern int Liric_General_Add_String(char **string,char *add);
 extern int Liric_General_Add_Integer_To_String(char **string,int i);
+extern void Liric_General_String_Builder_Initialise(struct Liric_General_String_Builder_Struct *builder,
+						    char *buffer,size_t buffer_length,size_t head_room);
+extern int Liric_General_String_Builder_Add(struct Liric_General_String_Builder_Struct *builder,char *add);
+extern int Liric_General_String_Builder_Add_Integer(struct Liric_General_String_Builder_Struct *builder,int i);
+extern int Liric_General_String_Builder_Add_Format(struct Liric_General_String_Builder_Struct *builder,
+						   char *format,...);
+extern char *Liric_General_String_Builder_Get(struct Liric_General_String_Builder_Struct *builder);
+extern size_t Liric_General_String_Builder_Length_Get(struct Liric_General_String_Builder_Struct *builder);
+extern char *Liric_General_String_Builder_Prefix(struct Liric_General_String_Builder_Struct *builder,
+						 char *prefix);
+extern void Liric_General_String_Builder_Free(struct Liric_General_String_Builder_Struct *builder);
 extern int Liric_General_Int_List_Add(int add,int **list,int *count);
 extern int Liric_General_Int_List_Sort(const void *f,const void *s);
 extern int Liric_General_Mutex_Lock(pthread_mutex_t *mutex);
@@ -0,0 +1,131 @@
+/* liric_job.h */
+#ifndef LIRIC_JOB_H
+#define LIRIC_JOB_H
+#include <time.h> /* struct timespec */
+
+/* hash defines */
+/**
+ * The number of jobs whose status and frames are kept. Submitting a new job replaces the oldest finished one.
+ */
+#define LIRIC_JOB_MAX_COUNT			(16)
+/**
+ * The length of the FITS filename in a job frame record.
+ */
+#define LIRIC_JOB_FILENAME_LENGTH		(256)
+/**
+ * The length of the error string stored for a failed job.
+ */
+#define LIRIC_JOB_ERROR_STRING_LENGTH		(256)
+/**
+ * The maximum time a client can wait for new frames in one call to Liric_Job_Frames_Get, in milliseconds.
+ */
+#define LIRIC_JOB_MAX_WAIT_MS			(60000)
+
+/* enums */
+/**
+ * Enum of the types of job.
+ * <ul>
+ * <li>LIRIC_JOB_TYPE_MULTRUN
+ * <li>LIRIC_JOB_TYPE_MULTBIAS
+ * <li>LIRIC_JOB_TYPE_MULTDARK
+ * </ul>
+ */
+enum LIRIC_JOB_TYPE
+{
+	LIRIC_JOB_TYPE_MULTRUN=0,LIRIC_JOB_TYPE_MULTBIAS,LIRIC_JOB_TYPE_MULTDARK
+};
+
+/**
+ * Enum of the states a job can be in.
+ * <ul>
+ * <li>LIRIC_JOB_STATE_QUEUED - the job has been submitted, but it's thread has not started it yet.
+ * <li>LIRIC_JOB_STATE_RUNNING - the job is taking frames.
+ * <li>LIRIC_JOB_STATE_DONE - the job completed successfully.
+ * <li>LIRIC_JOB_STATE_FAILED - the job failed, the job's error string says why.
+ * <li>LIRIC_JOB_STATE_ABORTED - the job was aborted.
+ * </ul>
+ */
+enum LIRIC_JOB_STATE
+{
+	LIRIC_JOB_STATE_QUEUED=0,LIRIC_JOB_STATE_RUNNING,LIRIC_JOB_STATE_DONE,LIRIC_JOB_STATE_FAILED,
+	LIRIC_JOB_STATE_ABORTED
+};
+
+/**
+ * Macro to check whether the job state has finished (it will not produce any more frames).
+ */
+#define LIRIC_JOB_STATE_IS_FINISHED(state)	(((state) == LIRIC_JOB_STATE_DONE)||\
+						 ((state) == LIRIC_JOB_STATE_FAILED)||\
+						 ((state) == LIRIC_JOB_STATE_ABORTED))
+
+/* data types */
+/**
+ * Structure holding the status of a job:
+ * <dl>
+ * <dt>Id</dt> <dd>The job id.</dd>
+ * <dt>Type</dt> <dd>The type of job.</dd>
+ * <dt>State</dt> <dd>The state of the job.</dd>
+ * <dt>Exposure_Length_Ms</dt> <dd>The exposure length of each frame, in milliseconds (0 for a multbias).</dd>
+ * <dt>Exposure_Count</dt> <dd>The number of frames the job will take.</dd>
+ * <dt>Frame_Count</dt> <dd>The number of frames saved so far.</dd>
+ * <dt>Multrun_Number</dt> <dd>The multrun number of the job's FITS filenames, or -1 if no frames have been
+ *     saved yet.</dd>
+ * <dt>Submit_Time</dt> <dd>The time the job was submitted.</dd>
+ * <dt>End_Time</dt> <dd>The time the job finished, or {0,0} if it is still in progress.</dd>
+ * <dt>Error_String</dt> <dd>Why the job failed (if the job state is LIRIC_JOB_STATE_FAILED or
+ *     LIRIC_JOB_STATE_ABORTED), otherwise an empty string.</dd>
+ * </dl>
+ * @see #LIRIC_JOB_TYPE
+ * @see #LIRIC_JOB_STATE
+ * @see #LIRIC_JOB_ERROR_STRING_LENGTH
+ */
+struct Liric_Job_Status_Struct
+{
+	int Id;
+	enum LIRIC_JOB_TYPE Type;
+	enum LIRIC_JOB_STATE State;
+	int Exposure_Length_Ms;
+	int Exposure_Count;
+	int Frame_Count;
+	int Multrun_Number;
+	struct timespec Submit_Time;
+	struct timespec End_Time;
+	char Error_String[LIRIC_JOB_ERROR_STRING_LENGTH];
+};
+
+/**
+ * Structure holding one frame saved by a job:
+ * <dl>
+ * <dt>Index</dt> <dd>The index of the frame in the job, starting at 0.</dd>
+ * <dt>Filename</dt> <dd>The FITS filename the frame was saved to.</dd>
+ * <dt>Saved_Time</dt> <dd>The time the frame was saved.</dd>
+ * <dt>Frame_Length_Ms</dt> <dd>The time taken for this frame, from the previous frame being saved (or the job
+ *     starting, for the first frame) to this one being saved, in milliseconds. This includes any mechanism moves
+ *     and FITS header setup, as well as the exposure and readout.</dd>
+ * </dl>
+ * @see #LIRIC_JOB_FILENAME_LENGTH
+ */
+struct Liric_Job_Frame_Struct
+{
+	int Index;
+	char Filename[LIRIC_JOB_FILENAME_LENGTH];
+	struct timespec Saved_Time;
+	double Frame_Length_Ms;
+};
+
+extern int Liric_Job_Submit(enum LIRIC_JOB_TYPE type,int exposure_length_ms,int exposure_count,int do_standard,
+			    int *job_id);
+extern int Liric_Job_Abort(int job_id);
+extern int Liric_Job_In_Progress(void);
+extern int Liric_Job_Detector_Claim(void);
+extern void Liric_Job_Detector_Release(void);
+extern int Liric_Job_Detector_Claimed(void);
+extern int Liric_Job_Status_Get(int job_id,struct Liric_Job_Status_Struct *status);
+extern int Liric_Job_Frames_Get(int job_id,int first_frame_index,int timeout_ms,
+				struct Liric_Job_Frame_Struct *frame_list,int max_frame_count,int *frame_count,
+				enum LIRIC_JOB_STATE *state);
+extern void Liric_Job_Frame_Saved(char *filename);
+extern char *Liric_Job_Type_To_String(enum LIRIC_JOB_TYPE type);
+extern char *Liric_Job_State_To_String(enum LIRIC_JOB_STATE state);
+
+#endif
@@ -0,0 +1,100 @@
+/* liric_log_binary.h */
+#ifndef LIRIC_LOG_BINARY_H
+#define LIRIC_LOG_BINARY_H
+#include <stdarg.h>
+#include <stdint.h>
+#include <time.h> /* struct timespec */
+
+/* hash defines */
+/**
+ * The magic string at the start of every binary log file.
+ */
+#define LIRIC_LOG_BINARY_MAGIC			("LIRICLOG")
+/**
+ * The length of LIRIC_LOG_BINARY_MAGIC, in bytes (it is written without a NULL terminator).
+ */
+#define LIRIC_LOG_BINARY_MAGIC_LENGTH		(8)
+/**
+ * The version of the binary log format, written (as a 32 bit integer) after the magic string.
+ */
+#define LIRIC_LOG_BINARY_VERSION		(1)
+/**
+ * Record type of a message definition record. The payload is the NULL terminated sub system followed by the
+ * NULL terminated format string, for the message id in the record header. A later definition of the same message id
+ * replaces an earlier one.
+ */
+#define LIRIC_LOG_BINARY_RECORD_TYPE_DEFINE	(1)
+/**
+ * Record type of a message record. The payload is the packed arguments of the message, which is reconstructed
+ * using the format string from the message id's definition record.
+ */
+#define LIRIC_LOG_BINARY_RECORD_TYPE_MESSAGE	(2)
+/**
+ * Packed argument type tag: a 32 bit integer follows (int/short/char/unsigned conversions, and '*' widths).
+ */
+#define LIRIC_LOG_BINARY_ARG_TYPE_INT32		('i')
+/**
+ * Packed argument type tag: a 64 bit integer follows (l/ll/j/z/t integer conversions).
+ */
+#define LIRIC_LOG_BINARY_ARG_TYPE_INT64		('l')
+/**
+ * Packed argument type tag: a double follows (floating point conversions).
+ */
+#define LIRIC_LOG_BINARY_ARG_TYPE_DOUBLE	('d')
+/**
+ * Packed argument type tag: a 16 bit length followed by that many characters (no NULL terminator) follows.
+ */
+#define LIRIC_LOG_BINARY_ARG_TYPE_STRING	('s')
+/**
+ * Packed argument type tag: a pointer value, as a 64 bit integer, follows.
+ */
+#define LIRIC_LOG_BINARY_ARG_TYPE_POINTER	('p')
+/**
+ * The maximum length of the packed arguments of one message, in bytes.
+ */
+#define LIRIC_LOG_BINARY_MAX_ARGS_LENGTH	(1024)
+/**
+ * The maximum length of a packed string argument. Longer strings are truncated.
+ */
+#define LIRIC_LOG_BINARY_MAX_STRING_LENGTH	(255)
+
+/* data types */
+/**
+ * The fixed length header at the start of every binary log record (in host byte order):
+ * <dl>
+ * <dt>Length</dt> <dd>The length of the payload following this header, in bytes.</dd>
+ * <dt>Type</dt> <dd>The record type, LIRIC_LOG_BINARY_RECORD_TYPE_DEFINE or
+ *     LIRIC_LOG_BINARY_RECORD_TYPE_MESSAGE.</dd>
+ * <dt>Level</dt> <dd>The log level of the message.</dd>
+ * <dt>Arg_Count</dt> <dd>The number of packed arguments in a message record.</dd>
+ * <dt>Message_Id</dt> <dd>The message id, identifying the sub system and format string of the message.</dd>
+ * <dt>Nanoseconds</dt> <dd>The nanoseconds part of the time the message was logged.</dd>
+ * <dt>Seconds</dt> <dd>The seconds part of the time the message was logged (seconds since the epoch, UTC).</dd>
+ * </dl>
+ * @see #LIRIC_LOG_BINARY_RECORD_TYPE_DEFINE
+ * @see #LIRIC_LOG_BINARY_RECORD_TYPE_MESSAGE
+ */
+struct Liric_Log_Binary_Record_Header_Struct
+{
+	uint32_t Length;
+	uint8_t Type;
+	uint8_t Level;
+	uint16_t Arg_Count;
+	uint32_t Message_Id;
+	uint32_t Nanoseconds;
+	int64_t Seconds;
+};
+
+extern int Liric_Log_Binary_Set_Directory(char *directory);
+extern int Liric_Log_Binary_Set_Root(char *filename_root);
+extern int Liric_Log_Binary_Pack(char *format,va_list ap,char *packed_args,int packed_args_length,
+				 int *arg_count,int *packed_length);
+extern int Liric_Log_Binary_Write(struct timespec timestamp,int level,char *sub_system,char *format,
+				  int arg_count,char *packed_args,int packed_length);
+extern void Liric_Log_Binary_Flush(void);
+extern int Liric_Log_Binary_Format(char *format,int arg_count,char *packed_args,int packed_length,
+				   char *message,int message_length);
+extern int Liric_Log_Binary_Args_To_CSV(int arg_count,char *packed_args,int packed_length,
+					char *csv_string,int csv_length);
+
+#endif
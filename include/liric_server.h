@@ -2,8 +2,53 @@
 #ifndef LIRIC_SERVER_H
 #define LIRIC_SERVER_H
 
+/**
+ * The maximum number of commands Liric_Server_Statistics_Get returns statistics for.
+ */
+#define LIRIC_SERVER_MAX_COMMAND_COUNT    (16)
+/**
+ * The length of the Keyword field in Liric_Server_Command_Statistics_Struct.
+ */
+#define LIRIC_SERVER_KEYWORD_LENGTH       (16)
+/**
+ * The number of bins in each command's latency histogram. Bin i counts commands that took less than
+ * 0.1*10^i milliseconds (and at least the previous bin's upper limit); the last bin counts all commands slower
+ * than that.
+ */
+#define LIRIC_SERVER_HISTOGRAM_BIN_COUNT  (10)
+
+/**
+ * Structure holding the processing statistics of one server command:
+ * <dl>
+ * <dt>Keyword</dt> <dd>The command keyword, e.g. "multrun".</dd>
+ * <dt>Count</dt> <dd>The number of times the command has been received.</dd>
+ * <dt>Failure_Count</dt> <dd>The number of commands that failed (including failure replies and rejections).</dd>
+ * <dt>Rejected_Count</dt> <dd>The number of commands rejected because a multrun/multbias/multdark
+ *     was in progress.</dd>
+ * <dt>Min_Ms</dt> <dd>The minimum time taken to process the command and send the reply, in milliseconds.</dd>
+ * <dt>Mean_Ms</dt> <dd>The mean processing time, in milliseconds.</dd>
+ * <dt>Max_Ms</dt> <dd>The maximum processing time, in milliseconds.</dd>
+ * <dt>Histogram</dt> <dd>A histogram of processing times, see LIRIC_SERVER_HISTOGRAM_BIN_COUNT.</dd>
+ * </dl>
+ * @see #LIRIC_SERVER_KEYWORD_LENGTH
+ * @see #LIRIC_SERVER_HISTOGRAM_BIN_COUNT
+ */
+struct Liric_Server_Command_Statistics_Struct
+{
+	char Keyword[LIRIC_SERVER_KEYWORD_LENGTH];
+	unsigned int Count;
+	unsigned int Failure_Count;
+	unsigned int Rejected_Count;
+	double Min_Ms;
+	double Mean_Ms;
+	double Max_Ms;
+	unsigned int Histogram[LIRIC_SERVER_HISTOGRAM_BIN_COUNT];
+};
+
 extern int Liric_Server_Initialise(void);
 extern int Liric_Server_Start(void);
 extern int Liric_Server_Stop(void);
+extern int Liric_Server_Statistics_Get(struct Liric_Server_Command_Statistics_Struct *statistics_list,
+				       int max_count,int *statistics_count,unsigned int *unknown_count);
 
 #endif
@@ -0,0 +1,128 @@
+/* liric_shm.h */
+#ifndef LIRIC_SHM_H
+#define LIRIC_SHM_H
+#include <stdint.h>
+#include <time.h> /* struct timespec */
+
+#include "liric_state.h"
+
+/* hash defines */
+/**
+ * The magic string at the start of the shared memory region. It is written (without a NULL terminator) once
+ * the rest of the header has been filled in, so a reader that sees it knows the header is complete.
+ */
+#define LIRIC_SHM_MAGIC				("LIRICSHM")
+/**
+ * The length of LIRIC_SHM_MAGIC, in bytes.
+ */
+#define LIRIC_SHM_MAGIC_LENGTH			(8)
+/**
+ * The version of the shared memory layout. Incremented whenever Liric_Shm_Header_Struct,
+ * Liric_Shm_Frame_Struct or Liric_State_Struct change.
+ */
+#define LIRIC_SHM_VERSION			(1)
+/**
+ * The default POSIX shared memory object name.
+ */
+#define LIRIC_SHM_DEFAULT_NAME			("/liric")
+/**
+ * The maximum number of frame slots in the ring.
+ */
+#define LIRIC_SHM_MAX_FRAME_SLOT_COUNT		(64)
+/**
+ * The length of the FITS filename stored with each frame.
+ */
+#define LIRIC_SHM_FILENAME_LENGTH		(256)
+/**
+ * The alignment of each frame slot (and of the pixel data within it) in the shared memory region, in bytes.
+ */
+#define LIRIC_SHM_ALIGNMENT			(4096)
+
+/* data types */
+/**
+ * The header of one frame slot in the shared memory region. The slot's pixel data (Size_X*Size_Y doubles,
+ * the mean image saved in the FITS image) follows at Frame_Data_Offset bytes from the start of the slot.
+ * <dl>
+ * <dt>Sequence</dt> <dd>The slot's sequence lock counter. Odd whilst the writer is changing the slot.</dd>
+ * <dt>Frame_Number</dt> <dd>The number of the frame in the slot (frames are numbered from 1 when liric starts),
+ *     or 0 if the slot has not been used yet.</dd>
+ * <dt>Size_X</dt> <dd>The number of columns in the frame.</dd>
+ * <dt>Size_Y</dt> <dd>The number of rows in the frame.</dd>
+ * <dt>Exposure_Length_Ms</dt> <dd>The exposure length of the frame, in milliseconds.</dd>
+ * <dt>Coadd_Count</dt> <dd>The number of coadds in the frame.</dd>
+ * <dt>Multrun_Number</dt> <dd>The multrun number of the frame's FITS image.</dd>
+ * <dt>Run_Number</dt> <dd>The run number of the frame's FITS image.</dd>
+ * <dt>Exposure_Start_Time</dt> <dd>When the exposure started.</dd>
+ * <dt>Publish_Time</dt> <dd>When the frame was published.</dd>
+ * <dt>Minimum</dt> <dd>The minimum pixel value.</dd>
+ * <dt>Maximum</dt> <dd>The maximum pixel value.</dd>
+ * <dt>Mean</dt> <dd>The mean pixel value.</dd>
+ * <dt>Median</dt> <dd>The median pixel value.</dd>
+ * <dt>Saturated_Count</dt> <dd>The number of saturated pixels.</dd>
+ * <dt>Filename</dt> <dd>The FITS image filename the frame was saved to.</dd>
+ * </dl>
+ */
+struct Liric_Shm_Frame_Struct
+{
+	volatile uint32_t Sequence;
+	int32_t Size_X;
+	uint64_t Frame_Number;
+	int32_t Size_Y;
+	int32_t Exposure_Length_Ms;
+	int32_t Coadd_Count;
+	int32_t Multrun_Number;
+	int32_t Run_Number;
+	int32_t Saturated_Count;
+	struct timespec Exposure_Start_Time;
+	struct timespec Publish_Time;
+	double Minimum;
+	double Maximum;
+	double Mean;
+	double Median;
+	char Filename[LIRIC_SHM_FILENAME_LENGTH];
+};
+
+/**
+ * The header at the start of the shared memory region:
+ * <dl>
+ * <dt>Magic</dt> <dd>LIRIC_SHM_MAGIC, without a NULL terminator.</dd>
+ * <dt>Version</dt> <dd>LIRIC_SHM_VERSION.</dd>
+ * <dt>Writer_Pid</dt> <dd>The process id of the liric process publishing into the region.</dd>
+ * <dt>Frame_Slot_Count</dt> <dd>The number of frame slots in the ring. Frame number N is published into slot
+ *     (N-1) % Frame_Slot_Count.</dd>
+ * <dt>Frame_Max_Pixel_Count</dt> <dd>The maximum number of pixels in a frame.</dd>
+ * <dt>Region_Length</dt> <dd>The length of the region, in bytes.</dd>
+ * <dt>Frame_Slot_Offset</dt> <dd>The offset of the first frame slot from the start of the region, in bytes.</dd>
+ * <dt>Frame_Slot_Length</dt> <dd>The length of each frame slot (header plus pixel data), in bytes.</dd>
+ * <dt>Frame_Data_Offset</dt> <dd>The offset of the pixel data from the start of each frame slot, in bytes.</dd>
+ * <dt>Frame_Number</dt> <dd>The number of the last frame published, or 0 if none have been published.</dd>
+ * <dt>State_Sequence</dt> <dd>The sequence lock counter of State. Odd whilst the writer is changing it.</dd>
+ * <dt>State</dt> <dd>A copy of the published instrument state.</dd>
+ * </dl>
+ * @see #LIRIC_SHM_MAGIC
+ * @see #LIRIC_SHM_VERSION
+ * @see liric_state.html#Liric_State_Struct
+ */
+struct Liric_Shm_Header_Struct
+{
+	char Magic[LIRIC_SHM_MAGIC_LENGTH];
+	uint32_t Version;
+	int32_t Writer_Pid;
+	uint32_t Frame_Slot_Count;
+	uint32_t Frame_Max_Pixel_Count;
+	uint64_t Region_Length;
+	uint64_t Frame_Slot_Offset;
+	uint64_t Frame_Slot_Length;
+	uint64_t Frame_Data_Offset;
+	volatile uint64_t Frame_Number;
+	volatile uint32_t State_Sequence;
+	struct Liric_State_Struct State;
+};
+
+extern int Liric_Shm_Initialise(char *name,int frame_slot_count,int max_pixel_count);
+extern int Liric_Shm_Shutdown(void);
+extern int Liric_Shm_Is_Enabled(void);
+extern void Liric_Shm_State_Publish(struct Liric_State_Struct *state);
+extern int Liric_Shm_Frame_Publish(char *fits_filename);
+
+#endif
@@ -0,0 +1,39 @@
+/* liric_shm_reader.h */
+#ifndef LIRIC_SHM_READER_H
+#define LIRIC_SHM_READER_H
+#include <stddef.h>
+#include <stdint.h>
+
+#include "liric_shm.h"
+#include "liric_state.h"
+
+/* data types */
+/**
+ * Structure holding a reader's connection to the liric shared memory region:
+ * <dl>
+ * <dt>Region</dt> <dd>The mapped (read only) shared memory region, or NULL if the reader is not open.</dd>
+ * <dt>Region_Length</dt> <dd>The length of the mapped region, in bytes.</dd>
+ * <dt>Header</dt> <dd>The header at the start of the region.</dd>
+ * </dl>
+ * @see liric_shm.html#Liric_Shm_Header_Struct
+ */
+struct Liric_Shm_Reader_Struct
+{
+	void *Region;
+	size_t Region_Length;
+	struct Liric_Shm_Header_Struct *Header;
+};
+
+extern int Liric_Shm_Reader_Open(char *name,struct Liric_Shm_Reader_Struct *reader);
+extern int Liric_Shm_Reader_Close(struct Liric_Shm_Reader_Struct *reader);
+extern int Liric_Shm_Reader_State_Get(struct Liric_Shm_Reader_Struct *reader,struct Liric_State_Struct *state);
+extern uint64_t Liric_Shm_Reader_Frame_Number_Get(struct Liric_Shm_Reader_Struct *reader);
+extern int Liric_Shm_Reader_Frame_Get(struct Liric_Shm_Reader_Struct *reader,uint64_t frame_number,
+				      struct Liric_Shm_Frame_Struct **frame,double **data,uint32_t *sequence);
+extern int Liric_Shm_Reader_Frame_Is_Valid(struct Liric_Shm_Frame_Struct *frame,uint32_t sequence);
+
+extern int Liric_Shm_Reader_Get_Error_Number(void);
+extern void Liric_Shm_Reader_Error(void);
+extern void Liric_Shm_Reader_Error_String(char *error_string);
+
+#endif
@@ -0,0 +1,113 @@
+/* liric_state.h */
+#ifndef LIRIC_STATE_H
+#define LIRIC_STATE_H
+#include <time.h> /* struct timespec */
+
+/* hash defines */
+/**
+ * The maximum number of startup phases whose times are recorded.
+ */
+#define LIRIC_STATE_STARTUP_PHASE_MAX_COUNT	(16)
+/**
+ * The length of a startup phase name.
+ */
+#define LIRIC_STATE_STARTUP_PHASE_NAME_LENGTH	(32)
+
+/* declared in detector_telemetry.h. Not included here, so shared memory readers do not need the detector library */
+struct Detector_Telemetry_Sample_Struct;
+
+/**
+ * Structure holding a snapshot of the instrument state, as published by the acquisition, mechanism and telemetry
+ * threads:
+ * <dl>
+ * <dt>Version</dt> <dd>The number of times the state has been published. A reader can compare versions to see
+ *     whether anything has changed.</dd>
+ * <dt>Update_Time</dt> <dd>When the state was last published.</dd>
+ * <dt>Sequence_In_Progress</dt> <dd>A boolean, TRUE whilst a multrun, multbias or multdark is in progress.</dd>
+ * <dt>Sequence_Count</dt> <dd>The number of frames in the multrun/multbias/multdark in progress.</dd>
+ * <dt>Sequence_Index</dt> <dd>The index of the frame the multrun/multbias/multdark in progress is taking.</dd>
+ * <dt>Exposure_In_Progress</dt> <dd>A boolean, TRUE whilst an exposure (or bias) is in progress.</dd>
+ * <dt>Exposure_Length_Ms</dt> <dd>The length of the current/last exposure, in milliseconds.</dd>
+ * <dt>Exposure_Start_Time</dt> <dd>When the current/last exposure started.</dd>
+ * <dt>Coadd_Count</dt> <dd>The number of coadds in the current/last exposure.</dd>
+ * <dt>Coadd_Frame_Exposure_Length_Ms</dt> <dd>The configured exposure length of each coadd, in milliseconds.</dd>
+ * <dt>Multrun_Number</dt> <dd>The multrun number used in the FITS filenames.</dd>
+ * <dt>Run_Number</dt> <dd>The run number used in the FITS filenames.</dd>
+ * <dt>Filter_Wheel_Valid</dt> <dd>A boolean, TRUE if the filter wheel position is known.</dd>
+ * <dt>Filter_Wheel_Position</dt> <dd>The filter wheel position, 0 if it is moving.</dd>
+ * <dt>Nudgematic_Valid</dt> <dd>A boolean, TRUE if the nudgematic position is known.</dd>
+ * <dt>Nudgematic_Position</dt> <dd>The nudgematic position, -1 if it is moving.</dd>
+ * <dt>Temperature_Valid</dt> <dd>A boolean, TRUE if a sensor temperature has been published.</dd>
+ * <dt>Temperature_C</dt> <dd>The last sensor temperature sampled, in degrees centigrade.</dd>
+ * <dt>Temperature_Time</dt> <dd>When the sensor temperature was sampled.</dd>
+ * </dl>
+ */
+struct Liric_State_Struct
+{
+	unsigned int Version;
+	struct timespec Update_Time;
+	int Sequence_In_Progress;
+	int Sequence_Count;
+	int Sequence_Index;
+	int Exposure_In_Progress;
+	int Exposure_Length_Ms;
+	struct timespec Exposure_Start_Time;
+	int Coadd_Count;
+	int Coadd_Frame_Exposure_Length_Ms;
+	int Multrun_Number;
+	int Run_Number;
+	int Filter_Wheel_Valid;
+	int Filter_Wheel_Position;
+	int Nudgematic_Valid;
+	int Nudgematic_Position;
+	int Temperature_Valid;
+	double Temperature_C;
+	struct timespec Temperature_Time;
+};
+
+/**
+ * Structure holding how long one phase of the liric startup took:
+ * <dl>
+ * <dt>Name</dt> <dd>The name of the phase (e.g. "detector").</dd>
+ * <dt>Success</dt> <dd>A boolean, TRUE if the phase succeeded.</dd>
+ * <dt>Time_Ms</dt> <dd>How long the phase took, in milliseconds.</dd>
+ * </dl>
+ * @see #LIRIC_STATE_STARTUP_PHASE_NAME_LENGTH
+ */
+struct Liric_State_Startup_Phase_Struct
+{
+	char Name[LIRIC_STATE_STARTUP_PHASE_NAME_LENGTH];
+	int Success;
+	double Time_Ms;
+};
+
+/**
+ * Structure holding how long the liric startup took:
+ * <dl>
+ * <dt>Phase_Count</dt> <dd>The number of phases in Phase_List.</dd>
+ * <dt>Phase_List</dt> <dd>The phases, in the order they finished.</dd>
+ * <dt>Total_Time_Ms</dt> <dd>How long it took from the program starting to the server being ready to accept
+ *     commands, in milliseconds, or 0 if the startup has not finished.</dd>
+ * </dl>
+ * @see #LIRIC_STATE_STARTUP_PHASE_MAX_COUNT
+ */
+struct Liric_State_Startup_Struct
+{
+	int Phase_Count;
+	struct Liric_State_Startup_Phase_Struct Phase_List[LIRIC_STATE_STARTUP_PHASE_MAX_COUNT];
+	double Total_Time_Ms;
+};
+
+extern void Liric_State_Get(struct Liric_State_Struct *state);
+extern void Liric_State_Publish(void);
+extern void Liric_State_Sequence_Set(int in_progress,int count,int index);
+extern void Liric_State_Exposure_Update(int in_progress);
+extern void Liric_State_Exposure_Started(void);
+extern void Liric_State_Filter_Wheel_Set(int valid,int position);
+extern void Liric_State_Nudgematic_Set(int valid,int position);
+extern void Liric_State_Telemetry_Sample_Set(struct Detector_Telemetry_Sample_Struct *sample);
+extern void Liric_State_Startup_Phase_Add(char *name,int success,double time_ms);
+extern void Liric_State_Startup_Total_Set(double time_ms);
+extern void Liric_State_Startup_Get(struct Liric_State_Startup_Struct *startup);
+
+#endif
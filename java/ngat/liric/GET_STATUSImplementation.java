@@ -55,6 +55,11 @@ public class GET_STATUSImplementation extends CommandImplementation implements J
 	 * The C layer's port number.
 	 */	
 	protected int cLayerPortNumber = 0;
+	/**
+	 * The "status all" command sent to the C layer, holding the snapshot of C layer status the
+	 * getStatus* methods retrieve their values from.
+	 */
+	protected StatusAllCommand statusAllCommand = null;
 	
 	/**
 	 * Constructor.
@@ -96,6 +101,7 @@ public class GET_STATUSImplementation extends CommandImplementation implements J
 	 * The local hashTable is setup (returned in the done object) and a local copy of status setup.
 	 * <ul>
 	 * <li>getCLayerConfig is called to get the C layer address/port number.
+	 * <li>getStatusAll is called to retrieve a snapshot of all the C layer status in one command.
 	 * <li>getExposureStatus is called to get the exposure status into the exposureStatus and exposureStatusString
 	 *     variables.
 	 * <li>"Exposure Status" and "Exposure Status String" status properties are added to the hashtable.
@@ -117,6 +123,7 @@ public class GET_STATUSImplementation extends CommandImplementation implements J
 	 * @see #hashTable
 	 * @see #detectorTemperatureInstrumentStatus
 	 * @see #getCLayerConfig
+	 * @see #getStatusAll
 	 * @see #getExposureStatus
 	 * @see #getStatusExposureIndex
 	 * @see #getStatusExposureCount
@@ -148,6 +155,8 @@ public class GET_STATUSImplementation extends CommandImplementation implements J
 			hashTable = new Hashtable();
 			// get C layer comms configuration
 			getCLayerConfig();
+			// get all the C layer status in one round trip
+			getStatusAll();
 			// exposure status
 			// Also sets currentMode
 			getExposureStatus(); 
@@ -230,133 +239,87 @@ public class GET_STATUSImplementation extends CommandImplementation implements J
 	}
 	
 	/**
-	 * Get the status/position of the filter wheel.
+	 * Send a "status all" command to the C layer, to retrieve a snapshot of all the C layer status
+	 * GET_STATUS needs in one round trip. The other getStatus* methods retrieve their values from the
+	 * reply.
 	 * @exception Exception Thrown if an error occurs.
+	 * @see #statusAllCommand
 	 * @see #cLayerHostname
 	 * @see #cLayerPortNumber
-	 * @see ngat.liric.command.StatusFilterWheelFilterCommand
-	 * @see ngat.liric.command.StatusFilterWheelPositionCommand
-	 * @see ngat.liric.command.StatusFilterWheelStatusCommand
+	 * @see ngat.liric.command.StatusAllCommand
 	 */
-	protected void getFilterWheelStatus() throws Exception
+	protected void getStatusAll() throws Exception
 	{
-		StatusFilterWheelFilterCommand statusFilterWheelFilterCommand = null;
-		StatusFilterWheelPositionCommand statusFilterWheelPositionCommand = null;
-		StatusFilterWheelStatusCommand statusFilterWheelStatusCommand = null;
+		int returnCode;
 		String errorString = null;
-		String filterName = null;
-		String filterWheelStatus = null;
-		int returnCode,filterWheelPosition;
 
-		liric.log(Logging.VERBOSITY_INTERMEDIATE,"getFilterWheelStatus:started for C layer :Hostname: "+
-			   cLayerHostname+" Port Number: "+cLayerPortNumber+".");
-		// Setup StatusFilterWheelFilterCommand
-		statusFilterWheelFilterCommand = new StatusFilterWheelFilterCommand();
-		statusFilterWheelFilterCommand.setAddress(cLayerHostname);
-		statusFilterWheelFilterCommand.setPortNumber(cLayerPortNumber);
+		liric.log(Logging.VERBOSITY_INTERMEDIATE,"getStatusAll:started for C layer ("+
+			   cLayerHostname+":"+cLayerPortNumber+").");
+		statusAllCommand = new StatusAllCommand();
+		statusAllCommand.setAddress(cLayerHostname);
+		statusAllCommand.setPortNumber(cLayerPortNumber);
 		// actually send the command to the C layer
-		statusFilterWheelFilterCommand.sendCommand();
+		statusAllCommand.sendCommand();
 		// check the parsed reply
-		if(statusFilterWheelFilterCommand.getParsedReplyOK() == false)
+		if(statusAllCommand.getParsedReplyOK() == false)
 		{
-			returnCode = statusFilterWheelFilterCommand.getReturnCode();
-			errorString = statusFilterWheelFilterCommand.getParsedReply();
+			returnCode = statusAllCommand.getReturnCode();
+			errorString = statusAllCommand.getParsedReply();
 			liric.log(Logging.VERBOSITY_TERSE,
-				   "getFilterWheelStatus:filterwheel filter command failed with return code "+
+				   "getStatusAll:status all command failed for C layer ("+
+				   cLayerHostname+":"+cLayerPortNumber+") with return code "+
 				   returnCode+" and error string:"+errorString);
-			throw new Exception(this.getClass().getName()+
-					  ":getFilterWheelStatus:filterwheel filter command failed with return code "+
-					    returnCode+" and error string:"+errorString);
+			throw new Exception(this.getClass().getName()+":getStatusAll:"+
+					    "status all command failed for C layer ("+
+					    cLayerHostname+":"+cLayerPortNumber+
+					    ") with return code "+returnCode+" and error string:"+errorString);
 		}
-		filterName = statusFilterWheelFilterCommand.getFilterName();
+		liric.log(Logging.VERBOSITY_INTERMEDIATE,"getStatusAll:finished for C layer ("+
+			   cLayerHostname+":"+cLayerPortNumber+").");
+	}
+
+	/**
+	 * Get the status/position of the filter wheel, from the "status all" reply.
+	 * @exception Exception Thrown if an error occurs.
+	 * @see #statusAllCommand
+	 * @see ngat.liric.command.StatusAllCommand#getValue
+	 * @see ngat.liric.command.StatusAllCommand#getValueInteger
+	 */
+	protected void getFilterWheelStatus() throws Exception
+	{
+		String filterName = null;
+		String filterWheelStatus = null;
+		int filterWheelPosition;
+
+		filterName = statusAllCommand.getValue("filterwheel.filter");
 		hashTable.put("Filter Wheel:1",new String(filterName));
-		// "status filterwheel position" command
-		statusFilterWheelPositionCommand = new StatusFilterWheelPositionCommand();
-		statusFilterWheelPositionCommand.setAddress(cLayerHostname);
-		statusFilterWheelPositionCommand.setPortNumber(cLayerPortNumber);
-		// actually send the command to the C layer
-		statusFilterWheelPositionCommand.sendCommand();
-		// check the parsed reply
-		if(statusFilterWheelPositionCommand.getParsedReplyOK() == false)
-		{
-			returnCode = statusFilterWheelPositionCommand.getReturnCode();
-			errorString = statusFilterWheelPositionCommand.getParsedReply();
-			liric.log(Logging.VERBOSITY_TERSE,
-				   "getFilterWheelStatus:filterwheel position command failed with return code "+
-				   returnCode+" and error string:"+errorString);
-			throw new Exception(this.getClass().getName()+
-					":getFilterWheelStatus:filterwheel position command failed with return code "+
-					    returnCode+" and error string:"+errorString);
-		}
-		filterWheelPosition = statusFilterWheelPositionCommand.getFilterWheelPosition();
+		filterWheelPosition = statusAllCommand.getValueInteger("filterwheel.position");
 		hashTable.put("Filter Wheel Position:1",new Integer(filterWheelPosition));
-		// "status filterwheel status" command
-		statusFilterWheelStatusCommand = new StatusFilterWheelStatusCommand();
-		statusFilterWheelStatusCommand.setAddress(cLayerHostname);
-		statusFilterWheelStatusCommand.setPortNumber(cLayerPortNumber);
-		// actually send the command to the C layer
-		statusFilterWheelStatusCommand.sendCommand();
-		// check the parsed reply
-		if(statusFilterWheelStatusCommand.getParsedReplyOK() == false)
-		{
-			returnCode = statusFilterWheelStatusCommand.getReturnCode();
-			errorString = statusFilterWheelStatusCommand.getParsedReply();
-			liric.log(Logging.VERBOSITY_TERSE,
-				   "getFilterWheelStatus:filterwheel status command failed with return code "+
-				   returnCode+" and error string:"+errorString);
-			throw new Exception(this.getClass().getName()+
-					   ":getFilterWheelStatus:filterwheel status command failed with return code "+
-					    returnCode+" and error string:"+errorString);
-		}
-		filterWheelStatus = statusFilterWheelStatusCommand.getFilterWheelStatus();
+		filterWheelStatus = statusAllCommand.getValue("filterwheel.status");
 		hashTable.put("Filter Wheel Status:1",new String(filterWheelStatus));
+		liric.log(Logging.VERBOSITY_INTERMEDIATE,"getFilterWheelStatus:finished with filter:"+filterName+
+			   " position:"+filterWheelPosition+" status:"+filterWheelStatus);
 	}
 	
 	/**
-	 * Get the exposure status. 
-	 * This retrieved using an instance of StatusExposureStatusCommand.
+	 * Get the exposure status, from the "status all" reply. 
 	 * The "Multrun In Progress" keyword/value pairs are generated from the returned status. 
 	 * The currentMode is set as either MODE_IDLE, or MODE_EXPOSING if the C layer reports a multrun is in progress.
 	 * @exception Exception Thrown if an error occurs.
 	 * @see #currentMode
-	 * @see #cLayerHostname
-	 * @see #cLayerPortNumber
-	 * @see ngat.liric.command.StatusExposureStatusCommand
-	 * @see ngat.liric.command.StatusExposureStatusCommand#getMultrunInProgress
+	 * @see #statusAllCommand
+	 * @see ngat.liric.command.StatusAllCommand#getValueBoolean
 	 * @see ngat.message.ISS_INST.GET_STATUS_DONE#MODE_IDLE
 	 * @see ngat.message.ISS_INST.GET_STATUS_DONE#MODE_EXPOSING
 	 * @see ngat.message.ISS_INST.GET_STATUS_DONE#MODE_ERROR
 	 */
 	protected void getExposureStatus() throws Exception
 	{
-		StatusExposureStatusCommand statusCommand = null;
-		int returnCode;
-		String errorString = null;
 		boolean multrunInProgress;
 		
 		// initialise currentMode to IDLE
 		currentMode = GET_STATUS_DONE.MODE_IDLE;
-		// Setup StatusExposureStatusCommand
-		liric.log(Logging.VERBOSITY_INTERMEDIATE,"getExposureStatus:started for C layer :Hostname: "+
-			   cLayerHostname+" Port Number: "+cLayerPortNumber+".");
-		statusCommand = new StatusExposureStatusCommand();
-		statusCommand.setAddress(cLayerHostname);
-		statusCommand.setPortNumber(cLayerPortNumber);
-		// actually send the command to the C layer
-		statusCommand.sendCommand();
-		// check the parsed reply
-		if(statusCommand.getParsedReplyOK() == false)
-		{
-			returnCode = statusCommand.getReturnCode();
-			errorString = statusCommand.getParsedReply();
-			liric.log(Logging.VERBOSITY_TERSE,
-				   "getExposureStatus:exposure status command failed with return code "+
-				   returnCode+" and error string:"+errorString);
-			throw new Exception(this.getClass().getName()+
-					    ":getExposureStatus:exposure status command failed with return code "+
-					    returnCode+" and error string:"+errorString);
-		}
-		multrunInProgress = statusCommand.getMultrunInProgress();
+		multrunInProgress = statusAllCommand.getValueBoolean("exposure.status");
 		hashTable.put("Multrun In Progress",new Boolean(multrunInProgress));
 		liric.log(Logging.VERBOSITY_INTERMEDIATE,"getExposureStatus:finished with multrun in progress:"+
 			   multrunInProgress);
@@ -367,136 +330,57 @@ public class GET_STATUSImplementation extends CommandImplementation implements J
 	}
 
 	/**
-	 * Get the exposure count. An instance of StatusExposureCountCommand is used to send the command
-	 * to the C layer, The returned value is stored in
+	 * Get the exposure count, from the "status all" reply. The value is stored in
 	 * the hashTable, under the "Exposure Count" key. 
 	 * @exception Exception Thrown if an error occurs.
 	 * @see #hashTable
-	 * @see #cLayerHostname
-	 * @see #cLayerPortNumber
-	 * @see ngat.liric.command.StatusExposureCountCommand
+	 * @see #statusAllCommand
+	 * @see ngat.liric.command.StatusAllCommand#getValueInteger
 	 */
 	protected void getStatusExposureCount() throws Exception
 	{
-		StatusExposureCountCommand statusCommand = null;
-		int returnCode,exposureCount;
-		String errorString = null;
+		int exposureCount;
 
-		liric.log(Logging.VERBOSITY_INTERMEDIATE,"getStatusExposureCount:started for C layer ("+
-			   cLayerHostname+":"+cLayerPortNumber+").");
-		statusCommand = new StatusExposureCountCommand();
-		statusCommand.setAddress(cLayerHostname);
-		statusCommand.setPortNumber(cLayerPortNumber);
-		// actually send the command to the C layer
-		statusCommand.sendCommand();
-		// check the parsed reply
-		if(statusCommand.getParsedReplyOK() == false)
-		{
-			returnCode = statusCommand.getReturnCode();
-			errorString = statusCommand.getParsedReply();
-			liric.log(Logging.VERBOSITY_TERSE,
-				   "getStatusExposureCount:exposure count command failed ("+
-				   cLayerHostname+":"+cLayerPortNumber+") with return code "+
-				   returnCode+" and error string:"+errorString);
-				throw new Exception(this.getClass().getName()+
-						    ":getStatusExposureCount:"+
-						    "exposure count command failed ("+cLayerHostname+":"+
-						    cLayerPortNumber+") with return code "+returnCode+
-						    " and error string:"+errorString);
-		}
-		exposureCount = statusCommand.getExposureCount();
+		exposureCount = statusAllCommand.getValueInteger("exposure.count");
 		hashTable.put("Exposure Count",new Integer(exposureCount));
-		liric.log(Logging.VERBOSITY_INTERMEDIATE,"getStatusExposureCount:finished for C layer ("+
-			   cLayerHostname+":"+cLayerPortNumber+") with count:"+exposureCount);
+		liric.log(Logging.VERBOSITY_INTERMEDIATE,"getStatusExposureCount:finished with count:"+exposureCount);
 	}
 
 	/**
-	 * Get the exposure length. An instance of StatusExposureLengthCommand is used to send the command
-	 * to the C layer. The returned value is stored in
+	 * Get the exposure length, from the "status all" reply. The value is stored in
 	 * the hashTable, under the "Exposure Length" key.
 	 * @exception Exception Thrown if an error occurs.
 	 * @see #hashTable
-	 * @see #cLayerHostname
-	 * @see #cLayerPortNumber
-	 * @see ngat.liric.command.StatusExposureLengthCommand
+	 * @see #statusAllCommand
+	 * @see ngat.liric.command.StatusAllCommand#getValueInteger
 	 */
 	protected void getStatusExposureLength() throws Exception
 	{
-		StatusExposureLengthCommand statusCommand = null;
-		int returnCode,exposureLength;
-		String errorString = null;
+		int exposureLength;
 
-		liric.log(Logging.VERBOSITY_INTERMEDIATE,"getStatusExposureLength:started for C layer ("+
-			   cLayerHostname+":"+cLayerPortNumber+").");
-		statusCommand = new StatusExposureLengthCommand();
-		statusCommand.setAddress(cLayerHostname);
-		statusCommand.setPortNumber(cLayerPortNumber);
-		// actually send the command to the C layer
-		statusCommand.sendCommand();
-		// check the parsed reply
-		if(statusCommand.getParsedReplyOK() == false)
-		{
-			returnCode = statusCommand.getReturnCode();
-			errorString = statusCommand.getParsedReply();
-			liric.log(Logging.VERBOSITY_TERSE,
-				   "getStatusExposureLength:exposure length command failed for C layer ("+
-				   cLayerHostname+":"+cLayerPortNumber+") with return code "+
-				   returnCode+" and error string:"+errorString);
-			throw new Exception(this.getClass().getName()+":getStatusExposureLength:"+
-					    "exposure length command failed for C layer ("+
-					    cLayerHostname+":"+cLayerPortNumber+
-					    ") with return code "+returnCode+" and error string:"+errorString);
-		}
-		exposureLength = statusCommand.getExposureLength();
+		exposureLength = statusAllCommand.getValueInteger("exposure.length");
 		hashTable.put("Exposure Length",new Integer(exposureLength));
-		liric.log(Logging.VERBOSITY_INTERMEDIATE,"getStatusExposureLength:finished for C layer ("+
-			   cLayerHostname+":"+cLayerPortNumber+") with length:"+exposureLength+ " ms.");
+		liric.log(Logging.VERBOSITY_INTERMEDIATE,"getStatusExposureLength:finished with length:"+
+			   exposureLength+ " ms.");
 	}
 	
 	/**
-	 * Get the exposure start time. An instance of StatusExposureStartTimeCommand is used to send the command
-	 * to the C layer. The returned value is stored in
+	 * Get the exposure start time, from the "status all" reply. The value is stored in
 	 * the hashTable, under the "Exposure Start Time" and "Exposure Start Time Date" key.
 	 * @exception Exception Thrown if an error occurs.
 	 * @see #hashTable
-	 * @see #cLayerHostname
-	 * @see #cLayerPortNumber
-	 * @see ngat.liric.command.StatusExposureStartTimeCommand
+	 * @see #statusAllCommand
+	 * @see ngat.liric.command.StatusAllCommand#getValueDate
 	 */
 	protected void getStatusExposureStartTime() throws Exception
 	{
-		StatusExposureStartTimeCommand statusCommand = null;
 		Date exposureStartTime = null;
-		int returnCode;
-		String errorString = null;
 
-		liric.log(Logging.VERBOSITY_INTERMEDIATE,"getStatusExposureStartTime:started.");
-		liric.log(Logging.VERBOSITY_INTERMEDIATE,"getStatusExposureStartTime:started for C layer ("+
-			   cLayerHostname+":"+cLayerPortNumber+").");
-		statusCommand = new StatusExposureStartTimeCommand();
-		statusCommand.setAddress(cLayerHostname);
-		statusCommand.setPortNumber(cLayerPortNumber);
-		// actually send the command to the C layer
-		statusCommand.sendCommand();
-		// check the parsed reply
-		if(statusCommand.getParsedReplyOK() == false)
-		{
-			returnCode = statusCommand.getReturnCode();
-			errorString = statusCommand.getParsedReply();
-			liric.log(Logging.VERBOSITY_TERSE,"getStatusExposureStartTime:"+
-				   "exposure start time command failed for C layer ("+
-				   cLayerHostname+":"+cLayerPortNumber+") with return code "+
-				   returnCode+" and error string:"+errorString);
-			throw new Exception(this.getClass().getName()+":getStatusExposureStartTime:"+
-					    "exposure start time command failed for C layer ("+
-					    cLayerHostname+":"+cLayerPortNumber+") with return code "+
-					    returnCode+" and error string:"+errorString);
-		}
-		exposureStartTime = statusCommand.getTimestamp();
+		exposureStartTime = statusAllCommand.getValueDate("exposure.start_time");
 		hashTable.put("Exposure Start Time",new Long(exposureStartTime.getTime()));
 		hashTable.put("Exposure Start Time Date",exposureStartTime);
-		liric.log(Logging.VERBOSITY_INTERMEDIATE,"getStatusExposureStartTime:finished for C layer ("+
-			   cLayerHostname+":"+cLayerPortNumber+") with start time:"+exposureStartTime);
+		liric.log(Logging.VERBOSITY_INTERMEDIATE,"getStatusExposureStartTime:finished with start time:"+
+			   exposureStartTime);
 	}
 
 	/**
@@ -536,220 +420,93 @@ public class GET_STATUSImplementation extends CommandImplementation implements J
 	}
 	
 	/**
-	 * Get the exposure index for each camera. 
-	 * An instance of StatusExposureIndexCommand is used to send the command to the C layer. 
-	 * The returned values are stored in the hashTable, under the : "Exposure Index" key.
+	 * Get the exposure index, from the "status all" reply. 
+	 * The value is stored in the hashTable, under the "Exposure Index" and "Exposure Number" keys.
 	 * @exception Exception Thrown if an error occurs.
-	 * @see #cLayerHostname
-	 * @see #cLayerPortNumber
 	 * @see #hashTable
-	 * @see ngat.liric.command.StatusExposureIndexCommand
+	 * @see #statusAllCommand
+	 * @see ngat.liric.command.StatusAllCommand#getValueInteger
 	 */
 	protected void getStatusExposureIndex() throws Exception
 	{
-		StatusExposureIndexCommand statusCommand = null;
-		int returnCode,exposureIndex;
-		String errorString = null;
+		int exposureIndex;
 
-		liric.log(Logging.VERBOSITY_INTERMEDIATE,"getStatusExposureIndex:started for C layer ("+
-			   cLayerHostname+":"+cLayerPortNumber+").");
-		statusCommand = new StatusExposureIndexCommand();
-		statusCommand.setAddress(cLayerHostname);
-		statusCommand.setPortNumber(cLayerPortNumber);
-		// actually send the command to the C layer
-		statusCommand.sendCommand();
-		// check the parsed reply
-		if(statusCommand.getParsedReplyOK() == false)
-		{
-			returnCode = statusCommand.getReturnCode();
-			errorString = statusCommand.getParsedReply();
-			liric.log(Logging.VERBOSITY_TERSE,
-				   "getStatusExposureIndex:exposure index command failed for C layer ("+
-				   cLayerHostname+":"+cLayerPortNumber+") with return code "+
-				   returnCode+" and error string:"+errorString);
-			throw new Exception(this.getClass().getName()+
-					    ":getStatusExposureIndex:exposure index command failed for C layer ("+
-					    cLayerHostname+":"+cLayerPortNumber+
-					    ") with return code "+returnCode+" and error string:"+errorString);
-		}
-		exposureIndex = statusCommand.getExposureIndex();
+		exposureIndex = statusAllCommand.getValueInteger("exposure.index");
 		hashTable.put("Exposure Index",new Integer(exposureIndex));
 		// exposure number is really the same thing, but is used by the IcsGUI.
 		hashTable.put("Exposure Number",new Integer(exposureIndex));
-		liric.log(Logging.VERBOSITY_INTERMEDIATE,"getStatusExposureIndex:finished for C layer ("+
-			   cLayerHostname+":"+cLayerPortNumber+") with index:"+exposureIndex);
+		liric.log(Logging.VERBOSITY_INTERMEDIATE,"getStatusExposureIndex:finished with index:"+exposureIndex);
 	}
 	
 	/**
-	 * Get the coadd exposure count. An instance of StatusExposureCoaddCountCommand is used to send the command
-	 * to the C layer, The returned value is stored in
+	 * Get the coadd exposure count, from the "status all" reply. The value is stored in
 	 * the hashTable, under the "Coadd Exposure Count" key. 
 	 * @exception Exception Thrown if an error occurs.
 	 * @see #hashTable
-	 * @see #cLayerHostname
-	 * @see #cLayerPortNumber
-	 * @see ngat.liric.command.StatusExposureCountCommand
+	 * @see #statusAllCommand
+	 * @see ngat.liric.command.StatusAllCommand#getValueInteger
 	 */
 	protected void getStatusExposureCoaddCount() throws Exception
 	{
-		StatusExposureCoaddCountCommand statusCommand = null;
-		int returnCode,coaddExposureCount;
-		String errorString = null;
+		int coaddExposureCount;
 
-		liric.log(Logging.VERBOSITY_INTERMEDIATE,"getStatusExposureCoaddCount:started for C layer ("+
-			   cLayerHostname+":"+cLayerPortNumber+").");
-		statusCommand = new StatusExposureCoaddCountCommand();
-		statusCommand.setAddress(cLayerHostname);
-		statusCommand.setPortNumber(cLayerPortNumber);
-		// actually send the command to the C layer
-		statusCommand.sendCommand();
-		// check the parsed reply
-		if(statusCommand.getParsedReplyOK() == false)
-		{
-			returnCode = statusCommand.getReturnCode();
-			errorString = statusCommand.getParsedReply();
-			liric.log(Logging.VERBOSITY_TERSE,
-				   "getStatusExposureCoaddCount:exposure coadd count command failed ("+
-				   cLayerHostname+":"+cLayerPortNumber+") with return code "+
-				   returnCode+" and error string:"+errorString);
-				throw new Exception(this.getClass().getName()+
-						    ":getStatusExposureCoaddCount:"+
-						    "exposure coadd count command failed ("+cLayerHostname+":"+
-						    cLayerPortNumber+") with return code "+returnCode+
-						    " and error string:"+errorString);
-		}
-		coaddExposureCount = statusCommand.getExposureCoaddCount();
+		coaddExposureCount = statusAllCommand.getValueInteger("exposure.coadd_count");
 		hashTable.put("Coadd Exposure Count",new Integer(coaddExposureCount));
-		liric.log(Logging.VERBOSITY_INTERMEDIATE,"getStatusExposureCoaddCount:finished for C layer ("+
-			   cLayerHostname+":"+cLayerPortNumber+") with coadd exposure count:"+coaddExposureCount);
+		liric.log(Logging.VERBOSITY_INTERMEDIATE,"getStatusExposureCoaddCount:finished with coadd exposure count:"+
+			   coaddExposureCount);
 	}
 
 	/**
-	 * Get the exposure coadd length. An instance of StatusExposureCoaddLengthCommand is used to send the command
-	 * to the C layer. The returned value is stored in
+	 * Get the exposure coadd length, from the "status all" reply. The value is stored in
 	 * the hashTable, under the "Coadd Exposure Length" key.
 	 * @exception Exception Thrown if an error occurs.
 	 * @see #hashTable
-	 * @see #cLayerHostname
-	 * @see #cLayerPortNumber
-	 * @see ngat.liric.command.StatusExposureCoaddLengthCommand
+	 * @see #statusAllCommand
+	 * @see ngat.liric.command.StatusAllCommand#getValueInteger
 	 */
 	protected void getStatusExposureCoaddLength() throws Exception
 	{
-		StatusExposureCoaddLengthCommand statusCommand = null;
-		int returnCode,coaddExposureLength;
-		String errorString = null;
+		int coaddExposureLength;
 
-		liric.log(Logging.VERBOSITY_INTERMEDIATE,"getStatusExposureCoaddLength:started for C layer ("+
-			   cLayerHostname+":"+cLayerPortNumber+").");
-		statusCommand = new StatusExposureCoaddLengthCommand();
-		statusCommand.setAddress(cLayerHostname);
-		statusCommand.setPortNumber(cLayerPortNumber);
-		// actually send the command to the C layer
-		statusCommand.sendCommand();
-		// check the parsed reply
-		if(statusCommand.getParsedReplyOK() == false)
-		{
-			returnCode = statusCommand.getReturnCode();
-			errorString = statusCommand.getParsedReply();
-			liric.log(Logging.VERBOSITY_TERSE,
-				   "getStatusExposureCoaddLength:exposure coadd length command failed for C layer ("+
-				   cLayerHostname+":"+cLayerPortNumber+") with return code "+
-				   returnCode+" and error string:"+errorString);
-			throw new Exception(this.getClass().getName()+":getStatusExposureCoaddLength:"+
-					    "exposure coadd length command failed for C layer ("+
-					    cLayerHostname+":"+cLayerPortNumber+
-					    ") with return code "+returnCode+" and error string:"+errorString);
-		}
-		coaddExposureLength = statusCommand.getExposureCoaddLength();
+		coaddExposureLength = statusAllCommand.getValueInteger("exposure.coadd_length");
 		hashTable.put("Coadd Exposure Length",new Integer(coaddExposureLength));
-		liric.log(Logging.VERBOSITY_INTERMEDIATE,"getStatusExposureCoaddLength:finished for C layer ("+
-			   cLayerHostname+":"+cLayerPortNumber+") with coadd exposure length:"+coaddExposureLength+ " ms.");
+		liric.log(Logging.VERBOSITY_INTERMEDIATE,"getStatusExposureCoaddLength:finished with coadd exposure length:"+
+			   coaddExposureLength+ " ms.");
 	}
 	
 	/**
-	 * Get the exposure multrun. An instance of StatusExposureMultrunCommand is used to send the command
-	 * to the C layer. The returned value is stored inthe hashTable, under the "Exposure Multrun" key.
+	 * Get the exposure multrun, from the "status all" reply. The value is stored in the hashTable, 
+	 * under the "Exposure Multrun" key.
 	 * @exception Exception Thrown if an error occurs.
 	 * @see #hashTable
-	 * @see #cLayerHostname
-	 * @see #cLayerPortNumber
-	 * @see ngat.liric.command.StatusExposureMultrunCommand
+	 * @see #statusAllCommand
+	 * @see ngat.liric.command.StatusAllCommand#getValueInteger
 	 */
 	protected void getStatusExposureMultrun() throws Exception
 	{
-		StatusExposureMultrunCommand statusCommand = null;
-		int returnCode,exposureMultrun;
-		String errorString = null;
+		int exposureMultrun;
 
-		liric.log(Logging.VERBOSITY_INTERMEDIATE,"getStatusExposureMultrun:started for C layer ("+
-			   cLayerHostname+":"+cLayerPortNumber+").");
-		statusCommand = new StatusExposureMultrunCommand();
-		statusCommand.setAddress(cLayerHostname);
-		statusCommand.setPortNumber(cLayerPortNumber);
-		// actually send the command to the C layer
-		statusCommand.sendCommand();
-		// check the parsed reply
-		if(statusCommand.getParsedReplyOK() == false)
-		{
-			returnCode = statusCommand.getReturnCode();
-			errorString = statusCommand.getParsedReply();
-			liric.log(Logging.VERBOSITY_TERSE,
-				   "getStatusExposureMultrun:exposure multrun command failed for C layer ("+
-				   cLayerHostname+":"+cLayerPortNumber+") with return code "+
-				   returnCode+" and error string:"+errorString);
-			throw new Exception(this.getClass().getName()+":getStatusExposureMultrun:"+
-					    "exposure multrun command failed for C layer ("+
-					    cLayerHostname+":"+cLayerPortNumber+
-					    ") with return code "+returnCode+" and error string:"+errorString);
-		}
-		exposureMultrun = statusCommand.getExposureMultrun();
+		exposureMultrun = statusAllCommand.getValueInteger("exposure.multrun");
 		hashTable.put("Exposure Multrun",new Integer(exposureMultrun));
-		liric.log(Logging.VERBOSITY_INTERMEDIATE,"getStatusExposureMultrun:finished for C layer ("+
-			   cLayerHostname+":"+cLayerPortNumber+") with multrun number:"+exposureMultrun);
+		liric.log(Logging.VERBOSITY_INTERMEDIATE,"getStatusExposureMultrun:finished with multrun number:"+
+			   exposureMultrun);
 	}
 
 	/**
-	 * Get the exposure multrun run. An instance of StatusExposureRunCommand is used to send the command
-	 * to the C layer. The returned value is stored in the hashTable, under the "Exposure Run" key.
+	 * Get the exposure multrun run, from the "status all" reply. The value is stored in the hashTable, 
+	 * under the "Exposure Run" key.
 	 * @exception Exception Thrown if an error occurs.
 	 * @see #hashTable
-	 * @see #cLayerHostname
-	 * @see #cLayerPortNumber
-	 * @see ngat.liric.command.StatusExposureRunCommand
+	 * @see #statusAllCommand
+	 * @see ngat.liric.command.StatusAllCommand#getValueInteger
 	 */
 	protected void getStatusExposureRun() throws Exception
 	{
-		StatusExposureRunCommand statusCommand = null;
-		int returnCode,exposureRun;
-		String errorString = null;
+		int exposureRun;
 
-		liric.log(Logging.VERBOSITY_INTERMEDIATE,"getStatusExposureRun:started.");
-		liric.log(Logging.VERBOSITY_INTERMEDIATE,"getStatusExposureRun:started for C layer ("+
-			   cLayerHostname+":"+cLayerPortNumber+").");
-		statusCommand = new StatusExposureRunCommand();
-		statusCommand.setAddress(cLayerHostname);
-		statusCommand.setPortNumber(cLayerPortNumber);
-		// actually send the command to the C layer
-		statusCommand.sendCommand();
-		// check the parsed reply
-		if(statusCommand.getParsedReplyOK() == false)
-		{
-			returnCode = statusCommand.getReturnCode();
-			errorString = statusCommand.getParsedReply();
-			liric.log(Logging.VERBOSITY_TERSE,
-				   "getStatusExposureRun:exposure run command failed for C layer ("+
-				   cLayerHostname+":"+cLayerPortNumber+") with return code "+
-				   returnCode+" and error string:"+errorString);
-			throw new Exception(this.getClass().getName()+":getStatusExposureRun:"+
-					    "exposure run command failed for C layer ("+
-					    cLayerHostname+":"+cLayerPortNumber+
-					    ") with return code "+returnCode+" and error string:"+errorString);
-		}
-		exposureRun = statusCommand.getExposureRun();
+		exposureRun = statusAllCommand.getValueInteger("exposure.run");
 		hashTable.put("Exposure Run",new Integer(exposureRun));
-		liric.log(Logging.VERBOSITY_INTERMEDIATE,"getStatusExposureRun:finished for C layer ("+
-			   cLayerHostname+":"+cLayerPortNumber+") with run number:"+exposureRun);
+		liric.log(Logging.VERBOSITY_INTERMEDIATE,"getStatusExposureRun:finished with run number:"+exposureRun);
 	}
 	
 	/**
@@ -788,67 +545,32 @@ public class GET_STATUSImplementation extends CommandImplementation implements J
 	}
 
 	/**
-	 * Get the current detector temperature.
-	 * An instance of StatusTemperatureGetCommand is used to send the command
-	 * to the C layer. The returned value is stored in
+	 * Get the current detector temperature, from the "status all" reply. The value is stored in
 	 * the hashTable, under the "Temperature" key (converted to Kelvin). 
 	 * A timestamp is also retrieved (when the temperature was actually measured, it may be a cached value), 
 	 * and this is stored in the "Temperature Timestamp" key.
 	 * setDetectorTemperatureInstrumentStatus is called with the detector temperature to set
 	 * the detector temperature health and wellbeing values.
 	 * @exception Exception Thrown if an error occurs.
-	 * @see #cLayerHostname
-	 * @see #cLayerPortNumber
 	 * @see #hashTable
+	 * @see #statusAllCommand
 	 * @see #setDetectorTemperatureInstrumentStatus
 	 * @see ngat.liric.Liric#CENTIGRADE_TO_KELVIN
-	 * @see ngat.liric.command.StatusTemperatureGetCommand
-	 * @see ngat.liric.command.StatusTemperatureGetCommand#setAddress
-	 * @see ngat.liric.command.StatusTemperatureGetCommand#setPortNumber
-	 * @see ngat.liric.command.StatusTemperatureGetCommand#sendCommand
-	 * @see ngat.liric.command.StatusTemperatureGetCommand#getReturnCode
-	 * @see ngat.liric.command.StatusTemperatureGetCommand#getParsedReply
-	 * @see ngat.liric.command.StatusTemperatureGetCommand#getTemperature
-	 * @see ngat.liric.command.StatusTemperatureGetCommand#getTimestamp
+	 * @see ngat.liric.command.StatusAllCommand#getValueDouble
+	 * @see ngat.liric.command.StatusAllCommand#getValueDate
 	 */
 	protected void getTemperature() throws Exception
 	{
-		StatusTemperatureGetCommand statusCommand = null;
-		int returnCode;
-		String errorString = null;
 		double temperature;
 		Date timestamp;
 
-		liric.log(Logging.VERBOSITY_INTERMEDIATE,"getTemperature:started for C layer ("+
-			   cLayerHostname+":"+cLayerPortNumber+").");
-		statusCommand = new StatusTemperatureGetCommand();
-		statusCommand.setAddress(cLayerHostname);
-		statusCommand.setPortNumber(cLayerPortNumber);
-		// actually send the command to the C layer
-		statusCommand.sendCommand();
-		// check the parsed reply
-		if(statusCommand.getParsedReplyOK() == false)
-		{
-			returnCode = statusCommand.getReturnCode();
-			errorString = statusCommand.getParsedReply();
-			liric.log(Logging.VERBOSITY_TERSE,
-				   "getTemperature:exposure run command failed for C layer ("+
-				   cLayerHostname+":"+cLayerPortNumber+
-				   ") with return code "+returnCode+" and error string:"+errorString);
-			throw new Exception(this.getClass().getName()+":getTemperature:"+
-					    "exposure run command failed C layer ("+
-					    cLayerHostname+":"+cLayerPortNumber+
-					    ") with return code "+returnCode+" and error string:"+errorString);
-		}
-		temperature = statusCommand.getTemperature();
-		timestamp = statusCommand.getTimestamp();
+		temperature = statusAllCommand.getValueDouble("temperature");
+		timestamp = statusAllCommand.getValueDate("temperature.time");
 		hashTable.put("Temperature",new Double(temperature+Liric.CENTIGRADE_TO_KELVIN));
 		hashTable.put("Temperature Timestamp",timestamp);
-		liric.log(Logging.VERBOSITY_INTERMEDIATE,"getTemperature:finished for C layer ("+
-			   cLayerHostname+":"+cLayerPortNumber+") with temperature:"+temperature+
+		liric.log(Logging.VERBOSITY_INTERMEDIATE,"getTemperature:finished with temperature:"+temperature+
 			   " measured at "+timestamp);
 		setDetectorTemperatureInstrumentStatus(temperature);
-		liric.log(Logging.VERBOSITY_INTERMEDIATE,"getTemperature:finished.");
 	}
 
 	/**
@@ -939,85 +661,24 @@ public class GET_STATUSImplementation extends CommandImplementation implements J
 	}
 
 	/**
-	 * Get the status/position/offsetsize of the nudgematic mechanism.
+	 * Get the status/position/offsetsize of the nudgematic mechanism, from the "status all" reply.
 	 * @exception Exception Thrown if an error occurs.
-	 * @see #cLayerHostname
-	 * @see #cLayerPortNumber
-	 * @see ngat.liric.command.StatusNudgematicPositionCommand
-	 * @see ngat.liric.command.StatusNudgematicStatusCommand
-	 * @see ngat.liric.command.StatusNudgematicOffsetSizeCommand
+	 * @see #hashTable
+	 * @see #statusAllCommand
+	 * @see ngat.liric.command.StatusAllCommand#getValue
+	 * @see ngat.liric.command.StatusAllCommand#getValueInteger
 	 */
 	protected void getNudgematicStatus() throws Exception
 	{
-		StatusNudgematicPositionCommand statusNudgematicPositionCommand = null;
-		StatusNudgematicStatusCommand statusNudgematicStatusCommand = null;
-		StatusNudgematicOffsetSizeCommand statusNudgematicOffsetSizeCommand = null;
-		
-		String errorString = null;
 		String nudgematicStatus = null;
 		String nudgematicOffsetSize = null;
-		int returnCode;
 		int nudgematicPosition;
 
-		// "status nudgematic position" command
-		statusNudgematicPositionCommand = new StatusNudgematicPositionCommand();
-		statusNudgematicPositionCommand.setAddress(cLayerHostname);
-		statusNudgematicPositionCommand.setPortNumber(cLayerPortNumber);
-		// actually send the command to the C layer
-		statusNudgematicPositionCommand.sendCommand();
-		// check the parsed reply
-		if(statusNudgematicPositionCommand.getParsedReplyOK() == false)
-		{
-			returnCode = statusNudgematicPositionCommand.getReturnCode();
-			errorString = statusNudgematicPositionCommand.getParsedReply();
-			liric.log(Logging.VERBOSITY_TERSE,
-				   "getNudgematicStatus:nudgematic position command failed with return code "+
-				   returnCode+" and error string:"+errorString);
-			throw new Exception(this.getClass().getName()+
-					   ":getNudgematicStatus:nudgematic position command failed with return code "+
-					    returnCode+" and error string:"+errorString);
-		}
-		nudgematicPosition = statusNudgematicPositionCommand.getNudgematicPosition();
+		nudgematicPosition = statusAllCommand.getValueInteger("nudgematic.position");
 		hashTable.put("Nudgematic Position",new Integer(nudgematicPosition));
-		// "status nudgematic status" command
-		statusNudgematicStatusCommand = new StatusNudgematicStatusCommand();
-		statusNudgematicStatusCommand.setAddress(cLayerHostname);
-		statusNudgematicStatusCommand.setPortNumber(cLayerPortNumber);
-		// actually send the command to the C layer
-		statusNudgematicStatusCommand.sendCommand();
-		// check the parsed reply
-		if(statusNudgematicStatusCommand.getParsedReplyOK() == false)
-		{
-			returnCode = statusNudgematicStatusCommand.getReturnCode();
-			errorString = statusNudgematicStatusCommand.getParsedReply();
-			liric.log(Logging.VERBOSITY_TERSE,
-				   "getNudgematicStatus:nudgematic status command failed with return code "+
-				   returnCode+" and error string:"+errorString);
-			throw new Exception(this.getClass().getName()+
-					    ":getNudgematicStatus:nudgematic status command failed with return code "+
-					    returnCode+" and error string:"+errorString);
-		}
-		nudgematicStatus = statusNudgematicStatusCommand.getNudgematicStatus();
+		nudgematicStatus = statusAllCommand.getValue("nudgematic.status");
 		hashTable.put("Nudgematic Status",new String(nudgematicStatus));
-		// "status nudgematic offset size" command
-		statusNudgematicOffsetSizeCommand = new StatusNudgematicOffsetSizeCommand();
-		statusNudgematicOffsetSizeCommand.setAddress(cLayerHostname);
-		statusNudgematicOffsetSizeCommand.setPortNumber(cLayerPortNumber);
-		// actually send the command to the C layer
-		statusNudgematicOffsetSizeCommand.sendCommand();
-		// check the parsed reply
-		if(statusNudgematicOffsetSizeCommand.getParsedReplyOK() == false)
-		{
-			returnCode = statusNudgematicOffsetSizeCommand.getReturnCode();
-			errorString = statusNudgematicOffsetSizeCommand.getParsedReply();
-			liric.log(Logging.VERBOSITY_TERSE,
-				   "getNudgematicStatus:nudgematic status command failed with return code "+
-				   returnCode+" and error string:"+errorString);
-			throw new Exception(this.getClass().getName()+
-					    ":getNudgematicStatus:nudgematic status command failed with return code "+
-					    returnCode+" and error string:"+errorString);
-		}
-		nudgematicOffsetSize = statusNudgematicOffsetSizeCommand.getNudgematicOffsetSize();
+		nudgematicOffsetSize = statusAllCommand.getValue("nudgematic.offsetsize");
 		hashTable.put("Nudgematic Offset Size",new String(nudgematicOffsetSize));
 	}
 
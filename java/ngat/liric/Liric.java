@@ -102,7 +102,9 @@ public class Liric
 	 * <li>We initialise the IP address of the ISS (Instrument Support Service) from the properties file.
 	 * <li>We initialise various acknowledge times (timeouts associated with the receiving of commands
 	 *     over network sockets) from the properties file.
-	 * <li>
+	 * <li>If the "liric.c.session.enable" property is true, we create a CommandSessionPool (keeping at most
+	 *     "liric.c.session.max_idle" idle sessions), and set it as the default session pool, so commands
+	 *     to the C layer are sent over pooled persistent sessions rather than a connection per command.
 	 * </ul>
 	 * @see #initLoggers
 	 * @see #setLogLevel
@@ -115,6 +117,8 @@ public class Liric
 	 * @see ngat.liric.LiricStatus
 	 * @see ngat.liric.LiricTCPServerConnectionThread#setDefaultAcknowledgeTime
 	 * @see ngat.liric.LiricTCPServerConnectionThread#setMinAcknowledgeTime
+	 * @see ngat.liric.command.Command#setDefaultSessionPool
+	 * @see ngat.liric.command.CommandSessionPool
 	 * @throws FileNotFoundException Thrown if the LiricStatus.load method fails.
 	 * @throws IOException Thrown if the LiricStatus.load method fails.
 	 * @throws NumberFormatException Thrown if various port numbers cannot be parsed from the config file.
@@ -123,7 +127,7 @@ public class Liric
 	private void init() throws FileNotFoundException,IOException,
 		NumberFormatException,Exception
 	{
-		int time;
+		int time,maxIdleCount;
 
 	// create status object and load liric properties into it
 		status = new LiricStatus();
@@ -182,6 +186,25 @@ public class Liric
 			error(this.getClass().getName()+":init:initialsing server connection thread times:",e);
 			// don't throw the error - failing to get this property is not 'vital' to Liric.
 		}		
+	// initialise the C layer session pool from properties file
+		try
+		{
+			if(status.getPropertyBoolean("liric.c.session.enable"))
+			{
+				maxIdleCount = status.getPropertyInteger("liric.c.session.max_idle");
+				Command.setDefaultSessionPool(new CommandSessionPool(maxIdleCount));
+			}
+		}
+		catch(NumberFormatException e)
+		{
+			error(this.getClass().getName()+":init:initialsing C layer session pool:",e);
+			// don't throw the error - commands will connect to the C layer once per command.
+		}
+		catch(NullPointerException e)
+		{
+			error(this.getClass().getName()+":init:initialsing C layer session pool:",e);
+			// don't throw the error - commands will connect to the C layer once per command.
+		}
 	}
 
 
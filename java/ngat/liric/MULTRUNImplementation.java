@@ -39,6 +39,11 @@ public class MULTRUNImplementation extends HardwareImplementation implements JMS
 	 * Return value from C layer: The last FITS filename produced.
 	 */
 	String lastFilename;
+	/**
+	 * The default time the C layer waits for the next frame of a multrun job, in milliseconds, if the
+	 * "liric.multrun.job.frames.timeout" property is not set.
+	 */
+	public final static int DEFAULT_JOB_FRAMES_TIMEOUT = 10000;
 
 	/**
 	 * Constructor.
@@ -132,11 +137,14 @@ public class MULTRUNImplementation extends HardwareImplementation implements JMS
 	 * <li>setFitsHeaders is called to get some FITS headers from the properties files and add them to the C layers.
 	 * <li>getFitsHeadersFromISS is called to gets some FITS headers from the ISS (RCS). 
 	 *     These are sent on to the C layer.
-	 * <li>We send a Multrun command to the C layer.
+	 * <li>If the "liric.multrun.job.enable" property is true, we run the multrun as a C layer job (sendMultrunJob),
+	 *     which updates the acknowledge time as each frame is saved. Otherwise we send a Multrun command to the
+	 *     C layer (sendMultrunCommand).
 	 * <li>The done object is setup. 
 	 * </ul>
 	 * @see #testAbort
 	 * @see #sendMultrunCommand
+	 * @see #sendMultrunJob
 	 * @see #filenameCount
 	 * @see #multrunNumber
 	 * @see #lastFilename
@@ -151,6 +159,7 @@ public class MULTRUNImplementation extends HardwareImplementation implements JMS
 		MULTRUN_DONE multRunDone = new MULTRUN_DONE(command.getId());
 		int exposureLength,exposureCount;
 		boolean standard;
+		boolean useJob = false;
 	
 		liric.log(Logging.VERBOSITY_TERSE,this.getClass().getName()+":processCommand:Started.");
 		if(testAbort(multRunCommand,multRunDone) == true)
@@ -185,7 +194,18 @@ public class MULTRUNImplementation extends HardwareImplementation implements JMS
 			   ":processCommand:Starting Multrun.");
 		try
 		{
-			sendMultrunCommand(exposureLength,exposureCount,standard);
+			useJob = status.getPropertyBoolean("liric.multrun.job.enable");
+		}
+		catch(NullPointerException e)
+		{
+			useJob = false;
+		}
+		try
+		{
+			if(useJob)
+				sendMultrunJob(multRunCommand,exposureLength,exposureCount,standard);
+			else
+				sendMultrunCommand(exposureLength,exposureCount,standard);
 		}
 		catch(Exception e )
 		{
@@ -272,6 +292,139 @@ public class MULTRUNImplementation extends HardwareImplementation implements JMS
 		liric.log(Logging.VERBOSITY_INTERMEDIATE,"sendMultrunCommand:finished.");
 	}
 
+	/**
+	 * Run a multrun as an asynchronous C layer job.
+	 * <ul>
+	 * <li>We submit the multrun job to the C layer (JobSubmitCommand), which returns the job id as soon as the job
+	 *     has started.
+	 * <li>We repeatedly send a JobFramesCommand for the next frame, which the C layer returns as soon as the frame
+	 *     has been saved (or after the "liric.multrun.job.frames.timeout" property milliseconds).
+	 *     For each frame returned, we update filenameCount and lastFilename.
+	 *     After each reply we send an acknowledge to the client, with the time to complete calculated from the
+	 *     measured mean frame length (or the exposure length, before the first frame is saved) multiplied by the
+	 *     number of frames remaining, rather than estimated from configured overheads.
+	 * <li>When the job has finished, we get the job status (JobStatusCommand) to retrieve the multrun number, and
+	 *     check the job completed successfully.
+	 * </ul>
+	 * @param command The MULTRUN command being implemented, used to send acknowledges to the client.
+	 * @param exposureLength The total exposure length of each frame in the multrun, in milliseconds.
+	 * @param exposureCount The number of exposures to do in the multrun.
+	 * @param standard A boolean, true if the observation is of a standard, false if it is not.
+	 * @exception Exception Thrown if an error occurs, or the job fails or is aborted.
+	 * @see #filenameCount
+	 * @see #multrunNumber
+	 * @see #lastFilename
+	 * @see #DEFAULT_JOB_FRAMES_TIMEOUT
+	 * @see #serverConnectionThread
+	 * @see ngat.liric.command.JobSubmitCommand
+	 * @see ngat.liric.command.JobFramesCommand
+	 * @see ngat.liric.command.JobStatusCommand
+	 * @see LiricTCPServerConnectionThread#sendAcknowledge
+	 * @see LiricTCPServerConnectionThread#getDefaultAcknowledgeTime
+	 */
+	protected void sendMultrunJob(COMMAND command,int exposureLength,int exposureCount,boolean standard)
+		throws Exception
+	{
+		JobSubmitCommand submitCommand = null;
+		JobFramesCommand framesCommand = null;
+		JobStatusCommand statusCommand = null;
+		ACK acknowledge = null;
+		String hostname = null;
+		double totalFrameLength,frameLength;
+		int portNumber,jobId,timeout,i,timeToComplete;
+
+		liric.log(Logging.VERBOSITY_INTERMEDIATE,"sendMultrunJob:exposure length = "+exposureLength+
+			   ":exposure count = "+exposureCount+":standard = "+standard+".");
+		hostname = status.getProperty("liric.c.hostname");
+		portNumber = status.getPropertyInteger("liric.c.port_number");
+		try
+		{
+			timeout = status.getPropertyInteger("liric.multrun.job.frames.timeout");
+		}
+		catch(NumberFormatException e)
+		{
+			timeout = DEFAULT_JOB_FRAMES_TIMEOUT;
+		}
+		// submit the job
+		submitCommand = new JobSubmitCommand();
+		submitCommand.setAddress(hostname);
+		submitCommand.setPortNumber(portNumber);
+		submitCommand.setMultrunCommand(exposureLength,exposureCount,standard);
+		submitCommand.sendCommand();
+		if(submitCommand.getParsedReplyOK() == false)
+		{
+			throw new Exception(this.getClass().getName()+
+					    ":sendMultrunJob:Job submit failed with return code "+
+					    submitCommand.getReturnCode()+" and error string:"+
+					    submitCommand.getParsedReply());
+		}
+		jobId = submitCommand.getJobId();
+		liric.log(Logging.VERBOSITY_INTERMEDIATE,"sendMultrunJob:Started job "+jobId+".");
+		// follow the job frame by frame
+		filenameCount = 0;
+		lastFilename = null;
+		totalFrameLength = 0.0;
+		do
+		{
+			framesCommand = new JobFramesCommand();
+			framesCommand.setAddress(hostname);
+			framesCommand.setPortNumber(portNumber);
+			framesCommand.setCommand(jobId,filenameCount,timeout);
+			framesCommand.sendCommand();
+			if(framesCommand.getParsedReplyOK() == false)
+			{
+				throw new Exception(this.getClass().getName()+
+						    ":sendMultrunJob:Getting frames of job "+jobId+
+						    " failed with return code "+framesCommand.getReturnCode()+
+						    " and error string:"+framesCommand.getParsedReply());
+			}
+			for(i = 0; i < framesCommand.getFrameCount(); i++)
+			{
+				filenameCount = framesCommand.getFrameIndex(i)+1;
+				lastFilename = framesCommand.getFilename(i);
+				totalFrameLength += framesCommand.getFrameLength(i);
+				liric.log(Logging.VERBOSITY_INTERMEDIATE,"sendMultrunJob:Job "+jobId+" saved frame "+
+					  framesCommand.getFrameIndex(i)+":"+lastFilename+" taking "+
+					  framesCommand.getFrameLength(i)+" ms.");
+			}
+			if(framesCommand.isJobFinished() == false)
+			{
+				if(filenameCount > 0)
+					frameLength = totalFrameLength/filenameCount;
+				else
+					frameLength = exposureLength;
+				timeToComplete = (int)(frameLength*(exposureCount-filenameCount))+
+					serverConnectionThread.getDefaultAcknowledgeTime();
+				acknowledge = new ACK(command.getId());
+				acknowledge.setTimeToComplete(timeToComplete);
+				serverConnectionThread.sendAcknowledge(acknowledge,true);
+			}
+		}
+		while(framesCommand.isJobFinished() == false);
+		// get the final job status
+		statusCommand = new JobStatusCommand();
+		statusCommand.setAddress(hostname);
+		statusCommand.setPortNumber(portNumber);
+		statusCommand.setCommand(jobId);
+		statusCommand.sendCommand();
+		if(statusCommand.getParsedReplyOK() == false)
+		{
+			throw new Exception(this.getClass().getName()+
+					    ":sendMultrunJob:Getting status of job "+jobId+
+					    " failed with return code "+statusCommand.getReturnCode()+
+					    " and error string:"+statusCommand.getParsedReply());
+		}
+		if(statusCommand.getJobState().equals(JobFramesCommand.STATE_DONE) == false)
+		{
+			throw new Exception(this.getClass().getName()+":sendMultrunJob:Job "+jobId+" "+
+					    statusCommand.getJobState()+":"+statusCommand.getJobErrorString());
+		}
+		multrunNumber = statusCommand.getMultrunNumber();
+		if(lastFilename == null)
+			lastFilename = new String("none");
+		liric.log(Logging.VERBOSITY_INTERMEDIATE,"sendMultrunJob:finished.");
+	}
+
 	/**
 	 * Parse the successful reply string from the Multrun command.
 	 * Currently should be of the form:
@@ -11,7 +11,8 @@ import ngat.net.TelnetConnectionListener;
 
 /**
  * The Command class is the base class for sending a command and getting a reply from the
- * Liric control system C layer. This is a telnet - type socket interaction.
+ * Liric control system C layer. This is a telnet - type socket interaction. By default a new connection is made
+ * for each command, if a session pool is set the command is sent over a pooled persistent session instead.
  * @author Chris Mottram
  * @version $Revision$
  */
@@ -58,6 +59,31 @@ public class Command implements Runnable, TelnetConnectionListener
 	 * The return code of the reply string, parsed as an integer.
 	 */
 	protected int returnCode = 0;
+	/**
+	 * The address of the C layer, used to get a session from the session pool.
+	 */
+	protected InetAddress address = null;
+	/**
+	 * The port number of the C layer, used to get a session from the session pool.
+	 */
+	protected int portNumber = 0;
+	/**
+	 * The session pool used by new Command instances, or null if new commands should connect per command.
+	 * @see #setDefaultSessionPool
+	 */
+	protected static CommandSessionPool defaultSessionPool = null;
+	/**
+	 * The session pool to send this command over, or null to make a new connection for this command.
+	 * Initialised to defaultSessionPool.
+	 * @see #defaultSessionPool
+	 */
+	protected CommandSessionPool sessionPool = null;
+	/**
+	 * The read timeout, in milliseconds, used when this command is sent over a session.
+	 * @see #setSessionTimeout
+	 * @see CommandSession#DEFAULT_TIMEOUT
+	 */
+	protected int sessionTimeout = CommandSession.DEFAULT_TIMEOUT;
 
 	/**
 	 * Default constructor. Construct the TelnetConnection and set this object to be the listener.
@@ -68,6 +94,7 @@ public class Command implements Runnable, TelnetConnectionListener
 		super();
 		telnetConnection = new TelnetConnection();
 		telnetConnection.setListener(this);
+		sessionPool = defaultSessionPool;
 	}
 
 	/**
@@ -79,6 +106,9 @@ public class Command implements Runnable, TelnetConnectionListener
 	 * @param commandString The string to send to the C layer as a command.
 	 * @see #telnetConnection
 	 * @see #commandString
+	 * @see #address
+	 * @see #portNumber
+	 * @see #sessionPool
 	 * @exception UnknownHostException Thrown if the address in unknown.
 	 */
 	public Command(String address,int portNumber,String commandString) throws UnknownHostException
@@ -87,6 +117,9 @@ public class Command implements Runnable, TelnetConnectionListener
 		telnetConnection = new TelnetConnection(address,portNumber);
 		telnetConnection.setListener(this);
 		this.commandString = commandString;
+		this.address = InetAddress.getByName(address);
+		this.portNumber = portNumber;
+		sessionPool = defaultSessionPool;
 	}
 
 	/**
@@ -95,33 +128,39 @@ public class Command implements Runnable, TelnetConnectionListener
 	 *     "localhost"
 	 * @exception UnknownHostException Thrown if the address in unknown.
 	 * @see #telnetConnection
+	 * @see #address
 	 * @see ngat.net.TelnetConnection#setAddress
 	 */
 	public void setAddress(String address) throws UnknownHostException
 	{
 		telnetConnection.setAddress(address);
+		this.address = InetAddress.getByName(address);
 	}
 
 	/**
 	 * Set the address.
 	 * @param address A instance of InetAddress representing the address of the server.
 	 * @see #telnetConnection
+	 * @see #address
 	 * @see ngat.net.TelnetConnection#setAddress
 	 */
 	public void setAddress(InetAddress address)
 	{
 		telnetConnection.setAddress(address);
+		this.address = address;
 	}
 
 	/**
 	 * Set the port number.
 	 * @param portNumber An integer representing the port number the server is receiving command on.
 	 * @see #telnetConnection
+	 * @see #portNumber
 	 * @see ngat.net.TelnetConnection#setPortNumber
 	 */
 	public void setPortNumber(int portNumber)
 	{
 		telnetConnection.setPortNumber(portNumber);
+		this.portNumber = portNumber;
 	}
 
 	/**
@@ -134,6 +173,37 @@ public class Command implements Runnable, TelnetConnectionListener
 		commandString = command;
 	}
 
+	/**
+	 * Set the session pool this command is sent over.
+	 * @param pool The session pool, or null to make a new connection for this command.
+	 * @see #sessionPool
+	 */
+	public void setSessionPool(CommandSessionPool pool)
+	{
+		sessionPool = pool;
+	}
+
+	/**
+	 * Set the read timeout used when this command is sent over a session. Commands that take exposures
+	 * set this from their exposure length and count.
+	 * @param timeout The read timeout, in milliseconds. 0 means wait for ever.
+	 * @see #sessionTimeout
+	 */
+	public void setSessionTimeout(int timeout)
+	{
+		sessionTimeout = timeout;
+	}
+
+	/**
+	 * Set the session pool Command instances created after this call are sent over.
+	 * @param pool The session pool, or null to make a new connection per command.
+	 * @see #defaultSessionPool
+	 */
+	public static void setDefaultSessionPool(CommandSessionPool pool)
+	{
+		defaultSessionPool = pool;
+	}
+
 	/**
 	 * Run thread. Uses sendCommand to send the specified command over a telnet connection to the specified
 	 * address and port number.
@@ -160,6 +230,100 @@ public class Command implements Runnable, TelnetConnectionListener
 		}
 	}
 
+	/**
+	 * Routine to send the specified command to the specified address and port number, 
+	 * wait for a reply from the server, and try to parse the reply. If a session pool has been set
+	 * the command is sent over a pooled session (sendSessionCommand), otherwise over a new telnet connection
+	 * (sendTelnetCommand).
+	 * @exception Exception Thrown if an error occurs.
+	 * @see #sessionPool
+	 * @see #address
+	 * @see #sendSessionCommand
+	 * @see #sendTelnetCommand
+	 */
+	public void sendCommand() throws Exception
+	{
+		if((sessionPool != null)&&(address != null))
+			sendSessionCommand();
+		else
+			sendTelnetCommand();
+	}
+
+	/**
+	 * Routine to send the specified command over a session taken from the session pool, 
+	 * wait for a reply from the server, and try to parse the reply.
+	 * <ul>
+	 * <li>If a session cannot be opened (i.e. the C layer does not support sessions), we fall back to
+	 *     sendTelnetCommand.
+	 * <li>We set the session's read timeout to sessionTimeout.
+	 * <li>If sending the command over a session that was reused from the pool fails, the C layer may have closed
+	 *     the idle session, so we retry once with a new session. We only retry if the session reports
+	 *     (CommandSession.canRetry) that the C layer cannot have processed the command, i.e. the write failed or
+	 *     the connection was closed before any reply was read. Otherwise retrying could carry out a
+	 *     command such as a multrun twice.
+	 * <li>A session whose command failed is closed rather than returned to the pool.
+	 * </ul>
+	 * @exception Exception Thrown if an error occurs.
+	 * @see #sessionPool
+	 * @see #address
+	 * @see #portNumber
+	 * @see #commandString
+	 * @see #sessionTimeout
+	 * @see #replyString
+	 * @see #commandFinished
+	 * @see #parseReplyString
+	 * @see #sendTelnetCommand
+	 * @see CommandSessionPool#getSession
+	 * @see CommandSessionPool#releaseSession
+	 * @see CommandSession#setTimeout
+	 * @see CommandSession#sendCommand
+	 * @see CommandSession#canRetry
+	 */
+	protected void sendSessionCommand() throws Exception
+	{
+		CommandSession session = null;
+		boolean reused;
+
+		commandFinished = false;
+		replyString = null;
+		try
+		{
+			session = sessionPool.getSession(address,portNumber);
+		}
+		catch(Exception e)
+		{
+			sendTelnetCommand();
+			return;
+		}
+		reused = (session.getCommandCount() > 0);
+		try
+		{
+			session.setTimeout(sessionTimeout);
+			replyString = session.sendCommand(commandString);
+			sessionPool.releaseSession(session,true);
+		}
+		catch(Exception e)
+		{
+			sessionPool.releaseSession(session,false);
+			if((reused == false)||(session.canRetry() == false))
+				throw e;
+			session = sessionPool.getSession(address,portNumber);
+			try
+			{
+				session.setTimeout(sessionTimeout);
+				replyString = session.sendCommand(commandString);
+				sessionPool.releaseSession(session,true);
+			}
+			catch(Exception e2)
+			{
+				sessionPool.releaseSession(session,false);
+				throw e2;
+			}
+		}
+		parseReplyString();
+		commandFinished = true;
+	}
+
 	/**
 	 * Routine to send the specified command over a telnet connection to the specified
 	 * address and port number, wait for a reply from the server, and try to parse the reply.
@@ -169,7 +333,7 @@ public class Command implements Runnable, TelnetConnectionListener
 	 * @see #commandFinished
 	 * @see #parseReplyString
 	 */
-	public void sendCommand() throws Exception
+	public void sendTelnetCommand() throws Exception
 	{
 		Thread thread = null;
 
@@ -0,0 +1,411 @@
+// CommandSession.java
+// $Id$
+package ngat.liric.command;
+
+import java.io.*;
+import java.lang.*;
+import java.net.*;
+
+/**
+ * The CommandSession class holds a persistent connection to the Liric control system C layer, over which
+ * many commands can be sent, rather than connecting once per command as Command does.
+ * The session is started by sending a "session" message. Each command is then sent as
+ * "&lt;request id&gt; &lt;command&gt;", and each reply is framed as
+ * "&lt;request id&gt; &lt;length&gt; &lt;reply&gt;", where &lt;length&gt; is the length of the reply in bytes.
+ * Commands can be pipelined (see sendCommands): the C layer processes the commands in a session in the order they
+ * were sent, and the request ids are used to match the replies to the commands.
+ * A session can only be used by one thread at a time, use CommandSessionPool to share sessions between threads.
+ * @author Chris Mottram
+ * @version $Revision$
+ * @see CommandSessionPool
+ */
+public class CommandSession
+{
+	/**
+	 * Revision Control System id string, showing the version of the Class.
+	 */
+	public final static String RCSID = new String("$Id$");
+	/**
+	 * The message sent to the C layer to start a session.
+	 */
+	public final static String SESSION_COMMAND_STRING = new String("session");
+	/**
+	 * The character set used to encode commands and decode replies.
+	 */
+	public final static String CHARSET_NAME = new String("ISO-8859-1");
+	/**
+	 * The default read timeout of a session, in milliseconds. This is long enough for any command that does
+	 * not take exposures.
+	 */
+	public final static int DEFAULT_TIMEOUT = 60000;
+	/**
+	 * An allowance, in milliseconds, for reading out and saving each frame, added to the exposure length when
+	 * computing the read timeout of a command that takes exposures.
+	 */
+	public final static int FRAME_TIMEOUT = 10000;
+	/**
+	 * The address of the C layer.
+	 */
+	protected InetAddress address = null;
+	/**
+	 * The port number of the C layer.
+	 */
+	protected int portNumber = 0;
+	/**
+	 * The socket connected to the C layer.
+	 */
+	protected Socket socket = null;
+	/**
+	 * Buffered input stream reading replies from the socket.
+	 */
+	protected InputStream inputStream = null;
+	/**
+	 * Buffered output stream writing commands to the socket.
+	 */
+	protected OutputStream outputStream = null;
+	/**
+	 * The request id to use for the next command. Request id 0 is used by the C layer to reply to the
+	 * session message, and to requests it cannot parse.
+	 */
+	protected int nextRequestId = 1;
+	/**
+	 * The number of commands sent over this session.
+	 */
+	protected int commandCount = 0;
+	/**
+	 * The read timeout of the socket (SO_TIMEOUT), in milliseconds. A reply that takes longer than this
+	 * causes sendCommands to fail, rather than block forever on a C layer that has stopped replying.
+	 * @see #DEFAULT_TIMEOUT
+	 */
+	protected int timeout = DEFAULT_TIMEOUT;
+	/**
+	 * The number of bytes of reply read by the current (or last) call to sendCommands.
+	 */
+	protected long replyByteCount = 0;
+	/**
+	 * Whether the last call to sendCommands failed before the C layer could have processed any of the commands.
+	 * @see #canRetry
+	 */
+	protected boolean retryable = false;
+
+	/**
+	 * Constructor.
+	 * @param address The address of the C layer.
+	 * @param portNumber The port number of the C layer.
+	 * @see #address
+	 * @see #portNumber
+	 */
+	public CommandSession(InetAddress address,int portNumber)
+	{
+		super();
+		this.address = address;
+		this.portNumber = portNumber;
+	}
+
+	/**
+	 * Open the session. We connect to the C layer, set the socket read timeout, send the session message,
+	 * and check the reply.
+	 * @exception Exception Thrown if the connection fails, or the C layer does not support sessions.
+	 * @see #socket
+	 * @see #timeout
+	 * @see #inputStream
+	 * @see #outputStream
+	 * @see #SESSION_COMMAND_STRING
+	 * @see #writeLine
+	 * @see #readReply
+	 * @see #close
+	 */
+	public void open() throws Exception
+	{
+		String replyString = null;
+
+		socket = new Socket(address,portNumber);
+		socket.setTcpNoDelay(true);
+		socket.setSoTimeout(timeout);
+		inputStream = new BufferedInputStream(socket.getInputStream());
+		outputStream = new BufferedOutputStream(socket.getOutputStream());
+		try
+		{
+			writeLine(SESSION_COMMAND_STRING);
+			outputStream.flush();
+			replyString = readReply(0);
+			if(replyString.startsWith("0 ") == false)
+			{
+				throw new Exception(this.getClass().getName()+":open:Session not started:"+replyString);
+			}
+		}
+		catch(Exception e)
+		{
+			close();
+			throw e;
+		}
+	}
+
+	/**
+	 * Send one command over the session, and wait for the reply.
+	 * @param commandString The command to send.
+	 * @return The reply to the command, with the framing removed, i.e. of the same form as replies to
+	 *         commands sent with Command.
+	 * @exception Exception Thrown if writing the command or reading the reply fails. The session should then
+	 *            be closed, as the framing may have been lost.
+	 * @see #sendCommands
+	 */
+	public String sendCommand(String commandString) throws Exception
+	{
+		String commandList[] = new String[1];
+		String replyList[] = null;
+
+		commandList[0] = commandString;
+		replyList = sendCommands(commandList);
+		return replyList[0];
+	}
+
+	/**
+	 * Send several commands over the session, pipelined: all the commands are sent before any replies are read.
+	 * This saves a round trip per command over sending them one at a time.
+	 * @param commandList The list of commands to send. They are processed by the C layer in this order.
+	 * @return A list of replies, one per command, in the same order as the commands.
+	 * @exception Exception Thrown if writing the commands or reading the replies fails. The session should then
+	 *            be closed, as the framing may have been lost. canRetry returns whether the commands can
+	 *            safely be resent.
+	 * @see #nextRequestId
+	 * @see #commandCount
+	 * @see #replyByteCount
+	 * @see #retryable
+	 * @see #canRetry
+	 * @see #writeLine
+	 * @see #readReply
+	 */
+	public String[] sendCommands(String commandList[]) throws Exception
+	{
+		String replyList[] = null;
+		int firstRequestId,i;
+
+		retryable = false;
+		replyByteCount = 0;
+		if(socket == null)
+			throw new Exception(this.getClass().getName()+":sendCommands:Session is not open.");
+		replyList = new String[commandList.length];
+		firstRequestId = nextRequestId;
+		try
+		{
+			for(i = 0; i < commandList.length; i++)
+			{
+				writeLine(Integer.toString(firstRequestId+i)+" "+commandList[i]);
+			}
+			outputStream.flush();
+		}
+		catch(IOException e)
+		{
+			retryable = true;
+			throw e;
+		}
+		nextRequestId += commandList.length;
+		// the C layer replies in the order the commands were sent
+		try
+		{
+			for(i = 0; i < commandList.length; i++)
+			{
+				replyList[i] = readReply(firstRequestId+i);
+				commandCount++;
+			}
+		}
+		catch(EOFException e)
+		{
+			// the C layer closed the session before replying at all, i.e. it closed an idle session
+			// without reading the commands
+			if(replyByteCount == 0)
+				retryable = true;
+			throw e;
+		}
+		return replyList;
+	}
+
+	/**
+	 * Return whether the last call to sendCommands failed in a way that means the C layer cannot have processed
+	 * any of the commands, so they can be resent over a new session: either writing the commands failed,
+	 * or the connection was closed before any byte of reply was read. A failure after part of a reply was read,
+	 * or a read timeout, is not retryable, as the C layer may have carried out the command.
+	 * @return A boolean, true if the commands can be resent.
+	 * @see #retryable
+	 */
+	public boolean canRetry()
+	{
+		return retryable;
+	}
+
+	/**
+	 * Set the read timeout of the session. If the session is open, the socket's timeout is changed immediately,
+	 * otherwise it is set when the session is opened.
+	 * @param timeout The read timeout, in milliseconds. 0 means wait for ever.
+	 * @exception SocketException Thrown if setting the socket timeout fails.
+	 * @see #timeout
+	 * @see #socket
+	 */
+	public void setTimeout(int timeout) throws SocketException
+	{
+		this.timeout = timeout;
+		if(socket != null)
+			socket.setSoTimeout(timeout);
+	}
+
+	/**
+	 * Close the session. The socket is closed, which ends the session in the C layer.
+	 * Any errors are ignored.
+	 * @see #socket
+	 */
+	public void close()
+	{
+		try
+		{
+			if(socket != null)
+				socket.close();
+		}
+		catch(IOException e)
+		{
+		}
+		socket = null;
+		inputStream = null;
+		outputStream = null;
+	}
+
+	/**
+	 * Return whether the session is open.
+	 * @return A boolean, true if the session is open.
+	 * @see #socket
+	 */
+	public boolean isOpen()
+	{
+		return (socket != null);
+	}
+
+	/**
+	 * Get the address of the C layer this session is connected to.
+	 * @return The address.
+	 * @see #address
+	 */
+	public InetAddress getAddress()
+	{
+		return address;
+	}
+
+	/**
+	 * Get the port number of the C layer this session is connected to.
+	 * @return The port number.
+	 * @see #portNumber
+	 */
+	public int getPortNumber()
+	{
+		return portNumber;
+	}
+
+	/**
+	 * Get the number of commands sent over this session.
+	 * @return The number of commands.
+	 * @see #commandCount
+	 */
+	public int getCommandCount()
+	{
+		return commandCount;
+	}
+
+	/**
+	 * Write a line (terminated by a newline) to the output stream. The stream is not flushed.
+	 * @param line The line to write.
+	 * @exception IOException Thrown if the write fails.
+	 * @see #outputStream
+	 * @see #CHARSET_NAME
+	 */
+	protected void writeLine(String line) throws IOException
+	{
+		outputStream.write((line+"\n").getBytes(CHARSET_NAME));
+	}
+
+	/**
+	 * Read one framed reply: "&lt;request id&gt; &lt;length&gt; &lt;reply&gt;". Any newlines before the request id
+	 * (i.e. terminating the previous reply) are skipped.
+	 * @param requestId The request id the reply should have.
+	 * @return The reply, with the framing removed.
+	 * @exception Exception Thrown if the read fails, the connection is closed, or the reply has the wrong
+	 *            request id or an invalid length.
+	 * @see #readNumber
+	 * @see #inputStream
+	 * @see #CHARSET_NAME
+	 */
+	protected String readReply(int requestId) throws Exception
+	{
+		byte replyBytes[] = null;
+		int replyRequestId,length,offset,readCount;
+
+		replyRequestId = (int)readNumber();
+		length = (int)readNumber();
+		if(replyRequestId != requestId)
+		{
+			throw new Exception(this.getClass().getName()+":readReply:Expected reply to request "+requestId+
+					    " but got reply to request "+replyRequestId+".");
+		}
+		replyBytes = new byte[length];
+		offset = 0;
+		while(offset < length)
+		{
+			readCount = inputStream.read(replyBytes,offset,length-offset);
+			if(readCount < 0)
+			{
+				throw new EOFException(this.getClass().getName()+":readReply:Connection closed after "+
+						       offset+" of "+length+" bytes of reply to request "+requestId+".");
+			}
+			offset += readCount;
+			replyByteCount += readCount;
+		}
+		return new String(replyBytes,CHARSET_NAME);
+	}
+
+	/**
+	 * Read an unsigned decimal number terminated by a space from the input stream. Any whitespace before the
+	 * number is skipped.
+	 * @return The number.
+	 * @exception Exception Thrown if the read fails, the connection is closed, or a character other than a digit
+	 *            is read.
+	 * @see #readByte
+	 */
+	protected long readNumber() throws Exception
+	{
+		long number = 0;
+		int ch,digitCount = 0;
+
+		ch = readByte();
+		while((ch == '\n')||(ch == '\r')||(ch == ' '))
+			ch = readByte();
+		while((ch >= '0')&&(ch <= '9'))
+		{
+			number = (number*10)+(ch-'0');
+			digitCount++;
+			ch = readByte();
+		}
+		if(ch < 0)
+			throw new EOFException(this.getClass().getName()+":readNumber:Connection closed.");
+		if((ch != ' ')||(digitCount == 0))
+		{
+			throw new Exception(this.getClass().getName()+":readNumber:Illegal character '"+(char)ch+
+					    "' in reply framing.");
+		}
+		return number;
+	}
+
+	/**
+	 * Read one byte from the input stream, counting it in replyByteCount.
+	 * @return The byte read, or -1 if the connection was closed.
+	 * @exception IOException Thrown if the read fails.
+	 * @see #inputStream
+	 * @see #replyByteCount
+	 */
+	protected int readByte() throws IOException
+	{
+		int ch;
+
+		ch = inputStream.read();
+		if(ch >= 0)
+			replyByteCount++;
+		return ch;
+	}
+}
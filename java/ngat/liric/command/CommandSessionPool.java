@@ -0,0 +1,265 @@
+// CommandSessionPool.java
+// $Id$
+package ngat.liric.command;
+
+import java.io.*;
+import java.lang.*;
+import java.net.*;
+import java.util.*;
+
+/**
+ * The CommandSessionPool class keeps a pool of idle CommandSession instances, one list per C layer address and
+ * port number, so commands can reuse an open session rather than connecting to the C layer once per command.
+ * Each thread sending a command takes a session from the pool (opening a new one if none are idle), and returns it
+ * when the reply has been received, so commands from different threads (i.e. a GET_STATUS during a MULTRUN)
+ * never wait for each other.
+ * @author Chris Mottram
+ * @version $Revision$
+ * @see CommandSession
+ * @see Command#setSessionPool
+ */
+public class CommandSessionPool
+{
+	/**
+	 * Revision Control System id string, showing the version of the Class.
+	 */
+	public final static String RCSID = new String("$Id$");
+	/**
+	 * The default maximum number of idle sessions kept per C layer.
+	 */
+	public final static int DEFAULT_MAX_IDLE_COUNT = 4;
+	/**
+	 * Hashtable of idle sessions. The key is a String of the form "&lt;address&gt;:&lt;port number&gt;",
+	 * the value is a Vector of idle CommandSession instances connected to that C layer.
+	 * Could be declared:  Generic:&lt;String, Vector&lt;CommandSession&gt;&gt; but this is not supported by Java 1.4.
+	 */
+	protected Hashtable idleSessionTable = new Hashtable();
+	/**
+	 * The maximum number of idle sessions kept per C layer. Sessions returned to the pool beyond this
+	 * number are closed.
+	 */
+	protected int maxIdleCount = DEFAULT_MAX_IDLE_COUNT;
+
+	/**
+	 * Default constructor.
+	 */
+	public CommandSessionPool()
+	{
+		super();
+	}
+
+	/**
+	 * Constructor.
+	 * @param maxIdleCount The maximum number of idle sessions kept per C layer.
+	 * @see #maxIdleCount
+	 */
+	public CommandSessionPool(int maxIdleCount)
+	{
+		super();
+		this.maxIdleCount = maxIdleCount;
+	}
+
+	/**
+	 * Get a session connected to the specified C layer. An idle session is returned if there is one,
+	 * otherwise a new session is opened. The session should be returned with releaseSession when the
+	 * command has completed.
+	 * @param address The address of the C layer.
+	 * @param portNumber The port number of the C layer.
+	 * @return An open session.
+	 * @exception Exception Thrown if a new session fails to open.
+	 * @see #idleSessionTable
+	 * @see #getKey
+	 * @see CommandSession#open
+	 */
+	public CommandSession getSession(InetAddress address,int portNumber) throws Exception
+	{
+		CommandSession session = null;
+		Vector sessionList = null;
+
+		synchronized(idleSessionTable)
+		{
+			sessionList = (Vector)(idleSessionTable.get(getKey(address,portNumber)));
+			if((sessionList != null)&&(sessionList.size() > 0))
+			{
+				session = (CommandSession)(sessionList.remove(sessionList.size()-1));
+			}
+		}
+		if(session == null)
+		{
+			session = new CommandSession(address,portNumber);
+			session.open();
+		}
+		return session;
+	}
+
+	/**
+	 * Return a session to the pool.
+	 * If the command failed (the session may have lost it's framing), or there are already maxIdleCount
+	 * idle sessions for this C layer, the session is closed instead.
+	 * @param session The session to return.
+	 * @param ok A boolean, true if the last command sent over the session completed successfully.
+	 * @see #idleSessionTable
+	 * @see #maxIdleCount
+	 * @see #getKey
+	 * @see CommandSession#close
+	 */
+	public void releaseSession(CommandSession session,boolean ok)
+	{
+		Vector sessionList = null;
+		String key = null;
+
+		if((ok == false)||(session.isOpen() == false))
+		{
+			session.close();
+			return;
+		}
+		key = getKey(session.getAddress(),session.getPortNumber());
+		synchronized(idleSessionTable)
+		{
+			sessionList = (Vector)(idleSessionTable.get(key));
+			if(sessionList == null)
+			{
+				sessionList = new Vector();
+				idleSessionTable.put(key,sessionList);
+			}
+			if(sessionList.size() < maxIdleCount)
+			{
+				sessionList.add(session);
+				session = null;
+			}
+		}
+		if(session != null)
+			session.close();
+	}
+
+	/**
+	 * Close all the idle sessions in the pool.
+	 * @see #idleSessionTable
+	 * @see CommandSession#close
+	 */
+	public void close()
+	{
+		Enumeration e = null;
+		Vector sessionList = null;
+		int i;
+
+		synchronized(idleSessionTable)
+		{
+			e = idleSessionTable.elements();
+			while(e.hasMoreElements())
+			{
+				sessionList = (Vector)(e.nextElement());
+				for(i = 0; i < sessionList.size(); i++)
+					((CommandSession)(sessionList.get(i))).close();
+				sessionList.clear();
+			}
+		}
+	}
+
+	/**
+	 * Get the idleSessionTable key for a C layer.
+	 * @param address The address of the C layer.
+	 * @param portNumber The port number of the C layer.
+	 * @return A string of the form "&lt;address&gt;:&lt;port number&gt;".
+	 */
+	protected String getKey(InetAddress address,int portNumber)
+	{
+		return new String(address.getHostAddress()+":"+portNumber);
+	}
+
+	/**
+	 * Print the mean/minimum/maximum of a list of command times.
+	 * @param name The name of the benchmark.
+	 * @param timeList The list of command times, in nanoseconds.
+	 */
+	protected static void printTimes(String name,long timeList[])
+	{
+		long min,max,total;
+		int i;
+
+		min = Long.MAX_VALUE;
+		max = 0;
+		total = 0;
+		for(i = 0; i < timeList.length; i++)
+		{
+			if(timeList[i] < min)
+				min = timeList[i];
+			if(timeList[i] > max)
+				max = timeList[i];
+			total += timeList[i];
+		}
+		System.out.println(name+": count = "+timeList.length+
+				   " mean = "+(((double)total)/(timeList.length*1000000.0))+" ms"+
+				   " min = "+(((double)min)/1000000.0)+" ms"+
+				   " max = "+(((double)max)/1000000.0)+" ms");
+	}
+
+	/**
+	 * Main program. This benchmarks the command latency of the connect-per-command model (Command),
+	 * sending commands one at a time over a pooled session, and pipelining commands over one session.
+	 * @param args The argument list: &lt;hostname&gt; &lt;port number&gt; &lt;command&gt; &lt;count&gt;.
+	 */
+	public static void main(String args[])
+	{
+		CommandSessionPool pool = null;
+		CommandSession session = null;
+		Command command = null;
+		String commandList[] = null;
+		long timeList[] = null;
+		long startTime;
+		int portNumber,count,i;
+
+		if(args.length != 4)
+		{
+			System.out.println("java ngat.liric.command.CommandSessionPool <hostname> <port number> "+
+					   "<command> <count>");
+			System.exit(1);
+		}
+		try
+		{
+			portNumber = Integer.parseInt(args[1]);
+			count = Integer.parseInt(args[3]);
+			timeList = new long[count];
+			// connect per command
+			for(i = 0; i < count; i++)
+			{
+				startTime = System.nanoTime();
+				command = new Command(args[0],portNumber,args[2]);
+				command.sendCommand();
+				timeList[i] = System.nanoTime()-startTime;
+			}
+			printTimes("Connect per command",timeList);
+			System.out.println("Last reply:"+command.getReply());
+			// pooled session, one command at a time
+			pool = new CommandSessionPool();
+			command = new Command(args[0],portNumber,args[2]);
+			command.setSessionPool(pool);
+			for(i = 0; i < count; i++)
+			{
+				startTime = System.nanoTime();
+				command.sendCommand();
+				timeList[i] = System.nanoTime()-startTime;
+			}
+			printTimes("Pooled session",timeList);
+			System.out.println("Last reply:"+command.getReply());
+			// pipelined, all commands sent before any replies are read
+			session = pool.getSession(InetAddress.getByName(args[0]),portNumber);
+			commandList = new String[count];
+			for(i = 0; i < count; i++)
+				commandList[i] = args[2];
+			startTime = System.nanoTime();
+			session.sendCommands(commandList);
+			for(i = 0; i < count; i++)
+				timeList[i] = (System.nanoTime()-startTime)/count;
+			pool.releaseSession(session,true);
+			printTimes("Pipelined session (per command)",timeList);
+			pool.close();
+		}
+		catch(Exception e)
+		{
+			e.printStackTrace(System.err);
+			System.exit(1);
+		}
+		System.exit(0);
+	}
+}
@@ -0,0 +1,102 @@
+// JobAbortCommand.java
+// $Id$
+package ngat.liric.command;
+
+import java.io.*;
+import java.lang.*;
+import java.net.*;
+import java.util.*;
+
+/**
+ * The "job abort" command is an extension of the Command, and aborts an asynchronous job (started with
+ * JobSubmitCommand) by job id. Aborting a job that has already finished succeeds and does nothing.
+ * @author Chris Mottram
+ * @version $Revision$
+ * @see JobSubmitCommand
+ */
+public class JobAbortCommand extends Command implements Runnable
+{
+	/**
+	 * Revision Control System id string, showing the version of the Class.
+	 */
+	public final static String RCSID = new String("$Id$");
+
+	/**
+	 * Default constructor.
+	 * @see Command
+	 * @see #commandString
+	 */
+	public JobAbortCommand()
+	{
+		super();
+		commandString = null;
+	}
+
+	/**
+	 * Constructor.
+	 * @param address A string representing the address of the server, i.e. "liric",
+	 *     "localhost"
+	 * @param portNumber An integer representing the port number the server is receiving command on.
+	 * @see Command
+	 * @see Command#setAddress
+	 * @see Command#setPortNumber
+	 * @exception UnknownHostException Thrown if the address in unknown.
+	 */
+	public JobAbortCommand(String address,int portNumber) throws UnknownHostException
+	{
+		super();
+		super.setAddress(address);
+		super.setPortNumber(portNumber);
+	}
+
+	/**
+	 * Setup the command.
+	 * @param jobId The id of the job to abort.
+	 * @see #commandString
+	 */
+	public void setCommand(int jobId)
+	{
+		commandString = new String("job abort "+jobId);
+	}
+
+	/**
+	 * Main test program.
+	 * @param args The argument list.
+	 */
+	public static void main(String args[])
+	{
+		JobAbortCommand command = null;
+		String hostname = null;
+		int portNumber = 8284;
+
+		if(args.length != 3)
+		{
+			System.out.println("java ngat.liric.command.JobAbortCommand <hostname> <port number> <job id>");
+			System.exit(1);
+		}
+		try
+		{
+			hostname = args[0];
+			portNumber = Integer.parseInt(args[1]);
+			command = new JobAbortCommand(hostname,portNumber);
+			command.setCommand(Integer.parseInt(args[2]));
+			command.run();
+			if(command.getRunException() != null)
+			{
+				System.err.println("JobAbortCommand: Command failed.");
+				command.getRunException().printStackTrace(System.err);
+				System.exit(1);
+			}
+			System.out.println("Finished:"+command.getCommandFinished());
+			System.out.println("Reply Parsed OK:"+command.getParsedReplyOK());
+			System.out.println("Return Code:"+command.getReturnCode());
+			System.out.println("Reply String:"+command.getParsedReply());
+		}
+		catch(Exception e)
+		{
+			e.printStackTrace(System.err);
+			System.exit(1);
+		}
+		System.exit(0);
+	}
+}
@@ -0,0 +1,300 @@
+// JobFramesCommand.java
+// $Id$
+package ngat.liric.command;
+
+import java.io.*;
+import java.lang.*;
+import java.net.*;
+import java.text.*;
+import java.util.*;
+
+/**
+ * The "job frames" command is an extension of the Command, and returns the frames saved by an asynchronous job
+ * (started with JobSubmitCommand), starting from a specified frame index. If that frame has not been saved yet,
+ * the C layer waits up to the specified timeout for it, so a client can follow a job's progress frame by frame by
+ * repeatedly sending this command with the index after the last frame it received, until the job is finished.
+ * The reply is of the form "&lt;state&gt; &lt;frame count&gt;" followed, for each frame, by
+ * " &lt;frame index&gt; &lt;FITS filename&gt; &lt;time saved&gt; &lt;frame length ms&gt;".
+ * @author Chris Mottram
+ * @version $Revision$
+ * @see JobSubmitCommand
+ */
+public class JobFramesCommand extends Command implements Runnable
+{
+	/**
+	 * Revision Control System id string, showing the version of the Class.
+	 */
+	public final static String RCSID = new String("$Id$");
+	/**
+	 * Job state: the job has been submitted but not started yet.
+	 */
+	public final static String STATE_QUEUED = new String("queued");
+	/**
+	 * Job state: the job is taking frames.
+	 */
+	public final static String STATE_RUNNING = new String("running");
+	/**
+	 * Job state: the job completed successfully.
+	 */
+	public final static String STATE_DONE = new String("done");
+	/**
+	 * Job state: the job failed.
+	 */
+	public final static String STATE_FAILED = new String("failed");
+	/**
+	 * Job state: the job was aborted.
+	 */
+	public final static String STATE_ABORTED = new String("aborted");
+	/**
+	 * The format of the time saved of each frame, i.e. '2020-04-15T13:59:59.123+0000'.
+	 */
+	public final static String DATE_FORMAT_STRING = new String("yyyy-MM-dd'T'HH:mm:ss.SSSZ");
+	/**
+	 * The job state.
+	 */
+	protected String jobState = null;
+	/**
+	 * The list of frame indexes returned.
+	 * Could be declared:  Generic:&lt;Integer&gt; but this is not supported by Java 1.4.
+	 */
+	protected Vector frameIndexList = new Vector();
+	/**
+	 * The list of FITS filenames returned.
+	 * Could be declared:  Generic:&lt;String&gt; but this is not supported by Java 1.4.
+	 */
+	protected Vector filenameList = new Vector();
+	/**
+	 * The list of times each frame was saved.
+	 * Could be declared:  Generic:&lt;Date&gt; but this is not supported by Java 1.4.
+	 */
+	protected Vector savedTimeList = new Vector();
+	/**
+	 * The list of frame lengths (the time between the previous frame and this frame being saved), in milliseconds.
+	 * Could be declared:  Generic:&lt;Double&gt; but this is not supported by Java 1.4.
+	 */
+	protected Vector frameLengthList = new Vector();
+
+	/**
+	 * Default constructor.
+	 * @see Command
+	 * @see #commandString
+	 */
+	public JobFramesCommand()
+	{
+		super();
+		commandString = null;
+	}
+
+	/**
+	 * Constructor.
+	 * @param address A string representing the address of the server, i.e. "liric",
+	 *     "localhost"
+	 * @param portNumber An integer representing the port number the server is receiving command on.
+	 * @see Command
+	 * @see Command#setAddress
+	 * @see Command#setPortNumber
+	 * @exception UnknownHostException Thrown if the address in unknown.
+	 */
+	public JobFramesCommand(String address,int portNumber) throws UnknownHostException
+	{
+		super();
+		super.setAddress(address);
+		super.setPortNumber(portNumber);
+	}
+
+	/**
+	 * Setup the command.
+	 * @param jobId The id of the job.
+	 * @param firstFrameIndex The index of the first frame to return.
+	 * @param timeout How long the C layer should wait for frame firstFrameIndex to be saved, in milliseconds.
+	 *        The session read timeout is extended by this amount.
+	 * @see #commandString
+	 * @see Command#setSessionTimeout
+	 * @see CommandSession#DEFAULT_TIMEOUT
+	 */
+	public void setCommand(int jobId,int firstFrameIndex,int timeout)
+	{
+		commandString = new String("job frames "+jobId+" "+firstFrameIndex+" "+timeout);
+		setSessionTimeout(CommandSession.DEFAULT_TIMEOUT+timeout);
+	}
+
+	/**
+	 * Parse a string returned from the server over the telnet connection.
+	 * @exception Exception Thrown if a parse error occurs.
+	 * @see #parsedReplyString
+	 * @see #parsedReplyOk
+	 * @see #jobState
+	 * @see #frameIndexList
+	 * @see #filenameList
+	 * @see #savedTimeList
+	 * @see #frameLengthList
+	 * @see #DATE_FORMAT_STRING
+	 */
+	public void parseReplyString() throws Exception
+	{
+		SimpleDateFormat dateFormat = null;
+		StringTokenizer st = null;
+		int frameCount,i;
+
+		super.parseReplyString();
+		jobState = null;
+		frameIndexList.clear();
+		filenameList.clear();
+		savedTimeList.clear();
+		frameLengthList.clear();
+		if(parsedReplyOk == false)
+			return;
+		dateFormat = new SimpleDateFormat(DATE_FORMAT_STRING);
+		st = new StringTokenizer(parsedReplyString," ");
+		try
+		{
+			jobState = st.nextToken();
+			frameCount = Integer.parseInt(st.nextToken());
+			for(i = 0; i < frameCount; i++)
+			{
+				frameIndexList.add(new Integer(st.nextToken()));
+				filenameList.add(st.nextToken());
+				savedTimeList.add(dateFormat.parse(st.nextToken()));
+				frameLengthList.add(new Double(st.nextToken()));
+			}
+		}
+		catch(Exception e)
+		{
+			parsedReplyOk = false;
+			throw new Exception(this.getClass().getName()+":parseReplyString:Failed to parse reply:"+
+					    parsedReplyString,e);
+		}
+	}
+
+	/**
+	 * Get the job state.
+	 * @return The job state, one of STATE_QUEUED, STATE_RUNNING, STATE_DONE, STATE_FAILED or STATE_ABORTED.
+	 * @see #jobState
+	 */
+	public String getJobState()
+	{
+		return jobState;
+	}
+
+	/**
+	 * Return whether the job has finished (it will not save any more frames).
+	 * @return A boolean, true if the job state is STATE_DONE, STATE_FAILED or STATE_ABORTED.
+	 * @see #jobState
+	 */
+	public boolean isJobFinished()
+	{
+		return (jobState != null)&&(jobState.equals(STATE_DONE)||jobState.equals(STATE_FAILED)||
+					    jobState.equals(STATE_ABORTED));
+	}
+
+	/**
+	 * Get the number of frames returned.
+	 * @return The number of frames.
+	 * @see #filenameList
+	 */
+	public int getFrameCount()
+	{
+		return filenameList.size();
+	}
+
+	/**
+	 * Get the index in the job of a returned frame.
+	 * @param i The index in the list of returned frames.
+	 * @return The frame index in the job.
+	 * @see #frameIndexList
+	 */
+	public int getFrameIndex(int i)
+	{
+		return ((Integer)(frameIndexList.get(i))).intValue();
+	}
+
+	/**
+	 * Get the FITS filename of a returned frame.
+	 * @param i The index in the list of returned frames.
+	 * @return The FITS filename.
+	 * @see #filenameList
+	 */
+	public String getFilename(int i)
+	{
+		return (String)(filenameList.get(i));
+	}
+
+	/**
+	 * Get the time a returned frame was saved.
+	 * @param i The index in the list of returned frames.
+	 * @return The time saved.
+	 * @see #savedTimeList
+	 */
+	public Date getSavedTime(int i)
+	{
+		return (Date)(savedTimeList.get(i));
+	}
+
+	/**
+	 * Get the length of a returned frame (the time between the previous frame and this one being saved).
+	 * @param i The index in the list of returned frames.
+	 * @return The frame length, in milliseconds.
+	 * @see #frameLengthList
+	 */
+	public double getFrameLength(int i)
+	{
+		return ((Double)(frameLengthList.get(i))).doubleValue();
+	}
+
+	/**
+	 * Main test program. This follows a job until it finishes, printing each frame as it is saved.
+	 * @param args The argument list.
+	 */
+	public static void main(String args[])
+	{
+		JobFramesCommand command = null;
+		String hostname = null;
+		int portNumber = 8284;
+		int jobId,nextFrameIndex,i;
+
+		if(args.length != 3)
+		{
+			System.out.println("java ngat.liric.command.JobFramesCommand <hostname> <port number> <job id>");
+			System.exit(1);
+		}
+		try
+		{
+			hostname = args[0];
+			portNumber = Integer.parseInt(args[1]);
+			jobId = Integer.parseInt(args[2]);
+			nextFrameIndex = 0;
+			do
+			{
+				command = new JobFramesCommand(hostname,portNumber);
+				command.setCommand(jobId,nextFrameIndex,10000);
+				command.run();
+				if(command.getRunException() != null)
+				{
+					System.err.println("JobFramesCommand: Command failed.");
+					command.getRunException().printStackTrace(System.err);
+					System.exit(1);
+				}
+				if(command.getParsedReplyOK() == false)
+				{
+					System.err.println("JobFramesCommand: Command failed:"+command.getParsedReply());
+					System.exit(1);
+				}
+				for(i = 0; i < command.getFrameCount(); i++)
+				{
+					System.out.println("Frame "+command.getFrameIndex(i)+":"+command.getFilename(i)+
+							   ":saved at "+command.getSavedTime(i)+":length "+
+							   command.getFrameLength(i)+" ms.");
+					nextFrameIndex = command.getFrameIndex(i)+1;
+				}
+			}
+			while(command.isJobFinished() == false);
+			System.out.println("Job finished:"+command.getJobState());
+		}
+		catch(Exception e)
+		{
+			e.printStackTrace(System.err);
+			System.exit(1);
+		}
+		System.exit(0);
+	}
+}
@@ -0,0 +1,235 @@
+// JobStatusCommand.java
+// $Id$
+package ngat.liric.command;
+
+import java.io.*;
+import java.lang.*;
+import java.net.*;
+import java.util.*;
+
+/**
+ * The "job status" command is an extension of the Command, and returns the status of an asynchronous job
+ * (started with JobSubmitCommand). The reply is of the form:
+ * "&lt;job id&gt; &lt;type&gt; &lt;state&gt; &lt;frames saved&gt; &lt;frame count&gt; &lt;multrun number&gt;
+ * [&lt;error string&gt;]".
+ * @author Chris Mottram
+ * @version $Revision$
+ * @see JobSubmitCommand
+ * @see JobFramesCommand
+ */
+public class JobStatusCommand extends Command implements Runnable
+{
+	/**
+	 * Revision Control System id string, showing the version of the Class.
+	 */
+	public final static String RCSID = new String("$Id$");
+	/**
+	 * The job type.
+	 */
+	protected String jobType = null;
+	/**
+	 * The job state, one of the JobFramesCommand.STATE_* values.
+	 * @see JobFramesCommand#STATE_DONE
+	 */
+	protected String jobState = null;
+	/**
+	 * The number of frames saved so far.
+	 */
+	protected int savedFrameCount = 0;
+	/**
+	 * The number of frames the job will take.
+	 */
+	protected int frameCount = 0;
+	/**
+	 * The multrun number of the job's FITS images, or -1 if no frames have been saved yet.
+	 */
+	protected int multrunNumber = -1;
+	/**
+	 * Why the job failed, or an empty string.
+	 */
+	protected String jobErrorString = null;
+
+	/**
+	 * Default constructor.
+	 * @see Command
+	 * @see #commandString
+	 */
+	public JobStatusCommand()
+	{
+		super();
+		commandString = null;
+	}
+
+	/**
+	 * Constructor.
+	 * @param address A string representing the address of the server, i.e. "liric",
+	 *     "localhost"
+	 * @param portNumber An integer representing the port number the server is receiving command on.
+	 * @see Command
+	 * @see Command#setAddress
+	 * @see Command#setPortNumber
+	 * @exception UnknownHostException Thrown if the address in unknown.
+	 */
+	public JobStatusCommand(String address,int portNumber) throws UnknownHostException
+	{
+		super();
+		super.setAddress(address);
+		super.setPortNumber(portNumber);
+	}
+
+	/**
+	 * Setup the command.
+	 * @param jobId The id of the job.
+	 * @see #commandString
+	 */
+	public void setCommand(int jobId)
+	{
+		commandString = new String("job status "+jobId);
+	}
+
+	/**
+	 * Parse a string returned from the server over the telnet connection.
+	 * @exception Exception Thrown if a parse error occurs.
+	 * @see #parsedReplyString
+	 * @see #parsedReplyOk
+	 * @see #jobType
+	 * @see #jobState
+	 * @see #savedFrameCount
+	 * @see #frameCount
+	 * @see #multrunNumber
+	 * @see #jobErrorString
+	 */
+	public void parseReplyString() throws Exception
+	{
+		StringTokenizer st = null;
+
+		super.parseReplyString();
+		if(parsedReplyOk == false)
+			return;
+		st = new StringTokenizer(parsedReplyString," ");
+		try
+		{
+			// job id
+			st.nextToken();
+			jobType = st.nextToken();
+			jobState = st.nextToken();
+			savedFrameCount = Integer.parseInt(st.nextToken());
+			frameCount = Integer.parseInt(st.nextToken());
+			multrunNumber = Integer.parseInt(st.nextToken());
+			if(st.hasMoreTokens())
+				jobErrorString = st.nextToken("").trim();
+			else
+				jobErrorString = "";
+		}
+		catch(Exception e)
+		{
+			parsedReplyOk = false;
+			throw new Exception(this.getClass().getName()+":parseReplyString:Failed to parse reply:"+
+					    parsedReplyString,e);
+		}
+	}
+
+	/**
+	 * Get the job type.
+	 * @return The job type, one of "multrun", "multbias" or "multdark".
+	 * @see #jobType
+	 */
+	public String getJobType()
+	{
+		return jobType;
+	}
+
+	/**
+	 * Get the job state.
+	 * @return The job state.
+	 * @see #jobState
+	 */
+	public String getJobState()
+	{
+		return jobState;
+	}
+
+	/**
+	 * Get the number of frames saved so far.
+	 * @return The number of frames.
+	 * @see #savedFrameCount
+	 */
+	public int getSavedFrameCount()
+	{
+		return savedFrameCount;
+	}
+
+	/**
+	 * Get the number of frames the job will take.
+	 * @return The number of frames.
+	 * @see #frameCount
+	 */
+	public int getFrameCount()
+	{
+		return frameCount;
+	}
+
+	/**
+	 * Get the multrun number of the job's FITS images.
+	 * @return The multrun number, or -1 if no frames have been saved yet.
+	 * @see #multrunNumber
+	 */
+	public int getMultrunNumber()
+	{
+		return multrunNumber;
+	}
+
+	/**
+	 * Get why the job failed.
+	 * @return The error string, or an empty string if the job has not failed.
+	 * @see #jobErrorString
+	 */
+	public String getJobErrorString()
+	{
+		return jobErrorString;
+	}
+
+	/**
+	 * Main test program.
+	 * @param args The argument list.
+	 */
+	public static void main(String args[])
+	{
+		JobStatusCommand command = null;
+		String hostname = null;
+		int portNumber = 8284;
+
+		if(args.length != 3)
+		{
+			System.out.println("java ngat.liric.command.JobStatusCommand <hostname> <port number> <job id>");
+			System.exit(1);
+		}
+		try
+		{
+			hostname = args[0];
+			portNumber = Integer.parseInt(args[1]);
+			command = new JobStatusCommand(hostname,portNumber);
+			command.setCommand(Integer.parseInt(args[2]));
+			command.run();
+			if(command.getRunException() != null)
+			{
+				System.err.println("JobStatusCommand: Command failed.");
+				command.getRunException().printStackTrace(System.err);
+				System.exit(1);
+			}
+			System.out.println("Finished:"+command.getCommandFinished());
+			System.out.println("Reply Parsed OK:"+command.getParsedReplyOK());
+			System.out.println("Type:"+command.getJobType());
+			System.out.println("State:"+command.getJobState());
+			System.out.println("Frames:"+command.getSavedFrameCount()+" of "+command.getFrameCount());
+			System.out.println("Multrun:"+command.getMultrunNumber());
+			System.out.println("Error:"+command.getJobErrorString());
+		}
+		catch(Exception e)
+		{
+			e.printStackTrace(System.err);
+			System.exit(1);
+		}
+		System.exit(0);
+	}
+}
@@ -0,0 +1,153 @@
+// JobSubmitCommand.java
+// $Id$
+package ngat.liric.command;
+
+import java.io.*;
+import java.lang.*;
+import java.net.*;
+import java.util.*;
+
+/**
+ * The "job multrun|multbias|multdark" command is an extension of the IntegerReplyCommand, and starts a
+ * multrun, multbias or multdark running asynchronously in the C layer. The reply is returned as soon as the job has
+ * started, and contains the job id, which can then be used with JobFramesCommand, JobStatusCommand and
+ * JobAbortCommand.
+ * @author Chris Mottram
+ * @version $Revision$
+ * @see JobFramesCommand
+ * @see JobStatusCommand
+ * @see JobAbortCommand
+ */
+public class JobSubmitCommand extends IntegerReplyCommand implements Runnable
+{
+	/**
+	 * Revision Control System id string, showing the version of the Class.
+	 */
+	public final static String RCSID = new String("$Id$");
+
+	/**
+	 * Default constructor.
+	 * @see IntegerReplyCommand
+	 * @see #commandString
+	 */
+	public JobSubmitCommand()
+	{
+		super();
+		commandString = null;
+	}
+
+	/**
+	 * Constructor.
+	 * @param address A string representing the address of the server, i.e. "liric",
+	 *     "localhost"
+	 * @param portNumber An integer representing the port number the server is receiving command on.
+	 * @see IntegerReplyCommand
+	 * @see Command#setAddress
+	 * @see Command#setPortNumber
+	 * @exception UnknownHostException Thrown if the address in unknown.
+	 */
+	public JobSubmitCommand(String address,int portNumber) throws UnknownHostException
+	{
+		super();
+		super.setAddress(address);
+		super.setPortNumber(portNumber);
+	}
+
+	/**
+	 * Setup the command to submit a multrun job.
+	 * @param exposureLength The length of each exposure in the multrun, in milliseconds.
+	 * @param exposureCount The number of frames to take in the multrun.
+	 * @param standard A boolean. If true the multrun is of a standard, otherwise it is of a exposure.
+	 * @see #commandString
+	 */
+	public void setMultrunCommand(int exposureLength,int exposureCount,boolean standard)
+	{
+		commandString = new String("job multrun "+exposureLength+" "+exposureCount+" "+standard);
+	}
+
+	/**
+	 * Setup the command to submit a multbias job.
+	 * @param exposureCount The number of bias frames to take.
+	 * @see #commandString
+	 */
+	public void setMultbiasCommand(int exposureCount)
+	{
+		commandString = new String("job multbias "+exposureCount);
+	}
+
+	/**
+	 * Setup the command to submit a multdark job.
+	 * @param exposureLength The length of each dark exposure, in milliseconds.
+	 * @param exposureCount The number of dark frames to take.
+	 * @see #commandString
+	 */
+	public void setMultdarkCommand(int exposureLength,int exposureCount)
+	{
+		commandString = new String("job multdark "+exposureLength+" "+exposureCount);
+	}
+
+	/**
+	 * Get the id of the submitted job.
+	 * @return The job id.
+	 * @see #getParsedReplyInteger
+	 */
+	public int getJobId()
+	{
+		return getParsedReplyInteger();
+	}
+
+	/**
+	 * Main test program.
+	 * @param args The argument list.
+	 */
+	public static void main(String args[])
+	{
+		JobSubmitCommand command = null;
+		String hostname = null;
+		int portNumber = 8284;
+
+		if(args.length < 4)
+		{
+			System.out.println("java ngat.liric.command.JobSubmitCommand <hostname> <port number> "+
+					   "multrun <exposure length> <exposure count> <standard>");
+			System.out.println("java ngat.liric.command.JobSubmitCommand <hostname> <port number> "+
+					   "multbias <exposure count>");
+			System.out.println("java ngat.liric.command.JobSubmitCommand <hostname> <port number> "+
+					   "multdark <exposure length> <exposure count>");
+			System.exit(1);
+		}
+		try
+		{
+			hostname = args[0];
+			portNumber = Integer.parseInt(args[1]);
+			command = new JobSubmitCommand(hostname,portNumber);
+			if(args[2].equals("multrun")&&(args.length == 6))
+			{
+				command.setMultrunCommand(Integer.parseInt(args[3]),Integer.parseInt(args[4]),
+							  args[5].equals("true"));
+			}
+			else if(args[2].equals("multbias")&&(args.length == 4))
+				command.setMultbiasCommand(Integer.parseInt(args[3]));
+			else if(args[2].equals("multdark")&&(args.length == 5))
+				command.setMultdarkCommand(Integer.parseInt(args[3]),Integer.parseInt(args[4]));
+			else
+				throw new IllegalArgumentException("JobSubmitCommand:Illegal job arguments.");
+			command.run();
+			if(command.getRunException() != null)
+			{
+				System.err.println("JobSubmitCommand: Command failed.");
+				command.getRunException().printStackTrace(System.err);
+				System.exit(1);
+			}
+			System.out.println("Finished:"+command.getCommandFinished());
+			System.out.println("Reply Parsed OK:"+command.getParsedReplyOK());
+			System.out.println("Job Id:"+command.getJobId());
+		}
+		catch(Exception e)
+		{
+			e.printStackTrace(System.err);
+			System.exit(1);
+		}
+		System.exit(0);
+	}
+}
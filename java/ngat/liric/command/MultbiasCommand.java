@@ -48,13 +48,17 @@ public class MultbiasCommand extends Command implements Runnable
 	}
 
 	/**
-	 * Setup the Multbias command. 
+	 * Setup the Multbias command. The session read timeout is set to allow for reading out and saving each frame.
 	 * @param exposureCount Set the number of frames to take in the Multbias. 
 	 * @see #commandString
+	 * @see Command#setSessionTimeout
+	 * @see CommandSession#DEFAULT_TIMEOUT
+	 * @see CommandSession#FRAME_TIMEOUT
 	 */
 	public void setCommand(int exposureCount)
 	{
 		commandString = new String("multbias "+exposureCount);
+		setSessionTimeout(CommandSession.DEFAULT_TIMEOUT+(exposureCount*CommandSession.FRAME_TIMEOUT));
 	}
 
 	/**
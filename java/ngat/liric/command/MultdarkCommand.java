@@ -48,14 +48,20 @@ public class MultdarkCommand extends Command implements Runnable
 	}
 
 	/**
-	 * Setup the Multdark command. 
+	 * Setup the Multdark command. The session read timeout is set to allow for each exposure, and reading out
+	 * and saving each frame.
 	 * @param exposureLength Set the length of each dark exposure in the multdark, in milliseconds. 
 	 * @param exposureCount Set the number of frames to take in the Multdark. 
 	 * @see #commandString
+	 * @see Command#setSessionTimeout
+	 * @see CommandSession#DEFAULT_TIMEOUT
+	 * @see CommandSession#FRAME_TIMEOUT
 	 */
 	public void setCommand(int exposureLength,int exposureCount)
 	{
 		commandString = new String("multdark "+exposureLength+" "+exposureCount);
+		setSessionTimeout(CommandSession.DEFAULT_TIMEOUT+
+				  (exposureCount*(exposureLength+CommandSession.FRAME_TIMEOUT)));
 	}
 
 	/**
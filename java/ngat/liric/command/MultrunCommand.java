@@ -48,15 +48,21 @@ public class MultrunCommand extends Command implements Runnable
 	}
 
 	/**
-	 * Setup the Multrun command. 
+	 * Setup the Multrun command. The session read timeout is set to allow for each exposure, and reading out
+	 * and saving each frame.
 	 * @param exposureLength Set the length of each exposure in the multrun, in milliseconds. 
 	 * @param exposureCount Set the number of frames to take in the Multrun. 
 	 * @param standard A boolean. If true the multrun is of a standard, otherwise it is of a exposure.
 	 * @see #commandString
+	 * @see Command#setSessionTimeout
+	 * @see CommandSession#DEFAULT_TIMEOUT
+	 * @see CommandSession#FRAME_TIMEOUT
 	 */
 	public void setCommand(int exposureLength,int exposureCount,boolean standard)
 	{
 		commandString = new String("multrun "+exposureLength+" "+exposureCount+" "+standard);
+		setSessionTimeout(CommandSession.DEFAULT_TIMEOUT+
+				  (exposureCount*(exposureLength+CommandSession.FRAME_TIMEOUT)));
 	}
 
 	/**
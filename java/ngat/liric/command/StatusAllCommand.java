@@ -0,0 +1,235 @@
+// StatusAllCommand.java
+// $Id$
+package ngat.liric.command;
+
+import java.io.*;
+import java.lang.*;
+import java.net.*;
+import java.text.*;
+import java.util.*;
+
+/**
+ * The "status all" command is an extension of Command, and returns a snapshot of all the status
+ * fields GET_STATUS needs (exposure, temperature, filter wheel and nudgematic status) in one reply.
+ * The reply is a space separated list of key=value pairs, which is parsed into a hashtable.
+ * @author Chris Mottram
+ * @version $Revision$
+ */
+public class StatusAllCommand extends Command implements Runnable
+{
+	/**
+	 * Revision Control System id string, showing the version of the Class.
+	 */
+	public final static String RCSID = new String("$Id$");
+	/**
+	 * The command to send to the server.
+	 */
+	public final static String COMMAND_STRING = new String("status all");
+	/**
+	 * The value the C layer returns for a key whose status could not be retrieved.
+	 */
+	public final static String VALUE_ERROR = new String("error");
+	/**
+	 * The format of time values in the reply, i.e. '2020-04-15T13:59:59.123+0000'.
+	 */
+	public final static String DATE_FORMAT_STRING = new String("yyyy-MM-dd'T'HH:mm:ss.SSSZ");
+	/**
+	 * Hashtable of parsed key/value pairs (both Strings).
+	 * Could be declared:  Generic:&lt;String, String&gt; but this is not supported by Java 1.4.
+	 */
+	protected Hashtable statusHashtable = new Hashtable();
+
+	/**
+	 * Default constructor.
+	 * @see Command
+	 * @see #commandString
+	 * @see #COMMAND_STRING
+	 */
+	public StatusAllCommand()
+	{
+		super();
+		commandString = COMMAND_STRING;
+	}
+
+	/**
+	 * Constructor.
+	 * @param address A string representing the address of the server, i.e. "liric",
+	 *     "localhost"
+	 * @param portNumber An integer representing the port number the server is receiving command on.
+	 * @see Command
+	 * @see #COMMAND_STRING
+	 * @exception UnknownHostException Thrown if the address in unknown.
+	 */
+	public StatusAllCommand(String address,int portNumber) throws UnknownHostException
+	{
+		super(address,portNumber,COMMAND_STRING);
+	}
+
+	/**
+	 * Parse a string returned from the server over the telnet connection.
+	 * In this case it is of the form: '&lt;n&gt; &lt;key&gt;=&lt;value&gt; &lt;key&gt;=&lt;value&gt; ...'.
+	 * The first number is a success failure code, if it is zero the key/value pairs follow, and are
+	 * put into statusHashtable.
+	 * @exception Exception Thrown if a parse error occurs.
+	 * @see #replyString
+	 * @see #parsedReplyString
+	 * @see #parsedReplyOk
+	 * @see #statusHashtable
+	 */
+	public void parseReplyString() throws Exception
+	{
+		StringTokenizer st = null;
+		String pairString = null;
+		int sindex;
+
+		super.parseReplyString();
+		statusHashtable.clear();
+		if(parsedReplyOk == false)
+			return;
+		st = new StringTokenizer(parsedReplyString," ");
+		while(st.hasMoreTokens())
+		{
+			pairString = st.nextToken();
+			sindex = pairString.indexOf('=');
+			if(sindex < 1)
+			{
+				throw new Exception(this.getClass().getName()+
+						    ":parseReplyString:Failed to find key/value separator in '"+
+						    pairString+"' in reply:"+replyString);
+			}
+			statusHashtable.put(pairString.substring(0,sindex),pairString.substring(sindex+1));
+		}// end while
+	}
+
+	/**
+	 * Get the value of the specified key in the returned status.
+	 * @param key The key of the status value to return, e.g. "exposure.count".
+	 * @return The value, as a string.
+	 * @exception Exception Thrown if the command failed, the key was not returned by the C layer, or the
+	 *            C layer could not retrieve the value (it is VALUE_ERROR).
+	 * @see #statusHashtable
+	 * @see #VALUE_ERROR
+	 */
+	public String getValue(String key) throws Exception
+	{
+		String valueString = null;
+
+		if(parsedReplyOk == false)
+		{
+			if(runException != null)
+				throw runException;
+			else
+				throw new Exception(this.getClass().getName()+":getValue:Unknown Error.");
+		}
+		valueString = (String)(statusHashtable.get(key));
+		if(valueString == null)
+		{
+			throw new Exception(this.getClass().getName()+":getValue:Key "+key+
+					    " not found in reply:"+replyString);
+		}
+		if(valueString.equals(VALUE_ERROR))
+		{
+			throw new Exception(this.getClass().getName()+":getValue:C layer failed to get "+key+".");
+		}
+		return valueString;
+	}
+
+	/**
+	 * Get the value of the specified key in the returned status, as an integer.
+	 * @param key The key of the status value to return, e.g. "exposure.count".
+	 * @return The value, as an integer.
+	 * @exception Exception Thrown if getValue fails, or the value is not a valid integer.
+	 * @see #getValue
+	 */
+	public int getValueInteger(String key) throws Exception
+	{
+		return Integer.parseInt(getValue(key));
+	}
+
+	/**
+	 * Get the value of the specified key in the returned status, as a double.
+	 * @param key The key of the status value to return, e.g. "temperature".
+	 * @return The value, as a double.
+	 * @exception Exception Thrown if getValue fails, or the value is not a valid double.
+	 * @see #getValue
+	 */
+	public double getValueDouble(String key) throws Exception
+	{
+		return Double.parseDouble(getValue(key));
+	}
+
+	/**
+	 * Get the value of the specified key in the returned status, as a boolean.
+	 * @param key The key of the status value to return, e.g. "exposure.status".
+	 * @return The value, true if the value was "true", and false otherwise.
+	 * @exception Exception Thrown if getValue fails.
+	 * @see #getValue
+	 */
+	public boolean getValueBoolean(String key) throws Exception
+	{
+		return getValue(key).equals("true");
+	}
+
+	/**
+	 * Get the value of the specified key in the returned status, as a date.
+	 * @param key The key of the status value to return, e.g. "exposure.start_time".
+	 * @return The value, as a date.
+	 * @exception Exception Thrown if getValue fails, or the value is not a valid date of the form
+	 *            DATE_FORMAT_STRING.
+	 * @see #getValue
+	 * @see #DATE_FORMAT_STRING
+	 */
+	public Date getValueDate(String key) throws Exception
+	{
+		SimpleDateFormat dateFormat = null;
+
+		dateFormat = new SimpleDateFormat(DATE_FORMAT_STRING);
+		return dateFormat.parse(getValue(key));
+	}
+
+	/**
+	 * Main test program.
+	 * @param args The argument list.
+	 */
+	public static void main(String args[])
+	{
+		StatusAllCommand command = null;
+		Enumeration keyList = null;
+		String hostname = null;
+		String key = null;
+		int portNumber = 8284;
+
+		if(args.length != 2)
+		{
+			System.out.println("java ngat.liric.command.StatusAllCommand <hostname> <port number>");
+			System.exit(1);
+		}
+		try
+		{
+			hostname = args[0];
+			portNumber = Integer.parseInt(args[1]);
+			command = new StatusAllCommand(hostname,portNumber);
+			command.run();
+			if(command.getRunException() != null)
+			{
+				System.err.println("StatusAllCommand: Command failed.");
+				command.getRunException().printStackTrace(System.err);
+				System.exit(1);
+			}
+			System.out.println("Finished:"+command.getCommandFinished());
+			System.out.println("Reply Parsed OK:"+command.getParsedReplyOK());
+			keyList = command.statusHashtable.keys();
+			while(keyList.hasMoreElements())
+			{
+				key = (String)(keyList.nextElement());
+				System.out.println(key+":"+command.statusHashtable.get(key));
+			}
+		}
+		catch(Exception e)
+		{
+			e.printStackTrace(System.err);
+			System.exit(1);
+		}
+		System.exit(0);
+	}
+}
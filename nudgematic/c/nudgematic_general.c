@@ -241,13 +241,16 @@ void Nudgematic_General_Get_Current_Time_String(char *time_string,int string_len
 
 /**
  * Routine to log a message to a defined logging mechanism. This routine has an arbitary number of arguments,
- * and uses vsprintf to format them i.e. like fprintf. 
+ * and uses vsnprintf to format them i.e. like fprintf. 
  * Nudgematic_General_Log is then called to handle the log message.
+ * We first call Nudgematic_General_Log_Level_Enabled, and return without formatting the message if it
+ * would be filtered out anyway, so suppressed messages cost a function call and a comparison.
  * @param level An integer, used to decide whether this particular message has been selected for
  * 	logging or not.
  * @param format A string, with formatting statements the same as fprintf would use to determine the type
  * 	of the following arguments.
  * @see #Nudgematic_General_Log
+ * @see #Nudgematic_General_Log_Level_Enabled
  * @see #LOG_BUFF_LENGTH
  */
 void Nudgematic_General_Log_Format(int level,char *format,...)
@@ -255,9 +258,12 @@ void Nudgematic_General_Log_Format(int level,char *format,...)
 	char buff[LOG_BUFF_LENGTH];
 	va_list ap;
 
+/* don't format messages that will be filtered out */
+	if(!Nudgematic_General_Log_Level_Enabled(level))
+		return;
 /* format the arguments */
 	va_start(ap,format);
-	vsprintf(buff,format,ap);
+	vsnprintf(buff,LOG_BUFF_LENGTH,format,ap);
 	va_end(ap);
 /* call the log routine to log the results */
 	Nudgematic_General_Log(level,buff);
@@ -290,6 +296,31 @@ void Nudgematic_General_Log(int level,char *string)
 	(*General_Data.Log_Handler)(level,string);
 }
 
+/**
+ * Routine to decide whether a message at the specified level would be logged, without needing the message itself.
+ * A message is not logged if there is no General_Data.Log_Handler. If General_Data.Log_Filter is one of the
+ * level only filters (Nudgematic_General_Log_Filter_Level_Absolute or Nudgematic_General_Log_Filter_Level_Bitwise), 
+ * we call it with a NULL string, as they don't look at the message. Any other filter may look at the message
+ * text, so we assume the message may be logged.
+ * @param level An integer, the log level of the message.
+ * @return The routine returns TRUE if a message at this level may be logged, and FALSE if it will be
+ *         filtered out.
+ * @see #General_Data
+ * @see #Nudgematic_General_Log_Filter_Level_Absolute
+ * @see #Nudgematic_General_Log_Filter_Level_Bitwise
+ */
+int Nudgematic_General_Log_Level_Enabled(int level)
+{
+	if(General_Data.Log_Handler == NULL)
+		return FALSE;
+	if((General_Data.Log_Filter == Nudgematic_General_Log_Filter_Level_Absolute)||
+	   (General_Data.Log_Filter == Nudgematic_General_Log_Filter_Level_Bitwise))
+	{
+		return General_Data.Log_Filter(level,NULL);
+	}
+	return TRUE;
+}
+
 /**
  * Routine to set the General_Data.Log_Handler used by Nudgematic_General_Log.
  * @param log_fn A function pointer to a suitable handler.
@@ -240,13 +240,16 @@ void USB_PIO_General_Get_Current_Time_String(char *time_string,int string_length
 
 /**
  * Routine to log a message to a defined logging mechanism. This routine has an arbitary number of arguments,
- * and uses vsprintf to format them i.e. like fprintf. 
+ * and uses vsnprintf to format them i.e. like fprintf. 
  * USB_PIO_General_Log is then called to handle the log message.
+ * We first call USB_PIO_General_Log_Level_Enabled, and return without formatting the message if it
+ * would be filtered out anyway, so suppressed messages cost a function call and a comparison.
  * @param level An integer, used to decide whether this particular message has been selected for
  * 	logging or not.
  * @param format A string, with formatting statements the same as fprintf would use to determine the type
  * 	of the following arguments.
  * @see #USB_PIO_General_Log
+ * @see #USB_PIO_General_Log_Level_Enabled
  * @see #LOG_BUFF_LENGTH
  */
 void USB_PIO_General_Log_Format(int level,char *format,...)
@@ -254,9 +257,12 @@ void USB_PIO_General_Log_Format(int level,char *format,...)
 	char buff[LOG_BUFF_LENGTH];
 	va_list ap;
 
+/* don't format messages that will be filtered out */
+	if(!USB_PIO_General_Log_Level_Enabled(level))
+		return;
 /* format the arguments */
 	va_start(ap,format);
-	vsprintf(buff,format,ap);
+	vsnprintf(buff,LOG_BUFF_LENGTH,format,ap);
 	va_end(ap);
 /* call the log routine to log the results */
 	USB_PIO_General_Log(level,buff);
@@ -289,6 +295,31 @@ void USB_PIO_General_Log(int level,char *string)
 	(*General_Data.Log_Handler)(level,string);
 }
 
+/**
+ * Routine to decide whether a message at the specified level would be logged, without needing the message itself.
+ * A message is not logged if there is no General_Data.Log_Handler. If General_Data.Log_Filter is one of the
+ * level only filters (USB_PIO_General_Log_Filter_Level_Absolute or USB_PIO_General_Log_Filter_Level_Bitwise), 
+ * we call it with a NULL string, as they don't look at the message. Any other filter may look at the message
+ * text, so we assume the message may be logged.
+ * @param level An integer, the log level of the message.
+ * @return The routine returns TRUE if a message at this level may be logged, and FALSE if it will be
+ *         filtered out.
+ * @see #General_Data
+ * @see #USB_PIO_General_Log_Filter_Level_Absolute
+ * @see #USB_PIO_General_Log_Filter_Level_Bitwise
+ */
+int USB_PIO_General_Log_Level_Enabled(int level)
+{
+	if(General_Data.Log_Handler == NULL)
+		return FALSE;
+	if((General_Data.Log_Filter == USB_PIO_General_Log_Filter_Level_Absolute)||
+	   (General_Data.Log_Filter == USB_PIO_General_Log_Filter_Level_Bitwise))
+	{
+		return General_Data.Log_Filter(level,NULL);
+	}
+	return TRUE;
+}
+
 /**
  * Routine to set the General_Data.Log_Handler used by USB_PIO_General_Log.
  * @param log_fn A function pointer to a suitable handler.